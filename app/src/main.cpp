@@ -8,8 +8,10 @@
 #include <QStandardPaths>
 #include "cache.hpp"
 #include "config.hpp"
+#include "history.hpp"
 #include "opengl.hpp"
-#include "time-delta.hpp"
+#include "parallel.hpp"
+#include "profile.hpp"
 #include "util.hpp"
 #include "view/log.hpp"
 #include "view/main-window.hpp"
@@ -21,6 +23,22 @@ namespace
     return QStandardPaths::locate (QStandardPaths::ConfigLocation, "dilay.config");
   }
 
+  QString programCachePath ()
+  {
+    const QString configDirName (QStandardPaths::writableLocation (QStandardPaths::ConfigLocation));
+
+    return configDirName.isEmpty () ? QString () : QDir (configDirName).filePath ("dilay-programs");
+  }
+
+  // the cache directory can be overridden by the environment
+  QString historyCachePath ()
+  {
+    const QString path = QString::fromLocal8Bit (qgetenv ("DILAY_CACHE"));
+
+    return path.isEmpty () ? QStandardPaths::writableLocation (QStandardPaths::CacheLocation)
+                           : path;
+  }
+
   void backupCrashLog ()
   {
     QFile log (ViewLog::logPath ());
@@ -48,16 +66,30 @@ int main (int argv, char** args)
 
   QCoreApplication::setApplicationName ("Dilay");
   QCoreApplication::setAttribute (Qt::AA_UseDesktopOpenGL);
-  OpenGL::setDefaultFormat ();
+  // the side view renders the buffers and programs of the main view
+  QCoreApplication::setAttribute (Qt::AA_ShareOpenGLContexts);
 
-  QApplication app (argv, args);
-  Config       config;
-  Cache        cache;
+  Config config;
 
   if (configPath ().isEmpty () == false)
   {
     config.fromFile (configPath ().toStdString ());
   }
+  OpenGL::setDefaultFormat (config.get<bool> ("editor/prefer-core-profile"));
+
+  QApplication app (argv, args);
+  Cache        cache;
+
+  Parallel::initialize (std::max (0, config.get<int> ("editor/num-threads")));
+
+  // profiles are recorded if a trace file is given
+  const QString tracePath = QString::fromLocal8Bit (qgetenv ("DILAY_TRACE"));
+  if (tracePath.isEmpty () == false)
+  {
+    Profile::start ();
+  }
+  OpenGL::programCacheDirectory (programCachePath ().toStdString ());
+  History::cacheDirectory (historyCachePath ().toStdString ());
 
   ViewMainWindow mainWindow (config, cache);
   mainWindow.resize (config.get<int> ("window/initial-width"),
@@ -77,6 +109,11 @@ int main (int argv, char** args)
       config.toFile (configDir.filePath ("dilay.config").toStdString ());
     }
   });
-  TimeDelta::initialize ();
+  QObject::connect (&app, &QApplication::aboutToQuit, [&tracePath]() {
+    if (tracePath.isEmpty () == false && Profile::toChromeTrace (tracePath.toStdString ()) == false)
+    {
+      DILAY_WARN ("Can not write trace file '%s'", tracePath.toStdString ().c_str ())
+    }
+  });
   return app.exec ();
 }
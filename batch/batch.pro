@@ -0,0 +1,28 @@
+include (../common.pri)
+
+TEMPLATE        = app
+TARGET          = dilay-batch
+DESTDIR         = $$OUT_PWD/..
+DEPENDPATH     += src 
+INCLUDEPATH    += src $$PWD/../lib/src
+SOURCES        += src/main.cpp \
+                  src/shard-file.cpp
+HEADERS        += src/shard-file.hpp
+
+win32:CONFIG(release, debug|release):    LIBS += -L$$OUT_PWD/../lib/release/ -ldilay
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../lib/debug/ -ldilay
+else:unix:                               LIBS += -L$$OUT_PWD/../lib/ -ldilay
+
+win32-g++:CONFIG(release, debug|release):             PRE_TARGETDEPS += $$OUT_PWD/../lib/release/libdilay.a
+else:win32-g++:CONFIG(debug, debug|release):          PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/libdilay.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/dilay.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release):   PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/dilay.lib
+else:unix:                                            PRE_TARGETDEPS += $$OUT_PWD/../lib/libdilay.a
+
+unix {
+  target.path     = $$PREFIX/bin/
+  INSTALLS       += target
+
+  format.commands = clang-format -style=file -i $$SOURCES $$HEADERS
+  QMAKE_EXTRA_TARGETS += format
+}
@@ -0,0 +1,551 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QCoreApplication>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "config.hpp"
+#include "dimension.hpp"
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/csg.hpp"
+#include "isosurface-extraction/shard.hpp"
+#include "parallel.hpp"
+#include "primitive/plane.hpp"
+#include "primitive/aabox.hpp"
+#include "scene.hpp"
+#include "shard-file.hpp"
+#include "sketch/mesh.hpp"
+#include "tool/convert-sketch/action.hpp"
+#include "tool/remesh/action.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/recording.hpp"
+#include "util.hpp"
+
+/* Runs a pipeline of steps on all meshes of a scene without an OpenGL context, i.e., meshes are
+ * never buffered.  Each extraction uses all threads of the thread pool.  Remeshes that exceed a
+ * single machine are sharded: each shard of the union of all meshes is extracted by a separate
+ * process, and the shards are stitched into a single mesh afterwards.
+ */
+namespace
+{
+  enum class StepKind
+  {
+    Convert,
+    Remesh,
+    Smooth,
+    Mirror,
+    Replay,
+    Synthesize
+  };
+
+  struct Step
+  {
+    StepKind              kind;
+    Dimension             dimension;
+    std::string           fileName;
+    std::string           brush;
+    SculptRecording::Path path;
+  };
+
+  enum class Mode
+  {
+    Steps,
+    CountShards,
+    ExtractShard,
+    Stitch
+  };
+
+  struct Parameters
+  {
+    float        resolution;
+    float        blend;
+    bool         adaptive;
+    unsigned int shardSize;
+    // the brush and the path are given by each step
+    SculptRecording::Workload workload;
+  };
+
+  void usage ()
+  {
+    std::cerr << "usage: dilay-batch [OPTION ...] [STEP ...] INPUT.dly OUTPUT\n"
+              << "       dilay-batch [OPTION ...] --count-shards INPUT.dly\n"
+              << "       dilay-batch [OPTION ...] --shard I INPUT.dly OUTPUT.shard\n"
+              << "       dilay-batch [OPTION ...] [STEP ...] --stitch SHARD ... OUTPUT\n"
+              << "options:\n"
+              << "  --threads N       number of threads (all cores by default)\n"
+              << "  --resolution R    resolution of conversions and remeshes (0.06)\n"
+              << "  --blend B         blend radius of conversions (0)\n"
+              << "  --adaptive        coarsens flat regions after conversions and remeshes\n"
+              << "  --shard-size N    number of samples along each side of a shard (128)\n"
+              << "  --strokes N       number of synthetic strokes (4)\n"
+              << "  --dabs N          number of dabs of each synthetic stroke (64)\n"
+              << "  --radius R        synthetic brush radius relative to the mesh size (0.05)\n"
+              << "  --intensity I     synthetic brush intensity (0.5)\n"
+              << "  --detail D        synthetic brush detail factor, i.e., when to subdivide\n"
+              << "                    (0.75)\n"
+              << "  --seed N          seed of synthetic random walks (0)\n"
+              << "steps, which are run in the given order:\n"
+              << "  --convert         converts sketches to meshes\n"
+              << "  --remesh          remeshes all meshes\n"
+              << "  --smooth          smoothes all meshes\n"
+              << "  --mirror x|y|z    mirrors the positive side of all meshes and sketches\n"
+              << "  --replay FILE     replays recorded sculpt strokes and prints the duration of\n"
+              << "                    each dab as CSV\n"
+              << "  --synthesize BRUSH PATH\n"
+              << "                    replays synthetic strokes over the first mesh like\n"
+              << "                    --replay, where BRUSH is draw, crease, grab, pinch,\n"
+              << "                    smooth, flatten or reduce, and PATH is random-walk,\n"
+              << "                    spiral or drag\n"
+              << "sharded remeshes:\n"
+              << "  --count-shards    prints the number of shards of the remesh of all meshes\n"
+              << "  --shard I         extracts the I-th shard of the remesh of all meshes\n"
+              << "  --stitch          stitches the given shards and runs the steps on the result\n"
+              << "the output is written as Wavefront file if its extension is .obj\n";
+  }
+
+  bool parseDimension (const std::string& arg, Dimension& dimension)
+  {
+    if (arg == "x")
+    {
+      dimension = Dimension::X;
+    }
+    else if (arg == "y")
+    {
+      dimension = Dimension::Y;
+    }
+    else if (arg == "z")
+    {
+      dimension = Dimension::Z;
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  }
+
+  bool endsWith (const std::string& string, const std::string& suffix)
+  {
+    return string.size () >= suffix.size () &&
+           string.compare (string.size () - suffix.size (), suffix.size (), suffix) == 0;
+  }
+
+  void finalizeMesh (const Parameters& parameters, DynamicMesh& mesh)
+  {
+    ToolSculptAction::smoothMesh (mesh);
+
+    if (parameters.adaptive)
+    {
+      ToolSculptAction::coarsenFlatRegions (mesh, parameters.resolution);
+    }
+  }
+
+  bool convert (const Config& config, const Parameters& parameters, Scene& scene)
+  {
+    std::vector<SketchMesh*> sketches;
+    scene.forEachMesh ([&sketches](SketchMesh& sketch) { sketches.push_back (&sketch); });
+
+    for (SketchMesh* sketch : sketches)
+    {
+      glm::vec3 min, max;
+      sketch->minMax (min, max);
+      sketch->optimizePaths ();
+
+      DynamicMesh mesh;
+      ToolConvertSketchAction::convert (sketch->primitives (), min, max, parameters.resolution,
+                                        parameters.blend, mesh);
+      scene.deleteMesh (*sketch);
+
+      if (mesh.isEmpty ())
+      {
+        std::cerr << "could not convert sketch\n";
+        return false;
+      }
+      finalizeMesh (parameters, scene.newDynamicMesh (config, mesh));
+    }
+    return true;
+  }
+
+  bool remesh (const Config& config, const Parameters& parameters, Scene& scene)
+  {
+    std::vector<DynamicMesh*> meshes;
+    scene.forEachMesh ([&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
+
+    for (DynamicMesh* mesh : meshes)
+    {
+      DynamicMesh extractedMesh;
+      ToolRemeshAction::remesh (*mesh, parameters.resolution, extractedMesh);
+      scene.deleteMesh (*mesh);
+
+      if (extractedMesh.isEmpty ())
+      {
+        std::cerr << "could not remesh mesh\n";
+        return false;
+      }
+      finalizeMesh (parameters, scene.newDynamicMesh (config, extractedMesh));
+    }
+    return true;
+  }
+
+  bool mirror (Dimension dimension, Scene& scene)
+  {
+    const PrimPlane plane (glm::vec3 (0.0f), DimensionUtil::vector (dimension));
+    bool            success = true;
+
+    scene.forEachMesh ([&plane, &success](DynamicMesh& mesh) {
+      if (mesh.mirrorPositive (plane) == false)
+      {
+        std::cerr << "could not mirror mesh\n";
+        success = false;
+      }
+    });
+    scene.forEachMesh ([dimension](SketchMesh& sketch) { sketch.mirrorPositive (dimension); });
+    return success;
+  }
+
+  // the union of all meshes, whose bounds must be equal for all shards
+  IsosurfaceExtractionCsg shardedMeshes (const Parameters& parameters, const Scene& scene)
+  {
+    std::vector<const DynamicMesh*> meshes;
+    scene.forEachConstMesh ([&meshes](const DynamicMesh& mesh) { meshes.push_back (&mesh); });
+
+    return IsosurfaceExtractionCsg (IsosurfaceExtractionCsg::Operation::Union, meshes,
+                                    parameters.resolution);
+  }
+
+  bool extractShard (const Parameters& parameters, unsigned int index, const Scene& scene,
+                     const std::string& fileName)
+  {
+    const IsosurfaceExtractionCsg csg = shardedMeshes (parameters, scene);
+    const glm::uvec3              numShards =
+      IsosurfaceExtraction::numShards (csg.bounds (), parameters.resolution, parameters.shardSize);
+
+    if (index >= numShards.x * numShards.y * numShards.z)
+    {
+      std::cerr << "shard " << index << " does not exist\n";
+      return false;
+    }
+
+    const glm::uvec3 shardIndex (index % numShards.x, (index / numShards.x) % numShards.y,
+                                 index / (numShards.x * numShards.y));
+
+    IsosurfaceExtractionShard shard;
+    IsosurfaceExtraction::extractShard (csg.distancesCallback (), csg.intersectionCallback (),
+                                        csg.bounds (), parameters.resolution,
+                                        parameters.shardSize, shardIndex, shard);
+
+    if (ShardFile::write (fileName, parameters.resolution, parameters.shardSize, shard) == false)
+    {
+      std::cerr << "could not write " << fileName << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  bool stitch (const Config& config, const Parameters& parameters,
+               const std::vector<std::string>& fileNames, Scene& scene)
+  {
+    std::vector<IsosurfaceExtractionShard> shards (fileNames.size ());
+
+    for (unsigned int i = 0; i < fileNames.size (); i++)
+    {
+      float        resolution;
+      unsigned int shardSize;
+
+      if (ShardFile::read (fileNames[i], resolution, shardSize, shards[i]) == false)
+      {
+        std::cerr << "could not load " << fileNames[i] << "\n";
+        return false;
+      }
+      else if (resolution != parameters.resolution || shardSize != parameters.shardSize)
+      {
+        std::cerr << fileNames[i] << " is a shard of a different extraction\n";
+        return false;
+      }
+    }
+
+    DynamicMesh mesh;
+    IsosurfaceExtraction::stitch (shards, mesh);
+
+    if (mesh.isEmpty ())
+    {
+      std::cerr << "could not stitch shards\n";
+      return false;
+    }
+    finalizeMesh (parameters, scene.newDynamicMesh (config, mesh));
+    return true;
+  }
+
+  // prints the duration of each dab as CSV and a summary of all dabs to the standard error
+  bool replay (const SculptRecording& recording, Scene& scene)
+  {
+    std::vector<float> milliseconds;
+
+    std::cout << "dab,milliseconds\n";
+    if (recording.replay (scene, [&milliseconds](unsigned int i, float duration) {
+          milliseconds.push_back (duration * 1000.0f);
+          std::cout << i << "," << milliseconds.back () << "\n";
+        }) == false)
+    {
+      return false;
+    }
+
+    if (milliseconds.empty () == false)
+    {
+      float sum = 0.0f;
+      for (float ms : milliseconds)
+      {
+        sum += ms;
+      }
+      std::sort (milliseconds.begin (), milliseconds.end ());
+
+      std::cerr << milliseconds.size () << " dabs, "
+                << 1000.0f * float(milliseconds.size ()) / glm::max (sum, 1e-6f)
+                << " dabs per second, p50 " << milliseconds[milliseconds.size () / 2]
+                << " ms, p99 " << milliseconds[(milliseconds.size () * 99) / 100] << " ms\n";
+    }
+    return true;
+  }
+
+  bool replay (const std::string& fileName, Scene& scene)
+  {
+    SculptRecording recording;
+    if (recording.fromFile (fileName) == false)
+    {
+      std::cerr << "could not read recording " << fileName << "\n";
+      return false;
+    }
+    else if (replay (recording, scene) == false)
+    {
+      std::cerr << "recording " << fileName << " does not match the scene\n";
+      return false;
+    }
+    return true;
+  }
+
+  bool synthesize (const Parameters& parameters, const Step& step, Scene& scene)
+  {
+    SculptRecording           recording;
+    SculptRecording::Workload workload = parameters.workload;
+
+    workload.brush = step.brush;
+    workload.path = step.path;
+
+    if (recording.generate (scene, 0, workload) == false)
+    {
+      std::cerr << "could not synthesize strokes of brush " << step.brush << "\n";
+      return false;
+    }
+    return replay (recording, scene);
+  }
+
+  bool run (const Config& config, const Parameters& parameters, const Step& step, Scene& scene)
+  {
+    switch (step.kind)
+    {
+      case StepKind::Convert:
+        return convert (config, parameters, scene);
+      case StepKind::Remesh:
+        return remesh (config, parameters, scene);
+      case StepKind::Smooth:
+        scene.forEachMesh ([](DynamicMesh& mesh) { ToolSculptAction::smoothMesh (mesh); });
+        return true;
+      case StepKind::Mirror:
+        return mirror (step.dimension, scene);
+      case StepKind::Replay:
+        return replay (step.fileName, scene);
+      case StepKind::Synthesize:
+        return synthesize (parameters, step, scene);
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+}
+
+int main (int argc, char** argv)
+{
+  QCoreApplication::setApplicationName ("dilay");
+
+  QCoreApplication  app (argc, argv);
+  Config            config;
+  unsigned int      numThreads = 0;
+  Parameters        parameters{0.06f, 0.0f, false, 128};
+  Mode              mode = Mode::Steps;
+  unsigned int      shardIndex = 0;
+  std::vector<Step> steps;
+
+  std::vector<std::string> fileNames;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string     arg (argv[i]);
+    Dimension             dimension = Dimension::X;
+    SculptRecording::Path path = SculptRecording::Path::RandomWalk;
+
+    if (arg == "--threads" && i + 1 < argc)
+    {
+      numThreads = std::stoul (argv[++i]);
+    }
+    else if (arg == "--resolution" && i + 1 < argc)
+    {
+      parameters.resolution = std::stof (argv[++i]);
+    }
+    else if (arg == "--blend" && i + 1 < argc)
+    {
+      parameters.blend = std::stof (argv[++i]);
+    }
+    else if (arg == "--adaptive")
+    {
+      parameters.adaptive = true;
+    }
+    else if (arg == "--shard-size" && i + 1 < argc)
+    {
+      parameters.shardSize = std::stoul (argv[++i]);
+    }
+    else if (arg == "--strokes" && i + 1 < argc)
+    {
+      parameters.workload.numStrokes = std::stoul (argv[++i]);
+    }
+    else if (arg == "--dabs" && i + 1 < argc)
+    {
+      parameters.workload.numDabsPerStroke = std::stoul (argv[++i]);
+    }
+    else if (arg == "--radius" && i + 1 < argc)
+    {
+      parameters.workload.radius = std::stof (argv[++i]);
+    }
+    else if (arg == "--intensity" && i + 1 < argc)
+    {
+      parameters.workload.intensity = std::stof (argv[++i]);
+    }
+    else if (arg == "--detail" && i + 1 < argc)
+    {
+      parameters.workload.detailFactor = std::stof (argv[++i]);
+    }
+    else if (arg == "--seed" && i + 1 < argc)
+    {
+      parameters.workload.seed = std::stoul (argv[++i]);
+    }
+    else if (arg == "--count-shards")
+    {
+      mode = Mode::CountShards;
+    }
+    else if (arg == "--shard" && i + 1 < argc)
+    {
+      mode = Mode::ExtractShard;
+      shardIndex = std::stoul (argv[++i]);
+    }
+    else if (arg == "--stitch")
+    {
+      mode = Mode::Stitch;
+    }
+    else if (arg == "--convert")
+    {
+      steps.push_back (Step{StepKind::Convert, dimension});
+    }
+    else if (arg == "--remesh")
+    {
+      steps.push_back (Step{StepKind::Remesh, dimension});
+    }
+    else if (arg == "--smooth")
+    {
+      steps.push_back (Step{StepKind::Smooth, dimension});
+    }
+    else if (arg == "--mirror" && i + 1 < argc && parseDimension (argv[i + 1], dimension))
+    {
+      steps.push_back (Step{StepKind::Mirror, dimension});
+      i++;
+    }
+    else if (arg == "--replay" && i + 1 < argc)
+    {
+      steps.push_back (Step{StepKind::Replay, dimension, argv[i + 1]});
+      i++;
+    }
+    else if (arg == "--synthesize" && i + 2 < argc &&
+             SculptRecording::parsePath (argv[i + 2], path))
+    {
+      steps.push_back (Step{StepKind::Synthesize, dimension, "", argv[i + 1], path});
+      i += 2;
+    }
+    else if (arg.empty () == false && arg[0] != '-')
+    {
+      fileNames.push_back (arg);
+    }
+    else
+    {
+      usage ();
+      return 1;
+    }
+  }
+
+  const unsigned int numFileNames = mode == Mode::CountShards ? 1 : 2;
+  const bool         validFileNames = mode == Mode::Stitch ? fileNames.size () >= numFileNames
+                                                   : fileNames.size () == numFileNames;
+
+  if (validFileNames == false || parameters.resolution <= 0.0f || parameters.blend < 0.0f ||
+      parameters.shardSize == 0 || parameters.workload.radius <= 0.0f ||
+      parameters.workload.detailFactor <= 0.0f)
+  {
+    usage ();
+    return 1;
+  }
+  Parallel::initialize (numThreads);
+
+  // deferred meshes would be buffered, and steps act on constructed meshes only
+  config.set ("editor/mesh/deferred-num-faces", 0);
+
+  Scene scene (config);
+
+  if (mode == Mode::Stitch)
+  {
+    const std::vector<std::string> shardFileNames (fileNames.begin (), fileNames.end () - 1);
+
+    if (stitch (config, parameters, shardFileNames, scene) == false)
+    {
+      return 1;
+    }
+  }
+  else if (scene.fromDlyFile (config, fileNames[0]) == false)
+  {
+    std::cerr << "could not load " << fileNames[0] << "\n";
+    return 1;
+  }
+
+  if ((mode == Mode::CountShards || mode == Mode::ExtractShard) && scene.numDynamicMeshes () == 0)
+  {
+    std::cerr << fileNames[0] << " does not contain any meshes\n";
+    return 1;
+  }
+  else if (mode == Mode::CountShards)
+  {
+    const glm::uvec3 numShards = IsosurfaceExtraction::numShards (
+      shardedMeshes (parameters, scene).bounds (), parameters.resolution, parameters.shardSize);
+
+    std::cout << numShards.x * numShards.y * numShards.z << "\n";
+    return 0;
+  }
+  else if (mode == Mode::ExtractShard)
+  {
+    return extractShard (parameters, shardIndex, scene, fileNames[1]) ? 0 : 1;
+  }
+
+  for (const Step& step : steps)
+  {
+    if (run (config, parameters, step, scene) == false)
+    {
+      return 1;
+    }
+  }
+
+  if (scene.toDlyFile (fileNames.back (), endsWith (fileNames.back (), ".obj")) == false)
+  {
+    std::cerr << "could not write " << fileNames.back () << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "isosurface-extraction/shard.hpp"
+#include "shard-file.hpp"
+
+namespace
+{
+  static const char header[] = "dilay-shard-1";
+
+  template <typename T> void write (std::ostream& stream, const T* values, std::size_t n)
+  {
+    stream.write (reinterpret_cast<const char*> (values), std::streamsize (n * sizeof (T)));
+  }
+
+  template <typename T> void write (std::ostream& stream, const T& value)
+  {
+    write (stream, &value, 1);
+  }
+
+  template <typename T> bool read (std::istream& stream, T* values, std::size_t n)
+  {
+    stream.read (reinterpret_cast<char*> (values), std::streamsize (n * sizeof (T)));
+    return bool(stream);
+  }
+
+  template <typename T> bool read (std::istream& stream, T& value)
+  {
+    return read (stream, &value, 1);
+  }
+
+  template <typename T> bool read (std::istream& stream, std::vector<T>& values)
+  {
+    std::uint32_t n;
+    if (read (stream, n) == false)
+    {
+      return false;
+    }
+    values.resize (n);
+    return read (stream, values.data (), values.size ());
+  }
+
+  template <typename T> void write (std::ostream& stream, const std::vector<T>& values)
+  {
+    write (stream, std::uint32_t (values.size ()));
+    write (stream, values.data (), values.size ());
+  }
+}
+
+namespace ShardFile
+{
+  bool write (const std::string& fileName, float resolution, unsigned int shardSize,
+              const IsosurfaceExtractionShard& shard)
+  {
+    std::ofstream file (fileName, std::ios::binary);
+
+    ::write (file, header, sizeof (header));
+    ::write (file, resolution);
+    ::write (file, std::uint32_t (shardSize));
+    ::write (file, shard.vertices);
+    ::write (file, shard.vertexKeys);
+    ::write (file, shard.indices);
+
+    return bool(file);
+  }
+
+  bool read (const std::string& fileName, float& resolution, unsigned int& shardSize,
+             IsosurfaceExtractionShard& shard)
+  {
+    std::ifstream file (fileName, std::ios::binary);
+    char          fileHeader[sizeof (header)];
+    std::uint32_t size;
+
+    if (::read (file, fileHeader, sizeof (header)) == false ||
+        std::memcmp (fileHeader, header, sizeof (header)) != 0)
+    {
+      return false;
+    }
+    if (::read (file, resolution) == false || ::read (file, size) == false)
+    {
+      return false;
+    }
+    shardSize = size;
+
+    return ::read (file, shard.vertices) && ::read (file, shard.vertexKeys) &&
+           ::read (file, shard.indices) && shard.vertexKeys.size () == shard.vertices.size ();
+  }
+}
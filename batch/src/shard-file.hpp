@@ -0,0 +1,21 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BATCH_SHARD_FILE
+#define DILAY_BATCH_SHARD_FILE
+
+#include <string>
+
+struct IsosurfaceExtractionShard;
+
+/* Shards are written in the byte order of the writing machine together with the resolution and
+ * size of their extraction, which must match when shards are stitched.
+ */
+namespace ShardFile
+{
+  bool write (const std::string&, float, unsigned int, const IsosurfaceExtractionShard&);
+  bool read (const std::string&, float&, unsigned int&, IsosurfaceExtractionShard&);
+}
+
+#endif
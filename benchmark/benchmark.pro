@@ -0,0 +1,39 @@
+include (../common.pri)
+
+TEMPLATE        = app
+TARGET          = run-benchmarks
+DESTDIR         = $$OUT_PWD/..
+DEPENDPATH     += src 
+INCLUDEPATH    += src $$PWD/../lib/src
+
+SOURCES += \
+           src/bench-history.cpp \
+           src/bench-import.cpp \
+           src/bench-isosurface.cpp \
+           src/bench-octree.cpp \
+           src/bench-sculpt.cpp \
+           src/benchmark.cpp \
+           src/main.cpp
+
+HEADERS += \
+           src/bench-history.hpp \
+           src/bench-import.hpp \
+           src/bench-isosurface.hpp \
+           src/bench-octree.hpp \
+           src/bench-sculpt.hpp \
+           src/benchmark.hpp
+
+win32:CONFIG(release, debug|release):    LIBS += -L$$OUT_PWD/../lib/release/ -ldilay
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../lib/debug/ -ldilay
+else:unix:                               LIBS += -L$$OUT_PWD/../lib/ -ldilay
+
+win32-g++:CONFIG(release, debug|release):             PRE_TARGETDEPS += $$OUT_PWD/../lib/release/libdilay.a
+else:win32-g++:CONFIG(debug, debug|release):          PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/libdilay.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/dilay.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release):   PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/dilay.lib
+else:unix:                                            PRE_TARGETDEPS += $$OUT_PWD/../lib/libdilay.a
+
+unix {
+  format.commands = clang-format -style=file -i $$SOURCES $$HEADERS
+  QMAKE_EXTRA_TARGETS += format
+}
@@ -0,0 +1,22 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "bench-history.hpp"
+#include "benchmark.hpp"
+#include "history.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  const unsigned int numRepetitions = 10;
+}
+
+void BenchHistory::run (const Config& config, const std::string& name, Scene& scene)
+{
+  History history (config);
+
+  Benchmark::measure ("history-snapshot", name, scene.numFaces (), numRepetitions,
+                      [&history, &scene]() { history.snapshotDynamicMeshes (scene); });
+  history.reset (scene);
+}
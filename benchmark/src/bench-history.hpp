@@ -0,0 +1,18 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCH_HISTORY
+#define DILAY_BENCH_HISTORY
+
+#include <string>
+
+class Config;
+class Scene;
+
+namespace BenchHistory
+{
+  void run (const Config&, const std::string&, Scene&);
+}
+
+#endif
@@ -0,0 +1,22 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "bench-import.hpp"
+#include "benchmark.hpp"
+#include "import-export.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  const unsigned int numRepetitions = 3;
+}
+
+void BenchImport::run (const Config& config, const std::string& name, unsigned int numFaces,
+                       const std::string& fileName)
+{
+  Benchmark::measure ("import-dly", name, numFaces, numRepetitions, [&config, &fileName]() {
+    Scene scene (config);
+    ImportExport::fromDlyFile (fileName, config, scene);
+  });
+}
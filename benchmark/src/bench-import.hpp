@@ -0,0 +1,17 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCH_IMPORT
+#define DILAY_BENCH_IMPORT
+
+#include <string>
+
+class Config;
+
+namespace BenchImport
+{
+  void run (const Config&, const std::string&, unsigned int, const std::string&);
+}
+
+#endif
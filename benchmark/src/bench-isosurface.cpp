@@ -0,0 +1,51 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include "bench-isosurface.hpp"
+#include "benchmark.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+
+namespace
+{
+  const unsigned int numRepetitions = 3;
+  const float        numSamplesPerDimension = 128.0f;
+}
+
+void BenchIsosurface::run (const std::string& scene, const DynamicMesh& mesh)
+{
+  const PrimAABox bounds = mesh.mesh ().bounds ();
+  const float     resolution = bounds.maxDimExtent () / numSamplesPerDimension;
+
+  const IsosurfaceExtraction::DistanceCallback getDistance = [&mesh](const glm::vec3& pos) {
+    return mesh.unsignedDistance (pos);
+  };
+
+  const IsosurfaceExtraction::IntersectionCallback getIntersection =
+    [&mesh](const PrimRay& ray, Intersection& intersection) {
+      if (mesh.intersects (ray, intersection, true))
+      {
+        return IsosurfaceExtraction::Intersection::Sample;
+      }
+      else
+      {
+        return IsosurfaceExtraction::Intersection::None;
+      }
+    };
+
+  Benchmark::measure ("extract", scene, mesh.numFaces (), numRepetitions, [&]() {
+    DynamicMesh extractedMesh;
+    IsosurfaceExtraction::extract (getDistance, getIntersection, bounds, resolution,
+                                   extractedMesh);
+  });
+
+  Benchmark::measure ("extract-distance-only", scene, mesh.numFaces (), numRepetitions, [&]() {
+    DynamicMesh extractedMesh;
+    IsosurfaceExtraction::extract (getDistance, bounds, resolution, extractedMesh);
+  });
+}
@@ -0,0 +1,61 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include "bench-octree.hpp"
+#include "benchmark.hpp"
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+
+namespace
+{
+  const unsigned int numRepetitions = 5;
+  const unsigned int numQueries = 1000;
+}
+
+void BenchOctree::run (const std::string& scene, DynamicMesh& mesh)
+{
+  const PrimAABox bounds = mesh.mesh ().bounds ();
+  const float     distance = 2.0f * bounds.maxDimExtent ();
+  const float     radius = 0.1f * bounds.maxDimExtent ();
+
+  std::vector<PrimRay> rays;
+  for (unsigned int i = 0; i < numQueries; i++)
+  {
+    const glm::vec3 direction = Benchmark::direction (i, numQueries);
+    rays.emplace_back (bounds.center () + (direction * distance), -direction);
+  }
+
+  std::vector<glm::vec3> positions;
+  for (const PrimRay& ray : rays)
+  {
+    DynamicMeshIntersection intersection;
+    if (mesh.intersects (ray, intersection))
+    {
+      positions.push_back (intersection.position ());
+    }
+  }
+
+  Benchmark::measure ("octree-ray", scene, mesh.numFaces (), numRepetitions, [&mesh, &rays]() {
+    for (const PrimRay& ray : rays)
+    {
+      DynamicMeshIntersection intersection;
+      mesh.intersects (ray, intersection);
+    }
+  });
+
+  Benchmark::measure ("octree-sphere", scene, mesh.numFaces (), numRepetitions,
+                      [&mesh, &positions, radius]() {
+                        for (const glm::vec3& position : positions)
+                        {
+                          DynamicFaces faces;
+                          mesh.intersects (PrimSphere (position, radius), faces);
+                        }
+                      });
+}
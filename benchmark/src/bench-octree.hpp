@@ -0,0 +1,17 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCH_OCTREE
+#define DILAY_BENCH_OCTREE
+
+#include <string>
+
+class DynamicMesh;
+
+namespace BenchOctree
+{
+  void run (const std::string&, DynamicMesh&);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "bench-sculpt.hpp"
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "scene.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/arena.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/recording.hpp"
+
+namespace
+{
+  const unsigned int numRepetitions = 5;
+  const unsigned int numSteps = 32;
+
+  // a stroke along a circle around the mesh's center
+  void stroke (SculptBrush& brush, ToolSculptArena& arena, DynamicMesh& mesh, unsigned int stroke)
+  {
+    const PrimAABox bounds = mesh.mesh ().bounds ();
+    const float     distance = 2.0f * bounds.maxDimExtent ();
+    const float     height = -0.5f + (float(stroke) / float(numRepetitions));
+
+    for (unsigned int i = 0; i < numSteps; i++)
+    {
+      const float     angle = 2.0f * glm::pi<float> () * float(i) / float(numSteps);
+      const glm::vec3 direction =
+        glm::normalize (glm::vec3 (glm::cos (angle), glm::sin (angle), height));
+
+      DynamicMeshIntersection intersection;
+      if (mesh.intersects (PrimRay (bounds.center () + (direction * distance), -direction),
+                           intersection))
+      {
+        brush.setPointOfAction (mesh, intersection.position (), intersection.normal ());
+        ToolSculptAction::sculpt (brush, arena);
+      }
+    }
+    brush.resetPointOfAction ();
+    arena.reset ();
+  }
+
+  template <typename T>
+  void measure (const Config& config, const std::string& name, const std::string& scene,
+                const DynamicMesh& original, const std::function<void(T&)>& setupParameters)
+  {
+    DynamicMesh     mesh (original);
+    SculptBrush     brush;
+    ToolSculptArena arena;
+
+    brush.radius (0.1f * mesh.mesh ().bounds ().maxDimExtent ());
+    brush.detailFactor (config.get<float> ("editor/tool/sculpt/detail-factor"));
+    brush.stepWidthFactor (config.get<float> ("editor/tool/sculpt/step-width-factor"));
+    brush.subdivide (true);
+    setupParameters (brush.initParameters<T> ());
+
+    unsigned int i = 0;
+    Benchmark::measure (name, scene, original.numFaces (), numRepetitions,
+                        [&brush, &arena, &mesh, &i]() { stroke (brush, arena, mesh, i++); });
+  }
+
+  // each repetition is a single dab of synthetic strokes
+  void measureSynthetic (const Config& config, const std::string& name, const std::string& scene,
+                         const DynamicMesh& original, const SculptRecording::Workload& workload)
+  {
+    Scene              sculptScene (config);
+    SculptRecording    recording;
+    std::vector<float> milliseconds;
+
+    sculptScene.newDynamicMesh (config, original);
+
+    if (recording.generate (sculptScene, 0, workload) &&
+        recording.replay (sculptScene, [&milliseconds](unsigned int, float duration) {
+          milliseconds.push_back (duration * 1000.0f);
+        }))
+    {
+      Benchmark::record (name, scene, original.numFaces (), std::move (milliseconds));
+    }
+  }
+}
+
+void BenchSculpt::run (const Config& config, const std::string& scene, const DynamicMesh& mesh)
+{
+  measure<SBDrawParameters> (config, "sculpt-draw", scene, mesh,
+                             [](SBDrawParameters& params) { params.intensity (0.5f); });
+  measure<SBSmoothParameters> (config, "sculpt-smooth", scene, mesh,
+                               [](SBSmoothParameters& params) { params.intensity (0.5f); });
+  measure<SBFlattenParameters> (config, "sculpt-flatten", scene, mesh,
+                                [](SBFlattenParameters& params) { params.intensity (0.5f); });
+
+  const std::vector<std::string> brushes = {"draw",   "crease",  "grab",  "pinch",
+                                            "smooth", "flatten", "reduce"};
+  const std::vector<std::string> paths = {"random-walk", "spiral", "drag"};
+
+  for (const std::string& brush : brushes)
+  {
+    for (const std::string& path : paths)
+    {
+      SculptRecording::Workload workload;
+
+      workload.brush = brush;
+      workload.detailFactor = config.get<float> ("editor/tool/sculpt/detail-factor");
+      workload.stepWidthFactor = config.get<float> ("editor/tool/sculpt/step-width-factor");
+      SculptRecording::parsePath (path, workload.path);
+
+      measureSynthetic (config, "synthetic-" + brush + "-" + path, scene, mesh, workload);
+    }
+  }
+}
@@ -0,0 +1,125 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+#include "benchmark.hpp"
+#include "parallel.hpp"
+
+namespace
+{
+  struct Result
+  {
+    std::string        name;
+    std::string        scene;
+    unsigned int       numFaces;
+    std::vector<float> milliseconds;
+  };
+
+  std::vector<Result> results;
+
+  void writeString (std::ostream& stream, const std::string& string)
+  {
+    stream << '"';
+    for (const char c : string)
+    {
+      if (c == '"' || c == '\\')
+      {
+        stream << '\\';
+      }
+      stream << c;
+    }
+    stream << '"';
+  }
+}
+
+namespace Benchmark
+{
+  void measure (const std::string& name, const std::string& scene, unsigned int numFaces,
+                unsigned int numRepetitions, const std::function<void()>& f)
+  {
+    typedef std::chrono::steady_clock Clock;
+
+    Result result{name, scene, numFaces, {}};
+
+    for (unsigned int i = 0; i < numRepetitions; i++)
+    {
+      const Clock::time_point start = Clock::now ();
+      f ();
+      const Clock::time_point end = Clock::now ();
+
+      result.milliseconds.push_back (
+        std::chrono::duration<float, std::milli> (end - start).count ());
+    }
+    results.push_back (std::move (result));
+  }
+
+  void record (const std::string& name, const std::string& scene, unsigned int numFaces,
+               std::vector<float>&& milliseconds)
+  {
+    results.push_back (Result{name, scene, numFaces, std::move (milliseconds)});
+  }
+
+  void reset () { results.clear (); }
+
+  glm::vec3 direction (unsigned int i, unsigned int n)
+  {
+    assert (i < n);
+
+    const float goldenAngle = glm::pi<float> () * (3.0f - glm::sqrt (5.0f));
+    const float z = 1.0f - ((2.0f * (float(i) + 0.5f)) / float(n));
+    const float r = glm::sqrt (1.0f - (z * z));
+
+    return glm::vec3 (r * glm::cos (goldenAngle * float(i)), r * glm::sin (goldenAngle * float(i)),
+                      z);
+  }
+
+  void toJson (std::ostream& stream)
+  {
+    stream << "{\n";
+    stream << "  \"version\": ";
+    writeString (stream, DILAY_VERSION);
+    stream << ",\n";
+    stream << "  \"threads\": " << Parallel::numThreads () << ",\n";
+    stream << "  \"results\": [";
+
+    for (unsigned int i = 0; i < results.size (); i++)
+    {
+      const Result&      r = results[i];
+      std::vector<float> sorted = r.milliseconds;
+      std::sort (sorted.begin (), sorted.end ());
+
+      float sum = 0.0f;
+      for (float ms : sorted)
+      {
+        sum += ms;
+      }
+
+      stream << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+      writeString (stream, r.name);
+      stream << ", \"scene\": ";
+      writeString (stream, r.scene);
+      stream << ", \"faces\": " << r.numFaces << ", \"repetitions\": " << sorted.size ();
+
+      if (sorted.empty () == false)
+      {
+        stream << std::fixed << std::setprecision (3) << ", \"min-ms\": " << sorted.front ()
+               << ", \"median-ms\": " << sorted[sorted.size () / 2]
+               << ", \"p99-ms\": " << sorted[(sorted.size () * 99) / 100]
+               << ", \"mean-ms\": " << (sum / float(sorted.size ()))
+               << ", \"max-ms\": " << sorted.back ()
+               << ", \"per-second\": " << (1000.0f * float(sorted.size ()) / glm::max (sum, 1e-6f))
+               << std::defaultfloat;
+      }
+      stream << "}";
+    }
+    stream << "\n  ]\n}\n";
+  }
+}
@@ -0,0 +1,27 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BENCHMARK
+#define DILAY_BENCHMARK
+
+#include <functional>
+#include <glm/fwd.hpp>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Benchmark
+{
+  // runs `f` repeatedly and records the wall-clock time of each repetition
+  void measure (const std::string&, const std::string&, unsigned int, unsigned int,
+                const std::function<void()>&);
+  // records the times of repetitions that have been measured elsewhere (e.g., of single dabs)
+  void record (const std::string&, const std::string&, unsigned int, std::vector<float>&&);
+  void reset ();
+  // the i-th of n evenly distributed directions
+  glm::vec3 direction (unsigned int, unsigned int);
+  void toJson (std::ostream&);
+}
+
+#endif
@@ -0,0 +1,219 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QTemporaryDir>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench-history.hpp"
+#include "bench-import.hpp"
+#include "bench-isosurface.hpp"
+#include "bench-octree.hpp"
+#include "bench-sculpt.hpp"
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "parallel.hpp"
+#include "scene.hpp"
+
+namespace
+{
+  struct SceneFile
+  {
+    std::string name;
+    std::string fileName;
+  };
+
+  void usage ()
+  {
+    std::cerr << "usage: run-benchmarks [--quick] [--threads N] [--output FILE] [FILE.dly ...]\n"
+              << "  without files, icosphere scenes of about 100k, 1M and 5M faces are used\n";
+  }
+
+  // returns false if the argument is not a non-negative number
+  bool parseNumThreads (const std::string& arg, unsigned int& numThreads)
+  {
+    try
+    {
+      std::size_t end;
+      const int   n = std::stoi (arg, &end);
+      const bool  isValid = end == arg.size () && n >= 0;
+
+      if (isValid)
+      {
+        numThreads = (unsigned int) n;
+      }
+      return isValid;
+    }
+    catch (const std::invalid_argument&)
+    {
+      return false;
+    }
+    catch (const std::out_of_range&)
+    {
+      return false;
+    }
+  }
+
+  std::string baseName (const std::string& fileName)
+  {
+    const std::size_t slash = fileName.find_last_of ("/\\");
+    return slash == std::string::npos ? fileName : fileName.substr (slash + 1);
+  }
+
+  bool generateScene (const Config& config, unsigned int numSubdivisions, const QTemporaryDir& dir,
+                      SceneFile& sceneFile)
+  {
+    Scene scene (config);
+    scene.newDynamicMesh (config, MeshUtil::icosphere (numSubdivisions));
+
+    sceneFile.name = "icosphere-" + std::to_string (scene.numFaces ());
+    sceneFile.fileName =
+      dir.filePath (QString::fromStdString (sceneFile.name + ".dly")).toStdString ();
+
+    return ImportExport::toDlyFile (sceneFile.fileName, scene, false);
+  }
+
+  void runScene (const Config& config, const SceneFile& sceneFile)
+  {
+    Scene scene (config);
+
+    if (scene.fromDlyFile (config, sceneFile.fileName) == false)
+    {
+      std::cerr << "could not load " << sceneFile.fileName << "\n";
+      return;
+    }
+    std::cerr << "running benchmarks on " << sceneFile.name << " (" << scene.numFaces ()
+              << " faces)\n";
+
+    BenchImport::run (config, sceneFile.name, scene.numFaces (), sceneFile.fileName);
+    BenchHistory::run (config, sceneFile.name, scene);
+
+    DynamicMesh* mesh = nullptr;
+    scene.forEachMesh ([&mesh](DynamicMesh& m) {
+      if (mesh == nullptr)
+      {
+        mesh = &m;
+      }
+    });
+
+    if (mesh)
+    {
+      BenchOctree::run (sceneFile.name, *mesh);
+      BenchIsosurface::run (sceneFile.name, *mesh);
+      BenchSculpt::run (config, sceneFile.name, *mesh);
+    }
+  }
+}
+
+int main (int argc, char** argv)
+{
+  QCoreApplication::setApplicationName ("dilay");
+
+  QGuiApplication app (argc, argv);
+  Config          config;
+  bool            quick = false;
+  unsigned int    numThreads = 0;
+  std::string     output;
+
+  std::vector<SceneFile> sceneFiles;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg (argv[i]);
+
+    if (arg == "--quick")
+    {
+      quick = true;
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+    {
+      if (parseNumThreads (argv[++i], numThreads) == false)
+      {
+        usage ();
+        return 1;
+      }
+    }
+    else if (arg == "--output" && i + 1 < argc)
+    {
+      output = argv[++i];
+    }
+    else if (arg.empty () == false && arg[0] != '-')
+    {
+      sceneFiles.push_back (SceneFile{baseName (arg), arg});
+    }
+    else
+    {
+      usage ();
+      return 1;
+    }
+  }
+  Parallel::initialize (numThreads);
+
+  // benchmarks act on constructed meshes and measure their construction when importing
+  config.set ("editor/mesh/deferred-num-faces", 0);
+
+  OpenGL::setDefaultFormat (config.get<bool> ("editor/prefer-core-profile"));
+
+  QOffscreenSurface surface;
+  surface.create ();
+
+  QOpenGLContext context;
+  if (context.create () == false || context.makeCurrent (&surface) == false)
+  {
+    std::cerr << "could not create OpenGL context\n";
+    return 1;
+  }
+  OpenGL::initializeFunctions (false);
+
+  QTemporaryDir dir;
+  if (sceneFiles.empty ())
+  {
+    const std::vector<unsigned int> numSubdivisions =
+      quick ? std::vector<unsigned int>{6} : std::vector<unsigned int>{6, 8, 9};
+
+    for (unsigned int n : numSubdivisions)
+    {
+      SceneFile sceneFile;
+      if (dir.isValid () == false || generateScene (config, n, dir, sceneFile) == false)
+      {
+        std::cerr << "could not generate reference scenes\n";
+        return 1;
+      }
+      sceneFiles.push_back (sceneFile);
+    }
+  }
+
+  for (const SceneFile& sceneFile : sceneFiles)
+  {
+    runScene (config, sceneFile);
+  }
+
+  if (output.empty ())
+  {
+    Benchmark::toJson (std::cout);
+  }
+  else
+  {
+    std::ofstream file (output);
+    Benchmark::toJson (file);
+
+    if (file.fail ())
+    {
+      std::cerr << "could not write " << output << "\n";
+      return 1;
+    }
+  }
+  context.doneCurrent ();
+  return 0;
+}
@@ -4,11 +4,12 @@ QT                     += widgets opengl openglextensions xml
 MOC_DIR                 = moc
 OBJECTS_DIR             = obj
 QMAKE_CXXFLAGS         += -DDILAY_VERSION=\\\"$$VERSION\\\" -DGLM_FORCE_RADIANS -DGLM_ENABLE_EXPERIMENTAL
-QMAKE_CXXFLAGS_RELEASE += -DNDEBUG
+QMAKE_CXXFLAGS_RELEASE += -DNDEBUG # -DDILAY_ENABLE_PROFILER -DDILAY_ENABLE_ALLOCATION_TRACKING -DDILAY_LOG_LEVEL=1
 QMAKE_CXXFLAGS_DEBUG   += -Wall # -pg # -DDILAY_RENDER_OCTREE
 QMAKE_LFLAGS_DEBUG     += # -pg
 
 win32:INCLUDEPATH      += $$PWD/glm/
+win32:LIBS             += -lpsapi
 
 unix {
   isEmpty (PREFIX) {
@@ -1,9 +1,11 @@
 CONFIG      += debug_and_release
 TEMPLATE     = subdirs
-SUBDIRS      = lib app test
+SUBDIRS      = lib app test benchmark batch
 
-app.depends  = lib
-test.depends = lib
+app.depends       = lib
+test.depends      = lib
+benchmark.depends = lib
+batch.depends     = lib
 
 disable-test {
   SUBDIRS -= test
@@ -13,6 +15,14 @@ disable-app {
   SUBDIRS -= app
 }
 
+disable-benchmark {
+  SUBDIRS -= benchmark
+}
+
+disable-batch {
+  SUBDIRS -= batch
+}
+
 unix {
   gdb.commands = gdb -ex run ./dilay_debug
   valgrind.commands = valgrind ./dilay_debug &> valgrind.log
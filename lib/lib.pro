@@ -7,36 +7,53 @@ INCLUDEPATH += src
 CONFIG      += staticlib
 
 SOURCES += \
+           src/bvh.cpp \
            src/camera.cpp \
            src/color.cpp \
            src/config.cpp \
            src/configurable.cpp \
            src/dimension.cpp \
            src/distance.cpp \
+           src/dynamic/distance-cache.cpp \
            src/dynamic/faces.cpp \
+           src/dynamic/lod-proxy.cpp \
            src/dynamic/mesh.cpp \
+           src/dynamic/mesh-changes.cpp \
            src/dynamic/mesh-intersection.cpp \
+           src/dynamic/mesh-layers.cpp \
            src/dynamic/octree.cpp \
+           src/dynamic/visited.cpp \
+           src/frame-queue.cpp \
            src/history.cpp \
+           src/idle-tasks.cpp \
            src/import-export.cpp \
            src/intersection.cpp \
            src/isosurface-extraction.cpp \
+           src/isosurface-extraction/csg.cpp \
            src/isosurface-extraction/grid.cpp \
+           src/journal.cpp \
            src/kvstore.cpp \
            src/log.cpp \
+           src/memory-governor.cpp \
            src/mesh.cpp \
+           src/mesh-instances.cpp \
            src/mesh-util.cpp \
            src/mirror.cpp \
            src/opengl.cpp \
            src/opengl-buffer-id.cpp \
+           src/opengl-vertex-array-id.cpp \
+           src/parallel.cpp \
            src/primitive/aabox.cpp \
            src/primitive/cone.cpp \
            src/primitive/cone-sphere.cpp \
+           src/primitive/cone-sphere-block.cpp \
            src/primitive/cylinder.cpp \
            src/primitive/plane.cpp \
            src/primitive/ray.cpp \
            src/primitive/sphere.cpp \
            src/primitive/triangle.cpp \
+           src/primitive/triangle-block.cpp \
+           src/profile.cpp \
            src/render-mode.cpp \
            src/renderer.cpp \
            src/scene.cpp \
@@ -47,27 +64,38 @@ SOURCES += \
            src/sketch/node-intersection.cpp \
            src/sketch/path.cpp \
            src/sketch/path-intersection.cpp \
+           src/sketch/primitives.cpp \
            src/state.cpp \
-           src/time-delta.cpp \
            src/tool.cpp \
            src/tool/convert-sketch.cpp \
+           src/tool/convert-sketch/action.cpp \
+           src/tool/convert-sketch/cache.cpp \
+           src/tool/decimate-mesh.cpp \
            src/tool/delete-mesh.cpp \
            src/tool/delete-sketch.cpp \
            src/tool/edit-sketch.cpp \
            src/tool/move-camera.cpp \
            src/tool/new-mesh.cpp \
            src/tool/remesh.cpp \
+           src/tool/remesh/action.cpp \
            src/tool/sculpt.cpp \
            src/tool/sculpt/draw.cpp \
            src/tool/sculpt/crease.cpp \
            src/tool/sculpt/flatten.cpp \
+           src/tool/sculpt/freeze.cpp \
            src/tool/sculpt/grab.cpp \
            src/tool/sculpt/pinch.cpp \
            src/tool/sculpt/reduce.cpp \
            src/tool/sculpt/smooth.cpp \
            src/tool/sculpt/util/action.cpp \
+           src/tool/sculpt/util/arena.cpp \
            src/tool/sculpt/util/brush.cpp \
            src/tool/sculpt/util/edge-collection.cpp \
+           src/tool/sculpt/util/governor.cpp \
+           src/tool/sculpt/util/laplacian.cpp \
+           src/tool/sculpt/util/level.cpp \
+           src/tool/sculpt/util/recording.cpp \
+           src/tool/sculpt/util/reference.cpp \
            src/tool/sketch-spheres.cpp \
            src/tool/transform-mesh.cpp \
            src/tool/trim-mesh.cpp \
@@ -75,11 +103,13 @@ SOURCES += \
            src/tool/trim-mesh/border.cpp \
            src/tool/trim-mesh/split-mesh.cpp \
            src/tool/util/movement.cpp \
+           src/tool/util/prediction.cpp \
            src/tool/util/rotation.cpp \
            src/tool/util/scaling.cpp \
            src/tool/util/step.cpp \
            src/util.cpp \
            src/view/axis.cpp \
+           src/view/background-save.cpp \
            src/view/color-button.cpp \
            src/view/configuration.cpp \
            src/view/context-menu.cpp \
@@ -95,9 +125,13 @@ SOURCES += \
            src/view/log.cpp \
            src/view/main-window.cpp \
            src/view/menu-bar.cpp \
+           src/view/performance-overlay.cpp \
+           src/view/picking.cpp \
            src/view/pointing-event.cpp \
+           src/view/preview.cpp \
            src/view/resolution-slider.cpp \
            src/view/shortcut.cpp \
+           src/view/side-view.cpp \
            src/view/tool-pane.cpp \
            src/view/tool-tip.cpp \
            src/view/two-column-grid.cpp \
@@ -107,40 +141,60 @@ SOURCES += \
 
 HEADERS += \
            src/bitset.hpp \
+           src/bvh.hpp \
            src/cache.hpp \
            src/camera.hpp \
            src/color.hpp \
            src/config.hpp \
            src/configurable.hpp \
+           src/copy-on-write.hpp \
            src/dimension.hpp \
            src/distance.hpp \
+           src/dynamic/distance-cache.hpp \
            src/dynamic/faces.hpp \
+           src/dynamic/lod-proxy.hpp \
            src/dynamic/mesh.hpp \
+           src/dynamic/mesh-changes.hpp \
            src/dynamic/mesh-intersection.hpp \
+           src/dynamic/mesh-layers.hpp \
+           src/dynamic/mesh-snapshot.hpp \
            src/dynamic/octree.hpp \
+           src/dynamic/visited.hpp \
+           src/frame-queue.hpp \
            src/hash.hpp \
            src/history.hpp \
+           src/idle-tasks.hpp \
            src/import-export.hpp \
            src/intersection.hpp \
            src/isosurface-extraction.hpp \
+           src/isosurface-extraction/csg.hpp \
            src/isosurface-extraction/grid.hpp \
+           src/isosurface-extraction/shard.hpp \
+           src/journal.hpp \
            src/kvstore.hpp \
            src/log.hpp \
            src/macro.hpp \
            src/maybe.hpp \
+           src/memory-governor.hpp \
            src/mesh.hpp \
+           src/mesh-instances.hpp \
            src/mesh-util.hpp \
            src/mirror.hpp \
            src/opengl.hpp \
            src/opengl-buffer-id.hpp \
+           src/opengl-vertex-array-id.hpp \
+           src/parallel.hpp \
            src/primitive/aabox.hpp \
            src/primitive/cone.hpp \
            src/primitive/cone-sphere.hpp \
+           src/primitive/cone-sphere-block.hpp \
            src/primitive/cylinder.hpp \
            src/primitive/plane.hpp \
            src/primitive/ray.hpp \
            src/primitive/sphere.hpp \
            src/primitive/triangle.hpp \
+           src/primitive/triangle-block.hpp \
+           src/profile.hpp \
            src/render-mode.hpp \
            src/renderer.hpp \
            src/scene.hpp \
@@ -152,19 +206,29 @@ HEADERS += \
            src/sketch/node-intersection.hpp \
            src/sketch/path.hpp \
            src/sketch/path-intersection.hpp \
+           src/sketch/primitives.hpp \
            src/state.hpp \
-           src/time-delta.hpp \
            src/tool.hpp \
+           src/tool/convert-sketch/action.hpp \
+           src/tool/convert-sketch/cache.hpp \
            src/tool/key.hpp \
            src/tool/move-camera.hpp \
+           src/tool/remesh/action.hpp \
            src/tool/sculpt.hpp \
            src/tool/sculpt/util/action.hpp \
+           src/tool/sculpt/util/arena.hpp \
            src/tool/sculpt/util/brush.hpp \
            src/tool/sculpt/util/edge-collection.hpp \
+           src/tool/sculpt/util/governor.hpp \
+           src/tool/sculpt/util/laplacian.hpp \
+           src/tool/sculpt/util/level.hpp \
+           src/tool/sculpt/util/recording.hpp \
+           src/tool/sculpt/util/reference.hpp \
            src/tool/trim-mesh/action.hpp \
            src/tool/trim-mesh/border.hpp \
            src/tool/trim-mesh/split-mesh.hpp \
            src/tool/util/movement.hpp \
+           src/tool/util/prediction.hpp \
            src/tool/util/rotation.hpp \
            src/tool/util/scaling.hpp \
            src/tool/util/step.hpp \
@@ -173,6 +237,7 @@ HEADERS += \
            src/util.hpp \
            src/variant.hpp \
            src/view/axis.hpp \
+           src/view/background-save.hpp \
            src/view/color-button.hpp \
            src/view/configuration.hpp \
            src/view/context-menu.hpp \
@@ -188,9 +253,13 @@ HEADERS += \
            src/view/log.hpp \
            src/view/main-window.hpp \
            src/view/menu-bar.hpp \
+           src/view/performance-overlay.hpp \
+           src/view/picking.hpp \
            src/view/pointing-event.hpp \
+           src/view/preview.hpp \
            src/view/resolution-slider.hpp \
            src/view/shortcut.hpp \
+           src/view/side-view.hpp \
            src/view/tool-pane.hpp \
            src/view/tool-tip.hpp \
            src/view/two-column-grid.hpp \
@@ -0,0 +1,585 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <vector>
+#include "bvh.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numBins = 16;
+  constexpr unsigned int maxLeafElements = 4;
+  constexpr unsigned int minParallelElements = 1 << 14;
+
+  struct Box
+  {
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    Box ()
+      : minimum (Util::maxFloat ())
+      , maximum (Util::minFloat ())
+    {
+    }
+
+    void extend (const glm::vec3& p)
+    {
+      this->minimum = glm::min (this->minimum, p);
+      this->maximum = glm::max (this->maximum, p);
+    }
+
+    void extend (const Box& b)
+    {
+      this->minimum = glm::min (this->minimum, b.minimum);
+      this->maximum = glm::max (this->maximum, b.maximum);
+    }
+
+    bool isEmpty () const { return glm::any (glm::greaterThan (this->minimum, this->maximum)); }
+
+    float distance (const glm::vec3& p) const
+    {
+      return glm::length (glm::max (glm::max (this->minimum - p, p - this->maximum), 0.0f));
+    }
+
+    float halfArea () const
+    {
+      if (this->isEmpty ())
+      {
+        return 0.0f;
+      }
+      else
+      {
+        const glm::vec3 d = this->maximum - this->minimum;
+        return (d.x * d.y) + (d.y * d.z) + (d.z * d.x);
+      }
+    }
+  };
+
+  Box toBox (const PrimAABox& box)
+  {
+    Box b;
+    b.minimum = box.minimum ();
+    b.maximum = box.maximum ();
+    return b;
+  }
+
+  // inner nodes store their children at `offset` and `offset + 1`
+  struct Node
+  {
+    Box          box;
+    unsigned int offset;
+    unsigned int numElements;
+
+    bool isLeaf () const { return this->numElements > 0; }
+  };
+
+  struct Bin
+  {
+    Box          box;
+    unsigned int numElements;
+
+    Bin ()
+      : numElements (0)
+    {
+    }
+  };
+}
+
+struct Bvh::Impl
+{
+  std::vector<Node>         nodes;
+  std::vector<unsigned int> elements;
+  std::vector<unsigned int> parents;
+  std::vector<unsigned int> leaves;
+
+  unsigned int numElements () const { return this->elements.size (); }
+
+  std::size_t numBytes () const
+  {
+    return (this->nodes.capacity () * sizeof (Node)) +
+           ((this->elements.capacity () + this->parents.capacity () + this->leaves.capacity ()) *
+            sizeof (unsigned int));
+  }
+
+  void build (unsigned int n, const Bvh::BoundsCallback& getBounds)
+  {
+    this->reset ();
+
+    if (n > 0)
+    {
+      std::vector<Box>       boxes (n);
+      std::vector<glm::vec3> centers (n);
+
+      this->elements.resize (n);
+      Parallel::forEach (n, [this, &getBounds, &boxes, &centers](unsigned int i) {
+        const PrimAABox bounds = getBounds (i);
+
+        boxes[i] = toBox (bounds);
+        centers[i] = bounds.center ();
+        this->elements[i] = i;
+      });
+
+      unsigned int parallelDepth = 1;
+      while ((1u << parallelDepth) < Parallel::numThreads ())
+      {
+        parallelDepth++;
+      }
+      this->buildTree (this->nodes, 0, n, boxes, centers, parallelDepth);
+    }
+  }
+
+  /* Builds the subtree of the elements `begin .. end-1` into `treeNodes`, starting with its root.
+   * Subtrees of the top levels are built in parallel and then appended to their parent.
+   */
+  void buildTree (std::vector<Node>& treeNodes, unsigned int begin, unsigned int end,
+                  const std::vector<Box>& boxes, const std::vector<glm::vec3>& centers,
+                  unsigned int parallelDepth)
+  {
+    assert (treeNodes.empty ());
+    treeNodes.emplace_back ();
+
+    if (parallelDepth == 0 || end - begin < minParallelElements)
+    {
+      treeNodes.reserve (2 * (end - begin));
+      this->buildNode (treeNodes, 0, begin, end, boxes, centers);
+      return;
+    }
+
+    Box                box, centerBox;
+    const unsigned int split = this->findSplit (begin, end, box, centerBox, boxes, centers);
+
+    treeNodes[0].box = box;
+
+    if (split == begin)
+    {
+      treeNodes[0].offset = begin;
+      treeNodes[0].numElements = end - begin;
+    }
+    else
+    {
+      std::vector<Node> left, right;
+      ParallelTaskGroup group;
+
+      group.add ([this, &left, begin, split, &boxes, &centers, parallelDepth]() {
+        this->buildTree (left, begin, split, boxes, centers, parallelDepth - 1);
+      });
+      this->buildTree (right, split, end, boxes, centers, parallelDepth - 1);
+      group.wait ();
+
+      const auto append = [&treeNodes](const std::vector<Node>& subtree, unsigned int begin,
+                                       unsigned int end, unsigned int shift) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+          treeNodes.push_back (subtree[i]);
+          if (treeNodes.back ().isLeaf () == false)
+          {
+            treeNodes.back ().offset += shift;
+          }
+        }
+      };
+
+      // the roots of both subtrees are followed by the remaining nodes of the left subtree
+      treeNodes.reserve (left.size () + right.size () + 1);
+      treeNodes[0].offset = 1;
+      treeNodes[0].numElements = 0;
+
+      append (left, 0, 1, 2);
+      append (right, 0, 1, left.size () + 1);
+      append (left, 1, left.size (), 2);
+      append (right, 1, right.size (), left.size () + 1);
+    }
+  }
+
+  void buildNode (std::vector<Node>& treeNodes, unsigned int nodeIndex, unsigned int begin,
+                  unsigned int end, const std::vector<Box>& boxes,
+                  const std::vector<glm::vec3>& centers)
+  {
+    Box                box, centerBox;
+    const unsigned int split = this->findSplit (begin, end, box, centerBox, boxes, centers);
+
+    treeNodes[nodeIndex].box = box;
+
+    if (split == begin)
+    {
+      treeNodes[nodeIndex].offset = begin;
+      treeNodes[nodeIndex].numElements = end - begin;
+    }
+    else
+    {
+      const unsigned int offset = treeNodes.size ();
+
+      treeNodes[nodeIndex].offset = offset;
+      treeNodes[nodeIndex].numElements = 0;
+      treeNodes.emplace_back ();
+      treeNodes.emplace_back ();
+
+      this->buildNode (treeNodes, offset, begin, split, boxes, centers);
+      this->buildNode (treeNodes, offset + 1, split, end, boxes, centers);
+    }
+  }
+
+  /* Computes the box of the elements and partitions them along the longest axis of their
+   * centers.  Returns the index of the first element of the second partition, or `begin` if a
+   * leaf is cheaper.
+   */
+  unsigned int findSplit (unsigned int begin, unsigned int end, Box& box, Box& centerBox,
+                          const std::vector<Box>& boxes, const std::vector<glm::vec3>& centers)
+  {
+    const unsigned int n = end - begin;
+
+    for (unsigned int i = begin; i < end; i++)
+    {
+      box.extend (boxes[this->elements[i]]);
+      centerBox.extend (centers[this->elements[i]]);
+    }
+
+    if (n <= 1)
+    {
+      return begin;
+    }
+
+    const glm::vec3 extent = centerBox.maximum - centerBox.minimum;
+    const int       axis = extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2)
+                                                : (extent.y >= extent.z ? 1 : 2);
+
+    if (extent[axis] <= 0.0f)
+    {
+      return n <= maxLeafElements ? begin : begin + (n / 2);
+    }
+
+    const float scale = float(numBins) / extent[axis];
+    const auto  binIndex = [&centerBox, &centers, axis, scale](unsigned int e) {
+      const float b = (centers[e][axis] - centerBox.minimum[axis]) * scale;
+      return glm::min (numBins - 1, (unsigned int) (b));
+    };
+
+    std::array<Bin, numBins> bins;
+    for (unsigned int i = begin; i < end; i++)
+    {
+      Bin& bin = bins[binIndex (this->elements[i])];
+      bin.box.extend (boxes[this->elements[i]]);
+      bin.numElements++;
+    }
+
+    std::array<float, numBins - 1> rightCosts;
+    Box                            rightBox;
+    unsigned int                   numRight = 0;
+
+    for (unsigned int i = numBins - 1; i > 0; i--)
+    {
+      rightBox.extend (bins[i].box);
+      numRight += bins[i].numElements;
+      rightCosts[i - 1] = rightBox.halfArea () * float(numRight);
+    }
+
+    Box          leftBox;
+    unsigned int numLeft = 0;
+    unsigned int bestBin = 0;
+    float        bestCost = Util::maxFloat ();
+
+    for (unsigned int i = 0; i < numBins - 1; i++)
+    {
+      leftBox.extend (bins[i].box);
+      numLeft += bins[i].numElements;
+
+      const float cost = (leftBox.halfArea () * float(numLeft)) + rightCosts[i];
+      if (numLeft > 0 && numLeft < n && cost < bestCost)
+      {
+        bestCost = cost;
+        bestBin = i;
+      }
+    }
+
+    // traversing a node costs about as much as intersecting an element
+    if (n <= maxLeafElements && bestCost >= (float(n) - 1.0f) * box.halfArea ())
+    {
+      return begin;
+    }
+
+    const auto middle =
+      std::partition (this->elements.begin () + begin, this->elements.begin () + end,
+                      [&binIndex, bestBin](unsigned int e) { return binIndex (e) <= bestBin; });
+
+    return middle - this->elements.begin ();
+  }
+
+  // children are stored after their parents
+  void refit (const Bvh::BoundsCallback& getBounds)
+  {
+    std::vector<Box> boxes (this->numElements ());
+
+    Parallel::forEach (boxes.size (), [&getBounds, &boxes](unsigned int i) {
+      boxes[i] = toBox (getBounds (i));
+    });
+    Parallel::forEach (this->nodes.size (), [this, &boxes](unsigned int i) {
+      Node& node = this->nodes[i];
+
+      if (node.isLeaf ())
+      {
+        node.box = Box ();
+        for (unsigned int j = node.offset; j < node.offset + node.numElements; j++)
+        {
+          node.box.extend (boxes[this->elements[j]]);
+        }
+      }
+    });
+    for (unsigned int i = this->nodes.size (); i > 0; i--)
+    {
+      Node& node = this->nodes[i - 1];
+
+      if (node.isLeaf () == false)
+      {
+        node.box = this->nodes[node.offset].box;
+        node.box.extend (this->nodes[node.offset + 1].box);
+      }
+    }
+  }
+
+  // the parents of nodes and the leaves of elements are only needed by partial refits
+  void computeParents ()
+  {
+    if (this->parents.size () != this->nodes.size ())
+    {
+      this->parents.assign (this->nodes.size (), Util::invalidIndex ());
+      this->leaves.assign (this->numElements (), Util::invalidIndex ());
+
+      for (unsigned int i = 0; i < this->nodes.size (); i++)
+      {
+        const Node& node = this->nodes[i];
+
+        if (node.isLeaf ())
+        {
+          for (unsigned int j = node.offset; j < node.offset + node.numElements; j++)
+          {
+            this->leaves[this->elements[j]] = i;
+          }
+        }
+        else
+        {
+          this->parents[node.offset] = i;
+          this->parents[node.offset + 1] = i;
+        }
+      }
+    }
+  }
+
+  void refit (const std::vector<unsigned int>& changed, const Bvh::BoundsCallback& getBounds)
+  {
+    std::vector<unsigned int> dirty;
+
+    this->computeParents ();
+
+    dirty.reserve (changed.size ());
+    for (unsigned int e : changed)
+    {
+      assert (e < this->leaves.size ());
+      dirty.push_back (this->leaves[e]);
+    }
+    std::sort (dirty.begin (), dirty.end ());
+    dirty.erase (std::unique (dirty.begin (), dirty.end ()), dirty.end ());
+
+    Parallel::forEach (dirty.size (), [this, &getBounds, &dirty](unsigned int i) {
+      Node& node = this->nodes[dirty[i]];
+
+      node.box = Box ();
+      for (unsigned int j = node.offset; j < node.offset + node.numElements; j++)
+      {
+        node.box.extend (toBox (getBounds (this->elements[j])));
+      }
+    });
+
+    // children are stored after their parents, hence ancestors are refit in descending order
+    std::vector<unsigned int> ancestors;
+    for (unsigned int n : dirty)
+    {
+      for (unsigned int p = this->parents[n]; p != Util::invalidIndex (); p = this->parents[p])
+      {
+        ancestors.push_back (p);
+      }
+    }
+    std::sort (ancestors.begin (), ancestors.end (), std::greater<unsigned int> ());
+    ancestors.erase (std::unique (ancestors.begin (), ancestors.end ()), ancestors.end ());
+
+    for (unsigned int n : ancestors)
+    {
+      Node& node = this->nodes[n];
+
+      node.box = this->nodes[node.offset].box;
+      node.box.extend (this->nodes[node.offset + 1].box);
+    }
+  }
+
+  void reset ()
+  {
+    this->nodes.clear ();
+    this->elements.clear ();
+    this->parents.clear ();
+    this->leaves.clear ();
+  }
+
+  void intersects (const PrimRay& ray, const Bvh::RayIntersectionCallback& f) const
+  {
+    this->intersectsLeaves (ray, [this, &f](const Node& leaf) {
+      float distance = Util::maxFloat ();
+      for (unsigned int i = leaf.offset; i < leaf.offset + leaf.numElements; i++)
+      {
+        distance = glm::min (distance, f (this->elements[i]));
+      }
+      return distance;
+    });
+  }
+
+  void intersects (const PrimRay& ray, const Bvh::RayElementsIntersectionCallback& f) const
+  {
+    this->intersectsLeaves (ray, [this, &f](const Node& leaf) {
+      return f (&this->elements[leaf.offset], leaf.numElements);
+    });
+  }
+
+  // `f` is called with each leaf that is hit and returns the nearest distance found in it
+  template <typename F> void intersectsLeaves (const PrimRay& ray, const F& f) const
+  {
+    if (this->nodes.empty ())
+    {
+      return;
+    }
+
+    const auto intersectsNode = [&ray](const Node& node, float& t) {
+      const glm::vec3 lowerTs = (node.box.minimum - ray.origin ()) * ray.invDirection ();
+      const glm::vec3 upperTs = (node.box.maximum - ray.origin ()) * ray.invDirection ();
+      const glm::vec3 min = glm::min (lowerTs, upperTs);
+      const glm::vec3 max = glm::max (lowerTs, upperTs);
+      const float     tMax = glm::min (glm::min (max.x, max.y), max.z);
+
+      t = glm::max (glm::max (min.x, min.y), min.z);
+      return (tMax >= 0.0f || ray.isLine ()) && t <= tMax;
+    };
+
+    std::vector<std::pair<unsigned int, float>> stack;
+    float                                       distance = Util::maxFloat ();
+    float                                       t;
+
+    if (intersectsNode (this->nodes[0], t))
+    {
+      stack.emplace_back (0, t);
+    }
+
+    while (stack.empty () == false)
+    {
+      const unsigned int nodeIndex = stack.back ().first;
+      const float        nodeT = stack.back ().second;
+      stack.pop_back ();
+
+      if (nodeT > distance)
+      {
+        continue;
+      }
+
+      const Node& node = this->nodes[nodeIndex];
+      if (node.isLeaf ())
+      {
+        distance = glm::min (distance, f (node));
+      }
+      else
+      {
+        float      t1, t2;
+        const bool hit1 = intersectsNode (this->nodes[node.offset], t1);
+        const bool hit2 = intersectsNode (this->nodes[node.offset + 1], t2);
+
+        // the nearer child is visited first
+        if (hit1 && hit2 && t1 <= t2)
+        {
+          stack.emplace_back (node.offset + 1, t2);
+          stack.emplace_back (node.offset, t1);
+        }
+        else if (hit1 && hit2)
+        {
+          stack.emplace_back (node.offset, t1);
+          stack.emplace_back (node.offset + 1, t2);
+        }
+        else if (hit1)
+        {
+          stack.emplace_back (node.offset, t1);
+        }
+        else if (hit2)
+        {
+          stack.emplace_back (node.offset + 1, t2);
+        }
+      }
+    }
+  }
+
+  float distance (const glm::vec3& p, const Bvh::DistanceCallback& f) const
+  {
+    return this->distance (p, Util::maxFloat (), f);
+  }
+
+  float distance (const glm::vec3& p, float maxDistance, const Bvh::DistanceCallback& f) const
+  {
+    float distance = maxDistance;
+
+    if (this->nodes.empty ())
+    {
+      return distance;
+    }
+
+    std::vector<std::pair<unsigned int, float>> stack;
+    stack.emplace_back (0, this->nodes[0].box.distance (p));
+
+    while (stack.empty () == false)
+    {
+      const unsigned int nodeIndex = stack.back ().first;
+      const float        nodeDistance = stack.back ().second;
+      stack.pop_back ();
+
+      if (nodeDistance >= distance)
+      {
+        continue;
+      }
+
+      const Node& node = this->nodes[nodeIndex];
+      if (node.isLeaf ())
+      {
+        distance = glm::min (distance, f (node));
+      }
+      else
+      {
+        const float d1 = this->nodes[node.offset].box.distance (p);
+        const float d2 = this->nodes[node.offset + 1].box.distance (p);
+
+        // the nearer child is visited first
+        if (d1 <= d2)
+        {
+          stack.emplace_back (node.offset + 1, d2);
+          stack.emplace_back (node.offset, d1);
+        }
+        else
+        {
+          stack.emplace_back (node.offset, d1);
+          stack.emplace_back (node.offset + 1, d2);
+        }
+      }
+    }
+    return distance;
+  }
+};
+
+DELEGATE_BIG6 (Bvh)
+DELEGATE_CONST (unsigned int, Bvh, numElements)
+DELEGATE_CONST (std::size_t, Bvh, numBytes)
+DELEGATE2 (void, Bvh, build, unsigned int, const Bvh::BoundsCallback&)
+DELEGATE1 (void, Bvh, refit, const Bvh::BoundsCallback&)
+DELEGATE2 (void, Bvh, refit, const std::vector<unsigned int>&, const Bvh::BoundsCallback&)
+DELEGATE (void, Bvh, reset)
+DELEGATE2_CONST (void, Bvh, intersects, const PrimRay&, const Bvh::RayIntersectionCallback&)
+DELEGATE2_CONST (void, Bvh, intersects, const PrimRay&,
+                 const Bvh::RayElementsIntersectionCallback&)
+DELEGATE2_CONST (float, Bvh, distance, const glm::vec3&, const Bvh::DistanceCallback&)
+DELEGATE3_CONST (float, Bvh, distance, const glm::vec3&, float, const Bvh::DistanceCallback&)
@@ -0,0 +1,54 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_BVH
+#define DILAY_BVH
+
+#include <cstddef>
+#include <functional>
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+class PrimAABox;
+class PrimRay;
+
+/* A bounding volume hierarchy over the boxes of elements `0 .. n-1`.  Nodes are stored in a
+ * single array and the elements of a leaf are consecutive.  The hierarchy is built in parallel
+ * with the surface area heuristic and refit, i.e. its boxes are recomputed while its structure
+ * is kept, when elements move.
+ */
+class Bvh
+{
+public:
+  DECLARE_BIG6 (Bvh)
+
+  // called in parallel
+  typedef std::function<PrimAABox(unsigned int)> BoundsCallback;
+
+  // return the distance of the nearest element found so far
+  typedef std::function<float(unsigned int)> RayIntersectionCallback;
+  typedef std::function<float(unsigned int)> DistanceCallback;
+
+  // called with the elements of a leaf
+  typedef std::function<float(const unsigned int*, unsigned int)> RayElementsIntersectionCallback;
+
+  unsigned int numElements () const;
+  std::size_t  numBytes () const;
+  void         build (unsigned int, const BoundsCallback&);
+  void         refit (const BoundsCallback&);
+  // only refits the leaves of the given elements and their ancestors
+  void         refit (const std::vector<unsigned int>&, const BoundsCallback&);
+  void         reset ();
+  void         intersects (const PrimRay&, const RayIntersectionCallback&) const;
+  void         intersects (const PrimRay&, const RayElementsIntersectionCallback&) const;
+  float        distance (const glm::vec3&, const DistanceCallback&) const;
+  // only searches elements that are nearer than the given distance
+  float        distance (const glm::vec3&, float, const DistanceCallback&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -15,16 +15,28 @@ public:
   {
   }
 
+  KVStore::Key key (const std::string& path) const { return this->store.key (path); }
+
   template <class T> const T& get (const std::string& path, const T& value) const
   {
     return this->store.get<T> (path, value);
   }
 
+  template <class T> const T& get (const KVStore::Key& key, const T& value) const
+  {
+    return this->store.get<T> (key, value);
+  }
+
   template <class T> void set (const std::string& path, const T& value)
   {
     this->store.set<T> (path, value);
   }
 
+  template <class T> void set (const KVStore::Key& key, const T& value)
+  {
+    this->store.set<T> (key, value);
+  }
+
 private:
   KVStore store;
 };
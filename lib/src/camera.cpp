@@ -18,7 +18,8 @@
 struct Camera::Impl
 {
   Camera*     self;
-  Renderer    renderer;
+  Renderer    ownRenderer;
+  Renderer&   renderer;
   glm::vec3   gazePoint;
   glm::vec3   toEyePoint;
   glm::vec3   right;
@@ -29,12 +30,25 @@ struct Camera::Impl
   float       nearClipping;
   float       farClipping;
   float       fieldOfView;
+  bool        orthographic;
 
   Impl (Camera* s, const Config& config)
+    : Impl (s, config, nullptr)
+  {
+  }
+
+  Impl (Camera* s, const Config& config, Renderer& r)
+    : Impl (s, config, &r)
+  {
+  }
+
+  Impl (Camera* s, const Config& config, Renderer* r)
     : self (s)
-    , renderer (config)
+    , ownRenderer (config)
+    , renderer (r ? *r : this->ownRenderer)
     , resolution (config.get<int> ("window/initial-width"),
                   config.get<int> ("window/initial-height"))
+    , orthographic (false)
   {
     this->set (glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 6.0f));
     this->runFromConfig (config);
@@ -167,12 +181,31 @@ struct Camera::Impl
     return PrimRay (eye, w - eye);
   }
 
+  // the extent of an orthographic projection matches the perspective one at the gaze point
   void updateProjection ()
   {
+    const float aspect = float(this->resolution.x) / float(this->resolution.y);
+
     OpenGL::glViewport (0, 0, this->resolution.x, this->resolution.y);
-    this->projection =
-      glm::perspective (this->fieldOfView, float(this->resolution.x) / float(this->resolution.y),
-                        this->nearClipping, this->farClipping);
+
+    if (this->orthographic)
+    {
+      const float h = glm::length (this->toEyePoint) * glm::tan (this->fieldOfView * 0.5f);
+      const float w = h * aspect;
+
+      this->projection = glm::ortho (-w, w, -h, h, this->nearClipping, this->farClipping);
+    }
+    else
+    {
+      this->projection =
+        glm::perspective (this->fieldOfView, aspect, this->nearClipping, this->farClipping);
+    }
+  }
+
+  void setOrthographic (bool value)
+  {
+    this->orthographic = value;
+    this->updateProjection ();
   }
 
   void updateView ()
@@ -182,6 +215,11 @@ struct Camera::Impl
     this->view = glm::lookAt (this->position (), this->gazePoint, up);
     this->viewRotation = glm::lookAt (glm::normalize (this->toEyePoint), glm::vec3 (0.0f), up);
     this->renderer.setEyePoint (this->position ());
+
+    if (this->orthographic)
+    {
+      this->updateProjection ();
+    }
   }
 
   Dimension primaryDimension () const
@@ -239,6 +277,7 @@ struct Camera::Impl
 };
 
 DELEGATE1_BIG3_SELF (Camera, const Config&)
+DELEGATE2_CONSTRUCTOR_SELF (Camera, const Config&, Renderer&)
 
 GETTER_CONST (Renderer&, Camera, renderer)
 GETTER_CONST (const glm::uvec2&, Camera, resolution)
@@ -248,8 +287,10 @@ DELEGATE_CONST (glm::vec3, Camera, realUp)
 GETTER_CONST (const glm::vec3&, Camera, right)
 GETTER_CONST (const glm::mat4x4&, Camera, view)
 GETTER_CONST (const glm::mat4x4&, Camera, viewRotation)
+GETTER_CONST (const glm::mat4x4&, Camera, projection)
 DELEGATE_CONST (glm::vec3, Camera, position)
 DELEGATE_CONST (glm::mat4x4, Camera, world)
+GETTER_CONST (bool, Camera, orthographic)
 DELEGATE1 (void, Camera, updateResolution, const glm::uvec2&)
 DELEGATE3 (void, Camera, setModelViewProjection, const glm::mat4x4&, const glm::mat3x3&, bool)
 DELEGATE2 (void, Camera, set, const glm::vec3&, const glm::vec3&)
@@ -265,3 +306,5 @@ DELEGATE_CONST (Dimension, Camera, primaryDimension)
 DELEGATE1_CONST (glm::vec3, Camera, viewPlaneIntersection, const glm::ivec2&)
 DELEGATE1_CONST (glm::vec3, Camera, primaryPlaneIntersection, const glm::ivec2&)
 DELEGATE1 (void, Camera, runFromConfig, const Config&)
+
+void Camera::orthographic (bool value) { this->impl->setOrthographic (value); }
@@ -17,6 +17,8 @@ class Camera : public Configurable
 {
 public:
   DECLARE_BIG3 (Camera, const Config&)
+  // renders with the given renderer, e.g., to share its programs with another camera
+  Camera (const Config&, Renderer&);
 
   Renderer&          renderer () const;
   const glm::uvec2&  resolution () const;
@@ -26,8 +28,12 @@ public:
   const glm::vec3&   right () const;
   const glm::mat4x4& view () const;
   const glm::mat4x4& viewRotation () const;
+  const glm::mat4x4& projection () const;
   glm::vec3          position () const;
   glm::mat4x4        world () const;
+  // orthographic cameras are only meant for rendering, not for picking
+  bool               orthographic () const;
+  void               orthographic (bool);
 
   void updateResolution (const glm::uvec2&);
   void setModelViewProjection (const glm::mat4x4&, const glm::mat3x3&, bool);
@@ -73,6 +73,20 @@ void Config::restoreDefaults ()
 
   this->set ("editor/mesh/color/normal", Color (0.8f, 0.8f, 0.8f));
   this->set ("editor/mesh/color/wireframe", Color (0.3f, 0.3f, 0.3f));
+  this->set ("editor/mesh/use-bvh", false);
+  this->set ("editor/mesh/cache-distances", false);
+  this->set ("editor/mesh/index-edges", false);
+  this->set ("editor/mesh/gpu-normals", false);
+  this->set ("editor/mesh/reorder-on-prune", false);
+  this->set ("editor/mesh/optimize-index-order", true);
+  this->set ("editor/mesh/cull-clusters", false);
+  this->set ("editor/mesh/compact-num-faces", 0);
+  this->set ("editor/mesh/deferred-num-faces", 200000);
+  this->set ("editor/mesh/matcap-num-faces", 0);
+  this->set ("editor/mesh/defragment-interval", 1000);
+  this->set ("editor/mesh/defragment-num-elements", 4096);
+  this->set ("editor/mesh/octree/leaf-size", 8);
+  this->set ("editor/mesh/octree/min-element-extent", 0.25f);
 
   this->set ("editor/sketch/node/color", Color (0.5f, 0.5f, 0.9f));
   this->set ("editor/sketch/bubble/color", Color (0.5f, 0.5f, 0.7f));
@@ -82,18 +96,51 @@ void Config::restoreDefaults ()
 
   this->set ("editor/tool/sculpt/detail-factor", 0.75f);
   this->set ("editor/tool/sculpt/step-width-factor", 0.3f);
+  this->set ("editor/tool/sculpt/batch-subdivision", false);
+  this->set ("editor/tool/sculpt/dab-budget", 16.0f);
+  this->set ("editor/tool/sculpt/coalesce-events", false);
+  this->set ("editor/tool/sculpt/background", false);
+  this->set ("editor/tool/sculpt/separate-stroke-region", true);
+  this->set ("editor/tool/sculpt/coarse-level-factor", 0.25f);
   this->set ("editor/tool/sculpt/max-absolute-radius", 2.0f);
+  this->set ("editor/tool/sculpt/highlight-region", false);
+  this->set ("editor/tool/sculpt/highlight-color", Color (1.0f, 0.8f, 0.6f));
+  this->set ("editor/tool/sculpt/cursor-prediction", 0.0f);
   this->set ("editor/tool/sculpt/mirror/render", false);
+  this->set ("editor/tool/sculpt/mirror/combine", false);
   this->set ("editor/tool/sculpt/mirror/width", 0.02f);
   this->set ("editor/tool/sculpt/mirror/color", Color (0.8f, 0.8f, 0.8f));
 
   this->set ("editor/tool/sketch-spheres/step-width-factor", 0.3f);
 
   this->set ("editor/undo-depth", 15);
+  this->set ("editor/undo-memory", 1024);
+  this->set ("editor/undo-disk-memory", 0);
+  this->set ("editor/undo-coalesce-time", 0);
+  this->set ("editor/memory-budget", 0);
+
+  this->set ("editor/autosave-interval", 5);
+  this->set ("editor/compress-files", false);
+  this->set ("editor/store-mesh-layouts", false);
+  this->set ("editor/preview-size", 128);
+  this->set ("editor/import/clean", true);
+  this->set ("editor/import/weld-distance", 0.0f);
+  this->set ("editor/journal/active", false);
+  this->set ("editor/journal/checkpoint-size", 256);
 
   this->set ("editor/tablet-pressure-intensity", 1.0f);
 
   this->set ("editor/use-geometry-shader", true);
+  this->set ("editor/prefer-core-profile", true);
+  this->set ("editor/max-frame-queue", 2);
+  this->set ("editor/occlusion-culling", false);
+  this->set ("editor/dynamic-resolution/active", false);
+  this->set ("editor/dynamic-resolution/min-scale", 0.5f);
+  this->set ("editor/dynamic-resolution/frame-time", 33.0f);
+  this->set ("editor/side-view/refresh-interval", 100);
+
+  this->set ("editor/num-threads", 0);
+  this->set ("editor/idle-delay", 500);
 
   this->set ("window/initial-width", 1024);
   this->set ("window/initial-height", 768);
@@ -12,11 +12,18 @@ class Config
 public:
   Config ();
 
+  KVStore::Key key (const std::string& path) const { return this->store.key (path); }
+
   template <class T> const T& get (const std::string& path) const
   {
     return this->store.get<T> (path);
   }
 
+  template <class T> const T& get (const KVStore::Key& key) const
+  {
+    return this->store.get<T> (key);
+  }
+
   template <class T> void set (const std::string& path, const T& value)
   {
     this->store.set<T> (path, value);
@@ -0,0 +1,47 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_COPY_ON_WRITE
+#define DILAY_COPY_ON_WRITE
+
+#include <memory>
+
+/* Copies share their value until one of them is written.  Writing to a shared value copies it
+ * first, so a reference obtained by `write` is invalidated by copying the owner.
+ */
+template <typename T> class CopyOnWrite
+{
+public:
+  CopyOnWrite ()
+    : value (std::make_shared<T> ())
+  {
+  }
+
+  CopyOnWrite (const CopyOnWrite<T>&) = default;
+  CopyOnWrite (CopyOnWrite<T>&&) = default;
+  CopyOnWrite<T>& operator= (const CopyOnWrite<T>&) = default;
+  CopyOnWrite<T>& operator= (CopyOnWrite<T>&&) = default;
+
+  const T& operator* () const { return *this->value; }
+
+  const T* operator-> () const { return this->value.get (); }
+
+  T& write ()
+  {
+    if (this->isShared ())
+    {
+      this->value = std::make_shared<T> (*this->value);
+    }
+    return *this->value;
+  }
+
+  bool isShared () const { return this->value.use_count () > 1; }
+
+  void reset () { this->value = std::make_shared<T> (); }
+
+private:
+  std::shared_ptr<T> value;
+};
+
+#endif
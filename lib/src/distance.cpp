@@ -3,11 +3,15 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include <limits>
 #include "distance.hpp"
+#include "primitive/cone-sphere-block.hpp"
 #include "primitive/cone-sphere.hpp"
 #include "primitive/cone.hpp"
 #include "primitive/cylinder.hpp"
 #include "primitive/sphere.hpp"
+#include "primitive/triangle-block.hpp"
 #include "primitive/triangle.hpp"
 #include "util.hpp"
 
@@ -37,6 +41,81 @@ namespace
       return insideR ? glm::max (-x, glm::max (yr, xl)) : yr;
     }
   }
+
+  // squared distance of a point to the segment from `d` to `d + e`, both relative to the point
+  float segmentDistanceSqr (const glm::vec3& d, const glm::vec3& e)
+  {
+    const float eSqr = glm::max (glm::length2 (e), std::numeric_limits<float>::min ());
+    const float u = glm::clamp (-glm::dot (d, e) / eSqr, 0.0f, 1.0f);
+
+    return glm::length2 (d + (u * e));
+  }
+
+  /* Branch-free variant of `Distance::distance (const PrimTriangle&, const glm::vec3&)`: the
+   * nearest point is the projection of the point if it lies within the triangle, and the nearest
+   * point of an edge otherwise.
+   */
+  float triangleDistance (const glm::vec3& v1, const glm::vec3& e0, const glm::vec3& e1,
+                          const glm::vec3& point)
+  {
+    const glm::vec3 d = v1 - point;
+    const float     a = glm::dot (e0, e0);
+    const float     b = glm::dot (e0, e1);
+    const float     c = glm::dot (e1, e1);
+    const float     dd = glm::dot (e0, d);
+    const float     e = glm::dot (e1, d);
+    const float     det = (a * c) - (b * b);
+    const float     s = ((b * e) - (c * dd)) / det;
+    const float     t = ((b * dd) - (a * e)) / det;
+    const bool      inside = s >= 0.0f && t >= 0.0f && s + t <= 1.0f;
+
+    const float interior = glm::length2 (d + (s * e0) + (t * e1));
+    const float edges = glm::min (glm::min (segmentDistanceSqr (d, e0), segmentDistanceSqr (d, e1)),
+                                  segmentDistanceSqr (d + e0, e1 - e0));
+
+    return glm::sqrt (inside ? interior : edges);
+  }
+
+  // branch-free variant of `Distance::distance (const PrimConeSphere&, const glm::vec3&)`
+  float coneSphereDistance (const PrimConeSphereBlock::Parameters& p, unsigned int i,
+                            const glm::vec3& point)
+  {
+    const float tx = point.x - p.x[i];
+    const float ty = point.y - p.y[i];
+    const float tz = point.z - p.z[i];
+    const float x = (tx * p.directionX[i]) + (ty * p.directionY[i]) + (tz * p.directionZ[i]);
+    const float y = glm::sqrt (glm::max (0.0f, (tx * tx) + (ty * ty) + (tz * tz) - (x * x)));
+    const float l = p.length[i];
+    const float xl = x - l;
+    const float d1 = glm::sqrt ((x * x) + (y * y)) - p.radius1[i];
+    const float d2 = glm::sqrt ((xl * xl) + (y * y)) - p.endRadius[i];
+    const float xh = x - p.h1[i];
+    const float yr = y - p.r1c[i];
+    const float xn = (xh * p.cosAlpha[i]) - (yr * p.sinAlpha[i]);
+    const float yn = (xh * p.sinAlpha[i]) + (yr * p.cosAlpha[i]);
+    const float dSide = xn <= 0.0f ? d1 : (xn >= p.sideLength[i] ? d2 : yn);
+    const float dCone = x <= 0.0f ? d1 : ((x >= l + p.h2[i] && y <= p.r2c[i]) ? d2 : dSide);
+
+    return p.hasCone[i] ? dCone : d1;
+  }
+
+  // the minimum of the first `n` distances and its index
+  float minimum (const float* distances, unsigned int n, unsigned int* index)
+  {
+    float        min = Util::maxFloat ();
+    unsigned int minIndex = Util::invalidIndex ();
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      if (distances[i] < min)
+      {
+        min = distances[i];
+        minIndex = i;
+      }
+    }
+    Util::setIfNotNull (index, minIndex);
+    return min;
+  }
 }
 
 float Distance::distance (const PrimSphere& sphere, const glm::vec3& point)
@@ -176,8 +255,13 @@ float Distance::distance (const PrimConeSphere& coneSphere, const glm::vec3& poi
   }
 }
 
-// cf. https://www.geometrictools.com/Documentation/DistancePoint3Triangle3.pdf
 float Distance::distance (const PrimTriangle& tri, const glm::vec3& point)
+{
+  return glm::distance (point, Distance::nearestPoint (tri, point));
+}
+
+// cf. https://www.geometrictools.com/Documentation/DistancePoint3Triangle3.pdf
+glm::vec3 Distance::nearestPoint (const PrimTriangle& tri, const glm::vec3& point)
 {
   const glm::vec3& P = point;
   const glm::vec3& B = tri.vertex1 ();
@@ -342,5 +426,60 @@ float Distance::distance (const PrimTriangle& tri, const glm::vec3& point)
       t = 1.0f - s;
     }
   }
-  return glm::distance (point, B + (s * E0) + (t * E1));
+  return B + (s * E0) + (t * E1);
+}
+
+float Distance::distance (const PrimTriangleBlock& block, const glm::vec3& point,
+                          unsigned int* nearest)
+{
+  const PrimTriangleBlock::Coordinates& v1 = block.vertices1 ();
+  const PrimTriangleBlock::Coordinates& e0 = block.edges1 ();
+  const PrimTriangleBlock::Coordinates& e1 = block.edges2 ();
+  float                                 distances[PrimTriangleBlock::maxTriangles];
+
+  for (unsigned int i = 0; i < block.numTriangles (); i++)
+  {
+    distances[i] = triangleDistance (glm::vec3 (v1.x[i], v1.y[i], v1.z[i]),
+                                     glm::vec3 (e0.x[i], e0.y[i], e0.z[i]),
+                                     glm::vec3 (e1.x[i], e1.y[i], e1.z[i]), point);
+  }
+  return minimum (distances, block.numTriangles (), nearest);
+}
+
+float Distance::distance (const PrimConeSphereBlock& block, const glm::vec3& point,
+                          unsigned int* nearest)
+{
+  float distances[PrimConeSphereBlock::maxConeSpheres];
+
+  for (unsigned int i = 0; i < block.numConeSpheres (); i++)
+  {
+    distances[i] = coneSphereDistance (block.parameters (), i, point);
+  }
+  return minimum (distances, block.numConeSpheres (), nearest);
+}
+
+void Distance::distances (const PrimTriangle& tri, const std::vector<glm::vec3>& points,
+                          std::vector<float>& distances)
+{
+  const glm::vec3 e0 = tri.vertex2 () - tri.vertex1 ();
+  const glm::vec3 e1 = tri.vertex3 () - tri.vertex1 ();
+
+  distances.resize (points.size ());
+  for (unsigned int i = 0; i < points.size (); i++)
+  {
+    distances[i] = triangleDistance (tri.vertex1 (), e0, e1, points[i]);
+  }
+}
+
+void Distance::distances (const PrimConeSphere& coneSphere, const std::vector<glm::vec3>& points,
+                          std::vector<float>& distances)
+{
+  PrimConeSphereBlock block;
+  block.add (coneSphere);
+
+  distances.resize (points.size ());
+  for (unsigned int i = 0; i < points.size (); i++)
+  {
+    distances[i] = coneSphereDistance (block.parameters (), 0, points[i]);
+  }
 }
@@ -6,12 +6,15 @@
 #define DILAY_DISTANCE
 
 #include <glm/fwd.hpp>
+#include <vector>
 
 class PrimCone;
 class PrimConeSphere;
+class PrimConeSphereBlock;
 class PrimCylinder;
 class PrimSphere;
 class PrimTriangle;
+class PrimTriangleBlock;
 
 namespace Distance
 {
@@ -20,6 +23,16 @@ namespace Distance
   float distance (const PrimCone&, const glm::vec3&);
   float distance (const PrimConeSphere&, const glm::vec3&);
   float distance (const PrimTriangle&, const glm::vec3&);
+  // the point of a triangle that is nearest to the given point
+  glm::vec3 nearestPoint (const PrimTriangle&, const glm::vec3&);
+
+  /* Batches are evaluated by branch-free loops, which compilers vectorize.  The distance to a
+   * block is the distance to its nearest primitive, whose index within the block is stored.
+   */
+  float distance (const PrimTriangleBlock&, const glm::vec3&, unsigned int* = nullptr);
+  float distance (const PrimConeSphereBlock&, const glm::vec3&, unsigned int* = nullptr);
+  void  distances (const PrimTriangle&, const std::vector<glm::vec3>&, std::vector<float>&);
+  void  distances (const PrimConeSphere&, const std::vector<glm::vec3>&, std::vector<float>&);
 }
 
 #endif
@@ -0,0 +1,228 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "dynamic/distance-cache.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // the bits of a position
+  struct Key
+  {
+    uint32_t x, y, z;
+
+    Key (const glm::vec3& p)
+    {
+      std::memcpy (&this->x, &p.x, sizeof (uint32_t));
+      std::memcpy (&this->y, &p.y, sizeof (uint32_t));
+      std::memcpy (&this->z, &p.z, sizeof (uint32_t));
+    }
+
+    glm::vec3 position () const
+    {
+      glm::vec3 p;
+      std::memcpy (&p.x, &this->x, sizeof (uint32_t));
+      std::memcpy (&p.y, &this->y, sizeof (uint32_t));
+      std::memcpy (&p.z, &this->z, sizeof (uint32_t));
+      return p;
+    }
+
+    bool operator== (const Key& other) const
+    {
+      return this->x == other.x && this->y == other.y && this->z == other.z;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator() (const Key& key) const
+    {
+      return (std::size_t (key.x) * 73856093u) ^ (std::size_t (key.y) * 19349663u) ^
+             (std::size_t (key.z) * 83492791u);
+    }
+  };
+
+  static const unsigned int numShards = 64;
+
+  struct Shard
+  {
+    std::mutex                               mutex;
+    std::unordered_map<Key, float, KeyHash> distances;
+  };
+
+  typedef std::array<Shard, numShards> Shards;
+}
+
+struct DynamicDistanceCache::Impl
+{
+  std::unique_ptr<Shards> shards;
+  std::atomic<bool>       hasEntries;
+  float                   resolution;
+  bool                    hasChanges;
+  glm::vec3               changesMin;
+  glm::vec3               changesMax;
+  std::mutex              mutex;
+
+  Impl ()
+    : hasEntries (false)
+    , resolution (0.0f)
+    , hasChanges (false)
+  {
+  }
+
+  Impl (const Impl&)
+    : Impl ()
+  {
+  }
+
+  bool isEmpty () const { return this->hasEntries == false; }
+
+  void addChange (const glm::vec3& p)
+  {
+    if (this->hasEntries)
+    {
+      if (this->hasChanges)
+      {
+        this->changesMin = glm::min (this->changesMin, p);
+        this->changesMax = glm::max (this->changesMax, p);
+      }
+      else
+      {
+        this->hasChanges = true;
+        this->changesMin = p;
+        this->changesMax = p;
+      }
+    }
+  }
+
+  // each entry of a map is approximated by a node with a pointer to the next one
+  std::size_t numBytes () const
+  {
+    std::size_t n = sizeof (DynamicDistanceCache::Impl);
+
+    if (this->shards)
+    {
+      for (Shard& shard : *this->shards)
+      {
+        std::lock_guard<std::mutex> lock (shard.mutex);
+
+        n += sizeof (Shard) + (shard.distances.bucket_count () * sizeof (void*)) +
+             (shard.distances.size () * (sizeof (std::pair<Key, float>) + sizeof (void*)));
+      }
+    }
+    return n;
+  }
+
+  void reset ()
+  {
+    this->shards.reset ();
+    this->hasEntries = false;
+    this->hasChanges = false;
+  }
+
+  // drops all distances that are not smaller than the distance to the changed region
+  void applyChanges ()
+  {
+    Shards& shards = *this->shards;
+
+    for (Shard& shard : shards)
+    {
+      for (auto it = shard.distances.begin (); it != shard.distances.end ();)
+      {
+        const glm::vec3 p = it->first.position ();
+        const glm::vec3 d =
+          glm::max (glm::max (this->changesMin - p, p - this->changesMax), glm::vec3 (0.0f));
+
+        if (glm::length (d) <= it->second)
+        {
+          it = shard.distances.erase (it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+    this->hasChanges = false;
+  }
+
+  void prepare (float resolution)
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    if (this->shards == nullptr || this->resolution != resolution)
+    {
+      this->reset ();
+      this->shards.reset (new Shards);
+      this->resolution = resolution;
+    }
+    else if (this->hasChanges)
+    {
+      this->applyChanges ();
+    }
+    this->hasEntries = true;
+  }
+
+  void distances (const std::vector<glm::vec3>& positions, std::vector<float>& distances,
+                  float resolution, const DistancesCallback& getDistances)
+  {
+    this->prepare (resolution);
+
+    Shards&                   shards = *this->shards;
+    std::vector<unsigned int> missing;
+    std::vector<glm::vec3>    missingPositions;
+    std::vector<float>        missingDistances;
+
+    distances.resize (positions.size ());
+    for (unsigned int i = 0; i < positions.size (); i++)
+    {
+      const Key                   key (positions[i]);
+      Shard&                      shard = shards[KeyHash () (key) % numShards];
+      std::lock_guard<std::mutex> lock (shard.mutex);
+      const auto                  it = shard.distances.find (key);
+
+      if (it == shard.distances.end ())
+      {
+        missing.push_back (i);
+        missingPositions.push_back (positions[i]);
+      }
+      else
+      {
+        distances[i] = it->second;
+      }
+    }
+
+    if (missing.empty () == false)
+    {
+      getDistances (missingPositions, missingDistances);
+      assert (missingDistances.size () == missing.size ());
+
+      for (unsigned int i = 0; i < missing.size (); i++)
+      {
+        const Key                   key (missingPositions[i]);
+        Shard&                      shard = shards[KeyHash () (key) % numShards];
+        std::lock_guard<std::mutex> lock (shard.mutex);
+
+        shard.distances.emplace (key, missingDistances[i]);
+        distances[missing[i]] = missingDistances[i];
+      }
+    }
+  }
+};
+
+DELEGATE_BIG4_COPY (DynamicDistanceCache)
+DELEGATE_CONST (bool, DynamicDistanceCache, isEmpty)
+DELEGATE1 (void, DynamicDistanceCache, addChange, const glm::vec3&)
+DELEGATE_CONST (std::size_t, DynamicDistanceCache, numBytes)
+DELEGATE (void, DynamicDistanceCache, reset)
+DELEGATE4 (void, DynamicDistanceCache, distances, const std::vector<glm::vec3>&,
+           std::vector<float>&, float, const DynamicDistanceCache::DistancesCallback&)
@@ -0,0 +1,40 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_DISTANCE_CACHE
+#define DILAY_DYNAMIC_DISTANCE_CACHE
+
+#include <cstddef>
+#include <functional>
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+/* Caches distances at the sample positions of a single resolution.  Changes of the underlying
+ * geometry are collected in a region, and cached distances that may be affected by the region are
+ * dropped before the cache is used next.  A copy of a cache starts empty.  Distances may be
+ * queried in parallel.
+ */
+class DynamicDistanceCache
+{
+public:
+  DECLARE_BIG4_COPY (DynamicDistanceCache)
+
+  typedef std::function<void(const std::vector<glm::vec3>&, std::vector<float>&)>
+    DistancesCallback;
+
+  bool        isEmpty () const;
+  void        addChange (const glm::vec3&);
+  std::size_t numBytes () const;
+  void        reset ();
+
+  // looks up the distances of the given positions and computes missing ones with the callback
+  void distances (const std::vector<glm::vec3>&, std::vector<float>&, float,
+                  const DistancesCallback&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
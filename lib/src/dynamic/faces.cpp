@@ -2,41 +2,109 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
 #include "dynamic/faces.hpp"
+#include "profile.hpp"
 
-void DynamicFaces::insert (unsigned int i) { this->_uncommitted.insert (i); }
+namespace
+{
+  bool isSet (const std::vector<bool>& bits, unsigned int i)
+  {
+    return i < bits.size () && bits[i];
+  }
+
+  void set (std::vector<bool>& bits, unsigned int i)
+  {
+    if (i >= bits.size ())
+    {
+      bits.resize (i + 1, false);
+    }
+    bits[i] = true;
+  }
+
+  void clear (std::vector<bool>& bits, const DynamicFaces::Container& indices)
+  {
+    for (unsigned int i : indices)
+    {
+      bits[i] = false;
+    }
+  }
+
+  void filter (DynamicFaces::Container& indices, std::vector<bool>& bits,
+               const std::function<bool(unsigned int)>& f)
+  {
+    const auto it = std::remove_if (indices.begin (), indices.end (), [&bits, &f](unsigned int i) {
+      if (f (i) == false)
+      {
+        bits[i] = false;
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    });
+    indices.erase (it, indices.end ());
+  }
+}
+
+void DynamicFaces::insert (unsigned int i)
+{
+  DILAY_ALLOCATION_SCOPE ("faces");
+
+  if (isSet (this->_isUncommitted, i) == false)
+  {
+    set (this->_isUncommitted, i);
+    this->_uncommitted.push_back (i);
+  }
+}
 
 void DynamicFaces::insert (const DynamicFaces::Container& v)
 {
-  this->_uncommitted.insert (v.begin (), v.end ());
+  for (unsigned int i : v)
+  {
+    this->insert (i);
+  }
 }
 
 void DynamicFaces::reset ()
 {
   this->resetCommitted ();
+
+  clear (this->_isUncommitted, this->_uncommitted);
   this->_uncommitted.clear ();
 }
 
-void DynamicFaces::resetCommitted () { this->_indices.clear (); }
+void DynamicFaces::resetCommitted ()
+{
+  clear (this->_isCommitted, this->_indices);
+  this->_indices.clear ();
+}
 
 void DynamicFaces::commit ()
 {
+  DILAY_ALLOCATION_SCOPE ("faces");
+
   if (this->_indices.empty ())
   {
     this->_indices.swap (this->_uncommitted);
+    this->_isCommitted.swap (this->_isUncommitted);
   }
   else
   {
-    this->_indices.insert (this->_uncommitted.begin (), this->_uncommitted.end ());
+    for (unsigned int i : this->_uncommitted)
+    {
+      if (isSet (this->_isCommitted, i) == false)
+      {
+        set (this->_isCommitted, i);
+        this->_indices.push_back (i);
+      }
+    }
+    clear (this->_isUncommitted, this->_uncommitted);
     this->_uncommitted.clear ();
   }
 }
 
-bool DynamicFaces::contains (unsigned int i) const
-{
-  return this->_indices.find (i) != this->_indices.end ();
-}
-
 bool DynamicFaces::isEmpty () const
 {
   return this->_indices.empty () && this->_uncommitted.empty ();
@@ -46,26 +114,6 @@ bool DynamicFaces::hasUncomitted () const { return this->_uncommitted.empty () =
 
 void DynamicFaces::filter (const std::function<bool(unsigned int)>& f)
 {
-  for (auto it = this->_indices.begin (); it != this->_indices.end ();)
-  {
-    if (f (*it) == false)
-    {
-      it = this->_indices.erase (it);
-    }
-    else
-    {
-      ++it;
-    }
-  }
-  for (auto it = this->_uncommitted.begin (); it != this->_uncommitted.end ();)
-  {
-    if (f (*it) == false)
-    {
-      it = this->_uncommitted.erase (it);
-    }
-    else
-    {
-      ++it;
-    }
-  }
+  ::filter (this->_indices, this->_isCommitted, f);
+  ::filter (this->_uncommitted, this->_isUncommitted, f);
 }
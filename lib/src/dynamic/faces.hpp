@@ -6,35 +6,42 @@
 #define DILAY_DYNAMIC_FACES
 
 #include <functional>
-#include <unordered_set>
+#include <vector>
 
+/* Indices are stored densely in insertion order.  Membership is tracked by bitmaps over face
+ * indices, so neither inserting nor looking up an index involves hashing.
+ */
 class DynamicFaces
 {
 public:
-  typedef std::unordered_set<unsigned int> Container;
+  typedef std::vector<unsigned int> Container;
 
   const Container& indices () const { return this->_indices; }
   const Container& uncommitted () const { return this->_uncommitted; }
   unsigned int     numElements () const { return this->_indices.size (); }
 
-  Container::iterator       begin () { return this->_indices.begin (); }
-  Container::iterator       end () { return this->_indices.end (); }
   Container::const_iterator begin () const { return this->_indices.begin (); }
   Container::const_iterator end () const { return this->_indices.end (); }
 
+  bool contains (unsigned int i) const
+  {
+    return i < this->_isCommitted.size () && this->_isCommitted[i];
+  }
+
   void insert (unsigned int);
   void insert (const Container&);
   void reset ();
   void resetCommitted ();
   void commit ();
-  bool contains (unsigned int) const;
   bool isEmpty () const;
   bool hasUncomitted () const;
   void filter (const std::function<bool(unsigned int)>&);
 
 private:
-  Container _indices;
-  Container _uncommitted;
+  Container         _indices;
+  Container         _uncommitted;
+  std::vector<bool> _isCommitted;
+  std::vector<bool> _isUncommitted;
 };
 
 #endif
@@ -0,0 +1,125 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <memory>
+#include "../mesh.hpp"
+#include "camera.hpp"
+#include "dynamic/lod-proxy.hpp"
+#include "idle-tasks.hpp"
+#include "mesh-util.hpp"
+#include "primitive/aabox.hpp"
+
+namespace
+{
+  static const unsigned int proxyResolution = 128;
+
+  // fraction of the screen's height below which a mesh is considered small
+  static const float smallOnScreen = 0.25f;
+}
+
+// proxies are built while the user is idle, and `build` is declared last to finish first
+struct DynamicLodProxy::Impl
+{
+  Mesh      proxy;
+  glm::vec3 center;
+  float     radius;
+  bool      isUpToDate;
+  bool      isBuildOutdated;
+  Mesh      builtProxy;
+  IdleTask  build;
+
+  Impl ()
+    : center (0.0f)
+    , radius (0.0f)
+    , isUpToDate (false)
+    , isBuildOutdated (false)
+  {
+  }
+
+  Impl (const Impl&)
+    : Impl ()
+  {
+  }
+
+  static unsigned int minNumFaces () { return 1 << 17; }
+
+  void invalidate ()
+  {
+    this->isUpToDate = false;
+    this->isBuildOutdated = this->build.isValid ();
+  }
+
+  void reset ()
+  {
+    this->build.reset ();
+    this->builtProxy.reset ();
+    this->proxy.reset ();
+    this->isUpToDate = false;
+    this->isBuildOutdated = false;
+  }
+
+  bool isSmallOnScreen (const Camera& camera, const Mesh& mesh) const
+  {
+    const glm::vec3 scaling = mesh.scaling ();
+    const glm::vec3 center = glm::vec3 (mesh.modelMatrix () * glm::vec4 (this->center, 1.0f));
+    const float     radius = this->radius * glm::max (scaling.x, glm::max (scaling.y, scaling.z));
+    const float     distance = glm::distance (camera.position (), center);
+
+    return distance > radius &&
+           radius * camera.projection ()[1][1] < smallOnScreen * distance;
+  }
+
+  void update (const Mesh& mesh)
+  {
+    if (this->build.isReady ())
+    {
+      this->build.reset ();
+
+      if (this->isBuildOutdated == false)
+      {
+        const PrimAABox bounds = this->builtProxy.bounds ();
+
+        this->proxy = std::move (this->builtProxy);
+        this->proxy.bufferData ();
+        this->center = bounds.center ();
+        this->radius = glm::length (bounds.halfWidth ());
+        this->isUpToDate = true;
+      }
+      this->builtProxy.reset ();
+      this->isBuildOutdated = false;
+    }
+
+    if (this->isUpToDate == false && this->build.isValid () == false)
+    {
+      // the source is shared, since tasks are copied when they are scheduled
+      this->build.schedule ([result = &this->builtProxy, source = std::make_shared<Mesh> (mesh)]() {
+        *result = MeshUtil::simplify (*source, proxyResolution);
+      });
+    }
+  }
+
+  void render (Camera& camera, const Mesh& mesh)
+  {
+    assert (this->isUpToDate);
+
+    this->proxy.copyNonGeometry (mesh);
+    this->proxy.render (camera);
+  }
+
+  std::size_t numBytes () const { return sizeof (DynamicLodProxy::Impl) + this->proxy.numBytes (); }
+
+  std::size_t numBufferBytes () const { return this->proxy.numBufferBytes (); }
+};
+
+DELEGATE_BIG4_COPY (DynamicLodProxy)
+DELEGATE_STATIC (unsigned int, DynamicLodProxy, minNumFaces)
+DELEGATE (void, DynamicLodProxy, invalidate)
+DELEGATE (void, DynamicLodProxy, reset)
+GETTER_CONST (bool, DynamicLodProxy, isUpToDate)
+DELEGATE2_CONST (bool, DynamicLodProxy, isSmallOnScreen, const Camera&, const Mesh&)
+DELEGATE1 (void, DynamicLodProxy, update, const Mesh&)
+DELEGATE2 (void, DynamicLodProxy, render, Camera&, const Mesh&)
+DELEGATE_CONST (std::size_t, DynamicLodProxy, numBytes)
+DELEGATE_CONST (std::size_t, DynamicLodProxy, numBufferBytes)
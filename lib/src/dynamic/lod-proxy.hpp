@@ -0,0 +1,44 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_LOD_PROXY
+#define DILAY_DYNAMIC_LOD_PROXY
+
+#include <cstddef>
+#include "macro.hpp"
+
+class Camera;
+class Mesh;
+
+/* A simplified proxy of a mesh that is rendered instead of the mesh while the camera is moving
+ * or if the mesh is small on screen.  The proxy is built in the background from a copy of the
+ * mesh, and is outdated whenever the mesh is buffered.  A copy of a proxy starts outdated.
+ */
+class DynamicLodProxy
+{
+public:
+  DECLARE_BIG4_COPY (DynamicLodProxy)
+
+  // meshes with fewer faces are always rendered at full resolution
+  static unsigned int minNumFaces ();
+
+  void invalidate ();
+  // drops the proxy and a proxy that is being built, e.g., to save memory
+  void reset ();
+  bool isUpToDate () const;
+  bool isSmallOnScreen (const Camera&, const Mesh&) const;
+
+  // adopts a finished proxy and starts building an outdated proxy in the background
+  void update (const Mesh&);
+  void render (Camera&, const Mesh&);
+
+  // a proxy that is still being built is not counted
+  std::size_t numBytes () const;
+  std::size_t numBufferBytes () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,266 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <cstring>
+#include "dynamic/mesh-changes.hpp"
+
+namespace
+{
+  uint64_t zigZag (int64_t value)
+  {
+    return (uint64_t (value) << 1) ^ uint64_t (value >> 63);
+  }
+
+  int64_t unZigZag (uint64_t value) { return int64_t (value >> 1) ^ -int64_t (value & 1); }
+
+  uint32_t floatBits (float value)
+  {
+    uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (float));
+    return bits;
+  }
+
+  float bitsFloat (uint32_t bits)
+  {
+    float value;
+    std::memcpy (&value, &bits, sizeof (float));
+    return value;
+  }
+
+  // variable-length encoding of 7 bits per byte
+  struct Encoder
+  {
+    std::vector<unsigned char>& data;
+
+    Encoder (std::vector<unsigned char>& d)
+      : data (d)
+    {
+    }
+
+    void put (uint64_t value)
+    {
+      while (value >= 0x80)
+      {
+        this->data.push_back ((unsigned char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+      }
+      this->data.push_back ((unsigned char) value);
+    }
+  };
+
+  struct Decoder
+  {
+    const unsigned char* data;
+    std::size_t          size;
+    std::size_t          position;
+
+    Decoder (const unsigned char* d, std::size_t s)
+      : data (d)
+      , size (s)
+      , position (0)
+    {
+    }
+
+    uint64_t get ()
+    {
+      uint64_t     value = 0;
+      unsigned int shift = 0;
+
+      while (true)
+      {
+        assert (this->position < this->size);
+
+        const unsigned char byte = this->data[this->position++];
+        value |= uint64_t (byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+          return value;
+        }
+        shift += 7;
+      }
+    }
+  };
+
+  /* Coordinates are stored as the exclusive or of their bits and the bits of the previous
+   * coordinate, which leaves the equal sign, exponent and leading mantissa bits of nearby
+   * vertices zero.
+   */
+  void encodeVec3 (Encoder& encoder, const glm::vec3& v, uint32_t* previous)
+  {
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      const uint32_t bits = floatBits (v[i]);
+      encoder.put (bits ^ previous[i]);
+      previous[i] = bits;
+    }
+  }
+
+  glm::vec3 decodeVec3 (Decoder& decoder, uint32_t* previous)
+  {
+    glm::vec3 v;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      previous[i] ^= uint32_t (decoder.get ());
+      v[i] = bitsFloat (previous[i]);
+    }
+    return v;
+  }
+}
+
+DynamicMeshChanges::DynamicMeshChanges (unsigned int numVertices, unsigned int numFaces,
+                                        const glm::vec3& position, const glm::vec3& scaling,
+                                        const glm::mat4x4& rotationMatrix)
+  : _numVertices (numVertices)
+  , _numFaces (numFaces)
+  , _position (position)
+  , _scaling (scaling)
+  , _rotationMatrix (rotationMatrix)
+  , _hasVertex (numVertices, false)
+  , _hasFace (numFaces, false)
+  , _isCompressed (false)
+{
+}
+
+void DynamicMeshChanges::addVertex (unsigned int i, bool isFree, const glm::vec3& position,
+                                    const glm::vec3& normal)
+{
+  assert (this->hasVertex (i) == false);
+
+  this->_hasVertex[i] = true;
+  this->_vertices.push_back (Vertex{i, isFree, position, normal});
+}
+
+void DynamicMeshChanges::addFace (unsigned int i, bool isFree, unsigned int i1, unsigned int i2,
+                                  unsigned int i3)
+{
+  assert (this->hasFace (i) == false);
+
+  this->_hasFace[i] = true;
+  this->_faces.push_back (Face{i, isFree, i1, i2, i3});
+}
+
+void DynamicMeshChanges::shrinkToFit ()
+{
+  this->_hasVertex.clear ();
+  this->_hasVertex.shrink_to_fit ();
+  this->_hasFace.clear ();
+  this->_hasFace.shrink_to_fit ();
+  this->_vertices.shrink_to_fit ();
+  this->_faces.shrink_to_fit ();
+}
+
+void DynamicMeshChanges::compress ()
+{
+  assert (this->_isCompressed == false);
+  assert (this->_hasVertex.empty () && this->_hasFace.empty ());
+
+  Encoder encoder (this->_compressed);
+
+  encoder.put (this->_vertices.size ());
+  encoder.put (this->_faces.size ());
+
+  int64_t  previousIndex = 0;
+  uint32_t previousPosition[3] = {0, 0, 0};
+  uint32_t previousNormal[3] = {0, 0, 0};
+
+  for (const Vertex& v : this->_vertices)
+  {
+    encoder.put ((zigZag (int64_t (v.index) - previousIndex) << 1) | (v.isFree ? 1 : 0));
+    encodeVec3 (encoder, v.position, previousPosition);
+    encodeVec3 (encoder, v.normal, previousNormal);
+    previousIndex = v.index;
+  }
+
+  int64_t previousI1 = 0;
+  previousIndex = 0;
+
+  for (const Face& f : this->_faces)
+  {
+    encoder.put ((zigZag (int64_t (f.index) - previousIndex) << 1) | (f.isFree ? 1 : 0));
+    encoder.put (zigZag (int64_t (f.i1) - previousI1));
+    encoder.put (zigZag (int64_t (f.i2) - int64_t (f.i1)));
+    encoder.put (zigZag (int64_t (f.i3) - int64_t (f.i1)));
+    previousIndex = f.index;
+    previousI1 = f.i1;
+  }
+
+  this->_compressed.shrink_to_fit ();
+  this->_vertices.clear ();
+  this->_vertices.shrink_to_fit ();
+  this->_faces.clear ();
+  this->_faces.shrink_to_fit ();
+  this->_isCompressed = true;
+}
+
+void DynamicMeshChanges::releaseCompressedData ()
+{
+  assert (this->_isCompressed);
+
+  this->_compressed.clear ();
+  this->_compressed.shrink_to_fit ();
+}
+
+void DynamicMeshChanges::decompress ()
+{
+  if (this->_isCompressed)
+  {
+    this->decompress (this->_compressed.data (), this->_compressed.size ());
+  }
+}
+
+void DynamicMeshChanges::decompress (const unsigned char* data, std::size_t size)
+{
+  assert (this->_isCompressed);
+
+  Decoder decoder (data, size);
+
+  this->_vertices.resize (decoder.get ());
+  this->_faces.resize (decoder.get ());
+
+  int64_t  previousIndex = 0;
+  uint32_t previousPosition[3] = {0, 0, 0};
+  uint32_t previousNormal[3] = {0, 0, 0};
+
+  for (Vertex& v : this->_vertices)
+  {
+    const uint64_t index = decoder.get ();
+
+    v.index = (unsigned int) (previousIndex + unZigZag (index >> 1));
+    v.isFree = (index & 1) == 1;
+    v.position = decodeVec3 (decoder, previousPosition);
+    v.normal = decodeVec3 (decoder, previousNormal);
+    previousIndex = v.index;
+  }
+
+  int64_t previousI1 = 0;
+  previousIndex = 0;
+
+  for (Face& f : this->_faces)
+  {
+    const uint64_t index = decoder.get ();
+
+    f.index = (unsigned int) (previousIndex + unZigZag (index >> 1));
+    f.isFree = (index & 1) == 1;
+    f.i1 = (unsigned int) (previousI1 + unZigZag (decoder.get ()));
+    f.i2 = (unsigned int) (int64_t (f.i1) + unZigZag (decoder.get ()));
+    f.i3 = (unsigned int) (int64_t (f.i1) + unZigZag (decoder.get ()));
+    previousIndex = f.index;
+    previousI1 = f.i1;
+  }
+  assert (decoder.position == size);
+
+  this->_compressed.clear ();
+  this->_compressed.shrink_to_fit ();
+  this->_isCompressed = false;
+}
+
+std::size_t DynamicMeshChanges::numBytes () const
+{
+  return sizeof (DynamicMeshChanges) + (this->_vertices.capacity () * sizeof (Vertex)) +
+         (this->_faces.capacity () * sizeof (Face)) +
+         ((this->_hasVertex.capacity () + this->_hasFace.capacity ()) / 8) +
+         this->_compressed.capacity ();
+}
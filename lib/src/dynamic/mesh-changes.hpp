@@ -0,0 +1,101 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_CHANGES
+#define DILAY_DYNAMIC_MESH_CHANGES
+
+#include <cassert>
+#include <glm/glm.hpp>
+#include <vector>
+
+/* Records the state of a dynamic mesh by storing the previous data of each vertex and face when
+ * it is modified for the first time.  Vertices and faces beyond the recorded number of vertices
+ * and faces were added in the meantime and are not stored.  Recording is finished by
+ * `shrinkToFit`.  Finished changes can be compressed losslessly, which delta-encodes indices and
+ * the bits of consecutive coordinates.
+ */
+class DynamicMeshChanges
+{
+public:
+  struct Vertex
+  {
+    unsigned int index;
+    bool         isFree;
+    glm::vec3    position;
+    glm::vec3    normal;
+  };
+
+  struct Face
+  {
+    unsigned int index;
+    bool         isFree;
+    unsigned int i1, i2, i3;
+  };
+
+  DynamicMeshChanges (unsigned int, unsigned int, const glm::vec3&, const glm::vec3&,
+                      const glm::mat4x4&);
+
+  unsigned int               numVertices () const { return this->_numVertices; }
+  unsigned int               numFaces () const { return this->_numFaces; }
+  const glm::vec3&           position () const { return this->_position; }
+  const glm::vec3&           scaling () const { return this->_scaling; }
+  const glm::mat4x4&         rotationMatrix () const { return this->_rotationMatrix; }
+  bool                       isCompressed () const { return this->_isCompressed; }
+
+  const std::vector<Vertex>& vertices () const
+  {
+    assert (this->_isCompressed == false);
+    return this->_vertices;
+  }
+
+  const std::vector<Face>& faces () const
+  {
+    assert (this->_isCompressed == false);
+    return this->_faces;
+  }
+
+  bool hasVertex (unsigned int i) const
+  {
+    assert (i >= this->_numVertices || i < this->_hasVertex.size ());
+    return i >= this->_numVertices || this->_hasVertex[i];
+  }
+
+  bool hasFace (unsigned int i) const
+  {
+    assert (i >= this->_numFaces || i < this->_hasFace.size ());
+    return i >= this->_numFaces || this->_hasFace[i];
+  }
+
+  void        addVertex (unsigned int, bool, const glm::vec3&, const glm::vec3&);
+  void        addFace (unsigned int, bool, unsigned int, unsigned int, unsigned int);
+  void        shrinkToFit ();
+  void        compress ();
+  void        decompress ();
+  std::size_t numBytes () const;
+
+  // compressed data can be moved elsewhere and decompressed from there
+  const std::vector<unsigned char>& compressedData () const
+  {
+    assert (this->_isCompressed);
+    return this->_compressed;
+  }
+
+  void releaseCompressedData ();
+  void decompress (const unsigned char*, std::size_t);
+
+private:
+  unsigned int               _numVertices;
+  unsigned int               _numFaces;
+  glm::vec3                  _position;
+  glm::vec3                  _scaling;
+  glm::mat4x4                _rotationMatrix;
+  std::vector<bool>          _hasVertex;
+  std::vector<bool>          _hasFace;
+  std::vector<Vertex>        _vertices;
+  std::vector<Face>          _faces;
+  bool                       _isCompressed;
+  std::vector<unsigned char> _compressed;
+};
+
+#endif
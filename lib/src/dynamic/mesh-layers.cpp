@@ -0,0 +1,184 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include "dynamic/mesh-layers.hpp"
+#include "parallel.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // the number of vertices per task of the parallel blend
+  constexpr unsigned int blendGrain = 1 << 12;
+}
+
+float DynamicMeshLayers::strength (unsigned int layer) const
+{
+  return layer < this->layers.size () ? this->layers[layer].strength : 1.0f;
+}
+
+unsigned int DynamicMeshLayers::numVertices (unsigned int layer) const
+{
+  return layer < this->layers.size () ? this->layers[layer].vertices.size () : 0;
+}
+
+bool DynamicMeshLayers::hasDelta (unsigned int layer, unsigned int vertex) const
+{
+  return layer < this->layers.size () && this->layers[layer].slots.count (vertex) > 0;
+}
+
+bool DynamicMeshLayers::isDisplaced (unsigned int vertex) const
+{
+  for (const Layer& l : this->layers)
+  {
+    if (l.slots.count (vertex) > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+glm::vec3 DynamicMeshLayers::delta (unsigned int layer, unsigned int vertex) const
+{
+  if (layer < this->layers.size ())
+  {
+    const auto it = this->layers[layer].slots.find (vertex);
+    if (it != this->layers[layer].slots.end ())
+    {
+      return this->layers[layer].deltas[it->second];
+    }
+  }
+  return glm::vec3 (0.0f);
+}
+
+void DynamicMeshLayers::addDelta (unsigned int layer, unsigned int vertex, const glm::vec3& d)
+{
+  if (layer >= this->layers.size ())
+  {
+    this->layers.resize (layer + 1);
+  }
+  Layer& l = this->layers[layer];
+
+  assert (l.strength != 0.0f);
+
+  const auto it = l.slots.emplace (vertex, l.vertices.size ());
+  if (it.second)
+  {
+    l.vertices.push_back (vertex);
+    l.deltas.push_back (d / l.strength);
+  }
+  else
+  {
+    l.deltas[it.first->second] += d / l.strength;
+  }
+}
+
+void DynamicMeshLayers::strength (unsigned int layer, float s, const OffsetCallback& f)
+{
+  if (layer >= this->layers.size ())
+  {
+    this->layers.resize (layer + 1);
+  }
+  Layer&      l = this->layers[layer];
+  const float change = s - l.strength;
+
+  l.strength = s;
+  if (change == 0.0f)
+  {
+    return;
+  }
+
+  std::vector<glm::vec3> offsets (l.deltas.size ());
+  Parallel::forRange (l.deltas.size (), blendGrain,
+                      [&l, &offsets, change](unsigned int begin, unsigned int end) {
+                        for (unsigned int i = begin; i < end; i++)
+                        {
+                          offsets[i] = change * l.deltas[i];
+                        }
+                      });
+
+  for (unsigned int i = 0; i < l.vertices.size (); i++)
+  {
+    f (l.vertices[i], offsets[i]);
+  }
+}
+
+void DynamicMeshLayers::deleteVertex (unsigned int vertex)
+{
+  for (Layer& l : this->layers)
+  {
+    const auto it = l.slots.find (vertex);
+    if (it != l.slots.end ())
+    {
+      const unsigned int slot = it->second;
+
+      l.slots.erase (it);
+      if (slot + 1 < l.vertices.size ())
+      {
+        l.vertices[slot] = l.vertices.back ();
+        l.deltas[slot] = l.deltas.back ();
+        l.slots[l.vertices[slot]] = slot;
+      }
+      l.vertices.pop_back ();
+      l.deltas.pop_back ();
+    }
+  }
+}
+
+void DynamicMeshLayers::moveVertex (unsigned int vertex, unsigned int to)
+{
+  for (Layer& l : this->layers)
+  {
+    const auto it = l.slots.find (vertex);
+    if (it != l.slots.end ())
+    {
+      const unsigned int slot = it->second;
+
+      assert (l.slots.count (to) == 0);
+      l.slots.erase (it);
+      l.slots.emplace (to, slot);
+      l.vertices[slot] = to;
+    }
+  }
+}
+
+void DynamicMeshLayers::remap (const std::vector<unsigned int>& vertexMap)
+{
+  for (Layer& l : this->layers)
+  {
+    unsigned int n = 0;
+
+    l.slots.clear ();
+    for (unsigned int i = 0; i < l.vertices.size (); i++)
+    {
+      const unsigned int v = l.vertices[i];
+
+      if (v < vertexMap.size () && vertexMap[v] != Util::invalidIndex ())
+      {
+        l.vertices[n] = vertexMap[v];
+        l.deltas[n] = l.deltas[i];
+        l.slots.emplace (l.vertices[n], n);
+        n++;
+      }
+    }
+    l.vertices.resize (n);
+    l.deltas.resize (n);
+  }
+}
+
+void DynamicMeshLayers::reset () { this->layers.clear (); }
+
+std::size_t DynamicMeshLayers::numBytes () const
+{
+  std::size_t n = this->layers.capacity () * sizeof (Layer);
+
+  for (const Layer& l : this->layers)
+  {
+    n += l.vertices.capacity () * sizeof (unsigned int);
+    n += l.deltas.capacity () * sizeof (glm::vec3);
+    n += l.slots.size () * ((2 * sizeof (unsigned int)) + sizeof (void*));
+  }
+  return n;
+}
@@ -0,0 +1,68 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_LAYERS
+#define DILAY_DYNAMIC_MESH_LAYERS
+
+#include <functional>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+/* Sculpt layers of a dynamic mesh.  A layer stores the displacements of the vertices it has
+ * touched at full strength, i.e., sparsely, and the mesh holds the sum of all displacements
+ * scaled by the strengths of their layers.  Changing a strength thus only moves the vertices of
+ * its layer.  Displacements follow vertices that are moved to other indices and are dropped with
+ * deleted vertices.
+ */
+class DynamicMeshLayers
+{
+public:
+  typedef std::function<void(unsigned int, const glm::vec3&)> OffsetCallback;
+
+  unsigned int numLayers () const { return this->layers.size (); }
+  float        strength (unsigned int) const;
+  unsigned int numVertices (unsigned int) const;
+  bool         hasDelta (unsigned int, unsigned int) const;
+
+  // whether any layer has a displacement of a vertex
+  bool isDisplaced (unsigned int) const;
+
+  // returns the displacement of a vertex at full strength, which is 0 if it has not been touched
+  glm::vec3 delta (unsigned int, unsigned int) const;
+
+  /* Adds a displacement at the current strength of a layer, which is created if it is missing.
+   * Muted layers, i.e., layers of strength 0, cannot record displacements.
+   */
+  void addDelta (unsigned int, unsigned int, const glm::vec3&);
+
+  /* Sets the strength of a layer and calls `f (vertex, offset)` for each of its vertices, where
+   * `offset` moves the vertex to its new displacement.  Offsets are computed in parallel.
+   */
+  void strength (unsigned int, float, const OffsetCallback&);
+
+  void        deleteVertex (unsigned int);
+  void        moveVertex (unsigned int, unsigned int);
+  void        remap (const std::vector<unsigned int>&);
+  void        reset ();
+  std::size_t numBytes () const;
+
+private:
+  struct Layer
+  {
+    float                                          strength;
+    std::vector<unsigned int>                      vertices;
+    std::vector<glm::vec3>                         deltas;
+    std::unordered_map<unsigned int, unsigned int> slots;
+
+    Layer ()
+      : strength (1.0f)
+    {
+    }
+  };
+
+  std::vector<Layer> layers;
+};
+
+#endif
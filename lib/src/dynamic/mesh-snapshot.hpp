@@ -0,0 +1,100 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_MESH_SNAPSHOT
+#define DILAY_DYNAMIC_MESH_SNAPSHOT
+
+#include <cassert>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "dynamic/octree.hpp"
+#include "util.hpp"
+
+/* Elements of an array in pages of equal size.  A copy shares the pages of the original, and an
+ * update only replaces the pages that have been written, so that copies are never changed.
+ */
+template <typename T> class DynamicSnapshotPages
+{
+public:
+  static constexpr unsigned int pageShift = 12;
+
+  DynamicSnapshotPages ()
+    : _numElements (0)
+  {
+  }
+
+  unsigned int numElements () const { return this->_numElements; }
+
+  const T& get (unsigned int i) const
+  {
+    assert (i < this->_numElements);
+    return (*this->pages[i >> pageShift])[i & ((1 << pageShift) - 1)];
+  }
+
+  /* Copies `get (i)` into pages that are dirty or that contain elements beyond the previous
+   * number of elements.  All pages are copied if `isDirty` is empty.
+   */
+  template <typename F>
+  void update (unsigned int numElements, const std::vector<bool>& isDirty, const F& get)
+  {
+    const unsigned int numPages = (numElements + (1 << pageShift) - 1) >> pageShift;
+    const unsigned int firstNewPage = this->_numElements >> pageShift;
+
+    this->pages.resize (numPages);
+    for (unsigned int p = 0; p < numPages; p++)
+    {
+      if (isDirty.empty () || p >= firstNewPage || (p < isDirty.size () && isDirty[p]))
+      {
+        const unsigned int begin = p << pageShift;
+        const unsigned int end = glm::min ((p + 1) << pageShift, numElements);
+        auto               page = std::make_shared<std::vector<T>> ();
+
+        page->reserve (end - begin);
+        for (unsigned int i = begin; i < end; i++)
+        {
+          page->push_back (get (i));
+        }
+        this->pages[p] = std::move (page);
+      }
+    }
+    this->_numElements = numElements;
+  }
+
+private:
+  std::vector<std::shared_ptr<const std::vector<T>>> pages;
+  unsigned int                                       _numElements;
+};
+
+/* An immutable version of the vertices and faces of a dynamic mesh, which may be read on other
+ * threads while the mesh is edited (e.g., to save or to extract it in the background).  The
+ * indices of free faces are invalid.  Publishing the octree copies it as a whole, so it is only
+ * published with versions of meshes that are not being stroked, i.e., `octreeVersion` may precede
+ * `version` during a stroke.
+ */
+struct DynamicMeshSnapshot
+{
+  unsigned int                               version;
+  unsigned int                               octreeVersion;
+  DynamicSnapshotPages<glm::vec3>            vertices;
+  DynamicSnapshotPages<unsigned int>         indices;
+  std::shared_ptr<const DynamicOctreeLayout> octree;
+
+  DynamicMeshSnapshot ()
+    : version (0)
+    , octreeVersion (0)
+  {
+  }
+
+  unsigned int numFaces () const { return this->indices.numElements () / 3; }
+
+  bool isFreeFace (unsigned int i) const
+  {
+    return this->indices.get (3 * i) == Util::invalidIndex ();
+  }
+};
+
+typedef std::shared_ptr<const DynamicMeshSnapshot> DynamicMeshSnapshotPtr;
+
+#endif
@@ -2,90 +2,704 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
-#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include "../mesh.hpp"
+#include "bvh.hpp"
+#include "camera.hpp"
 #include "config.hpp"
+#include "copy-on-write.hpp"
 #include "distance.hpp"
+#include "dynamic/distance-cache.hpp"
 #include "dynamic/faces.hpp"
+#include "dynamic/lod-proxy.hpp"
+#include "dynamic/mesh-changes.hpp"
 #include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh-layers.hpp"
+#include "dynamic/mesh-snapshot.hpp"
 #include "dynamic/mesh.hpp"
 #include "dynamic/octree.hpp"
+#include "dynamic/visited.hpp"
+#include "hash.hpp"
 #include "intersection.hpp"
+#include "maybe.hpp"
 #include "mesh-util.hpp"
+#include "opengl.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/triangle-block.hpp"
 #include "primitive/triangle.hpp"
+#include "profile.hpp"
+#include "render-mode.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "util.hpp"
 
 namespace
 {
+  constexpr unsigned int minAdjacentCapacity = 8;
+  constexpr unsigned int adjacentSlack = 2;
+  constexpr unsigned int nearestPointsGrainSize = 1 << 10;
+  constexpr unsigned int areaGrainSize = 1 << 14;
+  constexpr unsigned int planeGrainSize = 1 << 12;
+  // the octree is built from scratch if more faces than this fraction no longer fit their nodes
+  constexpr float maxRefitFraction = 0.25f;
+
+  /* The adjacent faces of all vertices are stored in a single pool.  Each vertex owns a slot
+   * with some slack for editing.  A vertex whose slot is full moves to a larger slot at the end
+   * of the pool; abandoned slots are reclaimed by compacting the pool.
+   */
   struct VertexData
   {
-    bool                      isFree;
-    std::vector<unsigned int> adjacentFaces;
+    bool         isFree;
+    bool         isFrozen;
+    unsigned int adjacentOffset;
+    unsigned int numAdjacent;
+    unsigned int adjacentCapacity;
+
+    VertexData ()
+      : adjacentOffset (0)
+      , adjacentCapacity (0)
+    {
+      this->reset ();
+    }
 
-    VertexData () { this->reset (); }
     void reset ()
     {
       this->isFree = true;
-      this->adjacentFaces.clear ();
+      this->isFrozen = false;
+      this->numAdjacent = 0;
+    }
+  };
+
+  unsigned int adjacentCapacity (unsigned int numAdjacent)
+  {
+    return glm::max (minAdjacentCapacity, numAdjacent + adjacentSlack);
+  }
+
+  struct FaceData
+  {
+    bool isFree;
+
+    FaceData () { this->reset (); }
+    void reset () { this->isFree = true; }
+  };
+
+  unsigned int newId ()
+  {
+    static std::atomic<unsigned int> nextId (0);
+    return nextId++;
+  }
+
+  // the id and the tracked changes belong to a single mesh and are moved but not copied
+  struct Tracking
+  {
+    unsigned int                        id;
+    std::unique_ptr<DynamicMeshChanges> changes;
+
+    Tracking ()
+      : id (newId ())
+    {
+    }
+
+    Tracking (const Tracking&)
+      : Tracking ()
+    {
     }
 
-    void addAdjacentFace (unsigned int face) { this->adjacentFaces.push_back (face); }
+    Tracking (Tracking&&) = default;
+  };
+
+  /* Pages of vertices and of indices that have been written since the latest snapshot had been
+   * published.  Nothing is recorded until a snapshot is pinned for the first time.
+   */
+  struct Publishing
+  {
+    DynamicMeshSnapshotPtr snapshot;
+    std::vector<bool>      dirtyVertexPages;
+    std::vector<bool>      dirtyIndexPages;
+    bool                   hasChanges;
+    bool                   isOctreeOutdated;
+
+    Publishing ()
+      : hasChanges (true)
+      , isOctreeOutdated (true)
+    {
+    }
 
-    void deleteAdjacentFace (unsigned int face)
+    static void markPage (std::vector<bool>& pages, unsigned int i)
     {
-      for (auto it = this->adjacentFaces.begin (); it != this->adjacentFaces.end (); ++it)
+      const unsigned int page = i >> DynamicSnapshotPages<glm::vec3>::pageShift;
+
+      if (pages.empty () == false)
       {
-        if (*it == face)
+        if (page >= pages.size ())
         {
-          this->adjacentFaces.erase (it);
-          return;
+          pages.resize (page + 1, false);
         }
+        pages[page] = true;
       }
-      DILAY_IMPOSSIBLE
+    }
+
+    void markVertex (unsigned int i)
+    {
+      if (this->snapshot)
+      {
+        markPage (this->dirtyVertexPages, i);
+        this->hasChanges = true;
+        this->isOctreeOutdated = true;
+      }
+    }
+
+    void markFace (unsigned int i)
+    {
+      if (this->snapshot)
+      {
+        markPage (this->dirtyIndexPages, (3 * i) + 0);
+        markPage (this->dirtyIndexPages, (3 * i) + 2);
+        this->hasChanges = true;
+        this->isOctreeOutdated = true;
+      }
+    }
+
+    // all pages are copied if no page is recorded
+    void markAll ()
+    {
+      this->dirtyVertexPages.clear ();
+      this->dirtyIndexPages.clear ();
+      this->hasChanges = true;
+      this->isOctreeOutdated = true;
+    }
+
+    void clear ()
+    {
+      this->dirtyVertexPages.assign (1, false);
+      this->dirtyIndexPages.assign (1, false);
+      this->hasChanges = false;
     }
   };
 
-  struct FaceData
+  /* Faces whose realignment in the octree is deferred until the octree is queried next.  Queries
+   * may run in parallel, so the pending realignment is applied under a mutex.
+   */
+  struct DeferredRealignment
   {
-    bool isFree;
+    std::vector<unsigned int> faces;
+    std::atomic<bool>         isPending;
+    std::mutex                mutex;
 
-    FaceData () { this->reset (); }
-    void reset () { this->isFree = true; }
+    DeferredRealignment ()
+      : isPending (false)
+    {
+    }
+
+    DeferredRealignment (const DeferredRealignment& other)
+      : faces (other.faces)
+      , isPending (other.isPending.load ())
+    {
+    }
+
+    DeferredRealignment (DeferredRealignment&& other)
+      : faces (std::move (other.faces))
+      , isPending (other.isPending.load ())
+    {
+    }
+  };
+
+  /* Faces of directed edges: the face of the edge `(i1, i2)` contains `i1` and `i2` in this
+   * order.  The lookup is optional: it is maintained while faces are added or deleted, and
+   * rebuilt after bulk changes.
+   */
+  struct EdgeFaces
+  {
+    struct KeyHash
+    {
+      std::size_t operator() (uint64_t key) const { return std::size_t (Hash::mix (key)); }
+    };
+
+    std::unordered_map<uint64_t, unsigned int, KeyHash> faces;
+    bool                                                isUsed;
+
+    EdgeFaces ()
+      : isUsed (false)
+    {
+    }
+
+    static uint64_t key (unsigned int i1, unsigned int i2)
+    {
+      return (uint64_t (i1) << 32) | uint64_t (i2);
+    }
+
+    void add (unsigned int face, unsigned int i1, unsigned int i2, unsigned int i3)
+    {
+      if (this->isUsed)
+      {
+        this->faces[key (i1, i2)] = face;
+        this->faces[key (i2, i3)] = face;
+        this->faces[key (i3, i1)] = face;
+      }
+    }
+
+    void remove (unsigned int face, unsigned int i1, unsigned int i2, unsigned int i3)
+    {
+      const auto removeEdge = [this, face](unsigned int from, unsigned int to) {
+        const auto it = this->faces.find (key (from, to));
+        if (it != this->faces.end () && it->second == face)
+        {
+          this->faces.erase (it);
+        }
+      };
+
+      if (this->isUsed)
+      {
+        removeEdge (i1, i2);
+        removeEdge (i2, i3);
+        removeEdge (i3, i1);
+      }
+    }
+
+    unsigned int face (unsigned int i1, unsigned int i2) const
+    {
+      const auto it = this->faces.find (key (i1, i2));
+      return it == this->faces.end () ? Util::invalidIndex () : it->second;
+    }
+
+    std::size_t numBytes () const
+    {
+      return this->faces.size () * (sizeof (uint64_t) + sizeof (unsigned int) + sizeof (void*)) +
+             this->faces.bucket_count () * sizeof (void*);
+    }
+  };
+
+  /* Faces are rendered in chunks of consecutive faces, which are culled against the view frustum
+   * by their bounds.  The bounds of modified chunks are updated when the mesh is buffered, and
+   * all faces are rendered as long as some bounds are outdated.
+   * Optionally, chunks are divided into clusters of consecutive faces (cf. meshlets), which are
+   * culled by their bounding spheres and by the cones of their normals if they face away from
+   * the eye.  Clusters are updated with their chunks.
+   */
+  struct RenderChunks
+  {
+    static constexpr unsigned int chunkShift = 12;
+    static constexpr unsigned int clusterShift = 7;
+
+    std::vector<glm::vec3>    minima;
+    std::vector<glm::vec3>    maxima;
+    std::vector<bool>         isDirty;
+    std::vector<unsigned int> dirty;
+    bool                      allDirty;
+
+    /* the spheres of clusters, whose radii are negative if they are empty, and the cones of
+     * their normals given by axes and cutoffs, which exceed 1 if clusters can not be culled
+     */
+    bool                   cullClusters;
+    std::vector<glm::vec4> clusterSpheres;
+    std::vector<glm::vec4> clusterCones;
+
+    // ranges of visible chunks, which are culled once per transformation and clip plane
+    mutable glm::mat4x4               culledMvp;
+    mutable glm::vec4                 culledClipPlane;
+    mutable std::vector<unsigned int> visibleFirsts;
+    mutable std::vector<unsigned int> visibleCounts;
+    mutable bool                      isCulled;
+
+    RenderChunks ()
+      : cullClusters (false)
+    {
+      this->reset ();
+    }
+
+    void reset ()
+    {
+      this->minima.clear ();
+      this->maxima.clear ();
+      this->clusterSpheres.clear ();
+      this->clusterCones.clear ();
+      this->isDirty.clear ();
+      this->dirty.clear ();
+      this->allDirty = true;
+      this->isCulled = false;
+    }
+
+    void markFace (unsigned int face)
+    {
+      const unsigned int chunk = face >> chunkShift;
+
+      if (chunk >= this->isDirty.size ())
+      {
+        this->isDirty.resize (chunk + 1, false);
+      }
+      if (this->isDirty[chunk] == false)
+      {
+        this->isDirty[chunk] = true;
+        this->dirty.push_back (chunk);
+      }
+    }
+
+    void markAll () { this->allDirty = true; }
+
+    bool hasDirty () const { return this->allDirty || this->dirty.empty () == false; }
+  };
+
+  /* The faces whose geometry has changed since the mesh was sanitized, which are refitted in the
+   * bounding volume hierarchy instead of refitting it as a whole.  The region is dropped once it
+   * exceeds a fraction of the mesh or the geometry of the whole mesh changes.
+   */
+  struct ChangedRegion
+  {
+    static constexpr unsigned int maxFraction = 8;
+
+    bool                      isWhole;
+    std::vector<unsigned int> faces;
+
+    ChangedRegion ()
+      : isWhole (false)
+    {
+    }
+
+    void add (unsigned int face, unsigned int numFaces)
+    {
+      if (this->isWhole == false)
+      {
+        if (maxFraction * this->faces.size () >= numFaces)
+        {
+          this->markAll ();
+        }
+        else
+        {
+          this->faces.push_back (face);
+        }
+      }
+    }
+
+    void markAll ()
+    {
+      this->isWhole = true;
+      this->faces.clear ();
+    }
+
+    void clear ()
+    {
+      this->isWhole = false;
+      this->faces.clear ();
+    }
+  };
+
+  /* The faces that have been modified during a stroke, i.e., the faces that have been added or
+   * deleted and the faces that are adjacent to vertices whose positions or normals have changed.
+   * The buffered mesh is not uploaded while a stroke is active.  Instead, the faces of the region
+   * are masked by rendering the index ranges between them, and the region itself is copied into
+   * a small batch, which is uploaded completely whenever the mesh is buffered.
+   */
+  struct StrokeRegion
+  {
+    // larger regions are merged back into the buffered mesh
+    static constexpr unsigned int maxNumFaces = 1 << 16;
+
+    bool                      isActive;
+    bool                      isBuffered;
+    std::vector<bool>         hasFace;
+    std::vector<bool>         hasVertex;
+    std::vector<unsigned int> faces;
+    std::vector<unsigned int> firsts;
+    std::vector<unsigned int> counts;
+    Mesh                      batch;
+
+    StrokeRegion ()
+      : isActive (false)
+      , isBuffered (false)
+    {
+    }
+
+    void clear ()
+    {
+      this->isBuffered = false;
+      this->hasFace.clear ();
+      this->hasVertex.clear ();
+      this->faces.clear ();
+      this->firsts.clear ();
+      this->counts.clear ();
+    }
+
+    void addFace (unsigned int face)
+    {
+      if (face >= this->hasFace.size ())
+      {
+        this->hasFace.resize (face + 1, false);
+      }
+      if (this->hasFace[face] == false)
+      {
+        this->hasFace[face] = true;
+        this->faces.push_back (face);
+      }
+    }
+
+    // returns true if the vertex has not been added before
+    bool addVertex (unsigned int vertex)
+    {
+      if (vertex >= this->hasVertex.size ())
+      {
+        this->hasVertex.resize (vertex + 1, false);
+      }
+      if (this->hasVertex[vertex] == false)
+      {
+        this->hasVertex[vertex] = true;
+        return true;
+      }
+      return false;
+    }
+
+    // computes the index ranges of the given number of faces without the faces of the region
+    void updateRanges (unsigned int numFaces)
+    {
+      std::sort (this->faces.begin (), this->faces.end ());
+
+      this->firsts.clear ();
+      this->counts.clear ();
+
+      unsigned int begin = 0;
+      for (unsigned int f : this->faces)
+      {
+        if (f > begin)
+        {
+          this->firsts.push_back (3 * begin);
+          this->counts.push_back (3 * (f - begin));
+        }
+        begin = f + 1;
+      }
+      if (numFaces > begin)
+      {
+        this->firsts.push_back (3 * begin);
+        this->counts.push_back (3 * (numFaces - begin));
+      }
+    }
+
+    std::size_t numBytes () const
+    {
+      return ((this->hasFace.capacity () + this->hasVertex.capacity ()) / 8) +
+             ((this->faces.capacity () + this->firsts.capacity () + this->counts.capacity ()) *
+              sizeof (unsigned int)) +
+             this->batch.numBytes ();
+    }
   };
+
+  constexpr unsigned int compactionGrainSize = 1 << 12;
+  // more deferred normals are updated on the CPU
+  constexpr unsigned int maxGpuNormals = 1 << 16;
+  constexpr unsigned int vertexCacheSize = 16;
+
+  /* Maps the kept elements of [0, n) to consecutive indices in their order and all others to
+   * `Util::invalidIndex ()`.  Blocks of elements are counted in parallel and offset by the
+   * prefix sums of their counts.  Returns the number of kept elements.
+   */
+  template <typename F>
+  unsigned int compactionMap (unsigned int n, std::vector<unsigned int>& map, const F& isKept)
+  {
+    const unsigned int        numBlocks = (n + compactionGrainSize - 1) / compactionGrainSize;
+    std::vector<unsigned int> offsets (numBlocks + 1, 0);
+
+    map.resize (n);
+    Parallel::forEach (numBlocks, [n, &map, &offsets, &isKept](unsigned int b) {
+      const unsigned int end = glm::min (n, (b + 1) * compactionGrainSize);
+      unsigned int       count = 0;
+
+      for (unsigned int i = b * compactionGrainSize; i < end; i++)
+      {
+        map[i] = isKept (i) ? count++ : Util::invalidIndex ();
+      }
+      offsets[b + 1] = count;
+    });
+
+    for (unsigned int b = 0; b < numBlocks; b++)
+    {
+      offsets[b + 1] += offsets[b];
+    }
+
+    Parallel::forEach (numBlocks, [n, &map, &offsets](unsigned int b) {
+      const unsigned int end = glm::min (n, (b + 1) * compactionGrainSize);
+
+      for (unsigned int i = b * compactionGrainSize; i < end; i++)
+      {
+        if (map[i] != Util::invalidIndex ())
+        {
+          map[i] += offsets[b];
+        }
+      }
+    });
+    return offsets.back ();
+  }
+
+  // a box is culled if it lies completely outside of one of the planes of a frustum
+  bool isInFrustum (const glm::vec4 (&planes)[6], const glm::vec3& min, const glm::vec3& max)
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      const glm::vec3 p (plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y,
+                         plane.z >= 0.0f ? max.z : min.z);
+
+      if ((plane.x * p.x) + (plane.y * p.y) + (plane.z * p.z) + plane.w < 0.0f)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // a sphere is culled like a box, i.e., `planes` need not be normalized
+  bool isInFrustum (const glm::vec4 (&planes)[6], const glm::vec4& sphere)
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      const glm::vec3 n (plane);
+
+      if (glm::dot (n, glm::vec3 (sphere)) + plane.w < -sphere.w * glm::length (n))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // a box is clipped if it lies completely in front of a clip plane (cf. `DynamicMesh::clipPlane`)
+  bool isClipped (const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max)
+  {
+    const glm::vec3 p (plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y,
+                       plane.z >= 0.0f ? min.z : max.z);
+
+    return (plane.x * p.x) + (plane.y * p.y) + (plane.z * p.z) + plane.w > 0.0f;
+  }
+
+  bool isClipped (const glm::vec4& plane, const glm::vec4& sphere)
+  {
+    const glm::vec3 n (plane);
+
+    return glm::dot (n, glm::vec3 (sphere)) + plane.w > sphere.w * glm::length (n);
+  }
+
+  /* A cluster faces away from an eye if all its faces do so from all points of its bounding
+   * sphere (cf. the cone culling of meshoptimizer).
+   */
+  bool isBackFacing (const glm::vec4& sphere, const glm::vec4& cone, const glm::vec3& eye)
+  {
+    const glm::vec3 d = glm::vec3 (sphere) - eye;
+
+    return glm::dot (d, glm::vec3 (cone)) >= (cone.w * glm::length (d)) + sphere.w;
+  }
 }
 
 struct DynamicMesh::Impl
 {
-  DynamicMesh*               self;
-  Mesh                       mesh;
-  std::vector<VertexData>    vertexData;
-  std::vector<unsigned char> vertexVisited;
-  std::vector<unsigned int>  freeVertexIndices;
-  std::vector<FaceData>      faceData;
-  std::vector<unsigned char> faceVisited;
-  std::vector<unsigned int>  freeFaceIndices;
-  DynamicOctree              octree;
+  DynamicMesh*                           self;
+  Mesh                                   mesh;
+  std::vector<VertexData>                vertexData;
+  // the freeze mask of a compact mesh, which is empty if no vertex is frozen
+  std::vector<bool>                      compactFrozen;
+  CopyOnWrite<std::vector<unsigned int>> adjacency;
+  unsigned int                           numUnusedAdjacency;
+  std::vector<unsigned int>              freeVertexIndices;
+  std::vector<FaceData>                  faceData;
+  std::vector<unsigned int>              freeFaceIndices;
+  mutable DynamicOctree                  octree;
+  mutable DynamicVisitedPool             visitedPool;
+  mutable DeferredRealignment            deferredRealignment;
+  std::vector<unsigned int>              deferredNormals;
+  std::vector<glm::vec3>                 faceNormals;
+  Bvh                                    bvh;
+  std::vector<unsigned int>              bvhFaces;
+  bool                                   useBvh;
+  bool                                   isBvhValid;
+  bool                                   canRefitBvh;
+  ChangedRegion                          changedRegion;
+  unsigned int                           topologyRevision;
+  mutable DynamicDistanceCache           distanceCache;
+  bool                                   useDistanceCache;
+  bool                                   reorderOnPrune;
+  bool                                   optimizeIndexOrder;
+  Tracking                               tracking;
+  Publishing                             publishing;
+  mutable MaybeInline<PrimAABox>         _bounds;
+  RenderChunks                           renderChunks;
+  StrokeRegion                           strokeRegion;
+  bool                                   isStroking;
+  bool                                   useGpuNormals;
+  EdgeFaces                              edgeFaces;
+  unsigned int                           lastHitFace;
+  std::vector<unsigned int>              hintFaces;
+  mutable DynamicLodProxy                lodProxy;
+  DynamicMeshLayers                      layers;
+  // points `p` with `dot (clipEquation, vec4 (p, 1))` > 0 are clipped, i.e., zero clips none
+  glm::vec4                              clipEquation;
 
   Impl (DynamicMesh* s)
     : self (s)
+    , numUnusedAdjacency (0)
+    , useBvh (false)
+    , isBvhValid (false)
+    , canRefitBvh (false)
+    , topologyRevision (0)
+    , useDistanceCache (false)
+    , reorderOnPrune (false)
+    , optimizeIndexOrder (false)
+    , isStroking (false)
+    , useGpuNormals (false)
+    , lastHitFace (Util::invalidIndex ())
+    , clipEquation (0.0f)
   {
   }
 
   Impl (DynamicMesh* s, const Mesh& m)
     : self (s)
+    , numUnusedAdjacency (0)
+    , useBvh (false)
+    , isBvhValid (false)
+    , canRefitBvh (false)
+    , topologyRevision (0)
+    , useDistanceCache (false)
+    , reorderOnPrune (false)
+    , optimizeIndexOrder (false)
+    , isStroking (false)
+    , useGpuNormals (false)
+    , lastHitFace (Util::invalidIndex ())
+    , clipEquation (0.0f)
   {
     this->fromMesh (m);
   }
 
+  Impl (DynamicMesh* s, const std::vector<glm::vec3>& vertices,
+        const std::vector<unsigned int>& indices)
+    : self (s)
+    , numUnusedAdjacency (0)
+    , useBvh (false)
+    , isBvhValid (false)
+    , canRefitBvh (false)
+    , topologyRevision (0)
+    , useDistanceCache (false)
+    , reorderOnPrune (false)
+    , optimizeIndexOrder (false)
+    , isStroking (false)
+    , useGpuNormals (false)
+    , lastHitFace (Util::invalidIndex ())
+    , clipEquation (0.0f)
+  {
+    this->fromArrays (vertices, indices);
+    this->mesh.bufferData ();
+  }
+
   unsigned int numVertices () const
   {
+    if (this->isCompact ())
+    {
+      return this->mesh.numVertices ();
+    }
     assert (this->mesh.numVertices () >= this->freeVertexIndices.size ());
     assert (this->mesh.numVertices () == this->vertexData.size ());
     return this->mesh.numVertices () - this->freeVertexIndices.size ();
@@ -93,6 +707,10 @@ struct DynamicMesh::Impl
 
   unsigned int numFaces () const
   {
+    if (this->isCompact ())
+    {
+      return this->mesh.numIndices () / 3;
+    }
     assert (this->faceData.size () >= this->freeFaceIndices.size ());
     return this->faceData.size () - this->freeFaceIndices.size ();
   }
@@ -105,6 +723,19 @@ struct DynamicMesh::Impl
     return this->vertexData[i].isFree;
   }
 
+  bool isFrozen (unsigned int i) const
+  {
+    assert (i < this->vertexData.size ());
+    return this->vertexData[i].isFrozen;
+  }
+
+  // the mask is not tracked, since it does not change the mesh
+  void freeze (unsigned int i, bool value)
+  {
+    assert (this->isFreeVertex (i) == false);
+    this->vertexData[i].isFrozen = value;
+  }
+
   bool isFreeFace (unsigned int i) const
   {
     assert (i < this->faceData.size ());
@@ -116,31 +747,84 @@ struct DynamicMesh::Impl
     return this->freeFaceIndices.empty () && this->freeVertexIndices.empty ();
   }
 
-  unsigned int valence (unsigned int i) const
+  void trackVertex (unsigned int i)
   {
-    assert (this->isFreeVertex (i) == false);
-    return this->vertexData[i].adjacentFaces.size ();
+    this->publishing.markVertex (i);
+
+    if (this->tracking.changes && this->tracking.changes->hasVertex (i) == false)
+    {
+      this->tracking.changes->addVertex (i, this->vertexData[i].isFree, this->mesh.vertex (i),
+                                         this->mesh.normal (i));
+    }
   }
 
-  void vertexIndices (unsigned int i, unsigned int& i1, unsigned int& i2, unsigned int& i3) const
+  void trackFace (unsigned int i)
   {
-    assert (this->isFreeFace (i) == false);
+    this->publishing.markFace (i);
 
-    i1 = this->mesh.index ((3 * i) + 0);
-    i2 = this->mesh.index ((3 * i) + 1);
-    i3 = this->mesh.index ((3 * i) + 2);
+    if (this->tracking.changes && this->tracking.changes->hasFace (i) == false)
+    {
+      this->tracking.changes->addFace (i, this->faceData[i].isFree, this->mesh.index ((3 * i) + 0),
+                                       this->mesh.index ((3 * i) + 1),
+                                       this->mesh.index ((3 * i) + 2));
+    }
   }
 
-  PrimTriangle face (unsigned int i) const
+  void trackAllVertices ()
   {
-    assert (this->isFreeFace (i) == false);
+    this->publishing.markAll ();
 
-    return PrimTriangle (this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
-                         this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
-                         this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
+    if (this->tracking.changes)
+    {
+      for (unsigned int i = 0; i < this->vertexData.size (); i++)
+      {
+        this->trackVertex (i);
+      }
+    }
   }
 
-  const glm::vec3& vertexNormal (unsigned int i) const { return this->mesh.normal (i); }
+  void trackAllFaces ()
+  {
+    this->publishing.markAll ();
+
+    if (this->tracking.changes)
+    {
+      for (unsigned int i = 0; i < this->faceData.size (); i++)
+      {
+        this->trackFace (i);
+      }
+    }
+  }
+
+  unsigned int valence (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    return this->vertexData[i].numAdjacent;
+  }
+
+  void vertexIndices (unsigned int i, unsigned int& i1, unsigned int& i2, unsigned int& i3) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    i1 = this->mesh.index ((3 * i) + 0);
+    i2 = this->mesh.index ((3 * i) + 1);
+    i3 = this->mesh.index ((3 * i) + 2);
+  }
+
+  PrimTriangle face (unsigned int i) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    return PrimTriangle (this->mesh.vertex (this->mesh.index ((3 * i) + 0)),
+                         this->mesh.vertex (this->mesh.index ((3 * i) + 1)),
+                         this->mesh.vertex (this->mesh.index ((3 * i) + 2)));
+  }
+
+  const glm::vec3& vertexNormal (unsigned int i) const
+  {
+    assert (this->deferredNormals.empty ());
+    return this->mesh.normal (i);
+  }
 
   glm::vec3 faceNormal (unsigned int i) const
   {
@@ -149,855 +833,3410 @@ struct DynamicMesh::Impl
     unsigned int i1, i2, i3;
     this->vertexIndices (i, i1, i2, i3);
 
-    return glm::normalize (glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                                       this->mesh.vertex (i3) - this->mesh.vertex (i1)));
+    return glm::normalize (glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                                       this->mesh.vertex (i3) - this->mesh.vertex (i1)));
+  }
+
+  void findAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
+                     unsigned int& leftVertex, unsigned int& rightFace,
+                     unsigned int& rightVertex) const
+  {
+    assert (this->isFreeVertex (e1) == false);
+    assert (this->isFreeVertex (e2) == false);
+
+    leftFace = Util::invalidIndex ();
+    leftVertex = Util::invalidIndex ();
+    rightFace = Util::invalidIndex ();
+    rightVertex = Util::invalidIndex ();
+
+    if (this->edgeFaces.isUsed)
+    {
+      leftFace = this->edgeFaces.face (e1, e2);
+      rightFace = this->edgeFaces.face (e2, e1);
+      leftVertex = this->otherVertex (leftFace, e1, e2);
+      rightVertex = this->otherVertex (rightFace, e1, e2);
+    }
+    else
+    {
+      this->scanAdjacent (e1, e2, leftFace, leftVertex, rightFace, rightVertex);
+    }
+    assert (leftFace != Util::invalidIndex ());
+    assert (leftVertex != Util::invalidIndex ());
+    assert (rightFace != Util::invalidIndex ());
+    assert (rightVertex != Util::invalidIndex ());
+  }
+
+  // returns the vertex of a face that is neither `e1` nor `e2`
+  unsigned int otherVertex (unsigned int face, unsigned int e1, unsigned int e2) const
+  {
+    if (face == Util::invalidIndex ())
+    {
+      return Util::invalidIndex ();
+    }
+    unsigned int i1, i2, i3;
+    this->vertexIndices (face, i1, i2, i3);
+
+    return i1 != e1 && i1 != e2 ? i1 : (i2 != e1 && i2 != e2 ? i2 : i3);
+  }
+
+  void scanAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
+                     unsigned int& leftVertex, unsigned int& rightFace,
+                     unsigned int& rightVertex) const
+  {
+    for (unsigned int a : this->adjacentFaces (e1))
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (a, i1, i2, i3);
+
+      if (e1 == i1 && e2 == i2)
+      {
+        leftFace = a;
+        leftVertex = i3;
+      }
+      else if (e1 == i2 && e2 == i1)
+      {
+        rightFace = a;
+        rightVertex = i3;
+      }
+      else if (e1 == i2 && e2 == i3)
+      {
+        leftFace = a;
+        leftVertex = i1;
+      }
+      else if (e1 == i3 && e2 == i2)
+      {
+        rightFace = a;
+        rightVertex = i1;
+      }
+      else if (e1 == i3 && e2 == i1)
+      {
+        leftFace = a;
+        leftVertex = i2;
+      }
+      else if (e1 == i1 && e2 == i3)
+      {
+        rightFace = a;
+        rightVertex = i2;
+      }
+    }
+  }
+
+  DynamicAdjacentFaces adjacentFaces (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    return this->adjacentFaces (this->vertexData[i]);
+  }
+
+  DynamicAdjacentFaces adjacentFaces (const VertexData& d) const
+  {
+    assert (d.adjacentOffset + d.adjacentCapacity <= this->adjacency->size ());
+    return DynamicAdjacentFaces (this->adjacency->data () + d.adjacentOffset, d.numAdjacent);
+  }
+
+  void addAdjacentFace (unsigned int i, unsigned int face)
+  {
+    DILAY_ALLOCATION_SCOPE ("adjacency");
+
+    if (this->vertexData[i].numAdjacent == this->vertexData[i].adjacentCapacity)
+    {
+      if (2 * this->numUnusedAdjacency > this->adjacency->size ())
+      {
+        this->compactAdjacency ();
+      }
+
+      VertexData& d = this->vertexData[i];
+      if (d.numAdjacent == d.adjacentCapacity)
+      {
+        std::vector<unsigned int>& adjacency = this->adjacency.write ();
+        const unsigned int         offset = adjacency.size ();
+
+        adjacency.resize (offset + glm::max (minAdjacentCapacity, 2 * d.adjacentCapacity));
+        std::copy (adjacency.begin () + d.adjacentOffset,
+                   adjacency.begin () + d.adjacentOffset + d.numAdjacent,
+                   adjacency.begin () + offset);
+
+        this->numUnusedAdjacency += d.adjacentCapacity;
+        d.adjacentOffset = offset;
+        d.adjacentCapacity = adjacency.size () - offset;
+      }
+    }
+    VertexData& d = this->vertexData[i];
+    this->adjacency.write ()[d.adjacentOffset + d.numAdjacent] = face;
+    d.numAdjacent++;
+  }
+
+  void deleteAdjacentFace (unsigned int i, unsigned int face)
+  {
+    VertexData& d = this->vertexData[i];
+
+    const auto begin = this->adjacency.write ().begin () + d.adjacentOffset;
+    const auto end = begin + d.numAdjacent;
+    const auto it = std::find (begin, end, face);
+
+    if (it == end)
+    {
+      DILAY_IMPOSSIBLE
+    }
+    std::copy (it + 1, end, it);
+    d.numAdjacent--;
+  }
+
+  void reserveAdjacency (const std::vector<unsigned int>& valences)
+  {
+    assert (valences.size () == this->vertexData.size ());
+
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      VertexData& d = this->vertexData[i];
+
+      assert (d.numAdjacent == 0);
+      d.adjacentOffset = offset;
+      d.adjacentCapacity = adjacentCapacity (valences[i]);
+      offset += d.adjacentCapacity;
+    }
+    this->adjacency.reset ();
+    this->adjacency.write ().resize (offset);
+    this->numUnusedAdjacency = 0;
+  }
+
+  void compactAdjacency ()
+  {
+    DILAY_ALLOCATION_SCOPE ("adjacency");
+
+    std::vector<unsigned int> compacted;
+    compacted.reserve (this->adjacency->size () - this->numUnusedAdjacency);
+
+    for (VertexData& d : this->vertexData)
+    {
+      const unsigned int offset = compacted.size ();
+
+      compacted.insert (compacted.end (), this->adjacency->begin () + d.adjacentOffset,
+                        this->adjacency->begin () + d.adjacentOffset + d.numAdjacent);
+      compacted.resize (offset + (d.isFree ? 0 : adjacentCapacity (d.numAdjacent)));
+
+      d.adjacentOffset = offset;
+      d.adjacentCapacity = compacted.size () - offset;
+    }
+    this->adjacency.reset ();
+    this->adjacency.write () = std::move (compacted);
+    this->numUnusedAdjacency = 0;
+  }
+
+  unsigned int vertexCapacity () const { return this->vertexData.size (); }
+
+  unsigned int faceCapacity () const { return this->faceData.size (); }
+
+  // cf. DynamicMesh::forEachVertex and DynamicMesh::forEachFace, which need a constructed mesh
+  template <typename F> void forEachVertex (const F& f) const
+  {
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      if (this->vertexData[i].isFree == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  template <typename F> void forEachFace (const F& f) const
+  {
+    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    {
+      if (this->faceData[i].isFree == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  // each traversal marks the elements it visited in marks of its own, cf. DynamicVisitedPool
+  DynamicVisitedPool::Scope vertexMarks () const
+  {
+    return DynamicVisitedPool::Scope (this->visitedPool, this->vertexData.size ());
+  }
+
+  DynamicVisitedPool::Scope faceMarks () const
+  {
+    return DynamicVisitedPool::Scope (this->visitedPool, this->faceData.size ());
+  }
+
+  template <typename F>
+  void visitVertices (unsigned int i, DynamicVisited& vertexVisited, const F& f) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    if (vertexVisited.visit (i1))
+    {
+      f (i1);
+    }
+    if (vertexVisited.visit (i2))
+    {
+      f (i2);
+    }
+    if (vertexVisited.visit (i3))
+    {
+      f (i3);
+    }
+  }
+
+  std::vector<unsigned int> vertices (const DynamicFaces& faces) const
+  {
+    std::vector<unsigned int> vertices;
+
+    const DynamicVisitedPool::Scope vertexVisited = this->vertexMarks ();
+
+    for (unsigned int i : faces)
+    {
+      this->visitVertices (i, *vertexVisited,
+                           [&vertices](unsigned int j) { vertices.push_back (j); });
+    }
+    return vertices;
+  }
+
+  std::vector<unsigned int> verticesExt (const DynamicFaces& faces) const
+  {
+    std::vector<unsigned int> vertices;
+
+    const auto visit = [&vertices](unsigned int j) { vertices.push_back (j); };
+
+    const DynamicVisitedPool::Scope vertexVisited = this->vertexMarks ();
+    const DynamicVisitedPool::Scope faceVisited = this->faceMarks ();
+
+    for (unsigned int i : faces)
+    {
+      this->visitVertices (i, *vertexVisited, [&](unsigned int j) {
+        vertices.push_back (j);
+
+        for (unsigned int a : this->adjacentFaces (j))
+        {
+          if (faceVisited->isVisited (a) == false)
+          {
+            this->visitVertices (a, *vertexVisited, visit);
+            faceVisited->visit (a);
+          }
+        }
+      });
+      faceVisited->visit (i);
+    }
+    return vertices;
+  }
+
+  void forEachFaceExt (const DynamicFaces&                       faces,
+                       const std::function<void(unsigned int)>& f) const
+  {
+    const DynamicVisitedPool::Scope vertexVisited = this->vertexMarks ();
+    const DynamicVisitedPool::Scope faceVisited = this->faceMarks ();
+
+    for (unsigned int i : faces)
+    {
+      if (faceVisited->visit (i))
+      {
+        f (i);
+      }
+      this->visitVertices (i, *vertexVisited, [this, &f, &faceVisited](unsigned int j) {
+        for (unsigned int a : this->adjacentFaces (j))
+        {
+          if (faceVisited->visit (a))
+          {
+            f (a);
+          }
+        }
+      });
+    }
+  }
+
+  void average (const DynamicFaces& faces, glm::vec3& position, glm::vec3& normal) const
+  {
+    assert (faces.numElements () > 0);
+
+    position = glm::vec3 (0.0f);
+    normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      position += this->mesh.vertex (i1);
+      position += this->mesh.vertex (i2);
+      position += this->mesh.vertex (i3);
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    position /= float(faces.numElements () * 3);
+    normal = glm::normalize (normal);
+  }
+
+  glm::vec3 averagePosition (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    glm::vec3 position = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      this->self->forEachVertexAdjacentToFace (
+        f, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
+    }
+    return position / float(faces.numElements () * 3);
+  }
+
+  glm::vec3 averagePosition (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->vertexData[i].numAdjacent > 0);
+
+    glm::vec3 position = glm::vec3 (0.0f);
+
+    this->self->forEachVertexAdjacentToVertex (
+      i, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
+    return position / float(this->vertexData[i].numAdjacent);
+  }
+
+  glm::vec3 averageNormal (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    glm::vec3 normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : faces)
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    return glm::normalize (normal);
+  }
+
+  glm::vec3 averageNormal (unsigned int i) const
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->vertexData[i].numAdjacent > 0);
+
+    glm::vec3 normal = glm::vec3 (0.0f);
+
+    for (unsigned int f : this->adjacentFaces (i))
+    {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    }
+    return glm::normalize (normal);
+  }
+
+  float averageEdgeLengthSqr (const DynamicFaces& faces) const
+  {
+    assert (faces.numElements () > 0);
+
+    float length = 0.0f;
+    for (unsigned int i : faces)
+    {
+      length += this->averageEdgeLengthSqr (i);
+    }
+    return length / float(faces.numElements ());
+  }
+
+  float averageEdgeLengthSqr (unsigned int i) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    const glm::vec3& v1 = this->mesh.vertex (i1);
+    const glm::vec3& v2 = this->mesh.vertex (i2);
+    const glm::vec3& v3 = this->mesh.vertex (i3);
+
+    return (glm::distance2 (v1, v2) + glm::distance2 (v1, v3) + glm::distance2 (v2, v3)) / 3.0f;
+  }
+
+  unsigned int addVertex (const glm::vec3& vertex, const glm::vec3& normal)
+  {
+    assert (this->vertexData.size () == this->mesh.numVertices ());
+
+    if (this->freeVertexIndices.empty ())
+    {
+      this->vertexData.emplace_back ();
+      this->vertexData.back ().isFree = false;
+      return this->mesh.addVertex (vertex, normal);
+    }
+    else
+    {
+      const unsigned int index = this->freeVertexIndices.back ();
+      this->trackVertex (index);
+      this->mesh.vertex (index, vertex);
+      this->mesh.normal (index, normal);
+      this->vertexData[index].reset ();
+      this->vertexData[index].isFree = false;
+      this->freeVertexIndices.pop_back ();
+      return index;
+    }
+  }
+
+  unsigned int addFace (unsigned int i1, unsigned int i2, unsigned int i3)
+  {
+    const unsigned int index = this->addFaceWithoutOctree (i1, i2, i3);
+
+    this->addFaceToOctree (index);
+    return index;
+  }
+
+  unsigned int addFaceWithoutOctree (unsigned int i1, unsigned int i2, unsigned int i3)
+  {
+    assert (i1 < this->mesh.numVertices ());
+    assert (i2 < this->mesh.numVertices ());
+    assert (i3 < this->mesh.numVertices ());
+    assert (3 * this->faceData.size () == this->mesh.numIndices ());
+
+    unsigned int index = Util::invalidIndex ();
+
+    if (this->freeFaceIndices.empty ())
+    {
+      index = this->numFaces ();
+      this->faceData.emplace_back ();
+
+      this->mesh.addIndex (i1);
+      this->mesh.addIndex (i2);
+      this->mesh.addIndex (i3);
+    }
+    else
+    {
+      index = this->freeFaceIndices.back ();
+      this->trackFace (index);
+      this->faceData[index].reset ();
+      this->freeFaceIndices.pop_back ();
+
+      this->mesh.index ((3 * index) + 0, i1);
+      this->mesh.index ((3 * index) + 1, i2);
+      this->mesh.index ((3 * index) + 2, i3);
+    }
+    this->faceData[index].isFree = false;
+    this->renderChunks.markFace (index);
+    this->addToStrokeRegion (index);
+    this->edgeFaces.add (index, i1, i2, i3);
+
+    this->addAdjacentFace (i1, index);
+    this->addAdjacentFace (i2, index);
+    this->addAdjacentFace (i3, index);
+    this->changeDistances (index);
+    this->invalidateGeometry (false);
+
+    return index;
+  }
+
+  void addFaceToOctree (unsigned int i)
+  {
+    const PrimTriangle tri = this->face (i);
+
+    if (this->octree.hasRoot () == false)
+    {
+      this->octree.setupRoot (tri.center (), tri.maxDimExtent ());
+    }
+
+    this->octree.addElement (i, tri.center (), tri.maxDimExtent ());
+  }
+
+  // rebuilds the octree in bulk, which is faster than inserting faces one by one
+  void allCenterAndExtents (std::vector<unsigned int>& faces,
+                            std::vector<glm::vec4>&    centerAndExtents) const
+  {
+    faces.reserve (this->numFaces ());
+    this->forEachFace ([&faces](unsigned int i) { faces.push_back (i); });
+
+    centerAndExtents.resize (faces.size ());
+    Parallel::forEach (faces.size (), [this, &faces, &centerAndExtents](unsigned int i) {
+      const PrimTriangle tri = this->face (faces[i]);
+      centerAndExtents[i] = glm::vec4 (tri.center (), tri.maxDimExtent ());
+    });
+  }
+
+  void buildOctree ()
+  {
+    std::vector<unsigned int> faces;
+    std::vector<glm::vec4>    centerAndExtents;
+
+    this->allCenterAndExtents (faces, centerAndExtents);
+    this->octree.build (faces, centerAndExtents);
+    this->discardDeferredRealignment ();
+    this->renderChunks.markAll ();
+  }
+
+  // the hierarchy can be refitted as long as the set of faces remains the same
+  void invalidateGeometry (bool hasSameFaces)
+  {
+    this->_bounds.reset ();
+    this->isBvhValid = false;
+    this->canRefitBvh = this->canRefitBvh && hasSameFaces;
+    this->changedRegion.markAll ();
+
+    if (hasSameFaces == false)
+    {
+      this->topologyRevision++;
+    }
+  }
+
+  // invalidates the geometry of a face whose vertices have moved
+  void invalidateFaceGeometry (unsigned int face)
+  {
+    this->_bounds.reset ();
+    this->isBvhValid = false;
+    this->changedRegion.add (face, this->faceData.size ());
+  }
+
+  void changeDistances (unsigned int face)
+  {
+    if (this->distanceCache.isEmpty () == false)
+    {
+      this->distanceCache.addChange (this->mesh.vertex (this->mesh.index ((3 * face) + 0)));
+      this->distanceCache.addChange (this->mesh.vertex (this->mesh.index ((3 * face) + 1)));
+      this->distanceCache.addChange (this->mesh.vertex (this->mesh.index ((3 * face) + 2)));
+    }
+  }
+
+  void deleteVertex (unsigned int i)
+  {
+    assert (i < this->vertexData.size ());
+
+    const DynamicAdjacentFaces      adjacent = this->adjacentFaces (this->vertexData[i]);
+    const std::vector<unsigned int> adjacentFaces (adjacent.begin (), adjacent.end ());
+    for (unsigned int f : adjacentFaces)
+    {
+      this->deleteFace (f);
+    }
+    this->trackVertex (i);
+    this->vertexData[i].reset ();
+    this->freeVertexIndices.push_back (i);
+    this->layers.deleteVertex (i);
+  }
+
+  void addToStrokeRegion (unsigned int face)
+  {
+    if (this->strokeRegion.isActive)
+    {
+      this->strokeRegion.addFace (face);
+    }
+  }
+
+  // faces that are added to the vertex later are added to the region by themselves
+  void addVertexToStrokeRegion (unsigned int i)
+  {
+    if (this->strokeRegion.isActive && this->strokeRegion.addVertex (i))
+    {
+      for (unsigned int f : this->adjacentFaces (this->vertexData[i]))
+      {
+        this->strokeRegion.addFace (f);
+      }
+    }
+  }
+
+  // the mesh must have been buffered before a stroke begins
+  void beginStroke (bool separateRegion)
+  {
+    this->isStroking = true;
+    this->strokeRegion.isActive = separateRegion;
+  }
+
+  void endStroke ()
+  {
+    this->isStroking = false;
+    this->strokeRegion.isActive = false;
+
+    if (this->strokeRegion.faces.empty () == false || this->deferredNormals.empty () == false)
+    {
+      this->bufferData ();
+    }
+    this->strokeRegion.clear ();
+  }
+
+  void deleteFace (unsigned int i)
+  {
+    assert (i < this->faceData.size ());
+
+    this->trackFace (i);
+    this->changeDistances (i);
+    this->addToStrokeRegion (i);
+    this->edgeFaces.remove (i, this->mesh.index ((3 * i) + 0), this->mesh.index ((3 * i) + 1),
+                            this->mesh.index ((3 * i) + 2));
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 0), i);
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 1), i);
+    this->deleteAdjacentFace (this->mesh.index ((3 * i) + 2), i);
+
+    this->faceData[i].reset ();
+    this->freeFaceIndices.push_back (i);
+    this->octree.deleteElement (i);
+    this->invalidateGeometry (false);
+  }
+
+  void vertex (unsigned int i, const glm::vec3& v)
+  {
+    assert (i < this->vertexData.size ());
+
+    this->trackVertex (i);
+    this->addVertexToStrokeRegion (i);
+
+    if (this->distanceCache.isEmpty () == false)
+    {
+      for (unsigned int f : this->adjacentFaces (this->vertexData[i]))
+      {
+        this->changeDistances (f);
+      }
+      this->distanceCache.addChange (v);
+    }
+    this->mesh.vertex (i, v);
+  }
+
+  void vertexNormal (unsigned int i, const glm::vec3& n)
+  {
+    assert (this->isFreeVertex (i) == false);
+    assert (this->mesh.numVertices () == this->vertexData.size ());
+
+    this->trackVertex (i);
+    this->addVertexToStrokeRegion (i);
+    this->mesh.normal (i, n);
+  }
+
+  void setVertexNormal (unsigned int i)
+  {
+    const glm::vec3 avg = this->averageNormal (i);
+
+    this->trackVertex (i);
+    this->addVertexToStrokeRegion (i);
+
+    if (Util::isNaN (avg))
+    {
+      this->mesh.normal (i, glm::vec3 (0.0f));
+    }
+    else
+    {
+      this->mesh.normal (i, avg);
+    }
+  }
+
+  /* Like `setVertexNormals`, but the normal of each face is computed once into the scratch array
+   * of face normals instead of once per adjacent vertex.
+   */
+  void setAllNormals ()
+  {
+    std::vector<glm::vec3> normals (this->vertexData.size (), glm::vec3 (0.0f));
+
+    this->faceNormals.resize (this->faceData.size ());
+    Parallel::forEach (this->faceData.size (), [this](unsigned int i) {
+      if (this->isFreeFace (i) == false)
+      {
+        unsigned int i1, i2, i3;
+        this->vertexIndices (i, i1, i2, i3);
+
+        this->faceNormals[i] = glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                                           this->mesh.vertex (i3) - this->mesh.vertex (i1));
+      }
+    });
+    Parallel::forEach (this->vertexData.size (), [this, &normals](unsigned int i) {
+      if (this->isFreeVertex (i) == false)
+      {
+        glm::vec3 normal (0.0f);
+
+        for (unsigned int f : this->adjacentFaces (i))
+        {
+          normal += this->faceNormals[f];
+        }
+        normal = glm::normalize (normal);
+        normals[i] = Util::isNaN (normal) ? glm::vec3 (0.0f) : normal;
+      }
+    });
+    this->forEachVertex ([this, &normals](unsigned int i) {
+      this->trackVertex (i);
+      this->mesh.normal (i, normals[i]);
+    });
+  }
+
+  /* Sets the normals of the given vertices.  The (unnormalized) normal of each adjacent face is
+   * computed once and accumulated by all of its vertices.
+   */
+  void setVertexNormals (const std::vector<unsigned int>& vertices)
+  {
+    std::vector<unsigned int> faces;
+    std::vector<glm::vec3>    normals (vertices.size ());
+
+    const DynamicVisitedPool::Scope faceVisited = this->faceMarks ();
+    for (unsigned int i : vertices)
+    {
+      for (unsigned int f : this->adjacentFaces (this->vertexData[i]))
+      {
+        if (faceVisited->visit (f))
+        {
+          faces.push_back (f);
+        }
+      }
+    }
+
+    this->faceNormals.resize (this->faceData.size ());
+    Parallel::forEach (faces.size (), [this, &faces](unsigned int i) {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (faces[i], i1, i2, i3);
+
+      this->faceNormals[faces[i]] = glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
+                                                this->mesh.vertex (i3) - this->mesh.vertex (i1));
+    });
+    Parallel::forEach (vertices.size (), [this, &vertices, &normals](unsigned int i) {
+      glm::vec3 normal (0.0f);
+
+      for (unsigned int f : this->adjacentFaces (this->vertexData[vertices[i]]))
+      {
+        normal += this->faceNormals[f];
+      }
+      normal = glm::normalize (normal);
+      normals[i] = Util::isNaN (normal) ? glm::vec3 (0.0f) : normal;
+    });
+
+    for (unsigned int i = 0; i < vertices.size (); i++)
+    {
+      this->trackVertex (vertices[i]);
+      this->addVertexToStrokeRegion (vertices[i]);
+      this->mesh.normal (vertices[i], normals[i]);
+    }
+  }
+
+  void setVertexNormals (const DynamicFaces& faces)
+  {
+    this->setVertexNormals (this->vertices (faces));
+  }
+
+  void deferNormals (const DynamicFaces& faces)
+  {
+    // vertices are tracked now, so that their previous normals are recorded by the current changes
+    for (unsigned int i : this->vertices (faces))
+    {
+      this->trackVertex (i);
+      this->deferredNormals.push_back (i);
+    }
+  }
+
+  void updateNormals ()
+  {
+    if (this->deferredNormals.empty () == false)
+    {
+      std::vector<unsigned int> vertices;
+
+      this->uniqueDeferredNormals ();
+      std::swap (vertices, this->deferredNormals);
+      this->setVertexNormals (vertices);
+    }
+  }
+
+  void uniqueDeferredNormals ()
+  {
+    std::vector<unsigned int>& vertices = this->deferredNormals;
+
+    std::sort (vertices.begin (), vertices.end ());
+    vertices.erase (std::unique (vertices.begin (), vertices.end ()), vertices.end ());
+    vertices.erase (std::remove_if (vertices.begin (), vertices.end (),
+                                    [this](unsigned int i) {
+                                      return this->isFreeVertex (i) ||
+                                             this->vertexData[i].numAdjacent == 0;
+                                    }),
+                    vertices.end ());
+  }
+
+  /* During a stroke, the normals of deferred vertices are recomputed on the GPU for rendering,
+   * while they stay deferred on the CPU until `updateNormals` is called.  Partial uploads
+   * overwrite the normals on the GPU with outdated normals, hence all deferred vertices are
+   * recomputed whenever the mesh is buffered.  Returns false if normals must be updated on the
+   * CPU.
+   */
+  bool recomputeNormalsOnGpu ()
+  {
+    if (this->isStroking == false || this->useGpuNormals == false ||
+        OpenGL::hasComputeShader () == false)
+    {
+      return false;
+    }
+    this->uniqueDeferredNormals ();
+
+    const std::vector<unsigned int>& vertices = this->deferredNormals;
+    if (vertices.size () > maxGpuNormals)
+    {
+      return false;
+    }
+    else if (vertices.empty () == false)
+    {
+      std::vector<unsigned int> work (3 * vertices.size ());
+
+      for (unsigned int k = 0; k < vertices.size (); k++)
+      {
+        const DynamicAdjacentFaces adjacent = this->adjacentFaces (this->vertexData[vertices[k]]);
+
+        work[(3 * k) + 0] = vertices[k];
+        work[(3 * k) + 1] = work.size ();
+        work[(3 * k) + 2] = this->vertexData[vertices[k]].numAdjacent;
+
+        for (unsigned int f : adjacent)
+        {
+          work.push_back (this->mesh.index ((3 * f) + 0));
+          work.push_back (this->mesh.index ((3 * f) + 1));
+          work.push_back (this->mesh.index ((3 * f) + 2));
+        }
+      }
+      this->mesh.recomputeNormals (vertices.size (), work);
+    }
+    return true;
+  }
+
+  void reset ()
+  {
+    this->trackAllVertices ();
+    this->trackAllFaces ();
+    this->mesh.reset ();
+    this->vertexData.clear ();
+    this->compactFrozen.clear ();
+    this->adjacency.reset ();
+    this->numUnusedAdjacency = 0;
+    this->freeVertexIndices.clear ();
+    this->faceData.clear ();
+    this->freeFaceIndices.clear ();
+    this->octree.reset ();
+    this->visitedPool.reset ();
+    this->discardDeferredRealignment ();
+    this->deferredNormals.clear ();
+    this->faceNormals.clear ();
+    this->bvh.reset ();
+    this->bvhFaces.clear ();
+    this->distanceCache.reset ();
+    this->renderChunks.reset ();
+    this->strokeRegion.clear ();
+    this->edgeFaces.faces.clear ();
+    this->lodProxy.invalidate ();
+    this->layers.reset ();
+    this->invalidateGeometry (false);
+  }
+
+  void fromMesh (const Mesh& mesh)
+  {
+    std::vector<glm::vec3>    vertices (mesh.numVertices ());
+    std::vector<unsigned int> indices (mesh.numIndices ());
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      vertices[i] = mesh.vertex (i);
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      indices[i] = mesh.index (i);
+    }
+    this->fromArrays (vertices.data (), nullptr, vertices.size (), indices.data (),
+                      indices.size ());
+    this->mesh.bufferData ();
+  }
+
+  bool fromMesh (const Mesh& mesh, const DynamicMeshLayout& layout)
+  {
+    std::vector<glm::vec3>    vertices (mesh.numVertices ());
+    std::vector<glm::vec3>    normals (mesh.numVertices ());
+    std::vector<unsigned int> indices (mesh.numIndices ());
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      vertices[i] = mesh.vertex (i);
+      normals[i] = mesh.normal (i);
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      indices[i] = mesh.index (i);
+    }
+    const bool usesLayout = this->fromArrays (vertices.data (), normals.data (), vertices.size (),
+                                              indices.data (), indices.size (), &layout);
+    this->mesh.bufferData ();
+    return usesLayout;
+  }
+
+  void fromArrays (const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices)
+  {
+    this->fromArrays (vertices.data (), nullptr, vertices.size (), indices.data (),
+                      indices.size ());
+  }
+
+  void fromArrays (const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals,
+                   const std::vector<unsigned int>& indices)
+  {
+    assert (normals.size () == vertices.size ());
+
+    this->fromArrays (vertices.data (), normals.data (), vertices.size (), indices.data (),
+                      indices.size ());
+  }
+
+  /* Constructs the mesh in bulk: the adjacent faces of each vertex are sorted by a parallel
+   * counting sort, so that they are stored in ascending order (as if the faces were added one by
+   * one), normals are computed in parallel if none are given, and the octree is built at once.
+   * Adjacency and octree are restored from a layout instead if one is given that fits.  Returns
+   * true if the layout has been used.
+   */
+  bool fromArrays (const glm::vec3* vertices, const glm::vec3* normals, unsigned int numVertices,
+                   const unsigned int* indices, unsigned int numIndices,
+                   const DynamicMeshLayout* layout = nullptr)
+  {
+    assert (numIndices % 3 == 0);
+
+    const unsigned int numFaces = numIndices / 3;
+
+    this->reset ();
+
+    if (normals)
+    {
+      this->mesh.addVertices (vertices, normals, numVertices);
+    }
+    else
+    {
+      const std::vector<glm::vec3> zeros (numVertices, glm::vec3 (0.0f));
+      this->mesh.addVertices (vertices, zeros.data (), numVertices);
+    }
+    this->mesh.addIndices (indices, numIndices);
+
+    this->vertexData.resize (numVertices);
+    for (VertexData& d : this->vertexData)
+    {
+      d.isFree = false;
+    }
+    this->faceData.resize (numFaces);
+    for (FaceData& d : this->faceData)
+    {
+      d.isFree = false;
+    }
+
+    const bool usesLayout = layout && this->fromLayout (*layout);
+
+    if (usesLayout == false)
+    {
+      this->buildAdjacency (indices, numIndices);
+      this->buildOctree ();
+    }
+    this->buildEdgeFaces ();
+    if (normals == nullptr)
+    {
+      this->setAllNormals ();
+    }
+    return usesLayout;
+  }
+
+  void buildAdjacency (const unsigned int* indices, unsigned int numIndices)
+  {
+    const unsigned int numVertices = this->vertexData.size ();
+
+    std::unique_ptr<std::atomic<unsigned int>[]> counts (
+      new std::atomic<unsigned int>[numVertices]);
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      counts[i] = 0;
+    }
+    Parallel::forEach (numIndices, [indices, numVertices, &counts](unsigned int i) {
+      assert (indices[i] < numVertices);
+      unused (numVertices);
+      counts[indices[i]]++;
+    });
+
+    std::vector<unsigned int> valences (numVertices);
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      valences[i] = counts[i].exchange (0);
+    }
+    this->reserveAdjacency (valences);
+
+    std::vector<unsigned int>& adjacency = this->adjacency.write ();
+    Parallel::forEach (numIndices, [this, indices, &counts, &adjacency](unsigned int i) {
+      const VertexData& d = this->vertexData[indices[i]];
+      adjacency[d.adjacentOffset + counts[indices[i]]++] = i / 3;
+    });
+    Parallel::forEach (numVertices, [this, &valences, &adjacency](unsigned int i) {
+      VertexData& d = this->vertexData[i];
+
+      d.numAdjacent = valences[i];
+      std::sort (adjacency.begin () + d.adjacentOffset,
+                 adjacency.begin () + d.adjacentOffset + d.numAdjacent);
+    });
+  }
+
+  // the layout is validated before the adjacency is restored
+  bool fromLayout (const DynamicMeshLayout& layout)
+  {
+    const unsigned int numFaces = this->faceData.size ();
+    uint64_t           numAdjacent = 0;
+
+    if (layout.valences.size () != this->vertexData.size () ||
+        layout.adjacency.size () != 3 * std::size_t (numFaces))
+    {
+      return false;
+    }
+    for (unsigned int valence : layout.valences)
+    {
+      numAdjacent += valence;
+    }
+    if (numAdjacent != layout.adjacency.size () ||
+        std::any_of (layout.adjacency.begin (), layout.adjacency.end (),
+                     [numFaces](unsigned int f) { return f >= numFaces; }) ||
+        this->octree.fromLayout (layout.octree, numFaces) == false)
+    {
+      return false;
+    }
+    this->reserveAdjacency (layout.valences);
+
+    std::vector<unsigned int>& adjacency = this->adjacency.write ();
+    unsigned int               offset = 0;
+
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      VertexData& d = this->vertexData[i];
+
+      d.numAdjacent = layout.valences[i];
+      std::copy (layout.adjacency.begin () + offset,
+                 layout.adjacency.begin () + offset + d.numAdjacent,
+                 adjacency.begin () + d.adjacentOffset);
+      offset += d.numAdjacent;
+    }
+    this->discardDeferredRealignment ();
+    this->renderChunks.markAll ();
+    return true;
+  }
+
+  void realignFace (unsigned int i)
+  {
+    assert (this->isFreeFace (i) == false);
+
+    const PrimTriangle tri = this->face (i);
+
+    this->octree.realignElement (i, tri.center (), tri.maxDimExtent ());
+    this->renderChunks.markFace (i);
+    this->invalidateFaceGeometry (i);
+  }
+
+  void realignFaces (const DynamicFaces& faces)
+  {
+    for (unsigned int i : faces)
+    {
+      this->realignFace (i);
+    }
+  }
+
+  /* Faces that still fit their nodes stay in place, e.g., after smoothing, and the octree is only
+   * built from scratch if most faces have moved, e.g., after transforming the mesh.
+   */
+  void realignAllFaces ()
+  {
+    std::vector<unsigned int> faces;
+    std::vector<glm::vec4>    centerAndExtents;
+
+    this->allCenterAndExtents (faces, centerAndExtents);
+
+    if (this->octree.refit (faces, centerAndExtents, maxRefitFraction))
+    {
+      this->octree.deleteEmptyChildren ();
+      this->octree.shrinkRoot ();
+    }
+    else
+    {
+      this->octree.build (faces, centerAndExtents);
+    }
+    this->discardDeferredRealignment ();
+    this->renderChunks.markAll ();
+    this->distanceCache.reset ();
+    this->invalidateGeometry (true);
+  }
+
+  void deferRealignment (const DynamicFaces& faces)
+  {
+    this->deferredRealignment.faces.insert (this->deferredRealignment.faces.end (),
+                                            faces.begin (), faces.end ());
+    this->deferredRealignment.isPending = this->deferredRealignment.faces.empty () == false;
+
+    for (unsigned int i : faces)
+    {
+      this->renderChunks.markFace (i);
+      this->invalidateFaceGeometry (i);
+    }
+  }
+
+  void discardDeferredRealignment ()
+  {
+    this->deferredRealignment.faces.clear ();
+    this->deferredRealignment.isPending = false;
+  }
+
+  /* Realigns all deferred faces in one pass: each face is realigned once, and the new centers and
+   * extents are computed in parallel.  A face that still fits its node stays in place.
+   */
+  void applyDeferredRealignment () const
+  {
+    DeferredRealignment& deferred = this->deferredRealignment;
+
+    if (deferred.isPending)
+    {
+      std::lock_guard<std::mutex> lock (deferred.mutex);
+
+      if (deferred.isPending)
+      {
+        std::vector<unsigned int>& faces = deferred.faces;
+
+        std::sort (faces.begin (), faces.end ());
+        faces.erase (std::unique (faces.begin (), faces.end ()), faces.end ());
+        faces.erase (std::remove_if (faces.begin (), faces.end (),
+                                     [this](unsigned int i) { return this->isFreeFace (i); }),
+                     faces.end ());
+
+        // runs serially, since parallel tasks might wait for other tasks that need the lock
+        for (unsigned int i : faces)
+        {
+          const PrimTriangle tri = this->face (i);
+          this->octree.realignElement (i, tri.center (), tri.maxDimExtent ());
+        }
+        faces.clear ();
+        deferred.isPending = false;
+      }
+    }
+  }
+
+  void sanitize ()
+  {
+    this->applyDeferredRealignment ();
+    this->octree.deleteEmptyChildren ();
+    this->octree.shrinkRoot ();
+    this->updateBvh ();
+  }
+
+  void sanitize (const DynamicFaces& faces)
+  {
+    this->deferRealignment (faces);
+    this->sanitize ();
+  }
+
+  PrimAABox faceBounds (unsigned int i) const
+  {
+    const PrimTriangle tri = this->face (i);
+    return PrimAABox (tri.minimum (), tri.maximum ());
+  }
+
+  void updateBvh ()
+  {
+    if (this->useBvh && this->isBvhValid == false)
+    {
+      const auto getBounds = [this](unsigned int i) {
+        return this->faceBounds (this->bvhFaces[i]);
+      };
+
+      if (this->canRefitBvh && this->changedRegion.isWhole == false)
+      {
+        assert (this->bvh.numElements () == this->bvhFaces.size ());
+        this->bvh.refit (this->changedRegionElements (), getBounds);
+      }
+      else if (this->canRefitBvh)
+      {
+        assert (this->bvh.numElements () == this->bvhFaces.size ());
+        this->bvh.refit (getBounds);
+      }
+      else
+      {
+        this->bvhFaces.clear ();
+        this->bvhFaces.reserve (this->numFaces ());
+        this->forEachFace ([this](unsigned int i) { this->bvhFaces.push_back (i); });
+        this->bvh.build (this->bvhFaces.size (), getBounds);
+      }
+      this->isBvhValid = true;
+      this->canRefitBvh = true;
+    }
+    this->changedRegion.clear ();
+  }
+
+  // faces are added to the hierarchy in ascending order
+  std::vector<unsigned int> changedRegionElements () const
+  {
+    std::vector<unsigned int> elements;
+
+    elements.reserve (this->changedRegion.faces.size ());
+    for (unsigned int i : this->changedRegion.faces)
+    {
+      const auto it = std::lower_bound (this->bvhFaces.begin (), this->bvhFaces.end (), i);
+
+      assert (it != this->bvhFaces.end () && *it == i);
+      elements.push_back (it - this->bvhFaces.begin ());
+    }
+    return elements;
+  }
+
+  void buildEdgeFaces ()
+  {
+    this->edgeFaces.faces.clear ();
+
+    if (this->edgeFaces.isUsed)
+    {
+      this->edgeFaces.faces.reserve (3 * this->numFaces ());
+      this->forEachFace ([this](unsigned int f) {
+        unsigned int i1, i2, i3;
+        this->vertexIndices (f, i1, i2, i3);
+        this->edgeFaces.add (f, i1, i2, i3);
+      });
+    }
+  }
+
+  void setUseGpuNormals (bool value) { this->useGpuNormals = value; }
+
+  void setUseEdgeFaces (bool value)
+  {
+    if (this->edgeFaces.isUsed != value)
+    {
+      this->edgeFaces.isUsed = value;
+
+      if (this->isCompact () == false)
+      {
+        this->buildEdgeFaces ();
+      }
+    }
+  }
+
+  void setCullRenderClusters (bool value)
+  {
+    RenderChunks& chunks = this->renderChunks;
+
+    if (chunks.cullClusters != value)
+    {
+      chunks.cullClusters = value;
+      chunks.clusterSpheres.clear ();
+      chunks.clusterCones.clear ();
+      chunks.markAll ();
+    }
+  }
+
+  void clipPlane (const PrimPlane* plane)
+  {
+    this->clipEquation =
+      plane ? glm::vec4 (plane->normal (), -glm::dot (plane->normal (), plane->point ()))
+            : glm::vec4 (0.0f);
+  }
+
+  bool hasClipPlane () const { return this->clipEquation != glm::vec4 (0.0f); }
+
+  float clipDistance (const glm::vec3& p) const
+  {
+    return glm::dot (glm::vec3 (this->clipEquation), p) + this->clipEquation.w;
+  }
+
+  // faces that cross a clip plane are not clipped
+  bool isClippedFace (unsigned int i) const
+  {
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    return this->clipDistance (this->mesh.vertex (i1)) > 0.0f &&
+           this->clipDistance (this->mesh.vertex (i2)) > 0.0f &&
+           this->clipDistance (this->mesh.vertex (i3)) > 0.0f;
+  }
+
+  /* The range [`tMin`, `tMax`] of a ray that is not clipped.  Returns false if the ray is
+   * clipped completely.
+   */
+  bool clipRay (const PrimRay& ray, float& tMin, float& tMax) const
+  {
+    const float d = this->clipDistance (ray.origin ());
+    const float slope = glm::dot (glm::vec3 (this->clipEquation), ray.direction ());
+
+    tMin = 0.0f;
+    tMax = Util::maxFloat ();
+
+    if (glm::abs (slope) < Util::epsilon ())
+    {
+      return d <= 0.0f;
+    }
+    else if (slope > 0.0f)
+    {
+      tMax = -d / slope;
+      return tMax >= 0.0f;
+    }
+    else
+    {
+      tMin = glm::max (0.0f, -d / slope);
+      return true;
+    }
+  }
+
+  void setUseBvh (bool value)
+  {
+    this->useBvh = value;
+
+    if (value)
+    {
+      this->updateBvh ();
+    }
+    else
+    {
+      this->bvh.reset ();
+      this->bvhFaces.clear ();
+      this->isBvhValid = false;
+      this->canRefitBvh = false;
+    }
+  }
+
+  // ray queries use the hierarchy if it is up to date and fall back to the octree otherwise
+  void intersectsRay (const PrimRay& ray, const DynamicOctree::RayIntersectionCallback& f) const
+  {
+    this->applyDeferredRealignment ();
+
+    if (this->useBvh && this->isBvhValid)
+    {
+      this->bvh.intersects (ray, [this, &f](unsigned int i) { return f (this->bvhFaces[i]); });
+    }
+    else
+    {
+      this->octree.intersects (ray, f);
+    }
+  }
+
+  // maps faces to the Morton order of their centroids
+  unsigned int spatialFaceIndexMap (std::vector<unsigned int>& faceMap) const
+  {
+    struct Element
+    {
+      uint64_t     code;
+      unsigned int face;
+
+      bool operator< (const Element& other) const
+      {
+        return this->code < other.code || (this->code == other.code && this->face < other.face);
+      }
+    };
+
+    const unsigned int numFaces =
+      compactionMap (this->faceData.size (), faceMap,
+                     [this](unsigned int i) { return this->faceData[i].isFree == false; });
+
+    std::vector<glm::vec3> centroids (numFaces);
+    Parallel::forEach (faceMap.size (), [this, &faceMap, &centroids](unsigned int i) {
+      if (faceMap[i] != Util::invalidIndex ())
+      {
+        unsigned int i1, i2, i3;
+        this->vertexIndices (i, i1, i2, i3);
+
+        centroids[faceMap[i]] =
+          (this->mesh.vertex (i1) + this->mesh.vertex (i2) + this->mesh.vertex (i3)) / 3.0f;
+      }
+    });
+
+    glm::vec3 min (Util::maxFloat ());
+    glm::vec3 max (Util::minFloat ());
+    for (const glm::vec3& c : centroids)
+    {
+      min = glm::min (min, c);
+      max = glm::max (max, c);
+    }
+
+    const float maxCoordinate = float((1 << 21) - 1);
+    const float scale =
+      maxCoordinate / glm::max (Util::epsilon (), glm::max (glm::max (max.x - min.x, max.y - min.y),
+                                                          max.z - min.z));
+
+    std::vector<Element> elements (numFaces);
+    Parallel::forEach (faceMap.size (), [&](unsigned int i) {
+      if (faceMap[i] != Util::invalidIndex ())
+      {
+        const glm::vec3 q = glm::clamp ((centroids[faceMap[i]] - min) * scale, glm::vec3 (0.0f),
+                                        glm::vec3 (maxCoordinate));
+
+        elements[faceMap[i]].code =
+          Util::mortonCode ((unsigned int) (q.x), (unsigned int) (q.y), (unsigned int) (q.z));
+        elements[faceMap[i]].face = i;
+      }
+    });
+    std::sort (elements.begin (), elements.end ());
+
+    Parallel::forEach (numFaces,
+                       [&faceMap, &elements](unsigned int i) { faceMap[elements[i].face] = i; });
+    return numFaces;
+  }
+
+  // maps vertices to the order of their first use by the (new) faces
+  unsigned int firstUseVertexIndexMap (const std::vector<unsigned int>& faceMap,
+                                       unsigned int numFaces,
+                                       std::vector<unsigned int>& vertexMap) const
+  {
+    std::vector<unsigned int> faces (numFaces);
+    for (unsigned int i = 0; i < faceMap.size (); i++)
+    {
+      if (faceMap[i] != Util::invalidIndex ())
+      {
+        faces[faceMap[i]] = i;
+      }
+    }
+
+    unsigned int numVertices = 0;
+    vertexMap.assign (this->vertexData.size (), Util::invalidIndex ());
+
+    for (unsigned int f : faces)
+    {
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        const unsigned int v = this->mesh.index ((3 * f) + j);
+        if (vertexMap[v] == Util::invalidIndex ())
+        {
+          vertexMap[v] = numVertices++;
+        }
+      }
+    }
+    // vertices without faces (cf. pruneAndCheckConsistency) are kept at the end
+    for (unsigned int i = 0; i < vertexMap.size (); i++)
+    {
+      if (vertexMap[i] == Util::invalidIndex () && this->vertexData[i].isFree == false)
+      {
+        vertexMap[i] = numVertices++;
+      }
+    }
+    return numVertices;
+  }
+
+  /* Moves vertices and faces to the new indices of the given maps, which are injective and
+   * leave no gaps.  Everything is gathered into new arrays in parallel, so any permutation of
+   * the remaining elements can be applied.
+   */
+  void applyIndexMaps (const std::vector<unsigned int>& vertexMap, unsigned int numVertices,
+                       const std::vector<unsigned int>& faceMap, unsigned int numFaces)
+  {
+    std::vector<unsigned int> vertices (numVertices);
+    Parallel::forEach (vertexMap.size (), [&vertexMap, &vertices](unsigned int i) {
+      if (vertexMap[i] != Util::invalidIndex ())
+      {
+        vertices[vertexMap[i]] = i;
+      }
+    });
+
+    std::vector<VertexData> newVertexData (numVertices);
+    unsigned int            adjacencySize = 0;
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      const VertexData& d = this->vertexData[vertices[i]];
+
+      newVertexData[i].isFree = false;
+      newVertexData[i].isFrozen = d.isFrozen;
+      newVertexData[i].numAdjacent = d.numAdjacent;
+      newVertexData[i].adjacentOffset = adjacencySize;
+      newVertexData[i].adjacentCapacity = adjacentCapacity (d.numAdjacent);
+      adjacencySize += newVertexData[i].adjacentCapacity;
+    }
+
+    std::vector<unsigned int> newAdjacency (adjacencySize);
+    std::vector<glm::vec3>    positions (numVertices);
+    std::vector<glm::vec3>    normals (numVertices);
+
+    Parallel::forEach (numVertices, [&](unsigned int i) {
+      const VertexData&   d = this->vertexData[vertices[i]];
+      const unsigned int* adjacent = this->adjacency->data () + d.adjacentOffset;
+
+      for (unsigned int j = 0; j < d.numAdjacent; j++)
+      {
+        assert (faceMap[adjacent[j]] != Util::invalidIndex ());
+        newAdjacency[newVertexData[i].adjacentOffset + j] = faceMap[adjacent[j]];
+      }
+      positions[i] = this->mesh.vertex (vertices[i]);
+      normals[i] = this->mesh.normal (vertices[i]);
+    });
+
+    std::vector<unsigned int> indices (3 * numFaces);
+    Parallel::forEach (faceMap.size (), [this, &vertexMap, &faceMap, &indices](unsigned int i) {
+      if (faceMap[i] != Util::invalidIndex ())
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          assert (vertexMap[this->mesh.index ((3 * i) + j)] != Util::invalidIndex ());
+          indices[(3 * faceMap[i]) + j] = vertexMap[this->mesh.index ((3 * i) + j)];
+        }
+      }
+    });
+
+    this->vertexData = std::move (newVertexData);
+    this->adjacency.reset ();
+    this->adjacency.write () = std::move (newAdjacency);
+    this->numUnusedAdjacency = 0;
+    this->freeVertexIndices.clear ();
+    this->mesh.shrinkVertices (0);
+    this->mesh.addVertices (positions.data (), normals.data (), numVertices);
+
+    this->faceData.assign (numFaces, FaceData ());
+    for (FaceData& d : this->faceData)
+    {
+      d.isFree = false;
+    }
+    this->freeFaceIndices.clear ();
+    this->mesh.shrinkIndices (0);
+    this->mesh.addIndices (indices.data (), indices.size ());
+    this->layers.remap (vertexMap);
+  }
+
+  /* Reorders faces for the post-transform vertex cache (cf. Sander et al.: Fast Triangle
+   * Reordering for Vertex Locality and Reduced Overdraw, 2007).  Faces are emitted in fans
+   * around vertices, and the next fanning vertex is an adjacent vertex that is likely to be
+   * still cached.  Dead ends continue with recent vertices or the faces in their mapped order.
+   */
+  void cacheOptimizedFaceIndexMap (std::vector<unsigned int>& faceMap, unsigned int numFaces) const
+  {
+    std::vector<unsigned int> faces (numFaces);
+    for (unsigned int i = 0; i < faceMap.size (); i++)
+    {
+      if (faceMap[i] != Util::invalidIndex ())
+      {
+        faces[faceMap[i]] = i;
+      }
+    }
+
+    std::vector<unsigned int> live (this->vertexData.size ());
+    std::vector<unsigned int> timeStamps (this->vertexData.size (), 0);
+    std::vector<bool>         isEmitted (faceMap.size (), false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    unsigned int              time = vertexCacheSize + 1;
+    unsigned int              numEmitted = 0;
+    unsigned int              cursor = 0;
+
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      live[i] = this->vertexData[i].isFree ? 0 : this->vertexData[i].numAdjacent;
+    }
+
+    const auto skipDeadEnd = [this, &faces, &live, &isEmitted, &deadEnds, &cursor]() {
+      while (deadEnds.empty () == false)
+      {
+        const unsigned int v = deadEnds.back ();
+        deadEnds.pop_back ();
+
+        if (live[v] > 0)
+        {
+          return v;
+        }
+      }
+      for (; cursor < faces.size (); cursor++)
+      {
+        if (isEmitted[faces[cursor]] == false)
+        {
+          return this->mesh.index (3 * faces[cursor]);
+        }
+      }
+      return Util::invalidIndex ();
+    };
+
+    unsigned int fanning = skipDeadEnd ();
+    while (fanning != Util::invalidIndex ())
+    {
+      candidates.clear ();
+      for (unsigned int f : this->adjacentFaces (this->vertexData[fanning]))
+      {
+        if (isEmitted[f] == false)
+        {
+          isEmitted[f] = true;
+          faceMap[f] = numEmitted++;
+
+          for (unsigned int j = 0; j < 3; j++)
+          {
+            const unsigned int v = this->mesh.index ((3 * f) + j);
+
+            deadEnds.push_back (v);
+            candidates.push_back (v);
+            live[v]--;
+
+            if (time - timeStamps[v] > vertexCacheSize)
+            {
+              timeStamps[v] = time++;
+            }
+          }
+        }
+      }
+
+      // prefers the oldest vertex that stays in the cache while its remaining faces are emitted
+      fanning = Util::invalidIndex ();
+      int maxPriority = -1;
+      for (unsigned int v : candidates)
+      {
+        if (live[v] > 0)
+        {
+          const unsigned int age = time - timeStamps[v];
+          const int          priority = age + (2 * live[v]) <= vertexCacheSize ? int(age) : 0;
+
+          if (priority > maxPriority)
+          {
+            maxPriority = priority;
+            fanning = v;
+          }
+        }
+      }
+      if (fanning == Util::invalidIndex ())
+      {
+        fanning = skipDeadEnd ();
+      }
+    }
+    assert (numEmitted == numFaces);
+  }
+
+  /* Maps the remaining vertices and faces to consecutive indices.  Faces are sorted spatially
+   * and/or for the vertex cache if enabled, and vertices then follow the order of the faces.
+   */
+  void remapIndices (std::vector<unsigned int>* pVertexIndexMap,
+                     std::vector<unsigned int>* pFaceIndexMap)
+  {
+    this->trackAllVertices ();
+    this->trackAllFaces ();
+
+    std::vector<unsigned int> defaultVertexIndexMap;
+    std::vector<unsigned int> defaultFaceIndexMap;
+
+    if (pVertexIndexMap == nullptr)
+    {
+      pVertexIndexMap = &defaultVertexIndexMap;
+    }
+    if (pFaceIndexMap == nullptr)
+    {
+      pFaceIndexMap = &defaultFaceIndexMap;
+    }
+
+    const unsigned int newNumFaces =
+      this->reorderOnPrune
+        ? this->spatialFaceIndexMap (*pFaceIndexMap)
+        : compactionMap (this->faceData.size (), *pFaceIndexMap,
+                         [this](unsigned int i) { return this->faceData[i].isFree == false; });
+
+    if (this->optimizeIndexOrder)
+    {
+      this->cacheOptimizedFaceIndexMap (*pFaceIndexMap, newNumFaces);
+    }
+
+    const unsigned int newNumVertices =
+      this->reorderOnPrune || this->optimizeIndexOrder
+        ? this->firstUseVertexIndexMap (*pFaceIndexMap, newNumFaces, *pVertexIndexMap)
+        : compactionMap (this->vertexData.size (), *pVertexIndexMap,
+                         [this](unsigned int i) { return this->vertexData[i].isFree == false; });
+
+    assert (newNumVertices == this->numVertices ());
+    assert (newNumFaces == this->numFaces ());
+
+    this->applyIndexMaps (*pVertexIndexMap, newNumVertices, *pFaceIndexMap, newNumFaces);
+    assert (this->numVertices () == newNumVertices);
+    assert (this->numFaces () == newNumFaces);
+
+    this->octree.updateIndices (*pFaceIndexMap);
+    this->renderChunks.markAll ();
+    this->buildEdgeFaces ();
+    this->invalidateGeometry (false);
+  }
+
+  void prune (std::vector<unsigned int>* pVertexIndexMap, std::vector<unsigned int>* pFaceIndexMap)
+  {
+    this->applyDeferredRealignment ();
+    this->updateNormals ();
+
+    if (this->isPruned () == false)
+    {
+      this->remapIndices (pVertexIndexMap, pFaceIndexMap);
+    }
+  }
+
+  // moves the last face into a free slot, which leaves the last slot free
+  void moveFace (unsigned int f, unsigned int slot)
+  {
+    assert (this->isFreeFace (f) == false);
+    assert (this->isFreeFace (slot));
+
+    unsigned int i[3];
+    this->vertexIndices (f, i[0], i[1], i[2]);
+
+    this->trackFace (f);
+    this->trackFace (slot);
+    this->edgeFaces.remove (f, i[0], i[1], i[2]);
+    this->octree.deleteElement (f);
+
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      const VertexData& d = this->vertexData[i[j]];
+      const auto        begin = this->adjacency.write ().begin () + d.adjacentOffset;
+
+      *std::find (begin, begin + d.numAdjacent, f) = slot;
+      this->mesh.index ((3 * slot) + j, i[j]);
+    }
+    this->faceData[slot].isFree = false;
+    this->faceData[f].reset ();
+
+    this->edgeFaces.add (slot, i[0], i[1], i[2]);
+    this->addFaceToOctree (slot);
+    this->renderChunks.markFace (slot);
+
+    if (this->lastHitFace == f)
+    {
+      this->lastHitFace = slot;
+    }
+  }
+
+  // moves the last vertex into a free slot, which leaves the last slot free
+  void moveVertex (unsigned int v, unsigned int slot)
+  {
+    assert (this->isFreeVertex (v) == false);
+    assert (this->isFreeVertex (slot));
+
+    this->trackVertex (v);
+    this->trackVertex (slot);
+
+    for (unsigned int f : this->adjacentFaces (this->vertexData[v]))
+    {
+      unsigned int i[3];
+      this->vertexIndices (f, i[0], i[1], i[2]);
+
+      this->trackFace (f);
+      this->edgeFaces.remove (f, i[0], i[1], i[2]);
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        if (i[j] == v)
+        {
+          i[j] = slot;
+          this->mesh.index ((3 * f) + j, slot);
+        }
+      }
+      this->edgeFaces.add (f, i[0], i[1], i[2]);
+      this->renderChunks.markFace (f);
+    }
+    this->mesh.vertex (slot, this->mesh.vertex (v));
+    this->mesh.normal (slot, this->mesh.normal (v));
+
+    // the adjacency of the moved vertex is handed over to the slot
+    this->numUnusedAdjacency += this->vertexData[slot].adjacentCapacity;
+    this->vertexData[slot] = this->vertexData[v];
+    this->vertexData[v].adjacentCapacity = 0;
+    this->vertexData[v].reset ();
+    this->layers.moveVertex (v, slot);
+  }
+
+  /* Closes free slots from the end: free slots at the end are dropped, and the last element is
+   * moved into the lowest free slot otherwise.  Free slots are sorted in descending order, hence
+   * the lowest one is taken from the back and addVertex/addFace also reuse the lowest slots.
+   */
+  template <typename Move, typename Drop>
+  static unsigned int defragmentSlots (std::vector<unsigned int>& free, unsigned int capacity,
+                                       unsigned int maxNumMoves, const Move& move,
+                                       const Drop& drop)
+  {
+    unsigned int numMoves = 0;
+    unsigned int numDropped = 0;
+
+    std::sort (free.begin (), free.end (), std::greater<unsigned int> ());
+
+    while (free.size () > numDropped)
+    {
+      if (free[numDropped] == capacity - 1)
+      {
+        numDropped++;
+      }
+      else if (numMoves < maxNumMoves)
+      {
+        move (capacity - 1, free.back ());
+        free.pop_back ();
+        numMoves++;
+      }
+      else
+      {
+        break;
+      }
+      drop (--capacity);
+    }
+    free.erase (free.begin (), free.begin () + numDropped);
+    return numMoves;
+  }
+
+  /* Moves at most the given number of live elements into free slots per call, so that meshes of
+   * long sessions stay dense without pausing for a complete prune.  Moves are tracked like edits,
+   * and the mesh is buffered if it changed.  Returns the number of moved elements.
+   */
+  unsigned int defragment (unsigned int maxNumMoves)
+  {
+    if (this->isCompact () || this->isStroking || this->isPruned ())
+    {
+      return 0;
+    }
+    this->applyDeferredRealignment ();
+    this->updateNormals ();
+
+    const unsigned int faceCapacity = this->faceData.size ();
+    const unsigned int vertexCapacity = this->vertexData.size ();
+    const unsigned int numFaceMoves = defragmentSlots (
+      this->freeFaceIndices, this->faceData.size (), maxNumMoves,
+      [this](unsigned int f, unsigned int slot) { this->moveFace (f, slot); },
+      [this](unsigned int last) {
+        this->trackFace (last);
+        this->faceData.pop_back ();
+        this->mesh.shrinkIndices (3 * last);
+      });
+
+    const unsigned int numVertexMoves = defragmentSlots (
+      this->freeVertexIndices, this->vertexData.size (), maxNumMoves - numFaceMoves,
+      [this](unsigned int v, unsigned int slot) { this->moveVertex (v, slot); },
+      [this](unsigned int last) {
+        this->trackVertex (last);
+        this->numUnusedAdjacency += this->vertexData.back ().adjacentCapacity;
+        this->vertexData.pop_back ();
+        this->mesh.shrinkVertices (last);
+      });
+
+    if (faceCapacity != this->faceData.size () || vertexCapacity != this->vertexData.size ())
+    {
+      if (2 * this->numUnusedAdjacency > this->adjacency->size ())
+      {
+        this->compactAdjacency ();
+      }
+      this->invalidateGeometry (false);
+      this->bufferData (false);
+    }
+    return numFaceMoves + numVertexMoves;
+  }
+
+  void reorder (bool buffer)
+  {
+    if (this->reorderOnPrune || this->optimizeIndexOrder)
+    {
+      this->applyDeferredRealignment ();
+      this->updateNormals ();
+      this->remapIndices (nullptr, nullptr);
+
+      if (buffer)
+      {
+        this->bufferData ();
+      }
+    }
+  }
+
+  bool pruneAndCheckConsistency (std::vector<unsigned int>* pVertexIndexMap,
+                                 std::vector<unsigned int>* pFaceIndexMap)
+  {
+    this->prune (pVertexIndexMap, pFaceIndexMap);
+    this->bufferData ();
+
+    if (MeshUtil::checkConsistency (this->mesh))
+    {
+      for (unsigned int i = 0; i < this->vertexData.size (); i++)
+      {
+        if (this->vertexData[i].isFree == false)
+        {
+          if (this->vertexData[i].numAdjacent == 0)
+          {
+            DILAY_WARN ("vertex %u is not free but has no adjacent faces", i);
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  bool mirrorPositive (const PrimPlane& plane)
+  {
+    assert (this->pruneAndCheckConsistency (nullptr, nullptr));
+
+    const auto inBorder = [this, &plane](unsigned int f) {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+
+      const float d1 = glm::abs (plane.distance (this->mesh.vertex (i1)));
+      const float d2 = glm::abs (plane.distance (this->mesh.vertex (i2)));
+      const float d3 = glm::abs (plane.distance (this->mesh.vertex (i3)));
+
+      return d1 <= Util::epsilon () && d2 <= Util::epsilon () && d3 <= Util::epsilon ();
+    };
+
+    DynamicFaces faces;
+    do
+    {
+      faces.reset ();
+      if (this->intersects (plane, faces) == false)
+      {
+        break;
+      }
+      faces.filter (inBorder);
+      if (faces.isEmpty ())
+      {
+        break;
+      }
+    } while (ToolSculptAction::deleteFaces (*this->self, faces));
+    assert (this->pruneAndCheckConsistency (nullptr, nullptr));
+
+    this->prune (nullptr, nullptr);
+
+    Mesh mirrored = MeshUtil::mirrorPositive (this->mesh, plane);
+    if (mirrored.numVertices () == 0)
+    {
+      this->setAllNormals ();
+      return false;
+    }
+    else
+    {
+      this->fromMesh (mirrored);
+      assert (this->pruneAndCheckConsistency (nullptr, nullptr));
+      return true;
+    }
+  }
+
+  void mirror (const PrimPlane& plane)
+  {
+    this->updateNormals ();
+    this->trackAllVertices ();
+    this->layers.reset ();
+    MeshUtil::mirror (this->mesh, plane);
+    this->realignAllFaces ();
+    this->bufferData ();
+  }
+
+  void moveToCenter ()
+  {
+    this->trackAllVertices ();
+    MeshUtil::moveToCenter (this->mesh);
+    this->realignAllFaces ();
+    this->bufferData ();
+  }
+
+  void normalizeScaling ()
+  {
+    this->trackAllVertices ();
+    this->layers.reset ();
+    MeshUtil::normalizeScaling (this->mesh);
+    this->realignAllFaces ();
+    this->bufferData ();
+  }
+
+  void transform (const glm::mat4x4& model)
+  {
+    this->updateNormals ();
+    this->trackAllVertices ();
+    this->layers.reset ();
+    MeshUtil::transform (this->mesh, model);
+    this->realignAllFaces ();
+    this->bufferData ();
+  }
+
+  void bufferData () { this->bufferData (true); }
+
+  // the level-of-detail proxy stays valid if elements have only been rearranged
+  void bufferData (bool invalidateLodProxy)
+  {
+    if (this->publishing.snapshot)
+    {
+      this->publish ();
+    }
+
+    if (this->isCompact ())
+    {
+      this->mesh.bufferData ();
+      return;
+    }
+    if (this->bufferStrokeRegion ())
+    {
+      return;
+    }
+    else if (this->recomputeNormalsOnGpu () == false)
+    {
+      this->updateNormals ();
+    }
+
+    const auto findNonFreeFaceIndex = [this]() -> unsigned int {
+      assert (this->numFaces () > 0);
+
+      for (unsigned int i = 0; i < this->faceData.size (); i++)
+      {
+        if (this->isFreeFace (i) == false)
+        {
+          return i;
+        }
+      }
+      DILAY_IMPOSSIBLE
+    };
+
+    if (this->numFaces () > 0 && this->freeFaceIndices.empty () == false)
+    {
+      const unsigned int nonFree = findNonFreeFaceIndex ();
+
+      for (unsigned int i : this->freeFaceIndices)
+      {
+        this->mesh.index ((3 * i) + 0, this->mesh.index ((3 * nonFree) + 0));
+        this->mesh.index ((3 * i) + 1, this->mesh.index ((3 * nonFree) + 1));
+        this->mesh.index ((3 * i) + 2, this->mesh.index ((3 * nonFree) + 2));
+      }
+    }
+    this->mesh.bufferData ();
+    this->updateRenderChunks ();
+    this->strokeRegion.clear ();
+
+    if (invalidateLodProxy)
+    {
+      this->lodProxy.invalidate ();
+    }
+  }
+
+  /* Pages of new elements are copied, since they are beyond the elements of the previous version.
+   * Compact meshes are not edited, so they keep their latest version.
+   */
+  void publish ()
+  {
+    DILAY_ALLOCATION_SCOPE ("snapshots");
+
+    Publishing& publishing = this->publishing;
+
+    if (this->isCompact () ||
+        (publishing.snapshot && publishing.hasChanges == false &&
+         (publishing.isOctreeOutdated == false || this->isStroking)))
+    {
+      return;
+    }
+
+    std::shared_ptr<DynamicMeshSnapshot> snapshot =
+      publishing.snapshot ? std::make_shared<DynamicMeshSnapshot> (*publishing.snapshot)
+                          : std::make_shared<DynamicMeshSnapshot> ();
+
+    if (publishing.hasChanges)
+    {
+      snapshot->version++;
+      snapshot->vertices.update (this->vertexData.size (), publishing.dirtyVertexPages,
+                                 [this](unsigned int i) { return this->mesh.vertex (i); });
+      snapshot->indices.update (3 * this->faceData.size (), publishing.dirtyIndexPages,
+                                [this](unsigned int i) {
+                                  return this->faceData[i / 3].isFree ? Util::invalidIndex ()
+                                                                      : this->mesh.index (i);
+                                });
+    }
+
+    if (publishing.isOctreeOutdated && this->isStroking == false)
+    {
+      this->applyDeferredRealignment ();
+      snapshot->octree = std::make_shared<DynamicOctreeLayout> (this->octree.layout ());
+      snapshot->octreeVersion = snapshot->version;
+      publishing.isOctreeOutdated = false;
+    }
+    publishing.snapshot = std::move (snapshot);
+    publishing.clear ();
+  }
+
+  DynamicMeshSnapshotPtr snapshot ()
+  {
+    this->publish ();
+    return this->publishing.snapshot;
   }
 
-  void findAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
-                     unsigned int& leftVertex, unsigned int& rightFace,
-                     unsigned int& rightVertex) const
+  /* Buffers the region of an active stroke as a separate batch, unless the region has grown too
+   * large or the mesh has been changed as a whole.  Returns false if the mesh must be buffered
+   * completely.
+   */
+  bool bufferStrokeRegion ()
   {
-    assert (this->isFreeVertex (e1) == false);
-    assert (this->isFreeVertex (e2) == false);
+    StrokeRegion& region = this->strokeRegion;
 
-    leftFace = Util::invalidIndex ();
-    leftVertex = Util::invalidIndex ();
-    rightFace = Util::invalidIndex ();
-    rightVertex = Util::invalidIndex ();
+    if (region.isActive == false)
+    {
+      return false;
+    }
+    this->updateNormals ();
 
-    for (unsigned int a : this->vertexData[e1].adjacentFaces)
+    if (region.faces.size () > StrokeRegion::maxNumFaces || this->renderChunks.allDirty ||
+        this->mesh.renderMode ().renderWireframe ())
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (a, i1, i2, i3);
+      return false;
+    }
 
-      if (e1 == i1 && e2 == i2)
-      {
-        leftFace = a;
-        leftVertex = i3;
-      }
-      else if (e1 == i2 && e2 == i1)
-      {
-        rightFace = a;
-        rightVertex = i3;
-      }
-      else if (e1 == i2 && e2 == i3)
-      {
-        leftFace = a;
-        leftVertex = i1;
-      }
-      else if (e1 == i3 && e2 == i2)
-      {
-        rightFace = a;
-        rightVertex = i1;
-      }
-      else if (e1 == i3 && e2 == i1)
-      {
-        leftFace = a;
-        leftVertex = i2;
-      }
-      else if (e1 == i1 && e2 == i3)
+    region.updateRanges (this->faceData.size ());
+    region.batch.copyNonGeometry (this->mesh);
+    region.batch.shrinkIndices (0);
+    region.batch.shrinkVertices (0);
+
+    for (unsigned int f : region.faces)
+    {
+      if (f < this->faceData.size () && this->isFreeFace (f) == false)
       {
-        rightFace = a;
-        rightVertex = i2;
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          const unsigned int v = this->mesh.index ((3 * f) + j);
+
+          region.batch.addIndex (region.batch.addVertex (this->mesh.vertex (v),
+                                                         this->mesh.normal (v)));
+        }
       }
     }
-    assert (leftFace != Util::invalidIndex ());
-    assert (leftVertex != Util::invalidIndex ());
-    assert (rightFace != Util::invalidIndex ());
-    assert (rightVertex != Util::invalidIndex ());
+    region.batch.bufferData ();
+    region.isBuffered = true;
+    this->lodProxy.invalidate ();
+    return true;
   }
 
-  const std::vector<unsigned int>& adjacentFaces (unsigned int i) const
+  /* The render chunks and the level-of-detail proxy of a compact mesh stay valid, since its
+   * geometry does not change until it is expanded.
+   */
+  void compact ()
   {
-    assert (this->isFreeVertex (i) == false);
-    return this->vertexData[i].adjacentFaces;
-  }
+    assert (this->isCompact () == false);
+    assert (this->tracksChanges () == false);
 
-  void forEachVertex (const std::function<void(unsigned int)>& f) const
-  {
+    this->prune (nullptr, nullptr);
+    this->bufferData ();
+    this->mesh.compact ();
+
+    this->compactFrozen.clear ();
     for (unsigned int i = 0; i < this->vertexData.size (); i++)
     {
-      if (this->isFreeVertex (i) == false)
+      if (this->vertexData[i].isFrozen)
       {
-        f (i);
+        this->compactFrozen.resize (this->vertexData.size (), false);
+        this->compactFrozen[i] = true;
       }
     }
+    std::vector<VertexData> ().swap (this->vertexData);
+    this->adjacency.reset ();
+    this->numUnusedAdjacency = 0;
+    std::vector<FaceData> ().swap (this->faceData);
+    this->octree.reset ();
+    this->visitedPool.reset ();
+    std::vector<glm::vec3> ().swap (this->faceNormals);
+    this->bvh.reset ();
+    std::vector<unsigned int> ().swap (this->bvhFaces);
+    this->isBvhValid = false;
+    this->canRefitBvh = false;
+    this->distanceCache.reset ();
+    decltype (this->edgeFaces.faces) ().swap (this->edgeFaces.faces);
+    this->mesh.bufferData ();
   }
 
-  void visitVertices (unsigned int i, const std::function<void(unsigned int)>& f)
+  void expand ()
   {
-    assert (this->isFreeFace (i) == false);
+    assert (this->isCompact ());
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    Mesh              nonGeometry;
+    std::vector<bool> frozen;
+
+    nonGeometry.copyNonGeometry (this->mesh);
+    frozen.swap (this->compactFrozen);
 
-    if (this->vertexVisited[i1] == 0)
+    this->mesh.expand ();
+
+    std::vector<glm::vec3>    vertices (this->mesh.numVertices ());
+    std::vector<glm::vec3>    normals (this->mesh.numVertices ());
+    std::vector<unsigned int> indices (this->mesh.numIndices ());
+
+    for (unsigned int i = 0; i < this->mesh.numVertices (); i++)
     {
-      this->vertexVisited[i1] = 1;
-      f (i1);
+      vertices[i] = this->mesh.vertex (i);
+      normals[i] = this->mesh.normal (i);
     }
-    if (this->vertexVisited[i2] == 0)
+    for (unsigned int i = 0; i < this->mesh.numIndices (); i++)
     {
-      this->vertexVisited[i2] = 1;
-      f (i2);
+      indices[i] = this->mesh.index (i);
     }
-    if (this->vertexVisited[i3] == 0)
+    // vertices keep their indices, hence their displacements
+    DynamicMeshLayers layers (std::move (this->layers));
+
+    this->fromArrays (vertices, normals, indices);
+    this->mesh.copyNonGeometry (nonGeometry);
+    this->layers = std::move (layers);
+
+    for (unsigned int i = 0; i < frozen.size (); i++)
     {
-      this->vertexVisited[i3] = 1;
-      f (i3);
+      this->vertexData[i].isFrozen = frozen[i];
     }
-    this->faceVisited[i] = 1;
+    this->bufferData ();
   }
 
-  void unvisitVertices ()
+  bool isCompact () const { return this->mesh.isCompact (); }
+
+  void updateRenderChunks ()
   {
-    std::memset (this->vertexVisited.data (), 0, this->vertexVisited.size ());
-  }
+    RenderChunks&      chunks = this->renderChunks;
+    const unsigned int chunkSize = 1 << RenderChunks::chunkShift;
+    const unsigned int numFaces = this->faceData.size ();
+    const unsigned int numChunks = (numFaces + chunkSize - 1) >> RenderChunks::chunkShift;
 
-  void unvisitFaces () { std::memset (this->faceVisited.data (), 0, this->faceVisited.size ()); }
+    const unsigned int clustersPerChunk = chunkSize >> RenderChunks::clusterShift;
 
-  void forEachVertex (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
-  {
-    this->unvisitVertices ();
+    chunks.minima.resize (numChunks);
+    chunks.maxima.resize (numChunks);
+    chunks.isDirty.resize (numChunks, false);
 
-    for (unsigned int i : faces)
+    if (chunks.cullClusters)
     {
-      this->visitVertices (i, f);
+      chunks.clusterSpheres.resize (numChunks * clustersPerChunk);
+      chunks.clusterCones.resize (numChunks * clustersPerChunk);
     }
-  }
-
-  void forEachVertexExt (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
-  {
-    this->unvisitVertices ();
-    this->unvisitFaces ();
 
-    for (unsigned int i : faces)
+    if (chunks.allDirty)
     {
-      this->visitVertices (i, [this, &f](unsigned int j) {
-        f (j);
+      chunks.dirty.resize (numChunks);
+      for (unsigned int c = 0; c < numChunks; c++)
+      {
+        chunks.dirty[c] = c;
+      }
+    }
+    else
+    {
+      chunks.dirty.erase (std::remove_if (chunks.dirty.begin (), chunks.dirty.end (),
+                                          [numChunks](unsigned int c) { return c >= numChunks; }),
+                          chunks.dirty.end ());
+    }
 
-        for (unsigned int a : this->vertexData[j].adjacentFaces)
+    Parallel::forEach (chunks.dirty.size (), [this, &chunks, chunkSize, clustersPerChunk,
+                                              numFaces](unsigned int k) {
+      const unsigned int c = chunks.dirty[k];
+      const unsigned int end = glm::min ((c + 1) * chunkSize, numFaces);
+      glm::vec3          min (Util::maxFloat ());
+      glm::vec3          max (Util::minFloat ());
+
+      for (unsigned int i = c * chunkSize; i < end; i++)
+      {
+        if (this->isFreeFace (i) == false)
         {
-          if (this->faceVisited[a] == 0)
+          for (unsigned int j = 0; j < 3; j++)
           {
-            this->visitVertices (a, f);
+            const glm::vec3& v = this->mesh.vertex (this->mesh.index ((3 * i) + j));
+
+            min = glm::min (min, v);
+            max = glm::max (max, v);
           }
         }
-      });
+      }
+      chunks.minima[c] = min;
+      chunks.maxima[c] = max;
+
+      if (chunks.cullClusters)
+      {
+        for (unsigned int l = c * clustersPerChunk; l < (c + 1) * clustersPerChunk; l++)
+        {
+          this->updateRenderCluster (l, numFaces);
+        }
+      }
+    });
+
+    for (unsigned int c : chunks.dirty)
+    {
+      chunks.isDirty[c] = false;
     }
+    chunks.dirty.clear ();
+    chunks.allDirty = false;
+    chunks.isCulled = false;
   }
 
-  void forEachVertexAdjacentToVertex (unsigned int                             i,
-                                      const std::function<void(unsigned int)>& f) const
+  void updateRenderCluster (unsigned int k, unsigned int numFaces)
   {
-    assert (this->isFreeVertex (i) == false);
-
-    for (unsigned int a : this->vertexData[i].adjacentFaces)
+    RenderChunks&      chunks = this->renderChunks;
+    const unsigned int begin = glm::min (k << RenderChunks::clusterShift, numFaces);
+    const unsigned int end = glm::min ((k + 1) << RenderChunks::clusterShift, numFaces);
+    glm::vec3          min (Util::maxFloat ());
+    glm::vec3          max (Util::minFloat ());
+    glm::vec3          axis (0.0f);
+
+    for (unsigned int i = begin; i < end; i++)
     {
-      unsigned int a1, a2, a3;
-      this->vertexIndices (a, a1, a2, a3);
-
-      if (i == a1)
-      {
-        f (a2);
-      }
-      else if (i == a2)
-      {
-        f (a3);
-      }
-      else if (i == a3)
-      {
-        f (a1);
-      }
-      else
+      if (this->isFreeFace (i) == false)
       {
-        DILAY_IMPOSSIBLE
+        const PrimTriangle tri = this->face (i);
+
+        min = glm::min (min, tri.minimum ());
+        max = glm::max (max, tri.maximum ());
+        axis += tri.normal ();
       }
     }
-  }
 
-  void forEachVertexAdjacentToFace (unsigned int                             i,
-                                    const std::function<void(unsigned int)>& f) const
-  {
-    assert (this->isFreeFace (i) == false);
+    if (min.x > max.x)
+    {
+      chunks.clusterSpheres[k] = glm::vec4 (0.0f, 0.0f, 0.0f, -1.0f);
+      chunks.clusterCones[k] = glm::vec4 (0.0f, 0.0f, 0.0f, 2.0f);
+      return;
+    }
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    const glm::vec3 center = 0.5f * (min + max);
+    const float     axisLength = glm::length (axis);
+    float           radius = 0.0f;
+    float           minDot = 1.0f;
 
-    f (i1);
-    f (i2);
-    f (i3);
-  }
+    axis = axisLength > Util::epsilon () ? axis / axisLength : glm::vec3 (0.0f);
 
-  void forEachFace (const std::function<void(unsigned int)>& f) const
-  {
-    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    for (unsigned int i = begin; i < end; i++)
     {
       if (this->isFreeFace (i) == false)
       {
-        f (i);
+        const PrimTriangle tri = this->face (i);
+
+        radius = glm::max (radius, glm::distance (center, tri.vertex1 ()));
+        radius = glm::max (radius, glm::distance (center, tri.vertex2 ()));
+        radius = glm::max (radius, glm::distance (center, tri.vertex3 ()));
+        minDot = glm::min (minDot, glm::dot (axis, tri.normal ()));
       }
     }
+    chunks.clusterSpheres[k] = glm::vec4 (center, radius);
+
+    // wide cones are hardly ever culled
+    const float cutoff = minDot > 0.1f ? glm::sqrt (1.0f - (minDot * minDot)) : 2.0f;
+    chunks.clusterCones[k] = glm::vec4 (axis, cutoff);
   }
 
-  void forEachFaceExt (const DynamicFaces& faces, const std::function<void(unsigned int)>& f)
+  // a single chunk is only culled if it might be clipped
+  bool canCullRenderChunks () const
   {
-    this->unvisitVertices ();
-    this->unvisitFaces ();
+    return this->strokeRegion.isBuffered == false && this->renderChunks.hasDirty () == false &&
+           (this->renderChunks.minima.size () >= 2 || this->hasClipPlane ());
+  }
 
-    for (unsigned int i : faces)
+  void cullRenderChunks (const Camera& camera) const
+  {
+    const RenderChunks& chunks = this->renderChunks;
+    const glm::mat4x4&  view =
+      this->mesh.renderMode ().cameraRotationOnly () ? camera.viewRotation () : camera.view ();
+    const glm::mat4x4 mvp = camera.projection () * view * this->mesh.modelMatrix ();
+    const glm::vec4   clip = glm::transpose (this->mesh.modelMatrix ()) * this->clipEquation;
+
+    if (chunks.isCulled && chunks.culledMvp == mvp && chunks.culledClipPlane == clip)
     {
-      if (this->faceVisited[i] == 0)
+      return;
+    }
+
+    const glm::vec4    row0 (mvp[0][0], mvp[1][0], mvp[2][0], mvp[3][0]);
+    const glm::vec4    row1 (mvp[0][1], mvp[1][1], mvp[2][1], mvp[3][1]);
+    const glm::vec4    row2 (mvp[0][2], mvp[1][2], mvp[2][2], mvp[3][2]);
+    const glm::vec4    row3 (mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+    const glm::vec4    planes[6] = {row3 + row0, row3 - row0, row3 + row1,
+                                 row3 - row1, row3 + row2, row3 - row2};
+    const unsigned int chunkSize = 3 << RenderChunks::chunkShift;
+    const unsigned int clusterSize = 3 << RenderChunks::clusterShift;
+    const unsigned int clustersPerChunk = chunkSize / clusterSize;
+    const glm::vec3    eye (glm::inverse (view * this->mesh.modelMatrix ())[3]);
+
+    std::vector<unsigned int>& firsts = chunks.visibleFirsts;
+    std::vector<unsigned int>& counts = chunks.visibleCounts;
+
+    firsts.clear ();
+    counts.clear ();
+
+    const auto addRange = [&firsts, &counts](unsigned int first, unsigned int count) {
+      if (counts.empty () == false && firsts.back () + counts.back () == first)
       {
-        f (i);
-        this->faceVisited[i] = 1;
+        counts.back () += count;
+      }
+      else
+      {
+        firsts.push_back (first);
+        counts.push_back (count);
       }
-      this->visitVertices (i, [this, &f](unsigned int j) {
-        for (unsigned int a : this->vertexData[j].adjacentFaces)
+    };
+
+    for (unsigned int c = 0; c < chunks.minima.size (); c++)
+    {
+      const glm::vec3& min = chunks.minima[c];
+      const glm::vec3& max = chunks.maxima[c];
+
+      if (min.x <= max.x && isInFrustum (planes, min, max) && isClipped (clip, min, max) == false)
+      {
+        if (chunks.cullClusters)
         {
-          if (this->faceVisited[a] == 0)
+          for (unsigned int k = c * clustersPerChunk; k < (c + 1) * clustersPerChunk; k++)
           {
-            f (a);
-            this->faceVisited[a] = 1;
+            const glm::vec4& sphere = chunks.clusterSpheres[k];
+
+            if (sphere.w >= 0.0f && isInFrustum (planes, sphere) &&
+                isClipped (clip, sphere) == false &&
+                isBackFacing (sphere, chunks.clusterCones[k], eye) == false)
+            {
+              addRange (k * clusterSize, clusterSize);
+            }
           }
         }
-      });
+        else
+        {
+          addRange (c * chunkSize, chunkSize);
+        }
+      }
     }
+    chunks.culledMvp = mvp;
+    chunks.culledClipPlane = clip;
+    chunks.isCulled = true;
   }
 
-  void average (const DynamicFaces& faces, glm::vec3& position, glm::vec3& normal) const
+  // only touches this mesh, i.e., meshes may be prepared concurrently
+  void prepareRendering (const Camera& camera) const
   {
-    assert (faces.numElements () > 0);
-
-    position = glm::vec3 (0.0f);
-    normal = glm::vec3 (0.0f);
+    this->applyDeferredRealignment ();
+    this->bounds ();
 
-    for (unsigned int f : faces)
+    if (this->canCullRenderChunks ())
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
-
-      position += this->mesh.vertex (i1);
-      position += this->mesh.vertex (i2);
-      position += this->mesh.vertex (i3);
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+      this->cullRenderChunks (camera);
     }
-    position /= float(faces.numElements () * 3);
-    normal = glm::normalize (normal);
   }
 
-  glm::vec3 averagePosition (const DynamicFaces& faces) const
+  // linked instances render the buffered mesh, i.e., they show the region of a stroke once it ends
+  void render (Camera& camera) const
   {
-    assert (faces.numElements () > 0);
+    const RenderChunks& chunks = this->renderChunks;
 
-    glm::vec3 position = glm::vec3 (0.0f);
+    if (this->strokeRegion.isBuffered)
+    {
+      if (this->strokeRegion.firsts.empty () == false)
+      {
+        this->mesh.render (camera, this->strokeRegion.firsts, this->strokeRegion.counts);
+      }
+      if (this->strokeRegion.batch.numIndices () > 0)
+      {
+        this->strokeRegion.batch.render (camera);
+      }
+    }
+    else if (this->canCullRenderChunks () == false)
+    {
+      this->mesh.render (camera);
+    }
+    else
+    {
+      this->cullRenderChunks (camera);
 
-    for (unsigned int f : faces)
+      const std::vector<unsigned int>& firsts = chunks.visibleFirsts;
+      const std::vector<unsigned int>& counts = chunks.visibleCounts;
+
+      if (firsts.size () == 1 && firsts[0] == 0 && counts[0] >= this->mesh.numIndices ())
+      {
+        this->mesh.render (camera);
+      }
+      else
+      {
+        this->mesh.render (camera, firsts, counts);
+      }
+    }
+#ifdef DILAY_RENDER_OCTREE
+    this->octree.render (camera);
+#endif
+  }
+
+  // proxies are not clipped, hence clipped meshes are rendered in full detail
+  void render (Camera& camera, bool preferLodProxy) const
+  {
+    if (this->numFaces () >= DynamicLodProxy::minNumFaces () && this->hasClipPlane () == false)
     {
-      this->forEachVertexAdjacentToFace (
-        f, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
+      if (preferLodProxy && this->isCompact () == false)
+      {
+        this->lodProxy.update (this->mesh);
+      }
+      if (this->lodProxy.isUpToDate () &&
+          (preferLodProxy || this->lodProxy.isSmallOnScreen (camera, this->mesh)))
+      {
+        this->lodProxy.render (camera, this->mesh);
+        return;
+      }
     }
-    return position / float(faces.numElements () * 3);
+    this->render (camera);
   }
 
-  glm::vec3 averagePosition (unsigned int i) const
+  bool intersects (const PrimRay& ray, Intersection& intersection, bool bothSides) const
   {
-    assert (this->isFreeVertex (i) == false);
-    assert (this->vertexData[i].adjacentFaces.size () > 0);
+    this->intersectsRay (ray, [this, &ray, &intersection, bothSides](unsigned int i) -> float {
+      const PrimTriangle tri = this->face (i);
+      float              t;
 
-    glm::vec3 position = glm::vec3 (0.0f);
+      if (IntersectionUtil::intersects (ray, tri, bothSides, &t))
+      {
+        intersection.update (t, ray.pointAt (t), tri.normal ());
+        return t;
+      }
+      else
+      {
+        return Util::maxFloat ();
+      }
+    });
+    return intersection.isIntersection ();
+  }
 
-    this->forEachVertexAdjacentToVertex (
-      i, [this, &position](unsigned int v) { position += this->mesh.vertex (v); });
-    return position / float(this->vertexData[i].adjacentFaces.size ());
+  bool intersectsAny (const PrimRay& ray, float maxDistance, bool bothSides) const
+  {
+    this->applyDeferredRealignment ();
+
+    return this->octree.intersectsAny (
+      ray, maxDistance,
+      [this, &ray, maxDistance, bothSides](const unsigned int* elements, unsigned int numElements) {
+        for (unsigned int i = 0; i < numElements; i++)
+        {
+          float t;
+          if (IntersectionUtil::intersects (ray, this->face (elements[i]), bothSides, &t) &&
+              t < maxDistance)
+          {
+            return true;
+          }
+        }
+        return false;
+      });
   }
 
-  glm::vec3 averageNormal (const DynamicFaces& faces) const
+  bool intersects (const PrimRay& ray, const std::function<bool(unsigned int)>& filter,
+                   Intersection& intersection) const
   {
-    assert (faces.numElements () > 0);
+    this->intersectsRay (ray, [this, &ray, &filter, &intersection](unsigned int i) -> float {
+      float t;
 
-    glm::vec3 normal = glm::vec3 (0.0f);
+      if (filter (i))
+      {
+        const PrimTriangle tri = this->face (i);
 
-    for (unsigned int f : faces)
-    {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
+        if (IntersectionUtil::intersects (ray, tri, false, &t))
+        {
+          intersection.update (t, ray.pointAt (t), tri.normal ());
+          return intersection.distance ();
+        }
+      }
+      return Util::maxFloat ();
+    });
+    return intersection.isIntersection ();
+  }
 
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
-    }
-    return glm::normalize (normal);
+  void intersects (const PrimRay& ray, std::vector<Intersection>& intersections,
+                   bool bothSides) const
+  {
+    intersections.clear ();
+
+    // the callback never shortens the ray, so all faces along the ray are visited in one traversal
+    this->intersectsRay (ray, [this, &ray, &intersections, bothSides](unsigned int i) -> float {
+      const PrimTriangle tri = this->face (i);
+      float              t;
+
+      if (IntersectionUtil::intersects (ray, tri, bothSides, &t))
+      {
+        intersections.emplace_back ();
+        intersections.back ().update (t, ray.pointAt (t), tri.normal ());
+      }
+      return Util::maxFloat ();
+    });
+
+    std::sort (intersections.begin (), intersections.end (),
+               [](const Intersection& a, const Intersection& b) {
+                 return a.distance () < b.distance ();
+               });
   }
 
-  glm::vec3 averageNormal (unsigned int i) const
+  void intersects (const std::vector<PrimRay>& rays, std::vector<Intersection>& intersections,
+                   bool bothSides) const
   {
-    assert (this->isFreeVertex (i) == false);
-    assert (this->vertexData[i].adjacentFaces.size () > 0);
-
-    glm::vec3 normal = glm::vec3 (0.0f);
+    intersections.clear ();
+    intersections.resize (rays.size ());
 
-    for (unsigned int f : this->vertexData[i].adjacentFaces)
+    if (this->useBvh && this->isBvhValid)
     {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
+      for (unsigned int i = 0; i < rays.size (); i++)
+      {
+        this->intersects (rays[i], intersections[i], bothSides);
+      }
+    }
+    else
+    {
+      this->applyDeferredRealignment ();
+      this->octree.intersects (
+        rays, [this, &rays, &intersections, bothSides](unsigned int r, unsigned int i) -> float {
+          const PrimTriangle tri = this->face (i);
+          float              t;
 
-      normal += glm::cross (this->mesh.vertex (i2) - this->mesh.vertex (i1),
-                            this->mesh.vertex (i3) - this->mesh.vertex (i1));
+          if (IntersectionUtil::intersects (rays[r], tri, bothSides, &t))
+          {
+            intersections[r].update (t, rays[r].pointAt (t), tri.normal ());
+            return t;
+          }
+          else
+          {
+            return Util::maxFloat ();
+          }
+        });
     }
-    return glm::normalize (normal);
   }
 
-  float averageEdgeLengthSqr (const DynamicFaces& faces) const
+  // faces are intersected in blocks of the octree's nodes or the hierarchy's leaves
+  // a compact mesh is expanded once it is intersected, since it is about to be edited
+  bool intersects (const PrimRay& ray, DynamicMeshIntersection& intersection)
   {
-    assert (faces.numElements () > 0);
+    if (this->isCompact ())
+    {
+      if (IntersectionUtil::intersects (ray, this->bounds (), nullptr) == false)
+      {
+        return false;
+      }
+      this->expand ();
+    }
+    this->applyDeferredRealignment ();
 
-    float length = 0.0f;
-    for (unsigned int i : faces)
+    /* Clipped meshes are intersected by the part of a ray that is not clipped, which starts at
+     * `tMin`, so the traversal skips the clipped nodes in front of the plane.  Lines are not
+     * clipped.
+     */
+    float tMin = 0.0f;
+    float tMax = Util::maxFloat ();
+
+    if (this->hasClipPlane () && ray.isLine () == false &&
+        this->clipRay (ray, tMin, tMax) == false)
     {
-      length += this->averageEdgeLengthSqr (i);
+      return intersection.isIntersection ();
     }
-    return length / float(faces.numElements ());
-  }
 
-  float averageEdgeLengthSqr (unsigned int i) const
-  {
-    assert (this->isFreeFace (i) == false);
+    const PrimRay clippedRay (ray.isLine (), ray.pointAt (tMin), ray.direction ());
+    const auto    maxDistance = [&intersection, tMin, tMax]() {
+      const float d = intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
+      return glm::min (d, tMax) - tMin;
+    };
 
-    unsigned int i1, i2, i3;
-    this->vertexIndices (i, i1, i2, i3);
+    PrimTriangleBlock block;
+    unsigned int      blockFaces[PrimTriangleBlock::maxTriangles];
 
-    const glm::vec3& v1 = this->mesh.vertex (i1);
-    const glm::vec3& v2 = this->mesh.vertex (i2);
-    const glm::vec3& v3 = this->mesh.vertex (i3);
+    const auto intersectsFaces = [this, &ray, &clippedRay, &intersection, &block, &blockFaces,
+                                  &maxDistance, tMin, tMax](
+                                   const unsigned int* elements, unsigned int numElements,
+                                   const std::vector<unsigned int>* elementFaces) -> float {
+      for (unsigned int begin = 0; begin < numElements; begin += PrimTriangleBlock::maxTriangles)
+      {
+        const unsigned int end =
+          glm::min (numElements, begin + PrimTriangleBlock::maxTriangles);
 
-    return (glm::distance2 (v1, v2) + glm::distance2 (v1, v3) + glm::distance2 (v2, v3)) / 3.0f;
-  }
+        block.reset ();
+        for (unsigned int i = begin; i < end; i++)
+        {
+          blockFaces[i - begin] = elementFaces ? (*elementFaces)[elements[i]] : elements[i];
+          block.add (this->face (blockFaces[i - begin]));
+        }
 
-  unsigned int addVertex (const glm::vec3& vertex, const glm::vec3& normal)
-  {
-    assert (this->vertexData.size () == this->mesh.numVertices ());
-    assert (this->vertexVisited.size () == this->mesh.numVertices ());
+        float        t;
+        unsigned int j;
+        if (IntersectionUtil::intersects (clippedRay, block, false, &t, &j) && t + tMin <= tMax)
+        {
+          intersection.update (t + tMin, ray.pointAt (t + tMin), block.normal (j), blockFaces[j],
+                               *this->self);
+        }
+      }
+      return maxDistance ();
+    };
 
-    if (this->freeVertexIndices.empty ())
+    /* Consecutive rays (e.g., of the cursor) tend to hit nearby faces.  A hit among the faces
+     * around the previous hit bounds the traversal, which still finds any nearer hit.
+     */
+    if (this->lastHitFace < this->faceData.size () && this->isFreeFace (this->lastHitFace) == false)
     {
-      this->vertexData.emplace_back ();
-      this->vertexData.back ().isFree = false;
-      this->vertexVisited.push_back (0);
-      return this->mesh.addVertex (vertex, normal);
+      unsigned int i[3];
+      this->vertexIndices (this->lastHitFace, i[0], i[1], i[2]);
+
+      this->hintFaces.clear ();
+      for (unsigned int v : i)
+      {
+        for (unsigned int f : this->adjacentFaces (v))
+        {
+          this->hintFaces.push_back (f);
+        }
+      }
+      intersectsFaces (this->hintFaces.data (), this->hintFaces.size (), nullptr);
+    }
+
+    if (this->useBvh && this->isBvhValid)
+    {
+      this->bvh.intersects (clippedRay, [this, &intersectsFaces](const unsigned int* elements,
+                                                                 unsigned int numElements) {
+        return intersectsFaces (elements, numElements, &this->bvhFaces);
+      });
     }
     else
     {
-      const unsigned int index = this->freeVertexIndices.back ();
-      this->mesh.vertex (index, vertex);
-      this->mesh.normal (index, normal);
-      this->vertexData[index].reset ();
-      this->vertexData[index].isFree = false;
-      this->vertexVisited[index] = 0;
-      this->freeVertexIndices.pop_back ();
-      return index;
+      this->octree.intersects (clippedRay, maxDistance (),
+                               [&intersectsFaces](const unsigned int* elements,
+                                                  unsigned int        numElements) {
+                                 return intersectsFaces (elements, numElements, nullptr);
+                               });
+    }
+
+    if (intersection.isIntersection () && &intersection.mesh () == this->self)
+    {
+      this->lastHitFace = intersection.faceIndex ();
     }
+    return intersection.isIntersection ();
   }
 
-  unsigned int addFace (unsigned int i1, unsigned int i2, unsigned int i3)
+  /* Only faces of octree nodes on the boundary of the primitive are tested.  Faces are filtered
+   * while they are collected, and the filter is evaluated before the intersection test.
+   */
+  template <typename T, typename Filter>
+  bool containsOrIntersectsT (const T& t, DynamicFaces& faces, const Filter& filter) const
   {
-    assert (i1 < this->mesh.numVertices ());
-    assert (i2 < this->mesh.numVertices ());
-    assert (i3 < this->mesh.numVertices ());
-    assert (3 * this->faceData.size () == this->mesh.numIndices ());
-    assert (this->faceData.size () == this->faceVisited.size ());
+    std::vector<unsigned int> contained;
+    std::vector<unsigned int> intersected;
 
-    unsigned int index = Util::invalidIndex ();
+    this->applyDeferredRealignment ();
+    this->octree.intersects (t, contained, intersected);
 
-    if (this->freeFaceIndices.empty ())
+    for (unsigned int i : contained)
     {
-      index = this->numFaces ();
-      this->faceData.emplace_back ();
-      this->faceVisited.push_back (0);
-
-      this->mesh.addIndex (i1);
-      this->mesh.addIndex (i2);
-      this->mesh.addIndex (i3);
+      if (filter (i))
+      {
+        faces.insert (i);
+      }
     }
-    else
+    for (unsigned int i : intersected)
     {
-      index = this->freeFaceIndices.back ();
-      this->faceData[index].reset ();
-      this->faceVisited[index] = 0;
-      this->freeFaceIndices.pop_back ();
-
-      this->mesh.index ((3 * index) + 0, i1);
-      this->mesh.index ((3 * index) + 1, i2);
-      this->mesh.index ((3 * index) + 2, i3);
+      if (filter (i) && IntersectionUtil::intersects (t, this->face (i)))
+      {
+        faces.insert (i);
+      }
     }
-    this->faceData[index].isFree = false;
-
-    this->vertexData[i1].addAdjacentFace (index);
-    this->vertexData[i2].addAdjacentFace (index);
-    this->vertexData[i3].addAdjacentFace (index);
-
-    this->addFaceToOctree (index);
-
-    return index;
+    faces.commit ();
+    return faces.isEmpty () == false;
   }
 
-  void addFaceToOctree (unsigned int i)
+  /* Faces of intersecting octree nodes are collected first and are then tested in parallel
+   * ranges, which are inserted in order.
+   */
+  bool intersects (const PrimPlane& plane, DynamicFaces& faces) const
   {
-    const PrimTriangle tri = this->face (i);
-
-    if (this->octree.hasRoot () == false)
+    std::vector<unsigned int> candidates;
+
+    this->applyDeferredRealignment ();
+    this->octree.intersects (plane,
+                             [&candidates](unsigned int i) { candidates.push_back (i); });
+
+    std::vector<char> isIntersecting (candidates.size ());
+    Parallel::forRange (candidates.size (), planeGrainSize,
+                        [this, &plane, &candidates, &isIntersecting](unsigned int begin,
+                                                                     unsigned int end) {
+                          for (unsigned int c = begin; c < end; c++)
+                          {
+                            unsigned int i1, i2, i3;
+                            this->vertexIndices (candidates[c], i1, i2, i3);
+
+                            isIntersecting[c] = IntersectionUtil::intersects (
+                              plane, this->mesh.vertex (i1), this->mesh.vertex (i2),
+                              this->mesh.vertex (i3));
+                          }
+                        });
+
+    for (unsigned int c = 0; c < candidates.size (); c++)
     {
-      this->octree.setupRoot (tri.center (), tri.maxDimExtent ());
+      if (isIntersecting[c])
+      {
+        faces.insert (candidates[c]);
+      }
     }
-
-    this->octree.addElement (i, tri.center (), tri.maxDimExtent ());
+    faces.commit ();
+    return faces.isEmpty () == false;
   }
 
-  void deleteVertex (unsigned int i)
+  bool intersects (const PrimSphere& sphere, DynamicFaces& faces) const
   {
-    assert (i < this->vertexData.size ());
-    assert (i < this->vertexVisited.size ());
-
-    std::vector<unsigned int> adjacentFaces = this->vertexData[i].adjacentFaces;
-    for (unsigned int f : adjacentFaces)
-    {
-      this->deleteFace (f);
-    }
-    this->vertexData[i].reset ();
-    this->vertexVisited[i] = 0;
-    this->freeVertexIndices.push_back (i);
+    return this->containsOrIntersectsT (sphere, faces, [](unsigned int) { return true; });
   }
 
-  void deleteFace (unsigned int i)
+  // the cross product of a face is computed from its vertices without building a triangle
+  bool facesDirection (unsigned int i, const glm::vec3& direction) const
   {
-    assert (i < this->faceData.size ());
-    assert (i < this->faceVisited.size ());
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
 
-    this->vertexData[this->mesh.index ((3 * i) + 0)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 1)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 2)].deleteAdjacentFace (i);
+    const glm::vec3& p1 = this->mesh.vertex (i1);
+    const glm::vec3  cross = glm::cross (this->mesh.vertex (i2) - p1, this->mesh.vertex (i3) - p1);
 
-    this->faceData[i].reset ();
-    this->faceVisited[i] = 0;
-    this->freeFaceIndices.push_back (i);
-    this->octree.deleteElement (i);
+    return glm::dot (direction, cross) > 0.0f;
   }
 
-  void vertexNormal (unsigned int i, const glm::vec3& n)
+  bool intersects (const PrimSphere& sphere, const glm::vec3& direction, DynamicFaces& faces) const
   {
-    assert (this->isFreeVertex (i) == false);
-    assert (this->mesh.numVertices () == this->vertexData.size ());
-
-    this->mesh.normal (i, n);
+    return this->containsOrIntersectsT (sphere, faces, [this, &direction](unsigned int i) {
+      return this->facesDirection (i, direction);
+    });
   }
 
-  void setVertexNormal (unsigned int i)
+  bool isUnclippedFace (unsigned int i) const
   {
-    const glm::vec3 avg = this->averageNormal (i);
+    return this->hasClipPlane () == false || this->isClippedFace (i) == false;
+  }
 
-    if (Util::isNaN (avg))
-    {
-      this->mesh.normal (i, glm::vec3 (0.0f));
-    }
-    else
-    {
-      this->mesh.normal (i, avg);
-    }
+  bool intersectsUnclipped (const PrimSphere& sphere, DynamicFaces& faces) const
+  {
+    return this->containsOrIntersectsT (
+      sphere, faces, [this](unsigned int i) { return this->isUnclippedFace (i); });
   }
 
-  void setAllNormals ()
+  bool intersectsUnclipped (const PrimSphere& sphere, const glm::vec3& direction,
+                            DynamicFaces& faces) const
   {
-    this->forEachVertex ([this](unsigned int i) { this->setVertexNormal (i); });
+    return this->containsOrIntersectsT (sphere, faces, [this, &direction](unsigned int i) {
+      return this->isUnclippedFace (i) && this->facesDirection (i, direction);
+    });
   }
 
-  void reset ()
+  bool intersects (const PrimAABox& box, DynamicFaces& faces) const
   {
-    this->mesh.reset ();
-    this->vertexData.clear ();
-    this->vertexVisited.clear ();
-    this->freeVertexIndices.clear ();
-    this->faceData.clear ();
-    this->faceVisited.clear ();
-    this->freeFaceIndices.clear ();
-    this->octree.reset ();
+    return this->containsOrIntersectsT (box, faces, [](unsigned int) { return true; });
   }
 
-  void fromMesh (const Mesh& mesh)
+  // the partial sums of ranges are added in a fixed order, so that the area is deterministic
+  float area () const
   {
-    this->reset ();
-    this->mesh.reserveVertices (mesh.numVertices ());
+    const unsigned int  n = this->faceCapacity ();
+    std::vector<double> areas ((n + areaGrainSize - 1) / areaGrainSize, 0.0);
 
-    for (unsigned int i = 0; i < mesh.numVertices (); i++)
-    {
-      this->addVertex (mesh.vertex (i), mesh.normal (i));
-    }
+    Parallel::forRange (n, areaGrainSize, [this, &areas](unsigned int begin, unsigned int end) {
+      double sum = 0.0;
 
-    assert (mesh.numIndices () % 3 == 0);
-    this->mesh.reserveIndices (mesh.numIndices ());
+      for (unsigned int i = begin; i < end; i++)
+      {
+        if (this->isFreeFace (i) == false)
+        {
+          sum += double(glm::length (this->face (i).cross ()));
+        }
+      }
+      areas[begin / areaGrainSize] = 0.5 * sum;
+    });
 
-    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    double area = 0.0;
+    for (double a : areas)
     {
-      this->addFace (mesh.index (i), mesh.index (i + 1), mesh.index (i + 2));
+      area += a;
     }
-    this->setAllNormals ();
-    this->mesh.bufferData ();
-  }
-
-  void realignFace (unsigned int i)
-  {
-    assert (this->isFreeFace (i) == false);
-
-    const PrimTriangle tri = this->face (i);
-
-    this->octree.realignElement (i, tri.center (), tri.maxDimExtent ());
+    return float(area);
   }
 
-  void realignFaces (const DynamicFaces& faces)
+  /* The bounds of the underlying mesh are maintained incrementally, but include the positions of
+   * free vertices.  Otherwise, bounds are computed on demand and kept until the octree changes.
+   */
+  PrimAABox bounds () const
   {
-    for (unsigned int i : faces)
+    if (this->isCompact () || this->freeVertexIndices.empty ())
     {
-      this->realignFace (i);
+      return this->mesh.bounds ();
+    }
+    else if (this->_bounds.hasValue () == false)
+    {
+      glm::vec3 min = glm::vec3 (Util::maxFloat ());
+      glm::vec3 max = glm::vec3 (Util::minFloat ());
+
+      this->forEachVertex ([this, &min, &max](unsigned int i) {
+        min = glm::min (min, this->mesh.vertex (i));
+        max = glm::max (max, this->mesh.vertex (i));
+      });
+      this->_bounds = PrimAABox (min, max);
     }
+    return *this->_bounds;
   }
 
-  void realignAllFaces ()
+  float unsignedDistance (const glm::vec3& pos) const
   {
-    this->forEachFace ([this](unsigned int i) { this->realignFace (i); });
+    unsigned int nearest;
+    return this->unsignedDistance (pos, Util::maxFloat (), nearest);
   }
 
-  void sanitize ()
+  // searches the faces that are nearer than `maxDistance` and records the nearest one found
+  float unsignedDistance (const glm::vec3& pos, float maxDistance, unsigned int& nearest) const
   {
-    this->octree.deleteEmptyChildren ();
-    this->octree.shrinkRoot ();
+    float minDistance = maxDistance;
+
+    const auto getDistance = [this, &pos, &minDistance, &nearest](unsigned int i) {
+      const float d = Distance::distance (this->face (i), pos);
+      if (d < minDistance)
+      {
+        minDistance = d;
+        nearest = i;
+      }
+      return d;
+    };
+
+    if (this->useBvh && this->isBvhValid)
+    {
+      this->bvh.distance (pos, maxDistance, [this, &getDistance](unsigned int i) {
+        return getDistance (this->bvhFaces[i]);
+      });
+    }
+    else
+    {
+      this->applyDeferredRealignment ();
+      this->octree.distance (pos, maxDistance, getDistance);
+    }
+    return minDistance;
   }
 
-  void prune (std::vector<unsigned int>* pVertexIndexMap, std::vector<unsigned int>* pFaceIndexMap)
+  /* Neighboring positions usually share their nearest face, so the distance to the nearest face
+   * of the previous position bounds the search of the next one.
+   */
+  void unsignedDistances (const std::vector<glm::vec3>& positions,
+                          std::vector<float>&           distances) const
   {
-    if (this->isPruned () == false)
-    {
-      std::vector<unsigned int> defaultVertexIndexMap;
-      std::vector<unsigned int> defaultFaceIndexMap;
+    unsigned int nearest = Util::invalidIndex ();
 
-      if (pVertexIndexMap == nullptr)
+    distances.resize (positions.size ());
+    for (unsigned int i = 0; i < positions.size (); i++)
+    {
+      if (nearest == Util::invalidIndex () || this->isFreeFace (nearest))
       {
-        pVertexIndexMap = &defaultVertexIndexMap;
+        distances[i] = this->unsignedDistance (positions[i], Util::maxFloat (), nearest);
       }
-      if (pFaceIndexMap == nullptr)
+      else
       {
-        pFaceIndexMap = &defaultFaceIndexMap;
+        const float bound = Distance::distance (this->face (nearest), positions[i]);
+        distances[i] = this->unsignedDistance (positions[i], bound, nearest);
       }
+    }
+  }
+
+  // each range of positions is searched coherently (cf. `unsignedDistances`)
+  void nearestPoints (const std::vector<glm::vec3>& positions,
+                      std::vector<glm::vec3>&       points) const
+  {
+    this->applyDeferredRealignment ();
+
+    points.resize (positions.size ());
+    Parallel::forRange (positions.size (), nearestPointsGrainSize,
+                        [this, &positions, &points](unsigned int begin, unsigned int end) {
+                          unsigned int nearest = Util::invalidIndex ();
+
+                          for (unsigned int i = begin; i < end; i++)
+                          {
+                            const float bound =
+                              nearest == Util::invalidIndex ()
+                                ? Util::maxFloat ()
+                                : Distance::distance (this->face (nearest), positions[i]);
+
+                            this->unsignedDistance (positions[i], bound, nearest);
+                            points[i] =
+                              nearest == Util::invalidIndex ()
+                                ? positions[i]
+                                : Distance::nearestPoint (this->face (nearest), positions[i]);
+                          }
+                        });
+  }
 
-      Util::prune<VertexData> (this->vertexData, [](const VertexData& d) { return d.isFree; },
-                               pVertexIndexMap);
-      Util::prune<FaceData> (this->faceData, [](const FaceData& d) { return d.isFree; },
-                             pFaceIndexMap);
+  void setUseDistanceCache (bool value)
+  {
+    this->useDistanceCache = value;
 
-      const unsigned int newNumVertices = this->vertexData.size ();
-      const unsigned int newNumFaces = this->faceData.size ();
+    if (value == false)
+    {
+      this->distanceCache.reset ();
+    }
+  }
 
-      for (VertexData& d : this->vertexData)
-      {
-        for (unsigned int& f : d.adjacentFaces)
-        {
-          assert (pFaceIndexMap->at (f) != Util::invalidIndex ());
+  void cachedUnsignedDistances (const std::vector<glm::vec3>& positions,
+                                std::vector<float>& distances, float resolution) const
+  {
+    if (this->useDistanceCache)
+    {
+      this->distanceCache.distances (
+        positions, distances, resolution,
+        [this](const std::vector<glm::vec3>& missing, std::vector<float>& missingDistances) {
+          this->unsignedDistances (missing, missingDistances);
+        });
+    }
+    else
+    {
+      this->unsignedDistances (positions, distances);
+    }
+  }
 
-          f = pFaceIndexMap->at (f);
-        }
-      }
+  void normalize ()
+  {
+    this->trackAllVertices ();
+    this->mesh.normalize ();
+    this->buildOctree ();
+    this->distanceCache.reset ();
+    this->invalidateGeometry (true);
+  }
 
-      for (unsigned int i = 0; i < pVertexIndexMap->size (); i++)
-      {
-        const unsigned int newV = pVertexIndexMap->at (i);
-        if (newV != Util::invalidIndex ())
-        {
-          this->mesh.vertex (newV, this->mesh.vertex (i));
-          this->mesh.normal (newV, this->mesh.normal (i));
-        }
-        else
-        {
-          // Expensive (!) in debug builds
-          assert (std::find (this->freeVertexIndices.begin (), this->freeVertexIndices.end (), i) !=
-                  this->freeVertexIndices.end ());
-        }
-      }
-      this->freeVertexIndices.clear ();
-      this->mesh.shrinkVertices (newNumVertices);
-      this->vertexVisited.resize (newNumVertices);
-      assert (this->numVertices () == newNumVertices);
+  void printStatistics () const { this->octree.printStatistics (); }
 
-      for (unsigned int i = 0; i < pFaceIndexMap->size (); i++)
-      {
-        const unsigned int newF = pFaceIndexMap->at (i);
-        if (newF != Util::invalidIndex ())
-        {
-          const unsigned int oldI1 = this->mesh.index ((3 * i) + 0);
-          const unsigned int oldI2 = this->mesh.index ((3 * i) + 1);
-          const unsigned int oldI3 = this->mesh.index ((3 * i) + 2);
+  DynamicOctreeStatistics octreeStatistics () const { return this->octree.statistics (); }
+
+  DynamicMeshLayout layout () const
+  {
+    DynamicMeshLayout layout;
 
-          assert (pVertexIndexMap->at (oldI1) != Util::invalidIndex ());
-          assert (pVertexIndexMap->at (oldI2) != Util::invalidIndex ());
-          assert (pVertexIndexMap->at (oldI3) != Util::invalidIndex ());
+    if (this->isCompact () == false)
+    {
+      std::vector<unsigned int> faceMap (this->faceData.size (), Util::invalidIndex ());
+      unsigned int              numFaces = 0;
 
-          this->mesh.index ((3 * newF) + 0, pVertexIndexMap->at (oldI1));
-          this->mesh.index ((3 * newF) + 1, pVertexIndexMap->at (oldI2));
-          this->mesh.index ((3 * newF) + 2, pVertexIndexMap->at (oldI3));
-        }
-        else
+      for (unsigned int i = 0; i < this->faceData.size (); i++)
+      {
+        if (this->faceData[i].isFree == false)
         {
-          // Expensive (!) in debug builds
-          assert (std::find (this->freeFaceIndices.begin (), this->freeFaceIndices.end (), i) !=
-                  this->freeFaceIndices.end ());
+          faceMap[i] = numFaces++;
         }
       }
-      this->freeFaceIndices.clear ();
-      this->mesh.shrinkIndices (3 * newNumFaces);
-      this->faceVisited.resize (newNumFaces);
-      assert (this->numFaces () == newNumFaces);
-
-      this->octree.updateIndices (*pFaceIndexMap);
-    }
-  }
 
-  bool pruneAndCheckConsistency (std::vector<unsigned int>* pVertexIndexMap,
-                                 std::vector<unsigned int>* pFaceIndexMap)
-  {
-    this->prune (pVertexIndexMap, pFaceIndexMap);
-    this->bufferData ();
+      this->applyDeferredRealignment ();
+      layout.octree = this->octree.layout ();
+      for (unsigned int& e : layout.octree.elements)
+      {
+        assert (faceMap[e] != Util::invalidIndex ());
+        e = faceMap[e];
+      }
 
-    if (MeshUtil::checkConsistency (this->mesh))
-    {
-      for (unsigned int i = 0; i < this->vertexData.size (); i++)
+      layout.valences.reserve (this->vertexData.size ());
+      layout.adjacency.reserve (3 * numFaces);
+      for (const VertexData& d : this->vertexData)
       {
-        if (this->vertexData[i].isFree == false)
+        if (d.isFree == false)
         {
-          if (this->vertexData[i].adjacentFaces.empty ())
+          layout.valences.push_back (d.numAdjacent);
+          for (unsigned int a : this->adjacentFaces (d))
           {
-            DILAY_WARN ("vertex %u is not free but has no adjacent faces", i);
-            return false;
+            layout.adjacency.push_back (faceMap[a]);
           }
         }
       }
-      return true;
     }
-    else
+    return layout;
+  }
+
+  std::size_t numBytes () const
+  {
+    std::size_t n = sizeof (DynamicMesh::Impl) + this->mesh.numBytes () + this->octree.numBytes () +
+                    this->visitedPool.numBytes () + this->bvh.numBytes () +
+                    this->distanceCache.numBytes () + this->lodProxy.numBytes () +
+                    this->edgeFaces.numBytes () + this->strokeRegion.numBytes () +
+                    this->layers.numBytes ();
+
+    n += this->vertexData.capacity () * sizeof (VertexData);
+    n += this->faceData.capacity () * sizeof (FaceData);
+    n += this->faceNormals.capacity () * sizeof (glm::vec3);
+    n += (this->adjacency->capacity () + this->freeVertexIndices.capacity () +
+          this->freeFaceIndices.capacity () + this->deferredRealignment.faces.capacity () +
+          this->deferredNormals.capacity () + this->bvhFaces.capacity () +
+          this->renderChunks.dirty.capacity () + this->hintFaces.capacity ()) *
+         sizeof (unsigned int);
+    n += (this->renderChunks.minima.capacity () + this->renderChunks.maxima.capacity ()) *
+         sizeof (glm::vec3);
+    n += (this->renderChunks.clusterSpheres.capacity () +
+          this->renderChunks.clusterCones.capacity ()) *
+         sizeof (glm::vec4);
+    n += this->renderChunks.isDirty.capacity () / 8;
+
+    if (this->tracking.changes)
     {
-      return false;
+      n += this->tracking.changes->numBytes ();
     }
+    return n;
   }
 
-  bool mirrorPositive (const PrimPlane& plane)
+  std::size_t numBufferBytes () const
   {
-    assert (this->pruneAndCheckConsistency (nullptr, nullptr));
-
-    const auto inBorder = [this, &plane](unsigned int f) {
-      unsigned int i1, i2, i3;
-      this->vertexIndices (f, i1, i2, i3);
-
-      const float d1 = glm::abs (plane.distance (this->mesh.vertex (i1)));
-      const float d2 = glm::abs (plane.distance (this->mesh.vertex (i2)));
-      const float d3 = glm::abs (plane.distance (this->mesh.vertex (i3)));
+    return this->mesh.numBufferBytes () + this->lodProxy.numBufferBytes () +
+           this->strokeRegion.batch.numBufferBytes ();
+  }
 
-      return d1 <= Util::epsilon () && d2 <= Util::epsilon () && d3 <= Util::epsilon ();
-    };
+  void releaseCaches ()
+  {
+    this->lodProxy.reset ();
+    this->distanceCache.reset ();
+  }
 
-    DynamicFaces faces;
-    do
-    {
-      faces.reset ();
-      if (this->intersects (plane, faces) == false)
-      {
-        break;
-      }
-      faces.filter (inBorder);
-      if (faces.isEmpty ())
-      {
-        break;
-      }
-    } while (ToolSculptAction::deleteFaces (*this->self, faces));
-    assert (this->pruneAndCheckConsistency (nullptr, nullptr));
+  void releaseStagingBuffers ()
+  {
+    this->mesh.releaseStagingBuffers ();
+    this->strokeRegion.batch.releaseStagingBuffers ();
+  }
 
-    this->prune (nullptr, nullptr);
+  std::size_t renderKey () const
+  {
+    std::size_t key = this->mesh.renderKey ();
 
-    Mesh mirrored = MeshUtil::mirrorPositive (this->mesh, plane);
-    if (mirrored.numVertices () == 0)
-    {
-      this->setAllNormals ();
-      return false;
-    }
-    else
+    if (this->strokeRegion.isBuffered)
     {
-      this->fromMesh (mirrored);
-      assert (this->pruneAndCheckConsistency (nullptr, nullptr));
-      return true;
+      Hash::combine (key, this->strokeRegion.batch.renderKey ());
     }
+    return key;
   }
 
-  void mirror (const PrimPlane& plane)
+  unsigned int id () const { return this->tracking.id; }
+
+  void trackChanges ()
   {
-    MeshUtil::mirror (this->mesh, plane);
-    this->realignAllFaces ();
-    this->bufferData ();
+    this->updateNormals ();
+    this->tracking.changes.reset (new DynamicMeshChanges (
+      this->vertexData.size (), this->faceData.size (), this->mesh.position (),
+      this->mesh.scaling (), this->mesh.rotationMatrix ()));
   }
 
-  void moveToCenter ()
+  bool tracksChanges () const { return bool(this->tracking.changes); }
+
+  const DynamicMeshChanges& trackedChanges () const
   {
-    MeshUtil::moveToCenter (this->mesh);
-    this->realignAllFaces ();
-    this->bufferData ();
+    assert (this->tracksChanges ());
+    return *this->tracking.changes;
   }
 
-  void normalizeScaling ()
+  DynamicMeshChanges untrackChanges ()
   {
-    MeshUtil::normalizeScaling (this->mesh);
-    this->realignAllFaces ();
-    this->bufferData ();
+    assert (this->tracksChanges ());
+
+    this->updateNormals ();
+
+    DynamicMeshChanges changes (std::move (*this->tracking.changes));
+    this->tracking.changes.reset ();
+    changes.shrinkToFit ();
+    return changes;
   }
 
-  void bufferData ()
+  /* Faces are deleted before recorded vertices are restored, so that no restored vertex and no
+   * truncated vertex has adjacent faces.  Recorded faces are restored afterwards.
+   */
+  DynamicMeshChanges applyChanges (const DynamicMeshChanges& changes)
   {
-    const auto findNonFreeFaceIndex = [this]() -> unsigned int {
-      assert (this->numFaces () > 0);
+    this->applyDeferredRealignment ();
+    assert (this->tracksChanges () == false);
 
-      for (unsigned int i = 0; i < this->faceData.size (); i++)
+    // displacements are not recorded by changes, hence layers are dropped if a change moves any
+    // of their vertices
+    if (this->changesDisplacedVertices (changes))
+    {
+      this->layers.reset ();
+    }
+    this->trackChanges ();
+
+    for (const DynamicMeshChanges::Face& f : changes.faces ())
+    {
+      if (f.index < this->faceData.size () && this->isFreeFace (f.index) == false)
       {
-        if (this->isFreeFace (i) == false)
-        {
-          return i;
-        }
+        this->deleteFace (f.index);
       }
-      DILAY_IMPOSSIBLE
-    };
-
-    if (this->numFaces () > 0 && this->freeFaceIndices.empty () == false)
+    }
+    for (unsigned int i = changes.numFaces (); i < this->faceData.size (); i++)
     {
-      const unsigned int nonFree = findNonFreeFaceIndex ();
-
-      for (unsigned int i : this->freeFaceIndices)
+      if (this->isFreeFace (i) == false)
       {
-        this->mesh.index ((3 * i) + 0, this->mesh.index ((3 * nonFree) + 0));
-        this->mesh.index ((3 * i) + 1, this->mesh.index ((3 * nonFree) + 1));
-        this->mesh.index ((3 * i) + 2, this->mesh.index ((3 * nonFree) + 2));
+        this->deleteFace (i);
       }
     }
-    this->mesh.bufferData ();
-  }
 
-  void render (Camera& camera) const
-  {
-    this->mesh.render (camera);
-#ifdef DILAY_RENDER_OCTREE
-    this->octree.render (camera);
-#endif
-  }
+    while (this->vertexData.size () < changes.numVertices ())
+    {
+      this->vertexData.emplace_back ();
+      this->mesh.addVertex (glm::vec3 (0.0f));
+    }
+    for (unsigned int i = changes.numVertices (); i < this->vertexData.size (); i++)
+    {
+      assert (this->vertexData[i].numAdjacent == 0);
+      this->trackVertex (i);
+      this->numUnusedAdjacency += this->vertexData[i].adjacentCapacity;
+    }
+    this->vertexData.resize (changes.numVertices ());
+    this->mesh.shrinkVertices (changes.numVertices ());
 
-  bool intersects (const PrimRay& ray, Intersection& intersection, bool bothSides) const
-  {
-    this->octree.intersects (ray, [this, &ray, &intersection, bothSides](unsigned int i) -> float {
-      const PrimTriangle tri = this->face (i);
-      float              t;
+    for (const DynamicMeshChanges::Vertex& v : changes.vertices ())
+    {
+      assert (v.isFree == false || this->vertexData[v.index].numAdjacent == 0);
 
-      if (IntersectionUtil::intersects (ray, tri, bothSides, &t))
+      this->trackVertex (v.index);
+      this->vertexData[v.index].isFree = v.isFree;
+      this->mesh.vertex (v.index, v.position);
+      this->mesh.normal (v.index, v.normal);
+    }
+
+    while (this->faceData.size () < changes.numFaces ())
+    {
+      this->faceData.emplace_back ();
+      this->mesh.addIndex (0);
+      this->mesh.addIndex (0);
+      this->mesh.addIndex (0);
+    }
+    for (unsigned int i = changes.numFaces (); i < this->faceData.size (); i++)
+    {
+      assert (this->isFreeFace (i));
+      this->trackFace (i);
+    }
+    this->faceData.resize (changes.numFaces ());
+    this->mesh.shrinkIndices (3 * changes.numFaces ());
+
+    const DynamicVisitedPool::Scope faceVisited = this->faceMarks ();
+    for (const DynamicMeshChanges::Face& f : changes.faces ())
+    {
+      this->trackFace (f.index);
+      this->mesh.index ((3 * f.index) + 0, f.i1);
+      this->mesh.index ((3 * f.index) + 1, f.i2);
+      this->mesh.index ((3 * f.index) + 2, f.i3);
+
+      if (f.isFree == false)
       {
-        intersection.update (t, ray.pointAt (t), tri.normal ());
-        return t;
+        this->faceData[f.index].isFree = false;
+        faceVisited->visit (f.index);
+        this->addAdjacentFace (f.i1, f.index);
+        this->addAdjacentFace (f.i2, f.index);
+        this->addAdjacentFace (f.i3, f.index);
+        this->addFaceToOctree (f.index);
+        this->edgeFaces.add (f.index, f.i1, f.i2, f.i3);
       }
-      else
+    }
+    for (const DynamicMeshChanges::Vertex& v : changes.vertices ())
+    {
+      if (v.isFree == false)
       {
-        return Util::maxFloat ();
+        for (unsigned int a : this->adjacentFaces (v.index))
+        {
+          if (faceVisited->visit (a))
+          {
+            this->realignFace (a);
+          }
+        }
       }
-    });
-    return intersection.isIntersection ();
-  }
-
-  bool intersects (const PrimRay& ray, DynamicMeshIntersection& intersection)
-  {
-    this->octree.intersects (ray, [this, &ray, &intersection](unsigned int i) -> float {
-      const PrimTriangle tri = this->face (i);
-      float              t;
+    }
 
-      if (IntersectionUtil::intersects (ray, tri, false, &t))
+    this->freeVertexIndices.clear ();
+    for (unsigned int i = 0; i < this->vertexData.size (); i++)
+    {
+      if (this->vertexData[i].isFree)
       {
-        intersection.update (t, ray.pointAt (t), tri.normal (), i, *this->self);
-        return intersection.distance ();
+        this->freeVertexIndices.push_back (i);
       }
-      else
+    }
+    this->freeFaceIndices.clear ();
+    for (unsigned int i = 0; i < this->faceData.size (); i++)
+    {
+      if (this->faceData[i].isFree)
       {
-        return Util::maxFloat ();
+        this->freeFaceIndices.push_back (i);
       }
-    });
-    return intersection.isIntersection ();
+    }
+    if (2 * this->numUnusedAdjacency > this->adjacency->size ())
+    {
+      this->compactAdjacency ();
+    }
+
+    this->mesh.position (changes.position ());
+    this->mesh.scaling (changes.scaling ());
+    this->mesh.rotationMatrix (changes.rotationMatrix ());
+    this->distanceCache.reset ();
+    this->renderChunks.markAll ();
+    this->invalidateGeometry (false);
+
+    return this->untrackChanges ();
   }
 
-  template <typename T, typename... Ts>
-  bool intersectsT (const T& t, DynamicFaces& faces, const Ts&... args) const
+  bool changesDisplacedVertices (const DynamicMeshChanges& changes) const
   {
-    this->octree.intersects (t, [this, &t, &faces, &args...](unsigned int i) {
-      if (IntersectionUtil::intersects (t, this->face (i), args...))
+    for (const DynamicMeshChanges::Vertex& v : changes.vertices ())
+    {
+      if (this->layers.isDisplaced (v.index))
       {
-        faces.insert (i);
+        return true;
       }
-    });
-    faces.commit ();
-    return faces.isEmpty () == false;
-  }
-
-  template <typename T, typename... Ts>
-  bool containsOrIntersectsT (const T& t, DynamicFaces& faces, const Ts&... args) const
-  {
-    this->octree.intersects (t, [this, &t, &faces, &args...](bool contains, unsigned int i) {
-      if (contains || IntersectionUtil::intersects (t, this->face (i), args...))
+    }
+    for (unsigned int i = changes.numVertices (); i < this->vertexData.size (); i++)
+    {
+      if (this->layers.isDisplaced (i))
       {
-        faces.insert (i);
-        faces.commit ();
+        return true;
       }
-    });
-    return faces.isEmpty () == false;
+    }
+    return false;
   }
 
-  bool intersects (const PrimPlane& plane, DynamicFaces& faces) const
+  void recordLayer (unsigned int layer)
   {
-    return this->intersectsT<PrimPlane> (plane, faces);
-  }
+    const DynamicMeshChanges& changes = this->trackedChanges ();
+    const float               strength = this->layers.strength (layer);
 
-  bool intersects (const PrimSphere& sphere, DynamicFaces& faces) const
-  {
-    return this->containsOrIntersectsT<PrimSphere> (sphere, faces);
-  }
+    if (strength == 0.0f)
+    {
+      return;
+    }
 
-  bool intersects (const PrimAABox& box, DynamicFaces& faces) const
-  {
-    return this->containsOrIntersectsT<PrimAABox> (box, faces);
-  }
+    std::vector<unsigned int> added;
+    for (const DynamicMeshChanges::Vertex& v : changes.vertices ())
+    {
+      if (v.index < this->vertexData.size () && this->isFreeVertex (v.index) == false)
+      {
+        if (v.isFree)
+        {
+          added.push_back (v.index);
+        }
+        else if (this->mesh.vertex (v.index) != v.position)
+        {
+          this->layers.addDelta (layer, v.index, this->mesh.vertex (v.index) - v.position);
+        }
+      }
+    }
+    for (unsigned int i = changes.numVertices (); i < this->vertexData.size (); i++)
+    {
+      if (this->isFreeVertex (i) == false)
+      {
+        added.push_back (i);
+      }
+    }
 
-  float unsignedDistance (const glm::vec3& pos) const
-  {
-    return this->octree.distance (
-      pos, [this, &pos](unsigned int i) { return Distance::distance (this->face (i), pos); });
+    // averages are taken before any added vertex is displaced
+    std::vector<glm::vec3> deltas (added.size (), glm::vec3 (0.0f));
+    for (unsigned int i = 0; i < added.size (); i++)
+    {
+      unsigned int numDisplaced = 0;
+
+      this->self->forEachVertexAdjacentToVertex (added[i], [&](unsigned int v) {
+        if (this->layers.hasDelta (layer, v))
+        {
+          deltas[i] += this->layers.delta (layer, v);
+          numDisplaced++;
+        }
+      });
+      if (numDisplaced > 0)
+      {
+        deltas[i] *= strength / float(numDisplaced);
+      }
+    }
+    for (unsigned int i = 0; i < added.size (); i++)
+    {
+      if (deltas[i] != glm::vec3 (0.0f))
+      {
+        this->layers.addDelta (layer, added[i], deltas[i]);
+      }
+    }
   }
 
-  void normalize ()
+  void layerStrength (unsigned int layer, float strength)
   {
-    this->mesh.normalize ();
-    this->octree.reset ();
+    if (this->isCompact () && this->layers.numVertices (layer) > 0)
+    {
+      this->expand ();
+    }
 
-    this->forEachFace ([this](unsigned int i) { this->addFaceToOctree (i); });
+    DynamicFaces faces;
+    this->layers.strength (layer, strength,
+                           [this, &faces](unsigned int i, const glm::vec3& offset) {
+                             this->vertex (i, this->mesh.vertex (i) + offset);
+                             for (unsigned int f : this->adjacentFaces (this->vertexData[i]))
+                             {
+                               faces.insert (f);
+                             }
+                           });
+
+    if (faces.isEmpty () == false)
+    {
+      faces.commit ();
+      this->deferNormals (faces);
+      this->deferRealignment (faces);
+      this->bufferData ();
+    }
   }
 
-  void printStatistics () const { this->octree.printStatistics (); }
-
   void runFromConfig (const Config& config)
   {
     this->mesh.color (config.get<Color> ("editor/mesh/color/normal"));
     this->mesh.wireframeColor (config.get<Color> ("editor/mesh/color/wireframe"));
+    this->setUseBvh (config.get<bool> ("editor/mesh/use-bvh"));
+    this->setUseDistanceCache (config.get<bool> ("editor/mesh/cache-distances"));
+    this->setUseEdgeFaces (config.get<bool> ("editor/mesh/index-edges"));
+    this->setUseGpuNormals (config.get<bool> ("editor/mesh/gpu-normals"));
+    this->setCullRenderClusters (config.get<bool> ("editor/mesh/cull-clusters"));
+    this->reorderOnPrune = config.get<bool> ("editor/mesh/reorder-on-prune");
+    this->optimizeIndexOrder = config.get<bool> ("editor/mesh/optimize-index-order");
+    this->octree.configure (
+      (unsigned int) (glm::max (0, config.get<int> ("editor/mesh/octree/leaf-size"))),
+      glm::clamp (config.get<float> ("editor/mesh/octree/min-element-extent"), 0.05f, 0.45f));
   }
 };
 
 DELEGATE_BIG4_COPY_SELF (DynamicMesh)
 DELEGATE1_CONSTRUCTOR_SELF (DynamicMesh, const Mesh&)
+DELEGATE2_CONSTRUCTOR_SELF (DynamicMesh, const std::vector<glm::vec3>&,
+                            const std::vector<unsigned int>&)
 DELEGATE_CONST (unsigned int, DynamicMesh, numVertices)
 DELEGATE_CONST (unsigned int, DynamicMesh, numFaces)
 DELEGATE_CONST (bool, DynamicMesh, isEmpty)
 DELEGATE1_CONST (bool, DynamicMesh, isFreeVertex, unsigned int)
+DELEGATE1_CONST (bool, DynamicMesh, isFrozen, unsigned int)
 DELEGATE1_CONST (bool, DynamicMesh, isFreeFace, unsigned int)
 DELEGATE1_MEMBER_CONST (const glm::vec3&, DynamicMesh, vertex, mesh, unsigned int)
 DELEGATE1_CONST (unsigned int, DynamicMesh, valence, unsigned int)
@@ -1006,19 +4245,15 @@ DELEGATE4_CONST (void, DynamicMesh, vertexIndices, unsigned int, unsigned int&,
 DELEGATE1_CONST (PrimTriangle, DynamicMesh, face, unsigned int)
 DELEGATE1_CONST (const glm::vec3&, DynamicMesh, vertexNormal, unsigned int)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, faceNormal, unsigned int)
-DELEGATE1_CONST (const std::vector<unsigned int>&, DynamicMesh, adjacentFaces, unsigned int)
+DELEGATE1_CONST (DynamicAdjacentFaces, DynamicMesh, adjacentFaces, unsigned int)
 GETTER_CONST (const Mesh&, DynamicMesh, mesh)
-DELEGATE1_CONST (void, DynamicMesh, forEachVertex, const std::function<void(unsigned int)>&)
-DELEGATE2 (void, DynamicMesh, forEachVertex, const DynamicFaces&,
-           const std::function<void(unsigned int)>&)
-DELEGATE2 (void, DynamicMesh, forEachVertexExt, const DynamicFaces&,
-           const std::function<void(unsigned int)>&)
-DELEGATE2_CONST (void, DynamicMesh, forEachVertexAdjacentToVertex, unsigned int,
-                 const std::function<void(unsigned int)>&)
-DELEGATE2_CONST (void, DynamicMesh, forEachVertexAdjacentToFace, unsigned int,
-                 const std::function<void(unsigned int)>&)
-DELEGATE1_CONST (void, DynamicMesh, forEachFace, const std::function<void(unsigned int)>&)
-DELEGATE2 (void, DynamicMesh, forEachFaceExt, const DynamicFaces&,
+DELEGATE_CONST (unsigned int, DynamicMesh, vertexCapacity)
+DELEGATE_CONST (unsigned int, DynamicMesh, faceCapacity)
+DELEGATE_CONST (DynamicVisitedPool::Scope, DynamicMesh, vertexMarks)
+DELEGATE_CONST (DynamicVisitedPool::Scope, DynamicMesh, faceMarks)
+DELEGATE1_CONST (std::vector<unsigned int>, DynamicMesh, vertices, const DynamicFaces&)
+DELEGATE1_CONST (std::vector<unsigned int>, DynamicMesh, verticesExt, const DynamicFaces&)
+DELEGATE2_CONST (void, DynamicMesh, forEachFaceExt, const DynamicFaces&,
            const std::function<void(unsigned int)>&)
 DELEGATE3_CONST (void, DynamicMesh, average, const DynamicFaces&, glm::vec3&, glm::vec3&)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, averagePosition, const DynamicFaces&)
@@ -1031,34 +4266,79 @@ DELEGATE2 (unsigned int, DynamicMesh, addVertex, const glm::vec3&, const glm::ve
 DELEGATE3 (unsigned int, DynamicMesh, addFace, unsigned int, unsigned int, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteVertex, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteFace, unsigned int)
-DELEGATE2_MEMBER (void, DynamicMesh, vertex, mesh, unsigned int, const glm::vec3&)
+DELEGATE2 (void, DynamicMesh, vertex, unsigned int, const glm::vec3&)
+DELEGATE2 (void, DynamicMesh, freeze, unsigned int, bool)
 DELEGATE2 (void, DynamicMesh, vertexNormal, unsigned int, const glm::vec3&)
 DELEGATE1 (void, DynamicMesh, setVertexNormal, unsigned int)
 DELEGATE (void, DynamicMesh, setAllNormals)
+DELEGATE1 (void, DynamicMesh, setVertexNormals, const DynamicFaces&)
+DELEGATE1 (void, DynamicMesh, deferNormals, const DynamicFaces&)
+DELEGATE (void, DynamicMesh, updateNormals)
 DELEGATE (void, DynamicMesh, reset)
 DELEGATE1 (void, DynamicMesh, fromMesh, const Mesh&)
+DELEGATE2 (bool, DynamicMesh, fromMesh, const Mesh&, const DynamicMeshLayout&)
+DELEGATE2 (void, DynamicMesh, fromArrays, const std::vector<glm::vec3>&,
+           const std::vector<unsigned int>&)
+DELEGATE3 (void, DynamicMesh, fromArrays, const std::vector<glm::vec3>&,
+           const std::vector<glm::vec3>&, const std::vector<unsigned int>&)
 DELEGATE1 (void, DynamicMesh, realignFace, unsigned int)
 DELEGATE1 (void, DynamicMesh, realignFaces, const DynamicFaces&)
 DELEGATE (void, DynamicMesh, realignAllFaces)
+DELEGATE1 (void, DynamicMesh, deferRealignment, const DynamicFaces&)
 DELEGATE (void, DynamicMesh, sanitize)
+DELEGATE1 (void, DynamicMesh, sanitize, const DynamicFaces&)
 DELEGATE2 (void, DynamicMesh, prune, std::vector<unsigned int>*, std::vector<unsigned int>*)
+DELEGATE1 (void, DynamicMesh, reorder, bool)
+DELEGATE1 (unsigned int, DynamicMesh, defragment, unsigned int)
 DELEGATE2 (bool, DynamicMesh, pruneAndCheckConsistency, std::vector<unsigned int>*,
            std::vector<unsigned int>*)
 DELEGATE1 (bool, DynamicMesh, mirrorPositive, const PrimPlane&)
 DELEGATE1 (void, DynamicMesh, mirror, const PrimPlane&)
 DELEGATE (void, DynamicMesh, moveToCenter)
 DELEGATE (void, DynamicMesh, normalizeScaling)
+DELEGATE1 (void, DynamicMesh, transform, const glm::mat4x4&)
 DELEGATE (void, DynamicMesh, bufferData)
+DELEGATE1 (void, DynamicMesh, beginStroke, bool)
+DELEGATE (void, DynamicMesh, endStroke)
+DELEGATE (DynamicMeshSnapshotPtr, DynamicMesh, snapshot)
+DELEGATE (void, DynamicMesh, compact)
+DELEGATE (void, DynamicMesh, expand)
+DELEGATE_CONST (bool, DynamicMesh, isCompact)
 DELEGATE1_CONST (void, DynamicMesh, render, Camera&)
+DELEGATE2_CONST (void, DynamicMesh, render, Camera&, bool)
+DELEGATE1_CONST (void, DynamicMesh, prepareRendering, const Camera&)
+DELEGATE_CONST (std::size_t, DynamicMesh, renderKey)
 DELEGATE_MEMBER_CONST (const RenderMode&, DynamicMesh, renderMode, mesh)
 DELEGATE_MEMBER (RenderMode&, DynamicMesh, renderMode, mesh)
+DELEGATE1 (void, DynamicMesh, clipPlane, const PrimPlane*)
 
+DELEGATE_CONST (PrimAABox, DynamicMesh, bounds)
+DELEGATE_CONST (float, DynamicMesh, area)
 DELEGATE3_CONST (bool, DynamicMesh, intersects, const PrimRay&, Intersection&, bool)
+DELEGATE3_CONST (bool, DynamicMesh, intersectsAny, const PrimRay&, float, bool)
+DELEGATE3_CONST (bool, DynamicMesh, intersects, const PrimRay&,
+                 const std::function<bool(unsigned int)>&, Intersection&)
 DELEGATE2 (bool, DynamicMesh, intersects, const PrimRay&, DynamicMeshIntersection&)
+DELEGATE3_CONST (void, DynamicMesh, intersects, const PrimRay&, std::vector<Intersection>&,
+                 bool)
+DELEGATE3_CONST (void, DynamicMesh, intersects, const std::vector<PrimRay>&,
+                 std::vector<Intersection>&, bool)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimPlane&, DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimSphere&, DynamicFaces&)
+DELEGATE3_CONST (bool, DynamicMesh, intersects, const PrimSphere&, const glm::vec3&,
+                 DynamicFaces&)
+DELEGATE2_CONST (bool, DynamicMesh, intersectsUnclipped, const PrimSphere&, DynamicFaces&)
+DELEGATE3_CONST (bool, DynamicMesh, intersectsUnclipped, const PrimSphere&, const glm::vec3&,
+                 DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimAABox&, DynamicFaces&)
 DELEGATE1_CONST (float, DynamicMesh, unsignedDistance, const glm::vec3&)
+DELEGATE3_CONST (float, DynamicMesh, unsignedDistance, const glm::vec3&, float, unsigned int&)
+DELEGATE2_CONST (void, DynamicMesh, unsignedDistances, const std::vector<glm::vec3>&,
+                 std::vector<float>&)
+DELEGATE2_CONST (void, DynamicMesh, nearestPoints, const std::vector<glm::vec3>&,
+                 std::vector<glm::vec3>&)
+DELEGATE3_CONST (void, DynamicMesh, cachedUnsignedDistances, const std::vector<glm::vec3>&,
+                 std::vector<float>&, float)
 
 DELEGATE (void, DynamicMesh, normalize)
 DELEGATE1_MEMBER (void, DynamicMesh, scale, mesh, const glm::vec3&)
@@ -1084,6 +4364,22 @@ DELEGATE_MEMBER_CONST (const Color&, DynamicMesh, wireframeColor, mesh)
 DELEGATE1_MEMBER (void, DynamicMesh, wireframeColor, mesh, const Color&)
 
 DELEGATE_CONST (void, DynamicMesh, printStatistics)
+DELEGATE_CONST (DynamicOctreeStatistics, DynamicMesh, octreeStatistics)
+DELEGATE_CONST (DynamicMeshLayout, DynamicMesh, layout)
+DELEGATE_CONST (std::size_t, DynamicMesh, numBytes)
+DELEGATE_CONST (std::size_t, DynamicMesh, numBufferBytes)
+DELEGATE (void, DynamicMesh, releaseCaches)
+DELEGATE (void, DynamicMesh, releaseStagingBuffers)
+DELEGATE_CONST (unsigned int, DynamicMesh, id)
+GETTER_CONST (unsigned int, DynamicMesh, topologyRevision)
+DELEGATE (void, DynamicMesh, trackChanges)
+DELEGATE_CONST (bool, DynamicMesh, tracksChanges)
+DELEGATE_CONST (const DynamicMeshChanges&, DynamicMesh, trackedChanges)
+DELEGATE (DynamicMeshChanges, DynamicMesh, untrackChanges)
+DELEGATE1 (DynamicMeshChanges, DynamicMesh, applyChanges, const DynamicMeshChanges&)
+GETTER_CONST (const DynamicMeshLayers&, DynamicMesh, layers)
+DELEGATE1 (void, DynamicMesh, recordLayer, unsigned int)
+DELEGATE2 (void, DynamicMesh, layerStrength, unsigned int, float)
 DELEGATE1 (void, DynamicMesh, runFromConfig, const Config&)
 
 void DynamicMesh::findAdjacent (unsigned int e1, unsigned int e2, unsigned int& leftFace,
@@ -1092,3 +4388,37 @@ void DynamicMesh::findAdjacent (unsigned int e1, unsigned int e2, unsigned int&
 {
   return this->impl->findAdjacent (e1, e2, leftFace, leftVertex, rightFace, rightVertex);
 }
+
+void DynamicMesh::forEachVertex (const std::function<void(unsigned int)>& f) const
+{
+  this->forEachVertex<std::function<void(unsigned int)>> (f);
+}
+
+void DynamicMesh::forEachVertex (const DynamicFaces&                       faces,
+                                 const std::function<void(unsigned int)>& f) const
+{
+  this->forEachVertex<std::function<void(unsigned int)>> (faces, f);
+}
+
+void DynamicMesh::forEachVertexExt (const DynamicFaces&                       faces,
+                                    const std::function<void(unsigned int)>& f) const
+{
+  this->forEachVertexExt<std::function<void(unsigned int)>> (faces, f);
+}
+
+void DynamicMesh::forEachVertexAdjacentToVertex (unsigned int                             i,
+                                                 const std::function<void(unsigned int)>& f) const
+{
+  this->forEachVertexAdjacentToVertex<std::function<void(unsigned int)>> (i, f);
+}
+
+void DynamicMesh::forEachVertexAdjacentToFace (unsigned int                             i,
+                                               const std::function<void(unsigned int)>& f) const
+{
+  this->forEachVertexAdjacentToFace<std::function<void(unsigned int)>> (i, f);
+}
+
+void DynamicMesh::forEachFace (const std::function<void(unsigned int)>& f) const
+{
+  this->forEachFace<std::function<void(unsigned int)>> (f);
+}
@@ -5,16 +5,24 @@
 #ifndef DILAY_DYNAMIC_MESH
 #define DILAY_DYNAMIC_MESH
 
+#include <cassert>
 #include <functional>
 #include <glm/fwd.hpp>
+#include <memory>
 #include <vector>
 #include "configurable.hpp"
+#include "dynamic/octree.hpp"
+#include "dynamic/visited.hpp"
 #include "macro.hpp"
+#include "util.hpp"
 
 class Camera;
 class Color;
 class DynamicFaces;
+class DynamicMeshChanges;
 class DynamicMeshIntersection;
+class DynamicMeshLayers;
+struct DynamicMeshSnapshot;
 class Intersection;
 class Mesh;
 class PrimAABox;
@@ -24,17 +32,56 @@ class PrimSphere;
 class PrimTriangle;
 class RenderMode;
 
+// a view of the faces adjacent to a vertex, invalidated by any change of the mesh's faces
+class DynamicAdjacentFaces
+{
+public:
+  DynamicAdjacentFaces (const unsigned int* b, unsigned int n)
+    : _begin (b)
+    , _size (n)
+  {
+  }
+
+  const unsigned int* begin () const { return this->_begin; }
+  const unsigned int* end () const { return this->_begin + this->_size; }
+  unsigned int        size () const { return this->_size; }
+  bool                empty () const { return this->_size == 0; }
+
+  unsigned int operator[] (unsigned int i) const
+  {
+    assert (i < this->_size);
+    return this->_begin[i];
+  }
+
+private:
+  const unsigned int* _begin;
+  unsigned int        _size;
+};
+
+// the adjacent faces of each vertex and the octree of a pruned mesh
+struct DynamicMeshLayout
+{
+  DynamicOctreeLayout       octree;
+  std::vector<unsigned int> valences;
+  std::vector<unsigned int> adjacency;
+
+  bool isEmpty () const { return this->valences.empty (); }
+};
+
 class DynamicMesh : public Configurable
 {
 public:
   DECLARE_BIG4_EXPLICIT_COPY (DynamicMesh);
   DynamicMesh (const Mesh&);
+  DynamicMesh (const std::vector<glm::vec3>&, const std::vector<unsigned int>&);
 
   unsigned int     numVertices () const;
   unsigned int     numFaces () const;
   bool             isEmpty () const;
   bool             isFreeVertex (unsigned int) const;
   bool             isFreeFace (unsigned int) const;
+  // frozen vertices are excluded from sculpting and from changes of the topology around them
+  bool             isFrozen (unsigned int) const;
   const glm::vec3& vertex (unsigned int) const;
   unsigned int     valence (unsigned int) const;
   void             vertexIndices (unsigned int, unsigned int&, unsigned int&, unsigned int&) const;
@@ -44,15 +91,140 @@ public:
   void findAdjacent (unsigned int, unsigned int, unsigned int&, unsigned int&, unsigned int&,
                      unsigned int&) const;
 
-  const std::vector<unsigned int>& adjacentFaces (unsigned int) const;
+  DynamicAdjacentFaces adjacentFaces (unsigned int) const;
+
+  // number of vertices and faces including free ones
+  unsigned int vertexCapacity () const;
+  unsigned int faceCapacity () const;
+
+  // vertices of faces (and of their adjacent faces) in the order visited by forEachVertex(Ext)
+  std::vector<unsigned int> vertices (const DynamicFaces&) const;
+  std::vector<unsigned int> verticesExt (const DynamicFaces&) const;
+
+  /* The templated iteration functions inline their callbacks and are chosen for lambdas.
+   * The std::function overloads are kept for callers that store their callbacks.
+   */
+  template <typename F> void forEachVertex (const F& f) const
+  {
+    for (unsigned int i = 0; i < this->vertexCapacity (); i++)
+    {
+      if (this->isFreeVertex (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
+
+  // marks of a traversal of vertices or faces, cf. `DynamicVisitedPool`
+  DynamicVisitedPool::Scope vertexMarks () const;
+  DynamicVisitedPool::Scope faceMarks () const;
+
+  template <typename F> void forEachVertex (const DynamicFaces& faces, const F& f) const
+  {
+    const DynamicVisitedPool::Scope vertexVisited = this->vertexMarks ();
+
+    for (unsigned int i : faces)
+    {
+      this->forEachVertexAdjacentToFace (i, [&vertexVisited, &f](unsigned int j) {
+        if (vertexVisited->visit (j))
+        {
+          f (j);
+        }
+      });
+    }
+  }
+
+  template <typename F> void forEachVertexExt (const DynamicFaces& faces, const F& f) const
+  {
+    const DynamicVisitedPool::Scope vertexVisited = this->vertexMarks ();
+    const DynamicVisitedPool::Scope faceVisited = this->faceMarks ();
+
+    const auto visit = [&vertexVisited, &f](unsigned int j) {
+      if (vertexVisited->visit (j))
+      {
+        f (j);
+      }
+    };
+
+    for (unsigned int i : faces)
+    {
+      this->forEachVertexAdjacentToFace (i, [this, &vertexVisited, &faceVisited, &f,
+                                             &visit](unsigned int j) {
+        if (vertexVisited->visit (j))
+        {
+          f (j);
+
+          for (unsigned int a : this->adjacentFaces (j))
+          {
+            if (faceVisited->visit (a))
+            {
+              this->forEachVertexAdjacentToFace (a, visit);
+            }
+          }
+        }
+      });
+      faceVisited->visit (i);
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToVertex (unsigned int i, const F& f) const
+  {
+    assert (this->isFreeVertex (i) == false);
+
+    for (unsigned int a : this->adjacentFaces (i))
+    {
+      unsigned int a1, a2, a3;
+      this->vertexIndices (a, a1, a2, a3);
+
+      if (i == a1)
+      {
+        f (a2);
+      }
+      else if (i == a2)
+      {
+        f (a3);
+      }
+      else if (i == a3)
+      {
+        f (a1);
+      }
+      else
+      {
+        DILAY_IMPOSSIBLE
+      }
+    }
+  }
+
+  template <typename F> void forEachVertexAdjacentToFace (unsigned int i, const F& f) const
+  {
+    assert (this->isFreeFace (i) == false);
+
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    f (i1);
+    f (i2);
+    f (i3);
+  }
+
+  template <typename F> void forEachFace (const F& f) const
+  {
+    for (unsigned int i = 0; i < this->faceCapacity (); i++)
+    {
+      if (this->isFreeFace (i) == false)
+      {
+        f (i);
+      }
+    }
+  }
 
   void forEachVertex (const std::function<void(unsigned int)>&) const;
-  void forEachVertex (const DynamicFaces&, const std::function<void(unsigned int)>&);
-  void forEachVertexExt (const DynamicFaces&, const std::function<void(unsigned int)>&);
+  void forEachVertex (const DynamicFaces&, const std::function<void(unsigned int)>&) const;
+  void forEachVertexExt (const DynamicFaces&, const std::function<void(unsigned int)>&) const;
   void forEachVertexAdjacentToVertex (unsigned int, const std::function<void(unsigned int)>&) const;
   void forEachVertexAdjacentToFace (unsigned int, const std::function<void(unsigned int)>&) const;
   void forEachFace (const std::function<void(unsigned int)>&) const;
-  void forEachFaceExt (const DynamicFaces&, const std::function<void(unsigned int)>&);
+  void forEachFaceExt (const DynamicFaces&, const std::function<void(unsigned int)>&) const;
 
   void      average (const DynamicFaces&, glm::vec3&, glm::vec3&) const;
   glm::vec3 averagePosition (const DynamicFaces&) const;
@@ -69,36 +241,118 @@ public:
   void         deleteFace (unsigned int);
 
   void vertex (unsigned int, const glm::vec3&);
+  void freeze (unsigned int, bool);
   void vertexNormal (unsigned int, const glm::vec3&);
   void setVertexNormal (unsigned int);
   void setAllNormals ();
+  void setVertexNormals (const DynamicFaces&);
+  // the normals of the vertices of the given faces are set by `updateNormals`, which must be
+  // called before normals are read (it is called when buffering data or tracking changes)
+  void deferNormals (const DynamicFaces&);
+  void updateNormals ();
 
   void reset ();
   void fromMesh (const Mesh&);
+  // restores the adjacency and the octree from a layout, or returns false if it does not fit
+  bool fromMesh (const Mesh&, const DynamicMeshLayout&);
+  // bulk construction from vertices, (optional) normals and indices, which does not buffer data
+  void fromArrays (const std::vector<glm::vec3>&, const std::vector<unsigned int>&);
+  void fromArrays (const std::vector<glm::vec3>&, const std::vector<glm::vec3>&,
+                   const std::vector<unsigned int>&);
   void realignFace (unsigned int);
   void realignFaces (const DynamicFaces&);
   void realignAllFaces ();
+  // realigns the faces before the octree is queried next
+  void deferRealignment (const DynamicFaces&);
   void sanitize ();
+  // realigns the given faces, whose geometry has changed, and sanitizes the mesh
+  void sanitize (const DynamicFaces&);
   void prune (std::vector<unsigned int>* = nullptr, std::vector<unsigned int>* = nullptr);
+  /* reorders vertices and faces for rendering (as configured for pruning) and buffers the mesh
+   * unless the argument is false, e.g., when reordering on another thread
+   */
+  void reorder (bool = true);
+  /* moves at most the given number of vertices and faces into free slots and drops free slots at
+   * the end, buffers the mesh if it changed, and returns the number of moved elements
+   */
+  unsigned int defragment (unsigned int);
   bool pruneAndCheckConsistency (std::vector<unsigned int>* = nullptr,
                                  std::vector<unsigned int>* = nullptr);
   bool mirrorPositive (const PrimPlane&);
   void mirror (const PrimPlane&);
   void moveToCenter ();
   void normalizeScaling ();
+  void transform (const glm::mat4x4&);
   void bufferData ();
+  /* While a stroke is active, the faces that it modifies can be buffered as a separate batch and
+   * the rest of the buffered mesh is kept, until the stroke ends and the mesh is buffered again.
+   * Normals of the buffered mesh may be recomputed on the GPU during a stroke (if configured).
+   */
+  void beginStroke (bool);
+  void endStroke ();
+  /* Pins the latest version of the mesh for readers on other threads, which is published first
+   * if the mesh has changed.  Once pinned, a mesh publishes a new version whenever it is buffered,
+   * e.g., after each sculpting step, which only copies pages that have been written since.
+   */
+  std::shared_ptr<const DynamicMeshSnapshot> snapshot ();
+  /* A compact mesh only keeps quantized vertices for rendering and releases its adjacency and
+   * acceleration structures, which are rebuilt when it is expanded.  Compact meshes are not
+   * intersected unless they are expanded by intersecting them with a `DynamicMeshIntersection`.
+   */
+  void compact ();
+  void expand ();
+  bool isCompact () const;
 
-  void render (Camera&) const;
+  void        render (Camera&) const;
+  // renders a simplified proxy if it is preferred, e.g., while the camera is moving
+  void        render (Camera&, bool) const;
+  // computes data of the next rendering, which may be called concurrently for different meshes
+  void        prepareRendering (const Camera&) const;
+  // includes the batch of an active stroke
+  std::size_t renderKey () const;
 
   const RenderMode& renderMode () const;
   RenderMode&       renderMode ();
 
-  bool  intersects (const PrimRay&, Intersection&, bool = false) const;
-  bool  intersects (const PrimRay&, DynamicMeshIntersection&);
-  bool  intersects (const PrimPlane&, DynamicFaces&) const;
-  bool  intersects (const PrimSphere&, DynamicFaces&) const;
-  bool  intersects (const PrimAABox&, DynamicFaces&) const;
-  float unsignedDistance (const glm::vec3&) const;
+  /* Faces in front of a clip plane (in the direction of its normal) are hidden, i.e., chunks of
+   * clipped faces are not rendered, rays only hit faces behind the plane and
+   * `intersectsUnclipped` does not collect clipped faces.  Faces that cross the plane are kept.
+   * `nullptr` disables clipping.
+   */
+  void clipPlane (const PrimPlane*);
+
+  PrimAABox bounds () const;
+  float     area () const;
+  bool      intersects (const PrimRay&, Intersection&, bool = false) const;
+  // whether any face is hit nearer than the given distance, e.g., to test occlusions
+  bool      intersectsAny (const PrimRay&, float, bool = false) const;
+  // only intersects (front sides of) faces that pass a filter
+  bool      intersects (const PrimRay&, const std::function<bool(unsigned int)>&,
+                        Intersection&) const;
+  bool      intersects (const PrimRay&, DynamicMeshIntersection&);
+  // collects all intersections along a ray sorted by distance
+  void      intersects (const PrimRay&, std::vector<Intersection>&, bool = false) const;
+  // intersects each ray of a batch (results are stored at the ray's index)
+  void      intersects (const std::vector<PrimRay>&, std::vector<Intersection>&,
+                        bool = false) const;
+  bool      intersects (const PrimPlane&, DynamicFaces&) const;
+  bool      intersects (const PrimSphere&, DynamicFaces&) const;
+  // only collects faces whose normals point into the half-space of the given direction
+  bool      intersects (const PrimSphere&, const glm::vec3&, DynamicFaces&) const;
+  // like the sphere queries above, but skips clipped faces (cf. `clipPlane`)
+  bool      intersectsUnclipped (const PrimSphere&, DynamicFaces&) const;
+  bool      intersectsUnclipped (const PrimSphere&, const glm::vec3&, DynamicFaces&) const;
+  bool      intersects (const PrimAABox&, DynamicFaces&) const;
+  float     unsignedDistance (const glm::vec3&) const;
+  // searches faces nearer than the given distance and records the nearest one found
+  float     unsignedDistance (const glm::vec3&, float, unsigned int&) const;
+  // computes the distances of neighboring positions coherently
+  void      unsignedDistances (const std::vector<glm::vec3>&, std::vector<float>&) const;
+  // computes the nearest points on the surface of a batch of positions in parallel
+  void      nearestPoints (const std::vector<glm::vec3>&, std::vector<glm::vec3>&) const;
+  // looks up distances of sample positions of the given resolution in the distance cache
+  void      cachedUnsignedDistances (const std::vector<glm::vec3>&, std::vector<float>&,
+                                     float) const;
 
   void               normalize ();
   void               scale (const glm::vec3&);
@@ -123,7 +377,41 @@ public:
   const Color&       wireframeColor () const;
   void               wireframeColor (const Color&);
 
-  void printStatistics () const;
+  void                    printStatistics () const;
+  DynamicOctreeStatistics octreeStatistics () const;
+  // refers to the vertices and faces of the pruned mesh, and is empty if the mesh is compact
+  DynamicMeshLayout       layout () const;
+  // the memory of the mesh and its acceleration structures, including tracked changes
+  std::size_t             numBytes () const;
+  std::size_t             numBufferBytes () const;
+  // drops the level-of-detail proxy and the distance cache, which are rebuilt on demand
+  void                    releaseCaches ();
+  void                    releaseStagingBuffers ();
+
+  // a copy is a new mesh with a new id that does not track changes
+  unsigned int id () const;
+  // changes whenever faces are added or deleted
+  unsigned int topologyRevision () const;
+
+  /* Tracking records the previous data of each modified vertex and face.  Applying tracked
+   * changes restores that data and returns the changes that undo the application.
+   */
+  void                      trackChanges ();
+  bool                      tracksChanges () const;
+  const DynamicMeshChanges& trackedChanges () const;
+  DynamicMeshChanges        untrackChanges ();
+  DynamicMeshChanges        applyChanges (const DynamicMeshChanges&);
+
+  /* Sculpt layers (cf. DynamicMeshLayers) are dropped, i.e., baked into the mesh, when applied
+   * changes move any of their vertices or when the whole mesh is transformed.
+   */
+  const DynamicMeshLayers& layers () const;
+  /* Adds the displacements of the tracked changes to a layer.  Vertices that have been added in
+   * the meantime are displaced like the average of their displaced neighbors.
+   */
+  void                     recordLayer (unsigned int);
+  // moves the vertices of a layer to a new strength and buffers the mesh
+  void                     layerStrength (unsigned int, float);
 
 private:
   IMPLEMENTATION
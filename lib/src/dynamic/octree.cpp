@@ -2,18 +2,23 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
 #include <functional>
 #include <glm/glm.hpp>
 #include <iostream>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include "dynamic/octree.hpp"
 #include "intersection.hpp"
-#include "maybe.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
+#include "primitive/ray.hpp"
 #include "primitive/sphere.hpp"
+#include "profile.hpp"
 #include "util.hpp"
 
 #ifdef DILAY_RENDER_OCTREE
@@ -24,42 +29,124 @@
 
 namespace
 {
-  struct IndexOctreeNode;
-  typedef Maybe<IndexOctreeNode> Child;
+  // number of levels below the root that a bulk build can reach
+  static const unsigned int mortonLevels = 21;
 
-  struct IndexOctreeStatistics
+  // leaves deeper than this are not split, e.g., if elements share their positions
+  constexpr int maxSplitDepth = 32;
+
+  // maximal number of elements that are passed to a callback at a time
+  static const unsigned int elementGroupSize = 8;
+
+  struct BuildElement
   {
-    typedef std::unordered_map<int, unsigned int> DepthMap;
+    uint64_t     code;
+    unsigned int level;
+    unsigned int index;
 
-    unsigned int numNodes;
-    unsigned int numElements;
-    int          minDepth;
-    int          maxDepth;
-    unsigned int maxElementsPerNode;
-    DepthMap     numElementsPerDepth;
-    DepthMap     numNodesPerDepth;
+    // elements that stop at a node come before the elements of its children
+    bool operator< (const BuildElement& other) const
+    {
+      return this->code < other.code || (this->code == other.code && this->level < other.level);
+    }
   };
 
-  struct IndexOctreeNode
+  // sorts chunks in parallel and merges them pairwise in parallel rounds
+  void parallelSort (std::vector<BuildElement>& elements)
+  {
+    const unsigned int n = elements.size ();
+    const unsigned int chunkSize =
+      glm::max (1u << 12, (n + Parallel::numThreads () - 1) / Parallel::numThreads ());
+
+    Parallel::forRange (n, chunkSize, [&elements](unsigned int begin, unsigned int end) {
+      std::sort (elements.begin () + begin, elements.begin () + end);
+    });
+
+    for (unsigned int width = chunkSize; width < n; width *= 2)
+    {
+      const unsigned int numMerges = (n + (2 * width) - 1) / (2 * width);
+
+      Parallel::forEach (numMerges, [&elements, n, width](unsigned int i) {
+        const unsigned int begin = 2 * width * i;
+        const unsigned int middle = glm::min (begin + width, n);
+        const unsigned int end = glm::min (begin + (2 * width), n);
+
+        std::inplace_merge (elements.begin () + begin, elements.begin () + middle,
+                            elements.begin () + end);
+      });
+    }
+  }
+
+  /* The rays of a batch are stored as arrays of origins and inverse directions, so the slab test
+   * of a node's box against all active rays is a tight loop over plain floats.
+   */
+  struct RayBatch
   {
-    const glm::vec3                  center;
-    const float                      width;
-    const int                        depth;
-    const PrimAABox                  looseAABox;
-    std::array<Child, 8>             children;
-    std::unordered_set<unsigned int> indices;
+    std::vector<glm::vec3>    origins;
+    std::vector<glm::vec3>    invDirections;
+    std::vector<bool>         isLine;
+    std::vector<float>        distances;
+    std::vector<unsigned int> active;
+
+    RayBatch (const std::vector<PrimRay>& rays)
+      : distances (rays.size (), Util::maxFloat ())
+    {
+      this->origins.reserve (rays.size ());
+      this->invDirections.reserve (rays.size ());
+      this->isLine.reserve (rays.size ());
+      this->active.reserve (2 * rays.size ());
+
+      for (unsigned int i = 0; i < rays.size (); i++)
+      {
+        this->origins.push_back (rays[i].origin ());
+        this->invDirections.push_back (rays[i].invDirection ());
+        this->isLine.push_back (rays[i].isLine ());
+        this->active.push_back (i);
+      }
+    }
+
+    // cf. `IntersectionUtil::intersects (const PrimRay&, const PrimAABox&, float*)`
+    bool intersects (unsigned int r, const glm::vec3& min, const glm::vec3& max) const
+    {
+      const glm::vec3 lowerTs = (min - this->origins[r]) * this->invDirections[r];
+      const glm::vec3 upperTs = (max - this->origins[r]) * this->invDirections[r];
+      const glm::vec3 tMins = glm::min (lowerTs, upperTs);
+      const glm::vec3 tMaxs = glm::max (lowerTs, upperTs);
+
+      const float tMin = glm::max (glm::max (tMins.x, tMins.y), tMins.z);
+      const float tMax = glm::min (glm::min (tMaxs.x, tMaxs.y), tMaxs.z);
+
+      return (tMax >= 0.0f || this->isLine[r]) && tMin <= tMax && tMin < this->distances[r];
+    }
+  };
 
-    static constexpr float relativeMinElementExtent = 0.25f;
+  struct IndexOctreeNode
+  {
+    glm::vec3                   center;
+    float                       width;
+    int                         depth;
+    std::array<unsigned int, 8> children;
+    unsigned int                parent;
+    unsigned int                firstElement;
+    unsigned int                numElements;
+    unsigned int                numSubtreeElements;
 
     IndexOctreeNode (const glm::vec3& c, float w, int d)
       : center (c)
       , width (w)
       , depth (d)
-      , looseAABox (c, 2.0f * w, 2.0f * w, 2.0f * w)
+      , parent (Util::invalidIndex ())
+      , firstElement (Util::invalidIndex ())
+      , numElements (0)
+      , numSubtreeElements (0)
     {
-      static_assert (IndexOctreeNode::relativeMinElementExtent < 0.5f,
-                     "relativeMinElementExtent must be smaller than 0.5f");
       assert (w > 0.0f);
+      this->children.fill (Util::invalidIndex ());
+    }
+
+    PrimAABox looseAABox () const
+    {
+      return PrimAABox (this->center, 2.0f * this->width, 2.0f * this->width, 2.0f * this->width);
     }
 
     bool approxContains (const glm::vec3& position, float maxDimExtent) const
@@ -98,339 +185,246 @@ namespace
       return index;
     }
 
-    bool hasChildren () const
-    {
-      return bool(this->children[0]) || bool(this->children[1]) || bool(this->children[2]) ||
-             bool(this->children[3]) || bool(this->children[4]) || bool(this->children[5]) ||
-             bool(this->children[6]) || bool(this->children[7]);
-    }
+    bool hasChild (unsigned int i) const { return this->children[i] != Util::invalidIndex (); }
 
-    bool insertIntoChild (float maxDimExtent) const
-    {
-      return maxDimExtent <= this->width * IndexOctreeNode::relativeMinElementExtent;
-    }
+    // free nodes have no width
+    bool isFree () const { return this->width == 0.0f; }
 
-    IndexOctreeNode& insertIntoChild (unsigned int index, const glm::vec3& position,
-                                      float maxDimExtent)
+    bool hasChildren () const
     {
-      const unsigned int childIndex = this->childIndex (position);
-
-      if (this->children[childIndex] == false)
+      for (unsigned int i = 0; i < 8; i++)
       {
-        const float q = this->width * 0.25f;
-        const float width = this->width * 0.5f;
-        const int   depth = this->depth + 1;
-
-        switch (childIndex)
+        if (this->hasChild (i))
         {
-          case 0:
-            this->children[0] = Child::make (this->center + glm::vec3 (-q, -q, -q), width, depth);
-            break;
-          case 1:
-            this->children[1] = Child::make (this->center + glm::vec3 (-q, -q, +q), width, depth);
-            break;
-          case 2:
-            this->children[2] = Child::make (this->center + glm::vec3 (-q, +q, -q), width, depth);
-            break;
-          case 3:
-            this->children[3] = Child::make (this->center + glm::vec3 (-q, +q, +q), width, depth);
-            break;
-          case 4:
-            this->children[4] = Child::make (this->center + glm::vec3 (+q, -q, -q), width, depth);
-            break;
-          case 5:
-            this->children[5] = Child::make (this->center + glm::vec3 (+q, -q, +q), width, depth);
-            break;
-          case 6:
-            this->children[6] = Child::make (this->center + glm::vec3 (+q, +q, -q), width, depth);
-            break;
-          case 7:
-            this->children[7] = Child::make (this->center + glm::vec3 (+q, +q, +q), width, depth);
-            break;
+          return true;
         }
       }
-      return this->children[childIndex]->addElement (index, position, maxDimExtent);
+      return false;
     }
 
-    IndexOctreeNode& addElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+    bool fitsIntoChild (float maxDimExtent, float relativeMinElementExtent) const
     {
-      assert (this->approxContains (position, maxDimExtent));
-
-      if (this->insertIntoChild (maxDimExtent))
-      {
-        return this->insertIntoChild (index, position, maxDimExtent);
-      }
-      else
-      {
-        this->indices.insert (index);
-        return *this;
-      }
+      return maxDimExtent <= this->width * relativeMinElementExtent;
     }
+  };
+}
+
+/* Nodes are stored in a contiguous array and address their children by index.  The elements of
+ * each node form a doubly-linked list whose links are stored in arrays addressed by element, which
+ * also map each element to its node.  Copying an octree thus copies a few flat arrays.
+ *
+ * An element is stored in the deepest node whose children are too small for it, unless a leaf
+ * gathers it: leaves keep up to `maxLeafElements` elements and are split once they overflow, and
+ * sparse subtrees are merged into leaves when empty children are deleted.  Regions of small faces
+ * (e.g., after refining a mesh locally) are thus not split into long chains of sparse nodes.
+ * Elements restored from a layout have unknown bounds and stay in their node when it is split.
+ *
+ * Nodes know their parents and the number of elements of their subtrees.  Nodes that lose
+ * elements are recorded, so that sparse subtrees and empty nodes are merged and deleted locally
+ * instead of sweeping the whole octree.
+ */
+struct DynamicOctree::Impl
+{
+  std::vector<IndexOctreeNode> nodes;
+  std::vector<unsigned int>    freeNodes;
+  unsigned int                 root;
+  std::vector<unsigned int>    elementNodes;
+  std::vector<unsigned int>    nextElements;
+  std::vector<unsigned int>    previousElements;
+  std::vector<glm::vec4>       elementBounds;
+  std::vector<unsigned int>    changedNodes;
+  unsigned int                 maxLeafElements;
+  float                        relativeMinElementExtent;
+
+  Impl ()
+    : root (Util::invalidIndex ())
+    , maxLeafElements (8)
+    , relativeMinElementExtent (0.25f)
+  {
+  }
+
+  void configure (unsigned int maxLeaf, float relativeExtent)
+  {
+    assert (relativeExtent > 0.0f && relativeExtent < 0.5f);
+
+    this->maxLeafElements = maxLeaf;
+    this->relativeMinElementExtent = relativeExtent;
+  }
+
+  bool fitsIntoChild (unsigned int n, float maxDimExtent) const
+  {
+    return this->nodes[n].fitsIntoChild (maxDimExtent, this->relativeMinElementExtent);
+  }
 
-    bool isEmpty () const { return this->indices.empty () && this->hasChildren () == false; }
+  bool hasRoot () const { return this->root != Util::invalidIndex (); }
+
+  void setupRoot (const glm::vec3& position, float width)
+  {
+    assert (this->hasRoot () == false);
+    this->root = this->makeNode (position, width, 0);
+  }
 
-    void deleteElement (unsigned int index)
+  unsigned int makeNode (const glm::vec3& center, float width, int depth)
+  {
+    if (this->freeNodes.empty ())
     {
-      unsigned int n = this->indices.erase (index);
-      assert (n > 0);
-      unused (n);
+      this->nodes.emplace_back (center, width, depth);
+      return this->nodes.size () - 1;
     }
-
-    bool deleteEmptyChildren ()
+    else
     {
-      bool allChildrenEmpty = true;
+      const unsigned int n = this->freeNodes.back ();
+      this->freeNodes.pop_back ();
+      this->nodes[n] = IndexOctreeNode (center, width, depth);
+      return n;
+    }
+  }
 
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          if (this->children[i]->deleteEmptyChildren ())
-          {
-            this->children[i].reset ();
-          }
-          else
-          {
-            allChildrenEmpty = false;
-          }
-        }
-      }
+  void freeNode (unsigned int n)
+  {
+    assert (this->isEmpty (n));
+    this->nodes[n].width = 0.0f;
+    this->freeNodes.push_back (n);
+  }
 
-      if (allChildrenEmpty)
-      {
-        assert (this->hasChildren () == false);
-        return this->indices.empty ();
-      }
-      else
-      {
-        return false;
-      }
-    }
+  // frees an empty subtree
+  void freeSubtree (unsigned int n)
+  {
+    assert (this->nodes[n].numSubtreeElements == 0);
 
-#ifdef DILAY_RENDER_OCTREE
-    void render (Camera& camera, Mesh& nodeMesh) const
+    for (unsigned int i = 0; i < 8; i++)
     {
-      nodeMesh.position (this->center);
-      nodeMesh.scaling (glm::vec3 (this->width * 0.5f));
-      nodeMesh.renderLines (camera);
-
-      for (unsigned int i = 0; i < 8; i++)
+      if (this->nodes[n].hasChild (i))
       {
-        if (this->children[i])
-        {
-          this->children[i]->render (camera, nodeMesh);
-        }
+        this->freeSubtree (this->nodes[n].children[i]);
+        this->nodes[n].children[i] = Util::invalidIndex ();
       }
     }
-#endif
+    this->freeNode (n);
+  }
 
-    template <typename T>
-    void containsOrIntersectsT (const T&                                           t,
-                                const DynamicOctree::ContainsIntersectionCallback& f) const
-    {
-      const bool contains = t.contains (this->looseAABox);
+  void detachFromParent (unsigned int n)
+  {
+    IndexOctreeNode& parent = this->nodes[this->nodes[n].parent];
 
-      if (contains || IntersectionUtil::intersects (t, this->looseAABox))
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (parent.children[i] == n)
       {
-        for (unsigned int index : this->indices)
-        {
-          f (contains, index);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->containsOrIntersectsT<T> (t, f);
-          }
-        }
+        parent.children[i] = Util::invalidIndex ();
       }
     }
+    this->nodes[n].parent = Util::invalidIndex ();
+  }
+
+  bool isEmpty (unsigned int n) const
+  {
+    return this->nodes[n].numElements == 0 && this->nodes[n].hasChildren () == false;
+  }
 
-    template <typename T>
-    void intersectsT (const T& t, const DynamicOctree::IntersectionCallback& f) const
+  void addToSubtrees (unsigned int n, int delta)
+  {
+    for (; n != Util::invalidIndex (); n = this->nodes[n].parent)
     {
-      if (IntersectionUtil::intersects (t, this->looseAABox))
-      {
-        for (unsigned int index : this->indices)
-        {
-          f (index);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->intersectsT<T> (t, f);
-          }
-        }
-      }
+      assert (delta > 0 || this->nodes[n].numSubtreeElements > 0);
+      this->nodes[n].numSubtreeElements += delta;
     }
+  }
 
-    void intersects (const PrimRay& ray, float& distance,
-                     const DynamicOctree::RayIntersectionCallback& f) const
+  template <typename F> void forEachElement (const IndexOctreeNode& node, const F& f) const
+  {
+    for (unsigned int e = node.firstElement; e != Util::invalidIndex ();
+         e = this->nextElements[e])
     {
-      float t;
-      if (IntersectionUtil::intersects (ray, this->looseAABox, &t) && t < distance)
-      {
-        for (unsigned int index : this->indices)
-        {
-          distance = glm::min (f (index), distance);
-        }
-        for (unsigned int i = 0; i < 8; i++)
-        {
-          if (this->children[i])
-          {
-            this->children[i]->intersects (ray, distance, f);
-          }
-        }
-      }
+      f (e);
     }
+  }
 
-    void distance (PrimSphere& sphere, const DynamicOctree::DistanceCallback& getDistance) const
+  void linkElement (unsigned int n, unsigned int index)
+  {
+    if (index >= this->elementNodes.size ())
     {
-      for (unsigned int i : this->indices)
-      {
-        const float distance = getDistance (i);
-        if (distance < sphere.radius ())
-        {
-          sphere.radius (distance);
-        }
-      }
-
-      const unsigned int first = this->childIndex (sphere.center ());
-      const bool         hasFirst = bool(this->children[first]);
-      if (hasFirst && IntersectionUtil::intersects (sphere, this->children[first]->looseAABox))
-      {
-        this->children[first]->distance (sphere, getDistance);
-      }
-
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        const bool hasChild = i != first && bool(this->children[i]);
-        if (hasChild && IntersectionUtil::intersects (sphere, this->children[i]->looseAABox))
-        {
-          this->children[i]->distance (sphere, getDistance);
-        }
-      }
+      this->elementNodes.resize (index + 1, Util::invalidIndex ());
+      this->nextElements.resize (index + 1, Util::invalidIndex ());
+      this->previousElements.resize (index + 1, Util::invalidIndex ());
     }
-
-    unsigned int numElements () const { return this->indices.size (); }
-
-    void updateIndices (const std::vector<unsigned int>& indexMap)
+    if (index >= this->elementBounds.size ())
     {
-      std::unordered_set<unsigned int> newIndices;
-
-      for (unsigned int i : this->indices)
-      {
-        assert (indexMap[i] != Util::invalidIndex ());
+      this->elementBounds.resize (index + 1, glm::vec4 (-1.0f));
+    }
+    assert (this->elementNodes[index] == Util::invalidIndex ());
 
-        newIndices.insert (indexMap[i]);
-      }
-      this->indices = std::move (newIndices);
+    IndexOctreeNode& node = this->nodes[n];
 
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          this->children[i]->updateIndices (indexMap);
-        }
-      }
-    }
+    this->elementNodes[index] = n;
+    this->previousElements[index] = Util::invalidIndex ();
+    this->nextElements[index] = node.firstElement;
 
-    void updateStatistics (IndexOctreeStatistics& stats) const
+    if (node.firstElement != Util::invalidIndex ())
     {
-      stats.numNodes += 1;
-      stats.numElements += this->numElements ();
-      stats.minDepth = glm::min (stats.minDepth, this->depth);
-      stats.maxDepth = glm::max (stats.maxDepth, this->depth);
-      stats.maxElementsPerNode = glm::max (stats.maxElementsPerNode, this->numElements ());
-
-      auto e = stats.numElementsPerDepth.find (this->depth);
-      if (e == stats.numElementsPerDepth.end ())
-      {
-        stats.numElementsPerDepth.emplace (this->depth, this->numElements ());
-      }
-      else
-      {
-        e->second = e->second + this->numElements ();
-      }
-      e = stats.numNodesPerDepth.find (this->depth);
-      if (e == stats.numNodesPerDepth.end ())
-      {
-        stats.numNodesPerDepth.emplace (this->depth, 1);
-      }
-      else
-      {
-        e->second = e->second + 1;
-      }
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (this->children[i])
-        {
-          this->children[i]->updateStatistics (stats);
-        }
-      }
+      this->previousElements[node.firstElement] = index;
     }
-  };
-}
-
-struct DynamicOctree::Impl
-{
-  Child                         root;
-  std::vector<IndexOctreeNode*> elementNodeMap;
-
-  Impl () {}
+    node.firstElement = index;
+    node.numElements++;
+    this->addToSubtrees (n, 1);
+  }
 
-  Impl (const Impl& other)
-    : root (other.root)
+  void unlinkElement (unsigned int index)
   {
-    this->makeElementNodeMap ();
-  }
+    assert (index < this->elementNodes.size ());
+    assert (this->elementNodes[index] != Util::invalidIndex ());
 
-  bool hasRoot () const { return bool(this->root); }
+    IndexOctreeNode&   node = this->nodes[this->elementNodes[index]];
+    const unsigned int next = this->nextElements[index];
+    const unsigned int previous = this->previousElements[index];
 
-  void setupRoot (const glm::vec3& position, float width)
-  {
-    assert (this->hasRoot () == false);
-    this->root = IndexOctreeNode (position, width, 0);
+    if (previous == Util::invalidIndex ())
+    {
+      node.firstElement = next;
+    }
+    else
+    {
+      this->nextElements[previous] = next;
+    }
+    if (next != Util::invalidIndex ())
+    {
+      this->previousElements[next] = previous;
+    }
+    assert (node.numElements > 0);
+    node.numElements--;
+    this->addToSubtrees (this->elementNodes[index], -1);
+    this->changedNodes.push_back (this->elementNodes[index]);
+    this->elementNodes[index] = Util::invalidIndex ();
   }
 
-  void makeElementNodeMap ()
+  unsigned int makeChild (unsigned int n, const glm::vec3& position)
   {
-    std::function<void(IndexOctreeNode&)> traverse = [this, &traverse](IndexOctreeNode& node) {
-      for (unsigned i : node.indices)
-      {
-        this->addToElementNodeMap (i, node);
-      }
-      for (unsigned int i = 0; i < 8; i++)
-      {
-        if (node.children[i])
-        {
-          traverse (*node.children[i]);
-        }
-      }
-    };
-    if (this->root)
-    {
-      traverse (*this->root);
-    }
+    return this->makeChild (n, this->nodes[n].childIndex (position));
   }
 
-  void addToElementNodeMap (unsigned int index, IndexOctreeNode& node)
+  unsigned int makeChild (unsigned int n, unsigned int childIndex)
   {
-    if (index >= this->elementNodeMap.size ())
+    if (this->nodes[n].hasChild (childIndex) == false)
     {
-      this->elementNodeMap.resize (index + 1, nullptr);
+      const float     q = this->nodes[n].width * 0.25f;
+      const glm::vec3 offset ((childIndex & 4) ? q : -q, (childIndex & 2) ? q : -q,
+                              (childIndex & 1) ? q : -q);
+      const unsigned int child = this->makeNode (this->nodes[n].center + offset,
+                                                 this->nodes[n].width * 0.5f,
+                                                 this->nodes[n].depth + 1);
+      this->nodes[n].children[childIndex] = child;
+      this->nodes[child].parent = n;
     }
-    assert (this->elementNodeMap[index] == nullptr);
-    this->elementNodeMap[index] = &node;
+    return this->nodes[n].children[childIndex];
   }
 
   void makeParent (const glm::vec3& position)
   {
     assert (this->hasRoot ());
 
-    const glm::vec3 rootCenter = this->root->center;
-    const float     rootWidth = this->root->width;
-    const float     halfRootWidth = this->root->width * 0.5f;
+    const glm::vec3 rootCenter = this->nodes[this->root].center;
+    const float     rootWidth = this->nodes[this->root].width;
+    const float     halfRootWidth = rootWidth * 0.5f;
     glm::vec3       parentCenter;
     int             index = 0;
 
@@ -456,108 +450,467 @@ struct DynamicOctree::Impl
       index += 1;
     }
 
-    IndexOctreeNode* newRoot =
-      new IndexOctreeNode (parentCenter, rootWidth * 2.0f, this->root->depth - 1);
-    newRoot->children[index] = std::move (this->root);
-    this->root.reset (newRoot);
+    const unsigned int newRoot =
+      this->makeNode (parentCenter, rootWidth * 2.0f, this->nodes[this->root].depth - 1);
+    this->nodes[newRoot].children[index] = this->root;
+    this->nodes[newRoot].numSubtreeElements = this->nodes[this->root].numSubtreeElements;
+    this->nodes[this->root].parent = newRoot;
+    this->root = newRoot;
   }
 
   void addElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
   {
+    DILAY_ALLOCATION_SCOPE ("octree");
+
     assert (this->hasRoot ());
 
-    if (this->root->approxContains (position, maxDimExtent))
+    while (this->nodes[this->root].approxContains (position, maxDimExtent) == false)
     {
-      IndexOctreeNode& node = this->root->addElement (index, position, maxDimExtent);
-      this->addToElementNodeMap (index, node);
+      this->makeParent (position);
     }
-    else
+
+    unsigned int n = this->root;
+    while (this->nodes[n].hasChildren () && this->fitsIntoChild (n, maxDimExtent))
     {
-      this->makeParent (position);
-      this->addElement (index, position, maxDimExtent);
+      n = this->makeChild (n, position);
+    }
+    assert (this->nodes[n].approxContains (position, maxDimExtent));
+    this->linkElement (n, index);
+    this->elementBounds[index] = glm::vec4 (position, maxDimExtent);
+
+    if (this->nodes[n].hasChildren () == false &&
+        this->nodes[n].numElements > this->maxLeafElements)
+    {
+      this->split (n);
     }
   }
 
-  void realignElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+  // moves the elements of an overflowing leaf that fit into its children one level down
+  void split (unsigned int n)
   {
-    assert (this->hasRoot ());
-    assert (index < this->elementNodeMap.size ());
-    assert (this->elementNodeMap[index]);
+    if (this->nodes[n].depth - this->nodes[this->root].depth >= maxSplitDepth)
+    {
+      return;
+    }
+
+    std::vector<unsigned int> moved;
+    this->forEachElement (this->nodes[n], [this, n, &moved](unsigned int e) {
+      const float extent = this->elementBounds[e].w;
+
+      if (extent >= 0.0f && this->fitsIntoChild (n, extent))
+      {
+        moved.push_back (e);
+      }
+    });
 
-    IndexOctreeNode* node = this->elementNodeMap[index];
+    for (unsigned int e : moved)
+    {
+      this->unlinkElement (e);
+      this->linkElement (this->makeChild (n, glm::vec3 (this->elementBounds[e])), e);
+    }
 
-    if (node->approxContains (position, maxDimExtent) == false ||
-        node->insertIntoChild (maxDimExtent))
+    for (unsigned int i = 0; i < 8; i++)
     {
-      this->deleteElement (index);
-      this->addElement (index, position, maxDimExtent);
+      const unsigned int child = this->nodes[n].children[i];
+
+      if (child != Util::invalidIndex () &&
+          this->nodes[child].numElements > this->maxLeafElements)
+      {
+        this->split (child);
+      }
     }
   }
 
-  void deleteElement (unsigned int index)
+  /* Builds the octree from scratch: elements are sorted by the Morton codes of their positions
+   * within the bounds of all elements, so the elements of each node form a contiguous range.
+   * Each element is put at the level a single insertion would put it (up to `mortonLevels`).
+   */
+  void build (const std::vector<unsigned int>& indices, const std::vector<glm::vec4>& elements)
   {
-    assert (index < this->elementNodeMap.size ());
-    assert (this->elementNodeMap[index]);
+    DILAY_PROFILE_ZONE ("DynamicOctree::build");
+    DILAY_ALLOCATION_SCOPE ("octree");
 
-    this->elementNodeMap[index]->deleteElement (index);
-    this->elementNodeMap[index] = nullptr;
+    assert (indices.size () == elements.size ());
 
-    if (this->hasRoot ())
+    this->reset ();
+
+    if (elements.empty ())
+    {
+      return;
+    }
+
+    glm::vec3 min (Util::maxFloat ());
+    glm::vec3 max (Util::minFloat ());
+    float     maxExtent = 0.0f;
+
+    for (const glm::vec4& e : elements)
     {
-      if (this->root->isEmpty ())
+      min = glm::min (min, glm::vec3 (e));
+      max = glm::max (max, glm::vec3 (e));
+      maxExtent = glm::max (maxExtent, e.w);
+    }
+
+    const glm::vec3 extent = max - min;
+    const float width = glm::max (Util::epsilon (), glm::max (glm::max (extent.x, extent.y),
+                                                             glm::max (extent.z, maxExtent)));
+    const glm::vec3 corner = ((min + max) * 0.5f) - glm::vec3 (width * 0.5f);
+    const float     scale = float(1 << mortonLevels) / width;
+    const float     maxCoordinate = float((1 << mortonLevels) - 1);
+
+    std::vector<BuildElement> buildElements (elements.size ());
+
+    Parallel::forEach (elements.size (), [&](unsigned int i) {
+      const glm::vec3 q =
+        glm::clamp ((glm::vec3 (elements[i]) - corner) * scale, glm::vec3 (0.0f),
+                    glm::vec3 (maxCoordinate));
+      const uint64_t code =
+        Util::mortonCode ((unsigned int) (q.x), (unsigned int) (q.y), (unsigned int) (q.z));
+      unsigned int level = 0;
+      float        levelWidth = width;
+
+      while (level < mortonLevels && elements[i].w <= levelWidth * this->relativeMinElementExtent)
       {
-        this->root.reset ();
+        levelWidth *= 0.5f;
+        level++;
       }
-      else
+
+      const unsigned int shift = 3 * (mortonLevels - level);
+      buildElements[i].code = shift < 64 ? (code >> shift) << shift : 0;
+      buildElements[i].level = level;
+      buildElements[i].index = indices[i];
+    });
+    parallelSort (buildElements);
+
+    for (unsigned int i = 0; i < indices.size (); i++)
+    {
+      if (indices[i] >= this->elementBounds.size ())
       {
-        this->shrinkRoot ();
+        this->elementBounds.resize (indices[i] + 1, glm::vec4 (-1.0f));
       }
+      this->elementBounds[indices[i]] = elements[i];
     }
+
+    this->root = this->makeNode ((min + max) * 0.5f, width, 0);
+    this->build (this->root, buildElements, 0, buildElements.size (), 0);
   }
 
-  void deleteEmptyChildren ()
+  // a range of at most `maxLeafElements` elements is gathered by a leaf
+  void build (unsigned int n, const std::vector<BuildElement>& elements, unsigned int begin,
+              unsigned int end, unsigned int level)
   {
-    if (this->hasRoot ())
+    unsigned int i = begin;
+
+    if (end - begin <= this->maxLeafElements)
     {
-      if (this->root->deleteEmptyChildren ())
+      for (; i < end; i++)
       {
-        this->root.reset ();
+        this->linkElement (n, elements[i].index);
       }
+      return;
     }
-  }
 
-  void updateIndices (const std::vector<unsigned int>& newIndices)
-  {
-    for (unsigned int i = 0; i < newIndices.size (); i++)
+    for (; i < end && elements[i].level == level; i++)
     {
-      const unsigned int newI = newIndices[i];
-      if (newI != Util::invalidIndex () && newI != i)
-      {
-        assert (i < this->elementNodeMap.size ());
-        assert (newI < this->elementNodeMap.size ());
-        assert (this->elementNodeMap[i]);
-        assert (this->elementNodeMap[newI] == nullptr);
-
-        this->elementNodeMap[newI] = this->elementNodeMap[i];
-        this->elementNodeMap[i] = nullptr;
-      }
+      this->linkElement (n, elements[i].index);
     }
-    this->elementNodeMap.resize (newIndices.size ());
 
-    if (this->hasRoot ())
+    const unsigned int shift = 3 * (mortonLevels - level - 1);
+
+    while (i < end)
     {
-      this->root->updateIndices (newIndices);
+      const unsigned int childIndex = (elements[i].code >> shift) & 7;
+      unsigned int       childEnd = i + 1;
+
+      while (childEnd < end && ((elements[childEnd].code >> shift) & 7) == childIndex)
+      {
+        childEnd++;
+      }
+      const unsigned int child = this->makeChild (n, childIndex);
+      this->build (child, elements, i, childEnd, level + 1);
+      i = childEnd;
     }
   }
 
-  void shrinkRoot ()
+  bool isElement (unsigned int index) const
   {
-    if (this->hasRoot () && this->root->indices.empty () && this->root->hasChildren ())
-    {
-      int singleNonEmptyChildIndex = -1;
+    return index < this->elementNodes.size () && this->elementNodes[index] != Util::invalidIndex ();
+  }
+
+  // an element fits its node if it is contained but does not fit into a child
+  bool fits (unsigned int index, const glm::vec3& position, float maxDimExtent) const
+  {
+    if (this->isElement (index) == false)
+    {
+      return false;
+    }
+    const unsigned int n = this->elementNodes[index];
+
+    return this->nodes[n].approxContains (position, maxDimExtent) &&
+           (this->nodes[n].hasChildren () == false ||
+            this->fitsIntoChild (n, maxDimExtent) == false);
+  }
+
+  void realignElement (unsigned int index, const glm::vec3& position, float maxDimExtent)
+  {
+    DILAY_ALLOCATION_SCOPE ("octree");
+
+    assert (this->hasRoot ());
+    assert (index < this->elementNodes.size ());
+    assert (this->elementNodes[index] != Util::invalidIndex ());
+
+    if (this->fits (index, position, maxDimExtent) == false)
+    {
+      this->deleteElement (index);
+      this->addElement (index, position, maxDimExtent);
+    }
+    else
+    {
+      this->elementBounds[index] = glm::vec4 (position, maxDimExtent);
+    }
+  }
+
+  /* Elements are tested in parallel, and the bounds of fitting elements are updated before the
+   * others are moved, so that splitting nodes sees the new bounds.
+   */
+  bool refit (const std::vector<unsigned int>& indices, const std::vector<glm::vec4>& elements,
+              float maxMoved)
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::refit");
+    DILAY_ALLOCATION_SCOPE ("octree");
+
+    assert (indices.size () == elements.size ());
+
+    if (this->hasRoot () == false)
+    {
+      return false;
+    }
+
+    std::vector<unsigned char> isMoved (indices.size ());
+    Parallel::forEach (indices.size (), [this, &indices, &elements, &isMoved](unsigned int i) {
+      isMoved[i] = this->fits (indices[i], glm::vec3 (elements[i]), elements[i].w) ? 0 : 1;
+    });
+
+    const std::size_t numMoved = std::size_t (std::count (isMoved.begin (), isMoved.end (), 1));
+    if (float(numMoved) > maxMoved * float(indices.size ()))
+    {
+      return false;
+    }
+
+    for (unsigned int i = 0; i < indices.size (); i++)
+    {
+      if (isMoved[i] == 0)
+      {
+        this->elementBounds[indices[i]] = elements[i];
+      }
+    }
+    for (unsigned int i = 0; i < indices.size (); i++)
+    {
+      const unsigned int index = indices[i];
+
+      if (isMoved[i] && this->isElement (index))
+      {
+        this->realignElement (index, glm::vec3 (elements[i]), elements[i].w);
+      }
+      else if (isMoved[i])
+      {
+        this->addElement (index, glm::vec3 (elements[i]), elements[i].w);
+      }
+    }
+    return true;
+  }
+
+  void deleteElement (unsigned int index)
+  {
+    this->unlinkElement (index);
+
+    if (this->hasRoot ())
+    {
+      if (this->nodes[this->root].numSubtreeElements == 0)
+      {
+        this->freeSubtree (this->root);
+        this->root = Util::invalidIndex ();
+      }
+      else
+      {
+        this->shrinkRoot ();
+      }
+    }
+  }
+
+  // moves the elements of the descendants of a node into a leaf and deletes the descendants
+  void mergeChildren (unsigned int n, unsigned int leaf)
+  {
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      const unsigned int child = this->nodes[n].children[i];
+
+      if (child != Util::invalidIndex ())
+      {
+        this->mergeChildren (child, leaf);
+
+        while (this->nodes[child].firstElement != Util::invalidIndex ())
+        {
+          const unsigned int e = this->nodes[child].firstElement;
+
+          this->unlinkElement (e);
+          this->linkElement (leaf, e);
+        }
+        this->freeNode (child);
+        this->nodes[n].children[i] = Util::invalidIndex ();
+      }
+    }
+  }
+
+  /* Only visits the ancestors of nodes that lost elements: the highest ancestor whose subtree
+   * fills at most half of a leaf is merged into a leaf, so that merged leaves do not overflow
+   * right away, and empty nodes are deleted bottom-up.
+   */
+  void deleteEmptyChildren ()
+  {
+    std::vector<unsigned int> changed;
+    changed.swap (this->changedNodes);
+
+    std::sort (changed.begin (), changed.end ());
+    changed.erase (std::unique (changed.begin (), changed.end ()), changed.end ());
+
+    for (unsigned int n : changed)
+    {
+      if (this->hasRoot () == false)
+      {
+        break;
+      }
+      else if (n >= this->nodes.size () || this->nodes[n].isFree ())
+      {
+        continue;
+      }
+      unsigned int sparse = Util::invalidIndex ();
+      for (unsigned int a = n; a != Util::invalidIndex (); a = this->nodes[a].parent)
+      {
+        if (this->nodes[a].hasChildren () &&
+            2 * this->nodes[a].numSubtreeElements <= this->maxLeafElements)
+        {
+          sparse = a;
+        }
+      }
+      if (sparse != Util::invalidIndex ())
+      {
+        this->mergeChildren (sparse, sparse);
+        n = sparse;
+      }
+      while (n != this->root && this->isEmpty (n))
+      {
+        const unsigned int parent = this->nodes[n].parent;
+
+        this->detachFromParent (n);
+        this->freeNode (n);
+        n = parent;
+      }
+    }
+    this->changedNodes.clear ();
+
+    if (this->hasRoot ())
+    {
+      if (this->isEmpty (this->root))
+      {
+        this->freeNode (this->root);
+        this->root = Util::invalidIndex ();
+      }
+      if (2 * this->freeNodes.size () > this->nodes.size ())
+      {
+        this->compactNodes ();
+      }
+    }
+  }
+
+  // stores the nodes without gaps in depth-first order
+  void compactNodes ()
+  {
+    std::vector<IndexOctreeNode> compacted;
+    std::vector<unsigned int>    nodeMap (this->nodes.size (), Util::invalidIndex ());
+
+    compacted.reserve (this->nodes.size () - this->freeNodes.size ());
+
+    std::function<unsigned int(unsigned int)> copy = [this, &compacted, &nodeMap,
+                                                      &copy](unsigned int n) {
+      const unsigned int newN = compacted.size ();
+      compacted.push_back (this->nodes[n]);
+      nodeMap[n] = newN;
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (this->nodes[n].hasChild (i))
+        {
+          const unsigned int newChild = copy (this->nodes[n].children[i]);
+          compacted[newN].children[i] = newChild;
+          compacted[newChild].parent = newN;
+        }
+      }
+      return newN;
+    };
+
+    if (this->hasRoot ())
+    {
+      this->root = copy (this->root);
+    }
+    for (unsigned int& n : this->elementNodes)
+    {
+      if (n != Util::invalidIndex ())
+      {
+        assert (nodeMap[n] != Util::invalidIndex ());
+        n = nodeMap[n];
+      }
+    }
+    this->nodes = std::move (compacted);
+    this->freeNodes.clear ();
+  }
+
+  void updateIndices (const std::vector<unsigned int>& newIndices)
+  {
+    const auto map = [&newIndices](unsigned int i) {
+      assert (i == Util::invalidIndex () || i < newIndices.size ());
+      return i == Util::invalidIndex () ? i : newIndices[i];
+    };
+
+    std::vector<unsigned int> newElementNodes (newIndices.size (), Util::invalidIndex ());
+    std::vector<unsigned int> newNextElements (newIndices.size (), Util::invalidIndex ());
+    std::vector<unsigned int> newPreviousElements (newIndices.size (), Util::invalidIndex ());
+    std::vector<glm::vec4>    newElementBounds (newIndices.size (), glm::vec4 (-1.0f));
+
+    for (unsigned int i = 0; i < this->elementNodes.size (); i++)
+    {
+      if (this->elementNodes[i] != Util::invalidIndex ())
+      {
+        const unsigned int newI = map (i);
+        assert (newI != Util::invalidIndex ());
+        assert (newElementNodes[newI] == Util::invalidIndex ());
+
+        newElementNodes[newI] = this->elementNodes[i];
+        newNextElements[newI] = map (this->nextElements[i]);
+        newPreviousElements[newI] = map (this->previousElements[i]);
+        newElementBounds[newI] = this->elementBounds[i];
+      }
+    }
+    for (IndexOctreeNode& node : this->nodes)
+    {
+      node.firstElement = map (node.firstElement);
+    }
+    this->elementNodes = std::move (newElementNodes);
+    this->nextElements = std::move (newNextElements);
+    this->previousElements = std::move (newPreviousElements);
+    this->elementBounds = std::move (newElementBounds);
+  }
+
+  void shrinkRoot ()
+  {
+    while (this->hasRoot () && this->nodes[this->root].numElements == 0 &&
+           this->nodes[this->root].hasChildren ())
+    {
+      const IndexOctreeNode& rootNode = this->nodes[this->root];
+      int                    singleNonEmptyChildIndex = -1;
+
       for (int i = 0; i < 8; i++)
       {
-        if (this->root->children[i] && this->root->children[i]->isEmpty () == false)
+        if (rootNode.hasChild (i) && this->nodes[rootNode.children[i]].numSubtreeElements > 0)
         {
           if (singleNonEmptyChildIndex == -1)
           {
@@ -569,21 +922,59 @@ struct DynamicOctree::Impl
           }
         }
       }
-      if (singleNonEmptyChildIndex != -1)
+      if (singleNonEmptyChildIndex == -1)
       {
-        this->root = std::move (this->root->children[singleNonEmptyChildIndex]);
-        this->shrinkRoot ();
+        return;
+      }
+      else
+      {
+        const unsigned int newRoot = rootNode.children[singleNonEmptyChildIndex];
+
+        for (int i = 0; i < 8; i++)
+        {
+          if (i != singleNonEmptyChildIndex && rootNode.hasChild (i))
+          {
+            this->freeSubtree (rootNode.children[i]);
+          }
+        }
+        this->nodes[this->root].children.fill (Util::invalidIndex ());
+        this->freeNode (this->root);
+        this->root = newRoot;
+        this->nodes[newRoot].parent = Util::invalidIndex ();
       }
     }
   }
 
   void reset ()
   {
-    this->root.reset ();
-    this->elementNodeMap.clear ();
+    this->nodes.clear ();
+    this->freeNodes.clear ();
+    this->root = Util::invalidIndex ();
+    this->elementNodes.clear ();
+    this->nextElements.clear ();
+    this->previousElements.clear ();
+    this->elementBounds.clear ();
+    this->changedNodes.clear ();
   }
 
 #ifdef DILAY_RENDER_OCTREE
+  void render (unsigned int n, Camera& camera, Mesh& nodeMesh) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    nodeMesh.position (node.center);
+    nodeMesh.scaling (glm::vec3 (node.width * 0.5f));
+    nodeMesh.renderLines (camera);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->render (node.children[i], camera, nodeMesh);
+      }
+    }
+  }
+
   void render (Camera& camera) const
   {
     Mesh nodeMesh;
@@ -639,68 +1030,589 @@ struct DynamicOctree::Impl
 
     if (this->hasRoot ())
     {
-      this->root->render (camera, nodeMesh);
+      this->render (this->root, camera, nodeMesh);
     }
   }
 #else
   void render (Camera&) const { DILAY_IMPOSSIBLE }
 #endif
 
+  // the loose boxes of a node's children are contained in the node's loose box
+  template <typename F> void forEachSubtreeElement (unsigned int n, const F& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    this->forEachElement (node, f);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->forEachSubtreeElement (node.children[i], f);
+      }
+    }
+  }
+
+  template <typename T>
+  void containsOrIntersectsT (unsigned int n, const T& t,
+                              const DynamicOctree::ContainsIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    const PrimAABox        looseAABox = node.looseAABox ();
+
+    if (t.contains (looseAABox))
+    {
+      this->forEachSubtreeElement (n, [&f](unsigned int index) { f (true, index); });
+    }
+    else if (IntersectionUtil::intersects (t, looseAABox))
+    {
+      this->forEachElement (node, [&f](unsigned int index) { f (false, index); });
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->containsOrIntersectsT<T> (node.children[i], t, f);
+        }
+      }
+    }
+  }
+
+  template <typename T>
+  void containsOrIntersectsT (unsigned int n, const T& t, std::vector<unsigned int>& contained,
+                              std::vector<unsigned int>& intersected) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    const PrimAABox        looseAABox = node.looseAABox ();
+
+    if (t.contains (looseAABox))
+    {
+      this->forEachSubtreeElement (
+        n, [&contained](unsigned int index) { contained.push_back (index); });
+    }
+    else if (IntersectionUtil::intersects (t, looseAABox))
+    {
+      this->forEachElement (
+        node, [&intersected](unsigned int index) { intersected.push_back (index); });
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->containsOrIntersectsT<T> (node.children[i], t, contained, intersected);
+        }
+      }
+    }
+  }
+
+  /* The loose box of a node intersects a plane if the distance of its center is at most the
+   * projection of its half extent onto the plane's normal, where `extent` is the sum of the
+   * absolute components of the normal.  Subtrees on one side are skipped as a whole.
+   */
+  void intersects (unsigned int n, const PrimPlane& plane, float extent,
+                   const DynamicOctree::IntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    if (glm::abs (plane.distance (node.center)) <= node.width * extent)
+    {
+      this->forEachElement (node, f);
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersects (node.children[i], plane, extent, f);
+        }
+      }
+    }
+  }
+
+  /* Visits the nodes that a ray enters before `distance` from front to back.  The children of a
+   * node are pushed onto a stack in descending order of their entry distances, so that the
+   * nearest child is visited next and subtrees behind the nearest hit so far are skipped.  `f`
+   * is called with each visited node, updates `distance` and returns false to stop the traversal.
+   */
+  template <typename F>
+  void intersectsNodes (const PrimRay& ray, float& distance, const F& f) const
+  {
+    typedef std::pair<unsigned int, float> Entry;
+
+    float t;
+    if (IntersectionUtil::intersects (ray, this->nodes[this->root].looseAABox (), &t) == false ||
+        t >= distance)
+    {
+      return;
+    }
+
+    std::vector<Entry> stack;
+    stack.emplace_back (this->root, t);
+
+    while (stack.empty () == false)
+    {
+      const Entry entry = stack.back ();
+      stack.pop_back ();
+
+      if (entry.second >= distance)
+      {
+        continue;
+      }
+
+      const IndexOctreeNode& node = this->nodes[entry.first];
+      if (f (node) == false)
+      {
+        return;
+      }
+
+      std::array<Entry, 8> children;
+      unsigned int         numChildren = 0;
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i) &&
+            IntersectionUtil::intersects (ray, this->nodes[node.children[i]].looseAABox (), &t) &&
+            t < distance)
+        {
+          children[numChildren++] = Entry (node.children[i], t);
+        }
+      }
+      std::sort (children.begin (), children.begin () + numChildren,
+                 [](const Entry& a, const Entry& b) { return a.second > b.second; });
+
+      stack.insert (stack.end (), children.begin (), children.begin () + numChildren);
+    }
+  }
+
+  // calls `f` with groups of up to `elementGroupSize` elements of a node
+  template <typename F> bool forEachElementGroup (const IndexOctreeNode& node, const F& f) const
+  {
+    std::array<unsigned int, elementGroupSize> group;
+    unsigned int                               groupSize = 0;
+    bool                                       proceed = true;
+
+    this->forEachElement (node, [&f, &group, &groupSize, &proceed](unsigned int index) {
+      if (proceed)
+      {
+        group[groupSize++] = index;
+
+        if (groupSize == elementGroupSize)
+        {
+          proceed = f (group.data (), groupSize);
+          groupSize = 0;
+        }
+      }
+    });
+    if (proceed && groupSize > 0)
+    {
+      proceed = f (group.data (), groupSize);
+    }
+    return proceed;
+  }
+
   void intersects (const PrimRay& ray, const DynamicOctree::RayIntersectionCallback& f) const
   {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (ray)");
+
     if (this->hasRoot ())
     {
       float distance = Util::maxFloat ();
-      return this->root->intersects (ray, distance, f);
+      this->intersectsNodes (ray, distance, [this, &distance, &f](const IndexOctreeNode& node) {
+        this->forEachElement (node, [&distance, &f](unsigned int index) {
+          distance = glm::min (f (index), distance);
+        });
+        return true;
+      });
+    }
+  }
+
+  void intersects (const PrimRay&                                        ray,
+                   const DynamicOctree::RayElementsIntersectionCallback& f) const
+  {
+    this->intersects (ray, Util::maxFloat (), f);
+  }
+
+  void intersects (const PrimRay& ray, float maxDistance,
+                   const DynamicOctree::RayElementsIntersectionCallback& f) const
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (ray, groups)");
+
+    if (this->hasRoot ())
+    {
+      float distance = maxDistance;
+      this->intersectsNodes (ray, distance, [this, &distance, &f](const IndexOctreeNode& node) {
+        return this->forEachElementGroup (
+          node, [&distance, &f](const unsigned int* elements, unsigned int numElements) {
+            distance = glm::min (f (elements, numElements), distance);
+            return true;
+          });
+      });
+    }
+  }
+
+  bool intersectsAny (const PrimRay& ray, float maxDistance,
+                      const DynamicOctree::RayElementsAnyIntersectionCallback& f) const
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersectsAny");
+
+    bool isHit = false;
+
+    if (this->hasRoot ())
+    {
+      float distance = maxDistance;
+      this->intersectsNodes (ray, distance, [this, &isHit, &f](const IndexOctreeNode& node) {
+        return this->forEachElementGroup (
+          node, [&isHit, &f](const unsigned int* elements, unsigned int numElements) {
+            isHit = f (elements, numElements);
+            return isHit == false;
+          });
+      });
+    }
+    return isHit;
+  }
+
+  /* Traverses the octree once for all rays of a batch.  The rays that hit a node are appended to
+   * `batch.active` after the rays of its parent, so each subtree is visited with the subset of
+   * rays that reach it.
+   */
+  void intersects (unsigned int n, RayBatch& batch, unsigned int begin,
+                   const DynamicOctree::BatchRayIntersectionCallback& f) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+    const unsigned int     end = batch.active.size ();
+    const glm::vec3        min = node.center - glm::vec3 (node.width);
+    const glm::vec3        max = node.center + glm::vec3 (node.width);
+
+    for (unsigned int i = begin; i < end; i++)
+    {
+      if (batch.intersects (batch.active[i], min, max))
+      {
+        batch.active.push_back (batch.active[i]);
+      }
+    }
+
+    if (batch.active.size () > end)
+    {
+      this->forEachElement (node, [&batch, end, &f](unsigned int index) {
+        for (unsigned int i = end; i < batch.active.size (); i++)
+        {
+          const unsigned int r = batch.active[i];
+          batch.distances[r] = glm::min (f (r, index), batch.distances[r]);
+        }
+      });
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          this->intersects (node.children[i], batch, end, f);
+        }
+      }
+    }
+    batch.active.resize (end);
+  }
+
+  void intersects (const std::vector<PrimRay>&                        rays,
+                   const DynamicOctree::BatchRayIntersectionCallback& f) const
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (rays)");
+
+    if (this->hasRoot () && rays.empty () == false)
+    {
+      RayBatch batch (rays);
+      this->intersects (this->root, batch, 0, f);
     }
   }
 
   void intersects (const PrimPlane& plane, const DynamicOctree::IntersectionCallback& f) const
   {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (plane)");
+
     if (this->hasRoot ())
     {
-      return this->root->intersectsT<PrimPlane> (plane, f);
+      const glm::vec3 n = glm::abs (plane.normal ());
+      this->intersects (this->root, plane, n.x + n.y + n.z, f);
     }
   }
 
   void intersects (const PrimSphere&                                  sphere,
                    const DynamicOctree::ContainsIntersectionCallback& f) const
   {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (sphere)");
+
     if (this->hasRoot ())
     {
-      return this->root->containsOrIntersectsT<PrimSphere> (sphere, f);
+      this->containsOrIntersectsT<PrimSphere> (this->root, sphere, f);
     }
   }
 
   void intersects (const PrimAABox& box, const DynamicOctree::ContainsIntersectionCallback& f) const
   {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (box)");
+
     if (this->hasRoot ())
     {
-      return this->root->containsOrIntersectsT<PrimAABox> (box, f);
+      this->containsOrIntersectsT<PrimAABox> (this->root, box, f);
+    }
+  }
+
+  void intersects (const PrimSphere& sphere, std::vector<unsigned int>& contained,
+                   std::vector<unsigned int>& intersected) const
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (sphere, ranges)");
+
+    if (this->hasRoot ())
+    {
+      this->containsOrIntersectsT<PrimSphere> (this->root, sphere, contained, intersected);
+    }
+  }
+
+  void intersects (const PrimAABox& box, std::vector<unsigned int>& contained,
+                   std::vector<unsigned int>& intersected) const
+  {
+    DILAY_PROFILE_ZONE ("DynamicOctree::intersects (box, ranges)");
+
+    if (this->hasRoot ())
+    {
+      this->containsOrIntersectsT<PrimAABox> (this->root, box, contained, intersected);
+    }
+  }
+
+  void distance (unsigned int n, PrimSphere& sphere, const DistanceCallback& getDistance) const
+  {
+    const IndexOctreeNode& node = this->nodes[n];
+
+    this->forEachElement (node, [&sphere, &getDistance](unsigned int index) {
+      const float distance = getDistance (index);
+      if (distance < sphere.radius ())
+      {
+        sphere.radius (distance);
+      }
+    });
+
+    const unsigned int first = node.childIndex (sphere.center ());
+    if (node.hasChild (first) &&
+        IntersectionUtil::intersects (sphere, this->nodes[node.children[first]].looseAABox ()))
+    {
+      this->distance (node.children[first], sphere, getDistance);
+    }
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (i != first && node.hasChild (i) &&
+          IntersectionUtil::intersects (sphere, this->nodes[node.children[i]].looseAABox ()))
+      {
+        this->distance (node.children[i], sphere, getDistance);
+      }
     }
   }
 
   float distance (const glm::vec3& p, const DistanceCallback& getDistance) const
   {
     assert (this->hasRoot ());
-    PrimSphere sphere (p, Util::maxFloat ());
-    this->root->distance (sphere, getDistance);
+    return this->distance (p, Util::maxFloat (), getDistance);
+  }
+
+  float distance (const glm::vec3& p, float maxDistance, const DistanceCallback& getDistance) const
+  {
+    PrimSphere sphere (p, maxDistance);
+
+    if (this->hasRoot ())
+    {
+      this->distance (this->root, sphere, getDistance);
+    }
     return sphere.radius ();
   }
 
-  void printStatistics () const
+  void updateStatistics (unsigned int n, DynamicOctreeStatistics& stats) const
   {
-    IndexOctreeStatistics stats{0,
-                                0,
-                                Util::maxInt (),
-                                Util::minInt (),
-                                0,
-                                IndexOctreeStatistics::DepthMap (),
-                                IndexOctreeStatistics::DepthMap ()};
+    const IndexOctreeNode& node = this->nodes[n];
+
+    stats.numNodes += 1;
+    stats.numElements += node.numElements;
+    stats.minDepth = glm::min (stats.minDepth, node.depth);
+    stats.maxDepth = glm::max (stats.maxDepth, node.depth);
+    stats.maxElementsPerNode = glm::max (stats.maxElementsPerNode, node.numElements);
+
+    auto e = stats.numElementsPerDepth.find (node.depth);
+    if (e == stats.numElementsPerDepth.end ())
+    {
+      stats.numElementsPerDepth.emplace (node.depth, node.numElements);
+    }
+    else
+    {
+      e->second = e->second + node.numElements;
+    }
+    e = stats.numNodesPerDepth.find (node.depth);
+    if (e == stats.numNodesPerDepth.end ())
+    {
+      stats.numNodesPerDepth.emplace (node.depth, 1);
+    }
+    else
+    {
+      e->second = e->second + 1;
+    }
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (node.hasChild (i))
+      {
+        this->updateStatistics (node.children[i], stats);
+      }
+    }
+  }
+
+  DynamicOctreeStatistics statistics () const
+  {
+    DynamicOctreeStatistics stats{0,
+                                  0,
+                                  Util::maxInt (),
+                                  Util::minInt (),
+                                  0,
+                                  DynamicOctreeStatistics::DepthMap (),
+                                  DynamicOctreeStatistics::DepthMap ()};
+    if (this->hasRoot ())
+    {
+      this->updateStatistics (this->root, stats);
+    }
+    return stats;
+  }
+
+  std::size_t numBytes () const
+  {
+    return sizeof (DynamicOctree::Impl) + (this->nodes.capacity () * sizeof (IndexOctreeNode)) +
+           ((this->freeNodes.capacity () + this->elementNodes.capacity () +
+             this->nextElements.capacity () + this->previousElements.capacity ()) *
+            sizeof (unsigned int)) +
+           (this->elementBounds.capacity () * sizeof (glm::vec4));
+  }
+
+  DynamicOctreeLayout layout () const
+  {
+    DynamicOctreeLayout layout;
+
+    std::function<void(unsigned int)> add = [this, &layout, &add](unsigned int n) {
+      const IndexOctreeNode& node = this->nodes[n];
+      unsigned int           childMask = 0;
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        childMask |= node.hasChild (i) ? (1u << i) : 0u;
+      }
+      layout.nodes.push_back (
+        DynamicOctreeLayout::Node{node.center, node.width, node.depth, childMask, 0});
+      this->forEachElement (node, [&layout](unsigned int e) {
+        layout.elements.push_back (e);
+        layout.nodes.back ().numElements++;
+      });
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.hasChild (i))
+        {
+          add (node.children[i]);
+        }
+      }
+    };
+
     if (this->hasRoot ())
     {
-      this->root->updateStatistics (stats);
+      layout.nodes.reserve (this->nodes.size () - this->freeNodes.size ());
+      layout.elements.reserve (this->elementNodes.size ());
+      add (this->root);
     }
+    return layout;
+  }
+
+  /* Each element must be stored exactly once, and each child must be half as wide as its parent,
+   * which bounds the depth of the octree.
+   */
+  bool fromLayout (const DynamicOctreeLayout& layout, unsigned int numElements)
+  {
+    this->reset ();
+
+    if (layout.elements.size () != numElements || (layout.nodes.empty () && numElements > 0))
+    {
+      return false;
+    }
+    else if (layout.nodes.empty ())
+    {
+      return true;
+    }
+
+    unsigned int nextNode = 0;
+    unsigned int nextElement = 0;
+
+    this->nodes.reserve (layout.nodes.size ());
+    this->elementNodes.resize (numElements, Util::invalidIndex ());
+    this->nextElements.resize (numElements, Util::invalidIndex ());
+    this->previousElements.resize (numElements, Util::invalidIndex ());
+    this->elementBounds.resize (numElements, glm::vec4 (-1.0f));
+
+    std::function<bool(unsigned int)> restore = [this, &layout, numElements, &nextNode,
+                                                 &nextElement, &restore](unsigned int n) {
+      const DynamicOctreeLayout::Node& node = layout.nodes[nextNode++];
+
+      if (node.numElements > numElements - nextElement)
+      {
+        return false;
+      }
+      // elements are prepended when linked, hence they are linked in reverse order
+      nextElement += node.numElements;
+      for (unsigned int i = 1; i <= node.numElements; i++)
+      {
+        const unsigned int e = layout.elements[nextElement - i];
+
+        if (e >= numElements || this->elementNodes[e] != Util::invalidIndex ())
+        {
+          return false;
+        }
+        this->linkElement (n, e);
+      }
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        if (node.childMask & (1u << i))
+        {
+          if (nextNode >= layout.nodes.size ())
+          {
+            return false;
+          }
+          const DynamicOctreeLayout::Node& child = layout.nodes[nextNode];
+
+          if (int64_t (child.depth) != int64_t (node.depth) + 1 ||
+              child.width != node.width * 0.5f || child.width <= 0.0f)
+          {
+            return false;
+          }
+          const unsigned int c = this->makeNode (child.center, child.width, child.depth);
+
+          this->nodes[n].children[i] = c;
+          this->nodes[c].parent = n;
+          if (restore (c) == false)
+          {
+            return false;
+          }
+        }
+      }
+      return true;
+    };
+
+    const DynamicOctreeLayout::Node& rootNode = layout.nodes.front ();
+
+    if (rootNode.width > 0.0f && std::isfinite (rootNode.width))
+    {
+      this->root = this->makeNode (rootNode.center, rootNode.width, rootNode.depth);
+
+      if (restore (this->root) && nextNode == layout.nodes.size () && nextElement == numElements)
+      {
+        return true;
+      }
+    }
+    this->reset ();
+    return false;
+  }
+
+  void printStatistics () const
+  {
+    const DynamicOctreeStatistics stats = this->statistics ();
+
     std::cout << "octree:"
               << "\n\tnum nodes:\t\t\t" << stats.numNodes << "\n\tnum elements:\t\t\t"
               << stats.numElements << "\n\tmax elements per node:\t\t" << stats.maxElementsPerNode
@@ -713,9 +1625,14 @@ struct DynamicOctree::Impl
 DELEGATE_BIG4_COPY (DynamicOctree)
 
 DELEGATE_CONST (bool, DynamicOctree, hasRoot)
+DELEGATE2 (void, DynamicOctree, configure, unsigned int, float)
 DELEGATE2 (void, DynamicOctree, setupRoot, const glm::vec3&, float)
 DELEGATE3 (void, DynamicOctree, addElement, unsigned int, const glm::vec3&, float)
+DELEGATE2 (void, DynamicOctree, build, const std::vector<unsigned int>&,
+           const std::vector<glm::vec4>&)
 DELEGATE3 (void, DynamicOctree, realignElement, unsigned int, const glm::vec3&, float)
+DELEGATE3 (bool, DynamicOctree, refit, const std::vector<unsigned int>&,
+           const std::vector<glm::vec4>&, float)
 DELEGATE1 (void, DynamicOctree, deleteElement, unsigned int)
 DELEGATE (void, DynamicOctree, deleteEmptyChildren)
 DELEGATE1 (void, DynamicOctree, updateIndices, const std::vector<unsigned int>&)
@@ -724,12 +1641,30 @@ DELEGATE (void, DynamicOctree, reset)
 DELEGATE1_CONST (void, DynamicOctree, render, Camera&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimRay&,
                  const DynamicOctree::RayIntersectionCallback&)
+DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimRay&,
+                 const DynamicOctree::RayElementsIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimRay&, float,
+                 const DynamicOctree::RayElementsIntersectionCallback&)
+DELEGATE3_CONST (bool, DynamicOctree, intersectsAny, const PrimRay&, float,
+                 const DynamicOctree::RayElementsAnyIntersectionCallback&)
+DELEGATE2_CONST (void, DynamicOctree, intersects, const std::vector<PrimRay>&,
+                 const DynamicOctree::BatchRayIntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimPlane&,
                  const DynamicOctree::IntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimSphere&,
                  const DynamicOctree::ContainsIntersectionCallback&)
 DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimAABox&,
                  const DynamicOctree::ContainsIntersectionCallback&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimSphere&, std::vector<unsigned int>&,
+                 std::vector<unsigned int>&)
+DELEGATE3_CONST (void, DynamicOctree, intersects, const PrimAABox&, std::vector<unsigned int>&,
+                 std::vector<unsigned int>&)
 DELEGATE2_CONST (float, DynamicOctree, distance, const glm::vec3&,
                  const DynamicOctree::DistanceCallback&)
+DELEGATE3_CONST (float, DynamicOctree, distance, const glm::vec3&, float,
+                 const DynamicOctree::DistanceCallback&)
+DELEGATE_CONST (DynamicOctreeStatistics, DynamicOctree, statistics)
+DELEGATE_CONST (std::size_t, DynamicOctree, numBytes)
+DELEGATE_CONST (DynamicOctreeLayout, DynamicOctree, layout)
+DELEGATE2 (bool, DynamicOctree, fromLayout, const DynamicOctreeLayout&, unsigned int)
 DELEGATE_CONST (void, DynamicOctree, printStatistics)
@@ -5,8 +5,10 @@
 #ifndef DILAY_DYNAMIC_OCTREE
 #define DILAY_DYNAMIC_OCTREE
 
+#include <cstddef>
 #include <functional>
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
+#include <unordered_map>
 #include <vector>
 #include "macro.hpp"
 
@@ -16,6 +18,37 @@ class PrimPlane;
 class PrimRay;
 class PrimSphere;
 
+struct DynamicOctreeStatistics
+{
+  typedef std::unordered_map<int, unsigned int> DepthMap;
+
+  unsigned int numNodes;
+  unsigned int numElements;
+  int          minDepth;
+  int          maxDepth;
+  unsigned int maxElementsPerNode;
+  DepthMap     numElementsPerDepth;
+  DepthMap     numNodesPerDepth;
+};
+
+/* The nodes of an octree in depth-first order, where the children of a node are given by a mask
+ * of its child indices, and the elements of each node in the same order.
+ */
+struct DynamicOctreeLayout
+{
+  struct Node
+  {
+    glm::vec3    center;
+    float        width;
+    int          depth;
+    unsigned int childMask;
+    unsigned int numElements;
+  };
+
+  std::vector<Node>         nodes;
+  std::vector<unsigned int> elements;
+};
+
 class DynamicOctree
 {
 public:
@@ -26,10 +59,31 @@ public:
   typedef std::function<void(bool, unsigned int)> ContainsIntersectionCallback;
   typedef std::function<float(unsigned int)>      DistanceCallback;
 
+  // called with the index of a ray and an element; returns the ray's new intersection distance
+  typedef std::function<float(unsigned int, unsigned int)> BatchRayIntersectionCallback;
+
+  // called with up to 8 elements of a node at a time; returns the ray's new intersection distance
+  typedef std::function<float(const unsigned int*, unsigned int)> RayElementsIntersectionCallback;
+
+  // called with up to 8 elements of a node at a time; returns whether any of them is hit
+  typedef std::function<bool(const unsigned int*, unsigned int)> RayElementsAnyIntersectionCallback;
+
+  /* Leaves gather up to the given number of elements before they are split, and an element is
+   * stored in a child if its maximal extent is at most the given fraction (below 0.5) of the
+   * node's width.  Changes apply to elements that are added or realigned afterwards.
+   */
+  void  configure (unsigned int, float);
   bool  hasRoot () const;
   void  setupRoot (const glm::vec3&, float);
   void  addElement (unsigned int, const glm::vec3&, float);
+  // builds the octree from scratch (positions and maximal extents are given as `glm::vec4`)
+  void  build (const std::vector<unsigned int>&, const std::vector<glm::vec4>&);
   void  realignElement (unsigned int, const glm::vec3&, float);
+  /* Realigns the given elements in bulk (cf. `build`): elements that still fit their nodes stay
+   * in place.  Returns false without changing the octree if it has no root or if more than the
+   * given fraction of elements would have to be moved, i.e., if building it is cheaper.
+   */
+  bool  refit (const std::vector<unsigned int>&, const std::vector<glm::vec4>&, float);
   void  deleteElement (unsigned int);
   void  deleteEmptyChildren ();
   void  updateIndices (const std::vector<unsigned int>&);
@@ -37,12 +91,30 @@ public:
   void  reset ();
   void  render (Camera&) const;
   void  intersects (const PrimRay&, const RayIntersectionCallback&) const;
+  void  intersects (const PrimRay&, const RayElementsIntersectionCallback&) const;
+  // only nodes that the ray enters before the given distance are visited
+  void  intersects (const PrimRay&, float, const RayElementsIntersectionCallback&) const;
+  // stops at the first hit (e.g., of occlusion queries) that is nearer than the given distance
+  bool  intersectsAny (const PrimRay&, float, const RayElementsAnyIntersectionCallback&) const;
+  void  intersects (const std::vector<PrimRay>&, const BatchRayIntersectionCallback&) const;
   void  intersects (const PrimPlane&, const IntersectionCallback&) const;
   void  intersects (const PrimSphere&, const ContainsIntersectionCallback&) const;
   void  intersects (const PrimAABox&, const ContainsIntersectionCallback&) const;
+  // appends elements of nodes within the primitive to the first vector and others to the second
+  void  intersects (const PrimSphere&, std::vector<unsigned int>&,
+                    std::vector<unsigned int>&) const;
+  void  intersects (const PrimAABox&, std::vector<unsigned int>&, std::vector<unsigned int>&) const;
   float distance (const glm::vec3&, const DistanceCallback&) const;
+  // only searches elements that are nearer than the given distance
+  float distance (const glm::vec3&, float, const DistanceCallback&) const;
   void  printStatistics () const;
 
+  DynamicOctreeStatistics statistics () const;
+  std::size_t             numBytes () const;
+  DynamicOctreeLayout     layout () const;
+  // restores an octree of the given number of elements, or returns false if the layout is invalid
+  bool                    fromLayout (const DynamicOctreeLayout&, unsigned int);
+
 private:
   IMPLEMENTATION
 };
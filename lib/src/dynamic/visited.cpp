@@ -0,0 +1,68 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <limits>
+#include "dynamic/visited.hpp"
+
+void DynamicVisited::begin (unsigned int n)
+{
+  if (this->_epoch == std::numeric_limits<uint32_t>::max ())
+  {
+    std::fill (this->_marks.begin (), this->_marks.end (), 0);
+    this->_epoch = 0;
+  }
+  this->_epoch++;
+
+  if (this->_marks.size () < n)
+  {
+    this->_marks.resize (n, 0);
+  }
+}
+
+DynamicVisitedPool::Scope::Scope (DynamicVisitedPool& pool, unsigned int n)
+  : _pool (pool)
+{
+  {
+    std::lock_guard<std::mutex> lock (pool._mutex);
+
+    if (pool._free.empty () == false)
+    {
+      this->_visited = std::move (pool._free.back ());
+      pool._free.pop_back ();
+    }
+  }
+  if (this->_visited == nullptr)
+  {
+    this->_visited.reset (new DynamicVisited);
+  }
+  this->_visited->begin (n);
+}
+
+DynamicVisitedPool::Scope::~Scope ()
+{
+  if (this->_visited)
+  {
+    std::lock_guard<std::mutex> lock (this->_pool._mutex);
+    this->_pool._free.push_back (std::move (this->_visited));
+  }
+}
+
+void DynamicVisitedPool::reset ()
+{
+  std::lock_guard<std::mutex> lock (this->_mutex);
+  this->_free.clear ();
+}
+
+std::size_t DynamicVisitedPool::numBytes ()
+{
+  std::lock_guard<std::mutex> lock (this->_mutex);
+  std::size_t                 n = 0;
+
+  for (const std::unique_ptr<DynamicVisited>& visited : this->_free)
+  {
+    n += visited->numBytes ();
+  }
+  return n;
+}
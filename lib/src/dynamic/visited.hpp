@@ -0,0 +1,87 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_VISITED
+#define DILAY_DYNAMIC_VISITED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* Marks elements as visited by storing the epoch of the current traversal per element.  A new
+ * traversal increments the epoch instead of clearing all marks, which are only cleared when the
+ * epoch wraps around.
+ */
+class DynamicVisited
+{
+public:
+  DynamicVisited ()
+    : _epoch (0)
+  {
+  }
+
+  // starts a traversal of elements in [0, n), which are all unvisited
+  void begin (unsigned int);
+
+  bool isVisited (unsigned int i) const { return this->_marks[i] == this->_epoch; }
+
+  std::size_t numBytes () const { return this->_marks.capacity () * sizeof (uint32_t); }
+
+  // marks an element and returns whether it was unvisited
+  bool visit (unsigned int i)
+  {
+    if (this->isVisited (i))
+    {
+      return false;
+    }
+    else
+    {
+      this->_marks[i] = this->_epoch;
+      return true;
+    }
+  }
+
+private:
+  std::vector<uint32_t> _marks;
+  uint32_t              _epoch;
+};
+
+/* Hands out visited marks to traversals.  Each traversal owns its marks until its scope ends, so
+ * traversals may nest and run on multiple threads at once.  Copies start with an empty pool.
+ */
+class DynamicVisitedPool
+{
+public:
+  class Scope
+  {
+  public:
+    Scope (DynamicVisitedPool&, unsigned int);
+    Scope (const Scope&) = delete;
+    Scope (Scope&&) = default;
+    ~Scope ();
+
+    DynamicVisited& operator* () const { return *this->_visited; }
+    DynamicVisited* operator-> () const { return this->_visited.get (); }
+
+  private:
+    DynamicVisitedPool&             _pool;
+    std::unique_ptr<DynamicVisited> _visited;
+  };
+
+  DynamicVisitedPool () {}
+  DynamicVisitedPool (const DynamicVisitedPool&) {}
+  DynamicVisitedPool& operator= (const DynamicVisitedPool&) { return *this; }
+
+  void        reset ();
+  // only counts the marks that are not owned by a traversal
+  std::size_t numBytes ();
+
+private:
+  std::vector<std::unique_ptr<DynamicVisited>> _free;
+  std::mutex                                   _mutex;
+};
+
+#endif
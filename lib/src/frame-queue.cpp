@@ -0,0 +1,75 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <deque>
+#include <utility>
+#include "frame-queue.hpp"
+#include "opengl.hpp"
+
+namespace
+{
+  typedef std::pair<unsigned int, void*> FencedFrame;
+
+  std::deque<FencedFrame> queuedFrames;
+  unsigned int            maxQueued = 2;
+  unsigned int            current = 1;
+  unsigned int            completed = 0;
+
+  void popFrame ()
+  {
+    assert (queuedFrames.empty () == false);
+
+    completed = queuedFrames.front ().first;
+    OpenGL::safeDeleteSync (queuedFrames.front ().second);
+    queuedFrames.pop_front ();
+  }
+}
+
+namespace FrameQueue
+{
+  void maxQueuedFrames (unsigned int n)
+  {
+    assert (n > 0);
+    maxQueued = n;
+  }
+
+  unsigned int currentFrame () { return current; }
+
+  bool isCompleted (unsigned int frame)
+  {
+    if (OpenGL::hasSync () == false)
+    {
+      return true;
+    }
+    while (queuedFrames.empty () == false && OpenGL::isSignaled (queuedFrames.front ().second))
+    {
+      popFrame ();
+    }
+    return frame <= completed || frame > current;
+  }
+
+  void endFrame ()
+  {
+    if (OpenGL::hasSync ())
+    {
+      queuedFrames.emplace_back (current, OpenGL::glFenceSync ());
+
+      while (queuedFrames.size () > maxQueued)
+      {
+        OpenGL::waitSync (queuedFrames.front ().second);
+        popFrame ();
+      }
+    }
+    current++;
+  }
+
+  void reset ()
+  {
+    while (queuedFrames.empty () == false)
+    {
+      popFrame ();
+    }
+  }
+}
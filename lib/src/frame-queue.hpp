@@ -0,0 +1,24 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_FRAME_QUEUE
+#define DILAY_FRAME_QUEUE
+
+/* Frames that have been submitted to the GPU but are not completed yet.  Each frame is fenced
+ * after submission, and submitting a frame waits for the oldest frame if more frames than allowed
+ * are queued.  Buffer objects record the last frame that used them, so that uploads can avoid
+ * writing buffers that are still in use.  Without sync objects, all frames count as completed.
+ */
+namespace FrameQueue
+{
+  void         maxQueuedFrames (unsigned int);
+  unsigned int currentFrame ();
+  bool         isCompleted (unsigned int);
+  void         endFrame ();
+
+  // deletes the fences of all queued frames, which requires a current context
+  void reset ();
+}
+
+#endif
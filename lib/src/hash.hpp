@@ -5,6 +5,7 @@
 #ifndef DILAY_HASH
 #define DILAY_HASH
 
+#include <cstdint>
 #include <functional>
 #include <utility>
 
@@ -15,8 +16,46 @@ namespace Hash
   {
     seed ^= std::hash<T> () (value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
   }
+
+  // finalizer of SplitMix64: each input bit affects all output bits
+  inline uint64_t mix (uint64_t value)
+  {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    value ^= value >> 31;
+    return value;
+  }
 }
 
+// undirected edge between two vertices, packed into 64 bits with the smaller index first
+class EdgeKey
+{
+public:
+  EdgeKey ()
+    : _value (~uint64_t (0))
+  {
+  }
+
+  EdgeKey (unsigned int i1, unsigned int i2)
+    : _value (i1 < i2 ? (uint64_t (i1) << 32) | uint64_t (i2)
+                      : (uint64_t (i2) << 32) | uint64_t (i1))
+  {
+  }
+
+  uint64_t     value () const { return this->_value; }
+  unsigned int vertex1 () const { return (unsigned int) (this->_value >> 32); }
+  unsigned int vertex2 () const { return (unsigned int) (this->_value); }
+
+  bool operator== (const EdgeKey& other) const { return this->_value == other._value; }
+  bool operator!= (const EdgeKey& other) const { return this->_value != other._value; }
+  bool operator< (const EdgeKey& other) const { return this->_value < other._value; }
+
+private:
+  uint64_t _value;
+};
+
 namespace std
 {
   template <typename T1, typename T2> struct hash<std::pair<T1, T2>>
@@ -26,9 +65,14 @@ namespace std
       size_t seed = 0;
       Hash::combine (seed, pair.first);
       Hash::combine (seed, pair.second);
-      return seed;
+      return size_t (Hash::mix (seed));
     }
   };
+
+  template <> struct hash<EdgeKey>
+  {
+    size_t operator() (const EdgeKey& key) const { return size_t (Hash::mix (key.value ())); }
+  };
 }
 
 #endif
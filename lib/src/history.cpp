@@ -2,20 +2,128 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QDir>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <utility>
 #include <vector>
 #include "config.hpp"
+#include "dynamic/mesh-changes.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
+#include "idle-tasks.hpp"
+#include "intersection.hpp"
+#include "journal.hpp"
 #include "maybe.hpp"
 #include "mesh.hpp"
+#include "primitive/sphere.hpp"
+#include "profile.hpp"
 #include "scene.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
 #include "state.hpp"
+#include "util.hpp"
 
 namespace
 {
+  typedef std::chrono::steady_clock Clock;
+
+  std::string cacheDir;
+
+  struct SpilledRegion
+  {
+    qint64 offset;
+    qint64 size;
+  };
+
+  /* Spilled snapshots are appended to a temporary file in the cache directory, whose regions
+   * are mapped lazily when the snapshots are decompressed again.  The file is removed when the
+   * store is closed.
+   */
+  struct SnapshotStore
+  {
+    std::unique_ptr<QTemporaryFile> file;
+
+    qint64 size () const { return this->file ? this->file->size () : 0; }
+
+    bool open ()
+    {
+      if (this->file == nullptr)
+      {
+        const QDir dir (cacheDir.empty () ? QDir::tempPath () : QString::fromStdString (cacheDir));
+
+        if (dir.exists () == false)
+        {
+          dir.mkpath (".");
+        }
+        this->file.reset (new QTemporaryFile (dir.filePath ("dilay-history-XXXXXX")));
+
+        if (this->file->open () == false)
+        {
+          DILAY_WARN ("could not open history store in %s", dir.path ().toStdString ().c_str ())
+          this->file.reset ();
+        }
+      }
+      return this->file != nullptr;
+    }
+
+    bool write (const unsigned char* data, qint64 size, SpilledRegion& region)
+    {
+      if (this->open () == false)
+      {
+        return false;
+      }
+      region.offset = this->file->size ();
+      region.size = size;
+
+      if (this->file->seek (region.offset) == false ||
+          this->file->write ((const char*) data, size) != size)
+      {
+        this->file->resize (region.offset);
+        return false;
+      }
+      // written data is buffered until it is flushed, which is required for mapping it
+      return this->file->flush ();
+    }
+
+    // reads a region if it cannot be mapped
+    bool read (const SpilledRegion&                              region,
+               const std::function<void(const unsigned char*)>& f)
+    {
+      if (this->file == nullptr)
+      {
+        return false;
+      }
+      unsigned char* data = this->file->map (region.offset, region.size);
+
+      if (data)
+      {
+        f (data);
+        this->file->unmap (data);
+        return true;
+      }
+      else
+      {
+        std::vector<unsigned char> buffer (std::size_t (region.size));
+
+        if (this->file->seek (region.offset) &&
+            this->file->read ((char*) buffer.data (), region.size) == region.size)
+        {
+          f (buffer.data ());
+          return true;
+        }
+        return false;
+      }
+    }
+
+    void close () { this->file.reset (); }
+  };
+
   struct SnapshotConfig
   {
     bool snapshotDynamicMeshes;
@@ -29,29 +137,178 @@ namespace
     }
   };
 
+  // sketch meshes are copied as flat trees, since snapshots are copied but not edited
+  struct SketchSnapshot
+  {
+    FlatTree<PrimSphere> tree;
+    SketchPaths          paths;
+
+    SketchSnapshot (const SketchMesh& mesh)
+      : tree (mesh.tree ())
+      , paths (mesh.paths ())
+    {
+    }
+
+    std::size_t numBytes () const
+    {
+      std::size_t n = this->tree.numNodes () * sizeof (PrimSphere);
+
+      for (const SketchPath& path : this->paths)
+      {
+        n += path.spheres ().size () * sizeof (PrimSphere);
+      }
+      return n;
+    }
+
+    void restore (State& state) const
+    {
+      SketchMesh& mesh = state.scene ().newSketchMesh (state.config (), this->tree.toTree ());
+
+      for (const SketchPath& path : this->paths)
+      {
+        mesh.addPath (path);
+      }
+    }
+  };
+
+  /* Dynamic meshes are not copied.  Instead, a snapshot stores the changes that revert
+   * modified dynamic meshes, the deleted dynamic meshes and the ids of new dynamic meshes.
+   */
   struct SceneSnapshot
   {
-    const SnapshotConfig   config;
-    std::list<DynamicMesh> dynamicMeshes;
-    std::list<SketchMesh>  sketchMeshes;
+    const SnapshotConfig                                   config;
+    std::list<std::pair<unsigned int, DynamicMeshChanges>> changedDynamicMeshes;
+    std::list<DynamicMesh>                                 deletedDynamicMeshes;
+    std::vector<unsigned int>                              newDynamicMeshes;
+    std::list<SketchSnapshot>                              sketchMeshes;
+    bool                                                   isCompressed;
+    bool                                                   isSpilled;
+    std::vector<SpilledRegion>                             spilledRegions;
 
     SceneSnapshot (const SnapshotConfig& c)
       : config (c)
+      , isCompressed (false)
+      , isSpilled (false)
+    {
+    }
+
+    void compress ()
+    {
+      for (auto& changes : this->changedDynamicMeshes)
+      {
+        changes.second.compress ();
+      }
+    }
+
+    // moves the compressed changes to the store
+    bool spill (SnapshotStore& store)
+    {
+      assert (this->isCompressed && this->isSpilled == false);
+
+      for (const auto& changes : this->changedDynamicMeshes)
+      {
+        const std::vector<unsigned char>& data = changes.second.compressedData ();
+        SpilledRegion                     region;
+
+        if (store.write (data.data (), qint64 (data.size ()), region) == false)
+        {
+          this->spilledRegions.clear ();
+          return false;
+        }
+        this->spilledRegions.push_back (region);
+      }
+      for (auto& changes : this->changedDynamicMeshes)
+      {
+        changes.second.releaseCompressedData ();
+      }
+      this->isSpilled = true;
+      return true;
+    }
+
+    // returns false if spilled changes could not be read
+    bool decompress (SnapshotStore& store)
     {
+      if (this->isCompressed)
+      {
+        auto region = this->spilledRegions.begin ();
+
+        for (auto& changes : this->changedDynamicMeshes)
+        {
+          if (this->isSpilled)
+          {
+            const bool success = store.read (*region, [&changes, &region](const unsigned char* d) {
+              changes.second.decompress (d, std::size_t (region->size));
+            });
+            if (success == false)
+            {
+              return false;
+            }
+            ++region;
+          }
+          else
+          {
+            changes.second.decompress ();
+          }
+        }
+        this->isCompressed = false;
+        this->isSpilled = false;
+        this->spilledRegions.clear ();
+      }
+      return true;
+    }
+
+    std::size_t numSpilledBytes () const
+    {
+      std::size_t n = 0;
+
+      for (const SpilledRegion& region : this->spilledRegions)
+      {
+        n += std::size_t (region.size);
+      }
+      return n;
+    }
+
+    std::size_t numBytes () const
+    {
+      std::size_t n = sizeof (SceneSnapshot);
+
+      for (const auto& changes : this->changedDynamicMeshes)
+      {
+        n += changes.second.numBytes ();
+      }
+      for (const DynamicMesh& mesh : this->deletedDynamicMeshes)
+      {
+        n += mesh.numBytes ();
+      }
+      for (const SketchSnapshot& mesh : this->sketchMeshes)
+      {
+        n += mesh.numBytes ();
+      }
+      return n;
     }
   };
 
   typedef std::list<SceneSnapshot> Timeline;
 
+  struct Stroke
+  {
+    unsigned int      mesh;
+    PrimSphere        region;
+    Clock::time_point time;
+  };
+
+  // changes since a snapshot belong to it, changes since an undo or a redo are reverted
+  enum class Tracking
+  {
+    None,
+    Snapshot,
+    Revert
+  };
+
   SceneSnapshot sceneSnapshot (const Scene& scene, const SnapshotConfig& config)
   {
     SceneSnapshot snapshot (config);
 
-    if (config.snapshotDynamicMeshes)
-    {
-      scene.forEachConstMesh (
-        [&snapshot](const DynamicMesh& mesh) { snapshot.dynamicMeshes.emplace_back (mesh); });
-    }
     if (config.snapshotSketchMeshes)
     {
       scene.forEachConstMesh (
@@ -60,69 +317,465 @@ namespace
     return snapshot;
   }
 
-  void resetToSnapshot (const SceneSnapshot& snapshot, State& state)
+  // meshes that are added while tracking are new meshes, hence deferred meshes are loaded before
+  void trackScene (Scene& scene)
   {
-    Scene& scene = state.scene ();
+    scene.loadDeferredMeshes ();
+    scene.clearDeletedMeshes ();
+    scene.forEachMesh ([](DynamicMesh& mesh) { mesh.trackChanges (); });
+  }
 
-    if (snapshot.config.snapshotDynamicMeshes)
-    {
-      scene.deleteDynamicMeshes ();
+  void moveDeletedMeshes (Scene& scene, std::list<DynamicMesh>& meshes)
+  {
+    scene.forEachDeletedMesh ([&meshes](DynamicMesh& mesh) {
+      if (mesh.tracksChanges ())
+      {
+        mesh.untrackChanges ();
+      }
+      meshes.emplace_back (std::move (mesh));
+    });
+    scene.clearDeletedMeshes ();
+  }
 
-      for (const DynamicMesh& mesh : snapshot.dynamicMeshes)
+  void untrackScene (Scene& scene, SceneSnapshot& snapshot)
+  {
+    scene.loadDeferredMeshes ();
+    scene.forEachMesh ([&snapshot](DynamicMesh& mesh) {
+      if (mesh.tracksChanges ())
+      {
+        snapshot.changedDynamicMeshes.emplace_back (mesh.id (), mesh.untrackChanges ());
+      }
+      else
       {
-        scene.newDynamicMesh (state.config (), mesh);
+        snapshot.newDynamicMeshes.push_back (mesh.id ());
       }
+    });
+    scene.forEachDeletedMesh (
+      [](DynamicMesh& mesh) { mesh.applyChanges (mesh.untrackChanges ()); });
+    moveDeletedMeshes (scene, snapshot.deletedDynamicMeshes);
+  }
+
+  DynamicMesh& findDynamicMesh (Scene& scene, unsigned int id)
+  {
+    DynamicMesh* result = nullptr;
+
+    scene.forEachMesh ([id, &result](DynamicMesh& mesh) {
+      if (mesh.id () == id)
+      {
+        result = &mesh;
+      }
+    });
+
+    if (result == nullptr)
+    {
+      DILAY_IMPOSSIBLE
     }
+    return *result;
+  }
+
+  SceneSnapshot resetToSnapshot (SceneSnapshot& snapshot, State& state)
+  {
+    Scene&        scene = state.scene ();
+    SceneSnapshot inverse (snapshot.config);
+
+    for (const auto& changes : snapshot.changedDynamicMeshes)
+    {
+      DynamicMesh& mesh = findDynamicMesh (scene, changes.first);
+
+      // a mesh may be changed repeatedly, so the inverse changes are applied in reverse order
+      inverse.changedDynamicMeshes.emplace_front (changes.first,
+                                                  mesh.applyChanges (changes.second));
+      mesh.bufferData ();
+    }
+
+    // deleted meshes are moved out of the scene by tracking them
+    for (unsigned int id : snapshot.newDynamicMeshes)
+    {
+      DynamicMesh& mesh = findDynamicMesh (scene, id);
+
+      mesh.trackChanges ();
+      scene.deleteMesh (mesh);
+    }
+    moveDeletedMeshes (scene, inverse.deletedDynamicMeshes);
+
+    for (DynamicMesh& mesh : snapshot.deletedDynamicMeshes)
+    {
+      inverse.newDynamicMeshes.push_back (mesh.id ());
+      scene.newDynamicMesh (state.config (), std::move (mesh));
+    }
+    snapshot.deletedDynamicMeshes.clear ();
+
     if (snapshot.config.snapshotSketchMeshes)
     {
+      scene.forEachConstMesh (
+        [&inverse](const SketchMesh& mesh) { inverse.sketchMeshes.emplace_back (mesh); });
       scene.deleteSketchMeshes ();
 
-      for (const SketchMesh& mesh : snapshot.sketchMeshes)
+      for (const SketchSnapshot& mesh : snapshot.sketchMeshes)
       {
-        scene.newSketchMesh (state.config (), mesh);
+        mesh.restore (state);
       }
     }
+    return inverse;
   }
 }
 
+/* Snapshots that are not among the most recent ones of the past or the future are compressed
+ * by an idle task.  Snapshotting never waits for the compression: snapshots that are removed in
+ * the meantime are moved to `discarded` and destroyed after the compression has finished.
+ * Undoing and redoing wait for it, i.e., they compress on the calling thread if the user has not
+ * been idle yet.  The destructor of `compression` also waits before the timeline is destroyed.
+ * If the timeline exceeds `editor/undo-memory`, the oldest compressed snapshots are spilled to
+ * `store` until it exceeds `editor/undo-disk-memory`.  Snapshotting already drops the oldest
+ * snapshots if the uncompressed ones alone exceed `editor/undo-memory`.
+ * Coalesced strokes do not take a snapshot but keep tracking changes into the snapshot of the
+ * previous stroke, i.e., the changes of both strokes are merged as they are recorded.
+ */
 struct History::Impl
 {
-  unsigned int undoDepth;
-  Timeline     past;
-  Timeline     future;
+  static constexpr unsigned int numUncompressedSnapshots = 2;
 
-  Impl (const Config& config) { this->runFromConfig (config); }
+  unsigned int        undoDepth;
+  std::size_t         maxNumBytes;
+  std::size_t         maxNumSpilledBytes;
+  std::size_t         timelineNumBytes;
+  Timeline            past;
+  Timeline            future;
+  Timeline            discarded;
+  Tracking            tracking;
+  IdleTask            compression;
+  SnapshotStore       store;
+  Journal             journal;
+  unsigned int        coalesceTime;
+  MaybeInline<Stroke> lastStroke;
+  bool                isCoalesced;
 
-  void snapshotAll (const Scene& scene) { this->snapshot (scene, SnapshotConfig (true, true)); }
+  Impl (const Config& config)
+    : timelineNumBytes (0)
+    , tracking (Tracking::None)
+    , journal (config)
+    , isCoalesced (false)
+  {
+    this->runFromConfig (config);
+  }
 
-  void snapshotDynamicMeshes (const Scene& scene)
+  void snapshotAll (Scene& scene) { this->snapshot (scene, SnapshotConfig (true, true)); }
+
+  void snapshotDynamicMeshes (Scene& scene)
   {
     this->snapshot (scene, SnapshotConfig (true, false));
   }
 
-  void snapshotSketchMeshes (const Scene& scene)
+  void snapshotSketchMeshes (Scene& scene)
   {
     this->snapshot (scene, SnapshotConfig (false, true));
   }
 
-  void snapshot (const Scene& scene, const SnapshotConfig& config)
+  bool canCoalesce (const Stroke& stroke) const
   {
+    return this->coalesceTime > 0 && this->lastStroke && this->tracking == Tracking::Snapshot &&
+           this->past.front ().config.snapshotSketchMeshes == false &&
+           this->lastStroke->mesh == stroke.mesh &&
+           stroke.time - this->lastStroke->time <=
+             std::chrono::milliseconds (this->coalesceTime) &&
+           IntersectionUtil::intersects (this->lastStroke->region, stroke.region);
+  }
+
+  void snapshotStroke (Scene& scene, const DynamicMesh& mesh, const PrimSphere& region)
+  {
+    const Stroke stroke{mesh.id (), region, Clock::now ()};
+
+    if (this->canCoalesce (stroke))
+    {
+      this->journal.record (scene);
+      this->isCoalesced = true;
+    }
+    else
+    {
+      this->snapshotDynamicMeshes (scene);
+    }
+    this->lastStroke = stroke;
+  }
+
+  void snapshot (Scene& scene, const SnapshotConfig& config)
+  {
+    DILAY_PROFILE_ZONE ("History::snapshot");
+    DILAY_ALLOCATION_SCOPE ("snapshots");
+
     assert (undoDepth > 0);
 
-    this->future.clear ();
+    // edits of the previous snapshot are committed
+    this->journal.record (scene);
+    this->untrack (scene);
+    this->discarded.splice (this->discarded.end (), this->future);
 
     while (this->past.size () >= this->undoDepth)
     {
-      this->past.pop_back ();
+      this->discarded.splice (this->discarded.end (), this->past, std::prev (this->past.end ()));
     }
     this->past.push_front (sceneSnapshot (scene, config));
+    this->limitUncompressedMemory ();
+    this->track (scene, Tracking::Snapshot);
+    this->lastStroke.reset ();
+    this->isCoalesced = false;
+    this->startCompression ();
+  }
+
+  void finishCompression ()
+  {
+    this->compression.wait ();
+    this->compression.reset ();
+    this->discarded.clear ();
+    this->limitMemory (this->maxNumBytes);
+  }
+
+  /* Compresses all snapshots but the most recent ones on the calling thread, which still
+   * receive changes, and spills them as far as the store allows.
+   */
+  void relieveMemory ()
+  {
+    this->finishCompression ();
+
+    const auto compress = [](Timeline& timeline) {
+      for (auto it = timeline.begin (); it != timeline.end (); ++it)
+      {
+        if (it != timeline.begin () && it->isCompressed == false)
+        {
+          it->isCompressed = true;
+          it->compress ();
+        }
+      }
+    };
+    compress (this->past);
+    compress (this->future);
+    this->limitMemory (0);
+  }
+
+  // remaining snapshots are compressed later if a compression is still running
+  void startCompression ()
+  {
+    if (this->compression.isValid ())
+    {
+      if (this->compression.isReady () == false)
+      {
+        return;
+      }
+      this->finishCompression ();
+    }
+    else
+    {
+      this->discarded.clear ();
+    }
+
+    std::vector<SceneSnapshot*> snapshots;
+
+    const auto addSnapshots = [&snapshots](Timeline& timeline) {
+      unsigned int i = 0;
+      for (SceneSnapshot& snapshot : timeline)
+      {
+        if (i >= numUncompressedSnapshots && snapshot.isCompressed == false)
+        {
+          snapshot.isCompressed = true;
+          snapshots.push_back (&snapshot);
+        }
+        i++;
+      }
+    };
+    addSnapshots (this->past);
+    addSnapshots (this->future);
+
+    if (snapshots.empty () == false)
+    {
+      this->compression.schedule ([snapshots]() {
+        for (SceneSnapshot* snapshot : snapshots)
+        {
+          snapshot->compress ();
+        }
+      });
+    }
   }
 
+  /* Spills the oldest compressed snapshots until the timeline fits into the given number of
+   * bytes, and drops the oldest snapshots until the timeline fits into both budgets.
+   */
+  void limitMemory (std::size_t maxUnspilledBytes)
+  {
+    std::size_t numBytes = 0;
+    std::size_t numSpilledBytes = 0;
+
+    for (const SceneSnapshot& snapshot : this->past)
+    {
+      numBytes += snapshot.numBytes ();
+      numSpilledBytes += snapshot.numSpilledBytes ();
+    }
+    for (const SceneSnapshot& snapshot : this->future)
+    {
+      numBytes += snapshot.numBytes ();
+      numSpilledBytes += snapshot.numSpilledBytes ();
+    }
+
+    const auto spill = [this, maxUnspilledBytes, &numBytes, &numSpilledBytes](Timeline& timeline) {
+      for (auto it = timeline.rbegin (); it != timeline.rend (); ++it)
+      {
+        if (numBytes <= maxUnspilledBytes || numSpilledBytes >= this->maxNumSpilledBytes)
+        {
+          return;
+        }
+        else if (it->isCompressed && it->isSpilled == false)
+        {
+          const std::size_t n = it->numBytes ();
+
+          if (it->spill (this->store) == false)
+          {
+            return;
+          }
+          numBytes = numBytes - n + it->numBytes ();
+          numSpilledBytes += it->numSpilledBytes ();
+        }
+      }
+    };
+    spill (this->past);
+    spill (this->future);
+
+    while ((numBytes > this->maxNumBytes || numSpilledBytes > this->maxNumSpilledBytes) &&
+           this->past.size () + this->future.size () > 1)
+    {
+      Timeline& timeline = this->past.size () > 1 ? this->past : this->future;
+
+      numBytes -= timeline.back ().numBytes ();
+      numSpilledBytes -= timeline.back ().numSpilledBytes ();
+      timeline.pop_back ();
+    }
+    this->timelineNumBytes = numBytes;
+    this->compactStore (numSpilledBytes);
+  }
+
+  /* Drops the oldest snapshots while the uncompressed ones alone exceed the budget.  Compressed
+   * snapshots may still be compressing, hence they are neither measured nor destroyed here.
+   */
+  void limitUncompressedMemory ()
+  {
+    std::size_t numBytes = 0;
+
+    for (const Timeline* timeline : {&this->past, &this->future})
+    {
+      for (const SceneSnapshot& snapshot : *timeline)
+      {
+        numBytes += snapshot.isCompressed ? 0 : snapshot.numBytes ();
+      }
+    }
+
+    while (numBytes > this->maxNumBytes && this->past.size () + this->future.size () > 1)
+    {
+      Timeline& timeline = this->past.size () > 1 ? this->past : this->future;
+
+      numBytes -= timeline.back ().isCompressed ? 0 : timeline.back ().numBytes ();
+      this->discarded.splice (this->discarded.end (), timeline, std::prev (timeline.end ()));
+    }
+  }
+
+  // regions of dropped or decompressed snapshots are reclaimed by copying the remaining ones
+  void compactStore (std::size_t numSpilledBytes)
+  {
+    if (numSpilledBytes == 0)
+    {
+      this->store.close ();
+    }
+    else if (std::size_t (this->store.size ()) > 2 * numSpilledBytes)
+    {
+      SnapshotStore              compacted;
+      std::vector<SpilledRegion> regions;
+
+      const auto copy = [this, &compacted, &regions](const Timeline& timeline) {
+        for (const SceneSnapshot& snapshot : timeline)
+        {
+          for (const SpilledRegion& region : snapshot.spilledRegions)
+          {
+            SpilledRegion copied;
+            bool          success = false;
+
+            this->store.read (region, [&compacted, &region, &copied, &success](
+                                        const unsigned char* data) {
+              success = compacted.write (data, region.size, copied);
+            });
+            if (success == false)
+            {
+              return false;
+            }
+            regions.push_back (copied);
+          }
+        }
+        return true;
+      };
+
+      if (copy (this->past) && copy (this->future))
+      {
+        auto copied = regions.begin ();
+
+        for (Timeline* timeline : {&this->past, &this->future})
+        {
+          for (SceneSnapshot& snapshot : *timeline)
+          {
+            for (SpilledRegion& region : snapshot.spilledRegions)
+            {
+              region = *copied++;
+            }
+          }
+        }
+        this->store = std::move (compacted);
+      }
+    }
+  }
+
+  // snapshots are not measured while they are compressed
+  std::size_t numBytes () const { return this->timelineNumBytes; }
+
+  void track (Scene& scene, Tracking mode)
+  {
+    assert (this->tracking == Tracking::None);
+
+    trackScene (scene);
+    this->tracking = mode;
+  }
+
+  // returns all changes that do not belong to the most recent snapshot
+  SceneSnapshot untrack (Scene& scene)
+  {
+    SceneSnapshot changes (SnapshotConfig (true, false));
+
+    this->lastStroke.reset ();
+    this->isCoalesced = false;
+
+    if (this->tracking == Tracking::Snapshot)
+    {
+      assert (this->past.empty () == false);
+      untrackScene (scene, this->past.front ());
+    }
+    else if (this->tracking == Tracking::Revert)
+    {
+      untrackScene (scene, changes);
+    }
+    this->tracking = Tracking::None;
+    return changes;
+  }
+
+  /* The most recent snapshots are never compressed.  The snapshot of a coalesced stroke is kept,
+   * since it belongs to the previous stroke as well.
+   */
   void dropPastSnapshot ()
   {
-    if (this->past.empty () == false)
+    if (this->isCoalesced)
+    {
+      this->isCoalesced = false;
+    }
+    else if (this->past.empty () == false)
     {
       this->past.pop_front ();
+
+      if (this->tracking == Tracking::Snapshot)
+      {
+        this->tracking = Tracking::Revert;
+      }
     }
   }
 
@@ -136,65 +789,166 @@ struct History::Impl
 
   void undo (State& state)
   {
+    DILAY_PROFILE_ZONE ("History::undo");
+
+    this->finishCompression ();
+
     if (this->past.empty () == false)
     {
-      const SnapshotConfig& config = this->past.front ().config;
+      SceneSnapshot changes = this->untrack (state.scene ());
+      resetToSnapshot (changes, state);
 
-      this->future.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->past.front (), state);
+      if (this->past.front ().decompress (this->store) == false)
+      {
+        DILAY_WARN ("could not read spilled snapshot")
+        this->past.clear ();
+        this->track (state.scene (), Tracking::Revert);
+        this->journal.recordAll (state.scene ());
+        return;
+      }
+      if (this->past.front ().config.snapshotDynamicMeshes == false)
+      {
+        this->moveDynamicChanges ();
+      }
+      this->future.push_front (resetToSnapshot (this->past.front (), state));
       this->past.pop_front ();
+      this->track (state.scene (), Tracking::Revert);
+      this->journal.recordAll (state.scene ());
+      this->startCompression ();
     }
   }
 
-  void redo (State& state)
+  /* Undoing a snapshot of sketch meshes leaves dynamic meshes untouched.  Hence, the dynamic
+   * changes it has recorded are prepended to the previous snapshot, which then reverts them
+   * as well.  Meshes deleted since the previous snapshot are reverted right away, or dropped if
+   * they did not exist back then.
+   */
+  void moveDynamicChanges ()
   {
-    if (this->future.empty () == false)
+    SceneSnapshot& snapshot = this->past.front ();
+
+    if (this->past.size () > 1)
     {
-      const SnapshotConfig& config = this->future.front ().config;
+      SceneSnapshot& previous = *std::next (this->past.begin ());
 
-      this->past.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->future.front (), state);
-      this->future.pop_front ();
+      if (previous.decompress (this->store) == false)
+      {
+        DILAY_WARN ("could not read spilled snapshot")
+        this->past.erase (std::next (this->past.begin ()), this->past.end ());
+      }
+      else
+      {
+        for (DynamicMesh& mesh : snapshot.deletedDynamicMeshes)
+        {
+          auto newMesh = std::find (previous.newDynamicMeshes.begin (),
+                                    previous.newDynamicMeshes.end (), mesh.id ());
+          if (newMesh != previous.newDynamicMeshes.end ())
+          {
+            previous.newDynamicMeshes.erase (newMesh);
+            continue;
+          }
+          for (auto it = previous.changedDynamicMeshes.begin ();
+               it != previous.changedDynamicMeshes.end ();)
+          {
+            if (it->first == mesh.id ())
+            {
+              mesh.applyChanges (it->second);
+              it = previous.changedDynamicMeshes.erase (it);
+            }
+            else
+            {
+              ++it;
+            }
+          }
+          previous.deletedDynamicMeshes.emplace_back (std::move (mesh));
+        }
+        previous.changedDynamicMeshes.splice (previous.changedDynamicMeshes.begin (),
+                                              snapshot.changedDynamicMeshes);
+        previous.newDynamicMeshes.insert (previous.newDynamicMeshes.end (),
+                                          snapshot.newDynamicMeshes.begin (),
+                                          snapshot.newDynamicMeshes.end ());
+      }
     }
+    snapshot.changedDynamicMeshes.clear ();
+    snapshot.deletedDynamicMeshes.clear ();
+    snapshot.newDynamicMeshes.clear ();
   }
 
-  bool hasRecentDynamicMesh () const
+  void redo (State& state)
   {
-    return this->past.empty () == false && this->past.front ().config.snapshotDynamicMeshes;
-  }
+    DILAY_PROFILE_ZONE ("History::redo");
 
-  void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>& f) const
-  {
-    assert (this->hasRecentDynamicMesh ());
+    this->finishCompression ();
 
-    for (const DynamicMesh& m : this->past.front ().dynamicMeshes)
+    if (this->future.empty () == false)
     {
-      f (m);
+      SceneSnapshot changes = this->untrack (state.scene ());
+      resetToSnapshot (changes, state);
+
+      if (this->future.front ().decompress (this->store) == false)
+      {
+        DILAY_WARN ("could not read spilled snapshot")
+        this->future.clear ();
+        this->track (state.scene (), Tracking::Revert);
+        this->journal.recordAll (state.scene ());
+        return;
+      }
+      this->past.push_front (resetToSnapshot (this->future.front (), state));
+      this->future.pop_front ();
+      this->track (state.scene (), Tracking::Revert);
+      this->journal.recordAll (state.scene ());
+      this->startCompression ();
     }
   }
 
-  void reset ()
+  void reset (Scene& scene)
   {
+    this->finishCompression ();
+
+    scene.forEachMesh ([](DynamicMesh& mesh) {
+      if (mesh.tracksChanges ())
+      {
+        mesh.untrackChanges ();
+      }
+    });
+    scene.clearDeletedMeshes ();
+
     this->past.clear ();
     this->future.clear ();
+    this->store.close ();
+    this->timelineNumBytes = 0;
+    this->tracking = Tracking::None;
+    this->lastStroke.reset ();
+    this->isCoalesced = false;
+    this->journal.reset ();
   }
 
   void runFromConfig (const Config& config)
   {
     this->undoDepth = config.get<int> ("editor/undo-depth");
+    this->maxNumBytes = std::size_t (config.get<int> ("editor/undo-memory")) * 1024 * 1024;
+    this->maxNumSpilledBytes =
+      std::size_t (config.get<int> ("editor/undo-disk-memory")) * 1024 * 1024;
+    this->coalesceTime = (unsigned int) config.get<int> ("editor/undo-coalesce-time");
+    this->finishCompression ();
+    this->journal.fromConfig (config);
   }
 };
 
 DELEGATE1_BIG3 (History, const Config&)
-DELEGATE1 (void, History, snapshotAll, const Scene&)
-DELEGATE1 (void, History, snapshotDynamicMeshes, const Scene&)
-DELEGATE1 (void, History, snapshotSketchMeshes, const Scene&)
+
+void History::cacheDirectory (const std::string& directory) { cacheDir = directory; }
+
+DELEGATE1 (void, History, snapshotAll, Scene&)
+DELEGATE1 (void, History, snapshotDynamicMeshes, Scene&)
+DELEGATE3 (void, History, snapshotStroke, Scene&, const DynamicMesh&, const PrimSphere&)
+DELEGATE1 (void, History, snapshotSketchMeshes, Scene&)
 DELEGATE (void, History, dropPastSnapshot)
 DELEGATE (void, History, dropFutureSnapshot)
 DELEGATE1 (void, History, undo, State&)
 DELEGATE1 (void, History, redo, State&)
-DELEGATE_CONST (bool, History, hasRecentDynamicMesh)
-DELEGATE1_CONST (void, History, forEachRecentDynamicMesh,
-                 const std::function<void(const DynamicMesh&)>&)
-DELEGATE (void, History, reset)
+DELEGATE_CONST (std::size_t, History, numBytes)
+DELEGATE (void, History, relieveMemory)
+DELEGATE1 (void, History, reset, Scene&)
+GETTER (Journal&, History, journal)
 DELEGATE1 (void, History, runFromConfig, const Config&)
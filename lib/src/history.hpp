@@ -5,11 +5,15 @@
 #ifndef DILAY_HISTORY
 #define DILAY_HISTORY
 
+#include <cstddef>
 #include <functional>
+#include <string>
 #include "configurable.hpp"
 #include "macro.hpp"
 
 class DynamicMesh;
+class Journal;
+class PrimSphere;
 class Scene;
 class State;
 
@@ -18,16 +22,30 @@ class History : public Configurable
 public:
   DECLARE_BIG3 (History, const Config&)
 
-  void snapshotAll (const Scene&);
-  void snapshotDynamicMeshes (const Scene&);
-  void snapshotSketchMeshes (const Scene&);
+  // cold snapshots are spilled to the given directory, or to the temporary directory if empty
+  static void cacheDirectory (const std::string&);
+
+  void snapshotAll (Scene&);
+  void snapshotDynamicMeshes (Scene&);
+  /* Snapshots dynamic meshes before a stroke of the given region on a mesh.  A stroke is
+   * coalesced with the previous one, i.e., it shares its snapshot, if both touch the same mesh
+   * in overlapping regions within `editor/undo-coalesce-time`.
+   */
+  void snapshotStroke (Scene&, const DynamicMesh&, const PrimSphere&);
+  // undoing a snapshot of sketch meshes leaves dynamic meshes untouched
+  void snapshotSketchMeshes (Scene&);
   void dropPastSnapshot ();
   void dropFutureSnapshot ();
   void undo (State&);
   void redo (State&);
-  bool hasRecentDynamicMesh () const;
-  void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>&) const;
-  void reset ();
+  void reset (Scene&);
+  // records committed edits to recover from crashes
+  Journal& journal ();
+
+  // returns the memory used by snapshots that are not spilled, measured after the last compression
+  std::size_t numBytes () const;
+  // compresses and spills snapshots regardless of `editor/undo-memory`, e.g., on memory pressure
+  void        relieveMemory ();
 
 private:
   IMPLEMENTATION
@@ -0,0 +1,278 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "idle-tasks.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  enum class TaskStatus
+  {
+    Queued,
+    Running,
+    Done
+  };
+
+  struct TaskState
+  {
+    Parallel::Task task;
+    TaskStatus     status;
+  };
+
+  typedef std::shared_ptr<TaskState> TaskStatePtr;
+
+  /* The dispatcher sleeps until the user is idle and passes the oldest queued task to the pool.
+   * Tasks that have been run by a waiting thread or have been dropped remain in the queue, but
+   * are no longer queued.
+   */
+  struct Scheduler
+  {
+    std::mutex               mutex;
+    std::condition_variable  changed;
+    std::deque<TaskStatePtr> queue;
+    Clock::duration          delay;
+    Clock::time_point        lastInteraction;
+    bool                     isStroking;
+    bool                     isDispatched;
+    bool                     stop;
+    ParallelTaskGroup        dispatched;
+    std::thread              dispatcher;
+
+    Scheduler ()
+      : delay (std::chrono::milliseconds (500))
+      , lastInteraction (Clock::now ())
+      , isStroking (false)
+      , isDispatched (false)
+      , stop (false)
+    {
+      // the pool must outlive the scheduler, which waits for dispatched tasks
+      Parallel::numThreads ();
+
+      this->dispatcher = std::thread ([this]() { this->dispatch (); });
+    }
+
+    ~Scheduler ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->stop = true;
+      }
+      this->changed.notify_all ();
+      this->dispatcher.join ();
+      this->dispatched.wait ();
+    }
+
+    bool isInterrupted () const
+    {
+      return this->isStroking || Clock::now () < this->lastInteraction + this->delay;
+    }
+
+    void dispatch ()
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      while (this->stop == false)
+      {
+        if (this->queue.empty () || this->isDispatched || this->isStroking)
+        {
+          this->changed.wait (lock);
+        }
+        else if (this->isInterrupted ())
+        {
+          this->changed.wait_until (lock, this->lastInteraction + this->delay);
+        }
+        else
+        {
+          TaskStatePtr state = std::move (this->queue.front ());
+          this->queue.pop_front ();
+
+          if (state->status == TaskStatus::Queued)
+          {
+            state->status = TaskStatus::Running;
+            this->isDispatched = true;
+
+            const Parallel::Task run = [this, state]() {
+              state->task ();
+              this->finish (*state, true);
+            };
+
+            // a pool of a single thread has no workers
+            if (Parallel::numThreads () == 1)
+            {
+              lock.unlock ();
+              run ();
+              lock.lock ();
+            }
+            else
+            {
+              this->dispatched.add (run);
+            }
+          }
+        }
+      }
+    }
+
+    void finish (TaskState& state, bool wasDispatched)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+
+        state.status = TaskStatus::Done;
+        state.task = nullptr;
+
+        if (wasDispatched)
+        {
+          this->isDispatched = false;
+        }
+      }
+      this->changed.notify_all ();
+    }
+
+    void push (const TaskStatePtr& state)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->queue.push_back (state);
+      }
+      this->changed.notify_all ();
+    }
+
+    void wait (TaskState& state)
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      if (state.status == TaskStatus::Queued)
+      {
+        state.status = TaskStatus::Running;
+        lock.unlock ();
+        state.task ();
+        this->finish (state, false);
+      }
+      else
+      {
+        this->changed.wait (lock, [&state]() { return state.status == TaskStatus::Done; });
+      }
+    }
+
+    void drop (TaskState& state)
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      if (state.status == TaskStatus::Queued)
+      {
+        state.status = TaskStatus::Done;
+        state.task = nullptr;
+      }
+      else
+      {
+        this->changed.wait (lock, [&state]() { return state.status == TaskStatus::Done; });
+      }
+    }
+  };
+
+  Scheduler& scheduler ()
+  {
+    static Scheduler s;
+    return s;
+  }
+}
+
+namespace IdleTasks
+{
+  void idleDelay (unsigned int milliseconds)
+  {
+    Scheduler& s = scheduler ();
+    {
+      std::lock_guard<std::mutex> lock (s.mutex);
+      s.delay = std::chrono::milliseconds (milliseconds);
+    }
+    s.changed.notify_all ();
+  }
+
+  void interact ()
+  {
+    Scheduler&                  s = scheduler ();
+    std::lock_guard<std::mutex> lock (s.mutex);
+
+    s.lastInteraction = Clock::now ();
+  }
+
+  void isStroking (bool value)
+  {
+    Scheduler& s = scheduler ();
+    {
+      std::lock_guard<std::mutex> lock (s.mutex);
+      s.isStroking = value;
+      s.lastInteraction = Clock::now ();
+    }
+    s.changed.notify_all ();
+  }
+
+  bool isInterrupted ()
+  {
+    Scheduler&                  s = scheduler ();
+    std::lock_guard<std::mutex> lock (s.mutex);
+
+    return s.isInterrupted ();
+  }
+}
+
+struct IdleTask::Impl
+{
+  TaskStatePtr state;
+
+  ~Impl () { this->reset (); }
+
+  bool isValid () const { return bool (this->state); }
+
+  bool isReady () const
+  {
+    if (this->state)
+    {
+      std::lock_guard<std::mutex> lock (scheduler ().mutex);
+      return this->state->status == TaskStatus::Done;
+    }
+    return false;
+  }
+
+  void schedule (const Parallel::Task& task)
+  {
+    assert (this->state == nullptr || this->isReady ());
+
+    this->state = std::make_shared<TaskState> (TaskState{task, TaskStatus::Queued});
+    scheduler ().push (this->state);
+  }
+
+  void wait ()
+  {
+    if (this->state)
+    {
+      scheduler ().wait (*this->state);
+    }
+  }
+
+  void reset ()
+  {
+    if (this->state)
+    {
+      scheduler ().drop (*this->state);
+      this->state.reset ();
+    }
+  }
+};
+
+DELEGATE_BIG2 (IdleTask)
+DELEGATE_CONST (bool, IdleTask, isValid)
+DELEGATE_CONST (bool, IdleTask, isReady)
+DELEGATE1 (void, IdleTask, schedule, const Parallel::Task&)
+DELEGATE (void, IdleTask, wait)
+DELEGATE (void, IdleTask, reset)
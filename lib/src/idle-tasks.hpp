@@ -0,0 +1,45 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_IDLE_TASKS
+#define DILAY_IDLE_TASKS
+
+#include "macro.hpp"
+#include "parallel.hpp"
+
+/* Low-priority tasks run on the thread pool only while the user is idle, i.e., if no interaction
+ * happened for `idleDelay` milliseconds and no stroke is in progress.  Idle tasks are started one
+ * at a time in the order of their scheduling, so that they occupy at most a single core.  An
+ * interaction does not interrupt a running task, but no further tasks are started until the user
+ * is idle again.  Long tasks may poll `isInterrupted` to return early.
+ */
+namespace IdleTasks
+{
+  void idleDelay (unsigned int);
+  // pauses idle tasks
+  void interact ();
+  // idle tasks are paused until the stroke has ended
+  void isStroking (bool);
+  bool isInterrupted ();
+}
+
+class IdleTask
+{
+public:
+  DECLARE_BIG2 (IdleTask)
+
+  bool isValid () const;
+  bool isReady () const;
+  // queues a task, which requires that the previous one is ready
+  void schedule (const Parallel::Task&);
+  // runs the task on the calling thread if it has not been started yet
+  void wait ();
+  // waits for a running task, or drops a queued one
+  void reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -2,13 +2,29 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <list>
 #include <sstream>
+#include <unordered_map>
+#include "config.hpp"
 #include "dynamic/mesh.hpp"
+#include "hash.hpp"
 #include "import-export.hpp"
+#include "journal.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
 #include "scene.hpp"
 #include "sketch/fwd.hpp"
 #include "sketch/mesh.hpp"
@@ -17,349 +33,2991 @@
 
 namespace
 {
-  std::ostream& operator<< (std::ostream& os, const glm::vec3& v)
+  // receives the output of a file in order
+  typedef std::function<void(const char*, std::size_t)> Sink;
+
+  Sink stringSink (std::string& buffer)
+  {
+    return [&buffer](const char* data, std::size_t size) { buffer.append (data, size); };
+  }
+
+  void appendUnsigned (std::string& buffer, unsigned int value)
+  {
+    char         digits[10];
+    unsigned int n = 0;
+
+    do
+    {
+      digits[n++] = char ('0' + (value % 10));
+      value /= 10;
+    } while (value > 0);
+
+    while (n > 0)
+    {
+      buffer.push_back (digits[--n]);
+    }
+  }
+
+  /* Floats are formatted independently of the locale with 9 significant digits, which suffice to
+   * parse the same float again.
+   */
+  void appendFloat (std::string& buffer, float value)
+  {
+    assert (std::isfinite (value));
+
+    if (value == 0.0f)
+    {
+      buffer.push_back ('0');
+      return;
+    }
+    else if (value < 0.0f)
+    {
+      buffer.push_back ('-');
+    }
+
+    const auto scaled = [](double v, int e) {
+      return e >= 0 ? v / std::pow (10.0, e) : v * std::pow (10.0, -e);
+    };
+    const double v = std::abs (double (value));
+    int          exponent = int (std::floor (std::log10 (v)));
+    uint64_t     digits = uint64_t (std::llround (scaled (v, exponent - 8)));
+
+    if (digits >= 1000000000ull)
+    {
+      exponent++;
+      digits = uint64_t (std::llround (scaled (v, exponent - 8)));
+    }
+    else if (digits < 100000000ull)
+    {
+      exponent--;
+      digits = uint64_t (std::llround (scaled (v, exponent - 8)));
+    }
+
+    char digitChars[9];
+    int  numDigits = 9;
+
+    for (int i = 8; i >= 0; i--)
+    {
+      digitChars[i] = char ('0' + (digits % 10));
+      digits /= 10;
+    }
+    while (numDigits > 1 && digitChars[numDigits - 1] == '0')
+    {
+      numDigits--;
+    }
+
+    if (exponent >= 0 && exponent < 9)
+    {
+      for (int i = 0; i <= exponent; i++)
+      {
+        buffer.push_back (i < numDigits ? digitChars[i] : '0');
+      }
+      if (numDigits > exponent + 1)
+      {
+        buffer.push_back ('.');
+        buffer.append (digitChars + exponent + 1, numDigits - exponent - 1);
+      }
+    }
+    else if (exponent < 0 && exponent >= -5)
+    {
+      buffer.append ("0.");
+      buffer.append (-exponent - 1, '0');
+      buffer.append (digitChars, numDigits);
+    }
+    else
+    {
+      buffer.push_back (digitChars[0]);
+      if (numDigits > 1)
+      {
+        buffer.push_back ('.');
+        buffer.append (digitChars + 1, numDigits - 1);
+      }
+      buffer.push_back ('e');
+      if (exponent < 0)
+      {
+        buffer.push_back ('-');
+      }
+      appendUnsigned (buffer, (unsigned int) std::abs (exponent));
+    }
+  }
+
+  void appendVec3 (std::string& buffer, const glm::vec3& v)
+  {
+    appendFloat (buffer, v.x);
+    buffer.push_back (' ');
+    appendFloat (buffer, v.y);
+    buffer.push_back (' ');
+    appendFloat (buffer, v.z);
+  }
+
+  // a range of vertices or faces of a mesh, which is formatted independently of other blocks
+  struct TextBlock
+  {
+    const Mesh*  mesh;
+    bool         isFirst;
+    bool         isVertices;
+    unsigned int begin;
+    unsigned int end;
+  };
+
+  void toDlyFile (std::string& buffer, const TextBlock& block)
+  {
+    const Mesh& mesh = *block.mesh;
+
+    if (block.isFirst)
+    {
+      buffer.append ("o\n");
+    }
+    if (block.isVertices)
+    {
+      for (unsigned int i = block.begin; i < block.end; i++)
+      {
+        buffer.append ("v ");
+        appendVec3 (buffer, mesh.vertex (i));
+        buffer.push_back ('\n');
+      }
+    }
+    else
+    {
+      for (unsigned int i = block.begin; i < block.end; i++)
+      {
+        buffer.append ("f ");
+        appendUnsigned (buffer, mesh.index ((3 * i) + 0) + 1);
+        buffer.push_back (' ');
+        appendUnsigned (buffer, mesh.index ((3 * i) + 1) + 1);
+        buffer.push_back (' ');
+        appendUnsigned (buffer, mesh.index ((3 * i) + 2) + 1);
+        buffer.push_back ('\n');
+      }
+    }
+  }
+
+  std::vector<TextBlock> textBlocks (const Mesh& mesh)
+  {
+    static constexpr unsigned int blockSize = 1 << 16;
+
+    std::vector<TextBlock> blocks;
+    const unsigned int     numFaces = mesh.numIndices () / 3;
+
+    blocks.push_back (TextBlock{&mesh, true, true, 0, glm::min (blockSize, mesh.numVertices ())});
+
+    for (unsigned int i = blockSize; i < mesh.numVertices (); i += blockSize)
+    {
+      blocks.push_back (
+        TextBlock{&mesh, false, true, i, glm::min (i + blockSize, mesh.numVertices ())});
+    }
+    for (unsigned int i = 0; i < numFaces; i += blockSize)
+    {
+      blocks.push_back (TextBlock{&mesh, false, false, i, glm::min (i + blockSize, numFaces)});
+    }
+    return blocks;
+  }
+
+  unsigned int toDlyFile (std::string& buffer, const SketchNode& node, unsigned int parentIndex,
+                          unsigned nodeIndex)
+  {
+    buffer.append ("dly_sketch_node ");
+    appendUnsigned (buffer, nodeIndex);
+    buffer.push_back (' ');
+    appendUnsigned (buffer, parentIndex);
+    buffer.push_back (' ');
+    appendVec3 (buffer, node.data ().center ());
+    buffer.push_back (' ');
+    appendFloat (buffer, node.data ().radius ());
+    buffer.push_back ('\n');
+
+    unsigned int childIndex = nodeIndex;
+
+    node.forEachConstChild ([&buffer, nodeIndex, &childIndex](const SketchNode& child) {
+      childIndex = toDlyFile (buffer, child, nodeIndex, childIndex + 1);
+    });
+    return childIndex;
+  }
+
+  void toDlyFile (std::string& buffer, const SketchPath& path)
+  {
+    if (path.isEmpty () == false)
+    {
+      buffer.append ("dly_sketch_path ");
+      appendVec3 (buffer, path.intersectionFirst ());
+      buffer.push_back (' ');
+      appendVec3 (buffer, path.intersectionLast ());
+      buffer.push_back ('\n');
+
+      for (const PrimSphere& s : path.spheres ())
+      {
+        buffer.append ("dly_sketch_sphere ");
+        appendVec3 (buffer, s.center ());
+        buffer.push_back (' ');
+        appendFloat (buffer, s.radius ());
+        buffer.push_back ('\n');
+      }
+    }
+  }
+
+  void toDlyFile (std::string& buffer, const ImportExport::FrozenSketchMesh& mesh)
+  {
+    buffer.append ("dly_sketch_mesh\n");
+
+    if (mesh.tree.hasRoot ())
+    {
+      toDlyFile (buffer, mesh.tree.root (), Util::invalidIndex (), 0);
+    }
+
+    for (const SketchPath& p : mesh.paths)
+    {
+      toDlyFile (buffer, p);
+    }
+  }
+
+  // copies the used vertices and faces of a frozen mesh
+  Mesh prunedMesh (const ImportExport::FrozenMesh& frozen)
+  {
+    if (frozen.freeVertices.empty () && frozen.freeFaces.empty ())
+    {
+      return frozen.mesh;
+    }
+
+    const Mesh&               mesh = frozen.mesh;
+    Mesh                      pruned;
+    std::vector<unsigned int> vertexIndexMap (mesh.numVertices (), Util::invalidIndex ());
+
+    pruned.copyNonGeometry (mesh);
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      if (frozen.freeVertices[i] == false)
+      {
+        vertexIndexMap[i] = pruned.addVertex (mesh.vertex (i), mesh.normal (i));
+      }
+    }
+    for (unsigned int i = 0; i < mesh.numIndices () / 3; i++)
+    {
+      if (frozen.freeFaces[i] == false)
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          assert (vertexIndexMap[mesh.index ((3 * i) + j)] != Util::invalidIndex ());
+          pruned.addIndex (vertexIndexMap[mesh.index ((3 * i) + j)]);
+        }
+      }
+    }
+    return pruned;
+  }
+
+  void reportProgress (const ImportExport::Progress& progress, unsigned int done,
+                       unsigned int total)
+  {
+    if (progress && total > 0)
+    {
+      progress (float (done) / float (total));
+    }
+  }
+
+  /* Blocks are formatted in parallel into reused buffers, which are passed to the sink in
+   * order.
+   */
+  void toDlyFile (const Sink& sink, const ImportExport::FrozenScene& scene, bool isObjFile,
+                  const ImportExport::Progress& progress)
+  {
+    std::vector<Mesh>      meshes;
+    std::vector<TextBlock> blocks;
+
+    meshes.reserve (scene.meshes.size ());
+    for (const ImportExport::FrozenMesh& mesh : scene.meshes)
+    {
+      meshes.push_back (prunedMesh (mesh));
+
+      const std::vector<TextBlock> meshBlocks = textBlocks (meshes.back ());
+      blocks.insert (blocks.end (), meshBlocks.begin (), meshBlocks.end ());
+    }
+
+    const unsigned int       batchSize = 4 * Parallel::numThreads ();
+    std::vector<std::string> buffers (batchSize);
+
+    for (unsigned int batch = 0; batch < blocks.size (); batch += batchSize)
+    {
+      const unsigned int n = glm::min (batchSize, (unsigned int) (blocks.size () - batch));
+
+      Parallel::forEach (n, [&blocks, &buffers, batch](unsigned int i) {
+        buffers[i].clear ();
+        toDlyFile (buffers[i], blocks[batch + i]);
+      });
+
+      for (unsigned int i = 0; i < n; i++)
+      {
+        sink (buffers[i].data (), buffers[i].size ());
+      }
+      reportProgress (progress, batch + n, blocks.size ());
+    }
+
+    if (isObjFile == false)
+    {
+      std::string& buffer = buffers.front ();
+
+      buffer.clear ();
+      for (const ImportExport::FrozenSketchMesh& mesh : scene.sketchMeshes)
+      {
+        toDlyFile (buffer, mesh);
+      }
+      sink (buffer.data (), buffer.size ());
+    }
+  }
+
+  /* Binary files start with `binaryMagic` followed by the version and the 64 bit offset of the
+   * index.  The index stores the number of meshes and the number of sketch meshes followed by one
+   * chunk per mesh and a single chunk of all sketch meshes.  A chunk is given by its 64 bit offset,
+   * its 64 bit size and a 64 bit hash of its content.  Each mesh stores its number of vertices and
+   * indices followed by the vertices, the normals and the indices.  Each sketch mesh stores its
+   * number of nodes and paths followed by a table of nodes in pre-order (parent index, center,
+   * radius) and its paths (first intersection, last intersection, number of spheres, spheres).
+   * All values are 32 bit little-endian integers or floats, 64 bit values are stored as two 32
+   * bit integers (low, high).  Compressed meshes start with `compressedMeshMarker` followed by
+   * their number of vertices and indices and the size of the compressed data, which is padded
+   * to 32 bit.  Their vertices and normals are byte-shuffled and their indices are delta-encoded
+   * and byte-shuffled before being compressed by zlib.  Files of version 1 store the number of
+   * meshes and sketch meshes in the header, which is followed by the meshes and the sketch
+   * meshes.  Since version 3, the index stores a chunk of the layout of each mesh after the
+   * chunks of meshes, whose size is zero if no layout is stored.  A layout stores the hash of
+   * the chunk of its mesh, the number of octree nodes, elements, vertices and adjacent faces,
+   * followed by the nodes (center, width, depth, child mask, number of elements), the elements
+   * of each node, the valence of each vertex and the adjacent faces of each vertex.  Layouts are
+   * only used if their hashes match.  Since version 4, the header additionally stores the 64 bit
+   * offset and size of an optional preview image, which is embedded after the file has been
+   * written and is padded to 32 bit.
+   */
+  static constexpr char         binaryMagic[4] = {'D', 'L', 'Y', 'B'};
+  static constexpr unsigned int binaryVersion = 4;
+  static constexpr std::size_t  binaryHeaderSize = 32;
+  static constexpr std::size_t  binaryPreviewOffset = 16;
+  static constexpr uint32_t     compressedMeshMarker = 0xffffffff;
+
+  static_assert (sizeof (glm::vec3) == 3 * sizeof (float), "Unexpected memory layout");
+  static_assert (sizeof (unsigned int) == sizeof (uint32_t), "Unexpected memory layout");
+  static_assert (sizeof (DynamicOctreeLayout::Node) == 7 * sizeof (uint32_t),
+                 "Unexpected memory layout");
+
+  // a separately addressable part of a binary file
+  struct BinaryChunk
+  {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t hash;
+
+    bool operator== (const BinaryChunk& other) const
+    {
+      return this->offset == other.offset && this->size == other.size && this->hash == other.hash;
+    }
+  };
+
+  struct BinaryIndex
+  {
+    uint32_t                 version = binaryVersion;
+    std::vector<BinaryChunk> meshes;
+    std::vector<BinaryChunk> layouts;
+    BinaryChunk              sketchMeshes;
+    uint32_t                 numSketchMeshes;
+    BinaryChunk              preview = {0, 0, 0};
+  };
+
+  // hashes 32 bit words, i.e., the size of the data must be a multiple of 4
+  uint64_t hashBinary (uint64_t hash, const char* data, std::size_t size)
+  {
+    assert (size % 4 == 0);
+
+    for (std::size_t i = 0; i < size; i += 4)
+    {
+      uint32_t word;
+      std::memcpy (&word, data + i, 4);
+      hash = Hash::mix (hash ^ word);
+    }
+    return hash;
+  }
+
+  static constexpr uint64_t binaryHashSeed = 0xcbf29ce484222325ull;
+
+  bool isLittleEndian ()
+  {
+    const uint32_t value = 1;
+    unsigned char  byte;
+    std::memcpy (&byte, &value, 1);
+    return byte == 1;
+  }
+
+  template <typename T> void writeBinary (const Sink& sink, const T* values, std::size_t n)
+  {
+    sink (reinterpret_cast<const char*> (values), n * sizeof (T));
+  }
+
+  void writeBinary (const Sink& sink, uint32_t value) { writeBinary (sink, &value, 1); }
+
+  void writeBinary (const Sink& sink, uint64_t value)
+  {
+    writeBinary (sink, uint32_t (value));
+    writeBinary (sink, uint32_t (value >> 32));
+  }
+
+  void writeBinary (const Sink& sink, float value) { writeBinary (sink, &value, 1); }
+
+  void writeBinary (const Sink& sink, const glm::vec3& v) { writeBinary (sink, &v, 1); }
+
+  void writeBinary (const Sink& sink, const PrimSphere& s)
+  {
+    writeBinary (sink, s.center ());
+    writeBinary (sink, s.radius ());
+  }
+
+  void writeBinary (const Sink& sink, const BinaryChunk& chunk)
+  {
+    writeBinary (sink, chunk.offset);
+    writeBinary (sink, chunk.size);
+    writeBinary (sink, chunk.hash);
+  }
+
+  void writeBinary (const Sink& sink, const BinaryIndex& index)
+  {
+    writeBinary (sink, uint32_t (index.meshes.size ()));
+    writeBinary (sink, index.numSketchMeshes);
+
+    for (const BinaryChunk& chunk : index.meshes)
+    {
+      writeBinary (sink, chunk);
+    }
+    for (const BinaryChunk& chunk : index.layouts)
+    {
+      writeBinary (sink, chunk);
+    }
+    writeBinary (sink, index.sketchMeshes);
+  }
+
+  void toBinaryDlyFile (const Sink& sink, const Mesh& mesh)
+  {
+    std::vector<glm::vec3>    vertices;
+    std::vector<glm::vec3>    normals;
+    std::vector<unsigned int> indices;
+
+    vertices.reserve (mesh.numVertices ());
+    normals.reserve (mesh.numVertices ());
+    indices.reserve (mesh.numIndices ());
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      vertices.push_back (mesh.vertex (i));
+      normals.push_back (mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i++)
+    {
+      indices.push_back (mesh.index (i));
+    }
+
+    writeBinary (sink, uint32_t (mesh.numVertices ()));
+    writeBinary (sink, uint32_t (mesh.numIndices ()));
+    writeBinary (sink, vertices.data (), vertices.size ());
+    writeBinary (sink, normals.data (), normals.size ());
+    writeBinary (sink, indices.data (), indices.size ());
+  }
+
+  uint64_t binaryLayoutSize (const DynamicMeshLayout& layout)
+  {
+    if (layout.isEmpty ())
+    {
+      return 0;
+    }
+    const uint64_t numWords =
+      layout.octree.elements.size () + layout.valences.size () + layout.adjacency.size ();
+
+    return 24 + (sizeof (DynamicOctreeLayout::Node) * layout.octree.nodes.size ()) +
+           (sizeof (uint32_t) * numWords);
+  }
+
+  void toBinaryDlyFile (const Sink& sink, uint64_t meshHash, const DynamicMeshLayout& layout)
+  {
+    assert (layout.isEmpty () == false);
+
+    writeBinary (sink, meshHash);
+    writeBinary (sink, uint32_t (layout.octree.nodes.size ()));
+    writeBinary (sink, uint32_t (layout.octree.elements.size ()));
+    writeBinary (sink, uint32_t (layout.valences.size ()));
+    writeBinary (sink, uint32_t (layout.adjacency.size ()));
+    writeBinary (sink, layout.octree.nodes.data (), layout.octree.nodes.size ());
+    writeBinary (sink, layout.octree.elements.data (), layout.octree.elements.size ());
+    writeBinary (sink, layout.valences.data (), layout.valences.size ());
+    writeBinary (sink, layout.adjacency.data (), layout.adjacency.size ());
+  }
+
+  // groups the n-th bytes of 32 bit values, which are compressed better
+  void shuffleBytes (const char* values, std::size_t numValues, char* shuffled)
+  {
+    for (std::size_t i = 0; i < numValues; i++)
+    {
+      for (std::size_t b = 0; b < 4; b++)
+      {
+        shuffled[(b * numValues) + i] = values[(4 * i) + b];
+      }
+    }
+  }
+
+  void unshuffleBytes (const char* shuffled, std::size_t numValues, char* values)
+  {
+    for (std::size_t i = 0; i < numValues; i++)
+    {
+      for (std::size_t b = 0; b < 4; b++)
+      {
+        values[(4 * i) + b] = shuffled[(b * numValues) + i];
+      }
+    }
+  }
+
+  /* Compresses the chunk of a mesh.  The chunk is returned uncompressed if it is too large for
+   * zlib or if it does not shrink.
+   */
+  std::string compressedMeshChunk (std::string chunk)
+  {
+    uint32_t numVertices, numIndices;
+
+    std::memcpy (&numVertices, chunk.data (), 4);
+    std::memcpy (&numIndices, chunk.data () + 4, 4);
+
+    const std::size_t numFloats = 6 * std::size_t (numVertices);
+    const char*       indices = chunk.data () + 8 + (4 * numFloats);
+
+    if (chunk.size () - 8 > std::size_t (std::numeric_limits<int>::max () / 2))
+    {
+      return chunk;
+    }
+
+    // differences of consecutive indices are zigzag-encoded, i.e., small values stay small
+    std::vector<uint32_t> deltas (numIndices);
+    uint32_t              previous = 0;
+
+    for (uint32_t i = 0; i < numIndices; i++)
+    {
+      uint32_t index;
+      std::memcpy (&index, indices + (4 * i), 4);
+
+      const uint32_t delta = index - previous;
+      deltas[i] = (delta << 1) ^ (0u - (delta >> 31));
+      previous = index;
+    }
+
+    QByteArray filtered (int (chunk.size () - 8), Qt::Uninitialized);
+
+    shuffleBytes (chunk.data () + 8, numFloats, filtered.data ());
+    shuffleBytes (reinterpret_cast<const char*> (deltas.data ()), numIndices,
+                  filtered.data () + (4 * numFloats));
+
+    const QByteArray  compressed = qCompress (filtered);
+    const std::size_t padding = (4 - (compressed.size () % 4)) % 4;
+
+    if (16 + compressed.size () + padding >= chunk.size ())
+    {
+      return chunk;
+    }
+
+    std::string result;
+    const Sink  sink = stringSink (result);
+
+    writeBinary (sink, compressedMeshMarker);
+    writeBinary (sink, numVertices);
+    writeBinary (sink, numIndices);
+    writeBinary (sink, uint32_t (compressed.size ()));
+    result.append (compressed.constData (), compressed.size ());
+    result.append (padding, '\0');
+    return result;
+  }
+
+  void toBinaryDlyFile (const Sink& sink, const SketchNode& node, unsigned int parentIndex,
+                        unsigned int& nodeIndex)
+  {
+    const unsigned int index = nodeIndex++;
+
+    writeBinary (sink, uint32_t (parentIndex));
+    writeBinary (sink, node.data ());
+
+    node.forEachConstChild ([&sink, index, &nodeIndex](const SketchNode& child) {
+      toBinaryDlyFile (sink, child, index, nodeIndex);
+    });
+  }
+
+  void toBinaryDlyFile (const Sink& sink, const ImportExport::FrozenSketchMesh& mesh)
+  {
+    const auto numPaths = std::count_if (mesh.paths.begin (), mesh.paths.end (),
+                                         [](const SketchPath& p) { return p.isEmpty () == false; });
+
+    writeBinary (sink, uint32_t (mesh.tree.hasRoot () ? mesh.tree.root ().numNodes () : 0));
+    writeBinary (sink, uint32_t (numPaths));
+
+    if (mesh.tree.hasRoot ())
+    {
+      unsigned int nodeIndex = 0;
+      toBinaryDlyFile (sink, mesh.tree.root (), Util::invalidIndex (), nodeIndex);
+    }
+
+    for (const SketchPath& p : mesh.paths)
+    {
+      if (p.isEmpty () == false)
+      {
+        writeBinary (sink, p.intersectionFirst ());
+        writeBinary (sink, p.intersectionLast ());
+        writeBinary (sink, uint32_t (p.spheres ().size ()));
+
+        for (const PrimSphere& s : p.spheres ())
+        {
+          writeBinary (sink, s);
+        }
+      }
+    }
+  }
+
+  // reads from the memory of a mapped file, which is aligned to 32 bit
+  struct BinaryReader
+  {
+    const unsigned char* data;
+    std::size_t          size;
+    std::size_t          position;
+
+    BinaryReader (const unsigned char* d, std::size_t s)
+      : data (d)
+      , size (s)
+      , position (0)
+    {
+    }
+
+    template <typename T> const T* readArray (std::size_t n)
+    {
+      static_assert (alignof (T) <= 4, "Unexpected alignment");
+
+      if (n > (this->size - this->position) / sizeof (T))
+      {
+        return nullptr;
+      }
+      const T* values = reinterpret_cast<const T*> (this->data + this->position);
+      this->position += n * sizeof (T);
+      return values;
+    }
+
+    template <typename T> bool read (T& value)
+    {
+      const T* values = this->readArray<T> (1);
+
+      if (values)
+      {
+        value = *values;
+        return true;
+      }
+      return false;
+    }
+
+    bool read (uint64_t& value)
+    {
+      uint32_t low, high;
+
+      if (this->read (low) && this->read (high))
+      {
+        value = (uint64_t (high) << 32) | uint64_t (low);
+        return true;
+      }
+      return false;
+    }
+
+    bool read (BinaryChunk& chunk)
+    {
+      return this->read (chunk.offset) && this->read (chunk.size) && this->read (chunk.hash) &&
+             chunk.offset % 4 == 0 && chunk.offset <= this->size &&
+             chunk.size <= this->size - chunk.offset;
+    }
+
+    // reads the offset and size of the preview in the header of files of version 4 or later
+    bool readPreview (BinaryChunk& chunk)
+    {
+      chunk.hash = 0;
+      return this->read (chunk.offset) && this->read (chunk.size) &&
+             chunk.offset <= this->size && chunk.size <= this->size - chunk.offset;
+    }
+
+    // a reader of the data of a chunk
+    BinaryReader chunkReader (const BinaryChunk& chunk) const
+    {
+      return BinaryReader (this->data + chunk.offset, std::size_t (chunk.size));
+    }
+  };
+
+  // reads the header and the index of a file with an index, i.e., of version 2 or later
+  bool readBinaryIndex (BinaryReader& reader, BinaryIndex& index)
+  {
+    uint32_t numMeshes;
+    uint64_t indexOffset;
+
+    reader.position = 0;
+    if (reader.readArray<char> (sizeof (binaryMagic)) == nullptr ||
+        std::memcmp (reader.data, binaryMagic, sizeof (binaryMagic)) != 0 ||
+        reader.read (index.version) == false || index.version < 2 ||
+        index.version > binaryVersion || reader.read (indexOffset) == false ||
+        indexOffset % 4 != 0 || indexOffset > reader.size ||
+        (index.version >= 4 && reader.readPreview (index.preview) == false))
+    {
+      return false;
+    }
+
+    reader.position = std::size_t (indexOffset);
+    if (reader.read (numMeshes) == false || reader.read (index.numSketchMeshes) == false ||
+        numMeshes > reader.size)
+    {
+      return false;
+    }
+
+    index.meshes.resize (numMeshes);
+    index.layouts.resize (numMeshes, BinaryChunk{0, 0, 0});
+    for (BinaryChunk& chunk : index.meshes)
+    {
+      if (reader.read (chunk) == false)
+      {
+        return false;
+      }
+    }
+    if (index.version >= 3)
+    {
+      for (BinaryChunk& chunk : index.layouts)
+      {
+        if (reader.read (chunk) == false)
+        {
+          return false;
+        }
+      }
+    }
+    return reader.read (index.sketchMeshes);
+  }
+
+  // the layout of a mesh is validated by its hash and the hash of the mesh's chunk
+  bool fromBinaryDlyFile (BinaryReader& reader, const BinaryChunk& layoutChunk, uint64_t meshHash,
+                          DynamicMeshLayout& layout)
+  {
+    uint64_t storedMeshHash;
+    uint32_t numNodes, numElements, numVertices, numAdjacent;
+
+    if (reader.size % 4 != 0 ||
+        hashBinary (binaryHashSeed, reinterpret_cast<const char*> (reader.data), reader.size) !=
+          layoutChunk.hash ||
+        reader.read (storedMeshHash) == false || storedMeshHash != meshHash ||
+        reader.read (numNodes) == false || reader.read (numElements) == false ||
+        reader.read (numVertices) == false || reader.read (numAdjacent) == false)
+    {
+      return false;
+    }
+
+    const DynamicOctreeLayout::Node* nodes = reader.readArray<DynamicOctreeLayout::Node> (numNodes);
+    const unsigned int*              elements = reader.readArray<unsigned int> (numElements);
+    const unsigned int*              valences = reader.readArray<unsigned int> (numVertices);
+    const unsigned int*              adjacency = reader.readArray<unsigned int> (numAdjacent);
+
+    if (nodes == nullptr || elements == nullptr || valences == nullptr || adjacency == nullptr ||
+        reader.position != reader.size)
+    {
+      return false;
+    }
+    layout.octree.nodes.assign (nodes, nodes + numNodes);
+    layout.octree.elements.assign (elements, elements + numElements);
+    layout.valences.assign (valences, valences + numVertices);
+    layout.adjacency.assign (adjacency, adjacency + numAdjacent);
+    return true;
+  }
+
+  bool addBinaryMesh (Mesh& mesh, const glm::vec3* vertices, const glm::vec3* normals,
+                      const unsigned int* indices, uint32_t numVertices, uint32_t numIndices)
+  {
+    if (std::any_of (indices, indices + numIndices,
+                     [numVertices](unsigned int i) { return i >= numVertices; }))
+    {
+      return false;
+    }
+    mesh.addVertices (vertices, normals, numVertices);
+    mesh.addIndices (indices, numIndices);
+    return true;
+  }
+
+  bool fromCompressedBinaryDlyFile (BinaryReader& reader, Mesh& mesh)
+  {
+    uint32_t numVertices, numIndices, compressedSize;
+
+    if (reader.read (numVertices) == false || reader.read (numIndices) == false ||
+        reader.read (compressedSize) == false || numIndices % 3 != 0 ||
+        compressedSize > uint32_t (std::numeric_limits<int>::max ()))
+    {
+      return false;
+    }
+
+    const std::size_t numFloats = 6 * std::size_t (numVertices);
+    const std::size_t padding = (4 - (compressedSize % 4)) % 4;
+    const char*       compressed = reader.readArray<char> (compressedSize + padding);
+
+    if (compressed == nullptr)
+    {
+      return false;
+    }
+
+    const QByteArray filtered =
+      qUncompress (reinterpret_cast<const uchar*> (compressed), int (compressedSize));
+
+    if (std::size_t (filtered.size ()) != 4 * (numFloats + numIndices))
+    {
+      return false;
+    }
+
+    std::vector<glm::vec3>    attributes (2 * std::size_t (numVertices));
+    std::vector<unsigned int> indices (numIndices);
+    uint32_t                  previous = 0;
+
+    unshuffleBytes (filtered.constData (), numFloats, reinterpret_cast<char*> (attributes.data ()));
+    unshuffleBytes (filtered.constData () + (4 * numFloats), numIndices,
+                    reinterpret_cast<char*> (indices.data ()));
+
+    for (unsigned int& index : indices)
+    {
+      index = previous + ((index >> 1) ^ (0u - (index & 1u)));
+      previous = index;
+    }
+    return addBinaryMesh (mesh, attributes.data (), attributes.data () + numVertices,
+                          indices.data (), numVertices, numIndices);
+  }
+
+  bool fromBinaryDlyFile (BinaryReader& reader, Mesh& mesh)
+  {
+    uint32_t numVertices, numIndices;
+
+    if (reader.read (numVertices) == false)
+    {
+      return false;
+    }
+    else if (numVertices == compressedMeshMarker)
+    {
+      return fromCompressedBinaryDlyFile (reader, mesh);
+    }
+    else if (reader.read (numIndices) == false || numIndices % 3 != 0)
+    {
+      return false;
+    }
+
+    const glm::vec3*    vertices = reader.readArray<glm::vec3> (numVertices);
+    const glm::vec3*    normals = reader.readArray<glm::vec3> (numVertices);
+    const unsigned int* indices = reader.readArray<unsigned int> (numIndices);
+
+    if (vertices == nullptr || normals == nullptr || indices == nullptr)
+    {
+      return false;
+    }
+    return addBinaryMesh (mesh, vertices, normals, indices, numVertices, numIndices);
+  }
+
+  bool fromBinaryDlyFile (BinaryReader& reader, SketchMesh& mesh)
+  {
+    uint32_t numNodes, numPaths;
+
+    if (reader.read (numNodes) == false || reader.read (numPaths) == false)
+    {
+      return false;
+    }
+
+    std::vector<SketchNode*> nodes;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+      uint32_t  parentIndex;
+      glm::vec3 center;
+      float     radius;
+
+      if (reader.read (parentIndex) == false || reader.read (center) == false ||
+          reader.read (radius) == false)
+      {
+        return false;
+      }
+      else if (i == 0)
+      {
+        nodes.push_back (&mesh.tree ().emplaceRoot (PrimSphere (center, radius)));
+      }
+      else if (parentIndex < nodes.size ())
+      {
+        nodes.push_back (&nodes[parentIndex]->emplaceChild (PrimSphere (center, radius)));
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    for (uint32_t i = 0; i < numPaths; i++)
+    {
+      glm::vec3 intersectionFirst, intersectionLast;
+      uint32_t  numSpheres;
+
+      if (reader.read (intersectionFirst) == false || reader.read (intersectionLast) == false ||
+          reader.read (numSpheres) == false)
+      {
+        return false;
+      }
+
+      SketchPath& path = mesh.addPath (SketchPath ());
+      for (uint32_t j = 0; j < numSpheres; j++)
+      {
+        glm::vec3 center;
+        float     radius;
+
+        if (reader.read (center) == false || reader.read (radius) == false)
+        {
+          return false;
+        }
+        path.addSphere (j == 0 ? intersectionFirst : intersectionLast, center, radius);
+      }
+    }
+    return true;
+  }
+
+  bool isBinaryDlyFile (const unsigned char* data, std::size_t size)
+  {
+    return size >= sizeof (binaryMagic) &&
+           std::memcmp (data, binaryMagic, sizeof (binaryMagic)) == 0;
+  }
+
+  // a line of a text file, whose numbers are parsed independently of the locale
+  struct TextLine
+  {
+    const char* position;
+    const char* end;
+
+    TextLine (const char* b, const char* e)
+      : position (b)
+      , end (e)
+    {
+    }
+
+    static bool isSpace (char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static bool isDigit (char c) { return c >= '0' && c <= '9'; }
+
+    bool isTokenEnd () const { return this->position == this->end || isSpace (*this->position); }
+
+    void skipSpace ()
+    {
+      while (this->position < this->end && isSpace (*this->position))
+      {
+        this->position++;
+      }
+    }
+
+    bool readKeyword (const char*& begin, std::size_t& length)
+    {
+      this->skipSpace ();
+      begin = this->position;
+
+      while (this->isTokenEnd () == false)
+      {
+        this->position++;
+      }
+      length = this->position - begin;
+      return length > 0;
+    }
+
+    bool read (unsigned int& value)
+    {
+      this->skipSpace ();
+
+      uint64_t result = 0;
+      if (this->position == this->end || isDigit (*this->position) == false)
+      {
+        return false;
+      }
+      while (this->position < this->end && isDigit (*this->position))
+      {
+        result = (10 * result) + (*this->position - '0');
+        this->position++;
+
+        if (result > std::numeric_limits<unsigned int>::max ())
+        {
+          return false;
+        }
+      }
+      value = (unsigned int) result;
+      return true;
+    }
+
+    // reads the first index of a face vertex like `1/2/3`
+    bool readFaceIndex (unsigned int& value)
+    {
+      if (this->read (value))
+      {
+        while (this->isTokenEnd () == false)
+        {
+          this->position++;
+        }
+        return true;
+      }
+      return false;
+    }
+
+    bool read (float& value)
+    {
+      static const double powersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                          1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+      this->skipSpace ();
+
+      const char* p = this->position;
+      bool        isNegative = false;
+      uint64_t    mantissa = 0;
+      int         exponent = 0;
+      bool        hasDigits = false;
+
+      if (p < this->end && (*p == '-' || *p == '+'))
+      {
+        isNegative = *p == '-';
+        p++;
+      }
+      for (; p < this->end && isDigit (*p); p++)
+      {
+        hasDigits = true;
+        if (mantissa < 100000000000000000ull)
+        {
+          mantissa = (10 * mantissa) + (*p - '0');
+        }
+        else
+        {
+          exponent++;
+        }
+      }
+      if (p < this->end && *p == '.')
+      {
+        for (p++; p < this->end && isDigit (*p); p++)
+        {
+          hasDigits = true;
+          if (mantissa < 100000000000000000ull)
+          {
+            mantissa = (10 * mantissa) + (*p - '0');
+            exponent--;
+          }
+        }
+      }
+      if (hasDigits == false)
+      {
+        return false;
+      }
+      if (p < this->end && (*p == 'e' || *p == 'E'))
+      {
+        p++;
+        bool isNegativeExponent = false;
+        int  e = 0;
+
+        if (p < this->end && (*p == '-' || *p == '+'))
+        {
+          isNegativeExponent = *p == '-';
+          p++;
+        }
+        if (p == this->end || isDigit (*p) == false)
+        {
+          return false;
+        }
+        for (; p < this->end && isDigit (*p); p++)
+        {
+          e = glm::min ((10 * e) + (*p - '0'), 1000);
+        }
+        exponent += isNegativeExponent ? -e : e;
+      }
+      this->position = p;
+
+      if (this->isTokenEnd () == false)
+      {
+        return false;
+      }
+
+      double result = double (mantissa);
+      if (exponent < 0 && exponent >= -22)
+      {
+        result /= powersOf10[-exponent];
+      }
+      else if (exponent > 0 && exponent <= 22)
+      {
+        result *= powersOf10[exponent];
+      }
+      else if (exponent != 0)
+      {
+        result *= std::pow (10.0, exponent);
+      }
+      value = float (isNegative ? -result : result);
+      return true;
+    }
+
+    bool read (glm::vec3& v) { return this->read (v.x) && this->read (v.y) && this->read (v.z); }
+  };
+
+  enum class TextKeyword
+  {
+    Object,
+    SketchMesh,
+    SketchNode,
+    SketchPath,
+    SketchSphere
+  };
+
+  // a line that is not a vertex or a face, which is applied when merging the chunks
+  struct TextMarker
+  {
+    TextKeyword  keyword;
+    unsigned int lineNumber;
+    unsigned int numVertices;
+    unsigned int numIndices;
+    unsigned int index1, index2;
+    glm::vec3    vector1, vector2;
+    float        radius;
+
+    TextMarker (TextKeyword k, unsigned int l, unsigned int v, unsigned int i)
+      : keyword (k)
+      , lineNumber (l)
+      , numVertices (v)
+      , numIndices (i)
+      , index1 (0)
+      , index2 (0)
+      , vector1 (0.0f)
+      , vector2 (0.0f)
+      , radius (0.0f)
+    {
+    }
+  };
+
+  // line numbers are relative to the beginning of the chunk
+  struct TextChunk
+  {
+    const char*               begin;
+    const char*               end;
+    unsigned int              numLines;
+    std::vector<glm::vec3>    vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TextMarker>   markers;
+    const char*               error;
+    unsigned int              errorLine;
+
+    TextChunk (const char* b, const char* e)
+      : begin (b)
+      , end (e)
+      , numLines (0)
+      , error (nullptr)
+      , errorLine (0)
+    {
+    }
+
+    bool fail (const char* message)
+    {
+      this->error = message;
+      this->errorLine = this->numLines;
+      return false;
+    }
+
+    void addMarker (TextKeyword keyword)
+    {
+      this->markers.emplace_back (keyword, this->numLines, this->vertices.size (),
+                                  this->indices.size ());
+    }
+
+    bool parseLine (TextLine& line)
+    {
+      const char* keyword;
+      std::size_t length;
+
+      const auto is = [&keyword, &length](const char* k) {
+        return std::strlen (k) == length && std::strncmp (keyword, k, length) == 0;
+      };
+
+      if (line.readKeyword (keyword, length) == false)
+      {
+        return true;
+      }
+      else if (is ("v"))
+      {
+        glm::vec3 vertex;
+        if (line.read (vertex) == false)
+        {
+          return this->fail ("could not parse vertex");
+        }
+        this->vertices.push_back (vertex);
+      }
+      else if (is ("f"))
+      {
+        unsigned int v1, v2, v3, v4;
+
+        if (line.readFaceIndex (v1) == false || line.readFaceIndex (v2) == false ||
+            line.readFaceIndex (v3) == false)
+        {
+          return this->fail ("could not parse face");
+        }
+        this->indices.insert (this->indices.end (), {v1 - 1, v2 - 1, v3 - 1});
+
+        line.skipSpace ();
+        if (line.position < line.end)
+        {
+          if (line.readFaceIndex (v4) == false)
+          {
+            return this->fail ("could not parse face");
+          }
+          this->indices.insert (this->indices.end (), {v4 - 1, v1 - 1, v3 - 1});
+        }
+      }
+      else if (is ("o"))
+      {
+        this->addMarker (TextKeyword::Object);
+      }
+      else if (is ("dly_sketch_mesh"))
+      {
+        this->addMarker (TextKeyword::SketchMesh);
+      }
+      else if (is ("dly_sketch_node"))
+      {
+        this->addMarker (TextKeyword::SketchNode);
+
+        TextMarker& m = this->markers.back ();
+        if (line.read (m.index1) == false || line.read (m.index2) == false ||
+            line.read (m.vector1) == false || line.read (m.radius) == false)
+        {
+          return this->fail ("could not parse sketch node");
+        }
+      }
+      else if (is ("dly_sketch_path"))
+      {
+        this->addMarker (TextKeyword::SketchPath);
+
+        TextMarker& m = this->markers.back ();
+        if (line.read (m.vector1) == false || line.read (m.vector2) == false)
+        {
+          return this->fail ("could not parse sketch path");
+        }
+      }
+      else if (is ("dly_sketch_sphere"))
+      {
+        this->addMarker (TextKeyword::SketchSphere);
+
+        TextMarker& m = this->markers.back ();
+        if (line.read (m.vector1) == false || line.read (m.radius) == false)
+        {
+          return this->fail ("could not parse sketch sphere");
+        }
+      }
+      return true;
+    }
+
+    void parse ()
+    {
+      const char* lineBegin = this->begin;
+
+      while (lineBegin < this->end)
+      {
+        const char* lineEnd = std::find (lineBegin, this->end, '\n');
+        TextLine    line (lineBegin, lineEnd);
+
+        this->numLines++;
+        if (this->parseLine (line) == false)
+        {
+          return;
+        }
+        lineBegin = lineEnd + 1;
+      }
+    }
+  };
+
+  // chunks end at line boundaries
+  std::vector<TextChunk> textChunks (const char* data, std::size_t size)
+  {
+    static constexpr std::size_t minChunkSize = 1 << 20;
+
+    const std::size_t numChunks =
+      glm::min (std::size_t (4 * Parallel::numThreads ()), (size / minChunkSize) + 1);
+    const std::size_t chunkSize = (size / numChunks) + 1;
+
+    std::vector<TextChunk> chunks;
+    const char*            begin = data;
+    const char*            end = data + size;
+
+    while (begin < end)
+    {
+      const char* chunkEnd = begin + glm::min (chunkSize, std::size_t (end - begin));
+
+      chunkEnd = std::find (chunkEnd, end, '\n');
+      chunkEnd = chunkEnd == end ? end : chunkEnd + 1;
+
+      chunks.emplace_back (begin, chunkEnd);
+      begin = chunkEnd;
+    }
+    return chunks;
+  }
+
+  // sketch markers are applied in order, vertices and faces are added to the current mesh
+  struct TextMerger
+  {
+    const Config&            config;
+    Scene&                   scene;
+    std::vector<Mesh>        meshes;
+    std::vector<SketchNode*> nodes;
+    SketchMesh*              sketch;
+    SketchPath*              sketchPath;
+    glm::vec3                intersectionFirst, intersectionLast;
+
+    TextMerger (const Config& c, Scene& s)
+      : config (c)
+      , scene (s)
+      , sketch (nullptr)
+      , sketchPath (nullptr)
+    {
+    }
+
+    Mesh& currentMesh ()
+    {
+      if (this->meshes.empty ())
+      {
+        this->meshes.emplace_back ();
+      }
+      return this->meshes.back ();
+    }
+
+    void addGeometry (const TextChunk& chunk, unsigned int& numVertices, unsigned int& numIndices,
+                      unsigned int newNumVertices, unsigned int newNumIndices)
+    {
+      if (newNumVertices > numVertices)
+      {
+        Mesh& mesh = this->currentMesh ();
+
+        mesh.reserveVertices (mesh.numVertices () + newNumVertices - numVertices);
+        for (unsigned int i = numVertices; i < newNumVertices; i++)
+        {
+          mesh.addVertex (chunk.vertices[i]);
+        }
+      }
+      if (newNumIndices > numIndices)
+      {
+        this->currentMesh ().addIndices (chunk.indices.data () + numIndices,
+                                         newNumIndices - numIndices);
+      }
+      numVertices = newNumVertices;
+      numIndices = newNumIndices;
+    }
+
+    bool apply (const TextMarker& m, unsigned int lineNumber)
+    {
+      switch (m.keyword)
+      {
+        case TextKeyword::Object:
+          this->meshes.emplace_back ();
+          return true;
+
+        case TextKeyword::SketchMesh:
+          this->nodes.clear ();
+          this->sketch = &this->scene.newSketchMesh (this->config, SketchTree ());
+          return true;
+
+        case TextKeyword::SketchNode:
+          if (this->sketch == nullptr)
+          {
+            DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
+            return false;
+          }
+          else if (m.index1 != this->nodes.size ())
+          {
+            DILAY_WARN ("invalid node index at line %u", lineNumber)
+            return false;
+          }
+          else if (m.index1 == 0)
+          {
+            this->nodes.push_back (
+              &this->sketch->tree ().emplaceRoot (PrimSphere (m.vector1, m.radius)));
+          }
+          else if (m.index2 < this->nodes.size ())
+          {
+            this->nodes.push_back (
+              &this->nodes[m.index2]->emplaceChild (PrimSphere (m.vector1, m.radius)));
+          }
+          else
+          {
+            DILAY_WARN ("invalid parent index at line %u", lineNumber)
+            return false;
+          }
+          return true;
+
+        case TextKeyword::SketchPath:
+          if (this->sketch == nullptr)
+          {
+            DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
+            return false;
+          }
+          this->intersectionFirst = m.vector1;
+          this->intersectionLast = m.vector2;
+          this->sketchPath = &this->sketch->addPath (SketchPath ());
+          return true;
+
+        case TextKeyword::SketchSphere:
+          if (this->sketchPath == nullptr)
+          {
+            DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u",
+                        lineNumber)
+            return false;
+          }
+          this->sketchPath->addSphere (this->sketchPath->isEmpty () ? this->intersectionFirst
+                                                                    : this->intersectionLast,
+                                       m.vector1, m.radius);
+          return true;
+      }
+      DILAY_IMPOSSIBLE
+    }
+
+    bool merge (const TextChunk& chunk, unsigned int firstLine)
+    {
+      unsigned int numVertices = 0;
+      unsigned int numIndices = 0;
+
+      for (const TextMarker& m : chunk.markers)
+      {
+        this->addGeometry (chunk, numVertices, numIndices, m.numVertices, m.numIndices);
+
+        if (this->apply (m, firstLine + m.lineNumber) == false)
+        {
+          return false;
+        }
+      }
+      this->addGeometry (chunk, numVertices, numIndices, chunk.vertices.size (),
+                         chunk.indices.size ());
+      return true;
+    }
+  };
+
+  /* Meshes that are deferred by the scene are checked for consistency when they are constructed in
+   * the background.  All other meshes are checked before any mesh is added.
+   */
+  // layouts are optional, otherwise there is one layout per mesh
+  bool addMeshes (std::vector<Mesh>& meshes, const Config& config, Scene& scene,
+                  const std::vector<DynamicMeshLayout>& layouts = {})
+  {
+    assert (layouts.empty () || layouts.size () == meshes.size ());
+
+    if (std::all_of (meshes.begin (), meshes.end (), [&scene](Mesh& m) {
+          return m.numVertices () == 0 || scene.defersMesh (m) || MeshUtil::checkConsistency (m);
+        }))
+    {
+      for (unsigned int i = 0; i < meshes.size (); i++)
+      {
+        Mesh& m = meshes[i];
+
+        if (m.numVertices () == 0)
+        {
+          continue;
+        }
+        else if (scene.defersMesh (m))
+        {
+          scene.newDeferredMesh (config, m);
+        }
+        else if (layouts.empty () == false && layouts[i].isEmpty () == false)
+        {
+          DynamicMesh mesh;
+
+          if (mesh.fromMesh (m, layouts[i]) == false)
+          {
+            DILAY_WARN ("ignoring layout of mesh that does not fit")
+          }
+          scene.newDynamicMesh (config, std::move (mesh)).reorder ();
+        }
+        else
+        {
+          scene.newDynamicMesh (config, m).reorder ();
+        }
+      }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  Sink streamSink (std::ostream& stream)
+  {
+    return [&stream](const char* data, std::size_t size) { stream.write (data, size); };
+  }
+
+  // the size of the chunk of a mesh, which is known before the mesh is pruned
+  uint64_t binaryChunkSize (const ImportExport::FrozenMesh& frozen)
+  {
+    const auto numUsed = [](const std::vector<bool>& free) {
+      return uint64_t (std::count (free.begin (), free.end (), false));
+    };
+    const uint64_t numVertices =
+      frozen.freeVertices.empty () ? frozen.mesh.numVertices () : numUsed (frozen.freeVertices);
+    const uint64_t numIndices =
+      frozen.freeFaces.empty () ? frozen.mesh.numIndices () : 3 * numUsed (frozen.freeFaces);
+
+    return 8 + (2 * sizeof (glm::vec3) * numVertices) + (sizeof (uint32_t) * numIndices);
+  }
+
+  std::string sketchMeshesChunk (const ImportExport::FrozenScene& scene)
+  {
+    std::string buffer;
+    const Sink  sink = stringSink (buffer);
+
+    for (const ImportExport::FrozenSketchMesh& mesh : scene.sketchMeshes)
+    {
+      toBinaryDlyFile (sink, mesh);
+    }
+    return buffer;
+  }
+
+  /* Chunks of meshes are formatted and compressed in parallel batches, which are passed to `f` in
+   * order.
+   */
+  void formatMeshChunks (const ImportExport::FrozenScene& scene,
+                         const ImportExport::Progress&    progress,
+                         const std::function<void(unsigned int, std::string&)>& f)
+  {
+    const unsigned int       batchSize = 4 * Parallel::numThreads ();
+    std::vector<std::string> buffers (batchSize);
+
+    for (unsigned int batch = 0; batch < scene.meshes.size (); batch += batchSize)
+    {
+      const unsigned int n = glm::min (batchSize, (unsigned int) (scene.meshes.size () - batch));
+
+      Parallel::forEach (n, [&scene, &buffers, batch](unsigned int i) {
+        buffers[i].clear ();
+        toBinaryDlyFile (stringSink (buffers[i]), prunedMesh (scene.meshes[batch + i]));
+
+        if (scene.compressMeshes)
+        {
+          buffers[i] = compressedMeshChunk (std::move (buffers[i]));
+        }
+      });
+
+      for (unsigned int i = 0; i < n; i++)
+      {
+        f (batch + i, buffers[i]);
+      }
+      reportProgress (progress, batch + n, scene.meshes.size ());
+    }
+  }
+
+  /* The offset of the index is known in advance, hence files are written in order: the header,
+   * the chunks and the index.  Hashes of chunks are computed while they are written.  Compressed
+   * chunks are kept in memory until their sizes are known.
+   */
+  void toBinaryDlyFile (const Sink& sink, const ImportExport::FrozenScene& scene,
+                        const ImportExport::Progress& progress)
+  {
+    assert (isLittleEndian ());
+
+    const std::string        sketchMeshes = sketchMeshesChunk (scene);
+    std::vector<std::string> compressed;
+    BinaryIndex              index;
+    uint64_t                 offset = binaryHeaderSize;
+
+    if (scene.compressMeshes)
+    {
+      compressed.resize (scene.meshes.size ());
+      formatMeshChunks (scene, progress, [&compressed](unsigned int i, std::string& buffer) {
+        compressed[i].swap (buffer);
+      });
+    }
+
+    for (unsigned int i = 0; i < scene.meshes.size (); i++)
+    {
+      if (scene.compressMeshes)
+      {
+        const std::string& buffer = compressed[i];
+        index.meshes.push_back (BinaryChunk{
+          offset, buffer.size (), hashBinary (binaryHashSeed, buffer.data (), buffer.size ())});
+      }
+      else
+      {
+        index.meshes.push_back (BinaryChunk{offset, binaryChunkSize (scene.meshes[i]), 0});
+      }
+      offset += index.meshes.back ().size;
+
+      const uint64_t layoutSize = binaryLayoutSize (scene.meshes[i].layout);
+
+      index.layouts.push_back (BinaryChunk{layoutSize > 0 ? offset : 0, layoutSize, 0});
+      offset += layoutSize;
+    }
+    index.sketchMeshes = BinaryChunk{
+      offset, sketchMeshes.size (),
+      hashBinary (binaryHashSeed, sketchMeshes.data (), sketchMeshes.size ())};
+    index.numSketchMeshes = uint32_t (scene.sketchMeshes.size ());
+    offset += sketchMeshes.size ();
+
+    sink (binaryMagic, sizeof (binaryMagic));
+    writeBinary (sink, uint32_t (binaryVersion));
+    writeBinary (sink, offset);
+    // previews are embedded later
+    writeBinary (sink, uint64_t (0));
+    writeBinary (sink, uint64_t (0));
+
+    // hashes the written data of a chunk
+    const auto chunkSink = [&sink](BinaryChunk& chunk, uint64_t& size) -> Sink {
+      chunk.hash = binaryHashSeed;
+      return [&sink, &chunk, &size](const char* data, std::size_t n) {
+        chunk.hash = hashBinary (chunk.hash, data, n);
+        size += n;
+        sink (data, n);
+      };
+    };
+
+    for (unsigned int i = 0; i < scene.meshes.size (); i++)
+    {
+      uint64_t size = 0;
+
+      if (scene.compressMeshes)
+      {
+        sink (compressed[i].data (), compressed[i].size ());
+      }
+      else
+      {
+        toBinaryDlyFile (chunkSink (index.meshes[i], size), prunedMesh (scene.meshes[i]));
+
+        assert (size == index.meshes[i].size);
+        reportProgress (progress, i + 1, scene.meshes.size ());
+      }
+
+      if (index.layouts[i].size > 0)
+      {
+        size = 0;
+        toBinaryDlyFile (chunkSink (index.layouts[i], size), index.meshes[i].hash,
+                         scene.meshes[i].layout);
+
+        assert (size == index.layouts[i].size);
+      }
+      (void) size;
+    }
+    sink (sketchMeshes.data (), sketchMeshes.size ());
+    writeBinary (sink, index);
+  }
+
+  /* Existing files of the current version are updated by appending the chunks of changed meshes
+   * and a new index.  The offset of the index in the header is overwritten last, hence an
+   * interrupted update leaves the previous index intact.  Chunks of unchanged meshes are
+   * identified by their size and hash.  Returns false if the file does not exist, is not of the
+   * current version, or if more than half of it would not be referenced anymore, in which case
+   * it must be rewritten.
+   */
+  bool updateBinaryDlyFile (const QString& fileName, const ImportExport::FrozenScene& scene,
+                            const ImportExport::Progress& progress)
+  {
+    assert (isLittleEndian ());
+
+    QFile       file (fileName);
+    BinaryIndex oldIndex;
+
+    if (file.exists () == false || file.open (QIODevice::ReadWrite) == false ||
+        file.size () < qint64 (binaryHeaderSize))
+    {
+      return false;
+    }
+    else
+    {
+      unsigned char* data = file.map (0, file.size ());
+
+      if (data == nullptr)
+      {
+        return false;
+      }
+      BinaryReader reader (data, std::size_t (file.size ()));
+      const bool   isValid = readBinaryIndex (reader, oldIndex);
+
+      file.unmap (data);
+      if (isValid == false || oldIndex.version != binaryVersion)
+      {
+        return false;
+      }
+    }
+
+    std::unordered_map<uint64_t, BinaryChunk> oldChunks;
+    for (const BinaryChunk& chunk : oldIndex.meshes)
+    {
+      oldChunks.emplace (chunk.hash, chunk);
+    }
+    for (const BinaryChunk& chunk : oldIndex.layouts)
+    {
+      if (chunk.size > 0)
+      {
+        oldChunks.emplace (chunk.hash, chunk);
+      }
+    }
+    oldChunks.emplace (oldIndex.sketchMeshes.hash, oldIndex.sketchMeshes);
+
+    const uint64_t           oldSize = uint64_t (file.size ());
+    std::vector<std::string> buffers;
+    BinaryIndex              index;
+    uint64_t                 offset = oldSize;
+    uint64_t                 usedSize = 0;
+
+    // appends a chunk if it has not been stored in the file yet
+    const auto addChunk = [&oldChunks, &offset, &usedSize](std::string& buffer) {
+      const uint64_t hash = hashBinary (binaryHashSeed, buffer.data (), buffer.size ());
+      const auto     it = oldChunks.find (hash);
+
+      if (it != oldChunks.end () && it->second.size == buffer.size ())
+      {
+        buffer = std::string ();
+        return it->second;
+      }
+      const BinaryChunk chunk{offset, buffer.size (), hash};
+
+      offset += chunk.size;
+      usedSize += chunk.size;
+      oldChunks.emplace (hash, chunk);
+      return chunk;
+    };
+
+    // buffers are written in the order of their chunks
+    const auto addBuffer = [&buffers, &addChunk](std::string& buffer) {
+      const BinaryChunk chunk = addChunk (buffer);
+
+      buffers.emplace_back ();
+      buffers.back ().swap (buffer);
+      return chunk;
+    };
+
+    formatMeshChunks (scene, progress,
+                      [&scene, &index, &addBuffer](unsigned int i, std::string& buffer) {
+                        std::string layout;
+
+                        index.meshes.push_back (addBuffer (buffer));
+
+                        if (scene.meshes[i].layout.isEmpty ())
+                        {
+                          index.layouts.push_back (BinaryChunk{0, 0, 0});
+                        }
+                        else
+                        {
+                          toBinaryDlyFile (stringSink (layout), index.meshes.back ().hash,
+                                           scene.meshes[i].layout);
+                          index.layouts.push_back (addBuffer (layout));
+                        }
+                      });
+    std::string sketchMeshes = sketchMeshesChunk (scene);
+    index.sketchMeshes = addBuffer (sketchMeshes);
+    index.numSketchMeshes = uint32_t (scene.sketchMeshes.size ());
+
+    if (index.meshes == oldIndex.meshes && index.layouts == oldIndex.layouts &&
+        index.sketchMeshes == oldIndex.sketchMeshes &&
+        index.numSketchMeshes == oldIndex.numSketchMeshes)
+    {
+      return true;
+    }
+
+    std::vector<BinaryChunk> chunks (index.meshes);
+    chunks.insert (chunks.end (), index.layouts.begin (), index.layouts.end ());
+
+    for (unsigned int i = 0; i < chunks.size (); i++)
+    {
+      if (chunks[i].offset < oldSize)
+      {
+        const auto isSame = [&chunks, i](const BinaryChunk& c) { return c == chunks[i]; };
+
+        if (std::none_of (chunks.begin (), chunks.begin () + i, isSame))
+        {
+          usedSize += chunks[i].size;
+        }
+      }
+    }
+    if (index.sketchMeshes.offset < oldSize)
+    {
+      usedSize += index.sketchMeshes.size;
+    }
+    if (offset - binaryHeaderSize > 2 * usedSize)
+    {
+      return false;
+    }
+
+    const Sink sink = [&file](const char* data, std::size_t size) { file.write (data, size); };
+
+    if (file.seek (qint64 (oldSize)) == false)
+    {
+      return false;
+    }
+    for (const std::string& buffer : buffers)
+    {
+      sink (buffer.data (), buffer.size ());
+    }
+    writeBinary (sink, index);
+
+    if (file.flush () == false || file.error () != QFileDevice::NoError ||
+        file.seek (qint64 (sizeof (binaryMagic) + sizeof (uint32_t))) == false)
+    {
+      return false;
+    }
+    writeBinary (sink, offset);
+    return file.flush () && file.error () == QFileDevice::NoError;
+  }
+
+  /* Binary STL and PLY files store the meshes of a scene as a single mesh.  STL files start with
+   * an 80 byte header and the number of triangles, each of which stores its normal, its three
+   * vertices and a 16 bit attribute.  PLY files start with a textual header that declares the
+   * properties of their elements.  Vertices are read from their `x`, `y` and `z` properties, faces
+   * from their `vertex_indices` list, and polygons are triangulated as fans.  Both formats are
+   * read from the mapped file and only little-endian files are supported.  ASCII STL files can be
+   * imported as well, but are never written.
+   */
+  static constexpr std::size_t stlHeaderSize = 84;
+  static constexpr std::size_t stlTriangleSize = 50;
+  static constexpr unsigned int meshFileBlockSize = 1 << 16;
+
+  bool isStlFile (const unsigned char* data, std::size_t size)
+  {
+    uint32_t numTriangles;
+
+    if (size < stlHeaderSize)
+    {
+      return false;
+    }
+    std::memcpy (&numTriangles, data + 80, sizeof (uint32_t));
+    return uint64_t (size) == stlHeaderSize + (stlTriangleSize * uint64_t (numTriangles));
+  }
+
+  bool isPlyFile (const unsigned char* data, std::size_t size)
+  {
+    return size >= 4 && std::memcmp (data, "ply", 3) == 0 && (data[3] == '\n' || data[3] == '\r');
+  }
+
+  /* Vertices and faces of imported meshes are cleaned before the meshes are constructed (cf.
+   * `MeshUtil::clean`), and changes are logged.  Returns false if a vertex is not finite or if an
+   * index is out of range.
+   */
+  bool addCleanedMesh (std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices,
+                       float weldDistance, Mesh& mesh)
+  {
+    assert (indices.size () % 3 == 0);
+
+    const std::size_t numVertices = vertices.size ();
+    std::atomic<bool> isFinite (true);
+
+    Parallel::forRange (vertices.size (), meshFileBlockSize,
+                        [&vertices, &isFinite](unsigned int begin, unsigned int end) {
+                          for (unsigned int i = begin; i < end; i++)
+                          {
+                            if (std::isfinite (vertices[i].x) == false ||
+                                std::isfinite (vertices[i].y) == false ||
+                                std::isfinite (vertices[i].z) == false)
+                            {
+                              isFinite = false;
+                            }
+                          }
+                        });
+    if (isFinite == false ||
+        std::any_of (indices.begin (), indices.end (),
+                     [numVertices](unsigned int i) { return i >= numVertices; }))
+    {
+      return false;
+    }
+
+    const MeshUtil::CleanResult result = MeshUtil::clean (vertices, indices, weldDistance);
+
+    if (result.numWeldedVertices > 0 || result.numDegeneratedFaces > 0 ||
+        result.numDuplicateFaces > 0 || result.numUnusedVertices > 0 ||
+        result.numSplitVertices > 0)
+    {
+      DILAY_INFO ("cleaned imported mesh: %u welded vertices, %u degenerated faces, "
+                  "%u duplicate faces, %u unused vertices, %u split vertices",
+                  result.numWeldedVertices, result.numDegeneratedFaces, result.numDuplicateFaces,
+                  result.numUnusedVertices, result.numSplitVertices)
+    }
+
+    mesh.reserveVertices ((unsigned int) vertices.size ());
+    for (const glm::vec3& v : vertices)
+    {
+      mesh.addVertex (v);
+    }
+    mesh.addIndices (indices.data (), (unsigned int) indices.size ());
+    return true;
+  }
+
+  // meshes of text files are cleaned like meshes of binary mesh files
+  bool cleanMeshes (std::vector<Mesh>& meshes, const Config& config)
+  {
+    const float weldDistance = config.get<float> ("editor/import/weld-distance");
+
+    for (Mesh& mesh : meshes)
+    {
+      if (mesh.numVertices () > 0)
+      {
+        std::vector<glm::vec3>    vertices (mesh.numVertices ());
+        std::vector<unsigned int> indices (mesh.numIndices ());
+        Mesh                      cleaned;
+
+        for (unsigned int i = 0; i < mesh.numVertices (); i++)
+        {
+          vertices[i] = mesh.vertex (i);
+        }
+        for (unsigned int i = 0; i < mesh.numIndices (); i++)
+        {
+          indices[i] = mesh.index (i);
+        }
+        if (indices.size () % 3 != 0 ||
+            addCleanedMesh (vertices, indices, weldDistance, cleaned) == false)
+        {
+          DILAY_WARN ("could not clean mesh with invalid vertices or faces")
+          return false;
+        }
+        cleaned.copyNonGeometry (mesh);
+        mesh = std::move (cleaned);
+      }
+    }
+    return true;
+  }
+
+  bool fromStlFile (const unsigned char* data, std::size_t size, float weldDistance,
+                    Mesh& mesh)
+  {
+    assert (isStlFile (data, size));
+    (void) size;
+
+    uint32_t numTriangles;
+    std::memcpy (&numTriangles, data + 80, sizeof (uint32_t));
+
+    if (uint64_t (numTriangles) * 3 > uint64_t (std::numeric_limits<unsigned int>::max ()))
+    {
+      return false;
+    }
+
+    std::vector<glm::vec3>    vertices (3 * std::size_t (numTriangles));
+    std::vector<unsigned int> indices (3 * std::size_t (numTriangles));
+
+    Parallel::forRange (numTriangles, meshFileBlockSize,
+                        [data, &vertices, &indices](unsigned int begin, unsigned int end) {
+                          for (unsigned int i = 3 * begin; i < 3 * end; i++)
+                          {
+                            const unsigned char* triangle =
+                              data + stlHeaderSize + (stlTriangleSize * std::size_t (i / 3));
+
+                            std::memcpy (&vertices[i],
+                                         triangle + (sizeof (glm::vec3) * (1 + (i % 3))),
+                                         sizeof (glm::vec3));
+                            indices[i] = i;
+                          }
+                        });
+    return addCleanedMesh (vertices, indices, weldDistance, mesh);
+  }
+
+  // ASCII STL files start with `solid`, whereas binary files are recognized by their size
+  bool isAsciiStlFile (const unsigned char* data, std::size_t size)
+  {
+    return size >= 5 && std::memcmp (data, "solid", 5) == 0 && isStlFile (data, size) == false;
+  }
+
+  /* Only the `vertex` lines of ASCII STL files are read, i.e., facets must be triangles, and
+   * files without `endsolid` are considered to be truncated.
+   */
+  bool fromAsciiStlFile (const unsigned char* data, std::size_t size, float weldDistance,
+                         Mesh& mesh)
+  {
+    const char*               end = reinterpret_cast<const char*> (data) + size;
+    std::vector<glm::vec3>    vertices;
+    std::vector<unsigned int> indices;
+    bool                      isComplete = false;
+
+    for (const char* lineBegin = reinterpret_cast<const char*> (data); lineBegin < end;)
+    {
+      const char* lineEnd = std::find (lineBegin, end, '\n');
+      TextLine    line (lineBegin, lineEnd);
+      const char* keyword;
+      std::size_t length;
+
+      const auto is = [&keyword, &length](const char* k) {
+        return std::strlen (k) == length && std::strncmp (keyword, k, length) == 0;
+      };
+
+      if (line.readKeyword (keyword, length) && is ("vertex"))
+      {
+        glm::vec3 vertex;
+        if (line.read (vertex) == false || vertices.size () == std::size_t (Util::invalidIndex ()))
+        {
+          return false;
+        }
+        indices.push_back ((unsigned int) vertices.size ());
+        vertices.push_back (vertex);
+      }
+      else if (is ("endsolid"))
+      {
+        isComplete = true;
+      }
+      lineBegin = lineEnd + 1;
+    }
+    return isComplete && vertices.size () % 3 == 0 &&
+           addCleanedMesh (vertices, indices, weldDistance, mesh);
+  }
+
+  enum class PlyType
+  {
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+  };
+
+  struct PlyProperty
+  {
+    std::string name;
+    bool        isList;
+    PlyType     countType;
+    PlyType     type;
+  };
+
+  struct PlyElement
+  {
+    std::string              name;
+    uint64_t                 count;
+    std::vector<PlyProperty> properties;
+  };
+
+  bool plyType (const std::string& name, PlyType& type)
+  {
+    static const std::unordered_map<std::string, PlyType> types = {
+      {"char", PlyType::Int8},     {"int8", PlyType::Int8},       {"uchar", PlyType::UInt8},
+      {"uint8", PlyType::UInt8},   {"short", PlyType::Int16},     {"int16", PlyType::Int16},
+      {"ushort", PlyType::UInt16}, {"uint16", PlyType::UInt16},   {"int", PlyType::Int32},
+      {"int32", PlyType::Int32},   {"uint", PlyType::UInt32},     {"uint32", PlyType::UInt32},
+      {"float", PlyType::Float32}, {"float32", PlyType::Float32}, {"double", PlyType::Float64},
+      {"float64", PlyType::Float64}};
+    const auto it = types.find (name);
+
+    if (it == types.end ())
+    {
+      return false;
+    }
+    type = it->second;
+    return true;
+  }
+
+  std::size_t plySize (PlyType type)
+  {
+    switch (type)
+    {
+      case PlyType::Int8:
+      case PlyType::UInt8:
+        return 1;
+      case PlyType::Int16:
+      case PlyType::UInt16:
+        return 2;
+      case PlyType::Int32:
+      case PlyType::UInt32:
+      case PlyType::Float32:
+        return 4;
+      case PlyType::Float64:
+        return 8;
+    }
+    DILAY_IMPOSSIBLE
+  }
+
+  template <typename T> T readPlyValue (const unsigned char* data)
+  {
+    T value;
+    std::memcpy (&value, data, sizeof (T));
+    return value;
+  }
+
+  double readPlyValue (const unsigned char* data, PlyType type)
+  {
+    switch (type)
+    {
+      case PlyType::Int8:
+        return double(readPlyValue<int8_t> (data));
+      case PlyType::UInt8:
+        return double(readPlyValue<uint8_t> (data));
+      case PlyType::Int16:
+        return double(readPlyValue<int16_t> (data));
+      case PlyType::UInt16:
+        return double(readPlyValue<uint16_t> (data));
+      case PlyType::Int32:
+        return double(readPlyValue<int32_t> (data));
+      case PlyType::UInt32:
+        return double(readPlyValue<uint32_t> (data));
+      case PlyType::Float32:
+        return double(readPlyValue<float> (data));
+      case PlyType::Float64:
+        return readPlyValue<double> (data);
+    }
+    DILAY_IMPOSSIBLE
+  }
+
+  // returns the size of the header, or 0 if the header is invalid
+  std::size_t readPlyHeader (const unsigned char* data, std::size_t size,
+                             std::vector<PlyElement>& elements)
+  {
+    const char* begin = reinterpret_cast<const char*> (data);
+    const char* end = begin + size;
+    bool        isBinary = false;
+
+    while (begin < end)
+    {
+      const char* lineEnd = std::find (begin, end, '\n');
+      std::string line (begin, lineEnd);
+
+      if (line.empty () == false && line.back () == '\r')
+      {
+        line.pop_back ();
+      }
+      begin = lineEnd == end ? end : lineEnd + 1;
+
+      std::istringstream stream (line);
+      std::string        keyword;
+
+      stream >> keyword;
+      if (keyword == "format")
+      {
+        std::string format;
+        stream >> format;
+        isBinary = format == "binary_little_endian";
+
+        if (isBinary == false)
+        {
+          DILAY_WARN ("unsupported PLY format %s", format.c_str ())
+          return 0;
+        }
+      }
+      else if (keyword == "element")
+      {
+        elements.emplace_back ();
+        if ((stream >> elements.back ().name >> elements.back ().count).fail ())
+        {
+          return 0;
+        }
+      }
+      else if (keyword == "property")
+      {
+        PlyProperty property;
+        std::string type;
+
+        stream >> type;
+        property.isList = type == "list";
+        if (property.isList)
+        {
+          stream >> type;
+          if (plyType (type, property.countType) == false)
+          {
+            return 0;
+          }
+          stream >> type;
+        }
+        if (elements.empty () || plyType (type, property.type) == false ||
+            (stream >> property.name).fail ())
+        {
+          return 0;
+        }
+        elements.back ().properties.push_back (property);
+      }
+      else if (keyword == "end_header")
+      {
+        return isBinary ? std::size_t (begin - reinterpret_cast<const char*> (data)) : 0;
+      }
+    }
+    return 0;
+  }
+
+  // returns the size of a record with lists, or 0 if the record exceeds the file
+  std::size_t plyRecordSize (const PlyElement& element, const unsigned char* data,
+                             const unsigned char* end)
+  {
+    std::size_t size = 0;
+
+    for (const PlyProperty& property : element.properties)
+    {
+      if (property.isList)
+      {
+        if (std::size_t (end - data) < size + plySize (property.countType))
+        {
+          return 0;
+        }
+        const double count = readPlyValue (data + size, property.countType);
+
+        if (count < 0.0)
+        {
+          return 0;
+        }
+        size += plySize (property.countType) + (std::size_t (count) * plySize (property.type));
+      }
+      else
+      {
+        size += plySize (property.type);
+      }
+    }
+    return std::size_t (end - data) < size ? 0 : size;
+  }
+
+  bool fromPlyFile (const unsigned char* data, std::size_t size, float weldDistance,
+                    Mesh& mesh)
+  {
+    std::vector<PlyElement>   elements;
+    std::vector<glm::vec3>    vertices;
+    std::vector<unsigned int> indices;
+    const unsigned char*      end = data + size;
+    const std::size_t         headerSize = readPlyHeader (data, size, elements);
+
+    if (headerSize == 0)
+    {
+      return false;
+    }
+    data += headerSize;
+
+    for (const PlyElement& element : elements)
+    {
+      const bool hasLists = std::any_of (element.properties.begin (), element.properties.end (),
+                                         [](const PlyProperty& p) { return p.isList; });
+
+      if (element.name == "vertex" && hasLists == false)
+      {
+        std::size_t  stride = 0;
+        std::size_t  offsets[3] = {0, 0, 0};
+        PlyType      types[3] = {PlyType::Float32, PlyType::Float32, PlyType::Float32};
+        unsigned int found = 0;
+
+        for (const PlyProperty& property : element.properties)
+        {
+          for (unsigned int i = 0; i < 3; i++)
+          {
+            if (property.name == std::string (1, char ('x' + i)))
+            {
+              offsets[i] = stride;
+              types[i] = property.type;
+              found |= 1u << i;
+            }
+          }
+          stride += plySize (property.type);
+        }
+        if (found != 7 || element.count > std::numeric_limits<unsigned int>::max () ||
+            uint64_t (end - data) < stride * element.count)
+        {
+          return false;
+        }
+        vertices.resize (std::size_t (element.count));
+
+        Parallel::forRange (
+          (unsigned int) element.count, meshFileBlockSize,
+          [data, stride, &offsets, &types, &vertices](unsigned int b, unsigned int e) {
+            for (unsigned int i = b; i < e; i++)
+            {
+              const unsigned char* record = data + (stride * i);
+
+              for (unsigned int j = 0; j < 3; j++)
+              {
+                vertices[i][j] = float(readPlyValue (record + offsets[j], types[j]));
+              }
+            }
+          });
+        data += stride * element.count;
+      }
+      else if (element.name == "face")
+      {
+        for (uint64_t i = 0; i < element.count; i++)
+        {
+          const std::size_t recordSize = plyRecordSize (element, data, end);
+
+          if (recordSize == 0)
+          {
+            return false;
+          }
+          for (const PlyProperty& property : element.properties)
+          {
+            const std::size_t countSize = property.isList ? plySize (property.countType) : 0;
+            const std::size_t n =
+              property.isList ? std::size_t (readPlyValue (data, property.countType)) : 1;
+
+            if (property.isList &&
+                (property.name == "vertex_indices" || property.name == "vertex_index"))
+            {
+              const unsigned char* values = data + countSize;
+              const auto           index = [values, &property](std::size_t k) {
+                return (unsigned int) readPlyValue (values + (k * plySize (property.type)),
+                                                    property.type);
+              };
+              for (std::size_t k = 2; k < n; k++)
+              {
+                indices.push_back (index (0));
+                indices.push_back (index (k - 1));
+                indices.push_back (index (k));
+              }
+            }
+            data += countSize + (n * plySize (property.type));
+          }
+          if (indices.size () > std::numeric_limits<unsigned int>::max ())
+          {
+            return false;
+          }
+        }
+      }
+      else
+      {
+        for (uint64_t i = 0; i < element.count; i++)
+        {
+          const std::size_t recordSize = plyRecordSize (element, data, end);
+
+          if (recordSize == 0)
+          {
+            return false;
+          }
+          data += recordSize;
+        }
+      }
+    }
+    return addCleanedMesh (vertices, indices, weldDistance, mesh);
+  }
+
+  // the normal of a triangle is zero if the triangle is degenerated
+  glm::vec3 triangleNormal (const Mesh& mesh, unsigned int triangle)
+  {
+    const glm::vec3& v1 = mesh.vertex (mesh.index ((3 * triangle) + 0));
+    const glm::vec3& v2 = mesh.vertex (mesh.index ((3 * triangle) + 1));
+    const glm::vec3& v3 = mesh.vertex (mesh.index ((3 * triangle) + 2));
+    const glm::vec3  n = glm::cross (v2 - v1, v3 - v1);
+    const float      length = glm::length (n);
+
+    return length > 0.0f ? n / length : glm::vec3 (0.0f);
+  }
+
+  /* Records of large meshes are formatted in parallel into blocks, which are passed to the sink
+   * in order.
+   */
+  void formatMeshFileRecords (const Sink& sink, unsigned int numRecords, std::size_t recordSize,
+                              const std::function<void(unsigned int, char*)>& format)
+  {
+    std::string buffer;
+
+    for (unsigned int block = 0; block < numRecords; block += 16 * meshFileBlockSize)
+    {
+      const unsigned int n = std::min (numRecords - block, 16 * meshFileBlockSize);
+
+      buffer.resize (n * recordSize);
+      Parallel::forRange (n, meshFileBlockSize,
+                          [block, recordSize, &buffer, &format](unsigned int b, unsigned int e) {
+                            for (unsigned int i = b; i < e; i++)
+                            {
+                              format (block + i, &buffer[i * recordSize]);
+                            }
+                          });
+      sink (buffer.data (), buffer.size ());
+    }
+  }
+
+  std::vector<Mesh> prunedMeshes (const ImportExport::FrozenScene& scene)
+  {
+    std::vector<Mesh> meshes;
+
+    for (const ImportExport::FrozenMesh& mesh : scene.meshes)
+    {
+      meshes.push_back (prunedMesh (mesh));
+    }
+    return meshes;
+  }
+
+  void toStlFile (const Sink& sink, const ImportExport::FrozenScene& scene,
+                  const ImportExport::Progress& progress)
+  {
+    assert (isLittleEndian ());
+
+    const std::vector<Mesh> meshes = prunedMeshes (scene);
+    uint32_t                numTriangles = 0;
+    char                    header[80] = "Dilay";
+
+    for (const Mesh& mesh : meshes)
+    {
+      numTriangles += mesh.numIndices () / 3;
+    }
+    sink (header, sizeof (header));
+    writeBinary (sink, numTriangles);
+
+    for (unsigned int m = 0; m < meshes.size (); m++)
+    {
+      const Mesh& mesh = meshes[m];
+
+      formatMeshFileRecords (sink, mesh.numIndices () / 3, stlTriangleSize,
+                             [&mesh](unsigned int i, char* record) {
+                               const glm::vec3 normal = triangleNormal (mesh, i);
+                               const uint16_t  attribute = 0;
+
+                               std::memcpy (record, &normal, sizeof (glm::vec3));
+                               for (unsigned int j = 0; j < 3; j++)
+                               {
+                                 std::memcpy (record + (sizeof (glm::vec3) * (j + 1)),
+                                              &mesh.vertex (mesh.index ((3 * i) + j)),
+                                              sizeof (glm::vec3));
+                               }
+                               std::memcpy (record + (4 * sizeof (glm::vec3)), &attribute,
+                                            sizeof (uint16_t));
+                             });
+      reportProgress (progress, m + 1, meshes.size ());
+    }
+  }
+
+  void toPlyFile (const Sink& sink, const ImportExport::FrozenScene& scene,
+                  const ImportExport::Progress& progress)
   {
-    os << v.x << " " << v.y << " " << v.z;
-    return os;
+    assert (isLittleEndian ());
+
+    const std::vector<Mesh> meshes = prunedMeshes (scene);
+    unsigned int            numVertices = 0;
+    unsigned int            numFaces = 0;
+    std::string             header;
+
+    for (const Mesh& mesh : meshes)
+    {
+      numVertices += mesh.numVertices ();
+      numFaces += mesh.numIndices () / 3;
+    }
+    header.append ("ply\nformat binary_little_endian 1.0\ncomment Dilay\nelement vertex ");
+    appendUnsigned (header, numVertices);
+    header.append ("\nproperty float x\nproperty float y\nproperty float z\n"
+                   "property float nx\nproperty float ny\nproperty float nz\nelement face ");
+    appendUnsigned (header, numFaces);
+    header.append ("\nproperty list uchar uint vertex_indices\nend_header\n");
+    sink (header.data (), header.size ());
+
+    for (const Mesh& mesh : meshes)
+    {
+      formatMeshFileRecords (sink, mesh.numVertices (), 2 * sizeof (glm::vec3),
+                             [&mesh](unsigned int i, char* record) {
+                               std::memcpy (record, &mesh.vertex (i), sizeof (glm::vec3));
+                               std::memcpy (record + sizeof (glm::vec3), &mesh.normal (i),
+                                            sizeof (glm::vec3));
+                             });
+    }
+
+    unsigned int offset = 0;
+    for (unsigned int m = 0; m < meshes.size (); m++)
+    {
+      const Mesh& mesh = meshes[m];
+
+      formatMeshFileRecords (sink, mesh.numIndices () / 3, 1 + (3 * sizeof (uint32_t)),
+                             [&mesh, offset](unsigned int i, char* record) {
+                               record[0] = 3;
+                               for (unsigned int j = 0; j < 3; j++)
+                               {
+                                 const uint32_t index = offset + mesh.index ((3 * i) + j);
+                                 std::memcpy (record + 1 + (sizeof (uint32_t) * j), &index,
+                                              sizeof (uint32_t));
+                               }
+                             });
+      offset += mesh.numVertices ();
+      reportProgress (progress, m + 1, meshes.size ());
+    }
+  }
+};
+
+namespace ImportExport
+{
+  FrozenMesh freeze (const DynamicMesh& mesh)
+  {
+    FrozenMesh frozen{mesh.mesh (), {}, {}};
+
+    // compact meshes are pruned
+    if (mesh.isCompact ())
+    {
+      frozen.mesh.expand ();
+    }
+    else if (mesh.numVertices () != mesh.vertexCapacity () ||
+             mesh.numFaces () != mesh.faceCapacity ())
+    {
+      frozen.freeVertices.resize (mesh.vertexCapacity ());
+      frozen.freeFaces.resize (mesh.faceCapacity ());
+
+      for (unsigned int i = 0; i < mesh.vertexCapacity (); i++)
+      {
+        frozen.freeVertices[i] = mesh.isFreeVertex (i);
+      }
+      for (unsigned int i = 0; i < mesh.faceCapacity (); i++)
+      {
+        frozen.freeFaces[i] = mesh.isFreeFace (i);
+      }
+    }
+    return frozen;
+  }
+
+  FrozenScene freeze (const Scene& scene)
+  {
+    FrozenScene frozen;
+
+    frozen.compressMeshes = scene.compressFiles ();
+    frozen.meshes.reserve (scene.numDynamicMeshes () + scene.numLinkedMeshes ());
+
+    scene.forEachConstMesh ([&scene, &frozen](const DynamicMesh& mesh) {
+      frozen.meshes.push_back (freeze (mesh));
+
+      if (scene.storeMeshLayouts ())
+      {
+        frozen.meshes.back ().layout = mesh.layout ();
+      }
+    });
+
+    // linked meshes are exported as unique meshes
+    scene.forEachConstLinkedMesh ([&frozen](const DynamicMesh& mesh, const glm::mat4x4& model) {
+      frozen.meshes.push_back (freeze (mesh));
+      MeshUtil::transform (frozen.meshes.back ().mesh, model);
+    });
+
+    scene.forEachConstMesh ([&frozen](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        frozen.sketchMeshes.push_back (FrozenSketchMesh{mesh.tree (), mesh.paths ()});
+      }
+    });
+    return frozen;
+  }
+
+  void toDlyFile (std::ostream& stream, const FrozenScene& scene, bool isObjFile,
+                  const Progress& progress)
+  {
+    ::toDlyFile (streamSink (stream), scene, isObjFile, progress);
+  }
+
+  void toBinaryDlyFile (std::ostream& stream, const FrozenScene& scene, const Progress& progress)
+  {
+    ::toBinaryDlyFile (streamSink (stream), scene, progress);
+  }
+
+  /* Binary files are updated in place if only some of their meshes changed.  Otherwise files are
+   * replaced atomically when the output is complete.
+   */
+  bool toDlyFile (const std::string& fileName, const FrozenScene& scene, bool isObjFile,
+                  const Progress& progress)
+  {
+    const QString name = QString::fromStdString (fileName);
+    const bool    isMesh = isMeshFile (fileName);
+
+    if (isMesh && isLittleEndian () == false)
+    {
+      DILAY_WARN ("mesh files are not supported on big-endian machines")
+      return false;
+    }
+    else if (isObjFile == false && isMesh == false && isLittleEndian () &&
+             updateBinaryDlyFile (name, scene, progress))
+    {
+      return true;
+    }
+
+    QSaveFile file (name);
+
+    if (file.open (QIODevice::WriteOnly))
+    {
+      const Sink sink = [&file](const char* data, std::size_t size) { file.write (data, size); };
+
+      if (isMesh && name.endsWith (".stl", Qt::CaseInsensitive))
+      {
+        ::toStlFile (sink, scene, progress);
+      }
+      else if (isMesh)
+      {
+        ::toPlyFile (sink, scene, progress);
+      }
+      else if (isObjFile == false && isLittleEndian ())
+      {
+        ::toBinaryDlyFile (sink, scene, progress);
+      }
+      else
+      {
+        ::toDlyFile (sink, scene, isObjFile, progress);
+      }
+      return file.commit ();
+    }
+    else
+    {
+      return false;
+    }
   }
 
-  std::istream& operator>> (std::istream& is, glm::vec3& v)
+  void toDlyFile (std::ostream& stream, const Scene& scene, bool isObjFile)
   {
-    is >> v.x >> v.y >> v.z;
-    return is;
+    toDlyFile (stream, freeze (scene), isObjFile);
   }
 
-  void toDlyFile (std::ostream& stream, const Mesh& mesh)
+  void toBinaryDlyFile (std::ostream& stream, const Scene& scene)
   {
-    stream << "o\n";
-    for (unsigned int i = 0; i < mesh.numVertices (); i++)
-    {
-      stream << "v " << mesh.vertex (i) << std::endl;
-    }
-    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
-    {
-      stream << "f " << mesh.index (i + 0) + 1 << " " << mesh.index (i + 1) + 1 << " "
-             << mesh.index (i + 2) + 1 << std::endl;
-    }
+    toBinaryDlyFile (stream, freeze (scene));
   }
 
-  unsigned int toDlyFile (std::ostream& stream, const SketchNode& node, unsigned int parentIndex,
-                          unsigned nodeIndex)
+  bool toDlyFile (const std::string& fileName, const Scene& scene, bool isObjFile)
   {
-    stream << "dly_sketch_node " << nodeIndex << " " << parentIndex << " " << node.data ().center ()
-           << " " << node.data ().radius () << std::endl;
+    return toDlyFile (fileName, freeze (scene), isObjFile);
+  }
 
-    unsigned int childIndex = nodeIndex;
+  bool fromDlyFile (std::istream& stream, const Config& config, Scene& scene)
+  {
+    const std::string data ((std::istreambuf_iterator<char> (stream)),
+                            std::istreambuf_iterator<char> ());
 
-    node.forEachConstChild ([&stream, nodeIndex, &childIndex](const SketchNode& child) {
-      childIndex = toDlyFile (stream, child, nodeIndex, childIndex + 1);
-    });
-    return childIndex;
+    return ImportExport::fromTextDlyFile (data.data (), data.size (), config, scene);
   }
 
-  void toDlyFile (std::ostream& stream, const SketchPath& path)
+  bool fromFrozenScene (const FrozenScene& frozen, const Config& config, Scene& scene)
   {
-    if (path.isEmpty () == false)
+    std::vector<Mesh> meshes;
+
+    meshes.reserve (frozen.meshes.size ());
+    for (const FrozenMesh& mesh : frozen.meshes)
+    {
+      meshes.push_back (prunedMesh (mesh));
+    }
+    if (addMeshes (meshes, config, scene) == false)
     {
-      stream << "dly_sketch_path"
-             << " " << path.intersectionFirst () << " " << path.intersectionLast () << std::endl;
+      return false;
+    }
+    for (const FrozenSketchMesh& mesh : frozen.sketchMeshes)
+    {
+      SketchMesh& sketch = scene.newSketchMesh (config, mesh.tree);
 
-      for (const PrimSphere& s : path.spheres ())
+      for (const SketchPath& path : mesh.paths)
       {
-        stream << "dly_sketch_sphere"
-               << " " << s.center () << " " << s.radius () << std::endl;
+        sketch.addPath (path);
       }
     }
+    return true;
   }
 
-  void toDlyFile (std::ostream& stream, const SketchMesh& mesh)
+  bool fromTextDlyFile (const char* data, std::size_t size, const Config& config, Scene& scene)
   {
-    if (mesh.isEmpty () == false)
-    {
-      stream << "dly_sketch_mesh\n";
+    std::vector<TextChunk> chunks = textChunks (data, size);
+
+    Parallel::forEach (chunks.size (), [&chunks](unsigned int i) { chunks[i].parse (); });
 
-      if (mesh.tree ().hasRoot ())
+    unsigned int firstLine = 0;
+    for (const TextChunk& chunk : chunks)
+    {
+      if (chunk.error)
       {
-        toDlyFile (stream, mesh.tree ().root (), Util::invalidIndex (), 0);
+        DILAY_WARN ("%s at line %u", chunk.error, firstLine + chunk.errorLine)
+        return false;
       }
+      firstLine += chunk.numLines;
+    }
+
+    TextMerger merger (config, scene);
 
-      for (const SketchPath& p : mesh.paths ())
+    firstLine = 0;
+    for (const TextChunk& chunk : chunks)
+    {
+      if (merger.merge (chunk, firstLine) == false)
       {
-        toDlyFile (stream, p);
+        return false;
       }
+      firstLine += chunk.numLines;
     }
-  }
-};
-
-namespace ImportExport
-{
-  void toDlyFile (std::ostream& stream, Scene& scene, bool isObjFile)
-  {
-    scene.forEachMesh ([&stream](DynamicMesh& mesh) {
-      mesh.prune ();
-      ::toDlyFile (stream, mesh.mesh ());
-    });
 
-    if (isObjFile == false)
+    if (config.get<bool> ("editor/import/clean") && cleanMeshes (merger.meshes, config) == false)
     {
-      scene.forEachConstMesh ([&stream](const SketchMesh& mesh) { ::toDlyFile (stream, mesh); });
+      return false;
     }
+    return addMeshes (merger.meshes, config, scene);
   }
 
-  bool toDlyFile (const std::string& fileName, Scene& scene, bool isObjFile)
+  bool fromBinaryDlyFile (const unsigned char* data, std::size_t size, const Config& config,
+                          Scene& scene)
   {
-    std::ofstream file (fileName);
+    assert (isBinaryDlyFile (data, size));
 
-    if (file.is_open ())
+    BinaryReader                   reader (data, size);
+    BinaryIndex                    index;
+    uint32_t                       version;
+    std::vector<Mesh>              meshes;
+    std::vector<DynamicMeshLayout> layouts;
+    std::list<SketchMesh>          sketchMeshes;
+
+    reader.readArray<char> (sizeof (binaryMagic));
+
+    if (isLittleEndian () == false)
     {
-      ImportExport::toDlyFile (file, scene, isObjFile);
-      file.close ();
-      return true;
+      DILAY_WARN ("binary files are not supported on big-endian machines")
+      return false;
     }
-    else
+    else if (reader.read (version) == false || version == 0 || version > binaryVersion)
     {
+      DILAY_WARN ("unsupported version of binary file")
       return false;
     }
-  }
-
-  bool fromDlyFile (std::istream& stream, const Config& config, Scene& scene)
-  {
-    unsigned int       lineNumber = 0;
-    std::istringstream lineStream;
+    else if (version == 1)
+    {
+      uint32_t numMeshes;
 
-    std::vector<Mesh>        meshes;
-    std::vector<SketchNode*> nodes;
-    SketchMesh*              sketch = nullptr;
-    SketchPath*              sketchPath = nullptr;
-    glm::vec3                intersectionFirst, intersectionLast;
+      if (reader.read (numMeshes) == false || reader.read (index.numSketchMeshes) == false ||
+          numMeshes > size || index.numSketchMeshes > size)
+      {
+        DILAY_WARN ("could not parse header of binary file")
+        return false;
+      }
+      meshes.resize (numMeshes);
+      for (Mesh& mesh : meshes)
+      {
+        if (::fromBinaryDlyFile (reader, mesh) == false)
+        {
+          DILAY_WARN ("could not parse mesh of binary file")
+          return false;
+        }
+      }
+    }
+    else if (readBinaryIndex (reader, index) == false)
+    {
+      DILAY_WARN ("could not parse index of binary file")
+      return false;
+    }
+    else
+    {
+      // chunks are located by the index, hence they are decoded in parallel
+      std::vector<char> isValid (index.meshes.size (), false);
+      std::vector<char> isValidLayout (index.meshes.size (), true);
 
-    auto extractFirst = [](const std::string& string, unsigned int& value) -> bool {
-      auto slashPos = string.find ('/');
-      return Util::fromString (string.substr (0, slashPos), value);
-    };
+      meshes.resize (index.meshes.size ());
+      layouts.resize (index.meshes.size ());
+      Parallel::forEach (meshes.size (), [&reader, &index, &meshes, &layouts, &isValid,
+                                          &isValidLayout](unsigned int i) {
+        BinaryReader chunkReader = reader.chunkReader (index.meshes[i]);
+        isValid[i] = ::fromBinaryDlyFile (chunkReader, meshes[i]);
 
-    auto nextLine = [&stream, &lineNumber, &lineStream]() -> bool {
-      std::string line;
-      std::getline (stream, line);
+        if (index.layouts[i].size > 0)
+        {
+          BinaryReader layoutReader = reader.chunkReader (index.layouts[i]);
+          isValidLayout[i] = ::fromBinaryDlyFile (layoutReader, index.layouts[i],
+                                                  index.meshes[i].hash, layouts[i]);
+          if (isValidLayout[i] == false)
+          {
+            layouts[i] = DynamicMeshLayout ();
+          }
+        }
+      });
 
-      if (stream)
+      if (std::find (isValid.begin (), isValid.end (), false) != isValid.end ())
       {
-        lineNumber++;
-        lineStream.clear ();
-        lineStream.str (line);
-        return true;
+        DILAY_WARN ("could not parse mesh of binary file")
+        return false;
       }
-      else
+      else if (std::find (isValidLayout.begin (), isValidLayout.end (), false) !=
+               isValidLayout.end ())
+      {
+        DILAY_WARN ("ignoring invalid mesh layouts of binary file")
+      }
+      reader = reader.chunkReader (index.sketchMeshes);
+    }
+
+    // the scene is only changed once the whole file has been parsed
+    for (uint32_t i = 0; i < index.numSketchMeshes; i++)
+    {
+      sketchMeshes.emplace_back ();
+
+      if (::fromBinaryDlyFile (reader, sketchMeshes.back ()) == false)
       {
+        DILAY_WARN ("could not parse sketch mesh of binary file")
         return false;
       }
-    };
+    }
+    if (addMeshes (meshes, config, scene, layouts) == false)
+    {
+      return false;
+    }
+    for (const SketchMesh& mesh : sketchMeshes)
+    {
+      scene.newSketchMesh (config, mesh);
+    }
+    return true;
+  }
+
+  bool isMeshFile (const std::string& fileName)
+  {
+    const QString name = QString::fromStdString (fileName);
+
+    return name.endsWith (".stl", Qt::CaseInsensitive) ||
+           name.endsWith (".ply", Qt::CaseInsensitive);
+  }
+
+  bool fromStlFile (const unsigned char* data, std::size_t size, const Config& config,
+                    Scene& scene)
+  {
+    const float       weldDistance = config.get<float> ("editor/import/weld-distance");
+    const bool        isBinary = isStlFile (data, size);
+    std::vector<Mesh> meshes (1);
+
+    if (isLittleEndian () == false)
+    {
+      DILAY_WARN ("mesh files are not supported on big-endian machines")
+      return false;
+    }
+    else if ((isBinary == false && isAsciiStlFile (data, size) == false) ||
+             (isBinary ? ::fromStlFile (data, size, weldDistance, meshes[0])
+                       : fromAsciiStlFile (data, size, weldDistance, meshes[0])) == false)
+    {
+      DILAY_WARN ("could not parse STL file")
+      return false;
+    }
+    return addMeshes (meshes, config, scene);
+  }
+
+  bool fromPlyFile (const unsigned char* data, std::size_t size, const Config& config,
+                    Scene& scene)
+  {
+    const float       weldDistance = config.get<float> ("editor/import/weld-distance");
+    std::vector<Mesh> meshes (1);
+
+    if (isLittleEndian () == false)
+    {
+      DILAY_WARN ("mesh files are not supported on big-endian machines")
+      return false;
+    }
+    else if (isPlyFile (data, size) == false ||
+             ::fromPlyFile (data, size, weldDistance, meshes[0]) == false)
+    {
+      DILAY_WARN ("could not parse PLY file")
+      return false;
+    }
+    return addMeshes (meshes, config, scene);
+  }
+
+  /* Files are mapped into memory, journals, binary files and PLY files are recognized by their
+   * magic number, and STL files by their suffix.
+   */
+  bool fromDlyFile (const std::string& fileName, const Config& config, Scene& scene)
+  {
+    QFile binaryFile (QString::fromStdString (fileName));
 
-    while (nextLine ())
+    if (binaryFile.open (QIODevice::ReadOnly) && binaryFile.size () > 0)
     {
-      std::string keyword;
-      lineStream >> keyword;
+      const std::size_t size = std::size_t (binaryFile.size ());
+      unsigned char*    data = binaryFile.map (0, binaryFile.size ());
 
-      if (lineStream.fail () == false)
+      if (data)
       {
-        if (keyword == "o")
+        bool success;
+
+        if (Journal::isJournal (data, size))
         {
-          meshes.push_back (Mesh ());
+          success = Journal::fromJournal (data, size, config, scene);
         }
-        else if (keyword == "v")
+        else if (isBinaryDlyFile (data, size))
         {
-          glm::vec3 vertex;
-          lineStream >> vertex;
-
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse vertex at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            if (meshes.empty ())
-            {
-              meshes.push_back (Mesh ());
-            }
-            meshes.back ().addVertex (vertex);
-          }
+          success = ImportExport::fromBinaryDlyFile (data, size, config, scene);
         }
-        else if (keyword == "f")
+        else if (isPlyFile (data, size))
         {
-          std::string  v1String, v2String, v3String;
-          unsigned int v1, v2, v3;
-
-          lineStream >> v1String >> v2String >> v3String;
-
-          if (lineStream.fail () || extractFirst (v1String, v1) == false ||
-              extractFirst (v2String, v2) == false || extractFirst (v3String, v3) == false)
-          {
-            DILAY_WARN ("could not parse face at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            std::string  v4String;
-            unsigned int v4;
-            lineStream >> v4String;
-
-            if (lineStream.fail ())
-            {
-              lineStream.clear ();
-
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1);
-            }
-            else if (extractFirst (v4String, v4) == false)
-            {
-              DILAY_WARN ("could not parse face at line %u", lineNumber)
-              return false;
-            }
-            else
-            {
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1, v4 - 1);
-            }
-          }
+          success = ImportExport::fromPlyFile (data, size, config, scene);
         }
-        else if (keyword == "dly_sketch_mesh")
+        else if (isMeshFile (fileName))
         {
-          nodes.clear ();
-          sketch = &scene.newSketchMesh (config, SketchTree ());
+          // mesh files are never parsed as text files
+          success = ImportExport::fromStlFile (data, size, config, scene);
         }
-        else if (keyword == "dly_sketch_node")
+        else
         {
-          if (sketch == nullptr)
-          {
-            DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
-            return false;
-          }
-          unsigned int nodeIndex;
-          unsigned int parentIndex;
-          glm::vec3    center;
-          float        radius;
+          success = ImportExport::fromTextDlyFile (reinterpret_cast<const char*> (data), size,
+                                                   config, scene);
+        }
+        binaryFile.unmap (data);
+        return success;
+      }
+    }
+    binaryFile.close ();
 
-          lineStream >> nodeIndex >> parentIndex >> center >> radius;
+    std::ifstream file (fileName);
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch node at line %u", lineNumber)
-            return false;
-          }
+    if (file.is_open ())
+    {
+      const bool success = ImportExport::fromDlyFile (file, config, scene);
+      file.close ();
+      return success;
+    }
+    else
+    {
+      return false;
+    }
+  }
 
-          if (nodeIndex == nodes.size ())
-          {
-            if (nodeIndex == 0)
-            {
-              nodes.push_back (&sketch->tree ().emplaceRoot (PrimSphere (center, radius)));
-            }
-            else if (parentIndex < nodes.size ())
-            {
-              nodes.push_back (&nodes.at (parentIndex)->emplaceChild (PrimSphere (center, radius)));
-            }
-            else
-            {
-              DILAY_WARN ("invalid parent index at line %u", lineNumber)
-              return false;
-            }
-          }
-          else
-          {
-            DILAY_WARN ("invalid node index at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_path")
-        {
-          lineStream >> intersectionFirst >> intersectionLast;
+  /* The header refers to no preview while a preview is written, hence an interrupted update leaves
+   * a valid file.  The previous preview is overwritten if nothing has been appended since.
+   */
+  bool embedPreview (const std::string& fileName, const std::string& preview)
+  {
+    assert (isLittleEndian ());
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch path at line %u", lineNumber)
-            return false;
-          }
-          if (sketch)
-          {
-            sketchPath = &sketch->addPath (SketchPath ());
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_sphere")
-        {
-          glm::vec3 center;
-          float     radius;
+    QFile       file (QString::fromStdString (fileName));
+    BinaryIndex index;
 
-          lineStream >> center >> radius;
+    if (file.open (QIODevice::ReadWrite) == false || file.size () < qint64 (binaryHeaderSize))
+    {
+      return false;
+    }
+    else
+    {
+      unsigned char* data = file.map (0, file.size ());
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch sphere at line %u", lineNumber)
-            return false;
-          }
+      if (data == nullptr)
+      {
+        return false;
+      }
+      BinaryReader reader (data, std::size_t (file.size ()));
+      const bool   isValid = readBinaryIndex (reader, index);
 
-          if (sketchPath)
-          {
-            if (sketchPath->isEmpty ())
-            {
-              sketchPath->addSphere (intersectionFirst, center, radius);
-            }
-            else
-            {
-              sketchPath->addSphere (intersectionLast, center, radius);
-            }
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u",
-                        lineNumber)
-            return false;
-          }
-        }
+      file.unmap (data);
+      if (isValid == false || index.version != binaryVersion)
+      {
+        return false;
       }
     }
-    meshes.erase (std::remove_if (meshes.begin (), meshes.end (),
-                                  [](Mesh& m) { return m.numVertices () == 0; }),
-                  meshes.end ());
 
-    if (std::all_of (meshes.begin (), meshes.end (),
-                     [](Mesh& m) { return MeshUtil::checkConsistency (m); }))
-    {
-      for (Mesh& m : meshes)
+    const auto     paddedSize = [](uint64_t size) { return size + (4 - size % 4) % 4; };
+    const uint64_t fileSize = uint64_t (file.size ());
+    const uint64_t offset =
+      index.preview.size > 0 && index.preview.offset + paddedSize (index.preview.size) == fileSize
+        ? index.preview.offset
+        : fileSize;
+    const Sink sink = [&file](const char* data, std::size_t size) { file.write (data, size); };
+
+    const auto writeChunk = [&file, &sink](uint64_t chunkOffset, uint64_t chunkSize) {
+      if (file.seek (qint64 (binaryPreviewOffset)) == false)
       {
-        scene.newDynamicMesh (config, m);
+        return false;
       }
-      return true;
+      writeBinary (sink, chunkOffset);
+      writeBinary (sink, chunkSize);
+      return file.flush () && file.error () == QFileDevice::NoError;
+    };
+
+    if (writeChunk (0, 0) == false || file.resize (qint64 (offset)) == false ||
+        file.seek (qint64 (offset)) == false)
+    {
+      return false;
     }
-    else
+    sink (preview.data (), preview.size ());
+    sink ("\0\0\0", std::size_t (paddedSize (preview.size ()) - preview.size ()));
+
+    if (file.flush () == false || file.error () != QFileDevice::NoError)
     {
       return false;
     }
+    return writeChunk (offset, preview.size ());
   }
 
-  bool fromDlyFile (const std::string& fileName, const Config& config, Scene& scene)
+  // only the header is parsed
+  std::string readPreview (const std::string& fileName)
   {
-    std::ifstream file (fileName);
+    QFile      file (QString::fromStdString (fileName));
+    QByteArray header;
 
-    if (file.is_open ())
+    if (file.open (QIODevice::ReadOnly))
     {
-      const bool success = ImportExport::fromDlyFile (file, config, scene);
-      file.close ();
-      return success;
+      header = file.read (qint64 (binaryHeaderSize));
     }
-    else
+    if (header.size () == int (binaryHeaderSize))
     {
-      return false;
+      const uint64_t fileSize = uint64_t (file.size ());
+      BinaryReader   reader (reinterpret_cast<const unsigned char*> (header.constData ()),
+                           binaryHeaderSize);
+      uint32_t       version;
+      uint64_t       indexOffset, offset, size;
+
+      if (reader.readArray<char> (sizeof (binaryMagic)) &&
+          std::memcmp (reader.data, binaryMagic, sizeof (binaryMagic)) == 0 &&
+          reader.read (version) && version >= 4 && version <= binaryVersion &&
+          reader.read (indexOffset) && reader.read (offset) && reader.read (size) && size > 0 &&
+          offset <= fileSize && size <= fileSize - offset && file.seek (qint64 (offset)))
+      {
+        const QByteArray preview = file.read (qint64 (size));
+
+        if (uint64_t (preview.size ()) == size)
+        {
+          return std::string (preview.constData (), std::size_t (preview.size ()));
+        }
+      }
     }
+    return std::string ();
   }
 };
@@ -5,18 +5,77 @@
 #ifndef DILAY_IMPORT_EXPORT
 #define DILAY_IMPORT_EXPORT
 
+#include <cstddef>
+#include <functional>
 #include <iosfwd>
 #include <string>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "mesh.hpp"
+#include "sketch/fwd.hpp"
+#include "sketch/path.hpp"
 
 class Config;
 class Scene;
 
+/* Files are written in the text format if they are Wavefront files, as binary STL or PLY files if
+ * they are mesh files, and otherwise in the binary format.
+ */
 namespace ImportExport
 {
-  void toDlyFile (std::ostream&, Scene&, bool);
-  bool toDlyFile (const std::string&, Scene&, bool);
-  bool fromDlyFile (std::istream&, const Config&, Scene&);
-  bool fromDlyFile (const std::string&, const Config&, Scene&);
+  /* Frozen scenes are immutable copies of a scene that share the geometry of its meshes until
+   * the scene is modified.  Free vertices and faces are only recorded for meshes that are not
+   * pruned, and are omitted when writing.  Frozen scenes can be written on any thread.  Meshes of
+   * binary files are compressed if `compressMeshes` is set.  Layouts of meshes are only stored in
+   * binary files, and only if they are not empty.
+   */
+  struct FrozenMesh
+  {
+    Mesh              mesh;
+    std::vector<bool> freeVertices;
+    std::vector<bool> freeFaces;
+    DynamicMeshLayout layout;
+  };
+
+  struct FrozenSketchMesh
+  {
+    SketchTree  tree;
+    SketchPaths paths;
+  };
+
+  struct FrozenScene
+  {
+    std::vector<FrozenMesh>       meshes;
+    std::vector<FrozenSketchMesh> sketchMeshes;
+    bool                          compressMeshes = false;
+  };
+
+  // receives the fraction of a file that has been written
+  typedef std::function<void(float)> Progress;
+
+  FrozenMesh  freeze (const DynamicMesh&);
+  FrozenScene freeze (const Scene&);
+  void        toDlyFile (std::ostream&, const FrozenScene&, bool, const Progress& = nullptr);
+  void        toBinaryDlyFile (std::ostream&, const FrozenScene&, const Progress& = nullptr);
+  bool        toDlyFile (const std::string&, const FrozenScene&, bool, const Progress& = nullptr);
+  void        toDlyFile (std::ostream&, const Scene&, bool);
+  void        toBinaryDlyFile (std::ostream&, const Scene&);
+  bool        toDlyFile (const std::string&, const Scene&, bool);
+  bool        fromDlyFile (std::istream&, const Config&, Scene&);
+  // adds the pruned meshes and the sketch meshes of a frozen scene
+  bool        fromFrozenScene (const FrozenScene&, const Config&, Scene&);
+  bool        fromTextDlyFile (const char*, std::size_t, const Config&, Scene&);
+  bool        fromBinaryDlyFile (const unsigned char*, std::size_t, const Config&, Scene&);
+  bool        fromDlyFile (const std::string&, const Config&, Scene&);
+  // mesh files are recognized by their suffix `.stl` or `.ply`, and omit sketch meshes
+  bool        isMeshFile (const std::string&);
+  // welds duplicate vertices of STL files and binary PLY files
+  bool        fromStlFile (const unsigned char*, std::size_t, const Config&, Scene&);
+  bool        fromPlyFile (const unsigned char*, std::size_t, const Config&, Scene&);
+  // embeds an image into a binary file of the current version, which replaces previous images
+  bool        embedPreview (const std::string&, const std::string&);
+  // returns the image embedded into a binary file, which is empty if there is none
+  std::string readPreview (const std::string&);
 };
 
 #endif
@@ -11,6 +11,7 @@
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/sphere.hpp"
+#include "primitive/triangle-block.hpp"
 #include "primitive/triangle.hpp"
 #include "util.hpp"
 
@@ -262,11 +263,68 @@ bool IntersectionUtil::intersects (const PrimRay& ray, const PrimTriangle& tri,
   }
 }
 
+// cf. `IntersectionUtil::intersects (const PrimRay&, const PrimTriangle&, bool, float*)`
+bool IntersectionUtil::intersects (const PrimRay& ray, const PrimTriangleBlock& block, bool both,
+                                   float* t, unsigned int* index)
+{
+  const PrimTriangleBlock::Coordinates& v1 = block.vertices1 ();
+  const PrimTriangleBlock::Coordinates& e1 = block.edges1 ();
+  const PrimTriangleBlock::Coordinates& e2 = block.edges2 ();
+  const glm::vec3&                      o = ray.origin ();
+  const glm::vec3&                      dir = ray.direction ();
+  const float                           epsSqr = Util::epsilon () * Util::epsilon ();
+
+  float        nearestT = Util::maxFloat ();
+  unsigned int nearest = Util::invalidIndex ();
+
+  for (unsigned int i = 0; i < block.numTriangles (); i++)
+  {
+    // the cross product of the edges is compared with the direction without normalizing it
+    const float cx = (e1.y[i] * e2.z[i]) - (e1.z[i] * e2.y[i]);
+    const float cy = (e1.z[i] * e2.x[i]) - (e1.x[i] * e2.z[i]);
+    const float cz = (e1.x[i] * e2.y[i]) - (e1.y[i] * e2.x[i]);
+    const float dot = (dir.x * cx) + (dir.y * cy) + (dir.z * cz);
+    const bool  isParallel = dot * dot <= epsSqr * ((cx * cx) + (cy * cy) + (cz * cz));
+    const bool  isCulled = isParallel || (both == false && dot > 0.0f);
+
+    const float s1x = (dir.y * e2.z[i]) - (dir.z * e2.y[i]);
+    const float s1y = (dir.z * e2.x[i]) - (dir.x * e2.z[i]);
+    const float s1z = (dir.x * e2.y[i]) - (dir.y * e2.x[i]);
+    const float invDet = 1.0f / ((s1x * e1.x[i]) + (s1y * e1.y[i]) + (s1z * e1.z[i]));
+    const float dx = o.x - v1.x[i];
+    const float dy = o.y - v1.y[i];
+    const float dz = o.z - v1.z[i];
+    const float s2x = (dy * e1.z[i]) - (dz * e1.y[i]);
+    const float s2y = (dz * e1.x[i]) - (dx * e1.z[i]);
+    const float s2z = (dx * e1.y[i]) - (dy * e1.x[i]);
+    const float b1 = ((dx * s1x) + (dy * s1y) + (dz * s1z)) * invDet;
+    const float b2 = ((dir.x * s2x) + (dir.y * s2y) + (dir.z * s2z)) * invDet;
+    const float tRay = ((e2.x[i] * s2x) + (e2.y[i] * s2y) + (e2.z[i] * s2z)) * invDet;
+
+    if (isCulled == false && b1 >= 0.0f && b2 >= 0.0f && b1 + b2 <= 1.0f &&
+        (tRay >= 0.0f || ray.isLine ()) && tRay < nearestT)
+    {
+      nearestT = tRay;
+      nearest = i;
+    }
+  }
+
+  if (nearest == Util::invalidIndex ())
+  {
+    return false;
+  }
+  else
+  {
+    Util::setIfNotNull (t, nearestT);
+    Util::setIfNotNull (index, nearest);
+    return true;
+  }
+}
+
 bool IntersectionUtil::intersects (const PrimRay& ray, const PrimAABox& box, float* t)
 {
-  const glm::vec3 invDir = glm::vec3 (1.0f) / ray.direction ();
-  const glm::vec3 lowerTs = (box.minimum () - ray.origin ()) * invDir;
-  const glm::vec3 upperTs = (box.maximum () - ray.origin ()) * invDir;
+  const glm::vec3 lowerTs = (box.minimum () - ray.origin ()) * ray.invDirection ();
+  const glm::vec3 upperTs = (box.maximum () - ray.origin ()) * ray.invDirection ();
   const glm::vec3 min = glm::min (lowerTs, upperTs);
   const glm::vec3 max = glm::max (lowerTs, upperTs);
 
@@ -380,9 +438,15 @@ bool IntersectionUtil::intersects (const PrimPlane& plane, const PrimAABox& box)
 
 bool IntersectionUtil::intersects (const PrimPlane& plane, const PrimTriangle& tri)
 {
-  const float d1 = plane.distance (tri.vertex1 ());
-  const float d2 = plane.distance (tri.vertex2 ());
-  const float d3 = plane.distance (tri.vertex3 ());
+  return IntersectionUtil::intersects (plane, tri.vertex1 (), tri.vertex2 (), tri.vertex3 ());
+}
+
+bool IntersectionUtil::intersects (const PrimPlane& plane, const glm::vec3& v1,
+                                   const glm::vec3& v2, const glm::vec3& v3)
+{
+  const float d1 = plane.distance (v1);
+  const float d2 = plane.distance (v2);
+  const float d3 = plane.distance (v3);
 
   const bool oneLess = d1 < Util::epsilon () || d2 < Util::epsilon () || d3 < Util::epsilon ();
   const bool oneGreater =
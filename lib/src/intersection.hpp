@@ -14,6 +14,7 @@ class PrimPlane;
 class PrimRay;
 class PrimSphere;
 class PrimTriangle;
+class PrimTriangleBlock;
 
 class Intersection
 {
@@ -46,11 +47,14 @@ namespace IntersectionUtil
   bool intersects (const PrimRay&, const PrimSphere&, float*);
   bool intersects (const PrimRay&, const PrimPlane&, float*);
   bool intersects (const PrimRay&, const PrimTriangle&, bool, float*);
+  // finds the nearest triangle of a block and stores its index within the block
+  bool intersects (const PrimRay&, const PrimTriangleBlock&, bool, float*, unsigned int*);
   bool intersects (const PrimRay&, const PrimAABox&, float*);
   bool intersects (const PrimRay&, const PrimCylinder&, float*, float*);
   bool intersects (const PrimRay&, const PrimCone&, float*, float*);
   bool intersects (const PrimPlane&, const PrimAABox&);
   bool intersects (const PrimPlane&, const PrimTriangle&);
+  bool intersects (const PrimPlane&, const glm::vec3&, const glm::vec3&, const glm::vec3&);
   bool intersects (const PrimCylinder&, const glm::vec3&);
   bool intersects (const PrimCone&, const glm::vec3&);
   bool intersects (const PrimAABox&, const PrimAABox&);
@@ -3,181 +3,516 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
 #include <glm/gtx/norm.hpp>
-#include <thread>
+#include <limits>
 #include <vector>
 #include "distance.hpp"
 #include "dynamic/mesh.hpp"
 #include "intersection.hpp"
 #include "isosurface-extraction.hpp"
 #include "isosurface-extraction/grid.hpp"
+#include "isosurface-extraction/shard.hpp"
+#include "maybe.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/triangle.hpp"
+#include "profile.hpp"
 #include "util.hpp"
 
 namespace
 {
   typedef IsosurfaceExtraction::DistanceCallback     DistanceCallback;
+  typedef IsosurfaceExtraction::DistancesCallback    DistancesCallback;
   typedef IsosurfaceExtraction::IntersectionCallback IntersectionCallback;
+  typedef IsosurfaceExtraction::NearCallback         NearCallback;
+  typedef IsosurfaceExtraction::BoundsCallback       BoundsCallback;
 
   static const float markInside = -0.5f;
   static const float markOutside = 0.5f;
   static const float markInsideToSample = -0.6f;
   static const float markOutsideToSample = 0.6f;
 
+  static const unsigned int brickSize = 8;
+  static const unsigned int minOctantSize = 2;
+  static const unsigned int maxNumSamplesInMemory = 1 << 24;
+
+  // the samples of anchored shards are keyed by their lattice coordinates plus this bias
+  static const int          anchoredBias = 1 << 19;
+  static const unsigned int anchoredNumCubes = 1 << 20;
+
+  // cf. `IsosurfaceExtraction::estimateNumFaces`
+  static const double      facesPerArea = 2.0 * 1.5;
+  static const std::size_t bytesPerFace = 128;
+
   struct Parameters
   {
-    const DistanceCallback&     getDistance;
-    const IntersectionCallback* getIntersection;
-    IsosurfaceExtractionGrid    grid;
+    const DistancesCallback      getDistances;
+    const IntersectionCallback*  getIntersection;
+    const NearCallback*          isNear;
+    const BoundsCallback*        getBounds;
+    IsosurfaceExtractionContext& context;
+    IsosurfaceExtractionGrid&    grid;
+    bool                         isRegion;
+    bool                         isShard;
+    float                        rayOffset;
+    // the range along z of the boxes of each column (cf. `cullColumns`)
+    std::vector<glm::vec2> columns;
 
-    Parameters (const DistanceCallback& d, const IntersectionCallback* i, const PrimAABox& b,
-                float r)
-      : getDistance (d)
+    Parameters (const DistancesCallback& d, const IntersectionCallback* i,
+                IsosurfaceExtractionContext& c, const PrimAABox& b, float r, bool slabs = false)
+      : getDistances (d)
       , getIntersection (i)
-      , grid (b, r)
+      , isNear (nullptr)
+      , getBounds (nullptr)
+      , context (c)
+      , grid (c.grid (b, r, slabs))
+      , isRegion (false)
+      , isShard (false)
+      , rayOffset (0.0f)
+    {
+    }
+
+    Parameters (const DistancesCallback& d, const IntersectionCallback* i,
+                IsosurfaceExtractionContext& c, IsosurfaceExtractionGrid& g)
+      : getDistances (d)
+      , getIntersection (i)
+      , isNear (nullptr)
+      , getBounds (nullptr)
+      , context (c)
+      , grid (g)
+      , isRegion (false)
+      , isShard (false)
+      , rayOffset (0.0f)
+    {
+    }
+
+    bool isCancelled () const { return this->context.isCancelled (); }
+
+    float getDistance (const glm::vec3& position) const
     {
+      std::vector<float> distances;
+      this->getDistances ({position}, distances);
+      return distances[0];
     }
   };
 
-  void sampleDistancesThread (Parameters& params, unsigned int numThreads, unsigned int threadId)
+  // [min, max)
+  struct Brick
   {
-    std::vector<float>& samples = params.grid.samples ();
+    glm::uvec3 min;
+    glm::uvec3 max;
+  };
+
+  /* Splits a grid of the given size into bricks of `brickSize`^3 elements, which are processed
+   * by the thread pool.  Idle threads take over the next unprocessed bricks, so expensive regions
+   * do not leave other threads idle, and neighboring elements are processed by the same thread.
+   */
+  template <typename F> void forEachBrick (const glm::uvec3& size, const F& f)
+  {
+    const glm::uvec3   numBricks = (size + glm::uvec3 (brickSize - 1)) / glm::uvec3 (brickSize);
+    const unsigned int totalNumBricks = numBricks.x * numBricks.y * numBricks.z;
+
+    Parallel::forEach (totalNumBricks, [&numBricks, &size, &f](unsigned int i) {
+      const std::div_t divZ = std::div (int(i), int(numBricks.x * numBricks.y));
+      const std::div_t divY = std::div (divZ.rem, int(numBricks.x));
+      Brick            brick;
 
-    for (unsigned int z = 0; z < params.grid.numSamples ().z; z++)
+      brick.min = glm::uvec3 (divY.rem, divY.quot, divZ.quot) * brickSize;
+      brick.max = glm::min (brick.min + glm::uvec3 (brickSize), size);
+
+      f (brick);
+    });
+  }
+
+  template <typename F> void forEachInBrick (const Brick& brick, const F& f)
+  {
+    for (unsigned int z = brick.min.z; z < brick.max.z; z++)
     {
-      for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+      for (unsigned int y = brick.min.y; y < brick.max.y; y++)
       {
-        for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
+        for (unsigned int x = brick.min.x; x < brick.max.x; x++)
         {
-          const unsigned int index = params.grid.sampleIndex (x, y, z);
+          f (x, y, z);
+        }
+      }
+    }
+  }
 
-          if (index % numThreads == threadId)
-          {
-            const glm::vec3 pos = params.grid.samplePos (x, y, z);
+  // samples the distances of all samples of a brick that are still to be sampled at once
+  void sampleDistances (Parameters& params, const Brick& brick)
+  {
+    std::vector<float>&     samples = params.grid.samples ();
+    std::vector<glm::uvec3> coordinates;
+    std::vector<glm::vec3>  positions;
+    std::vector<float>      distances;
 
-            if (params.getIntersection)
-            {
-              if (samples[index] == markInsideToSample)
-              {
-                samples[index] = -params.getDistance (pos);
-              }
-              else if (samples[index] == markOutsideToSample)
-              {
-                samples[index] = params.getDistance (pos);
-              }
-              else
-              {
-                continue;
-              }
-            }
-            else
-            {
-              assert (samples[index] == Util::maxFloat ());
-              samples[index] = params.getDistance (pos);
-            }
-            assert (Util::isNaN (samples[index]) == false);
-            assert (samples[index] != Util::maxFloat ());
-            assert ((x > 0 && x < params.grid.numSamples ().x - 1) || samples[index] > 0.0f);
-            assert ((y > 0 && y < params.grid.numSamples ().y - 1) || samples[index] > 0.0f);
-            assert ((z > 0 && z < params.grid.numSamples ().z - 1) || samples[index] > 0.0f);
-          }
-        }
+    forEachInBrick (brick, [&params, &samples, &coordinates](unsigned int x, unsigned int y,
+                                                             unsigned int z) {
+      const float sample = samples[params.grid.sampleIndex (x, y, z)];
+
+      if (params.getIntersection ? (sample == markInsideToSample || sample == markOutsideToSample)
+                                 : sample == Util::maxFloat ())
+      {
+        coordinates.emplace_back (x, y, z);
       }
+    });
+
+    if (coordinates.empty ())
+    {
+      return;
+    }
+
+    positions.reserve (coordinates.size ());
+    for (const glm::uvec3& c : coordinates)
+    {
+      positions.push_back (params.grid.samplePos (c.x, c.y, c.z));
+    }
+    params.getDistances (positions, distances);
+    assert (distances.size () == positions.size ());
+
+    for (unsigned int i = 0; i < coordinates.size (); i++)
+    {
+      const unsigned int x = coordinates[i].x;
+      const unsigned int y = coordinates[i].y;
+      const unsigned int z = coordinates[i].z;
+      const unsigned int index = params.grid.sampleIndex (x, y, z);
+
+      samples[index] = samples[index] == markInsideToSample ? -distances[i] : distances[i];
+
+      assert (Util::isNaN (samples[index]) == false);
+      assert (samples[index] != Util::maxFloat ());
+      // the bounds of shards may lie within the surface
+      assert (params.isShard || (x > 0 && x < params.grid.numSamples ().x - 1) ||
+              samples[index] > 0.0f);
+      assert (params.isShard || (y > 0 && y < params.grid.numSamples ().y - 1) ||
+              samples[index] > 0.0f);
+      assert (params.isShard || (z > 0 && z < params.grid.numSamples ().z - 1) ||
+              samples[index] > 0.0f);
     }
   }
 
   void sampleDistances (Parameters& params)
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: sample distances");
+
+    forEachBrick (params.grid.numSamples (), [&params](const Brick& brick) {
+      if (params.isCancelled () == false)
+      {
+        sampleDistances (params, brick);
+      }
+    });
+  }
+
+  void fillBrick (Parameters& params, const Brick& brick, float distance)
+  {
+    IsosurfaceExtractionGrid& grid = params.grid;
+    std::vector<float>&       samples = grid.samples ();
+
+    forEachInBrick (brick, [&grid, &samples, distance](unsigned int x, unsigned int y,
+                                                       unsigned int z) {
+      const unsigned int index = grid.sampleIndex (x, y, z);
+
+      assert (samples[index] == Util::maxFloat ());
+      samples[index] = distance;
+    });
+  }
 
-    for (unsigned int i = 0; i < numThreads; i++)
+  /* The distance callback is assumed to be 1-Lipschitz (e.g. a signed distance or a union of
+   * signed distances).  A brick whose center is further away from the surface than its half
+   * diagonal plus one cell can not contain a sign change, nor can one of its samples form a sign
+   * change with a neighboring sample.  Its samples are therefore filled without sampling.
+   */
+  bool fillFarBrick (Parameters& params, const Brick& brick, float distance)
+  {
+    const IsosurfaceExtractionGrid& grid = params.grid;
+
+    const glm::vec3 minPos = grid.samplePos (brick.min.x, brick.min.y, brick.min.z);
+    const glm::vec3 maxPos = grid.samplePos (brick.max.x - 1, brick.max.y - 1, brick.max.z - 1);
+    const float     halfDiagonal = 0.5f * glm::distance (minPos, maxPos);
+
+    assert (Util::isNaN (distance) == false);
+
+    if (glm::abs (distance) > halfDiagonal + grid.resolution ())
     {
-      threads.emplace_back (sampleDistancesThread, std::ref (params), numThreads, i);
+      fillBrick (params, brick, distance);
+      return true;
     }
-    for (unsigned int i = 0; i < numThreads; i++)
+    else
     {
-      threads.at (i).join ();
+      return false;
     }
   }
 
-  void sampleIntersectionsThread (Parameters& params, unsigned int numThreads,
-                                  unsigned int threadId)
+  /* The octants of a brick that is near the surface are filled likewise, down to octants of
+   * `minOctantSize`^3 samples, so only a thin shell around the surface remains to be sampled.
+   * The distances of the centers of all octants of a brick are computed at once.
+   */
+  void fillFarOctants (Parameters& params, const Brick& brick)
   {
-    assert (params.getIntersection);
+    const glm::uvec3 size = brick.max - brick.min;
 
-    std::vector<float>& samples = params.grid.samples ();
+    if (glm::any (glm::lessThan (size, glm::uvec3 (2 * minOctantSize))))
+    {
+      return;
+    }
 
-    for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+    const glm::uvec3       mid = brick.min + ((size + glm::uvec3 (1)) / glm::uvec3 (2));
+    std::vector<Brick>     octants (8);
+    std::vector<glm::vec3> centers (8);
+    std::vector<float>     distances;
+
+    for (unsigned int i = 0; i < 8; i++)
     {
-      for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
+      Brick& octant = octants[i];
+
+      octant.min.x = (i & 1) ? mid.x : brick.min.x;
+      octant.min.y = (i & 2) ? mid.y : brick.min.y;
+      octant.min.z = (i & 4) ? mid.z : brick.min.z;
+      octant.max.x = (i & 1) ? brick.max.x : mid.x;
+      octant.max.y = (i & 2) ? brick.max.y : mid.y;
+      octant.max.z = (i & 4) ? brick.max.z : mid.z;
+
+      centers[i] =
+        0.5f * (params.grid.samplePos (octant.min.x, octant.min.y, octant.min.z) +
+                params.grid.samplePos (octant.max.x - 1, octant.max.y - 1, octant.max.z - 1));
+    }
+    params.getDistances (centers, distances);
+    assert (distances.size () == centers.size ());
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (fillFarBrick (params, octants[i], distances[i]) == false)
       {
-        if (params.grid.sampleIndex (x, y, 0) % numThreads == threadId)
-        {
-          const glm::vec3 dir (0.0f, 0.0f, 1.0f);
-          bool            inside = false;
-          unsigned int    z = 0;
-          Intersection    intersection;
-          PrimRay         ray (params.grid.samplePos (x, y, 0.0f) - (dir * Util::epsilon ()), dir);
+        fillFarOctants (params, octants[i]);
+      }
+    }
+  }
 
-          while (true)
-          {
-            intersection.reset ();
-            IsosurfaceExtraction::Intersection i = (*params.getIntersection) (ray, intersection);
+  /* Bricks that are not near the surface (extended by one cell) are filled without computing a
+   * distance: each sample is at least one cell away from the surface.
+   */
+  void cullFarBrick (Parameters& params, const Brick& brick)
+  {
+    const IsosurfaceExtractionGrid& grid = params.grid;
 
-            if (i == IsosurfaceExtraction::Intersection::None)
-            {
-              break;
-            }
-            else
-            {
-              const float d2 = intersection.distance () * intersection.distance ();
+    const glm::vec3 minPos = grid.samplePos (brick.min.x, brick.min.y, brick.min.z);
+    const glm::vec3 maxPos = grid.samplePos (brick.max.x - 1, brick.max.y - 1, brick.max.z - 1);
+    const glm::vec3 cell (grid.resolution ());
+    const bool      isNear =
+      params.isNear == nullptr || (*params.isNear) (PrimAABox (minPos - cell, maxPos + cell));
 
-              while (glm::distance2 (params.grid.samplePos (x, y, z), ray.origin ()) < d2)
-              {
-                const unsigned int index = params.grid.sampleIndex (x, y, z);
+    if (isNear == false)
+    {
+      fillBrick (params, brick, grid.resolution ());
+    }
+    else if (fillFarBrick (params, brick, params.getDistance (0.5f * (minPos + maxPos))) == false)
+    {
+      fillFarOctants (params, brick);
+    }
+  }
 
-                assert (samples[index] == Util::maxFloat ());
-                samples[index] = inside ? markInside : markOutside;
+  void cullFarBricks (Parameters& params)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: cull far bricks");
 
-                z++;
-              }
-              ray.origin (intersection.position () + (dir * Util::epsilon ()));
+    forEachBrick (params.grid.numSamples (), [&params](const Brick& brick) {
+      if (params.isCancelled () == false)
+      {
+        cullFarBrick (params, brick);
+      }
+    });
+  }
 
-              if (i == IsosurfaceExtraction::Intersection::Sample)
-              {
-                inside = not inside;
-              }
-            }
-          }
+  void sampleLayer (Parameters& params, unsigned int layer)
+  {
+    const glm::uvec3 layerSize (params.grid.numSamples ().x, params.grid.numSamples ().y, 1);
 
-          assert (z < params.grid.numSamples ().z - 1);
-          for (; z < params.grid.numSamples ().z; z++)
-          {
-            const unsigned int index = params.grid.sampleIndex (x, y, z);
+    forEachBrick (layerSize, [&params, layer](const Brick& layerBrick) {
+      const Brick brick{glm::uvec3 (layerBrick.min.x, layerBrick.min.y, layer),
+                        glm::uvec3 (layerBrick.max.x, layerBrick.max.y, layer + 1)};
+      std::vector<float>& samples = params.grid.samples ();
 
-            assert (samples[index] == Util::maxFloat ());
-            samples[index] = markOutside;
-          }
+      forEachInBrick (brick, [&params, &samples](unsigned int x, unsigned int y, unsigned int z) {
+        samples[params.grid.sampleIndex (x, y, z)] = Util::maxFloat ();
+      });
+      if (params.isCancelled () == false)
+      {
+        cullFarBrick (params, brick);
+        sampleDistances (params, brick);
+      }
+    });
+    params.context.reportProgress (float(layer + 1) / float(params.grid.numSamples ().z));
+  }
+
+  /* Rasterizes the boxes of the bounds callback into the columns of the grid, i.e., the range
+   * along z of the boxes that enclose a column's ray.  Boxes are enlarged by half a cell, so that
+   * rounding does not cull the rays of columns that touch a box.
+   */
+  void cullColumns (Parameters& params)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: cull columns");
+
+    assert (params.getBounds);
+
+    const IsosurfaceExtractionGrid& grid = params.grid;
+    const glm::uvec3&               numSamples = grid.numSamples ();
+    const glm::vec3                 origin = grid.samplePos (0, 0, 0);
+    const float                     r = grid.resolution ();
+
+    params.columns.assign (numSamples.x * numSamples.y,
+                           glm::vec2 (Util::maxFloat (), -Util::maxFloat ()));
+
+    (*params.getBounds) ([&params, &numSamples, &origin, r](const PrimAABox& box) {
+      const glm::vec3 min = ((box.minimum () - origin) / r) - glm::vec3 (0.5f);
+      const glm::vec3 max = ((box.maximum () - origin) / r) + glm::vec3 (0.5f);
+
+      if (max.x < 0.0f || max.y < 0.0f || min.x > float(numSamples.x - 1) ||
+          min.y > float(numSamples.y - 1))
+      {
+        return;
+      }
+
+      const unsigned int minX = (unsigned int) glm::max (0.0f, glm::ceil (min.x));
+      const unsigned int minY = (unsigned int) glm::max (0.0f, glm::ceil (min.y));
+      const unsigned int maxX = (unsigned int) glm::min (float(numSamples.x - 1), max.x);
+      const unsigned int maxY = (unsigned int) glm::min (float(numSamples.y - 1), max.y);
+
+      for (unsigned int y = minY; y <= maxY; y++)
+      {
+        for (unsigned int x = minX; x <= maxX; x++)
+        {
+          glm::vec2& column = params.columns[(y * numSamples.x) + x];
+
+          column.x = glm::min (column.x, box.minimum ().z);
+          column.y = glm::max (column.y, box.maximum ().z);
         }
       }
-    }
+    });
   }
 
-  void sampleIntersections (Parameters& params)
+  /* Each column is sampled by a single ray: all of its crossings with the surface are queried at
+   * once, and a sample is inside if an odd number of crossings lies in front of it.  If columns
+   * have been culled, samples more than a cell below a column's boxes are outside, and its ray
+   * starts at the last of them.  Samples of columns without boxes are outside.
+   */
+  void sampleIntersection (Parameters& params, std::vector<float>& crossings, unsigned int x,
+                           unsigned int y)
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    assert (params.getIntersection);
+
+    std::vector<float>& samples = params.grid.samples ();
+    const unsigned int  numZ = params.grid.numSamples ().z;
+    const glm::vec3     dir (0.0f, 0.0f, 1.0f);
+    unsigned int        firstZ = 0;
+
+    if (params.columns.empty () == false)
+    {
+      const glm::vec2& column = params.columns[(y * params.grid.numSamples ().x) + x];
+
+      if (column.x > column.y)
+      {
+        firstZ = numZ;
+      }
+      else
+      {
+        const float below = ((column.x - params.grid.samplePos (x, y, 0).z) /
+                             params.grid.resolution ()) - 1.0f;
+
+        firstZ = (unsigned int) glm::clamp (glm::ceil (below), 0.0f, float(numZ));
+      }
+
+      for (unsigned int z = 0; z < firstZ; z++)
+      {
+        const unsigned int index = params.grid.sampleIndex (x, y, z);
+
+        assert (samples[index] == Util::maxFloat ());
+        samples[index] = markOutside;
+      }
+      if (firstZ == numZ)
+      {
+        return;
+      }
+    }
 
-    for (unsigned int i = 0; i < numThreads; i++)
+    const float   offset = params.rayOffset + Util::epsilon ();
+    const PrimRay ray (firstZ == 0 ? params.grid.samplePos (x, y, 0) - (dir * offset)
+                                   : params.grid.samplePos (x, y, firstZ - 1),
+                       dir);
+    unsigned int  numCrossings = 0;
+
+    crossings.clear ();
+    (*params.getIntersection) (ray, crossings);
+    assert (std::is_sorted (crossings.begin (), crossings.end ()));
+
+    for (unsigned int z = firstZ; z < numZ; z++)
     {
-      threads.emplace_back (sampleIntersectionsThread, std::ref (params), numThreads, i);
+      const unsigned int index = params.grid.sampleIndex (x, y, z);
+      const float        d = glm::distance (params.grid.samplePos (x, y, z), ray.origin ());
+
+      while (numCrossings < crossings.size () && crossings[numCrossings] <= d)
+      {
+        numCrossings++;
+      }
+      assert (samples[index] == Util::maxFloat ());
+      samples[index] = numCrossings % 2 == 1 ? markInside : markOutside;
     }
-    for (unsigned int i = 0; i < numThreads; i++)
+    assert (params.isRegion || params.isShard ||
+            samples[params.grid.sampleIndex (x, y, numZ - 1)] == markOutside);
+  }
+
+  void sampleIntersections (Parameters& params)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: sample intersections");
+
+    if (params.getBounds && *params.getBounds)
     {
-      threads.at (i).join ();
+      cullColumns (params);
     }
+
+    const glm::uvec3 numColumns (params.grid.numSamples ().x, params.grid.numSamples ().y, 1);
+
+    forEachBrick (numColumns, [&params](const Brick& brick) {
+      std::vector<float> crossings;
+
+      if (params.isCancelled ())
+      {
+        return;
+      }
+
+      forEachInBrick (brick, [&params, &crossings](unsigned int x, unsigned int y, unsigned int) {
+        sampleIntersection (params, crossings, x, y);
+      });
+    });
+  }
+
+  /* Samples along the grid's bounds may be inside the surface when extracting a region.  They are
+   * marked as outside, which closes the extracted isosurface along the bounds.
+   */
+  void capRegion (Parameters& params)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: cap region");
+
+    IsosurfaceExtractionGrid& grid = params.grid;
+    std::vector<float>&       samples = grid.samples ();
+    const glm::uvec3&         numSamples = grid.numSamples ();
+
+    forEachBrick (numSamples, [&grid, &samples, &numSamples](const Brick& brick) {
+      forEachInBrick (brick, [&grid, &samples, &numSamples](unsigned int x, unsigned int y,
+                                                            unsigned int z) {
+        const bool onBounds = x == 0 || y == 0 || z == 0 || x == numSamples.x - 1 ||
+                              y == numSamples.y - 1 || z == numSamples.z - 1;
+        const unsigned int index = grid.sampleIndex (x, y, z);
+
+        if (onBounds && samples[index] == markInside)
+        {
+          samples[index] = markOutside;
+        }
+      });
+    });
   }
 
   bool isIntersecting (float s1, float s2)
@@ -185,82 +520,538 @@ namespace
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
   }
 
-  void markSamplePositions (Parameters& params)
+  bool isIntersectingCube (Parameters& params, unsigned int x, unsigned int y, unsigned int z)
   {
-    std::vector<float>& samples = params.grid.samples ();
+    const std::vector<float>& samples = params.grid.samples ();
+    const unsigned int        cubeIndex = params.grid.cubeIndex (x, y, z);
 
-    for (unsigned int z = 0; z < params.grid.numCubes ().z; z++)
+    const float cubeSamples[] = {samples[params.grid.sampleIndex (cubeIndex, 0)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 1)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 2)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 3)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 4)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 5)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 6)],
+                                 samples[params.grid.sampleIndex (cubeIndex, 7)]};
+
+    for (unsigned int edge = 0; edge < 12; edge++)
     {
-      for (unsigned int y = 0; y < params.grid.numCubes ().y; y++)
+      const unsigned char vertex1 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][0];
+      const unsigned char vertex2 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][1];
+
+      if (isIntersecting (cubeSamples[vertex1], cubeSamples[vertex2]))
       {
-        for (unsigned int x = 0; x < params.grid.numCubes ().x; x++)
-        {
-          const unsigned int cubeIndex = params.grid.cubeIndex (x, y, z);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Marks all samples of intersecting cubes.  Cubes share samples, hence intersecting cubes are
+   * determined first, and each sample is marked afterwards by looking at its adjacent cubes.
+   */
+  void markSamplePositions (Parameters& params)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction: mark sample positions");
 
-          const unsigned int cubeSampleIndices[] = {
-            params.grid.sampleIndex (cubeIndex, 0), params.grid.sampleIndex (cubeIndex, 1),
-            params.grid.sampleIndex (cubeIndex, 2), params.grid.sampleIndex (cubeIndex, 3),
-            params.grid.sampleIndex (cubeIndex, 4), params.grid.sampleIndex (cubeIndex, 5),
-            params.grid.sampleIndex (cubeIndex, 6), params.grid.sampleIndex (cubeIndex, 7)};
+    const IsosurfaceExtractionGrid& grid = params.grid;
+    const glm::uvec3&               numCubes = grid.numCubes ();
+    std::vector<float>&             samples = params.grid.samples ();
+    std::vector<char>               intersectingCubes (numCubes.x * numCubes.y * numCubes.z, 0);
 
-          const float cubeSamples[] = {
-            samples[cubeSampleIndices[0]], samples[cubeSampleIndices[1]],
-            samples[cubeSampleIndices[2]], samples[cubeSampleIndices[3]],
-            samples[cubeSampleIndices[4]], samples[cubeSampleIndices[5]],
-            samples[cubeSampleIndices[6]], samples[cubeSampleIndices[7]]};
+    forEachBrick (numCubes, [&params, &grid, &intersectingCubes](const Brick& brick) {
+      forEachInBrick (brick, [&params, &grid, &intersectingCubes](unsigned int x, unsigned int y,
+                                                                  unsigned int z) {
+        intersectingCubes[grid.cubeIndex (x, y, z)] = isIntersectingCube (params, x, y, z);
+      });
+    });
 
-          for (unsigned int edge = 0; edge < 12; edge++)
+    const auto isAdjacentToIntersectingCube = [&grid, &numCubes, &intersectingCubes](
+                                                unsigned int x, unsigned int y, unsigned int z) {
+      for (unsigned int cz = z > 0 ? z - 1 : 0; cz <= z && cz < numCubes.z; cz++)
+      {
+        for (unsigned int cy = y > 0 ? y - 1 : 0; cy <= y && cy < numCubes.y; cy++)
+        {
+          for (unsigned int cx = x > 0 ? x - 1 : 0; cx <= x && cx < numCubes.x; cx++)
           {
-            const unsigned char vertex1 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][0];
-            const unsigned char vertex2 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][1];
-
-            if (isIntersecting (cubeSamples[vertex1], cubeSamples[vertex2]))
+            if (intersectingCubes[grid.cubeIndex (cx, cy, cz)])
             {
-              for (unsigned int i = 0; i < 8; i++)
-              {
-                if (cubeSamples[i] == markInside)
-                {
-                  samples[cubeSampleIndices[i]] = markInsideToSample;
-                }
-                else if (cubeSamples[i] == markOutside)
-                {
-                  samples[cubeSampleIndices[i]] = markOutsideToSample;
-                }
-              }
-              break;
+              return true;
             }
           }
         }
       }
+      return false;
+    };
+
+    forEachBrick (grid.numSamples (), [&grid, &samples,
+                                       &isAdjacentToIntersectingCube](const Brick& brick) {
+      forEachInBrick (brick, [&grid, &samples, &isAdjacentToIntersectingCube](
+                               unsigned int x, unsigned int y, unsigned int z) {
+        const unsigned int index = grid.sampleIndex (x, y, z);
+
+        if ((samples[index] == markInside || samples[index] == markOutside) &&
+            isAdjacentToIntersectingCube (x, y, z))
+        {
+          samples[index] = samples[index] == markInside ? markInsideToSample : markOutsideToSample;
+        }
+      });
+    });
+  }
+
+  // cancelled extractions do not make a mesh, unless the mesh is made while sampling
+  bool makeMesh (Parameters& params, DynamicMesh& mesh)
+  {
+    if (params.isCancelled ())
+    {
+      return false;
+    }
+    params.grid.makeMesh (mesh);
+    params.context.reportProgress (1.0f);
+    return true;
+  }
+
+  bool extractDistances (const DistancesCallback& getDistances, const NearCallback* isNear,
+                         const PrimAABox& bounds, float resolution, DynamicMesh& mesh,
+                         IsosurfaceExtractionContext& context)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtraction::extract");
+
+    const glm::uvec3 numSamples = context.grid (bounds, resolution, true).numSamples ();
+
+    if (numSamples.x > 0 && numSamples.y > 0 && numSamples.z > 0)
+    {
+      if (std::size_t (numSamples.x) * numSamples.y * numSamples.z > maxNumSamplesInMemory)
+      {
+        Parameters params (getDistances, nullptr, context, bounds, resolution, true);
+        params.isNear = isNear;
+
+        params.grid.makeMesh (mesh, [&params](unsigned int z) { sampleLayer (params, z); });
+        return params.isCancelled () == false;
+      }
+      else
+      {
+        Parameters params (getDistances, nullptr, context, bounds, resolution);
+        params.isNear = isNear;
+
+        cullFarBricks (params);
+        context.reportProgress (0.1f);
+        sampleDistances (params);
+        context.reportProgress (0.8f);
+        return makeMesh (params, mesh);
+      }
+    }
+    return context.isCancelled () == false;
+  }
+}
+
+struct IsosurfaceExtractionContext::Impl
+{
+  Maybe<IsosurfaceExtractionGrid> _grid;
+  std::atomic<bool>               isCancelled;
+  Progress                        progress;
+
+  Impl ()
+    : isCancelled (false)
+  {
+  }
+
+  void cancel () { this->isCancelled = true; }
+
+  void resetCancellation () { this->isCancelled = false; }
+
+  void onProgress (const Progress& p) { this->progress = p; }
+
+  void reportProgress (float fraction) const
+  {
+    if (this->progress)
+    {
+      this->progress (fraction);
+    }
+  }
+
+  IsosurfaceExtractionGrid& grid (const PrimAABox& bounds, float resolution, bool slabs)
+  {
+    if (this->_grid)
+    {
+      this->_grid->reset (bounds, resolution, slabs);
+    }
+    else
+    {
+      this->_grid = Maybe<IsosurfaceExtractionGrid>::make (bounds, resolution, slabs);
     }
+    return *this->_grid;
   }
+
+  IsosurfaceExtractionGrid& grid (const glm::vec3& origin, const glm::uvec3& size, float resolution)
+  {
+    if (this->_grid)
+    {
+      this->_grid->reset (origin, size, resolution, false);
+    }
+    else
+    {
+      // the grid is reset, since there is no constructor of a lattice
+      this->_grid = Maybe<IsosurfaceExtractionGrid>::make (
+        PrimAABox (glm::vec3 (0.0f), glm::vec3 (0.0f)), resolution, false);
+      this->_grid->reset (origin, size, resolution, false);
+    }
+    return *this->_grid;
+  }
+};
+
+DELEGATE_BIG3 (IsosurfaceExtractionContext)
+DELEGATE (void, IsosurfaceExtractionContext, cancel)
+GETTER_CONST (bool, IsosurfaceExtractionContext, isCancelled)
+DELEGATE (void, IsosurfaceExtractionContext, resetCancellation)
+DELEGATE1 (void, IsosurfaceExtractionContext, onProgress,
+           const IsosurfaceExtractionContext::Progress&)
+DELEGATE1_CONST (void, IsosurfaceExtractionContext, reportProgress, float)
+DELEGATE3 (IsosurfaceExtractionGrid&, IsosurfaceExtractionContext, grid, const PrimAABox&, float,
+           bool)
+DELEGATE3 (IsosurfaceExtractionGrid&, IsosurfaceExtractionContext, grid, const glm::vec3&,
+           const glm::uvec3&, float)
+
+bool IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
+                                    float resolution, DynamicMesh& mesh,
+                                    IsosurfaceExtractionContext* context)
+{
+  return IsosurfaceExtraction::extract (
+    [&getDistance](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+      distances.resize (positions.size ());
+      for (unsigned int i = 0; i < positions.size (); i++)
+      {
+        distances[i] = getDistance (positions[i]);
+      }
+    },
+    bounds, resolution, mesh, context);
+}
+
+bool IsosurfaceExtraction::extract (const DistancesCallback& getDistances, const PrimAABox& bounds,
+                                    float resolution, DynamicMesh& mesh,
+                                    IsosurfaceExtractionContext* context)
+{
+  IsosurfaceExtractionContext localContext;
+
+  return extractDistances (getDistances, nullptr, bounds, resolution, mesh,
+                           context ? *context : localContext);
+}
+
+bool IsosurfaceExtraction::extractNarrowBand (const DistancesCallback& getDistances,
+                                              const NearCallback& isNear, const PrimAABox& bounds,
+                                              float resolution, DynamicMesh& mesh,
+                                              IsosurfaceExtractionContext* context)
+{
+  IsosurfaceExtractionContext localContext;
+
+  return extractDistances (getDistances, &isNear, bounds, resolution, mesh,
+                           context ? *context : localContext);
 }
 
-void IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
-                                    float resolution, DynamicMesh& mesh)
+void IsosurfaceExtraction::addCrossings (const PrimRay&                      ray,
+                                         const std::vector<::Intersection>& intersections,
+                                         std::vector<float>&                crossings)
 {
-  Parameters                params (getDistance, nullptr, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
+  bool inside = false;
+
+  for (const ::Intersection& intersection : intersections)
+  {
+    const bool enters = glm::dot (ray.direction (), intersection.normal ()) < 0.0f;
+
+    if (enters != inside)
+    {
+      inside = enters;
+      crossings.push_back (intersection.distance ());
+    }
+  }
+}
+
+IsosurfaceExtraction::DistancesCallback IsosurfaceExtraction::meshDistances (
+  const DynamicMesh& mesh, float resolution)
+{
+  return [&mesh, resolution](const std::vector<glm::vec3>& positions,
+                             std::vector<float>&           distances) {
+    mesh.cachedUnsignedDistances (positions, distances, resolution);
+  };
+}
+
+IsosurfaceExtraction::BoundsCallback IsosurfaceExtraction::meshBounds (const DynamicMesh& mesh)
+{
+  return [&mesh](const std::function<void(const PrimAABox&)>& f) {
+    mesh.forEachFace ([&mesh, &f](unsigned int i) {
+      const PrimTriangle face = mesh.face (i);
+      f (PrimAABox (face.minimum (), face.maximum ()));
+    });
+  };
+}
+
+bool IsosurfaceExtraction::extract (const DistancesCallback&    getDistances,
+                                    const IntersectionCallback& getIntersection,
+                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh,
+                                    IsosurfaceExtractionContext* context,
+                                    const BoundsCallback&        getBounds)
+{
+  DILAY_PROFILE_ZONE ("IsosurfaceExtraction::extract (intersections)");
+
+  IsosurfaceExtractionContext  localContext;
+  IsosurfaceExtractionContext& c = context ? *context : localContext;
+  Parameters                   params (getDistances, &getIntersection, c, bounds, resolution);
+  IsosurfaceExtractionGrid&    grid = params.grid;
 
   if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
   {
+    params.getBounds = &getBounds;
+
+    sampleIntersections (params);
+    params.context.reportProgress (0.3f);
+    markSamplePositions (params);
+    params.context.reportProgress (0.4f);
     sampleDistances (params);
-    grid.makeMesh (mesh);
+    params.context.reportProgress (0.8f);
+    return makeMesh (params, mesh);
   }
+  return params.isCancelled () == false;
 }
 
-void IsosurfaceExtraction::extract (const DistanceCallback&     getDistance,
-                                    const IntersectionCallback& getIntersection,
-                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh)
+bool IsosurfaceExtraction::extractRegion (const DistancesCallback&    getDistances,
+                                          const IntersectionCallback& getIntersection,
+                                          const PrimAABox& surfaceBounds, const PrimAABox& region,
+                                          float resolution, DynamicMesh& mesh,
+                                          IsosurfaceExtractionContext* context,
+                                          const BoundsCallback&        getBounds)
 {
-  Parameters                params (getDistance, &getIntersection, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
+  DILAY_PROFILE_ZONE ("IsosurfaceExtraction::extractRegion");
+
+  IsosurfaceExtractionContext  localContext;
+  IsosurfaceExtractionContext& c = context ? *context : localContext;
+  Parameters                   params (getDistances, &getIntersection, c, region, resolution);
+  IsosurfaceExtractionGrid&    grid = params.grid;
 
   if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
   {
+    params.isRegion = true;
+    params.getBounds = &getBounds;
+    params.rayOffset =
+      glm::max (0.0f, grid.samplePos (0, 0, 0).z - surfaceBounds.minimum ().z) + resolution;
+
     sampleIntersections (params);
+    capRegion (params);
+    params.context.reportProgress (0.3f);
     markSamplePositions (params);
+    params.context.reportProgress (0.4f);
     sampleDistances (params);
-    grid.makeMesh (mesh);
+    params.context.reportProgress (0.8f);
+    return makeMesh (params, mesh);
+  }
+  return params.isCancelled () == false;
+}
+
+glm::uvec3 IsosurfaceExtraction::numShards (const PrimAABox& bounds, float resolution,
+                                            unsigned int shardSize)
+{
+  glm::vec3  origin;
+  glm::uvec3 numSamples;
+
+  IsosurfaceExtractionGrid::lattice (bounds, resolution, origin, numSamples);
+  return (numSamples + glm::uvec3 (shardSize - 1)) / glm::uvec3 (shardSize);
+}
+
+/* A shard makes the faces of its samples, which refer to the vertices of adjacent cubes, whose
+ * number of vertices depends on their adjacent cubes in turn.  Its grid therefore extends two
+ * samples beyond its samples, so the vertices it refers to are the same in all shards.  Rays
+ * start below the extraction's grid, so the samples of all shards are classified alike.
+ */
+bool IsosurfaceExtraction::extractShard (const DistancesCallback&    getDistances,
+                                         const IntersectionCallback& getIntersection,
+                                         const PrimAABox& bounds, float resolution,
+                                         unsigned int shardSize, const glm::uvec3& index,
+                                         IsosurfaceExtractionShard&   shard,
+                                         IsosurfaceExtractionContext* context)
+{
+  DILAY_PROFILE_ZONE ("IsosurfaceExtraction::extractShard");
+
+  glm::vec3  origin;
+  glm::uvec3 numSamples;
+
+  IsosurfaceExtractionGrid::lattice (bounds, resolution, origin, numSamples);
+
+  const glm::uvec3 min = glm::min (index * shardSize, numSamples);
+  const glm::uvec3 max = glm::min (min + glm::uvec3 (shardSize), numSamples);
+  const glm::uvec3 gridMin = glm::max (min, glm::uvec3 (2)) - glm::uvec3 (2);
+  const glm::uvec3 gridMax = glm::min (max + glm::uvec3 (2), numSamples);
+
+  shard.vertices.clear ();
+  shard.vertexKeys.clear ();
+  shard.indices.clear ();
+
+  if (glm::any (glm::lessThanEqual (max, min)))
+  {
+    return true;
+  }
+
+  IsosurfaceExtractionContext  localContext;
+  IsosurfaceExtractionContext& c = context ? *context : localContext;
+  IsosurfaceExtractionGrid&    grid =
+    c.grid (origin + glm::vec3 (gridMin), gridMax - gridMin, resolution);
+  Parameters params (getDistances, &getIntersection, c, grid);
+
+  params.isShard = true;
+  params.rayOffset = resolution * float(gridMin.z);
+
+  sampleIntersections (params);
+  params.context.reportProgress (0.3f);
+  markSamplePositions (params);
+  params.context.reportProgress (0.4f);
+  sampleDistances (params);
+  params.context.reportProgress (0.8f);
+
+  if (params.isCancelled ())
+  {
+    return false;
+  }
+  params.grid.makeShard (min - gridMin, max - gridMin, gridMin, numSamples - glm::uvec3 (1),
+                         shard);
+  params.context.reportProgress (1.0f);
+  return true;
+}
+
+void IsosurfaceExtraction::anchoredShards (const PrimAABox& bounds, float resolution,
+                                           unsigned int shardSize, glm::ivec3& min,
+                                           glm::ivec3& max)
+{
+  const glm::vec3 r (resolution);
+  const glm::vec3 n (float(shardSize));
+
+  min = glm::ivec3 (glm::floor (glm::floor (bounds.minimum () / r) / n));
+  max = glm::ivec3 (glm::floor (glm::ceil (bounds.maximum () / r) / n));
+}
+
+PrimAABox IsosurfaceExtraction::anchoredShardBounds (float resolution, unsigned int shardSize,
+                                                     const glm::ivec3& index)
+{
+  const glm::vec3 min = glm::vec3 (index * int(shardSize) - glm::ivec3 (2));
+  const glm::vec3 max = min + glm::vec3 (float(shardSize + 3));
+
+  return PrimAABox (min * resolution, max * resolution);
+}
+
+/* Anchored shards are extracted like other shards (cf. `extractShard`), but their grids start at
+ * lattice coordinates and their vertices are keyed by their cubes in a lattice of
+ * `anchoredNumCubes`^3 cubes around the origin.
+ */
+bool IsosurfaceExtraction::extractAnchoredShard (const DistancesCallback& getDistances,
+                                                 const NearCallback& isNear, float resolution,
+                                                 unsigned int shardSize, const glm::ivec3& index,
+                                                 IsosurfaceExtractionShard&   shard,
+                                                 IsosurfaceExtractionContext* context)
+{
+  DILAY_PROFILE_ZONE ("IsosurfaceExtraction::extractAnchoredShard");
+
+  const glm::ivec3 gridMin = (index * int(shardSize)) - glm::ivec3 (2);
+  const glm::uvec3 gridSize (shardSize + 4);
+  const glm::uvec3 offset (gridMin + glm::ivec3 (anchoredBias));
+
+  assert (glm::all (glm::greaterThanEqual (gridMin, glm::ivec3 (-anchoredBias))));
+  assert (glm::all (glm::lessThan (offset + gridSize, glm::uvec3 (anchoredNumCubes))));
+
+  shard.vertices.clear ();
+  shard.vertexKeys.clear ();
+  shard.indices.clear ();
+
+  IsosurfaceExtractionContext  localContext;
+  IsosurfaceExtractionContext& c = context ? *context : localContext;
+  IsosurfaceExtractionGrid&    grid = c.grid (glm::vec3 (gridMin), gridSize, resolution);
+  Parameters                   params (getDistances, nullptr, c, grid);
+
+  params.isNear = &isNear;
+  params.isShard = true;
+
+  cullFarBricks (params);
+  sampleDistances (params);
+
+  if (params.isCancelled ())
+  {
+    return false;
   }
+  params.grid.makeShard (glm::uvec3 (2), glm::uvec3 (shardSize + 2), offset,
+                         glm::uvec3 (anchoredNumCubes), shard);
+  return true;
+}
+
+// vertices are ordered by their keys, i.e., by their cubes
+void IsosurfaceExtraction::stitch (const std::vector<IsosurfaceExtractionShard>& shards,
+                                   DynamicMesh&                                  mesh)
+{
+  DILAY_PROFILE_ZONE ("IsosurfaceExtraction::stitch");
+
+  std::vector<std::pair<std::uint64_t, unsigned int>> keys;
+  std::vector<unsigned int>                           firstVertexIndices;
+
+  for (const IsosurfaceExtractionShard& shard : shards)
+  {
+    assert (shard.vertexKeys.size () == shard.vertices.size ());
+
+    firstVertexIndices.push_back ((unsigned int) keys.size ());
+    for (std::uint64_t key : shard.vertexKeys)
+    {
+      keys.emplace_back (key, (unsigned int) keys.size ());
+    }
+  }
+  std::sort (keys.begin (), keys.end ());
+
+  std::vector<unsigned int> newIndices (keys.size ());
+  std::vector<glm::vec3>    vertices;
+
+  for (unsigned int i = 0; i < keys.size (); i++)
+  {
+    // the first occurrence of a key belongs to the first shard, since indices are sorted too
+    if (i == 0 || keys[i].first != keys[i - 1].first)
+    {
+      const unsigned int v = keys[i].second;
+      const unsigned int s = (unsigned int) (std::upper_bound (firstVertexIndices.begin (),
+                                                               firstVertexIndices.end (), v) -
+                                             firstVertexIndices.begin ()) -
+                             1;
+
+      vertices.push_back (shards[s].vertices[v - firstVertexIndices[s]]);
+    }
+    newIndices[keys[i].second] = (unsigned int) vertices.size () - 1;
+  }
+
+  std::vector<unsigned int> indices;
+  for (unsigned int i = 0; i < shards.size (); i++)
+  {
+    for (unsigned int index : shards[i].indices)
+    {
+      indices.push_back (newIndices[firstVertexIndices[i] + index]);
+    }
+  }
+
+  mesh.fromArrays (vertices, indices);
+  assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (nullptr, nullptr));
+  mesh.bufferData ();
+}
+
+/* Each crossed edge of the grid yields two faces.  An edge of length `r` is crossed by a plane
+ * with normal `n` at a rate of `|n.x| + |n.y| + |n.z|` per area `r^2`, which is 1.5 on average
+ * over all orientations.
+ */
+unsigned int IsosurfaceExtraction::estimateNumFaces (float area, float resolution)
+{
+  assert (resolution > 0.0f);
+
+  const double n = facesPerArea * double(area) / double(resolution * resolution);
+  return (unsigned int) (glm::min (n, double(std::numeric_limits<unsigned int>::max ())));
+}
+
+float IsosurfaceExtraction::estimateResolution (float area, unsigned int numFaces)
+{
+  assert (numFaces > 0);
+
+  return float(glm::sqrt (facesPerArea * double(area) / double(numFaces)));
+}
+
+std::size_t IsosurfaceExtraction::estimateNumBytes (unsigned int numFaces)
+{
+  return std::size_t (numFaces) * bytesPerFace;
 }
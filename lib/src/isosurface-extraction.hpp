@@ -5,29 +5,126 @@
 #ifndef DILAY_ISOSURFACE_EXTRACTION
 #define DILAY_ISOSURFACE_EXTRACTION
 
+#include <cstddef>
 #include <functional>
 #include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
 
 class DynamicMesh;
 class Intersection;
+class IsosurfaceExtractionGrid;
+struct IsosurfaceExtractionShard;
 class PrimAABox;
 class PrimRay;
 
+/* Retains the buffers of extractions, so that repeated extractions of similar sizes reuse them.
+ * Extractions with a context can be cancelled and report their progress.  A context must not be
+ * used by several extractions at once.
+ */
+class IsosurfaceExtractionContext
+{
+public:
+  // the completed fraction of an extraction in [0, 1]
+  typedef std::function<void(float)> Progress;
+
+  DECLARE_BIG3 (IsosurfaceExtractionContext)
+
+  // may be called from any thread: the running (or next) extraction stops early
+  void cancel ();
+  bool isCancelled () const;
+  void resetCancellation ();
+
+  // called by the extracting thread
+  void onProgress (const Progress&);
+  void reportProgress (float) const;
+
+  IsosurfaceExtractionGrid& grid (const PrimAABox&, float, bool);
+  IsosurfaceExtractionGrid& grid (const glm::vec3&, const glm::uvec3&, float);
+
+private:
+  IMPLEMENTATION
+};
+
 namespace IsosurfaceExtraction
 {
-  enum class Intersection
-  {
-    None,
-    Sample,
-    Continue
-  };
-
-  typedef std::function<float(const glm::vec3&)>                        DistanceCallback;
-  typedef std::function<Intersection (const PrimRay&, ::Intersection&)> IntersectionCallback;
-
-  void extract (const DistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
-                DynamicMesh&);
-  void extract (const DistanceCallback&, const PrimAABox&, float, DynamicMesh&);
+  typedef std::function<float(const glm::vec3&)> DistanceCallback;
+
+  // computes the distances of neighboring positions at once
+  typedef std::function<void(const std::vector<glm::vec3>&, std::vector<float>&)>
+    DistancesCallback;
+
+  // appends the sorted distances at which a ray enters or leaves the surface
+  typedef std::function<void(const PrimRay&, std::vector<float>&)> IntersectionCallback;
+
+  // returns false if the surface does not come near a box
+  typedef std::function<bool(const PrimAABox&)> NearCallback;
+
+  // calls the given function with boxes that enclose the surface, e.g., the bounds of its faces
+  typedef std::function<void(const std::function<void(const PrimAABox&)>&)> BoundsCallback;
+
+  // appends the distances at which a ray enters or leaves a closed surface, given all its sorted
+  // intersections with the surface
+  void addCrossings (const PrimRay&, const std::vector<::Intersection>&, std::vector<float>&);
+
+  // the unsigned distances to a mesh at the samples of the given resolution, which are cached
+  // by the mesh if enabled
+  DistancesCallback meshDistances (const DynamicMesh&, float);
+  // the bounds of the faces of a mesh
+  BoundsCallback meshBounds (const DynamicMesh&);
+
+  /* All extractions return false if they are cancelled by their context, which leaves the mesh
+   * empty or incomplete.  Extractions with intersections only cast rays along the columns of the
+   * grid that are enclosed by the boxes of a bounds callback, if one is given.
+   */
+  bool extract (const DistancesCallback&, const IntersectionCallback&, const PrimAABox&, float,
+                DynamicMesh&, IsosurfaceExtractionContext* = nullptr,
+                const BoundsCallback& = nullptr);
+  // the distance callback must not overestimate distances (cf. narrow band culling)
+  bool extract (const DistanceCallback&, const PrimAABox&, float, DynamicMesh&,
+                IsosurfaceExtractionContext* = nullptr);
+  bool extract (const DistancesCallback&, const PrimAABox&, float, DynamicMesh&,
+                IsosurfaceExtractionContext* = nullptr);
+  // only samples the distances of bricks that are near the surface
+  bool extractNarrowBand (const DistancesCallback&, const NearCallback&, const PrimAABox&, float,
+                          DynamicMesh&, IsosurfaceExtractionContext* = nullptr);
+  // extracts the part of a surface (with the given bounds) that lies within a region: the
+  // resulting mesh is closed along the region's bounds
+  bool extractRegion (const DistancesCallback&, const IntersectionCallback&, const PrimAABox&,
+                      const PrimAABox&, float, DynamicMesh&,
+                      IsosurfaceExtractionContext* = nullptr, const BoundsCallback& = nullptr);
+
+  /* Sharded extractions split the grid of an extraction (with the given bounds and resolution)
+   * into boxes of `n`^3 samples, which are extracted independently, e.g., by several processes,
+   * and stitched afterwards.
+   */
+  glm::uvec3 numShards (const PrimAABox&, float, unsigned int);
+  // extracts the shard of the given (three-dimensional) index
+  bool extractShard (const DistancesCallback&, const IntersectionCallback&, const PrimAABox&,
+                     float, unsigned int, const glm::uvec3&, IsosurfaceExtractionShard&,
+                     IsosurfaceExtractionContext* = nullptr);
+  /* Anchored shards split the unbounded lattice of a resolution into boxes of `n`^3 samples, so
+   * the shards of a surface keep their indices and the keys of their vertices when its bounds
+   * change, e.g., to reextract only the shards of a changed part of the surface.
+   */
+  // the (inclusive) range of the indices of the anchored shards that cover the given bounds
+  void anchoredShards (const PrimAABox&, float, unsigned int, glm::ivec3&, glm::ivec3&);
+  // the box of all samples that the extraction of an anchored shard depends on
+  PrimAABox anchoredShardBounds (float, unsigned int, const glm::ivec3&);
+  // only samples the distances of bricks that are near the surface (cf. `extractNarrowBand`)
+  bool extractAnchoredShard (const DistancesCallback&, const NearCallback&, float, unsigned int,
+                             const glm::ivec3&, IsosurfaceExtractionShard&,
+                             IsosurfaceExtractionContext* = nullptr);
+  // shared vertices are taken from the first shard that contains them
+  void stitch (const std::vector<IsosurfaceExtractionShard>&, DynamicMesh&);
+
+  /* Estimates of the extraction of a surface with the given area, e.g., to warn about huge
+   * meshes before they are extracted.  `estimateResolution` solves for a number of faces.
+   */
+  unsigned int estimateNumFaces (float, float);
+  float        estimateResolution (float, unsigned int);
+  // the memory of an extracted mesh (including its buffers) in bytes
+  std::size_t  estimateNumBytes (unsigned int);
 };
 
 #endif
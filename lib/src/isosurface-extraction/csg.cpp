@@ -0,0 +1,223 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction/csg.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // a lower bound of the distance between a position and the surface within a box
+  float distanceToBox (const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& p)
+  {
+    return glm::distance (p, glm::clamp (p, minimum, maximum));
+  }
+}
+
+struct IsosurfaceExtractionCsg::Impl
+{
+  const Operation                       operation;
+  const std::vector<const DynamicMesh*> operands;
+  const float                           resolution;
+  std::vector<glm::vec3>                minima;
+  std::vector<glm::vec3>                maxima;
+
+  Impl (Operation o, const std::vector<const DynamicMesh*>& ops, float r)
+    : operation (o)
+    , operands (ops)
+    , resolution (r)
+  {
+    assert (this->operands.empty () == false);
+
+    for (const DynamicMesh* operand : this->operands)
+    {
+      const PrimAABox b = operand->mesh ().bounds ();
+
+      this->minima.push_back (b.minimum ());
+      this->maxima.push_back (b.maximum ());
+    }
+  }
+
+  PrimAABox bounds () const
+  {
+    glm::vec3 min = this->minima[0];
+    glm::vec3 max = this->maxima[0];
+
+    // a difference lies within its first operand
+    if (this->operation != Operation::Difference)
+    {
+      for (unsigned int i = 1; i < this->operands.size (); i++)
+      {
+        if (this->operation == Operation::Union)
+        {
+          min = glm::min (min, this->minima[i]);
+          max = glm::max (max, this->maxima[i]);
+        }
+        else
+        {
+          min = glm::max (min, this->minima[i]);
+          max = glm::min (max, this->maxima[i]);
+        }
+      }
+    }
+    return PrimAABox (min, glm::max (min, max));
+  }
+
+  bool isInside (const std::vector<bool>& inside) const
+  {
+    switch (this->operation)
+    {
+      case Operation::Union:
+        return std::find (inside.begin (), inside.end (), true) != inside.end ();
+      case Operation::Intersection:
+        return std::find (inside.begin (), inside.end (), false) == inside.end ();
+      case Operation::Difference:
+        return inside[0] && std::find (inside.begin () + 1, inside.end (), true) == inside.end ();
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  /* A ray that misses the first operand of a difference, or any operand of an intersection, never
+   * enters the result, so the remaining operands are not intersected.  The intersections of all
+   * operands are merged by their distances.
+   */
+  void crossings (const PrimRay& ray, std::vector<float>& crossings) const
+  {
+    const unsigned int                     n = this->operands.size ();
+    std::vector<std::vector<Intersection>> intersections (n);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      this->operands[i]->intersects (ray, intersections[i], true);
+
+      if (intersections[i].empty () &&
+          (this->operation == Operation::Intersection ||
+           (this->operation == Operation::Difference && i == 0)))
+      {
+        return;
+      }
+    }
+
+    std::vector<unsigned int> next (n, 0);
+    std::vector<bool>         inside (n, false);
+    bool                      isInside = false;
+
+    while (true)
+    {
+      unsigned int nearest = Util::invalidIndex ();
+
+      for (unsigned int i = 0; i < n; i++)
+      {
+        if (next[i] < intersections[i].size () &&
+            (nearest == Util::invalidIndex () ||
+             intersections[i][next[i]].distance () <
+               intersections[nearest][next[nearest]].distance ()))
+        {
+          nearest = i;
+        }
+      }
+
+      if (nearest == Util::invalidIndex ())
+      {
+        return;
+      }
+
+      const Intersection& intersection = intersections[nearest][next[nearest]++];
+      inside[nearest] = glm::dot (ray.direction (), intersection.normal ()) < 0.0f;
+
+      if (this->isInside (inside) != isInside)
+      {
+        isInside = not isInside;
+        crossings.push_back (intersection.distance ());
+      }
+    }
+  }
+
+  /* The distance of a position is the minimal distance to all operands.  Operands are visited by
+   * the distance of their bounds to the center of the positions, and the distance to an operand is
+   * only computed for positions whose minimal distance so far exceeds the distance to its bounds.
+   */
+  void distances (const std::vector<glm::vec3>& positions, std::vector<float>& distances) const
+  {
+    const unsigned int n = this->operands.size ();
+    glm::vec3          center (0.0f);
+
+    for (const glm::vec3& p : positions)
+    {
+      center += p;
+    }
+    center /= float(glm::max (std::size_t (1), positions.size ()));
+
+    std::vector<unsigned int> order (n);
+    std::vector<float>        boxDistances (n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+      order[i] = i;
+      boxDistances[i] = distanceToBox (this->minima[i], this->maxima[i], center);
+    }
+    std::stable_sort (order.begin (), order.end (), [&boxDistances](unsigned int a, unsigned int b) {
+      return boxDistances[a] < boxDistances[b];
+    });
+
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3>    subPositions;
+    std::vector<float>        subDistances;
+
+    distances.assign (positions.size (), Util::maxFloat ());
+    for (unsigned int i : order)
+    {
+      indices.clear ();
+      subPositions.clear ();
+
+      for (unsigned int j = 0; j < positions.size (); j++)
+      {
+        if (distanceToBox (this->minima[i], this->maxima[i], positions[j]) < distances[j])
+        {
+          indices.push_back (j);
+          subPositions.push_back (positions[j]);
+        }
+      }
+
+      if (subPositions.empty () == false)
+      {
+        this->operands[i]->cachedUnsignedDistances (subPositions, subDistances, this->resolution);
+        assert (subDistances.size () == subPositions.size ());
+
+        for (unsigned int j = 0; j < indices.size (); j++)
+        {
+          distances[indices[j]] = glm::min (distances[indices[j]], subDistances[j]);
+        }
+      }
+    }
+  }
+
+  IsosurfaceExtraction::IntersectionCallback intersectionCallback () const
+  {
+    return [this](const PrimRay& ray, std::vector<float>& crossings) {
+      this->crossings (ray, crossings);
+    };
+  }
+
+  IsosurfaceExtraction::DistancesCallback distancesCallback () const
+  {
+    return [this](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+      this->distances (positions, distances);
+    };
+  }
+};
+
+DELEGATE3_BIG3 (IsosurfaceExtractionCsg, IsosurfaceExtractionCsg::Operation,
+                const std::vector<const DynamicMesh*>&, float)
+DELEGATE_CONST (PrimAABox, IsosurfaceExtractionCsg, bounds)
+DELEGATE_CONST (IsosurfaceExtraction::IntersectionCallback, IsosurfaceExtractionCsg,
+                intersectionCallback)
+DELEGATE_CONST (IsosurfaceExtraction::DistancesCallback, IsosurfaceExtractionCsg,
+                distancesCallback)
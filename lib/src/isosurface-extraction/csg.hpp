@@ -0,0 +1,41 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_ISOSURFACE_EXTRACTION_CSG
+#define DILAY_ISOSURFACE_EXTRACTION_CSG
+
+#include <vector>
+#include "isosurface-extraction.hpp"
+#include "macro.hpp"
+
+class DynamicMesh;
+class PrimAABox;
+
+/* Evaluates a boolean operation of closed meshes for isosurface extraction.  The first operand
+ * is combined with all others, i.e., a difference subtracts all other operands from the first.
+ * The operands must outlive the callbacks.
+ */
+class IsosurfaceExtractionCsg
+{
+public:
+  enum class Operation
+  {
+    Union,
+    Intersection,
+    Difference
+  };
+
+  DECLARE_BIG3 (IsosurfaceExtractionCsg, Operation, const std::vector<const DynamicMesh*>&, float)
+
+  // the bounds of the result, which are smaller than the bounds of all operands if possible
+  PrimAABox bounds () const;
+
+  IsosurfaceExtraction::IntersectionCallback intersectionCallback () const;
+  IsosurfaceExtraction::DistancesCallback    distancesCallback () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
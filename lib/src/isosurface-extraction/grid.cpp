@@ -2,12 +2,16 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
-#include <array>
+#include <algorithm>
+#include <numeric>
 #include <glm/gtx/norm.hpp>
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction/grid.hpp"
+#include "isosurface-extraction/shard.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
+#include "profile.hpp"
 #include "util.hpp"
 
 /* vertex layout:          edge layout:          face layout:
@@ -26,323 +30,224 @@
  */
 namespace
 {
-  static const glm::vec3 invalidVec3 = glm::vec3 (Util::minFloat ());
-
-  static bool nonManifoldConfig[256] = {
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, true,  true,  false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    true,  false, false, true,  false, false, false, false, false, false, false, false, true,
-    false, false, false, false, false, false, true,  true,  false, false, false, false, false,
-    false, true,  false, false, false, true,  true,  true,  true,  false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, false,
-    false, false, false, false, false, false, false, false, false, false, false, false, true,
-    false, true,  false, true,  false, false, false, false, false, false, false, true,  false,
-    false, false, false, false, true,  false, false, false, false, false, false, false, true,
-    false, true,  false, true,  false, false, true,  false, true,  false, false, false, false,
-    false, false, false, false, true,  false, false, false, true,  false, false, false, false,
-    false, false, false, true,  false, false, false, true,  false, true,  true,  false, false,
-    false, true,  false, false, false, false, true,  false, true,  true,  false, false, false,
-    false, true,  false, true,  false, false, false, false, false, false, false, false, true,
-    false, false, true,  false, false, false, false, false, false};
-
-  static char vertexIndicesByConfiguration[256][12] = {
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {0, -1, -1, -1, 0, 0, -1, -1, -1, -1, -1, -1},
-    {-1, 0, 0, -1, 0, 0, -1, -1, -1, -1, -1, -1},
-    {-1, 0, -1, 0, -1, -1, -1, -1, 0, -1, -1, -1},
-    {0, -1, 0, 0, -1, -1, -1, -1, 0, -1, -1, -1},
-    {0, 1, -1, 1, 0, 0, -1, -1, 1, -1, -1, -1},
-    {-1, -1, 0, 0, 0, 0, -1, -1, 0, -1, -1, -1},
-    {-1, -1, -1, 0, 0, -1, -1, -1, -1, -1, -1, 0},
-    {0, 0, 0, 1, 1, -1, -1, -1, -1, -1, -1, 1},
-    {0, -1, -1, 0, -1, 0, -1, -1, -1, -1, -1, 0},
-    {-1, 0, 0, 0, -1, 0, -1, -1, -1, -1, -1, 0},
-    {-1, 0, -1, -1, 0, -1, -1, -1, 0, -1, -1, 0},
-    {0, -1, 0, -1, 0, -1, -1, -1, 0, -1, -1, 0},
-    {0, 0, -1, -1, -1, 0, -1, -1, 0, -1, -1, 0},
-    {-1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0},
-    {-1, -1, 0, -1, -1, -1, 0, 0, -1, -1, -1, -1},
-    {0, 0, -1, -1, -1, -1, 0, 0, -1, -1, -1, -1},
-    {0, -1, 1, -1, 0, 0, 1, 1, -1, -1, -1, -1},
-    {-1, 0, -1, -1, 0, 0, 0, 0, -1, -1, -1, -1},
-    {-1, 1, 0, 1, -1, -1, 0, 0, 1, -1, -1, -1},
-    {0, -1, -1, 0, -1, -1, 0, 0, 0, -1, -1, -1},
-    {2, 0, 1, 0, 2, 2, 1, 1, 0, -1, -1, -1},
-    {-1, -1, -1, 0, 0, 0, 0, 0, 0, -1, -1, -1},
-    {-1, -1, 0, 1, 1, -1, 0, 0, -1, -1, -1, 1},
-    {0, 0, -1, 1, 1, -1, 0, 0, -1, -1, -1, 1},
-    {0, -1, 1, 0, -1, 0, 1, 1, -1, -1, -1, 0},
-    {-1, 0, -1, 0, -1, 0, 0, 0, -1, -1, -1, 0},
-    {-1, 0, 1, -1, 0, -1, 1, 1, 0, -1, -1, 0},
-    {0, -1, -1, -1, 0, -1, 0, 0, 0, -1, -1, 0},
-    {1, 1, 0, -1, -1, 1, 0, 0, 1, -1, -1, 1},
-    {-1, -1, -1, -1, -1, 0, 0, 0, 0, -1, -1, 0},
-    {-1, -1, -1, -1, -1, 0, 0, -1, -1, -1, 0, -1},
-    {0, 0, 0, -1, -1, 1, 1, -1, -1, -1, 1, -1},
-    {0, -1, -1, -1, 0, -1, 0, -1, -1, -1, 0, -1},
-    {-1, 0, 0, -1, 0, -1, 0, -1, -1, -1, 0, -1},
-    {-1, 1, -1, 1, -1, 0, 0, -1, 1, -1, 0, -1},
-    {0, -1, 0, 0, -1, 1, 1, -1, 0, -1, 1, -1},
-    {0, 1, -1, 1, 0, -1, 0, -1, 1, -1, 0, -1},
-    {-1, -1, 0, 0, 0, -1, 0, -1, 0, -1, 0, -1},
-    {-1, -1, -1, 1, 1, 0, 0, -1, -1, -1, 0, 1},
-    {1, 1, 1, 0, 0, 2, 2, -1, -1, -1, 2, 0},
-    {0, -1, -1, 0, -1, -1, 0, -1, -1, -1, 0, 0},
-    {-1, 0, 0, 0, -1, -1, 0, -1, -1, -1, 0, 0},
-    {-1, 0, -1, -1, 0, 1, 1, -1, 0, -1, 1, 0},
-    {1, -1, 1, -1, 1, 0, 0, -1, 1, -1, 0, 1},
-    {0, 0, -1, -1, -1, -1, 0, -1, 0, -1, 0, 0},
-    {-1, -1, 0, -1, -1, -1, 0, -1, 0, -1, 0, 0},
-    {-1, -1, 0, -1, -1, 0, -1, 0, -1, -1, 0, -1},
-    {0, 0, -1, -1, -1, 0, -1, 0, -1, -1, 0, -1},
-    {0, -1, 0, -1, 0, -1, -1, 0, -1, -1, 0, -1},
-    {-1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1},
-    {-1, 1, 0, 1, -1, 0, -1, 0, 1, -1, 0, -1},
-    {0, -1, -1, 0, -1, 0, -1, 0, 0, -1, 0, -1},
-    {1, 0, 1, 0, 1, -1, -1, 1, 0, -1, 1, -1},
-    {-1, -1, -1, 0, 0, -1, -1, 0, 0, -1, 0, -1},
-    {-1, -1, 0, 1, 1, 0, -1, 0, -1, -1, 0, 1},
-    {1, 1, -1, 0, 0, 1, -1, 1, -1, -1, 1, 0},
-    {0, -1, 0, 0, -1, -1, -1, 0, -1, -1, 0, 0},
-    {-1, 0, -1, 0, -1, -1, -1, 0, -1, -1, 0, 0},
-    {-1, 1, 0, -1, 1, 0, -1, 0, 1, -1, 0, 1},
-    {1, -1, -1, -1, 1, 1, -1, 0, 0, -1, 0, 0},
-    {1, 1, 1, -1, -1, -1, -1, 0, 0, -1, 0, 0},
-    {-1, -1, -1, -1, -1, -1, -1, 0, 0, -1, 0, 0},
-    {-1, -1, -1, -1, -1, -1, -1, 0, 0, 0, -1, -1},
-    {0, 0, 0, -1, -1, -1, -1, 1, 1, 1, -1, -1},
-    {1, -1, -1, -1, 1, 1, -1, 0, 0, 0, -1, -1},
-    {-1, 0, 0, -1, 0, 0, -1, 1, 1, 1, -1, -1},
-    {-1, 0, -1, 0, -1, -1, -1, 0, -1, 0, -1, -1},
-    {0, -1, 0, 0, -1, -1, -1, 0, -1, 0, -1, -1},
-    {1, 0, -1, 0, 1, 1, -1, 0, -1, 0, -1, -1},
-    {-1, -1, 0, 0, 0, 0, -1, 0, -1, 0, -1, -1},
-    {-1, -1, -1, 0, 0, -1, -1, 1, 1, 1, -1, 0},
-    {2, 2, 2, 0, 0, -1, -1, 1, 1, 1, -1, 0},
-    {0, -1, -1, 0, -1, 0, -1, 1, 1, 1, -1, 0},
-    {-1, 1, 1, 1, -1, 1, -1, 0, 0, 0, -1, 1},
-    {-1, 0, -1, -1, 0, -1, -1, 0, -1, 0, -1, 0},
-    {0, -1, 0, -1, 0, -1, -1, 0, -1, 0, -1, 0},
-    {0, 0, -1, -1, -1, 0, -1, 0, -1, 0, -1, 0},
-    {-1, -1, 0, -1, -1, 0, -1, 0, -1, 0, -1, 0},
-    {-1, -1, 0, -1, -1, -1, 0, -1, 0, 0, -1, -1},
-    {0, 0, -1, -1, -1, -1, 0, -1, 0, 0, -1, -1},
-    {1, -1, 0, -1, 1, 1, 0, -1, 0, 0, -1, -1},
-    {-1, 0, -1, -1, 0, 0, 0, -1, 0, 0, -1, -1},
-    {-1, 0, 0, 0, -1, -1, 0, -1, -1, 0, -1, -1},
-    {0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1},
-    {0, 1, 1, 1, 0, 0, 1, -1, -1, 1, -1, -1},
-    {-1, -1, -1, 0, 0, 0, 0, -1, -1, 0, -1, -1},
-    {-1, -1, 0, 1, 1, -1, 0, -1, 0, 0, -1, 1},
-    {1, 1, -1, 0, 0, -1, 1, -1, 1, 1, -1, 0},
-    {1, -1, 0, 1, -1, 1, 0, -1, 0, 0, -1, 1},
-    {-1, 1, -1, 1, -1, 0, 0, -1, 1, 0, -1, 0},
-    {-1, 0, 0, -1, 0, -1, 0, -1, -1, 0, -1, 0},
-    {0, -1, -1, -1, 0, -1, 0, -1, -1, 0, -1, 0},
-    {1, 1, 1, -1, -1, 0, 0, -1, -1, 0, -1, 0},
-    {-1, -1, -1, -1, -1, 0, 0, -1, -1, 0, -1, 0},
-    {-1, -1, -1, -1, -1, 0, 0, 1, 1, 1, 0, -1},
-    {1, 1, 1, -1, -1, 0, 0, 2, 2, 2, 0, -1},
-    {0, -1, -1, -1, 0, -1, 0, 1, 1, 1, 0, -1},
-    {-1, 1, 1, -1, 1, -1, 1, 0, 0, 0, 1, -1},
-    {-1, 0, -1, 0, -1, 1, 1, 0, -1, 0, 1, -1},
-    {1, -1, 1, 1, -1, 0, 0, 1, -1, 1, 0, -1},
-    {0, 1, -1, 1, 0, -1, 0, 1, -1, 1, 0, -1},
-    {-1, -1, 1, 0, 0, -1, 1, 1, -1, 0, 0, -1},
-    {-1, -1, -1, 1, 1, 2, 2, 0, 0, 0, 2, 1},
-    {2, 2, 2, 3, 3, 0, 0, 1, 1, 1, 0, 3},
-    {1, -1, -1, 1, -1, -1, 1, 0, 0, 0, 1, 1},
-    {-1, 0, 0, 0, -1, -1, 0, 1, 1, 1, 0, 0},
-    {-1, 1, -1, -1, 1, 0, 0, 1, -1, 1, 0, 1},
-    {0, -1, 0, -1, 0, 1, 1, 0, -1, 0, 1, 0},
-    {0, 0, -1, -1, -1, -1, 0, 0, -1, 1, 1, 1},
-    {-1, -1, 0, -1, -1, -1, 0, 0, -1, 1, 1, 1},
-    {-1, -1, 0, -1, -1, 0, -1, -1, 0, 0, 0, -1},
-    {0, 0, -1, -1, -1, 0, -1, -1, 0, 0, 0, -1},
-    {0, -1, 0, -1, 0, -1, -1, -1, 0, 0, 0, -1},
-    {-1, 0, -1, -1, 0, -1, -1, -1, 0, 0, 0, -1},
-    {-1, 0, 0, 0, -1, 0, -1, -1, -1, 0, 0, -1},
-    {0, -1, -1, 0, -1, 0, -1, -1, -1, 0, 0, -1},
-    {1, 1, 1, 0, 0, -1, -1, -1, -1, 0, 0, -1},
-    {-1, -1, -1, 0, 0, -1, -1, -1, -1, 0, 0, -1},
-    {-1, -1, 1, 0, 0, 1, -1, -1, 1, 1, 1, 0},
-    {0, 0, -1, 1, 1, 0, -1, -1, 0, 0, 0, 1},
-    {0, -1, 0, 0, -1, -1, -1, -1, 0, 1, 1, 1},
-    {-1, 0, -1, 0, -1, -1, -1, -1, 0, 1, 1, 1},
-    {-1, 0, 0, -1, 0, 0, -1, -1, -1, 1, 1, 1},
-    {0, -1, -1, -1, 0, 0, -1, -1, -1, 1, 1, 1},
-    {1, 1, 1, -1, -1, -1, -1, -1, -1, 0, 0, 0},
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0},
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0},
-    {1, 1, 1, -1, -1, -1, -1, -1, -1, 0, 0, 0},
-    {0, -1, -1, -1, 0, 0, -1, -1, -1, 1, 1, 1},
-    {-1, 0, 0, -1, 0, 0, -1, -1, -1, 1, 1, 1},
-    {-1, 0, -1, 0, -1, -1, -1, -1, 0, 1, 1, 1},
-    {0, -1, 0, 0, -1, -1, -1, -1, 0, 1, 1, 1},
-    {2, 1, -1, 1, 2, 2, -1, -1, 1, 0, 0, 0},
-    {-1, -1, 1, 1, 1, 1, -1, -1, 1, 0, 0, 0},
-    {-1, -1, -1, 0, 0, -1, -1, -1, -1, 0, 0, -1},
-    {1, 1, 1, 0, 0, -1, -1, -1, -1, 0, 0, -1},
-    {0, -1, -1, 0, -1, 0, -1, -1, -1, 0, 0, -1},
-    {-1, 0, 0, 0, -1, 0, -1, -1, -1, 0, 0, -1},
-    {-1, 0, -1, -1, 0, -1, -1, -1, 0, 0, 0, -1},
-    {0, -1, 0, -1, 0, -1, -1, -1, 0, 0, 0, -1},
-    {0, 0, -1, -1, -1, 0, -1, -1, 0, 0, 0, -1},
-    {-1, -1, 0, -1, -1, 0, -1, -1, 0, 0, 0, -1},
-    {-1, -1, 0, -1, -1, -1, 0, 0, -1, 1, 1, 1},
-    {0, 0, -1, -1, -1, -1, 0, 0, -1, 1, 1, 1},
-    {1, -1, 2, -1, 1, 1, 2, 2, -1, 0, 0, 0},
-    {-1, 1, -1, -1, 1, 1, 1, 1, -1, 0, 0, 0},
-    {-1, 1, 0, 1, -1, -1, 0, 0, 1, 2, 2, 2},
-    {1, -1, -1, 1, -1, -1, 1, 1, 1, 0, 0, 0},
-    {3, 2, 0, 2, 3, 3, 0, 0, 2, 1, 1, 1},
-    {-1, -1, -1, 0, 0, 0, 0, 0, 0, 1, 1, 1},
-    {-1, -1, 1, 0, 0, -1, 1, 1, -1, 0, 0, -1},
-    {1, 1, -1, 0, 0, -1, 1, 1, -1, 0, 0, -1},
-    {1, -1, 0, 1, -1, 1, 0, 0, -1, 1, 1, -1},
-    {-1, 0, -1, 0, -1, 1, 1, 0, -1, 0, 1, -1},
-    {-1, 1, 0, -1, 1, -1, 0, 0, 1, 1, 1, -1},
-    {0, -1, -1, -1, 0, -1, 0, 1, 1, 1, 0, -1},
-    {0, 0, 1, -1, -1, 0, 1, 1, 0, 0, 0, -1},
-    {-1, -1, -1, -1, -1, 0, 0, 1, 1, 1, 0, -1},
-    {-1, -1, -1, -1, -1, 0, 0, -1, -1, 0, -1, 0},
-    {1, 1, 1, -1, -1, 0, 0, -1, -1, 0, -1, 0},
-    {0, -1, -1, -1, 0, -1, 0, -1, -1, 0, -1, 0},
-    {-1, 0, 0, -1, 0, -1, 0, -1, -1, 0, -1, 0},
-    {-1, 1, -1, 1, -1, 0, 0, -1, 1, 0, -1, 0},
-    {1, -1, 1, 1, -1, 0, 0, -1, 1, 0, -1, 0},
-    {1, 0, -1, 0, 1, -1, 1, -1, 0, 1, -1, 1},
-    {-1, -1, 0, 1, 1, -1, 0, -1, 0, 0, -1, 1},
-    {-1, -1, -1, 0, 0, 0, 0, -1, -1, 0, -1, -1},
-    {0, 0, 0, 1, 1, 1, 1, -1, -1, 1, -1, -1},
-    {0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1},
-    {-1, 0, 0, 0, -1, -1, 0, -1, -1, 0, -1, -1},
-    {-1, 0, -1, -1, 0, 0, 0, -1, 0, 0, -1, -1},
-    {1, -1, 0, -1, 1, 1, 0, -1, 0, 0, -1, -1},
-    {0, 0, -1, -1, -1, -1, 0, -1, 0, 0, -1, -1},
-    {-1, -1, 0, -1, -1, -1, 0, -1, 0, 0, -1, -1},
-    {-1, -1, 0, -1, -1, 0, -1, 0, -1, 0, -1, 0},
-    {0, 0, -1, -1, -1, 0, -1, 0, -1, 0, -1, 0},
-    {0, -1, 0, -1, 0, -1, -1, 0, -1, 0, -1, 0},
-    {-1, 0, -1, -1, 0, -1, -1, 0, -1, 0, -1, 0},
-    {-1, 0, 1, 0, -1, 1, -1, 1, 0, 1, -1, 1},
-    {0, -1, -1, 0, -1, 0, -1, 1, 1, 1, -1, 0},
-    {0, 1, 0, 1, 0, -1, -1, 0, 1, 0, -1, 0},
-    {-1, -1, -1, 0, 0, -1, -1, 1, 1, 1, -1, 0},
-    {-1, -1, 0, 0, 0, 0, -1, 0, -1, 0, -1, -1},
-    {1, 0, -1, 0, 1, 1, -1, 0, -1, 0, -1, -1},
-    {0, -1, 0, 0, -1, -1, -1, 0, -1, 0, -1, -1},
-    {-1, 0, -1, 0, -1, -1, -1, 0, -1, 0, -1, -1},
-    {-1, 0, 0, -1, 0, 0, -1, 1, 1, 1, -1, -1},
-    {1, -1, -1, -1, 1, 1, -1, 0, 0, 0, -1, -1},
-    {0, 0, 0, -1, -1, -1, -1, 1, 1, 1, -1, -1},
-    {-1, -1, -1, -1, -1, -1, -1, 0, 0, 0, -1, -1},
-    {-1, -1, -1, -1, -1, -1, -1, 0, 0, -1, 0, 0},
-    {1, 1, 1, -1, -1, -1, -1, 0, 0, -1, 0, 0},
-    {1, -1, -1, -1, 1, 1, -1, 0, 0, -1, 0, 0},
-    {-1, 1, 1, -1, 1, 1, -1, 0, 0, -1, 0, 0},
-    {-1, 0, -1, 0, -1, -1, -1, 0, -1, -1, 0, 0},
-    {0, -1, 0, 0, -1, -1, -1, 0, -1, -1, 0, 0},
-    {0, 1, -1, 1, 0, 0, -1, 1, -1, -1, 1, 1},
-    {-1, -1, 0, 1, 1, 0, -1, 0, -1, -1, 0, 1},
-    {-1, -1, -1, 0, 0, -1, -1, 0, 0, -1, 0, -1},
-    {0, 0, 0, 1, 1, -1, -1, 1, 1, -1, 1, -1},
-    {0, -1, -1, 0, -1, 0, -1, 0, 0, -1, 0, -1},
-    {-1, 1, 0, 1, -1, 0, -1, 0, 1, -1, 0, -1},
-    {-1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1},
-    {0, -1, 0, -1, 0, -1, -1, 0, -1, -1, 0, -1},
-    {0, 0, -1, -1, -1, 0, -1, 0, -1, -1, 0, -1},
-    {-1, -1, 0, -1, -1, 0, -1, 0, -1, -1, 0, -1},
-    {-1, -1, 0, -1, -1, -1, 0, -1, 0, -1, 0, 0},
-    {0, 0, -1, -1, -1, -1, 0, -1, 0, -1, 0, 0},
-    {0, -1, 1, -1, 0, 0, 1, -1, 1, -1, 1, 1},
-    {-1, 0, -1, -1, 0, 1, 1, -1, 0, -1, 1, 0},
-    {-1, 0, 0, 0, -1, -1, 0, -1, -1, -1, 0, 0},
-    {0, -1, -1, 0, -1, -1, 0, -1, -1, -1, 0, 0},
-    {1, 0, 0, 0, 1, 1, 0, -1, -1, -1, 0, 0},
-    {-1, -1, -1, 1, 1, 0, 0, -1, -1, -1, 0, 1},
-    {-1, -1, 0, 0, 0, -1, 0, -1, 0, -1, 0, -1},
-    {0, 1, -1, 1, 0, -1, 0, -1, 1, -1, 0, -1},
-    {0, -1, 0, 0, -1, 1, 1, -1, 0, -1, 1, -1},
-    {-1, 1, -1, 1, -1, 0, 0, -1, 1, -1, 0, -1},
-    {-1, 0, 0, -1, 0, -1, 0, -1, -1, -1, 0, -1},
-    {0, -1, -1, -1, 0, -1, 0, -1, -1, -1, 0, -1},
-    {0, 0, 0, -1, -1, 1, 1, -1, -1, -1, 1, -1},
-    {-1, -1, -1, -1, -1, 0, 0, -1, -1, -1, 0, -1},
-    {-1, -1, -1, -1, -1, 0, 0, 0, 0, -1, -1, 0},
-    {0, 0, 0, -1, -1, 1, 1, 1, 1, -1, -1, 1},
-    {0, -1, -1, -1, 0, -1, 0, 0, 0, -1, -1, 0},
-    {-1, 0, 1, -1, 0, -1, 1, 1, 0, -1, -1, 0},
-    {-1, 0, -1, 0, -1, 0, 0, 0, -1, -1, -1, 0},
-    {0, -1, 1, 0, -1, 0, 1, 1, -1, -1, -1, 0},
-    {0, 0, -1, 1, 1, -1, 0, 0, -1, -1, -1, 1},
-    {-1, -1, 0, 1, 1, -1, 0, 0, -1, -1, -1, 1},
-    {-1, -1, -1, 0, 0, 0, 0, 0, 0, -1, -1, -1},
-    {1, 1, 1, 0, 0, 0, 0, 0, 0, -1, -1, -1},
-    {0, -1, -1, 0, -1, -1, 0, 0, 0, -1, -1, -1},
-    {-1, 1, 0, 1, -1, -1, 0, 0, 1, -1, -1, -1},
-    {-1, 0, -1, -1, 0, 0, 0, 0, -1, -1, -1, -1},
-    {0, -1, 1, -1, 0, 0, 1, 1, -1, -1, -1, -1},
-    {0, 0, -1, -1, -1, -1, 0, 0, -1, -1, -1, -1},
-    {-1, -1, 0, -1, -1, -1, 0, 0, -1, -1, -1, -1},
-    {-1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0},
-    {0, 0, -1, -1, -1, 0, -1, -1, 0, -1, -1, 0},
-    {0, -1, 0, -1, 0, -1, -1, -1, 0, -1, -1, 0},
-    {-1, 0, -1, -1, 0, -1, -1, -1, 0, -1, -1, 0},
-    {-1, 0, 0, 0, -1, 0, -1, -1, -1, -1, -1, 0},
-    {0, -1, -1, 0, -1, 0, -1, -1, -1, -1, -1, 0},
-    {0, 0, 0, 1, 1, -1, -1, -1, -1, -1, -1, 1},
-    {-1, -1, -1, 0, 0, -1, -1, -1, -1, -1, -1, 0},
-    {-1, -1, 0, 0, 0, 0, -1, -1, 0, -1, -1, -1},
-    {0, 1, -1, 1, 0, 0, -1, -1, 1, -1, -1, -1},
-    {0, -1, 0, 0, -1, -1, -1, -1, 0, -1, -1, -1},
-    {-1, 0, -1, 0, -1, -1, -1, -1, 0, -1, -1, -1},
-    {-1, 0, 0, -1, 0, 0, -1, -1, -1, -1, -1, -1},
-    {0, -1, -1, -1, 0, 0, -1, -1, -1, -1, -1, -1},
-    {0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1},
-    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
-
-  static unsigned char edgeIndicesByFace[6][4] = {{0, 2, 5, 6},   {3, 8, 9, 11}, {1, 2, 7, 8},
-                                                  {4, 5, 10, 11}, {0, 1, 3, 4},  {6, 7, 9, 10}};
-
-  unsigned char numVertices (unsigned char configuration)
-  {
-    char n = -1;
-    for (unsigned char i = 0; i < 12; i++)
-    {
-      n = std::max (n, vertexIndicesByConfiguration[configuration][i]);
-    }
-    return (unsigned char) (n + 1);
+  static const unsigned int numSlabLayers = 3;
+  // a cube of any configuration has at most 4 vertices
+  static const unsigned int maxNumCubeVertices = 4;
+  static const unsigned int rowGrainSize = 16;
+  static const unsigned int indexGrainSize = 1 << 14;
+
+  // `bits (i, j, ...)` sets the bits i, j, ...
+  constexpr unsigned int bits () { return 0; }
+
+  template <typename... Ts> constexpr unsigned int bits (unsigned int i, Ts... is)
+  {
+    return (1u << i) | bits (is...);
+  }
+
+  /* A base configuration is given by the vertices that lie inside the surface, and by the groups
+   * of crossed edges that share a vertex of the cube.  All 256 configurations are rotations of
+   * these 23 base configurations.
+   */
+  struct BaseConfiguration
+  {
+    unsigned int vertices;
+    unsigned int edgeGroups[maxNumCubeVertices];
+    bool         nonManifold;
+  };
+
+  constexpr BaseConfiguration baseConfigurations[] = {
+    {bits (), {}, false},
+    {bits (4), {bits (2, 6, 7)}, false},
+    {bits (4, 5), {bits (2, 5, 7, 10)}, false},
+    {bits (4, 7), {bits (2, 6, 7), bits (9, 10, 11)}, false},
+    {bits (3, 4), {bits (2, 6, 7), bits (3, 4, 11)}, false},
+
+    {bits (0, 1, 5), {bits (1, 2, 4, 6, 10)}, false},
+    {bits (3, 4, 5), {bits (2, 5, 7, 10), bits (3, 4, 11)}, false},
+    {bits (3, 5, 6), {bits (7, 8, 9), bits (3, 4, 11), bits (5, 6, 10)}, false},
+    {bits (0, 1, 4, 5), {bits (1, 4, 7, 10)}, false},
+    {bits (0, 1, 2, 4), {bits (3, 4, 5, 6, 7, 8)}, false},
+
+    {bits (1, 3, 4, 6), {bits (2, 6, 8, 9), bits (0, 3, 5, 11)}, false},
+    {bits (0, 1, 3, 4), {bits (1, 3, 5, 6, 7, 11)}, false},
+    {bits (0, 1, 5, 6), {bits (7, 8, 9), bits (1, 2, 4, 6, 10)}, false},
+    {bits (1, 2, 4, 7),
+     {bits (2, 6, 7), bits (9, 10, 11), bits (1, 3, 8), bits (0, 4, 5)},
+     false},
+    {bits (0, 1, 2, 5), {bits (2, 3, 4, 6, 8, 10)}, false},
+
+    {bits (0, 1, 2, 4, 7), {bits (3, 4, 5, 6, 7, 8), bits (9, 10, 11)}, false},
+    {bits (0, 1, 2, 6, 7), {bits (2, 5, 7, 10), bits (3, 4, 11)}, true},
+    {bits (2, 3, 4, 6, 7), {bits (1, 2, 4, 6, 10)}, false},
+    {bits (0, 1, 2, 5, 6, 7), {bits (2, 6, 7), bits (3, 4, 11)}, false},
+    {bits (0, 1, 2, 3, 5, 6), {bits (2, 6, 7), bits (9, 10, 11)}, true},
+
+    {bits (0, 1, 2, 3, 6, 7), {bits (2, 5, 7, 10)}, false},
+    {bits (0, 1, 2, 3, 5, 6, 7), {bits (2, 6, 7)}, false},
+    {bits (0, 1, 2, 3, 4, 5, 6, 7), {}, false}};
+
+  // rotations around the x, y, and z axis map each vertex and edge to its rotated source
+  constexpr unsigned char vertexRotations[3][8] = {
+    {4, 5, 0, 1, 6, 7, 2, 3}, {1, 5, 3, 7, 0, 4, 2, 6}, {2, 0, 3, 1, 6, 4, 7, 5}};
+
+  constexpr unsigned char edgeRotations[3][12] = {{6, 2, 7, 0, 5, 10, 9, 8, 1, 3, 11, 4},
+                                                  {5, 4, 0, 11, 10, 6, 2, 1, 3, 8, 7, 9},
+                                                  {1, 3, 8, 4, 0, 2, 7, 9, 11, 10, 6, 5}};
+
+  constexpr unsigned char edgeIndicesByFace[6][4] = {{0, 2, 5, 6},   {3, 8, 9, 11}, {1, 2, 7, 8},
+                                                     {4, 5, 10, 11}, {0, 1, 3, 4},  {6, 7, 9, 10}};
+
+  constexpr unsigned char noAmbiguousFace = 0xff;
+
+  struct Configuration
+  {
+    unsigned int vertices;
+    signed char  vertexIndices[12];
+    bool         nonManifold;
+  };
+
+  constexpr Configuration rotate (const Configuration& c, unsigned int axis)
+  {
+    Configuration r = {0, {}, c.nonManifold};
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      if (c.vertices & (1u << vertexRotations[axis][i]))
+      {
+        r.vertices |= 1u << i;
+      }
+    }
+    for (unsigned int i = 0; i < 12; i++)
+    {
+      r.vertexIndices[i] = c.vertexIndices[edgeRotations[axis][i]];
+    }
+    return r;
+  }
+
+  constexpr Configuration rotate (const Configuration& c, unsigned int axis, unsigned int n)
+  {
+    return n == 0 ? c : rotate (rotate (c, axis), axis, n - 1);
+  }
+
+  // the data of all configurations, which is indexed by the bits of their inner vertices
+  struct Configurations
+  {
+    signed char   vertexIndices[256][12];
+    unsigned char numVertices[256];
+    unsigned char crossedEdges[256][12];
+    unsigned char numCrossedEdges[256];
+    bool          nonManifold[256];
+    unsigned char ambiguousFace[256];
+    unsigned int  numDefined;
+  };
+
+  // the first rotation of a base configuration that yields a configuration defines it
+  constexpr Configurations generateConfigurations ()
+  {
+    Configurations cs = {};
+    bool           isDefined[256] = {};
+
+    for (unsigned int x = 0; x < 4; x++)
+    {
+      for (unsigned int y = 0; y < 4; y++)
+      {
+        for (unsigned int z = 0; z < 4; z++)
+        {
+          for (const BaseConfiguration& base : baseConfigurations)
+          {
+            Configuration c = {base.vertices, {}, base.nonManifold};
+
+            for (unsigned int e = 0; e < 12; e++)
+            {
+              c.vertexIndices[e] = -1;
+
+              for (unsigned int g = 0; g < maxNumCubeVertices; g++)
+              {
+                if (base.edgeGroups[g] & (1u << e))
+                {
+                  c.vertexIndices[e] = (signed char) g;
+                }
+              }
+            }
+            c = rotate (rotate (rotate (c, 2, z), 1, y), 0, x);
+
+            if (isDefined[c.vertices] == false)
+            {
+              for (unsigned int e = 0; e < 12; e++)
+              {
+                cs.vertexIndices[c.vertices][e] = c.vertexIndices[e];
+              }
+              cs.nonManifold[c.vertices] = c.nonManifold;
+              cs.ambiguousFace[c.vertices] = noAmbiguousFace;
+              cs.numDefined++;
+              isDefined[c.vertices] = true;
+            }
+          }
+        }
+      }
+    }
+
+    for (unsigned int c = 0; c < 256; c++)
+    {
+      for (unsigned char e = 0; e < 12; e++)
+      {
+        const signed char v = cs.vertexIndices[c][e];
+
+        if (v >= 0)
+        {
+          cs.numVertices[c] = (unsigned char) (v + 1) > cs.numVertices[c]
+                                ? (unsigned char) (v + 1)
+                                : cs.numVertices[c];
+          cs.crossedEdges[c][cs.numCrossedEdges[c]++] = e;
+        }
+      }
+      for (unsigned char f = 0; f < 6 && cs.nonManifold[c]; f++)
+      {
+        const unsigned char* edges = edgeIndicesByFace[f];
+
+        if (cs.ambiguousFace[c] == noAmbiguousFace && cs.vertexIndices[c][edges[0]] >= 0 &&
+            cs.vertexIndices[c][edges[1]] >= 0 && cs.vertexIndices[c][edges[2]] >= 0 &&
+            cs.vertexIndices[c][edges[3]] >= 0)
+        {
+          cs.ambiguousFace[c] = f;
+        }
+      }
+    }
+    return cs;
   }
 
+  constexpr Configurations configurations = generateConfigurations ();
+
+  static_assert (configurations.numDefined == 256, "rotations must yield all configurations");
+
   bool isIntersecting (float s1, float s2)
   {
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
   }
 
-  struct Cube
+  /* A cube that is crossed by the surface.  Cubes of configuration 0 or 255 have no vertices and
+   * are not stored at all.  The vertices of a cube are added consecutively to the mesh.
+   */
+  struct ActiveCube
   {
-    unsigned char               configuration;
-    glm::vec3                   vertex;
-    unsigned char               numVertexIndicesInMesh;
-    std::array<unsigned int, 3> vertexIndicesInMesh;
-    bool                        nonManifold;
-
-    Cube ()
-      : configuration (0)
-      , vertex (invalidVec3)
+    unsigned int  x;
+    glm::vec3     vertex;
+    unsigned int  firstVertexIndexInMesh;
+    unsigned char configuration;
+    unsigned char numVertexIndicesInMesh;
+    bool          nonManifold;
+
+    ActiveCube (unsigned int cx, unsigned char c, const glm::vec3& v)
+      : x (cx)
+      , vertex (v)
+      , firstVertexIndexInMesh (Util::invalidIndex ())
+      , configuration (c)
       , numVertexIndicesInMesh (0)
       , nonManifold (false)
     {
     }
 
-    bool nonManifoldConfig () const { return ::nonManifoldConfig[this->configuration]; }
+    bool nonManifoldConfig () const { return configurations.nonManifold[this->configuration]; }
 
     bool collapseNonManifoldConfig () const
     {
@@ -352,42 +257,32 @@ namespace
     unsigned int vertexIndex (unsigned char edge) const
     {
       assert (edge < 12);
-      assert (vertexIndicesByConfiguration[this->configuration][edge] >= 0);
+      assert (configurations.vertexIndices[this->configuration][edge] >= 0);
       assert (this->nonManifold == false || this->nonManifoldConfig ());
 
       const unsigned char i = this->collapseNonManifoldConfig ()
                                 ? 0
-                                : vertexIndicesByConfiguration[this->configuration][edge];
-      assert (i < this->vertexIndicesInMesh.size ());
+                                : configurations.vertexIndices[this->configuration][edge];
       assert (i < this->numVertexIndicesInMesh);
 
-      return this->vertexIndicesInMesh[i];
+      return this->firstVertexIndexInMesh + i;
     }
 
     unsigned char getAmbiguousFaceOfNonManifoldConfig () const
     {
       assert (this->nonManifoldConfig ());
+      assert (configurations.ambiguousFace[this->configuration] != noAmbiguousFace);
 
-      for (unsigned int i = 0; i < 6; i++)
-      {
-        const unsigned char edge1 = edgeIndicesByFace[i][0];
-        const unsigned char edge2 = edgeIndicesByFace[i][1];
-        const unsigned char edge3 = edgeIndicesByFace[i][2];
-        const unsigned char edge4 = edgeIndicesByFace[i][3];
-
-        const char vertex1 = vertexIndicesByConfiguration[this->configuration][edge1];
-        const char vertex2 = vertexIndicesByConfiguration[this->configuration][edge2];
-        const char vertex3 = vertexIndicesByConfiguration[this->configuration][edge3];
-        const char vertex4 = vertexIndicesByConfiguration[this->configuration][edge4];
-
-        if (vertex1 != -1 && vertex2 != -1 && vertex3 != -1 && vertex4 != -1)
-        {
-          return (unsigned char) i;
-        }
-      }
-      DILAY_IMPOSSIBLE
+      return configurations.ambiguousFace[this->configuration];
     }
   };
+
+  // the active cubes of a layer ordered by rows, and the offset of each row
+  struct CubeLayer
+  {
+    std::vector<ActiveCube>   cubes;
+    std::vector<unsigned int> rowOffsets;
+  };
 }
 
 const unsigned char IsosurfaceExtractionGrid::vertexIndicesByEdge[12][2] = {
@@ -395,30 +290,56 @@ const unsigned char IsosurfaceExtractionGrid::vertexIndicesByEdge[12][2] = {
 
 struct IsosurfaceExtractionGrid::Impl
 {
-  float              resolution;
-  glm::vec3          sampleMin;
-  glm::vec3          sampleMax;
-  glm::uvec3         numSamples;
-  std::vector<float> samples;
-  glm::uvec3         numCubes;
-  std::vector<Cube>  cubes;
-
-  Impl (const PrimAABox& bounds, float r)
-    : resolution (r)
+  float                  resolution;
+  glm::vec3              sampleOrigin;
+  glm::vec3              sampleMax;
+  glm::uvec3             numSamples;
+  std::vector<float>     samples;
+  glm::uvec3             numCubes;
+  std::vector<CubeLayer> cubeLayers;
+  unsigned int           numLayers;
+
+  Impl (const PrimAABox& bounds, float r, bool slabs) { this->reset (bounds, r, slabs); }
+
+  static void lattice (const PrimAABox& bounds, float r, glm::vec3& origin, glm::uvec3& size)
   {
     const glm::vec3 min = bounds.minimum () - glm::vec3 (Util::epsilon () + r);
     const glm::vec3 max = bounds.maximum () + glm::vec3 (Util::epsilon () + r);
 
-    this->sampleMin = min;
-    this->numSamples = glm::vec3 (1.0f) + glm::ceil ((max - min) / glm::vec3 (r));
+    /* Samples lie on a lattice of multiples of the resolution, so grids of the same resolution
+     * share the exact positions of their samples (see `DynamicDistanceCache`).
+     */
+    origin = glm::floor (min / glm::vec3 (r));
+    size = glm::vec3 (1.0f) + glm::ceil ((max - (origin * glm::vec3 (r))) / glm::vec3 (r));
+  }
+
+  // buffers keep their capacities
+  void reset (const PrimAABox& bounds, float r, bool slabs)
+  {
+    glm::vec3  origin;
+    glm::uvec3 size;
+
+    Impl::lattice (bounds, r, origin, size);
+    this->reset (origin, size, r, slabs);
+  }
+
+  void reset (const glm::vec3& origin, const glm::uvec3& size, float r, bool slabs)
+  {
+    this->resolution = r;
+    this->sampleOrigin = origin;
+    this->numSamples = size;
     this->numCubes = this->numSamples - glm::uvec3 (1);
+    this->numLayers = slabs ? glm::min (numSlabLayers, this->numSamples.z) : this->numSamples.z;
 
-    const unsigned int totalNumSamples =
-      this->numSamples.x * this->numSamples.y * this->numSamples.z;
-    const unsigned int totalNumCubes = this->numCubes.x * this->numCubes.y * this->numCubes.z;
+    const unsigned int totalNumSamples = this->numSamples.x * this->numSamples.y * this->numLayers;
 
-    this->samples.resize (totalNumSamples, Util::maxFloat ());
-    this->cubes.resize (totalNumCubes);
+    this->samples.assign (totalNumSamples, Util::maxFloat ());
+    this->cubeLayers.resize (this->numLayers);
+    for (CubeLayer& layer : this->cubeLayers)
+    {
+      layer.cubes.clear ();
+      layer.rowOffsets.assign (this->numCubes.y + 1, 0);
+    }
   }
 
   glm::vec3 samplePos (unsigned int x, unsigned int y, unsigned int z) const
@@ -427,12 +348,14 @@ struct IsosurfaceExtractionGrid::Impl
     assert (y < (unsigned int) this->numSamples.y);
     assert (z < (unsigned int) this->numSamples.z);
 
-    return this->sampleMin +
-           (glm::vec3 (this->resolution) * glm::vec3 (float(x), float(y), float(z)));
+    return glm::vec3 (this->resolution) *
+           (this->sampleOrigin + glm::vec3 (float(x), float(y), float(z)));
   }
 
   glm::vec3 samplePos (unsigned int i) const
   {
+    assert (this->numLayers == this->numSamples.z);
+
     const std::div_t divZ = std::div (int(i), int(this->numSamples.x * this->numSamples.y));
     const std::div_t divY = std::div (divZ.rem, int(this->numSamples.x));
 
@@ -447,7 +370,8 @@ struct IsosurfaceExtractionGrid::Impl
 
   unsigned int sampleIndex (unsigned int x, unsigned int y, unsigned int z) const
   {
-    return (z * this->numSamples.x * this->numSamples.y) + (y * this->numSamples.x) + x;
+    return ((z % this->numLayers) * this->numSamples.x * this->numSamples.y) +
+           (y * this->numSamples.x) + x;
   }
 
   unsigned int sampleIndex (unsigned int cubeIndex, unsigned char vertex) const
@@ -487,19 +411,51 @@ struct IsosurfaceExtractionGrid::Impl
 
   unsigned int cubeIndex (unsigned int x, unsigned int y, unsigned int z) const
   {
-    return (z * this->numCubes.x * this->numCubes.y) + (y * this->numCubes.x) + x;
+    return ((z % this->numLayers) * this->numCubes.x * this->numCubes.y) +
+           (y * this->numCubes.x) + x;
   }
 
-  unsigned int cubeVertexIndex (unsigned int cubeIndex, unsigned char edge) const
+  /* Looks up the record of a cube, which is `nullptr` if the cube is not crossed by the surface.
+   * Rows hold few active cubes, so a binary search within its row is cheap.
+   */
+  const ActiveCube* activeCube (unsigned int x, unsigned int y, unsigned int z) const
   {
-    return this->cubes[cubeIndex].vertexIndex (edge);
+    const CubeLayer& layer = this->cubeLayers[z % this->numLayers];
+    const auto       begin = layer.cubes.begin () + layer.rowOffsets[y];
+    const auto       end = layer.cubes.begin () + layer.rowOffsets[y + 1];
+    const auto       it = std::lower_bound (
+      begin, end, x, [](const ActiveCube& cube, unsigned int cx) { return cube.x < cx; });
+
+    return (it != end && it->x == x) ? &*it : nullptr;
+  }
+
+  unsigned char configuration (unsigned int x, unsigned int y, unsigned int z) const
+  {
+    const ActiveCube* cube = this->activeCube (x, y, z);
+
+    if (cube)
+    {
+      return cube->configuration;
+    }
+    else
+    {
+      return this->samples[this->sampleIndex (x, y, z)] < 0.0f ? 0xff : 0;
+    }
   }
 
-  void setCubeVertex (unsigned int cubeIndex)
+  unsigned int cubeVertexIndex (unsigned int x, unsigned int y, unsigned int z,
+                                unsigned char edge) const
   {
-    glm::vec3    vertex = glm::vec3 (0.0f);
-    unsigned int numCrossedEdges = 0;
-    Cube&        cube = this->cubes[cubeIndex];
+    const ActiveCube* cube = this->activeCube (x, y, z);
+
+    assert (cube);
+    return cube->vertexIndex (edge);
+  }
+
+  void setCubeVertex (unsigned int x, unsigned int y, unsigned int z, CubeLayer& layer)
+  {
+    const unsigned int cubeIndex = this->cubeIndex (x, y, z);
+    unsigned char      configuration = 0;
 
     const unsigned int indices[] = {
       this->sampleIndex (cubeIndex, 0), this->sampleIndex (cubeIndex, 1),
@@ -512,139 +468,117 @@ struct IsosurfaceExtractionGrid::Impl
                              this->samples[indices[4]], this->samples[indices[5]],
                              this->samples[indices[6]], this->samples[indices[7]]};
 
-    const glm::vec3 positions[] = {this->samplePos (indices[0]), this->samplePos (indices[1]),
-                                   this->samplePos (indices[2]), this->samplePos (indices[3]),
-                                   this->samplePos (indices[4]), this->samplePos (indices[5]),
-                                   this->samplePos (indices[6]), this->samplePos (indices[7])};
-
-    cube.configuration = 0;
-    for (unsigned char edge = 0; edge < 12; edge++)
+    for (unsigned char vertex = 0; vertex < 8; vertex++)
     {
-      const unsigned char vertex1 = vertexIndicesByEdge[edge][0];
-      const unsigned char vertex2 = vertexIndicesByEdge[edge][1];
-
-      cube.configuration |= ((samples[vertex1] < 0.0f) << vertex1);
-      cube.configuration |= ((samples[vertex2] < 0.0f) << vertex2);
-
-      if (isIntersecting (samples[vertex1], samples[vertex2]))
-      {
-        const float     factor = samples[vertex1] / (samples[vertex1] - samples[vertex2]);
-        const glm::vec3 delta = positions[vertex2] - positions[vertex1];
-
-        vertex += positions[vertex1] + (delta * factor);
-        numCrossedEdges++;
-      }
+      configuration |= ((samples[vertex] < 0.0f) << vertex);
     }
 
-#ifndef NDEBUG
-    for (unsigned char edge = 0; edge < 12; edge++)
+    if (configuration == 0 || configuration == 0xff)
     {
-      const unsigned char vertex1 = vertexIndicesByEdge[edge][0];
-      const unsigned char vertex2 = vertexIndicesByEdge[edge][1];
+      assert (configurations.numVertices[configuration] == 0);
+      return;
+    }
 
-      if (samples[vertex1] < 0.0f)
-      {
-        assert ((cube.configuration & (1 << vertex1)) != 0);
-      }
-      else
-      {
-        assert ((cube.configuration & (1 << vertex1)) == 0);
-      }
+    const glm::vec3 positions[] = {
+      this->samplePos (x, y, z),         this->samplePos (x + 1, y, z),
+      this->samplePos (x, y + 1, z),     this->samplePos (x + 1, y + 1, z),
+      this->samplePos (x, y, z + 1),     this->samplePos (x + 1, y, z + 1),
+      this->samplePos (x, y + 1, z + 1), this->samplePos (x + 1, y + 1, z + 1)};
 
-      if (samples[vertex2] < 0.0f)
-      {
-        assert ((cube.configuration & (1 << vertex2)) != 0);
-      }
-      else
-      {
-        assert ((cube.configuration & (1 << vertex2)) == 0);
-      }
+    const unsigned char  numCrossedEdges = configurations.numCrossedEdges[configuration];
+    const unsigned char* crossedEdges = configurations.crossedEdges[configuration];
+    glm::vec3            vertex = glm::vec3 (0.0f);
 
-      if (isIntersecting (samples[vertex1], samples[vertex2]))
-      {
-        assert (vertexIndicesByConfiguration[cube.configuration][edge] != -1);
-      }
-    }
-#endif
+    assert (numCrossedEdges > 0);
 
-    if (numCrossedEdges > 0)
-    {
-      cube.vertex = vertex / float(numCrossedEdges);
-    }
-    else
+    for (unsigned char i = 0; i < numCrossedEdges; i++)
     {
-      assert (numVertices (cube.configuration) == 0);
+      const unsigned char vertex1 = vertexIndicesByEdge[crossedEdges[i]][0];
+      const unsigned char vertex2 = vertexIndicesByEdge[crossedEdges[i]][1];
+      const float         factor = samples[vertex1] / (samples[vertex1] - samples[vertex2]);
+      const glm::vec3     delta = positions[vertex2] - positions[vertex1];
+
+      assert (isIntersecting (samples[vertex1], samples[vertex2]));
+
+      vertex += positions[vertex1] + (delta * factor);
     }
+    layer.cubes.emplace_back (x, configuration, vertex / float(numCrossedEdges));
   }
 
-  void setCubeVertices ()
+  void setCubeVertices (unsigned int z)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    CubeLayer& layer = this->cubeLayers[z % this->numLayers];
+
+    layer.cubes.clear ();
+    for (unsigned int y = 0; y < this->numCubes.y; y++)
     {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      layer.rowOffsets[y] = (unsigned int) layer.cubes.size ();
+
+      for (unsigned int x = 0; x < this->numCubes.x; x++)
       {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          this->setCubeVertex (this->cubeIndex (x, y, z));
-        }
+        this->setCubeVertex (x, y, z, layer);
       }
     }
+    layer.rowOffsets[this->numCubes.y] = (unsigned int) layer.cubes.size ();
+  }
 
+  // the configurations of a layer must match the configurations of its preceding layer
+  void checkConfigurations (unsigned int z) const
+  {
 #ifndef NDEBUG
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    for (unsigned int y = 0; y < this->numCubes.y; y++)
     {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      for (unsigned int x = 0; x < this->numCubes.x; x++)
       {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          unsigned char config = this->cubes[this->cubeIndex (x, y, z)].configuration;
+        unsigned char config = this->configuration (x, y, z);
 
-          if (x > 0)
-          {
-            unsigned char left = this->cubes[this->cubeIndex (x - 1, y, z)].configuration;
+        if (x > 0)
+        {
+          unsigned char left = this->configuration (x - 1, y, z);
 
-            assert (((config & (1 << 0)) == 0) == ((left & (1 << 1)) == 0));
-            assert (((config & (1 << 2)) == 0) == ((left & (1 << 3)) == 0));
-            assert (((config & (1 << 4)) == 0) == ((left & (1 << 5)) == 0));
-            assert (((config & (1 << 6)) == 0) == ((left & (1 << 7)) == 0));
-          }
-          if (y > 0)
-          {
-            unsigned char below = this->cubes[this->cubeIndex (x, y - 1, z)].configuration;
+          assert (((config & (1 << 0)) == 0) == ((left & (1 << 1)) == 0));
+          assert (((config & (1 << 2)) == 0) == ((left & (1 << 3)) == 0));
+          assert (((config & (1 << 4)) == 0) == ((left & (1 << 5)) == 0));
+          assert (((config & (1 << 6)) == 0) == ((left & (1 << 7)) == 0));
+        }
+        if (y > 0)
+        {
+          unsigned char below = this->configuration (x, y - 1, z);
 
-            assert (((config & (1 << 0)) == 0) == ((below & (1 << 2)) == 0));
-            assert (((config & (1 << 1)) == 0) == ((below & (1 << 3)) == 0));
-            assert (((config & (1 << 4)) == 0) == ((below & (1 << 6)) == 0));
-            assert (((config & (1 << 5)) == 0) == ((below & (1 << 7)) == 0));
-          }
-          if (z > 0)
-          {
-            unsigned char behind = this->cubes[this->cubeIndex (x, y, z - 1)].configuration;
+          assert (((config & (1 << 0)) == 0) == ((below & (1 << 2)) == 0));
+          assert (((config & (1 << 1)) == 0) == ((below & (1 << 3)) == 0));
+          assert (((config & (1 << 4)) == 0) == ((below & (1 << 6)) == 0));
+          assert (((config & (1 << 5)) == 0) == ((below & (1 << 7)) == 0));
+        }
+        if (z > 0)
+        {
+          unsigned char behind = this->configuration (x, y, z - 1);
 
-            assert (((config & (1 << 0)) == 0) == ((behind & (1 << 4)) == 0));
-            assert (((config & (1 << 1)) == 0) == ((behind & (1 << 5)) == 0));
-            assert (((config & (1 << 2)) == 0) == ((behind & (1 << 6)) == 0));
-            assert (((config & (1 << 3)) == 0) == ((behind & (1 << 7)) == 0));
-          }
+          assert (((config & (1 << 0)) == 0) == ((behind & (1 << 4)) == 0));
+          assert (((config & (1 << 1)) == 0) == ((behind & (1 << 5)) == 0));
+          assert (((config & (1 << 2)) == 0) == ((behind & (1 << 6)) == 0));
+          assert (((config & (1 << 3)) == 0) == ((behind & (1 << 7)) == 0));
         }
       }
     }
+#else
+    unused (z);
 #endif
   }
 
-  bool hasAmbiguousNeighbor (const Cube& cube, unsigned int x, unsigned int y, unsigned int z,
-                             unsigned char ambiguousFace, char dim)
+  bool hasAmbiguousNeighbor (const ActiveCube& cube, unsigned int y, unsigned int z,
+                             unsigned char ambiguousFace, char dim) const
   {
     assert (cube.nonManifoldConfig ());
     assert (dim == -3 || dim == -2 || dim == -1 || dim == 1 || dim == 2 || dim == 3);
-    unused (cube);
 
-    Cube& other = this->cubes[this->cubeIndex (dim == -1 ? x - 1 : (dim == 1 ? x + 1 : x),
-                                               dim == -2 ? y - 1 : (dim == 2 ? y + 1 : y),
-                                               dim == -3 ? z - 1 : (dim == 3 ? z + 1 : z))];
-    if (other.nonManifoldConfig ())
+    const unsigned int x = cube.x;
+    const ActiveCube*  other = this->activeCube (dim == -1 ? x - 1 : (dim == 1 ? x + 1 : x),
+                                                dim == -2 ? y - 1 : (dim == 2 ? y + 1 : y),
+                                                dim == -3 ? z - 1 : (dim == 3 ? z + 1 : z));
+    if (other && other->nonManifoldConfig ())
     {
-      const unsigned char otherAmbiguousFace = other.getAmbiguousFaceOfNonManifoldConfig ();
+      const unsigned char otherAmbiguousFace = other->getAmbiguousFaceOfNonManifoldConfig ();
 
       const bool nx = dim == -1 && ambiguousFace == 2 && otherAmbiguousFace == 3;
       const bool px = dim == 1 && ambiguousFace == 3 && otherAmbiguousFace == 2;
@@ -661,23 +595,22 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void resolveNonManifold (unsigned int x, unsigned int y, unsigned int z)
+  void resolveNonManifold (ActiveCube& cube, unsigned int y, unsigned int z)
   {
-    Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
-
     if (cube.nonManifoldConfig ())
     {
+      const unsigned int  x = cube.x;
       const unsigned char ambiguousFace = cube.getAmbiguousFaceOfNonManifoldConfig ();
 
-      const bool nx = x > 0 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, -1);
+      const bool nx = x > 0 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, -1);
       const bool px =
-        x < this->numCubes.x - 1 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, 1);
-      const bool ny = y > 0 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, -2);
+        x < this->numCubes.x - 1 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, 1);
+      const bool ny = y > 0 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, -2);
       const bool py =
-        y < this->numCubes.y - 1 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, 2);
-      const bool nz = z > 0 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, -3);
+        y < this->numCubes.y - 1 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, 2);
+      const bool nz = z > 0 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, -3);
       const bool pz =
-        z < this->numCubes.z - 1 && this->hasAmbiguousNeighbor (cube, x, y, z, ambiguousFace, 3);
+        z < this->numCubes.z - 1 && this->hasAmbiguousNeighbor (cube, y, z, ambiguousFace, 3);
 
       cube.nonManifold = nx || px || ny || py || nz || pz;
     }
@@ -687,42 +620,92 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void resolveNonManifolds ()
+  // only resolves the cubes of the rows within [minY, maxY) of a layer
+  void resolveNonManifolds (unsigned int z, unsigned int minY, unsigned int maxY)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    CubeLayer& layer = this->cubeLayers[z % this->numLayers];
+
+    for (unsigned int y = minY; y < maxY; y++)
     {
-      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      for (unsigned int i = layer.rowOffsets[y]; i < layer.rowOffsets[y + 1]; i++)
       {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
-        {
-          this->resolveNonManifold (x, y, z);
-        }
+        this->resolveNonManifold (layer.cubes[i], y, z);
       }
     }
   }
 
-  void addCubeVerticesToMesh (Cube& cube, DynamicMesh& mesh)
+  void resolveNonManifolds (unsigned int z)
+  {
+    this->resolveNonManifolds (z, 0, this->numCubes.y);
+  }
+
+  static void setNumVertexIndicesInMesh (ActiveCube& cube)
   {
     cube.numVertexIndicesInMesh =
-      cube.collapseNonManifoldConfig () ? 1 : numVertices (cube.configuration);
+      cube.collapseNonManifoldConfig () ? 1 : configurations.numVertices[cube.configuration];
+    assert (cube.numVertexIndicesInMesh > 0);
+  }
+
+  void addCubeVerticesToMesh (ActiveCube& cube, DynamicMesh& mesh)
+  {
+    setNumVertexIndicesInMesh (cube);
 
-    for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+    cube.firstVertexIndexInMesh = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+    for (unsigned char i = 1; i < cube.numVertexIndicesInMesh; i++)
     {
-      cube.vertexIndicesInMesh[i] = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+      const unsigned int index = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+
+      assert (index == cube.firstVertexIndexInMesh + i);
+      unused (index);
     }
-#ifndef NDEBUG
-    for (unsigned char i = cube.numVertexIndicesInMesh; i < cube.vertexIndicesInMesh.size (); i++)
+  }
+
+  void addCubeVerticesToMesh (unsigned int z, DynamicMesh& mesh)
+  {
+    for (ActiveCube& cube : this->cubeLayers[z % this->numLayers].cubes)
     {
-      cube.vertexIndicesInMesh[i] = Util::invalidIndex ();
+      this->addCubeVerticesToMesh (cube, mesh);
+    }
+  }
+
+  unsigned int countCubeVertices (unsigned int z)
+  {
+    unsigned int n = 0;
+
+    for (ActiveCube& cube : this->cubeLayers[z % this->numLayers].cubes)
+    {
+      setNumVertexIndicesInMesh (cube);
+      n += cube.numVertexIndicesInMesh;
+    }
+    return n;
+  }
+
+  // `countCubeVertices` must be called before
+  void setCubeVertices (unsigned int z, unsigned int firstIndex, std::vector<glm::vec3>& vertices)
+  {
+    for (ActiveCube& cube : this->cubeLayers[z % this->numLayers].cubes)
+    {
+      cube.firstVertexIndexInMesh = firstIndex;
+
+      for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+      {
+        vertices[firstIndex++] = cube.vertex;
+      }
     }
-#endif
+  }
+
+  // a quad is split along its shorter diagonal
+  static bool splitAlongFirstDiagonal (const glm::vec3& v, const glm::vec3& vu,
+                                       const glm::vec3& vv, const glm::vec3& vuv)
+  {
+    return glm::distance2 (v, vuv) <= glm::distance2 (vu, vv);
   }
 
   void addQuadToMesh (DynamicMesh& mesh, unsigned int i, unsigned int iu, unsigned int iv,
                       unsigned int iuv)
   {
-    if (glm::distance2 (mesh.vertex (i), mesh.vertex (iuv)) <=
-        glm::distance2 (mesh.vertex (iu), mesh.vertex (iv)))
+    if (splitAlongFirstDiagonal (mesh.vertex (i), mesh.vertex (iu), mesh.vertex (iv),
+                                 mesh.vertex (iuv)))
     {
       mesh.addFace (i, iu, iuv);
       mesh.addFace (i, iuv, iv);
@@ -734,8 +717,24 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned char edge, unsigned int x, unsigned int y,
-                  unsigned int z)
+  static void addQuadToIndices (const std::vector<glm::vec3>& vertices, unsigned int i,
+                                unsigned int iu, unsigned int iv, unsigned int iuv,
+                                std::vector<unsigned int>& indices)
+  {
+    if (splitAlongFirstDiagonal (vertices[i], vertices[iu], vertices[iv], vertices[iuv]))
+    {
+      indices.insert (indices.end (), {i, iu, iuv, i, iuv, iv});
+    }
+    else
+    {
+      indices.insert (indices.end (), {iu, iuv, iv, iu, iv, i});
+    }
+  }
+
+  // calls `f (i, iu, iv, iuv)` if the given edge of the given sample is crossed by the surface
+  template <typename F>
+  void forQuad (unsigned char edge, unsigned int x, unsigned int y, unsigned int z,
+                const F& f) const
   {
     assert (edge == 0 || edge == 1 || edge == 2);
 
@@ -749,24 +748,24 @@ struct IsosurfaceExtractionGrid::Impl
 
       if (edge == 0)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 0);
-        iu = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z), 3);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z - 1), 9);
-        iv = this->cubeVertexIndex (this->cubeIndex (x, y, z - 1), 6);
+        i = this->cubeVertexIndex (x, y, z, 0);
+        iu = this->cubeVertexIndex (x, y - 1, z, 3);
+        iuv = this->cubeVertexIndex (x, y - 1, z - 1, 9);
+        iv = this->cubeVertexIndex (x, y, z - 1, 6);
       }
       else if (edge == 1)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 1);
-        iu = this->cubeVertexIndex (this->cubeIndex (x, y, z - 1), 7);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z - 1), 10);
-        iv = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z), 4);
+        i = this->cubeVertexIndex (x, y, z, 1);
+        iu = this->cubeVertexIndex (x, y, z - 1, 7);
+        iuv = this->cubeVertexIndex (x - 1, y, z - 1, 10);
+        iv = this->cubeVertexIndex (x - 1, y, z, 4);
       }
       else if (edge == 2)
       {
-        i = this->cubeVertexIndex (this->cubeIndex (x, y, z), 2);
-        iu = this->cubeVertexIndex (this->cubeIndex (x - 1, y, z), 5);
-        iuv = this->cubeVertexIndex (this->cubeIndex (x - 1, y - 1, z), 11);
-        iv = this->cubeVertexIndex (this->cubeIndex (x, y - 1, z), 8);
+        i = this->cubeVertexIndex (x, y, z, 2);
+        iu = this->cubeVertexIndex (x - 1, y, z, 5);
+        iuv = this->cubeVertexIndex (x - 1, y - 1, z, 11);
+        iv = this->cubeVertexIndex (x, y - 1, z, 8);
       }
       else
       {
@@ -778,70 +777,285 @@ struct IsosurfaceExtractionGrid::Impl
         std::swap (iu, iv);
       }
 
-      this->addQuadToMesh (mesh, i, iu, iv, iuv);
+      f (i, iu, iv, iuv);
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned int x, unsigned int y, unsigned int z)
+  /* An intersecting edge 0, 1 or 2 of a cube makes the cube active, so only active cubes need
+   * to be visited.
+   */
+  template <typename F> void forEachQuad (unsigned int z, const F& f) const
   {
-    if (y > 0 && z > 0)
-    {
-      this->makeFaces (mesh, 0, x, y, z);
-    }
-    if (x > 0 && z > 0)
-    {
-      this->makeFaces (mesh, 1, x, y, z);
-    }
-    if (x > 0 && y > 0)
+    this->forEachQuad (z, glm::uvec2 (0), glm::uvec2 (this->numCubes), f);
+  }
+
+  // only visits the quads of the samples within [min, max) of a layer
+  template <typename F>
+  void forEachQuad (unsigned int z, const glm::uvec2& min, const glm::uvec2& max, const F& f) const
+  {
+    const CubeLayer& layer = this->cubeLayers[z % this->numLayers];
+
+    for (unsigned int y = min.y; y < glm::min (max.y, this->numCubes.y); y++)
     {
-      this->makeFaces (mesh, 2, x, y, z);
+      const auto begin = layer.cubes.begin () + layer.rowOffsets[y];
+      const auto end = layer.cubes.begin () + layer.rowOffsets[y + 1];
+      const auto first = std::lower_bound (
+        begin, end, min.x, [](const ActiveCube& cube, unsigned int cx) { return cube.x < cx; });
+
+      for (auto it = first; it != end && it->x < max.x; ++it)
+      {
+        const unsigned int x = it->x;
+
+        if (y > 0 && z > 0)
+        {
+          this->forQuad (0, x, y, z, f);
+        }
+        if (x > 0 && z > 0)
+        {
+          this->forQuad (1, x, y, z, f);
+        }
+        if (x > 0 && y > 0)
+        {
+          this->forQuad (2, x, y, z, f);
+        }
+      }
     }
   }
 
+  void makeFaces (DynamicMesh& mesh, unsigned int z)
+  {
+    this->forEachQuad (z, [this, &mesh](unsigned int i, unsigned int iu, unsigned int iv,
+                                        unsigned int iuv) {
+      this->addQuadToMesh (mesh, i, iu, iv, iuv);
+    });
+  }
+
+  void makeFaces (const std::vector<glm::vec3>& vertices, unsigned int z,
+                  std::vector<unsigned int>& indices) const
+  {
+    this->forEachQuad (z, [&vertices, &indices](unsigned int i, unsigned int iu, unsigned int iv,
+                                                unsigned int iuv) {
+      addQuadToIndices (vertices, i, iu, iv, iuv, indices);
+    });
+  }
+
+  /* Layers are processed in parallel: the vertices of a layer get consecutive indices that start
+   * at the prefix sum of the vertex counts of the preceding layers, and the faces of each layer
+   * are collected separately before the mesh is constructed at once.
+   */
   void makeMesh (DynamicMesh& mesh)
   {
-    this->setCubeVertices ();
-    this->resolveNonManifolds ();
+    DILAY_PROFILE_ZONE ("IsosurfaceExtractionGrid::makeMesh");
+
+    assert (this->numLayers == this->numSamples.z);
+
+    const unsigned int numZ = this->numCubes.z;
+
+    Parallel::forEach (numZ, [this](unsigned int z) { this->setCubeVertices (z); });
+    Parallel::forEach (numZ, [this](unsigned int z) { this->checkConfigurations (z); });
+    Parallel::forEach (numZ, [this](unsigned int z) { this->resolveNonManifolds (z); });
+
+    std::vector<unsigned int> firstVertexIndices (numZ + 1, 0);
+    Parallel::forEach (numZ, [this, &firstVertexIndices](unsigned int z) {
+      firstVertexIndices[z + 1] = this->countCubeVertices (z);
+    });
+    std::partial_sum (firstVertexIndices.begin (), firstVertexIndices.end (),
+                      firstVertexIndices.begin ());
+
+    std::vector<glm::vec3> vertices (firstVertexIndices.back ());
+    Parallel::forEach (numZ, [this, &firstVertexIndices, &vertices](unsigned int z) {
+      this->setCubeVertices (z, firstVertexIndices[z], vertices);
+    });
+
+    std::vector<std::vector<unsigned int>> indices (numZ);
+    Parallel::forEach (numZ, [this, &vertices, &indices](unsigned int z) {
+      this->makeFaces (vertices, z, indices[z]);
+    });
+
+    std::vector<unsigned int> allIndices;
+    concatenate (indices, allIndices);
+
+    mesh.fromArrays (vertices, allIndices);
+    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (nullptr, nullptr));
+    mesh.bufferData ();
+  }
+
+  /* Processes the grid slab by slab, i.e., only `numSlabLayers` layers of samples and cubes are
+   * kept: a layer of cubes needs the samples of its two sample layers, its non-manifold
+   * resolution needs the configurations of the adjacent cube layers, and the faces of a sample
+   * layer need the vertices of its two adjacent cube layers.  The rows of a layer are resolved in
+   * parallel, since a cube only reads the configurations of its neighbors.
+   */
+  void makeMesh (DynamicMesh& mesh, const std::function<void(unsigned int)>& sampleLayer)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtractionGrid::makeMesh (layers)");
+
+    assert (this->numLayers == glm::min (numSlabLayers, this->numSamples.z));
 
     mesh.reset ();
-    for (Cube& cube : this->cubes)
-    {
-      this->addCubeVerticesToMesh (cube, mesh);
-    }
+    sampleLayer (0);
+    sampleLayer (1);
+    this->setCubeVertices (0);
+    this->checkConfigurations (0);
 
     for (unsigned int z = 0; z < this->numCubes.z; z++)
     {
+      if (z + 1 < this->numCubes.z)
+      {
+        sampleLayer (z + 2);
+        this->setCubeVertices (z + 1);
+        this->checkConfigurations (z + 1);
+      }
+      Parallel::forRange (this->numCubes.y, rowGrainSize,
+                          [this, z](unsigned int begin, unsigned int end) {
+                            this->resolveNonManifolds (z, begin, end);
+                          });
+      this->addCubeVerticesToMesh (z, mesh);
+      this->makeFaces (mesh, z);
+    }
+    this->finalizeMesh (mesh);
+  }
+
+  /* The vertices of all cubes are made, since the faces of the shard's bounds refer to cubes
+   * outside of its bounds.  Only vertices that are referred to are kept, and each is identified
+   * by its cube in the larger grid and its index within the cube.  Vertices are pruned in
+   * parallel per layer: the vertices of a cube layer are only referred to by the faces of the
+   * two adjacent sample layers, and kept vertices retain their order.
+   */
+  void makeShard (const glm::uvec3& min, const glm::uvec3& max, const glm::uvec3& offset,
+                  const glm::uvec3& totalNumCubes, IsosurfaceExtractionShard& shard)
+  {
+    DILAY_PROFILE_ZONE ("IsosurfaceExtractionGrid::makeShard");
+
+    assert (this->numLayers == this->numSamples.z);
+
+    const unsigned int numZ = this->numCubes.z;
+
+    Parallel::forEach (numZ, [this](unsigned int z) { this->setCubeVertices (z); });
+    Parallel::forEach (numZ, [this](unsigned int z) { this->checkConfigurations (z); });
+    Parallel::forEach (numZ, [this](unsigned int z) { this->resolveNonManifolds (z); });
+
+    std::vector<unsigned int> firstVertexIndices (numZ + 1, 0);
+    Parallel::forEach (numZ, [this, &firstVertexIndices](unsigned int z) {
+      firstVertexIndices[z + 1] = this->countCubeVertices (z);
+    });
+    std::partial_sum (firstVertexIndices.begin (), firstVertexIndices.end (),
+                      firstVertexIndices.begin ());
+
+    std::vector<glm::vec3>     vertices (firstVertexIndices.back ());
+    std::vector<std::uint64_t> keys (firstVertexIndices.back ());
+    Parallel::forEach (numZ, [this, &firstVertexIndices, &vertices, &keys, &offset,
+                              &totalNumCubes](unsigned int z) {
+      const CubeLayer& layer = this->cubeLayers[z];
+
+      this->setCubeVertices (z, firstVertexIndices[z], vertices);
+
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
-        for (unsigned int x = 0; x < this->numCubes.x; x++)
+        for (unsigned int i = layer.rowOffsets[y]; i < layer.rowOffsets[y + 1]; i++)
         {
-          this->makeFaces (mesh, x, y, z);
+          const ActiveCube&   cube = layer.cubes[i];
+          const std::uint64_t cubeKey =
+            (((std::uint64_t (offset.z + z) * totalNumCubes.y) + offset.y + y) * totalNumCubes.x) +
+            offset.x + cube.x;
+
+          assert (cube.numVertexIndicesInMesh <= maxNumCubeVertices);
+          for (unsigned char v = 0; v < cube.numVertexIndicesInMesh; v++)
+          {
+            keys[cube.firstVertexIndexInMesh + v] = (cubeKey * maxNumCubeVertices) + v;
+          }
         }
       }
-    }
-    mesh.setAllNormals ();
+    });
 
-#ifndef NDEBUG
-    std::vector<unsigned int> vertexIndexMap, faceIndexMap;
-    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (&vertexIndexMap, nullptr));
+    std::vector<std::vector<unsigned int>> indices (numZ);
+    Parallel::forEach (numZ, [this, &min, &max, &vertices, &indices](unsigned int z) {
+      if (z >= min.z && z < max.z)
+      {
+        this->forEachQuad (z, glm::uvec2 (min), glm::uvec2 (max),
+                           [&vertices, &indices, z](unsigned int i, unsigned int iu,
+                                                    unsigned int iv, unsigned int iuv) {
+                             addQuadToIndices (vertices, i, iu, iv, iuv, indices[z]);
+                           });
+      }
+    });
 
-    for (Cube& c : this->cubes)
-    {
-      if (vertexIndexMap.empty () == false)
+    std::vector<unsigned int> newIndices (vertices.size (), Util::invalidIndex ());
+    std::vector<unsigned int> firstNewIndices (numZ + 1, 0);
+    Parallel::forEach (numZ, [&firstVertexIndices, &indices, &newIndices, &firstNewIndices,
+                              numZ](unsigned int z) {
+      const unsigned int begin = firstVertexIndices[z];
+      const unsigned int end = firstVertexIndices[z + 1];
+
+      for (unsigned int l = z; l < glm::min (z + 2, numZ); l++)
+      {
+        for (unsigned int i : indices[l])
+        {
+          if (i >= begin && i < end)
+          {
+            newIndices[i] = 0;
+          }
+        }
+      }
+      firstNewIndices[z + 1] = (unsigned int) std::count (newIndices.begin () + begin,
+                                                          newIndices.begin () + end, 0);
+    });
+    std::partial_sum (firstNewIndices.begin (), firstNewIndices.end (), firstNewIndices.begin ());
+
+    shard.vertices.resize (firstNewIndices.back ());
+    shard.vertexKeys.resize (firstNewIndices.back ());
+    Parallel::forEach (numZ, [&firstVertexIndices, &vertices, &keys, &newIndices,
+                              &firstNewIndices, &shard](unsigned int z) {
+      unsigned int newIndex = firstNewIndices[z];
+
+      for (unsigned int i = firstVertexIndices[z]; i < firstVertexIndices[z + 1]; i++)
       {
-        for (unsigned char i = 0; i < c.numVertexIndicesInMesh; i++)
+        if (newIndices[i] != Util::invalidIndex ())
         {
-          c.vertexIndicesInMesh[i] = vertexIndexMap[c.vertexIndicesInMesh[i]];
-          assert (c.vertexIndicesInMesh[i] != Util::invalidIndex ());
+          newIndices[i] = newIndex;
+          shard.vertices[newIndex] = vertices[i];
+          shard.vertexKeys[newIndex] = keys[i];
+          newIndex++;
         }
       }
+    });
+
+    concatenate (indices, shard.indices);
+    Parallel::forRange (shard.indices.size (), indexGrainSize,
+                        [&newIndices, &shard](unsigned int begin, unsigned int end) {
+                          for (unsigned int i = begin; i < end; i++)
+                          {
+                            shard.indices[i] = newIndices[shard.indices[i]];
+                          }
+                        });
+  }
+
+  // copies the indices of all layers in parallel
+  static void concatenate (const std::vector<std::vector<unsigned int>>& indices,
+                           std::vector<unsigned int>&                    allIndices)
+  {
+    std::vector<unsigned int> offsets (indices.size () + 1, 0);
+    for (unsigned int z = 0; z < indices.size (); z++)
+    {
+      offsets[z + 1] = offsets[z] + (unsigned int) indices[z].size ();
     }
-#endif
+
+    allIndices.resize (offsets.back ());
+    Parallel::forEach (indices.size (), [&indices, &allIndices, &offsets](unsigned int z) {
+      std::copy (indices[z].begin (), indices[z].end (), allIndices.begin () + offsets[z]);
+    });
+  }
+
+  void finalizeMesh (DynamicMesh& mesh)
+  {
+    mesh.setAllNormals ();
+
+    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (nullptr, nullptr));
     mesh.bufferData ();
   }
 };
 
-DELEGATE2_BIG4_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
+DELEGATE3_BIG4_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float, bool)
 GETTER_CONST (float, IsosurfaceExtractionGrid, resolution)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numSamples)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numCubes)
@@ -854,4 +1068,12 @@ DELEGATE3_CONST (unsigned int, IsosurfaceExtractionGrid, sampleIndex, unsigned i
 DELEGATE2_CONST (unsigned int, IsosurfaceExtractionGrid, sampleIndex, unsigned int, unsigned char)
 DELEGATE3_CONST (unsigned int, IsosurfaceExtractionGrid, cubeIndex, unsigned int, unsigned int,
                  unsigned int)
+DELEGATE4_STATIC (void, IsosurfaceExtractionGrid, lattice, const PrimAABox&, float, glm::vec3&,
+                  glm::uvec3&)
+DELEGATE3 (void, IsosurfaceExtractionGrid, reset, const PrimAABox&, float, bool)
+DELEGATE4 (void, IsosurfaceExtractionGrid, reset, const glm::vec3&, const glm::uvec3&, float, bool)
 DELEGATE1 (void, IsosurfaceExtractionGrid, makeMesh, DynamicMesh&)
+DELEGATE2 (void, IsosurfaceExtractionGrid, makeMesh, DynamicMesh&,
+           const std::function<void(unsigned int)>&)
+DELEGATE5 (void, IsosurfaceExtractionGrid, makeShard, const glm::uvec3&, const glm::uvec3&,
+           const glm::uvec3&, const glm::uvec3&, IsosurfaceExtractionShard&)
@@ -5,19 +5,22 @@
 #ifndef DILAY_ISOSURFACE_EXTRACTION_GRID
 #define DILAY_ISOSURFACE_EXTRACTION_GRID
 
+#include <functional>
 #include <glm/glm.hpp>
 #include <vector>
 #include "macro.hpp"
 
 class DynamicMesh;
 class PrimAABox;
+struct IsosurfaceExtractionShard;
 
 class IsosurfaceExtractionGrid
 {
 public:
   static const unsigned char vertexIndicesByEdge[12][2];
 
-  DECLARE_BIG4_EXPLICIT_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
+  // a grid of slabs keeps only a few layers (along z) of samples at a time
+  DECLARE_BIG4_EXPLICIT_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float, bool)
 
   float               resolution () const;
   const glm::uvec3&   numSamples () const;
@@ -30,7 +33,22 @@ public:
   unsigned int sampleIndex (unsigned int, unsigned char) const;
   unsigned int cubeIndex (unsigned int, unsigned int, unsigned int) const;
 
+  // the lattice of a grid with the given bounds and resolution: its origin (in cells) and size
+  static void lattice (const PrimAABox&, float, glm::vec3&, glm::uvec3&);
+
+  // reinitializes the grid like its constructor but keeps its buffers
+  void reset (const PrimAABox&, float, bool);
+  // reinitializes the grid to the given origin (in cells) and number of samples
+  void reset (const glm::vec3&, const glm::uvec3&, float, bool);
+
   void makeMesh (DynamicMesh&);
+  // grid of slabs only: the callback must sample the given layer
+  void makeMesh (DynamicMesh&, const std::function<void(unsigned int)>&);
+  /* Makes the faces of the samples within [min, max) (first two arguments).  The grid is part of
+   * a larger grid: it starts at the given sample of a grid with the given number of cubes.
+   */
+  void makeShard (const glm::uvec3&, const glm::uvec3&, const glm::uvec3&, const glm::uvec3&,
+                  IsosurfaceExtractionShard&);
 
 private:
   IMPLEMENTATION
@@ -0,0 +1,23 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_ISOSURFACE_EXTRACTION_SHARD
+#define DILAY_ISOSURFACE_EXTRACTION_SHARD
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+/* The faces of an extraction that belong to a box of samples of the extraction's grid.  Shards
+ * overlap by a few cells and identify each vertex by its cube in the extraction's grid, so
+ * vertices along their bounds are shared when shards are stitched.
+ */
+struct IsosurfaceExtractionShard
+{
+  std::vector<glm::vec3>     vertices;
+  std::vector<std::uint64_t> vertexKeys;
+  std::vector<unsigned int>  indices;
+};
+
+#endif
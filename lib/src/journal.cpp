@@ -0,0 +1,758 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <glm/glm.hpp>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "config.hpp"
+#include "dynamic/mesh-changes.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "journal.hpp"
+#include "mesh.hpp"
+#include "scene.hpp"
+#include "sketch/mesh.hpp"
+#include "util.hpp"
+
+namespace
+{
+  /* Journals start with `journalMagic` followed by the version and a sequence of records.  Each
+   * record stores its type, the id of its mesh and the size of its data.  Meshes store their
+   * transformation, their number of vertices and faces including free ones, the vertices (free,
+   * position, normal) and the faces (free, indices).  Changes store the transformation, the
+   * number of vertices and faces, the number of recorded vertices and faces, and the recorded
+   * vertices (index, free, position, normal) and faces (index, free, indices).  Sketch meshes
+   * are stored as a binary Dilay file.  All values are 32 bit little-endian integers or floats.
+   * A checkpoint consists of records of all meshes and sketch meshes.
+   */
+  static constexpr char         journalMagic[4] = {'D', 'L', 'Y', 'J'};
+  static constexpr unsigned int journalVersion = 1;
+
+  enum class RecordType : uint32_t
+  {
+    Mesh = 0,
+    Changes = 1,
+    Deletion = 2,
+    SketchMeshes = 3
+  };
+
+  template <typename T> void append (std::string& buffer, const T& value)
+  {
+    static_assert (sizeof (T) % 4 == 0, "Unexpected memory layout");
+    buffer.append (reinterpret_cast<const char*> (&value), sizeof (T));
+  }
+
+  void appendTransformation (std::string& buffer, const Mesh& mesh)
+  {
+    append (buffer, mesh.position ());
+    append (buffer, mesh.scaling ());
+    append (buffer, mesh.rotationMatrix ());
+  }
+
+  // returns the offset of the size of the record, which is set by `endRecord`
+  std::size_t beginRecord (std::string& buffer, RecordType type, unsigned int id)
+  {
+    append (buffer, uint32_t (type));
+    append (buffer, uint32_t (id));
+    append (buffer, uint32_t (0));
+    return buffer.size () - sizeof (uint32_t);
+  }
+
+  void endRecord (std::string& buffer, std::size_t sizeOffset)
+  {
+    const uint32_t size = uint32_t (buffer.size () - sizeOffset - sizeof (uint32_t));
+    std::memcpy (&buffer[sizeOffset], &size, sizeof (uint32_t));
+  }
+
+  void appendMesh (std::string& buffer, unsigned int id, const ImportExport::FrozenMesh& frozen)
+  {
+    const Mesh&        mesh = frozen.mesh;
+    const unsigned int numFaces = mesh.numIndices () / 3;
+    const std::size_t  sizeOffset = beginRecord (buffer, RecordType::Mesh, id);
+
+    appendTransformation (buffer, mesh);
+    append (buffer, uint32_t (mesh.numVertices ()));
+    append (buffer, uint32_t (numFaces));
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      append (buffer, uint32_t (frozen.freeVertices.empty () ? false : frozen.freeVertices[i]));
+      append (buffer, mesh.vertex (i));
+      append (buffer, mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < numFaces; i++)
+    {
+      append (buffer, uint32_t (frozen.freeFaces.empty () ? false : frozen.freeFaces[i]));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 0)));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 1)));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 2)));
+    }
+    endRecord (buffer, sizeOffset);
+  }
+
+  /* The current data of all vertices and faces that are recorded by the tracked changes, and of
+   * all vertices and faces that were added since tracking started.
+   */
+  void appendChanges (std::string& buffer, const DynamicMesh& dynamicMesh)
+  {
+    const DynamicMeshChanges& changes = dynamicMesh.trackedChanges ();
+    const Mesh&               mesh = dynamicMesh.mesh ();
+    std::vector<unsigned int> vertices;
+    std::vector<unsigned int> faces;
+
+    for (const DynamicMeshChanges::Vertex& v : changes.vertices ())
+    {
+      if (v.index < changes.numVertices () && v.index < dynamicMesh.vertexCapacity ())
+      {
+        vertices.push_back (v.index);
+      }
+    }
+    for (unsigned int i = changes.numVertices (); i < dynamicMesh.vertexCapacity (); i++)
+    {
+      vertices.push_back (i);
+    }
+    for (const DynamicMeshChanges::Face& f : changes.faces ())
+    {
+      if (f.index < changes.numFaces () && f.index < dynamicMesh.faceCapacity ())
+      {
+        faces.push_back (f.index);
+      }
+    }
+    for (unsigned int i = changes.numFaces (); i < dynamicMesh.faceCapacity (); i++)
+    {
+      faces.push_back (i);
+    }
+
+    const std::size_t sizeOffset = beginRecord (buffer, RecordType::Changes, dynamicMesh.id ());
+
+    appendTransformation (buffer, mesh);
+    append (buffer, uint32_t (dynamicMesh.vertexCapacity ()));
+    append (buffer, uint32_t (dynamicMesh.faceCapacity ()));
+    append (buffer, uint32_t (vertices.size ()));
+    append (buffer, uint32_t (faces.size ()));
+
+    for (unsigned int i : vertices)
+    {
+      append (buffer, uint32_t (i));
+      append (buffer, uint32_t (dynamicMesh.isFreeVertex (i)));
+      append (buffer, mesh.vertex (i));
+      append (buffer, mesh.normal (i));
+    }
+    for (unsigned int i : faces)
+    {
+      append (buffer, uint32_t (i));
+      append (buffer, uint32_t (dynamicMesh.isFreeFace (i)));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 0)));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 1)));
+      append (buffer, uint32_t (mesh.index ((3 * i) + 2)));
+    }
+    endRecord (buffer, sizeOffset);
+  }
+
+  void appendDeletion (std::string& buffer, unsigned int id)
+  {
+    endRecord (buffer, beginRecord (buffer, RecordType::Deletion, id));
+  }
+
+  // sketch meshes are small, hence they are always recorded entirely
+  std::string sketchMeshesRecord (const std::vector<ImportExport::FrozenSketchMesh>& meshes)
+  {
+    ImportExport::FrozenScene sketchScene;
+    std::ostringstream        stream;
+    std::string               buffer;
+
+    sketchScene.sketchMeshes = meshes;
+    ImportExport::toBinaryDlyFile (stream, sketchScene);
+
+    const std::size_t sizeOffset = beginRecord (buffer, RecordType::SketchMeshes, 0);
+    buffer.append (stream.str ());
+    endRecord (buffer, sizeOffset);
+    return buffer;
+  }
+
+  bool writeCheckpoint (const std::string& fileName, const ImportExport::FrozenScene& scene,
+                        const std::vector<unsigned int>& ids)
+  {
+    QSaveFile file (QString::fromStdString (fileName));
+
+    if (file.open (QIODevice::WriteOnly))
+    {
+      std::string buffer (journalMagic, sizeof (journalMagic));
+
+      append (buffer, uint32_t (journalVersion));
+      file.write (buffer.data (), buffer.size ());
+
+      // linked meshes are recorded as unique meshes, which are not modified later on
+      for (unsigned int i = 0; i < scene.meshes.size (); i++)
+      {
+        buffer.clear ();
+        appendMesh (buffer, i < ids.size () ? ids[i] : Util::invalidIndex (), scene.meshes[i]);
+        file.write (buffer.data (), buffer.size ());
+      }
+      buffer = sketchMeshesRecord (scene.sketchMeshes);
+      file.write (buffer.data (), buffer.size ());
+
+      return file.commit ();
+    }
+    return false;
+  }
+
+  // reads from the memory of a mapped journal, whose values are copied
+  struct JournalReader
+  {
+    const unsigned char* data;
+    std::size_t          size;
+    std::size_t          position;
+
+    JournalReader (const unsigned char* d, std::size_t s)
+      : data (d)
+      , size (s)
+      , position (0)
+    {
+    }
+
+    bool isAtEnd () const { return this->position == this->size; }
+
+    template <typename T> bool read (T& value)
+    {
+      if (sizeof (T) > this->size - this->position)
+      {
+        return false;
+      }
+      std::memcpy (&value, this->data + this->position, sizeof (T));
+      this->position += sizeof (T);
+      return true;
+    }
+
+    bool readTransformation (Mesh& mesh)
+    {
+      glm::vec3   position, scaling;
+      glm::mat4x4 rotation;
+
+      if (this->read (position) && this->read (scaling) && this->read (rotation))
+      {
+        mesh.position (position);
+        mesh.scaling (scaling);
+        mesh.rotationMatrix (rotation);
+        return true;
+      }
+      return false;
+    }
+  };
+
+  // vertices and faces that are added by changes are free until they are recorded
+  void resize (ImportExport::FrozenMesh& frozen, unsigned int numVertices, unsigned int numFaces)
+  {
+    Mesh& mesh = frozen.mesh;
+
+    if (numVertices < mesh.numVertices ())
+    {
+      mesh.shrinkVertices (numVertices);
+    }
+    while (mesh.numVertices () < numVertices)
+    {
+      mesh.addVertex (glm::vec3 (0.0f));
+    }
+    if (3 * numFaces < mesh.numIndices ())
+    {
+      mesh.shrinkIndices (3 * numFaces);
+    }
+    while (mesh.numIndices () < 3 * numFaces)
+    {
+      mesh.addIndex (0);
+    }
+    frozen.freeVertices.resize (numVertices, true);
+    frozen.freeFaces.resize (numFaces, true);
+  }
+
+  bool readVertex (JournalReader& reader, ImportExport::FrozenMesh& frozen, unsigned int i)
+  {
+    uint32_t  isFree;
+    glm::vec3 position, normal;
+
+    if (i < frozen.mesh.numVertices () && reader.read (isFree) && reader.read (position) &&
+        reader.read (normal))
+    {
+      frozen.freeVertices[i] = isFree != 0;
+      frozen.mesh.vertex (i, position);
+      frozen.mesh.normal (i, normal);
+      return true;
+    }
+    return false;
+  }
+
+  bool readFace (JournalReader& reader, ImportExport::FrozenMesh& frozen, unsigned int i)
+  {
+    uint32_t isFree, i1, i2, i3;
+
+    if (3 * i < frozen.mesh.numIndices () && reader.read (isFree) && reader.read (i1) &&
+        reader.read (i2) && reader.read (i3))
+    {
+      frozen.freeFaces[i] = isFree != 0;
+      frozen.mesh.index ((3 * i) + 0, i1);
+      frozen.mesh.index ((3 * i) + 1, i2);
+      frozen.mesh.index ((3 * i) + 2, i3);
+      return true;
+    }
+    return false;
+  }
+
+  bool readMesh (JournalReader& reader, ImportExport::FrozenMesh& frozen)
+  {
+    uint32_t numVertices, numFaces;
+
+    if (reader.readTransformation (frozen.mesh) == false || reader.read (numVertices) == false ||
+        reader.read (numFaces) == false || numVertices > reader.size || numFaces > reader.size)
+    {
+      return false;
+    }
+    resize (frozen, numVertices, numFaces);
+
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+      if (readVertex (reader, frozen, i) == false)
+      {
+        return false;
+      }
+    }
+    for (uint32_t i = 0; i < numFaces; i++)
+    {
+      if (readFace (reader, frozen, i) == false)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool readChanges (JournalReader& reader, ImportExport::FrozenMesh& frozen)
+  {
+    uint32_t numVertices, numFaces, numRecordedVertices, numRecordedFaces;
+
+    if (reader.readTransformation (frozen.mesh) == false || reader.read (numVertices) == false ||
+        reader.read (numFaces) == false || reader.read (numRecordedVertices) == false ||
+        reader.read (numRecordedFaces) == false || numVertices > reader.size ||
+        numFaces > reader.size)
+    {
+      return false;
+    }
+    resize (frozen, numVertices, numFaces);
+
+    for (uint32_t i = 0; i < numRecordedVertices; i++)
+    {
+      uint32_t index;
+      if (reader.read (index) == false || readVertex (reader, frozen, index) == false)
+      {
+        return false;
+      }
+    }
+    for (uint32_t i = 0; i < numRecordedFaces; i++)
+    {
+      uint32_t index;
+      if (reader.read (index) == false || readFace (reader, frozen, index) == false)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // used faces must refer to used vertices
+  bool isConsistent (const ImportExport::FrozenMesh& frozen)
+  {
+    for (unsigned int i = 0; i < frozen.freeFaces.size (); i++)
+    {
+      if (frozen.freeFaces[i] == false)
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          const unsigned int v = frozen.mesh.index ((3 * i) + j);
+
+          if (v >= frozen.freeVertices.size () || frozen.freeVertices[v])
+          {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+}
+
+/* Records are appended to the file immediately, unless a checkpoint is being written: then they
+ * are buffered in `pending` and appended once the checkpoint has replaced the journal.  Meshes
+ * are recorded if their render key changed since they were recorded last.
+ */
+struct Journal::Impl
+{
+  bool                                          isActive;
+  std::size_t                                   checkpointSize;
+  std::string                                   fileName;
+  std::string                                   sceneFileName;
+  QFile                                         file;
+  std::unordered_map<unsigned int, std::size_t> renderKeys;
+  std::string                                   sketchMeshes;
+  std::string                                   pending;
+  std::string                                   buffer;
+  std::future<bool>                             checkpointing;
+
+  Impl (const Config& config)
+    : isActive (false)
+    , checkpointSize (0)
+  {
+    this->runFromConfig (config);
+  }
+
+  ~Impl () { this->reset (); }
+
+  static std::string path (const Scene& scene)
+  {
+    return scene.hasFileName () ? scene.fileName () + ".journal"
+                                : QDir::temp ().filePath ("dilay.journal").toStdString ();
+  }
+
+  static bool isJournal (const unsigned char* data, std::size_t size)
+  {
+    return size >= sizeof (journalMagic) &&
+           std::memcmp (data, journalMagic, sizeof (journalMagic)) == 0;
+  }
+
+  struct RecoveredMesh
+  {
+    bool                     isDeleted;
+    ImportExport::FrozenMesh mesh;
+  };
+
+  static bool fromJournal (const unsigned char* data, std::size_t size, const Config& config,
+                           Scene& scene)
+  {
+    assert (isJournal (data, size));
+
+    JournalReader                                 reader (data, size);
+    uint32_t                                      version;
+    std::vector<RecoveredMesh>                    meshes;
+    std::unordered_map<unsigned int, std::size_t> meshIndices;
+    const unsigned char*                          sketchMeshes = nullptr;
+    std::size_t                                   sketchMeshesSize = 0;
+
+    reader.position = sizeof (journalMagic);
+
+    if (reader.read (version) == false || version != journalVersion)
+    {
+      DILAY_WARN ("unsupported version of journal")
+      return false;
+    }
+
+    while (reader.isAtEnd () == false)
+    {
+      uint32_t type, id, recordSize;
+
+      if (reader.read (type) == false || reader.read (id) == false ||
+          reader.read (recordSize) == false || recordSize > reader.size - reader.position)
+      {
+        DILAY_WARN ("ignoring incomplete record at the end of the journal")
+        break;
+      }
+
+      JournalReader record (data + reader.position, recordSize);
+      const auto    it = meshIndices.find (id);
+      bool          isValid = true;
+
+      reader.position += recordSize;
+
+      switch (RecordType (type))
+      {
+        case RecordType::Mesh:
+          if (it == meshIndices.end ())
+          {
+            meshes.push_back (RecoveredMesh{false, ImportExport::FrozenMesh{Mesh (), {}, {}}});
+            if (id != Util::invalidIndex ())
+            {
+              meshIndices.emplace (id, meshes.size () - 1);
+            }
+            isValid = readMesh (record, meshes.back ().mesh);
+          }
+          else
+          {
+            meshes[it->second].mesh = ImportExport::FrozenMesh{Mesh (), {}, {}};
+            isValid = readMesh (record, meshes[it->second].mesh);
+          }
+          break;
+
+        case RecordType::Changes:
+          isValid = it != meshIndices.end () && readChanges (record, meshes[it->second].mesh);
+          break;
+
+        case RecordType::Deletion:
+          if (it != meshIndices.end ())
+          {
+            meshes[it->second].isDeleted = true;
+            meshIndices.erase (it);
+          }
+          break;
+
+        case RecordType::SketchMeshes:
+          sketchMeshes = record.data;
+          sketchMeshesSize = record.size;
+          break;
+
+        default:
+          isValid = false;
+          break;
+      }
+
+      if (isValid == false)
+      {
+        DILAY_WARN ("invalid record in journal")
+        return false;
+      }
+    }
+
+    ImportExport::FrozenScene frozen;
+    for (RecoveredMesh& mesh : meshes)
+    {
+      if (mesh.isDeleted == false)
+      {
+        if (isConsistent (mesh.mesh) == false)
+        {
+          DILAY_WARN ("inconsistent mesh in journal")
+          return false;
+        }
+        frozen.meshes.push_back (std::move (mesh.mesh));
+      }
+    }
+
+    if (ImportExport::fromFrozenScene (frozen, config, scene) == false)
+    {
+      return false;
+    }
+    else if (sketchMeshes)
+    {
+      return ImportExport::fromBinaryDlyFile (sketchMeshes, sketchMeshesSize, config, scene);
+    }
+    return true;
+  }
+
+  /* Replaces the journal by a checkpoint of the scene, which is written on a worker thread.  A
+   * previous journal at the same path remains until the checkpoint replaces it.
+   */
+  void checkpoint (Scene& scene)
+  {
+    const std::string newFileName = path (scene);
+
+    this->close ();
+    if (this->fileName.empty () == false && this->fileName != newFileName)
+    {
+      QFile::remove (QString::fromStdString (this->fileName));
+    }
+    this->renderKeys.clear ();
+
+    scene.loadDeferredMeshes ();
+
+    std::vector<unsigned int> ids;
+    scene.forEachConstMesh ([this, &ids](const DynamicMesh& mesh) {
+      ids.push_back (mesh.id ());
+      this->renderKeys.emplace (mesh.id (), mesh.renderKey ());
+    });
+
+    ImportExport::FrozenScene frozen = ImportExport::freeze (scene);
+
+    this->fileName = newFileName;
+    this->sceneFileName = scene.fileName ();
+    this->sketchMeshes = sketchMeshesRecord (frozen.sketchMeshes);
+
+    auto write = [fileName = this->fileName, frozen = std::move (frozen),
+                  ids = std::move (ids)]() { return writeCheckpoint (fileName, frozen, ids); };
+    this->checkpointing = std::async (std::launch::async, std::move (write));
+  }
+
+  // opens the new journal and appends pending records
+  void finishCheckpoint ()
+  {
+    assert (this->checkpointing.valid ());
+
+    this->file.setFileName (QString::fromStdString (this->fileName));
+
+    if (this->checkpointing.get () && this->file.open (QIODevice::WriteOnly | QIODevice::Append))
+    {
+      this->file.write (this->pending.data (), this->pending.size ());
+      this->file.flush ();
+    }
+    else
+    {
+      // the next record starts a new checkpoint
+      DILAY_WARN ("could not write journal %s", this->fileName.c_str ())
+      this->fileName.clear ();
+    }
+    this->pending.clear ();
+  }
+
+  void append (const std::string& records)
+  {
+    if (this->checkpointing.valid () &&
+        this->checkpointing.wait_for (std::chrono::seconds (0)) == std::future_status::ready)
+    {
+      this->finishCheckpoint ();
+    }
+
+    if (this->checkpointing.valid ())
+    {
+      this->pending.append (records);
+    }
+    else if (this->file.isOpen ())
+    {
+      this->file.write (records.data (), records.size ());
+      this->file.flush ();
+    }
+  }
+
+  std::size_t numBytes () const
+  {
+    return std::size_t (this->file.isOpen () ? this->file.size () : 0) + this->pending.size ();
+  }
+
+  void record (Scene& scene, bool all)
+  {
+    if (this->isActive == false)
+    {
+      return;
+    }
+    else if (this->fileName.empty () || this->sceneFileName != scene.fileName ())
+    {
+      this->checkpoint (scene);
+      return;
+    }
+
+    scene.loadDeferredMeshes ();
+
+    std::unordered_set<unsigned int> ids;
+
+    this->buffer.clear ();
+    scene.forEachConstMesh ([this, all, &ids](const DynamicMesh& mesh) {
+      const auto it = this->renderKeys.find (mesh.id ());
+
+      ids.insert (mesh.id ());
+
+      if (it == this->renderKeys.end ())
+      {
+        appendMesh (this->buffer, mesh.id (), ImportExport::freeze (mesh));
+        this->renderKeys.emplace (mesh.id (), mesh.renderKey ());
+      }
+      else if (it->second != mesh.renderKey ())
+      {
+        if (all == false && mesh.tracksChanges ())
+        {
+          appendChanges (this->buffer, mesh);
+        }
+        else
+        {
+          appendMesh (this->buffer, mesh.id (), ImportExport::freeze (mesh));
+        }
+        it->second = mesh.renderKey ();
+      }
+    });
+
+    for (auto it = this->renderKeys.begin (); it != this->renderKeys.end ();)
+    {
+      if (ids.count (it->first) == 0)
+      {
+        appendDeletion (this->buffer, it->first);
+        it = this->renderKeys.erase (it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    std::vector<ImportExport::FrozenSketchMesh> frozenSketchMeshes;
+    scene.forEachConstMesh ([&frozenSketchMeshes](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        frozenSketchMeshes.push_back (ImportExport::FrozenSketchMesh{mesh.tree (), mesh.paths ()});
+      }
+    });
+
+    std::string sketchMeshes = sketchMeshesRecord (frozenSketchMeshes);
+    if (sketchMeshes != this->sketchMeshes)
+    {
+      this->buffer.append (sketchMeshes);
+      this->sketchMeshes.swap (sketchMeshes);
+    }
+
+    if (this->buffer.empty () == false)
+    {
+      this->append (this->buffer);
+
+      if (this->checkpointing.valid () == false && this->numBytes () > this->checkpointSize)
+      {
+        this->checkpoint (scene);
+      }
+    }
+  }
+
+  void record (Scene& scene) { this->record (scene, false); }
+
+  void recordAll (Scene& scene) { this->record (scene, true); }
+
+  // waits for a pending checkpoint
+  void close ()
+  {
+    if (this->checkpointing.valid ())
+    {
+      this->checkpointing.wait ();
+      this->finishCheckpoint ();
+    }
+    if (this->file.isOpen ())
+    {
+      this->file.close ();
+    }
+  }
+
+  void reset ()
+  {
+    this->close ();
+
+    if (this->fileName.empty () == false)
+    {
+      QFile::remove (QString::fromStdString (this->fileName));
+    }
+    this->fileName.clear ();
+    this->sceneFileName.clear ();
+    this->renderKeys.clear ();
+    this->sketchMeshes.clear ();
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    this->isActive = config.get<bool> ("editor/journal/active");
+    this->checkpointSize =
+      std::size_t (config.get<int> ("editor/journal/checkpoint-size")) * 1024 * 1024;
+
+    if (this->isActive == false)
+    {
+      this->reset ();
+    }
+  }
+};
+
+DELEGATE1_BIG2 (Journal, const Config&)
+DELEGATE1_STATIC (std::string, Journal, path, const Scene&)
+DELEGATE2_STATIC (bool, Journal, isJournal, const unsigned char*, std::size_t)
+DELEGATE4_STATIC (bool, Journal, fromJournal, const unsigned char*, std::size_t, const Config&,
+                  Scene&)
+GETTER_CONST (bool, Journal, isActive)
+DELEGATE1 (void, Journal, record, Scene&)
+DELEGATE1 (void, Journal, recordAll, Scene&)
+DELEGATE (void, Journal, reset)
+DELEGATE1 (void, Journal, runFromConfig, const Config&)
@@ -0,0 +1,46 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_JOURNAL
+#define DILAY_JOURNAL
+
+#include <cstddef>
+#include <string>
+#include "configurable.hpp"
+#include "macro.hpp"
+
+class Scene;
+
+/* A journal appends compact records of committed edits to a file next to the scene (cf.
+ * `path`), so that edits since the last save can be recovered by opening the journal after a
+ * crash.  A journal starts with a checkpoint of the whole scene, which is written on a worker
+ * thread, and is checkpointed again if it exceeds `editor/journal/checkpoint-size`.  Modified
+ * meshes are recorded by the data of the vertices and faces that their tracked changes refer
+ * to.  Journals are removed when they are reset or destroyed, i.e., only journals of crashed
+ * sessions remain.
+ */
+class Journal : public Configurable
+{
+public:
+  DECLARE_BIG2 (Journal, const Config&)
+
+  static std::string path (const Scene&);
+  static bool        isJournal (const unsigned char*, std::size_t);
+  // restores the scene up to the last complete record
+  static bool        fromJournal (const unsigned char*, std::size_t, const Config&, Scene&);
+
+  bool isActive () const;
+  // records meshes by their tracked changes
+  void record (Scene&);
+  // records modified meshes entirely, e.g., after changes have been reverted
+  void recordAll (Scene&);
+  void reset ();
+
+private:
+  IMPLEMENTATION
+
+  void runFromConfig (const Config&);
+};
+
+#endif
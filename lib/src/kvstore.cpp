@@ -2,24 +2,99 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QByteArray>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDomNode>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
+#include <deque>
 #include <glm/glm.hpp>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "color.hpp"
 #include "kvstore.hpp"
 #include "util.hpp"
 #include "variant.hpp"
 #include "xml-conversion.hpp"
 
+namespace
+{
+  static const quint32 binaryMagic = 0x444b5653;
+  static const quint32 binaryVersion = 1;
+
+  enum class BinaryType : quint8
+  {
+    Float,
+    Integer,
+    Boolean,
+    Vector3f,
+    Vector2i,
+    Color
+  };
+
+  std::string binaryFileName (const std::string& fileName) { return fileName + ".bin"; }
+
+  void writeBinary (QDataStream& stream, float f) { stream << f; }
+  void writeBinary (QDataStream& stream, int i) { stream << qint32 (i); }
+  void writeBinary (QDataStream& stream, bool b) { stream << b; }
+  void writeBinary (QDataStream& stream, const glm::vec3& v) { stream << v.x << v.y << v.z; }
+  void writeBinary (QDataStream& stream, const glm::ivec2& v)
+  {
+    stream << qint32 (v.x) << qint32 (v.y);
+  }
+  void writeBinary (QDataStream& stream, const Color& c)
+  {
+    stream << c.r () << c.g () << c.b () << c.opacity ();
+  }
+
+  void readBinary (QDataStream& stream, float& f) { stream >> f; }
+  void readBinary (QDataStream& stream, int& i)
+  {
+    qint32 v;
+    stream >> v;
+    i = int(v);
+  }
+  void readBinary (QDataStream& stream, bool& b) { stream >> b; }
+  void readBinary (QDataStream& stream, glm::vec3& v) { stream >> v.x >> v.y >> v.z; }
+  void readBinary (QDataStream& stream, glm::ivec2& v)
+  {
+    qint32 x, y;
+    stream >> x >> y;
+    v = glm::ivec2 (x, y);
+  }
+  void readBinary (QDataStream& stream, Color& c)
+  {
+    float r, g, b, opacity;
+    stream >> r >> g >> b >> opacity;
+    c = Color (r, g, b, opacity);
+  }
+
+  // identifies the xml file from which a binary file has been written
+  void xmlStamp (const std::string& fileName, qint64& size, qint64& modified)
+  {
+    const QFileInfo info (fileName.c_str ());
+
+    size = info.size ();
+    modified = info.lastModified ().toMSecsSinceEpoch ();
+  }
+}
+
 struct KVStore::Impl
 {
   typedef Variant<float, int, bool, glm::vec3, glm::ivec2, Color> Value;
-  typedef std::unordered_map<std::string, Value>                  Map;
+  typedef std::unordered_map<std::string, unsigned int>           Keys;
+  typedef std::pair<std::string, Value>                           Entry;
 
-  const std::string root;
-  Map               map;
+  /* Paths are interned: each path is mapped to a fixed entry, so handles of paths stay
+   * valid even if their values are removed.  Entries are never moved, hence references to
+   * values stay valid while other paths are interned.
+   */
+  const std::string         root;
+  mutable Keys              keys;
+  mutable std::deque<Entry> entries;
 
   Impl (const std::string& r)
     : root (r)
@@ -42,44 +117,100 @@ struct KVStore::Impl
     }
   }
 
-  template <class T> const T& get (const std::string& p) const
+  Key key (const std::string& p) const
+  {
+    const std::string path = this->path (p);
+    const auto        it = this->keys.find (path);
+
+    if (it == this->keys.end ())
+    {
+      const unsigned int index = this->entries.size ();
+
+      this->keys.emplace (path, index);
+      this->entries.emplace_back (path, Value ());
+      return Key{index};
+    }
+    else
+    {
+      return Key{it->second};
+    }
+  }
+
+  const Value* find (const std::string& p) const
+  {
+    const auto it = this->keys.find (this->path (p));
+
+    if (it == this->keys.end () || this->entries[it->second].second.isSet () == false)
+    {
+      return nullptr;
+    }
+    else
+    {
+      return &this->entries[it->second].second;
+    }
+  }
+
+  const Value* find (const Key& key) const
+  {
+    assert (key.index < this->entries.size ());
+
+    const Value& value = this->entries[key.index].second;
+    return value.isSet () ? &value : nullptr;
+  }
+
+  std::string pathOf (const std::string& p) const { return this->path (p); }
+
+  std::string pathOf (const Key& key) const { return this->entries[key.index].first; }
+
+  template <class T, class K> const T& get (const K& k) const
   {
-    Map::const_iterator value = this->map.find (this->path (p));
+    const Value* value = this->find (k);
 
-    if (value == this->map.end ())
+    if (value == nullptr)
     {
-      throw (std::runtime_error ("Can not find path '" + this->path (p) + "' in kv-store"));
+      throw (std::runtime_error ("Can not find path '" + this->pathOf (k) + "' in kv-store"));
     }
     else
     {
-      return value->second.get<T> ();
+      return value->get<T> ();
     }
   }
 
-  template <class T> const T& get (const std::string& p, const T& defaultV) const
+  template <class T, class K> const T& get (const K& k, const T& defaultV) const
   {
-    Map::const_iterator value = this->map.find (this->path (p));
+    const Value* value = this->find (k);
 
-    if (value == this->map.end ())
+    if (value == nullptr)
     {
       return defaultV;
     }
     else
     {
-      return value->second.get<T> ();
+      return value->get<T> ();
     }
   }
 
-  template <class T> void set (const std::string& p, const T& t)
+  template <class T> void set (const Key& key, const T& t)
   {
-    this->remove (p);
+    assert (key.index < this->entries.size ());
+    this->entries[key.index].second.set<T> (t);
+  }
 
-    Value value;
-    value.set<T> (t);
-    this->map.emplace (this->path (p), value);
+  template <class T> void set (const std::string& p, const T& t)
+  {
+    this->set<T> (this->key (p), t);
   }
 
   void fromFile (const std::string& fileName)
+  {
+    if (this->fromBinaryFile (fileName) == false)
+    {
+      this->fromXmlFile (fileName);
+      this->toBinaryFile (fileName);
+    }
+  }
+
+  void fromXmlFile (const std::string& fileName)
   {
     Util::withCLocale<void> ([this, &fileName]() {
       QFile file (fileName.c_str ());
@@ -188,18 +319,182 @@ struct KVStore::Impl
     return ok;
   }
 
+  template <typename T>
+  static bool readBinaryEntry (QDataStream& stream, const std::string& path,
+                               std::vector<Entry>& entries)
+  {
+    T t;
+    readBinary (stream, t);
+
+    entries.emplace_back (path, Value ());
+    entries.back ().second.set<T> (t);
+    return stream.status () == QDataStream::Ok;
+  }
+
+  /* A binary file caches the contents of an xml file and is only read if it has been written
+   * from the current version of that file.  Otherwise `false` is returned.
+   */
+  bool fromBinaryFile (const std::string& fileName)
+  {
+    QFile file (binaryFileName (fileName).c_str ());
+
+    if (file.open (QIODevice::ReadOnly) == false)
+    {
+      return false;
+    }
+    QDataStream stream (&file);
+    quint32     magic, version, numEntries;
+    qint64      size, modified, xmlSize, xmlModified;
+
+    stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+    stream >> magic >> version >> size >> modified >> numEntries;
+    xmlStamp (fileName, xmlSize, xmlModified);
+
+    if (stream.status () != QDataStream::Ok || magic != binaryMagic ||
+        version != binaryVersion || size != xmlSize || modified != xmlModified)
+    {
+      return false;
+    }
+
+    std::vector<Entry> loaded;
+    loaded.reserve (numEntries);
+
+    for (quint32 i = 0; i < numEntries; i++)
+    {
+      QByteArray key;
+      quint8     type;
+      bool       ok = false;
+
+      stream >> key >> type;
+
+      const std::string path (key.constData (), key.size ());
+
+      if (stream.status () != QDataStream::Ok || path.find ("/" + this->root + "/") != 0)
+      {
+        return false;
+      }
+      switch (BinaryType (type))
+      {
+        case BinaryType::Float:
+          ok = readBinaryEntry<float> (stream, path, loaded);
+          break;
+        case BinaryType::Integer:
+          ok = readBinaryEntry<int> (stream, path, loaded);
+          break;
+        case BinaryType::Boolean:
+          ok = readBinaryEntry<bool> (stream, path, loaded);
+          break;
+        case BinaryType::Vector3f:
+          ok = readBinaryEntry<glm::vec3> (stream, path, loaded);
+          break;
+        case BinaryType::Vector2i:
+          ok = readBinaryEntry<glm::ivec2> (stream, path, loaded);
+          break;
+        case BinaryType::Color:
+          ok = readBinaryEntry<Color> (stream, path, loaded);
+          break;
+      }
+      if (ok == false)
+      {
+        return false;
+      }
+    }
+
+    for (Entry& e : loaded)
+    {
+      this->entries[this->key (e.first).index].second = std::move (e.second);
+    }
+    return true;
+  }
+
+  template <typename T>
+  static void writeBinaryEntry (QDataStream& stream, BinaryType type, const Entry& entry)
+  {
+    stream << QByteArray (entry.first.c_str (), int(entry.first.size ())) << quint8 (type);
+    writeBinary (stream, entry.second.get<T> ());
+  }
+
+  // failures are ignored, since binary files are caches that can be rebuilt
+  void toBinaryFile (const std::string& fileName) const
+  {
+    QFile file (binaryFileName (fileName).c_str ());
+
+    if (file.open (QIODevice::WriteOnly))
+    {
+      QDataStream stream (&file);
+      quint32     numEntries = 0;
+      qint64      size, modified;
+
+      for (const Entry& e : this->entries)
+      {
+        numEntries += e.second.isSet () ? 1 : 0;
+      }
+      xmlStamp (fileName, size, modified);
+      stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+      stream << binaryMagic << binaryVersion << size << modified << numEntries;
+
+      for (const Entry& e : this->entries)
+      {
+        const Value& value = e.second;
+
+        if (value.isSet () == false)
+        {
+        }
+        else if (value.is<float> ())
+        {
+          writeBinaryEntry<float> (stream, BinaryType::Float, e);
+        }
+        else if (value.is<int> ())
+        {
+          writeBinaryEntry<int> (stream, BinaryType::Integer, e);
+        }
+        else if (value.is<bool> ())
+        {
+          writeBinaryEntry<bool> (stream, BinaryType::Boolean, e);
+        }
+        else if (value.is<glm::vec3> ())
+        {
+          writeBinaryEntry<glm::vec3> (stream, BinaryType::Vector3f, e);
+        }
+        else if (value.is<glm::ivec2> ())
+        {
+          writeBinaryEntry<glm::ivec2> (stream, BinaryType::Vector2i, e);
+        }
+        else if (value.is<Color> ())
+        {
+          writeBinaryEntry<Color> (stream, BinaryType::Color, e);
+        }
+        else
+          DILAY_IMPOSSIBLE
+      }
+      file.close ();
+
+      if (stream.status () != QDataStream::Ok)
+      {
+        file.remove ();
+      }
+    }
+  }
+
   void toFile (const std::string& fileName) const
+  {
+    this->toXmlFile (fileName);
+    this->toBinaryFile (fileName);
+  }
+
+  void toXmlFile (const std::string& fileName) const
   {
     Util::withCLocale<void> ([this, &fileName]() {
       QDomDocument doc;
 
-      for (auto& c : this->map)
+      for (const Entry& e : this->entries)
       {
-        const std::string& key = c.first;
-        const Value&       value = c.second;
-        QStringList        path = QString (key.c_str ()).split ("/", QString::SkipEmptyParts);
+        if (e.second.isSet ())
+        {
+          QStringList path = QString (e.first.c_str ()).split ("/", QString::SkipEmptyParts);
 
-        this->appendAsDomChild (doc, doc, path, value);
+          this->appendAsDomChild (doc, doc, path, e.second);
+        }
       }
       if (doc.isNull () == false)
       {
@@ -275,12 +570,27 @@ struct KVStore::Impl
     }
   }
 
-  void remove (const std::string& p) { this->map.erase (this->path (p)); }
+  void remove (const std::string& p)
+  {
+    const auto it = this->keys.find (this->path (p));
+
+    if (it != this->keys.end ())
+    {
+      this->entries[it->second].second.release ();
+    }
+  }
 
-  void reset () { this->map.clear (); }
+  void reset ()
+  {
+    for (Entry& e : this->entries)
+    {
+      e.second.release ();
+    }
+  }
 };
 
 DELEGATE1_BIG2 (KVStore, const std::string&)
+DELEGATE1_CONST (KVStore::Key, KVStore, key, const std::string&);
 DELEGATE1 (void, KVStore, fromFile, const std::string&);
 DELEGATE1_CONST (void, KVStore, toFile, const std::string&);
 DELEGATE1 (void, KVStore, remove, const std::string&);
@@ -301,21 +611,54 @@ template <class T> void KVStore::set (const std::string& path, const T& value)
   return this->impl->set<T> (path, value);
 }
 
+template <class T> const T& KVStore::get (const Key& key) const
+{
+  return this->impl->get<T> (key);
+}
+
+template <class T> const T& KVStore::get (const Key& key, const T& defaultV) const
+{
+  return this->impl->get<T> (key, defaultV);
+}
+
+template <class T> void KVStore::set (const Key& key, const T& value)
+{
+  return this->impl->set<T> (key, value);
+}
+
 template const float&      KVStore::get<float> (const std::string&) const;
 template const float&      KVStore::get<float> (const std::string&, const float&) const;
 template void              KVStore::set<float> (const std::string&, const float&);
+template const float&      KVStore::get<float> (const KVStore::Key&) const;
+template const float&      KVStore::get<float> (const KVStore::Key&, const float&) const;
+template void              KVStore::set<float> (const KVStore::Key&, const float&);
 template const int&        KVStore::get<int> (const std::string&) const;
 template const int&        KVStore::get<int> (const std::string&, const int&) const;
 template void              KVStore::set<int> (const std::string&, const int&);
+template const int&        KVStore::get<int> (const KVStore::Key&) const;
+template const int&        KVStore::get<int> (const KVStore::Key&, const int&) const;
+template void              KVStore::set<int> (const KVStore::Key&, const int&);
 template const bool&       KVStore::get<bool> (const std::string&) const;
 template const bool&       KVStore::get<bool> (const std::string&, const bool&) const;
 template void              KVStore::set<bool> (const std::string&, const bool&);
+template const bool&       KVStore::get<bool> (const KVStore::Key&) const;
+template const bool&       KVStore::get<bool> (const KVStore::Key&, const bool&) const;
+template void              KVStore::set<bool> (const KVStore::Key&, const bool&);
 template const Color&      KVStore::get<Color> (const std::string&) const;
 template const Color&      KVStore::get<Color> (const std::string&, const Color&) const;
 template void              KVStore::set<Color> (const std::string&, const Color&);
+template const Color&      KVStore::get<Color> (const KVStore::Key&) const;
+template const Color&      KVStore::get<Color> (const KVStore::Key&, const Color&) const;
+template void              KVStore::set<Color> (const KVStore::Key&, const Color&);
 template const glm::vec3&  KVStore::get<glm::vec3> (const std::string&) const;
 template const glm::vec3&  KVStore::get<glm::vec3> (const std::string&, const glm::vec3&) const;
 template void              KVStore::set<glm::vec3> (const std::string&, const glm::vec3&);
+template const glm::vec3&  KVStore::get<glm::vec3> (const KVStore::Key&) const;
+template const glm::vec3&  KVStore::get<glm::vec3> (const KVStore::Key&, const glm::vec3&) const;
+template void              KVStore::set<glm::vec3> (const KVStore::Key&, const glm::vec3&);
 template const glm::ivec2& KVStore::get<glm::ivec2> (const std::string&) const;
 template const glm::ivec2& KVStore::get<glm::ivec2> (const std::string&, const glm::ivec2&) const;
 template void              KVStore::set<glm::ivec2> (const std::string&, const glm::ivec2&);
+template const glm::ivec2& KVStore::get<glm::ivec2> (const KVStore::Key&) const;
+template const glm::ivec2& KVStore::get<glm::ivec2> (const KVStore::Key&, const glm::ivec2&) const;
+template void              KVStore::set<glm::ivec2> (const KVStore::Key&, const glm::ivec2&);
@@ -13,10 +13,22 @@ class KVStore
 public:
   DECLARE_BIG2 (KVStore, const std::string&)
 
+  // handle of an interned path, which saves building and hashing the path on each access
+  struct Key
+  {
+    unsigned int index;
+  };
+
+  Key key (const std::string&) const;
+
   template <class T> const T& get (const std::string&) const;
   template <class T> const T& get (const std::string&, const T&) const;
   template <class T> void     set (const std::string&, const T&);
+  template <class T> const T& get (const Key&) const;
+  template <class T> const T& get (const Key&, const T&) const;
+  template <class T> void     set (const Key&, const T&);
 
+  // files are cached in binary files next to them, which are preferred if they are up to date
   void fromFile (const std::string&);
   void toFile (const std::string&) const;
   void remove (const std::string&);
@@ -1,15 +1,26 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
 #include <ctime>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include "log.hpp"
 #include "util.hpp"
 
 namespace
 {
-  static std::FILE*  fileHandle = nullptr;
-  static std::string filePath;
-  static std::time_t startTime;
+  // the number of slots must be a power of two
+  constexpr unsigned int numSlots = 1 << 10;
+  // longer messages are truncated
+  constexpr unsigned int maxMessageLength = 512;
+  constexpr unsigned int numRateLimits = 1 << 8;
+  constexpr unsigned int maxMessagesPerSecond = 10;
+  constexpr unsigned int flushMilliseconds = 100;
 
   const char* levelToString (Log::Level level)
   {
@@ -25,28 +36,311 @@ namespace
     return nullptr;
   }
 
-  void shutdown ()
+  struct Slot
   {
-    if (fileHandle)
+    std::atomic<unsigned int> sequence;
+    Log::Level                level;
+    const char*               file;
+    unsigned int              line;
+    unsigned int              time;
+    unsigned int              numSuppressed;
+    char                      message[maxMessageLength];
+  };
+
+  /* Limits the messages of each call site per second.  Call sites are hashed, so that sites
+   * sharing an entry share their limit.  Counters are updated without locks and may be slightly
+   * off when sites log concurrently.
+   */
+  struct RateLimit
+  {
+    std::atomic<unsigned int> second;
+    std::atomic<unsigned int> count;
+    std::atomic<unsigned int> numSuppressed;
+  };
+
+  /* Messages are formatted by the logging thread into a bounded multi-producer queue of slots
+   * (cf. Vyukov's bounded queue), and are written by a flusher thread, which wakes up
+   * periodically or on warnings.  Logging never blocks: messages are dropped and counted if the
+   * queue is full.  Panics are written synchronously, since the program aborts afterwards.
+   */
+  struct Logger
+  {
+    std::vector<Slot>         slots;
+    std::vector<RateLimit>    rateLimits;
+    std::atomic<unsigned int> enqueuePosition;
+    std::atomic<unsigned int> numDropped;
+    std::time_t               startTime;
+
+    // the file and the dequeue position are guarded by `writeMutex`
+    std::mutex   writeMutex;
+    unsigned int dequeuePosition;
+    std::FILE*   fileHandle;
+    std::string  filePath;
+
+    std::mutex              wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool>       stop;
+    std::thread             flusher;
+
+    Logger ()
+      : slots (numSlots)
+      , rateLimits (numRateLimits)
+      , enqueuePosition (0)
+      , numDropped (0)
+      , startTime (std::time (nullptr))
+      , dequeuePosition (0)
+      , fileHandle (nullptr)
+      , stop (false)
+    {
+      for (unsigned int i = 0; i < numSlots; i++)
+      {
+        this->slots[i].sequence.store (i, std::memory_order_relaxed);
+      }
+      for (RateLimit& r : this->rateLimits)
+      {
+        r.second.store (0, std::memory_order_relaxed);
+        r.count.store (0, std::memory_order_relaxed);
+        r.numSuppressed.store (0, std::memory_order_relaxed);
+      }
+      this->flusher = std::thread ([this]() { this->runFlusher (); });
+    }
+
+    ~Logger () { this->shutdown (false); }
+
+    unsigned int secondsSinceStart () const
     {
-      std::fclose (fileHandle);
-      std::remove (filePath.c_str ());
+      return (unsigned int) std::difftime (std::time (nullptr), this->startTime);
     }
+
+    bool admit (const char* file, unsigned int line, unsigned int time,
+                unsigned int& numSuppressed)
+    {
+      const std::uintptr_t hash = (reinterpret_cast<std::uintptr_t> (file) * 31) + line;
+      RateLimit&           r = this->rateLimits[hash % numRateLimits];
+      unsigned int         second = r.second.load (std::memory_order_relaxed);
+
+      if (second != time && r.second.compare_exchange_strong (second, time))
+      {
+        r.count.store (0, std::memory_order_relaxed);
+      }
+      if (r.count.fetch_add (1, std::memory_order_relaxed) < maxMessagesPerSecond)
+      {
+        numSuppressed = r.numSuppressed.exchange (0, std::memory_order_relaxed);
+        return true;
+      }
+      r.numSuppressed.fetch_add (1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // returns nullptr if the queue is full
+    Slot* claimSlot (unsigned int& position)
+    {
+      position = this->enqueuePosition.load (std::memory_order_relaxed);
+
+      while (true)
+      {
+        Slot&     slot = this->slots[position & (numSlots - 1)];
+        const int diff = int(slot.sequence.load (std::memory_order_acquire)) - int(position);
+
+        if (diff == 0)
+        {
+          if (this->enqueuePosition.compare_exchange_weak (position, position + 1,
+                                                           std::memory_order_relaxed))
+          {
+            return &slot;
+          }
+        }
+        else if (diff < 0)
+        {
+          return nullptr;
+        }
+        else
+        {
+          position = this->enqueuePosition.load (std::memory_order_relaxed);
+        }
+      }
+    }
+
+    void log (Log::Level level, const char* file, unsigned int line, const char* format,
+              va_list args)
+    {
+      const unsigned int time = this->secondsSinceStart ();
+      unsigned int       numSuppressed = 0;
+
+      if (level == Log::Level::Panic)
+      {
+        char message[maxMessageLength];
+        std::vsnprintf (message, maxMessageLength, format, args);
+
+        std::lock_guard<std::mutex> lock (this->writeMutex);
+        this->drain ();
+        this->write (level, file, line, time, 0, message);
+      }
+      else if (this->admit (file, line, time, numSuppressed))
+      {
+        unsigned int position;
+        Slot*        slot = this->claimSlot (position);
+
+        if (slot)
+        {
+          slot->level = level;
+          slot->file = file;
+          slot->line = line;
+          slot->time = time;
+          slot->numSuppressed = numSuppressed;
+          std::vsnprintf (slot->message, maxMessageLength, format, args);
+          slot->sequence.store (position + 1, std::memory_order_release);
+
+          // messages are written synchronously once the flusher has stopped
+          if (this->stop)
+          {
+            this->flush ();
+          }
+          else if (level != Log::Level::Info)
+          {
+            this->wake.notify_one ();
+          }
+        }
+        else
+        {
+          this->numDropped.fetch_add (1, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    void write (Log::Level level, const char* file, unsigned int line, unsigned int time,
+                unsigned int numSuppressed, const char* message)
+    {
+      const auto writeTo = [=](std::FILE* handle) {
+        std::fprintf (handle, "%09u [%s] %s (%u): %s", time, levelToString (level), file, line,
+                      message);
+        if (numSuppressed > 0)
+        {
+          std::fprintf (handle, " (%u similar messages suppressed)", numSuppressed);
+        }
+        std::fprintf (handle, "\n");
+      };
+
+      if (this->fileHandle)
+      {
+        writeTo (this->fileHandle);
+      }
+      if (level != Log::Level::Info)
+      {
+        writeTo (stderr);
+      }
+    }
+
+    // writes all queued messages, which requires `writeMutex`
+    void drain ()
+    {
+      while (true)
+      {
+        Slot& slot = this->slots[this->dequeuePosition & (numSlots - 1)];
+
+        if (slot.sequence.load (std::memory_order_acquire) != this->dequeuePosition + 1)
+        {
+          break;
+        }
+        this->write (slot.level, slot.file, slot.line, slot.time, slot.numSuppressed,
+                     slot.message);
+        slot.sequence.store (this->dequeuePosition + numSlots, std::memory_order_release);
+        this->dequeuePosition++;
+      }
+
+      const unsigned int numDropped = this->numDropped.exchange (0, std::memory_order_relaxed);
+      if (numDropped > 0 && this->fileHandle)
+      {
+        std::fprintf (this->fileHandle, "%09u [%s] %u messages dropped\n",
+                      this->secondsSinceStart (), levelToString (Log::Level::Warning),
+                      numDropped);
+      }
+      if (this->fileHandle)
+      {
+        std::fflush (this->fileHandle);
+      }
+    }
+
+    void flush ()
+    {
+      std::lock_guard<std::mutex> lock (this->writeMutex);
+      this->drain ();
+    }
+
+    void runFlusher ()
+    {
+      std::unique_lock<std::mutex> lock (this->wakeMutex);
+
+      while (this->stop == false)
+      {
+        this->wake.wait_for (lock, std::chrono::milliseconds (flushMilliseconds));
+        lock.unlock ();
+        this->flush ();
+        lock.lock ();
+      }
+    }
+
+    void initialize (const std::string& path)
+    {
+      std::lock_guard<std::mutex> lock (this->writeMutex);
+      assert (this->fileHandle == nullptr);
+
+      this->fileHandle = std::fopen (path.c_str (), "w");
+
+      if (this->fileHandle)
+      {
+        this->filePath = path;
+        this->startTime = std::time (nullptr);
+      }
+    }
+
+    // the log file is removed on regular exits, so that only logs of crashes remain
+    void shutdown (bool removeFile)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->wakeMutex);
+        this->stop = true;
+      }
+      this->wake.notify_one ();
+
+      if (this->flusher.joinable ())
+      {
+        this->flusher.join ();
+      }
+
+      std::lock_guard<std::mutex> lock (this->writeMutex);
+      this->drain ();
+
+      if (this->fileHandle)
+      {
+        std::fclose (this->fileHandle);
+        this->fileHandle = nullptr;
+
+        if (removeFile)
+        {
+          std::remove (this->filePath.c_str ());
+        }
+      }
+    }
+  };
+
+  Logger& logger ()
+  {
+    static Logger l;
+    return l;
   }
+
+  void shutdown () { logger ().shutdown (true); }
 }
 
 namespace Log
 {
   void initialize (const std::string& path)
   {
-    assert (fileHandle == nullptr);
-
-    fileHandle = std::fopen (path.c_str (), "w");
+    logger ().initialize (path);
 
-    if (fileHandle)
+    if (logger ().fileHandle)
     {
-      filePath = path;
-      startTime = std::time (nullptr);
       std::atexit (shutdown);
     }
     else
@@ -57,31 +351,12 @@ namespace Log
 
   void log (Log::Level level, const char* file, unsigned int line, const char* format, ...)
   {
-    const unsigned int secDiff = (unsigned int) std::difftime (std::time (nullptr), startTime);
-
-    va_list args1;
-    va_list args2;
-
-    va_start (args1, format);
-    va_copy (args2, args1);
+    va_list args;
 
-    std::vector<char> buffer (1 + std::vsnprintf (nullptr, 0, format, args1));
-    va_end (args1);
-
-    std::vsnprintf (buffer.data (), buffer.size (), format, args2);
-    va_end (args2);
-
-    if (fileHandle)
-    {
-      std::fprintf (fileHandle, "%09u [%s] %s (%u): %s\n", secDiff, levelToString (level), file,
-                    line, buffer.data ());
-      std::fflush (fileHandle);
-    }
-
-    if (level != Log::Level::Info)
-    {
-      std::fprintf (stderr, "%09u [%s] %s (%u): %s\n", secDiff, levelToString (level), file, line,
-                    buffer.data ());
-    }
+    va_start (args, format);
+    logger ().log (level, file, line, format, args);
+    va_end (args);
   }
+
+  void flush () { logger ().flush (); }
 }
@@ -17,7 +17,10 @@ namespace Log
   };
 
   void initialize (const std::string&);
+  // queues a message, which is written asynchronously unless it is a panic
   void log (Level, const char*, unsigned int, const char*, ...);
+  // writes all queued messages
+  void flush ();
 }
 
 #endif
@@ -7,6 +7,9 @@
 
 #include <cassert>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template <typename T> class Maybe
 {
@@ -110,4 +113,149 @@ private:
   std::unique_ptr<T> value;
 };
 
+/* Stores its value inline instead of on the heap, so that copies of small values (e.g., in
+ * per-event tool code) do not allocate.  Its interface equals `Maybe`, except for owning pointers.
+ */
+template <typename T> class MaybeInline
+{
+  static_assert (std::is_pointer<T>::value == false, "MaybeInline does not support pointers");
+  static_assert (std::is_reference<T>::value == false, "MaybeInline does not support references");
+
+public:
+  MaybeInline ()
+    : _hasValue (false)
+  {
+  }
+
+  MaybeInline (const T& v)
+    : _hasValue (false)
+  {
+    this->emplace (v);
+  }
+
+  MaybeInline (T&& v)
+    : _hasValue (false)
+  {
+    this->emplace (std::move (v));
+  }
+
+  MaybeInline (const MaybeInline<T>& o)
+    : _hasValue (false)
+  {
+    if (o.hasValue ())
+    {
+      this->emplace (*o);
+    }
+  }
+
+  // like `Maybe`, a moved-from instance has no value
+  MaybeInline (MaybeInline<T>&& o)
+    : _hasValue (false)
+  {
+    if (o.hasValue ())
+    {
+      this->emplace (std::move (*o));
+      o.reset ();
+    }
+  }
+
+  template <typename... Args> static MaybeInline<T> make (Args&&... args)
+  {
+    MaybeInline<T> m;
+    m.emplace (std::forward<Args> (args)...);
+    return m;
+  }
+
+  ~MaybeInline () { this->reset (); }
+
+  MaybeInline<T>& operator= (const T& v)
+  {
+    if (this->get () != &v)
+    {
+      this->reset ();
+      this->emplace (v);
+    }
+    return *this;
+  }
+
+  MaybeInline<T>& operator= (const MaybeInline<T>& o)
+  {
+    if (this != &o)
+    {
+      this->reset ();
+      if (o.hasValue ())
+      {
+        this->emplace (*o);
+      }
+    }
+    return *this;
+  }
+
+  MaybeInline<T>& operator= (MaybeInline<T>&& o)
+  {
+    if (this != &o)
+    {
+      this->reset ();
+      if (o.hasValue ())
+      {
+        this->emplace (std::move (*o));
+        o.reset ();
+      }
+    }
+    return *this;
+  }
+
+  explicit operator bool () const { return this->hasValue (); }
+
+  bool operator== (bool v) const { return this->operator bool () == v; }
+
+  T& operator* ()
+  {
+    assert (this->hasValue ());
+    return *this->pointer ();
+  }
+
+  const T& operator* () const
+  {
+    assert (this->hasValue ());
+    return *this->pointer ();
+  }
+
+  T* operator-> () { return this->get (); }
+
+  const T* operator-> () const { return this->get (); }
+
+  T* get () { return this->_hasValue ? this->pointer () : nullptr; }
+
+  const T* get () const { return this->_hasValue ? this->pointer () : nullptr; }
+
+  bool hasValue () const { return this->_hasValue; }
+
+  void reset ()
+  {
+    if (this->_hasValue)
+    {
+      this->pointer ()->~T ();
+      this->_hasValue = false;
+    }
+  }
+
+  void swap (MaybeInline<T>& o) { std::swap (*this, o); }
+
+  template <typename... Args> T& emplace (Args&&... args)
+  {
+    this->reset ();
+    new (&this->storage) T (std::forward<Args> (args)...);
+    this->_hasValue = true;
+    return *this->pointer ();
+  }
+
+private:
+  T*       pointer () { return reinterpret_cast<T*> (&this->storage); }
+  const T* pointer () const { return reinterpret_cast<const T*> (&this->storage); }
+
+  typename std::aligned_storage<sizeof (T), alignof (T)>::type storage;
+  bool                                                        _hasValue;
+};
+
 #endif
@@ -0,0 +1,61 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "history.hpp"
+#include "memory-governor.hpp"
+#include "scene.hpp"
+#include "util.hpp"
+
+struct MemoryGovernor::Impl
+{
+  std::size_t budget;
+  Step        lastStep;
+
+  Impl ()
+    : budget (0)
+    , lastStep (Step::None)
+  {
+  }
+
+  // an unknown resident memory never exceeds the budget
+  Step update (Scene& scene, History& history)
+  {
+    const std::size_t residentMemory = this->budget > 0 ? Util::residentMemory () : 0;
+
+    if (residentMemory <= this->budget)
+    {
+      this->lastStep = Step::None;
+      return Step::None;
+    }
+
+    switch (this->lastStep)
+    {
+      case Step::None:
+        scene.releaseCaches ();
+        this->lastStep = Step::ReleaseCaches;
+        break;
+      case Step::ReleaseCaches:
+        history.relieveMemory ();
+        this->lastStep = Step::RelieveHistory;
+        break;
+      case Step::RelieveHistory:
+        scene.releaseStagingBuffers ();
+        this->lastStep = Step::ReleaseStagingBuffers;
+        break;
+      case Step::ReleaseStagingBuffers:
+        DILAY_WARN ("resident memory of %u MiB exceeds the budget of %u MiB",
+                    (unsigned int) (residentMemory >> 20), (unsigned int) (this->budget >> 20));
+        this->lastStep = Step::Warn;
+        return Step::Warn;
+      case Step::Warn:
+        return Step::None;
+    }
+    Util::releaseFreeMemory ();
+    return this->lastStep;
+  }
+};
+
+DELEGATE_BIG3 (MemoryGovernor)
+SETTER (std::size_t, MemoryGovernor, budget)
+DELEGATE2 (MemoryGovernor::Step, MemoryGovernor, update, Scene&, History&)
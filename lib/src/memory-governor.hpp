@@ -0,0 +1,43 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MEMORY_GOVERNOR
+#define DILAY_MEMORY_GOVERNOR
+
+#include <cstddef>
+#include "macro.hpp"
+
+class History;
+class Scene;
+
+/* Responds to memory pressure, i.e., to a resident memory of the process that exceeds a budget.
+ * Each update under pressure takes the next step, so that the effect of a step is measured
+ * before the next one is taken: the caches of meshes are dropped, the snapshots of the history
+ * are compressed and spilled, the staging buffers of meshes are released, and finally the user
+ * is warned.  The steps start over once the process fits into its budget again.
+ */
+class MemoryGovernor
+{
+public:
+  DECLARE_BIG3 (MemoryGovernor)
+
+  enum class Step
+  {
+    None,
+    ReleaseCaches,
+    RelieveHistory,
+    ReleaseStagingBuffers,
+    Warn
+  };
+
+  // the budget in bytes, where 0 disables the governor
+  void budget (std::size_t);
+  // returns the step that has been taken, which requires a current context
+  Step update (Scene&, History&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,159 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <vector>
+#include "mesh-instances.hpp"
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+
+namespace
+{
+  // a model matrix followed by its normal matrix
+  constexpr unsigned int numFloats = 16 + 9;
+  constexpr unsigned int stride = numFloats * sizeof (float);
+}
+
+struct MeshInstances::Impl
+{
+  std::vector<float> data;
+  unsigned int       numInstances;
+  unsigned int       numBufferedInstances;
+  bool               isDirty;
+  OpenGLBufferId     bufferId;
+
+  Impl ()
+    : numInstances (0)
+    , numBufferedInstances (0)
+    , isDirty (false)
+  {
+  }
+
+  Impl (const Impl& other)
+    : data (other.data)
+    , numInstances (other.numInstances)
+    , numBufferedInstances (0)
+    , isDirty (true)
+  {
+  }
+
+  const float* model (unsigned int i) const
+  {
+    assert (i < this->numInstances);
+    return &this->data[numFloats * i];
+  }
+
+  const float* modelNormal (unsigned int i) const { return this->model (i) + 16; }
+
+  void reset () { this->numInstances = 0; }
+
+  void add (const glm::mat4x4& model)
+  {
+    const glm::mat3x3  modelNormal = glm::inverseTranspose (glm::mat3x3 (model));
+    const unsigned int offset = numFloats * this->numInstances;
+
+    if (this->data.size () < offset + numFloats)
+    {
+      this->data.resize (offset + numFloats, 0.0f);
+      this->isDirty = true;
+    }
+
+    const auto set = [this](unsigned int i, float value) {
+      if (this->data[i] != value)
+      {
+        this->data[i] = value;
+        this->isDirty = true;
+      }
+    };
+
+    for (unsigned int c = 0; c < 4; c++)
+    {
+      for (unsigned int r = 0; r < 4; r++)
+      {
+        set (offset + (4 * c) + r, model[c][r]);
+      }
+    }
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      for (unsigned int r = 0; r < 3; r++)
+      {
+        set (offset + 16 + (3 * c) + r, modelNormal[c][r]);
+      }
+    }
+    this->numInstances++;
+  }
+
+  void bufferData ()
+  {
+    if (this->bufferId.isValid () == false)
+    {
+      this->bufferId.allocate ();
+      this->isDirty = true;
+    }
+
+    if (this->isDirty || this->numInstances != this->numBufferedInstances)
+    {
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+      OpenGL::glBufferData (OpenGL::ArrayBuffer (), this->numInstances * stride,
+                            this->data.data (), OpenGL::DynamicDraw ());
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+
+      this->numBufferedInstances = this->numInstances;
+      this->isDirty = false;
+    }
+  }
+
+  void bindAttributes () const
+  {
+    assert (this->bufferId.isValid ());
+
+    const auto offset = [](unsigned int i) {
+      return reinterpret_cast<const void*> (std::uintptr_t (i * sizeof (float)));
+    };
+
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+
+    for (unsigned int c = 0; c < 4; c++)
+    {
+      OpenGL::glEnableVertexAttribArray (OpenGL::ModelIndex + c);
+      OpenGL::glVertexAttribPointer (OpenGL::ModelIndex + c, 4, OpenGL::Float (), false, stride,
+                                     offset (4 * c));
+      OpenGL::glVertexAttribDivisor (OpenGL::ModelIndex + c, 1);
+    }
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      OpenGL::glEnableVertexAttribArray (OpenGL::ModelNormalIndex + c);
+      OpenGL::glVertexAttribPointer (OpenGL::ModelNormalIndex + c, 3, OpenGL::Float (), false,
+                                     stride, offset (16 + (3 * c)));
+      OpenGL::glVertexAttribDivisor (OpenGL::ModelNormalIndex + c, 1);
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
+
+  void unbindAttributes () const
+  {
+    for (unsigned int c = 0; c < 4; c++)
+    {
+      OpenGL::glVertexAttribDivisor (OpenGL::ModelIndex + c, 0);
+      OpenGL::glDisableVertexAttribArray (OpenGL::ModelIndex + c);
+    }
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      OpenGL::glVertexAttribDivisor (OpenGL::ModelNormalIndex + c, 0);
+      OpenGL::glDisableVertexAttribArray (OpenGL::ModelNormalIndex + c);
+    }
+  }
+};
+
+DELEGATE_BIG4_COPY (MeshInstances)
+GETTER_CONST (unsigned int, MeshInstances, numInstances)
+DELEGATE1_CONST (const float*, MeshInstances, model, unsigned int)
+DELEGATE1_CONST (const float*, MeshInstances, modelNormal, unsigned int)
+DELEGATE (void, MeshInstances, reset)
+DELEGATE1 (void, MeshInstances, add, const glm::mat4x4&)
+DELEGATE (void, MeshInstances, bufferData)
+DELEGATE_CONST (void, MeshInstances, bindAttributes)
+DELEGATE_CONST (void, MeshInstances, unbindAttributes)
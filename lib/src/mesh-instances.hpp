@@ -0,0 +1,34 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_INSTANCES
+#define DILAY_MESH_INSTANCES
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+/* Model matrices of instances of a mesh.  Instances are collected anew before each frame, and
+ * are only uploaded if they differ from the instances of the previous frame.  A copy of a set of
+ * instances is not buffered.
+ */
+class MeshInstances
+{
+public:
+  DECLARE_BIG4_COPY (MeshInstances)
+
+  unsigned int numInstances () const;
+  const float* model (unsigned int) const;
+  const float* modelNormal (unsigned int) const;
+
+  void reset ();
+  void add (const glm::mat4x4&);
+  void bufferData ();
+  void bindAttributes () const;
+  void unbindAttributes () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -3,15 +3,22 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <numeric>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "hash.hpp"
 #include "intersection.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
@@ -23,11 +30,11 @@ namespace
   {
     typedef std::function<unsigned int(unsigned int, unsigned int)> MakeNewVertex;
 
-    std::unordered_map<ui_pair, unsigned int> cache;
+    std::unordered_map<EdgeKey, unsigned int> cache;
 
     unsigned int lookup (unsigned int i1, unsigned int i2, const MakeNewVertex& f)
     {
-      const ui_pair key = std::make_pair (glm::min (i1, i2), glm::max (i1, i2));
+      const EdgeKey key (i1, i2);
 
       const auto it = this->cache.find (key);
       if (it == this->cache.end ())
@@ -115,6 +122,44 @@ namespace
     std::vector<std::vector<std::pair<unsigned int, unsigned int>>> elements;
   };
 
+  // error quadric of the squared distances to a set of planes
+  struct Quadric
+  {
+    glm::mat3x3 a;
+    glm::vec3   b;
+
+    Quadric ()
+      : a (0.0f)
+      , b (0.0f)
+    {
+    }
+
+    void addPlane (const glm::vec3& normal, const glm::vec3& point, float weight)
+    {
+      const float d = -glm::dot (normal, point);
+
+      for (unsigned int i = 0; i < 3; i++)
+      {
+        this->a[i] += weight * normal[i] * normal;
+      }
+      this->b += weight * d * normal;
+    }
+
+    // returns false if the minimum is not unique, e.g., for planar clusters
+    bool minimize (glm::vec3& minimum) const
+    {
+      const float trace = this->a[0][0] + this->a[1][1] + this->a[2][2];
+      const float det = glm::determinant (this->a);
+
+      if (trace > 0.0f && det > 0.001f * trace * trace * trace / 27.0f)
+      {
+        minimum = -(glm::inverse (this->a) * this->b);
+        return true;
+      }
+      return false;
+    }
+  };
+
   Mesh& withDefaultNormals (Mesh& mesh)
   {
     for (unsigned int i = 0; i < mesh.numVertices (); i++)
@@ -123,6 +168,107 @@ namespace
     }
     return mesh;
   }
+
+  // negative zeros are hashed as zeros
+  uint64_t hashVec3 (const glm::vec3& v)
+  {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      const float c = v[i] == 0.0f ? 0.0f : v[i];
+      uint32_t    bits;
+
+      std::memcpy (&bits, &c, sizeof (uint32_t));
+      hash = Hash::mix (hash ^ bits);
+    }
+    return hash;
+  }
+
+  /* Maps each element to the first element that equals it.  Elements are partitioned into shards
+   * by their hashes, which are processed in parallel.  Since the elements of each shard remain in
+   * order, the result does not depend on the number of threads.
+   */
+  template <typename Equal>
+  std::vector<unsigned int> firstEquals (const std::vector<uint64_t>& hashes, const Equal& equal)
+  {
+    const unsigned int        n = (unsigned int) hashes.size ();
+    const unsigned int        numShards = 4 * Parallel::numThreads ();
+    std::vector<unsigned int> shardBegin (numShards + 1, 0);
+    std::vector<unsigned int> sorted (n);
+    std::vector<unsigned int> firsts (n);
+
+    for (uint64_t hash : hashes)
+    {
+      shardBegin[(hash % numShards) + 1]++;
+    }
+    std::partial_sum (shardBegin.begin (), shardBegin.end (), shardBegin.begin ());
+    {
+      std::vector<unsigned int> next (shardBegin.begin (), shardBegin.end () - 1);
+
+      for (unsigned int i = 0; i < n; i++)
+      {
+        sorted[next[hashes[i] % numShards]++] = i;
+      }
+    }
+
+    Parallel::forEach (numShards, [&hashes, &equal, &shardBegin, &sorted,
+                                   &firsts](unsigned int s) {
+      const auto hash = [&hashes](unsigned int i) { return std::size_t (hashes[i]); };
+      std::unordered_set<unsigned int, decltype (hash), Equal> set (
+        shardBegin[s + 1] - shardBegin[s], hash, equal);
+
+      for (unsigned int k = shardBegin[s]; k < shardBegin[s + 1]; k++)
+      {
+        firsts[sorted[k]] = *set.insert (sorted[k]).first;
+      }
+    });
+    return firsts;
+  }
+
+  // finds the root of an element in a disjoint-set forest, whose paths are halved concurrently
+  unsigned int findRoot (std::atomic<unsigned int>* parents, unsigned int i)
+  {
+    while (true)
+    {
+      unsigned int       parent = parents[i];
+      const unsigned int grandparent = parents[parent];
+
+      if (parent == grandparent)
+      {
+        return parent;
+      }
+      parents[i].compare_exchange_weak (parent, grandparent);
+      i = grandparent;
+    }
+  }
+
+  /* Roots are linked to smaller roots only, so that concurrent unions never form cycles.  A union
+   * is retried if the larger root has been linked by another thread in the meantime.
+   */
+  void unite (std::atomic<unsigned int>* parents, unsigned int i, unsigned int j)
+  {
+    while (true)
+    {
+      i = findRoot (parents, i);
+      j = findRoot (parents, j);
+
+      if (i == j)
+      {
+        return;
+      }
+      else if (i < j)
+      {
+        std::swap (i, j);
+      }
+
+      unsigned int root = i;
+      if (parents[i].compare_exchange_strong (root, j))
+      {
+        return;
+      }
+    }
+  }
 }
 
 void MeshUtil::addFace (Mesh& mesh, unsigned int i1, unsigned int i2, unsigned int i3)
@@ -451,11 +597,12 @@ Mesh MeshUtil::mirrorPositive (const Mesh& mesh, const PrimPlane& plane)
     return d < -eps ? Side::Negative : (d > eps ? Side::Positive : Side::Border);
   };
 
-  Mesh                    m;
-  std::vector<Side>       sides;
-  std::vector<BorderFlag> borderFlags;
-  std::vector<ui_pair>    newIndices;
-  EdgeMap                 newBorderVertices (mesh.numVertices ());
+  std::vector<Side>         sides (mesh.numVertices ());
+  std::vector<BorderFlag>   borderFlags (mesh.numVertices (), BorderFlag::NoBorder);
+  std::vector<ui_pair>      newIndices;
+  std::vector<unsigned int> vertexOffsets (mesh.numVertices () + 1, 0);
+  std::vector<unsigned int> faceOffsets ((mesh.numIndices () / 3) + 1, 0);
+  std::vector<EdgeKey>      borderEdges;
 
   auto updateBorderFlag = [&borderFlags](unsigned int i, Side side) {
     BorderFlag& current = borderFlags[i];
@@ -487,71 +634,57 @@ Mesh MeshUtil::mirrorPositive (const Mesh& mesh, const PrimPlane& plane)
     }
   };
 
-  auto newBorderVertex = [&mesh, &plane, &newBorderVertices, &m](unsigned int i1,
-                                                                 unsigned int i2) -> unsigned int {
-    const unsigned int* existentIndex = newBorderVertices.find (i1, i2);
-
-    if (existentIndex)
-    {
-      return *existentIndex;
-    }
-    else
+  // turns counts at `offsets[i + 1]` into offsets
+  auto accumulate = [](std::vector<unsigned int>& offsets) {
+    for (unsigned int i = 1; i < offsets.size (); i++)
     {
-      const glm::vec3 v1 (mesh.vertex (i1));
-      const glm::vec3 v2 (mesh.vertex (i2));
-      const PrimRay   ray (true, v1, v2 - v1);
-
-      float     t;
-      glm::vec3 position;
-
-      if (IntersectionUtil::intersects (ray, plane, &t))
-      {
-        position = ray.pointAt (t);
-      }
-      else
-      {
-        position = (v1 + v2) * 0.5f;
-      }
-      const unsigned int newIndex = m.addVertex (position);
-
-      newBorderVertices.add (i1, i2, newIndex);
-      return newIndex;
+      offsets[i] += offsets[i - 1];
     }
   };
 
-  m.copyNonGeometry (mesh);
+  auto borderVertex = [&vertexOffsets, &borderEdges](unsigned int i1,
+                                                     unsigned int i2) -> unsigned int {
+    const EdgeKey key (i1, i2);
+    const auto    it = std::lower_bound (borderEdges.begin (), borderEdges.end (), key);
 
-  sides.reserve (mesh.numVertices ());
-  borderFlags.reserve (mesh.numVertices ());
+    assert (it != borderEdges.end () && *it == key);
+    return vertexOffsets.back () + (it - borderEdges.begin ());
+  };
 
   newIndices.resize (mesh.numVertices (),
                      std::make_pair (Util::invalidIndex (), Util::invalidIndex ()));
 
   // cache data
-  for (unsigned int i = 0; i < mesh.numVertices (); i++)
-  {
-    sides.push_back (side (mesh.vertex (i)));
-    borderFlags.push_back (BorderFlag::NoBorder);
-  }
+  Parallel::forEach (mesh.numVertices (),
+                     [&mesh, &sides, &side](unsigned int i) { sides[i] = side (mesh.vertex (i)); });
 
-  // update border flags
+  // update border flags and collect edges that cross the plane
   for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
   {
-    const unsigned int i1 = mesh.index (i + 0);
-    const unsigned int i2 = mesh.index (i + 1);
-    const unsigned int i3 = mesh.index (i + 2);
+    const unsigned int is[] = {mesh.index (i + 0), mesh.index (i + 1), mesh.index (i + 2)};
+
+    assert (sides[is[0]] != Side::Border || sides[is[1]] != Side::Border ||
+            sides[is[2]] != Side::Border);
+
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      const unsigned int i1 = is[j];
+      const unsigned int i2 = is[(j + 1) % 3];
 
-    assert (sides[i1] != Side::Border || sides[i2] != Side::Border || sides[i3] != Side::Border);
+      updateBorderFlag (i1, sides[i2]);
+      updateBorderFlag (i2, sides[i1]);
 
-    updateBorderFlag (i1, sides[i2]);
-    updateBorderFlag (i1, sides[i3]);
-    updateBorderFlag (i2, sides[i1]);
-    updateBorderFlag (i2, sides[i3]);
-    updateBorderFlag (i3, sides[i1]);
-    updateBorderFlag (i3, sides[i2]);
+      if ((sides[i1] == Side::Positive && sides[i2] == Side::Negative) ||
+          (sides[i1] == Side::Negative && sides[i2] == Side::Positive))
+      {
+        borderEdges.emplace_back (i1, i2);
+      }
+    }
   }
+  std::sort (borderEdges.begin (), borderEdges.end ());
+  borderEdges.erase (std::unique (borderEdges.begin (), borderEdges.end ()), borderEdges.end ());
 
-  // mirror vertices
+  // count new vertices and faces
   for (unsigned int i = 0; i < mesh.numVertices (); i++)
   {
     switch (sides[i])
@@ -560,7 +693,6 @@ Mesh MeshUtil::mirrorPositive (const Mesh& mesh, const PrimPlane& plane)
         break;
 
       case Side::Border:
-      {
         switch (borderFlags[i])
         {
           case BorderFlag::NoBorder:
@@ -569,177 +701,240 @@ Mesh MeshUtil::mirrorPositive (const Mesh& mesh, const PrimPlane& plane)
           case BorderFlag::ConnectsNegative:
             break;
           case BorderFlag::ConnectsPositive:
-          {
-            const unsigned int index1 = m.addVertex (mesh.vertex (i));
-            const unsigned int index2 = m.addVertex (mesh.vertex (i));
-
-            newIndices[i] = std::make_pair (index1, index2);
+            vertexOffsets[i + 1] = 2;
             break;
-          }
           case BorderFlag::ConnectsBoth:
-          {
-            const unsigned int index = m.addVertex (mesh.vertex (i));
-
-            newIndices[i] = std::make_pair (index, index);
+            vertexOffsets[i + 1] = 1;
             break;
-          }
         }
         break;
-      }
-      case Side::Positive:
-      {
-        const unsigned int index1 = m.addVertex (mesh.vertex (i));
-        const unsigned int index2 = m.addVertex (plane.mirror (mesh.vertex (i)));
 
-        newIndices[i] = std::make_pair (index1, index2);
+      case Side::Positive:
+        vertexOffsets[i + 1] = 2;
         break;
-      }
     }
   }
+  accumulate (vertexOffsets);
 
-  // mirror faces
-  for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
-  {
-    const unsigned int oldIndex1 = mesh.index (i + 0);
-    const unsigned int oldIndex2 = mesh.index (i + 1);
-    const unsigned int oldIndex3 = mesh.index (i + 2);
+  Parallel::forEach (faceOffsets.size () - 1, [&mesh, &sides, &faceOffsets](unsigned int f) {
+    unsigned int numPositive = 0;
+    unsigned int numNegative = 0;
+
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      const Side s = sides[mesh.index ((3 * f) + j)];
 
-    const Side s1 = sides[oldIndex1];
-    const Side s2 = sides[oldIndex2];
-    const Side s3 = sides[oldIndex3];
+      numPositive += s == Side::Positive ? 1 : 0;
+      numNegative += s == Side::Negative ? 1 : 0;
+    }
+    faceOffsets[f + 1] = numPositive == 0 ? 0 : ((numPositive == 2 && numNegative == 1) ? 4 : 2);
+  });
+  accumulate (faceOffsets);
+
+  // mirror vertices
+  const unsigned int     numNewVertices = vertexOffsets.back () + borderEdges.size ();
+  std::vector<glm::vec3> positions (numNewVertices);
 
-    if (s1 == Side::Positive || s2 == Side::Positive || s3 == Side::Positive)
+  Parallel::forEach (mesh.numVertices (), [&](unsigned int i) {
+    const unsigned int index = vertexOffsets[i];
+
+    switch (vertexOffsets[i + 1] - index)
     {
+      case 0:
+        break;
+      case 1:
+        positions[index] = mesh.vertex (i);
+        newIndices[i] = std::make_pair (index, index);
+        break;
+      case 2:
+        positions[index] = mesh.vertex (i);
+        positions[index + 1] =
+          sides[i] == Side::Positive ? plane.mirror (mesh.vertex (i)) : mesh.vertex (i);
+        newIndices[i] = std::make_pair (index, index + 1);
+        break;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  });
+
+  Parallel::forEach (borderEdges.size (), [&](unsigned int e) {
+    const glm::vec3 v1 (mesh.vertex (borderEdges[e].vertex1 ()));
+    const glm::vec3 v2 (mesh.vertex (borderEdges[e].vertex2 ()));
+    const PrimRay   ray (true, v1, v2 - v1);
+
+    float t;
+    if (IntersectionUtil::intersects (ray, plane, &t))
+    {
+      positions[vertexOffsets.back () + e] = ray.pointAt (t);
+    }
+    else
+    {
+      positions[vertexOffsets.back () + e] = (v1 + v2) * 0.5f;
+    }
+  });
+
+  // mirror faces
+  std::vector<unsigned int> indices (3 * faceOffsets.back ());
+
+  Parallel::forEach (faceOffsets.size () - 1, [&](unsigned int f) {
+    if (faceOffsets[f + 1] > faceOffsets[f])
+    {
+      unsigned int* out = indices.data () + (3 * faceOffsets[f]);
+
+      auto add = [&out](unsigned int i1, unsigned int i2, unsigned int i3) {
+        out[0] = i1;
+        out[1] = i2;
+        out[2] = i3;
+        out += 3;
+      };
+
+      const unsigned int oldIndex1 = mesh.index ((3 * f) + 0);
+      const unsigned int oldIndex2 = mesh.index ((3 * f) + 1);
+      const unsigned int oldIndex3 = mesh.index ((3 * f) + 2);
+
+      const Side s1 = sides[oldIndex1];
+      const Side s2 = sides[oldIndex2];
+      const Side s3 = sides[oldIndex3];
+
       const ui_pair& new1 = newIndices[oldIndex1];
       const ui_pair& new2 = newIndices[oldIndex2];
       const ui_pair& new3 = newIndices[oldIndex3];
 
-      // 3 non-negative
-      if (s1 != Side::Negative && s2 != Side::Negative && s3 != Side::Negative)
-      {
-        MeshUtil::addFace (m, new1.first, new2.first, new3.first);
-        MeshUtil::addFace (m, new3.second, new2.second, new1.second);
-      }
-      // 1 negative - 2 positive
-      else if (s1 == Side::Positive && s2 == Side::Positive && s3 == Side::Negative)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex3);
-        unsigned int b2 = newBorderVertex (oldIndex2, oldIndex3);
+          // 3 non-negative
+          if (s1 != Side::Negative && s2 != Side::Negative && s3 != Side::Negative)
+          {
+            add (new1.first, new2.first, new3.first);
+            add (new3.second, new2.second, new1.second);
+          }
+          // 1 negative - 2 positive
+          else if (s1 == Side::Positive && s2 == Side::Positive && s3 == Side::Negative)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex3);
+            const unsigned int b2 = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new2.first, b2, new1.first);
-        MeshUtil::addFace (m, new1.second, b2, new2.second);
+            add (new2.first, b2, new1.first);
+            add (new1.second, b2, new2.second);
 
-        MeshUtil::addFace (m, new1.first, b2, b1);
-        MeshUtil::addFace (m, b1, b2, new1.second);
-      }
-      else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Positive)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex2);
-        unsigned int b2 = newBorderVertex (oldIndex2, oldIndex3);
+            add (new1.first, b2, b1);
+            add (b1, b2, new1.second);
+          }
+          else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Positive)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex2);
+            const unsigned int b2 = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new1.first, b1, new3.first);
-        MeshUtil::addFace (m, new3.second, b1, new1.second);
+            add (new1.first, b1, new3.first);
+            add (new3.second, b1, new1.second);
 
-        MeshUtil::addFace (m, new3.first, b1, b2);
-        MeshUtil::addFace (m, b2, b1, new3.second);
-      }
-      else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Positive)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex2);
-        unsigned int b2 = newBorderVertex (oldIndex1, oldIndex3);
+            add (new3.first, b1, b2);
+            add (b2, b1, new3.second);
+          }
+          else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Positive)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex2);
+            const unsigned int b2 = borderVertex (oldIndex1, oldIndex3);
 
-        MeshUtil::addFace (m, new3.first, b2, new2.first);
-        MeshUtil::addFace (m, new2.second, b2, new3.second);
+            add (new3.first, b2, new2.first);
+            add (new2.second, b2, new3.second);
 
-        MeshUtil::addFace (m, new2.first, b2, b1);
-        MeshUtil::addFace (m, b1, b2, new2.second);
-      }
-      // 1 positive - 2 negative
-      else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Negative)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex2);
-        unsigned int b2 = newBorderVertex (oldIndex1, oldIndex3);
+            add (new2.first, b2, b1);
+            add (b1, b2, new2.second);
+          }
+          // 1 positive - 2 negative
+          else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Negative)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex2);
+            const unsigned int b2 = borderVertex (oldIndex1, oldIndex3);
 
-        MeshUtil::addFace (m, new1.first, b1, b2);
-        MeshUtil::addFace (m, b2, b1, new1.second);
-      }
-      else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Negative)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex2);
-        unsigned int b2 = newBorderVertex (oldIndex2, oldIndex3);
+            add (new1.first, b1, b2);
+            add (b2, b1, new1.second);
+          }
+          else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Negative)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex2);
+            const unsigned int b2 = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new2.first, b2, b1);
-        MeshUtil::addFace (m, b1, b2, new2.second);
-      }
-      else if (s1 == Side::Negative && s2 == Side::Negative && s3 == Side::Positive)
-      {
-        unsigned int b1 = newBorderVertex (oldIndex1, oldIndex3);
-        unsigned int b2 = newBorderVertex (oldIndex2, oldIndex3);
+            add (new2.first, b2, b1);
+            add (b1, b2, new2.second);
+          }
+          else if (s1 == Side::Negative && s2 == Side::Negative && s3 == Side::Positive)
+          {
+            const unsigned int b1 = borderVertex (oldIndex1, oldIndex3);
+            const unsigned int b2 = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new3.first, b1, b2);
-        MeshUtil::addFace (m, b2, b1, new3.second);
-      }
-      // 1 positive - 1 border - 1 negative
-      else if (s1 == Side::Positive && s2 == Side::Border && s3 == Side::Negative)
-      {
-        assert (borderFlags[oldIndex2] == BorderFlag::ConnectsBoth);
+            add (new3.first, b1, b2);
+            add (b2, b1, new3.second);
+          }
+          // 1 positive - 1 border - 1 negative
+          else if (s1 == Side::Positive && s2 == Side::Border && s3 == Side::Negative)
+          {
+            assert (borderFlags[oldIndex2] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex1, oldIndex3);
+            const unsigned int b = borderVertex (oldIndex1, oldIndex3);
 
-        MeshUtil::addFace (m, new1.first, new2.first, b);
-        MeshUtil::addFace (m, b, new2.second, new1.second);
-      }
-      else if (s1 == Side::Border && s2 == Side::Positive && s3 == Side::Negative)
-      {
-        assert (borderFlags[oldIndex1] == BorderFlag::ConnectsBoth);
+            add (new1.first, new2.first, b);
+            add (b, new2.second, new1.second);
+          }
+          else if (s1 == Side::Border && s2 == Side::Positive && s3 == Side::Negative)
+          {
+            assert (borderFlags[oldIndex1] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex2, oldIndex3);
+            const unsigned int b = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new1.first, new2.first, b);
-        MeshUtil::addFace (m, b, new2.second, new1.second);
-      }
-      else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Border)
-      {
-        assert (borderFlags[oldIndex3] == BorderFlag::ConnectsBoth);
+            add (new1.first, new2.first, b);
+            add (b, new2.second, new1.second);
+          }
+          else if (s1 == Side::Positive && s2 == Side::Negative && s3 == Side::Border)
+          {
+            assert (borderFlags[oldIndex3] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex1, oldIndex2);
+            const unsigned int b = borderVertex (oldIndex1, oldIndex2);
 
-        MeshUtil::addFace (m, new1.first, b, new3.first);
-        MeshUtil::addFace (m, new3.second, b, new1.second);
-      }
-      else if (s1 == Side::Border && s2 == Side::Negative && s3 == Side::Positive)
-      {
-        assert (borderFlags[oldIndex1] == BorderFlag::ConnectsBoth);
+            add (new1.first, b, new3.first);
+            add (new3.second, b, new1.second);
+          }
+          else if (s1 == Side::Border && s2 == Side::Negative && s3 == Side::Positive)
+          {
+            assert (borderFlags[oldIndex1] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex2, oldIndex3);
+            const unsigned int b = borderVertex (oldIndex2, oldIndex3);
 
-        MeshUtil::addFace (m, new1.first, b, new3.first);
-        MeshUtil::addFace (m, new3.second, b, new1.second);
-      }
-      else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Border)
-      {
-        assert (borderFlags[oldIndex3] == BorderFlag::ConnectsBoth);
+            add (new1.first, b, new3.first);
+            add (new3.second, b, new1.second);
+          }
+          else if (s1 == Side::Negative && s2 == Side::Positive && s3 == Side::Border)
+          {
+            assert (borderFlags[oldIndex3] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex1, oldIndex2);
+            const unsigned int b = borderVertex (oldIndex1, oldIndex2);
 
-        MeshUtil::addFace (m, new2.first, new3.first, b);
-        MeshUtil::addFace (m, b, new3.second, new2.second);
-      }
-      else if (s1 == Side::Negative && s2 == Side::Border && s3 == Side::Positive)
-      {
-        assert (borderFlags[oldIndex2] == BorderFlag::ConnectsBoth);
+            add (new2.first, new3.first, b);
+            add (b, new3.second, new2.second);
+          }
+          else if (s1 == Side::Negative && s2 == Side::Border && s3 == Side::Positive)
+          {
+            assert (borderFlags[oldIndex2] == BorderFlag::ConnectsBoth);
 
-        unsigned int b = newBorderVertex (oldIndex1, oldIndex3);
+            const unsigned int b = borderVertex (oldIndex1, oldIndex3);
 
-        MeshUtil::addFace (m, new2.first, new3.first, b);
-        MeshUtil::addFace (m, b, new3.second, new2.second);
-      }
-      else
-      {
-        DILAY_IMPOSSIBLE
-      }
+            add (new2.first, new3.first, b);
+            add (b, new3.second, new2.second);
+          }
+          else
+          {
+            DILAY_IMPOSSIBLE
+          }
+
+      assert (out == indices.data () + (3 * faceOffsets[f + 1]));
     }
-  }
+  });
+
+  Mesh                   m;
+  std::vector<glm::vec3> normals (numNewVertices, glm::vec3 (0.0f));
+
+  m.copyNonGeometry (mesh);
+  m.addVertices (positions.data (), normals.data (), numNewVertices);
+  m.addIndices (indices.data (), indices.size ());
 
   if (MeshUtil::checkConsistency (m) == false)
   {
@@ -750,22 +945,27 @@ Mesh MeshUtil::mirrorPositive (const Mesh& mesh, const PrimPlane& plane)
 
 void MeshUtil::mirror (Mesh& mesh, const PrimPlane& plane)
 {
-  for (unsigned int i = 0; i < mesh.numVertices (); i++)
-  {
-    mesh.vertex (i, plane.mirror (mesh.vertex (i)));
-    mesh.normal (i, plane.mirrorDirection (mesh.normal (i)));
-  }
+  std::vector<glm::vec3>    vertices (mesh.numVertices ());
+  std::vector<glm::vec3>    normals (mesh.numVertices ());
+  std::vector<unsigned int> indices (mesh.numIndices ());
 
   assert (mesh.numIndices () % 3 == 0);
 
-  for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
-  {
-    const unsigned int i2 = mesh.index (i + 1);
-    const unsigned int i3 = mesh.index (i + 2);
-
-    mesh.index (i + 1, i3);
-    mesh.index (i + 2, i2);
-  }
+  Parallel::forEach (mesh.numVertices (), [&mesh, &plane, &vertices, &normals](unsigned int i) {
+    vertices[i] = plane.mirror (mesh.vertex (i));
+    normals[i] = plane.mirrorDirection (mesh.normal (i));
+  });
+
+  Parallel::forEach (mesh.numIndices () / 3, [&mesh, &indices](unsigned int f) {
+    indices[(3 * f) + 0] = mesh.index ((3 * f) + 0);
+    indices[(3 * f) + 1] = mesh.index ((3 * f) + 2);
+    indices[(3 * f) + 2] = mesh.index ((3 * f) + 1);
+  });
+
+  mesh.shrinkVertices (0);
+  mesh.addVertices (vertices.data (), normals.data (), vertices.size ());
+  mesh.shrinkIndices (0);
+  mesh.addIndices (indices.data (), indices.size ());
 }
 
 void MeshUtil::moveToCenter (Mesh& mesh)
@@ -782,12 +982,108 @@ void MeshUtil::normalizeScaling (Mesh& mesh)
   const glm::vec3& center = bounds.center ();
   const float      factor = 2.0f / bounds.maxDimExtent ();
 
-  for (unsigned int i = 0; i < mesh.numVertices (); i++)
+  mesh.transform (glm::translate (glm::mat4x4 (1.0f), center) *
+                  glm::scale (glm::mat4x4 (1.0f), glm::vec3 (factor)) *
+                  glm::translate (glm::mat4x4 (1.0f), -center));
+}
+
+void MeshUtil::transform (Mesh& mesh, const glm::mat4x4& model)
+{
+  assert (glm::determinant (glm::mat3x3 (model)) > 0.0f);
+
+  mesh.transform (model);
+}
+
+Mesh MeshUtil::simplify (const Mesh& mesh, unsigned int resolution)
+{
+  assert (resolution > 0 && resolution <= 1024);
+
+  struct Cluster
   {
-    const glm::vec3& v = mesh.vertex (i);
+    Quadric      quadric;
+    glm::vec3    sum;
+    glm::vec3    normal;
+    unsigned int numVertices;
+    glm::uvec3   cell;
+  };
+
+  const PrimAABox  bounds = mesh.bounds ();
+  const glm::vec3& origin = bounds.minimum ();
+  const float      cellSize =
+    glm::max (bounds.maxDimExtent () / float(resolution), Util::epsilon ());
+
+  std::vector<unsigned int> vertexClusters (mesh.numVertices (), Util::invalidIndex ());
+  std::vector<Cluster>      clusters;
+  std::unordered_map<unsigned int, unsigned int> cellClusters;
+
+  const auto clusterOf = [&](unsigned int v) -> unsigned int {
+    if (vertexClusters[v] == Util::invalidIndex ())
+    {
+      const glm::uvec3   cell = glm::min (glm::uvec3 ((mesh.vertex (v) - origin) / cellSize),
+                                        glm::uvec3 (resolution - 1));
+      const unsigned int key = cell.x + (resolution * (cell.y + (resolution * cell.z)));
+      const auto         it = cellClusters.emplace (key, clusters.size ());
+
+      if (it.second)
+      {
+        clusters.push_back (Cluster{Quadric (), glm::vec3 (0.0f), glm::vec3 (0.0f), 0, cell});
+      }
+      clusters[it.first->second].sum += mesh.vertex (v);
+      clusters[it.first->second].numVertices++;
+      vertexClusters[v] = it.first->second;
+    }
+    return vertexClusters[v];
+  };
+
+  std::vector<unsigned int> indices;
+  for (unsigned int i = 0; i + 2 < mesh.numIndices (); i += 3)
+  {
+    const glm::vec3& v1 = mesh.vertex (mesh.index (i + 0));
+    const glm::vec3& v2 = mesh.vertex (mesh.index (i + 1));
+    const glm::vec3& v3 = mesh.vertex (mesh.index (i + 2));
+    const glm::vec3  cross = glm::cross (v2 - v1, v3 - v1);
+    const float      length = glm::length (cross);
+
+    if (length > 0.0f)
+    {
+      const unsigned int c[] = {clusterOf (mesh.index (i + 0)), clusterOf (mesh.index (i + 1)),
+                                clusterOf (mesh.index (i + 2))};
+
+      for (unsigned int j : c)
+      {
+        clusters[j].quadric.addPlane (cross / length, v1, 0.5f * length);
+        clusters[j].normal += cross;
+      }
+      if (c[0] != c[1] && c[1] != c[2] && c[0] != c[2])
+      {
+        indices.insert (indices.end (), c, c + 3);
+      }
+    }
+  }
+
+  Mesh simplified;
+  simplified.reserveVertices (clusters.size ());
+  simplified.reserveIndices (indices.size ());
+
+  for (const Cluster& c : clusters)
+  {
+    const glm::vec3 cellMin = origin + (glm::vec3 (c.cell) * cellSize);
+    const glm::vec3 cellMax = cellMin + glm::vec3 (cellSize);
+    glm::vec3       position;
+
+    // the minimum of the quadric is only used if it lies within the cluster's cell
+    if (c.quadric.minimize (position) == false ||
+        glm::any (glm::lessThan (position, cellMin)) ||
+        glm::any (glm::greaterThan (position, cellMax)))
+    {
+      position = c.sum / float(glm::max (c.numVertices, 1u));
+    }
+    const float length = glm::length (c.normal);
 
-    mesh.vertex (i, (factor * (v - center)) + center);
+    simplified.addVertex (position, length > 0.0f ? c.normal / length : glm::vec3 (0.0f));
   }
+  simplified.addIndices (indices.data (), indices.size ());
+  return simplified;
 }
 
 bool MeshUtil::checkConsistency (const Mesh& mesh)
@@ -841,3 +1137,270 @@ bool MeshUtil::checkConsistency (const Mesh& mesh)
   }
   return true;
 }
+
+MeshUtil::CleanResult MeshUtil::clean (std::vector<glm::vec3>&    vertices,
+                                       std::vector<unsigned int>& indices, float weldDistance)
+{
+  assert (weldDistance >= 0.0f);
+  assert (indices.size () % 3 == 0);
+
+  CleanResult result;
+
+  // vertices are welded if they are equal or if they are quantized to the same cell
+  {
+    std::vector<glm::vec3> cells (vertices.size ());
+    std::vector<uint64_t>  hashes (vertices.size ());
+
+    Parallel::forEach (vertices.size (),
+                       [&vertices, weldDistance, &cells, &hashes](unsigned int i) {
+                         cells[i] = weldDistance > 0.0f ? glm::floor (vertices[i] / weldDistance)
+                                                        : vertices[i];
+                         hashes[i] = hashVec3 (cells[i]);
+                       });
+
+    const std::vector<unsigned int> firsts = firstEquals (
+      hashes, [&cells](unsigned int i, unsigned int j) { return cells[i] == cells[j]; });
+
+    Parallel::forEach (indices.size (),
+                       [&indices, &firsts](unsigned int i) { indices[i] = firsts[indices[i]]; });
+
+    for (unsigned int i = 0; i < firsts.size (); i++)
+    {
+      result.numWeldedVertices += firsts[i] == i ? 0 : 1;
+    }
+  }
+
+  // faces are removed if they are degenerated or if they duplicate a previous face
+  {
+    const unsigned int    numFaces = (unsigned int) (indices.size () / 3);
+    std::vector<uint64_t> hashes (numFaces);
+    std::vector<bool>     isDegenerated (numFaces);
+
+    const auto sortedFace = [&indices](unsigned int f) {
+      unsigned int face[3] = {indices[(3 * f) + 0], indices[(3 * f) + 1], indices[(3 * f) + 2]};
+      std::sort (face, face + 3);
+      return glm::uvec3 (face[0], face[1], face[2]);
+    };
+
+    Parallel::forEach (numFaces, [&sortedFace, &hashes](unsigned int f) {
+      const glm::uvec3 face = sortedFace (f);
+      hashes[f] = Hash::mix (Hash::mix (Hash::mix (face.x) ^ face.y) ^ face.z);
+    });
+    for (unsigned int f = 0; f < numFaces; f++)
+    {
+      const glm::uvec3 face = sortedFace (f);
+      isDegenerated[f] = face.x == face.y || face.y == face.z;
+    }
+
+    const std::vector<unsigned int> firsts =
+      firstEquals (hashes, [&sortedFace](unsigned int f, unsigned int g) {
+        return sortedFace (f) == sortedFace (g);
+      });
+
+    unsigned int numKept = 0;
+    for (unsigned int f = 0; f < numFaces; f++)
+    {
+      if (isDegenerated[f])
+      {
+        result.numDegeneratedFaces++;
+      }
+      else if (firsts[f] != f)
+      {
+        result.numDuplicateFaces++;
+      }
+      else
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          indices[(3 * numKept) + j] = indices[(3 * f) + j];
+        }
+        numKept++;
+      }
+    }
+    indices.resize (3 * numKept);
+  }
+
+  // unused vertices are removed, which includes all welded vertices
+  {
+    std::vector<unsigned int> newIndices (vertices.size (), Util::invalidIndex ());
+    unsigned int              numUsed = 0;
+
+    for (unsigned int i : indices)
+    {
+      newIndices[i] = 0;
+    }
+    for (unsigned int i = 0; i < vertices.size (); i++)
+    {
+      if (newIndices[i] != Util::invalidIndex ())
+      {
+        vertices[numUsed] = vertices[i];
+        newIndices[i] = numUsed++;
+      }
+    }
+    result.numUnusedVertices = (unsigned int) vertices.size () - numUsed - result.numWeldedVertices;
+    vertices.resize (numUsed);
+
+    Parallel::forEach (indices.size (), [&indices, &newIndices](unsigned int i) {
+      indices[i] = newIndices[indices[i]];
+    });
+  }
+
+  /* Edges with more than two adjacent faces are split by splitting their vertices: the faces of a
+   * vertex are grouped into fans that are connected by edges with two adjacent faces, and each fan
+   * but the first gets its own copy of the vertex.
+   */
+  {
+    const unsigned int        numVertices = (unsigned int) vertices.size ();
+    const unsigned int        numCorners = (unsigned int) indices.size ();
+    std::vector<uint64_t>     hashes (numCorners);
+    std::vector<unsigned int> numEdgeFaces (numCorners, 0);
+    std::vector<unsigned int> vertexBegin (numVertices + 1, 0);
+    std::vector<unsigned int> vertexCorners (numCorners);
+    std::vector<unsigned int> cornerFans (numCorners, 0);
+    std::vector<unsigned int> numFans (numVertices, 1);
+
+    // the edge of a corner connects its vertex to the next vertex of its face
+    const auto edge = [&indices](unsigned int c) {
+      return EdgeKey (indices[c], indices[(3 * (c / 3)) + ((c + 1) % 3)]);
+    };
+
+    Parallel::forEach (numCorners, [&edge, &hashes](unsigned int c) {
+      hashes[c] = Hash::mix (edge (c).value ());
+    });
+
+    const std::vector<unsigned int> firsts = firstEquals (
+      hashes, [&edge](unsigned int c, unsigned int d) { return edge (c) == edge (d); });
+
+    for (unsigned int c = 0; c < numCorners; c++)
+    {
+      numEdgeFaces[firsts[c]]++;
+      vertexBegin[indices[c] + 1]++;
+    }
+    std::partial_sum (vertexBegin.begin (), vertexBegin.end (), vertexBegin.begin ());
+    {
+      std::vector<unsigned int> next (vertexBegin.begin (), vertexBegin.end () - 1);
+
+      for (unsigned int c = 0; c < numCorners; c++)
+      {
+        vertexCorners[next[indices[c]]++] = c;
+      }
+    }
+
+    Parallel::forEach (numVertices, [&indices, &firsts, &numEdgeFaces, &vertexBegin, &vertexCorners,
+                                     &cornerFans, &numFans](unsigned int v) {
+      const unsigned int begin = vertexBegin[v];
+      const unsigned int n = vertexBegin[v + 1] - begin;
+
+      std::vector<unsigned int> parents (n);
+      std::vector<ui_pair>      neighbors;
+
+      std::iota (parents.begin (), parents.end (), 0);
+
+      const auto find = [&parents](unsigned int i) {
+        while (parents[i] != i)
+        {
+          parents[i] = parents[parents[i]];
+          i = parents[i];
+        }
+        return i;
+      };
+
+      // both edges of a corner that are adjacent to two faces connect its face to a fan
+      for (unsigned int k = 0; k < n; k++)
+      {
+        const unsigned int c = vertexCorners[begin + k];
+        const unsigned int previous = (3 * (c / 3)) + ((c + 2) % 3);
+
+        if (numEdgeFaces[firsts[c]] == 2)
+        {
+          neighbors.emplace_back (indices[(3 * (c / 3)) + ((c + 1) % 3)], k);
+        }
+        if (numEdgeFaces[firsts[previous]] == 2)
+        {
+          neighbors.emplace_back (indices[previous], k);
+        }
+      }
+      std::sort (neighbors.begin (), neighbors.end ());
+
+      for (unsigned int i = 1; i < neighbors.size (); i++)
+      {
+        if (neighbors[i].first == neighbors[i - 1].first)
+        {
+          parents[find (neighbors[i].second)] = find (neighbors[i - 1].second);
+        }
+      }
+
+      // fans are numbered in the order of their first face
+      std::vector<unsigned int> fans (n, Util::invalidIndex ());
+      unsigned int              numVertexFans = 0;
+
+      for (unsigned int k = 0; k < n; k++)
+      {
+        const unsigned int root = find (k);
+
+        if (fans[root] == Util::invalidIndex ())
+        {
+          fans[root] = numVertexFans++;
+        }
+        cornerFans[vertexCorners[begin + k]] = fans[root];
+      }
+      numFans[v] = std::max (1u, numVertexFans);
+    });
+
+    std::vector<unsigned int> firstCopies (numVertices);
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+      firstCopies[v] = (unsigned int) vertices.size ();
+      for (unsigned int i = 1; i < numFans[v]; i++)
+      {
+        const glm::vec3 vertex = vertices[v];
+        vertices.push_back (vertex);
+      }
+    }
+    result.numSplitVertices = (unsigned int) vertices.size () - numVertices;
+
+    Parallel::forEach (numCorners, [&indices, &cornerFans, &firstCopies](unsigned int c) {
+      if (cornerFans[c] > 0)
+      {
+        indices[c] = firstCopies[indices[c]] + cornerFans[c] - 1;
+      }
+    });
+  }
+  return result;
+}
+
+unsigned int MeshUtil::components (const std::vector<unsigned int>& indices,
+                                   unsigned int                     numVertices,
+                                   std::vector<unsigned int>&       faceComponents)
+{
+  assert (indices.size () % 3 == 0);
+
+  const unsigned int numFaces = (unsigned int) (indices.size () / 3);
+
+  std::unique_ptr<std::atomic<unsigned int>[]> parents (
+    new std::atomic<unsigned int>[numVertices]);
+
+  Parallel::forEach (numVertices, [&parents](unsigned int i) { parents[i] = i; });
+  Parallel::forEach (numFaces, [&indices, &parents](unsigned int f) {
+    unite (parents.get (), indices[(3 * f) + 0], indices[(3 * f) + 1]);
+    unite (parents.get (), indices[(3 * f) + 0], indices[(3 * f) + 2]);
+  });
+
+  faceComponents.resize (numFaces);
+  Parallel::forEach (numFaces, [&indices, &parents, &faceComponents](unsigned int f) {
+    faceComponents[f] = findRoot (parents.get (), indices[3 * f]);
+  });
+
+  std::vector<unsigned int> numbers (numVertices, Util::invalidIndex ());
+  unsigned int              numComponents = 0;
+
+  for (unsigned int& c : faceComponents)
+  {
+    if (numbers[c] == Util::invalidIndex ())
+    {
+      numbers[c] = numComponents++;
+    }
+    c = numbers[c];
+  }
+  return numComponents;
+}
@@ -5,6 +5,9 @@
 #ifndef DILAY_MESH_UTIL
 #define DILAY_MESH_UTIL
 
+#include <glm/fwd.hpp>
+#include <vector>
+
 class Mesh;
 class PrimPlane;
 
@@ -24,7 +27,36 @@ namespace MeshUtil
 
   void moveToCenter (Mesh&);
   void normalizeScaling (Mesh&);
+  // transforms positions and normals by an affine matrix that preserves orientation
+  void transform (Mesh&, const glm::mat4x4&);
+  // simplifies a mesh by clustering its vertices in a grid of given resolution
+  Mesh simplify (const Mesh&, unsigned int);
   bool checkConsistency (const Mesh&);
+
+  // the numbers of vertices and faces that have been changed by `clean`
+  struct CleanResult
+  {
+    unsigned int numWeldedVertices = 0;
+    unsigned int numDegeneratedFaces = 0;
+    unsigned int numDuplicateFaces = 0;
+    unsigned int numUnusedVertices = 0;
+    unsigned int numSplitVertices = 0;
+  };
+
+  /* Prepares the vertices and indices of imported meshes in parallel: vertices are welded if they
+   * are quantized to the same cell of the given size (or if they are equal if the size is 0),
+   * degenerated and duplicate faces are removed, as well as unused vertices, and vertices of
+   * edges with more than two adjacent faces are split.  Vertices must be finite and indices must
+   * be in range.
+   */
+  CleanResult clean (std::vector<glm::vec3>&, std::vector<unsigned int>&, float);
+
+  /* Finds the connected components of the faces of the given indices and number of vertices in
+   * parallel, and returns their number.  Components are numbered in the order of their first
+   * faces, and the component of each face is written to the last argument.
+   */
+  unsigned int components (const std::vector<unsigned int>&, unsigned int,
+                           std::vector<unsigned int>&);
 };
 
 #endif
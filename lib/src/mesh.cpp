@@ -2,16 +2,26 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include "camera.hpp"
 #include "color.hpp"
+#include "copy-on-write.hpp"
+#include "frame-queue.hpp"
+#include "hash.hpp"
+#include "mesh-instances.hpp"
 #include "mesh.hpp"
 #include "opengl-buffer-id.hpp"
+#include "opengl-vertex-array-id.hpp"
 #include "opengl.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
+#include "profile.hpp"
 #include "render-mode.hpp"
 #include "renderer.hpp"
 #include "util.hpp"
@@ -20,69 +30,322 @@ namespace
 {
   static_assert (sizeof (glm::vec3) == 3 * sizeof (float), "Unexpected memory layout");
 
-  template <typename T> struct BufferedData
+  // modified elements are recorded in pages of 2^pageShift elements
+  constexpr unsigned int pageShift = 10;
+
+  struct DirtyPages
   {
-    OpenGLBufferId id;
-    std::vector<T> data;
-    unsigned int   dataLowerBound;
-    unsigned int   dataUpperBound;
-    unsigned int   bufferSize;
+    std::vector<bool>         isDirty;
+    std::vector<unsigned int> pages;
+    bool                      includesAll;
 
-    BufferedData () { this->reset (); }
+    DirtyPages () { this->reset (); }
 
     void reset ()
     {
-      this->id.reset ();
-      this->data.clear ();
-      this->resetBounds ();
-      this->bufferSize = 0;
+      for (unsigned int p : this->pages)
+      {
+        this->isDirty[p] = false;
+      }
+      this->pages.clear ();
+      this->includesAll = false;
+    }
+
+    void markAll () { this->includesAll = true; }
+
+    void mark (unsigned int element)
+    {
+      const unsigned int page = element >> pageShift;
+
+      if (page >= this->isDirty.size ())
+      {
+        this->isDirty.resize (page + 1, false);
+      }
+      if (this->isDirty[page] == false)
+      {
+        this->isDirty[page] = true;
+        this->pages.push_back (page);
+      }
+    }
+
+    void mark (unsigned int begin, unsigned int end)
+    {
+      assert (begin < end);
+
+      for (unsigned int p = begin >> pageShift; p <= (end - 1) >> pageShift; p++)
+      {
+        this->mark (p << pageShift);
+      }
+    }
+
+    std::size_t numBytes () const
+    {
+      return (this->isDirty.capacity () / 8) + (this->pages.capacity () * sizeof (unsigned int));
+    }
+  };
+
+  /* Bounds of the pages of vertices.  Writes grow the bounds of their pages incrementally.  A
+   * page is only rescanned if a vertex on its boundary has been moved, and the overall bounds
+   * are recombined from the bounds of the pages if a vertex on their boundary has been moved.
+   */
+  struct PageBounds
+  {
+    std::vector<glm::vec3>    minima;
+    std::vector<glm::vec3>    maxima;
+    std::vector<bool>         isStale;
+    std::vector<unsigned int> stalePages;
+    glm::vec3                 minimum;
+    glm::vec3                 maximum;
+    bool                      isExact;
+
+    PageBounds () { this->reset (); }
+
+    void reset ()
+    {
+      this->minima.clear ();
+      this->maxima.clear ();
+      this->isStale.clear ();
+      this->stalePages.clear ();
+      this->minimum = glm::vec3 (Util::maxFloat ());
+      this->maximum = glm::vec3 (Util::minFloat ());
+      this->isExact = true;
+    }
+
+    static bool isOnBoundary (const glm::vec3& v, const glm::vec3& min, const glm::vec3& max)
+    {
+      return glm::any (glm::equal (v, min)) || glm::any (glm::equal (v, max));
     }
 
-    void resetBounds ()
+    void markStale (unsigned int page)
     {
-      this->dataLowerBound = Util::maxUnsignedInt ();
-      this->dataUpperBound = 0;
+      if (this->isStale[page] == false)
+      {
+        this->isStale[page] = true;
+        this->stalePages.push_back (page);
+      }
+    }
+
+    void grow (unsigned int i, const glm::vec3& v)
+    {
+      const unsigned int page = i >> pageShift;
+
+      if (page >= this->minima.size ())
+      {
+        this->minima.resize (page + 1, glm::vec3 (Util::maxFloat ()));
+        this->maxima.resize (page + 1, glm::vec3 (Util::minFloat ()));
+        this->isStale.resize (page + 1, false);
+      }
+      this->minima[page] = glm::min (this->minima[page], v);
+      this->maxima[page] = glm::max (this->maxima[page], v);
+      this->minimum = glm::min (this->minimum, v);
+      this->maximum = glm::max (this->maximum, v);
     }
 
-    unsigned int numElements () const { return this->data.size (); }
+    // `previous` is the position of the i-th vertex that is replaced by `v`
+    void update (unsigned int i, const glm::vec3& previous, const glm::vec3& v)
+    {
+      const unsigned int page = i >> pageShift;
 
-    void reserve (unsigned int size) { this->data.reserve (size); }
+      if (isOnBoundary (previous, this->minima[page], this->maxima[page]))
+      {
+        this->markStale (page);
+      }
+      if (isOnBoundary (previous, this->minimum, this->maximum))
+      {
+        this->isExact = false;
+      }
+      this->grow (i, v);
+    }
 
     void shrink (unsigned int n)
     {
-      assert (n <= this->numElements ());
-      this->data.resize (n);
-      this->dataLowerBound = 0;
-      this->dataUpperBound = n > 0 ? n - 1 : 0;
+      const unsigned int numPages = (n + (1 << pageShift) - 1) >> pageShift;
+
+      if (numPages < this->minima.size ())
+      {
+        this->minima.resize (numPages);
+        this->maxima.resize (numPages);
+        this->isStale.resize (numPages);
+        const auto isRemoved = [numPages](unsigned int p) { return p >= numPages; };
+
+        this->stalePages.erase (
+          std::remove_if (this->stalePages.begin (), this->stalePages.end (), isRemoved),
+          this->stalePages.end ());
+      }
+      if (numPages > 0 && (n & ((1 << pageShift) - 1)) != 0)
+      {
+        this->markStale (numPages - 1);
+      }
+      this->isExact = false;
+    }
+
+    // recomputes the bounds of all pages in parallel, e.g., after all vertices have been moved
+    template <typename F> void rebuild (unsigned int numVertices, const F& vertex)
+    {
+      const unsigned int numPages = (numVertices + (1 << pageShift) - 1) >> pageShift;
+
+      this->reset ();
+      this->minima.resize (numPages);
+      this->maxima.resize (numPages);
+      this->isStale.resize (numPages, false);
+
+      Parallel::forEach (numPages, [this, numVertices, &vertex](unsigned int page) {
+        const unsigned int begin = page << pageShift;
+        const unsigned int end = glm::min ((page + 1) << pageShift, numVertices);
+
+        this->minima[page] = glm::vec3 (Util::maxFloat ());
+        this->maxima[page] = glm::vec3 (Util::minFloat ());
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+          this->minima[page] = glm::min (this->minima[page], vertex (i));
+          this->maxima[page] = glm::max (this->maxima[page], vertex (i));
+        }
+      });
+      this->isExact = false;
+    }
+
+    // `vertex (i)` returns the position of the i-th vertex
+    template <typename F> PrimAABox bounds (unsigned int numVertices, const F& vertex)
+    {
+      for (unsigned int page : this->stalePages)
+      {
+        const unsigned int begin = page << pageShift;
+        const unsigned int end = glm::min ((page + 1) << pageShift, numVertices);
+
+        this->minima[page] = glm::vec3 (Util::maxFloat ());
+        this->maxima[page] = glm::vec3 (Util::minFloat ());
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+          this->minima[page] = glm::min (this->minima[page], vertex (i));
+          this->maxima[page] = glm::max (this->maxima[page], vertex (i));
+        }
+        this->isStale[page] = false;
+      }
+      this->stalePages.clear ();
+
+      if (this->isExact == false)
+      {
+        this->minimum = glm::vec3 (Util::maxFloat ());
+        this->maximum = glm::vec3 (Util::minFloat ());
+
+        for (unsigned int page = 0; page < this->minima.size (); page++)
+        {
+          this->minimum = glm::min (this->minimum, this->minima[page]);
+          this->maximum = glm::max (this->maximum, this->maxima[page]);
+        }
+        this->isExact = true;
+      }
+      return PrimAABox (this->minimum, this->maximum);
+    }
+
+    std::size_t numBytes () const
+    {
+      return ((this->minima.capacity () + this->maxima.capacity ()) * sizeof (glm::vec3)) +
+             (this->isStale.capacity () / 8) +
+             (this->stalePages.capacity () * sizeof (unsigned int));
+    }
+  };
+
+  // copies of a mesh share their data until it is written
+  template <typename T> struct BufferedData
+  {
+    CopyOnWrite<std::vector<T>> data;
+    DirtyPages                  dirty;
+
+    BufferedData () { this->reset (); }
+
+    void reset ()
+    {
+      this->data.reset ();
+      this->dirty.reset ();
+    }
+
+    unsigned int numElements () const { return this->data->size (); }
+
+    std::size_t numBytes () const
+    {
+      return (this->data->capacity () * sizeof (T)) + this->dirty.numBytes ();
     }
 
-    void updateBounds (unsigned int index)
+    void reserve (unsigned int size) { this->data.write ().reserve (size); }
+
+    void shrink (unsigned int n)
     {
-      this->dataLowerBound = glm::min (this->dataLowerBound, index);
-      this->dataUpperBound = glm::max (this->dataUpperBound, index);
+      assert (n <= this->numElements ());
+      this->data.write ().resize (n);
+      this->dirty.markAll ();
     }
 
     unsigned int add (const T& value)
     {
-      this->data.push_back (value);
-      this->updateBounds (this->numElements () - 1);
+      this->data.write ().push_back (value);
+      this->dirty.mark (this->numElements () - 1);
       return this->numElements () - 1;
     }
 
+    void add (const T* values, unsigned int n)
+    {
+      if (n > 0)
+      {
+        std::vector<T>& data = this->data.write ();
+
+        data.insert (data.end (), values, values + n);
+        this->dirty.mark (data.size () - n, data.size ());
+      }
+    }
+
     void set (unsigned int index, const T& value)
     {
       assert (index < this->numElements ());
-      this->data[index] = value;
-      this->updateBounds (index);
+      this->data.write ()[index] = value;
+      this->dirty.mark (index);
     }
 
     const T& get (unsigned int index) const
     {
       assert (index < this->numElements ());
-      return this->data[index];
+      return (*this->data)[index];
+    }
+
+    const T* elements (unsigned int begin) const
+    {
+      assert (begin <= this->numElements ());
+      return this->data->data () + begin;
+    }
+  };
+
+  // a buffer object, whose data is uploaded from ranges of elements
+  struct GpuBuffer
+  {
+    OpenGLBufferId       id;
+    unsigned int         bufferSize;
+    unsigned int         numBufferedElements;
+    mutable unsigned int usedInFrame;
+
+    GpuBuffer () { this->reset (); }
+
+    void reset ()
+    {
+      this->id.reset ();
+      this->bufferSize = 0;
+      this->numBufferedElements = 0;
+      this->usedInFrame = 0;
     }
 
-    void bufferData (unsigned int target)
+    void markUsed () const { this->usedInFrame = FrameQueue::currentFrame (); }
+
+    /* Uploads the elements of the given pages, which are sorted and coalesced into ranges.  All
+     * elements are uploaded into a new buffer if the buffer grows, and into an orphaned buffer if
+     * at least half of the elements are dirty, so the driver need not wait for pending draws.
+     * A buffer that is still used by a queued frame is orphaned if a quarter of the elements are
+     * dirty, since updating it in place might stall until that frame is completed.
+     * `getData (begin, end)` returns the elements of a range.
+     */
+    template <typename F>
+    void bufferData (unsigned int target, unsigned int elementSize, unsigned int numElements,
+                     bool uploadAll, std::vector<unsigned int>& pages, const F& getData)
     {
       if (this->id.isValid () == false)
       {
@@ -91,29 +354,350 @@ namespace
       }
       OpenGL::glBindBuffer (target, this->id.id ());
 
-      const unsigned int dataSize = this->numElements () * sizeof (T);
+      const unsigned int dataSize = numElements * elementSize;
+      const unsigned int orphanFactor = FrameQueue::isCompleted (this->usedInFrame) ? 2 : 4;
 
       if (this->bufferSize == 0)
       {
-        OpenGL::glBufferData (target, dataSize, this->data.data (), OpenGL::StaticDraw ());
+        OpenGL::glBufferData (target, dataSize, getData (0, numElements), OpenGL::StaticDraw ());
         this->bufferSize = dataSize;
       }
       else if (this->bufferSize < dataSize)
       {
-        const unsigned int newBufferSize = this->bufferSize + (100 * (dataSize - this->bufferSize));
+        const unsigned int newBufferSize =
+          glm::max (dataSize, this->bufferSize + (this->bufferSize / 2));
 
-        OpenGL::glBufferData (target, newBufferSize, nullptr, OpenGL::StaticDraw ());
-        OpenGL::glBufferSubData (target, 0, dataSize, this->data.data ());
+        OpenGL::glBufferData (target, newBufferSize, nullptr, OpenGL::DynamicDraw ());
+        OpenGL::glBufferSubData (target, 0, dataSize, getData (0, numElements));
         this->bufferSize = newBufferSize;
       }
-      else if (this->dataLowerBound <= this->dataUpperBound)
+      else if (uploadAll || orphanFactor * (pages.size () << pageShift) >= numElements)
+      {
+        OpenGL::glBufferData (target, this->bufferSize, nullptr, OpenGL::DynamicDraw ());
+        OpenGL::glBufferSubData (target, 0, dataSize, getData (0, numElements));
+      }
+      else
       {
-        const unsigned int size = (this->dataUpperBound - this->dataLowerBound + 1) * sizeof (T);
+        std::sort (pages.begin (), pages.end ());
+
+        for (unsigned int i = 0; i < pages.size ();)
+        {
+          unsigned int j = i + 1;
+          while (j < pages.size () && pages[j] == pages[j - 1] + 1)
+          {
+            j++;
+          }
+
+          const unsigned int begin = pages[i] << pageShift;
+          const unsigned int end = glm::min ((pages[j - 1] + 1) << pageShift, numElements);
+
+          if (begin < end)
+          {
+            OpenGL::glBufferSubData (target, begin * elementSize, (end - begin) * elementSize,
+                                     getData (begin, end));
+          }
+          i = j;
+        }
+      }
+      this->numBufferedElements = numElements;
+    }
+  };
+
+  struct FloatNormalVertex
+  {
+    glm::vec3 position;
+    glm::vec3 normal;
+  };
+
+  struct PackedNormalVertex
+  {
+    glm::vec3 position;
+    uint32_t  normal;
+  };
+
+  static_assert (sizeof (FloatNormalVertex) == 6 * sizeof (float), "Unexpected memory layout");
+  static_assert (sizeof (PackedNormalVertex) == 4 * sizeof (float), "Unexpected memory layout");
+
+  // packs the components of a normal into signed 10-bit integers
+  uint32_t packNormal (const glm::vec3& n)
+  {
+    const auto pack = [](float c) -> uint32_t {
+      return uint32_t (int(glm::round (glm::clamp (c, -1.0f, 1.0f) * 511.0f))) & 0x3ffu;
+    };
+    return pack (n.x) | (pack (n.y) << 10) | (pack (n.z) << 20);
+  }
+
+  void setVertex (FloatNormalVertex& v, const glm::vec3& position, const glm::vec3& normal)
+  {
+    v.position = position;
+    v.normal = normal;
+  }
+
+  void setVertex (PackedNormalVertex& v, const glm::vec3& position, const glm::vec3& normal)
+  {
+    v.position = position;
+    v.normal = packNormal (normal);
+  }
+
+  // a vertex of a compact mesh, cf. `CompactVertices`
+  struct CompactVertex
+  {
+    uint16_t position[4];
+    int16_t  normal[2];
+  };
+
+  static_assert (sizeof (CompactVertex) == 3 * sizeof (float), "Unexpected memory layout");
+
+  glm::vec2 signNotZero (const glm::vec2& v)
+  {
+    return glm::vec2 (v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+  }
+
+  // cf. Cigolle et al.: A Survey of Efficient Representations for Independent Unit Vectors
+  glm::vec2 toOctahedral (const glm::vec3& n)
+  {
+    const float l1 = glm::abs (n.x) + glm::abs (n.y) + glm::abs (n.z);
+
+    if (l1 == 0.0f)
+    {
+      return glm::vec2 (0.0f);
+    }
+    const glm::vec2 p = glm::vec2 (n.x, n.y) / l1;
+    return n.z >= 0.0f ? p : (glm::vec2 (1.0f) - glm::abs (glm::vec2 (p.y, p.x))) * signNotZero (p);
+  }
+
+  glm::vec3 fromOctahedral (const glm::vec2& e)
+  {
+    const float z = 1.0f - glm::abs (e.x) - glm::abs (e.y);
+
+    if (z >= 0.0f)
+    {
+      return glm::normalize (glm::vec3 (e.x, e.y, z));
+    }
+    const glm::vec2 p = (glm::vec2 (1.0f) - glm::abs (glm::vec2 (e.y, e.x))) * signNotZero (e);
+    return glm::normalize (glm::vec3 (p.x, p.y, z));
+  }
+
+  /* Positions of compact meshes are quantized to 16 bits per coordinate relative to the bounds
+   * of the mesh, and normals are stored as octahedral coordinates of 16 bits each.  The vertices
+   * are uploaded as they are: normalized attributes map the quantized positions to the unit
+   * cube, which is mapped to the bounds by the model matrix, and the vertex shader decodes the
+   * normals.
+   */
+  struct CompactVertices
+  {
+    CopyOnWrite<std::vector<CompactVertex>> data;
+    glm::vec3                               origin;
+    glm::vec3                               extent;
+    bool                                    isUsed;
+    bool                                    isDirty;
+
+    CompactVertices () { this->reset (); }
+
+    void reset ()
+    {
+      this->data.reset ();
+      this->origin = glm::vec3 (0.0f);
+      this->extent = glm::vec3 (0.0f);
+      this->isUsed = false;
+      this->isDirty = false;
+    }
+
+    unsigned int numElements () const { return this->data->size (); }
+
+    std::size_t numBytes () const { return this->data->capacity () * sizeof (CompactVertex); }
+
+    void compact (const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals)
+    {
+      assert (positions.size () == normals.size ());
+
+      glm::vec3 min = glm::vec3 (Util::maxFloat ());
+      glm::vec3 max = glm::vec3 (Util::minFloat ());
 
-        OpenGL::glBufferSubData (target, this->dataLowerBound * sizeof (T), size,
-                                 &this->get (this->dataLowerBound));
+      for (const glm::vec3& p : positions)
+      {
+        min = glm::min (min, p);
+        max = glm::max (max, p);
+      }
+      this->origin = positions.empty () ? glm::vec3 (0.0f) : min;
+      this->extent = positions.empty () ? glm::vec3 (0.0f) : max - min;
+
+      const glm::vec3 scale (this->extent.x > 0.0f ? 65535.0f / this->extent.x : 0.0f,
+                             this->extent.y > 0.0f ? 65535.0f / this->extent.y : 0.0f,
+                             this->extent.z > 0.0f ? 65535.0f / this->extent.z : 0.0f);
+
+      std::vector<CompactVertex>& vertices = this->data.write ();
+      vertices.resize (positions.size ());
+
+      Parallel::forEach (positions.size (), [this, &positions, &normals, &scale,
+                                             &vertices](unsigned int i) {
+        const glm::vec3 q =
+          glm::clamp (glm::round ((positions[i] - this->origin) * scale), 0.0f, 65535.0f);
+        const glm::vec2 o = glm::round (toOctahedral (normals[i]) * 32767.0f);
+
+        vertices[i] = CompactVertex{{uint16_t (q.x), uint16_t (q.y), uint16_t (q.z), 0},
+                                    {int16_t (o.x), int16_t (o.y)}};
+      });
+      this->isUsed = true;
+      this->isDirty = true;
+    }
+
+    void expand (std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const
+    {
+      const std::vector<CompactVertex>& vertices = *this->data;
+
+      positions.resize (vertices.size ());
+      normals.resize (vertices.size ());
+
+      Parallel::forEach (vertices.size (), [this, &vertices, &positions,
+                                            &normals](unsigned int i) {
+        const CompactVertex& v = vertices[i];
+        const glm::vec3      q (v.position[0], v.position[1], v.position[2]);
+
+        positions[i] = this->origin + (this->extent * (q / 65535.0f));
+        normals[i] = fromOctahedral (glm::max (glm::vec2 (v.normal[0], v.normal[1]) / 32767.0f,
+                                               glm::vec2 (-1.0f)));
+      });
+    }
+
+    // maps the normalized positions of the vertex buffer to the bounds
+    glm::mat4x4 dequantization () const
+    {
+      return glm::scale (glm::translate (glm::mat4x4 (1.0f), this->origin),
+                         glm::max (this->extent, glm::vec3 (Util::epsilon ())));
+    }
+  };
+
+  /* Positions and normals are interleaved in a single buffer object.  Normals are packed into
+   * 10-10-10-2 integers if supported, which shrinks the uploaded data by a third.  The vertices
+   * of compact meshes are uploaded without conversion.
+   */
+  struct VertexBuffer
+  {
+    GpuBuffer                  buffer;
+    bool                       packNormals;
+    bool                       isCompact;
+    std::vector<unsigned char> interleaved;
+    std::vector<unsigned int>  pages;
+
+    VertexBuffer () { this->reset (); }
+
+    void reset ()
+    {
+      this->buffer.reset ();
+      this->packNormals = false;
+      this->isCompact = false;
+      this->interleaved.clear ();
+      this->pages.clear ();
+    }
+
+    unsigned int stride () const
+    {
+      if (this->isCompact)
+      {
+        return sizeof (CompactVertex);
+      }
+      return this->packNormals ? sizeof (PackedNormalVertex) : sizeof (FloatNormalVertex);
+    }
+
+    std::size_t numBytes () const
+    {
+      return this->interleaved.capacity () + (this->pages.capacity () * sizeof (unsigned int));
+    }
+
+    template <typename V>
+    const void* interleave (const BufferedData<glm::vec3>& vertices,
+                            const BufferedData<glm::vec3>& normals, unsigned int begin,
+                            unsigned int end)
+    {
+      this->interleaved.resize ((end - begin) * sizeof (V));
+
+      V* data = reinterpret_cast<V*> (this->interleaved.data ());
+      for (unsigned int i = begin; i < end; i++)
+      {
+        setVertex (data[i - begin], vertices.get (i), normals.get (i));
+      }
+      return data;
+    }
+
+    void bufferData (const BufferedData<glm::vec3>& vertices,
+                     const BufferedData<glm::vec3>& normals)
+    {
+      assert (vertices.numElements () == normals.numElements ());
+
+      if (this->buffer.id.isValid () == false)
+      {
+        this->packNormals = OpenGL::hasPackedNormals ();
+      }
+
+      const auto getData = [this, &vertices, &normals](unsigned int begin, unsigned int end) {
+        return this->packNormals
+                 ? this->interleave<PackedNormalVertex> (vertices, normals, begin, end)
+                 : this->interleave<FloatNormalVertex> (vertices, normals, begin, end);
+      };
+
+      this->pages = vertices.dirty.pages;
+      for (unsigned int p : normals.dirty.pages)
+      {
+        if (p >= vertices.dirty.isDirty.size () || vertices.dirty.isDirty[p] == false)
+        {
+          this->pages.push_back (p);
+        }
+      }
+
+      this->buffer.bufferData (OpenGL::ArrayBuffer (), this->stride (), vertices.numElements (),
+                               vertices.dirty.includesAll || normals.dirty.includesAll,
+                               this->pages, getData);
+
+      // the interleaved data of partial uploads is kept for the next sculpting step
+      if (this->interleaved.size () == vertices.numElements () * this->stride ())
+      {
+        std::vector<unsigned char> ().swap (this->interleaved);
+      }
+    }
+
+    void bufferData (const CompactVertices& vertices)
+    {
+      std::vector<unsigned int> noPages;
+
+      this->isCompact = true;
+      this->buffer.bufferData (OpenGL::ArrayBuffer (), this->stride (), vertices.numElements (),
+                               true, noPages, [&vertices](unsigned int begin, unsigned int) {
+                                 return vertices.data->data () + begin;
+                               });
+    }
+
+    void setAttributes () const
+    {
+      const void* normalOffset = reinterpret_cast<const void*> (
+        this->isCompact ? offsetof (CompactVertex, normal) : sizeof (glm::vec3));
+
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->buffer.id.id ());
+      OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
+
+      if (this->isCompact)
+      {
+        OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::UnsignedShort (), true,
+                                       this->stride (), nullptr);
+        OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 2, OpenGL::Short (), true,
+                                       this->stride (), normalOffset);
+      }
+      else
+      {
+        OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false,
+                                       this->stride (), nullptr);
+        if (this->packNormals)
+        {
+          OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 4, OpenGL::Int2101010Rev (), true,
+                                         this->stride (), normalOffset);
+        }
+        else
+        {
+          OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false,
+                                         this->stride (), normalOffset);
+        }
       }
-      this->resetBounds ();
     }
   };
 }
@@ -127,8 +711,19 @@ struct Mesh::Impl
   BufferedData<glm::vec3>    vertices;
   BufferedData<unsigned int> indices;
   BufferedData<glm::vec3>    normals;
+  mutable PageBounds         vertexBounds;
+  CompactVertices            compactVertices;
+  VertexBuffer               vertexBuffer;
+  GpuBuffer                  indexBuffer;
+  GpuBuffer                  edgeBuffer;
+  std::vector<unsigned int>  normalWork;
+  unsigned int               numNormalWork;
+  GpuBuffer                  normalWorkBuffer;
+  mutable unsigned int       numPendingNormals;
+  OpenGLVertexArrayId        vertexArray;
   Color                      color;
   Color                      wireframeColor;
+  unsigned int               bufferVersion;
 
   RenderMode renderMode;
 
@@ -136,13 +731,20 @@ struct Mesh::Impl
     : scalingMatrix (glm::mat4x4 (1.0f))
     , rotationMatrix (glm::mat4x4 (1.0f))
     , translationMatrix (glm::mat4x4 (1.0f))
+    , numNormalWork (0)
+    , numPendingNormals (0)
     , color (Color::White ())
     , wireframeColor (Color::Black ())
+    , bufferVersion (0)
   {
     this->renderMode.smoothShading (true);
   }
 
-  unsigned int numVertices () const { return this->vertices.numElements (); }
+  unsigned int numVertices () const
+  {
+    return this->isCompact () ? this->compactVertices.numElements ()
+                              : this->vertices.numElements ();
+  }
 
   unsigned int numIndices () const { return this->indices.numElements (); }
 
@@ -164,6 +766,8 @@ struct Mesh::Impl
 
   unsigned int addIndex (unsigned int i) { return this->indices.add (i); }
 
+  void addIndices (const unsigned int* is, unsigned int n) { this->indices.add (is, n); }
+
   void reserveIndices (unsigned int n) { this->indices.reserve (n); }
 
   void shrinkIndices (unsigned int n) { this->indices.shrink (n); }
@@ -172,14 +776,28 @@ struct Mesh::Impl
 
   unsigned int addVertex (const glm::vec3& v, const glm::vec3& n)
   {
+    assert (this->isCompact () == false);
     assert (Util::isNaN (v) == false);
     assert (Util::isNaN (n) == false);
     assert (this->vertices.numElements () == this->normals.numElements ());
 
-    this->vertices.add (v);
+    this->vertexBounds.grow (this->vertices.add (v), v);
     return this->normals.add (n);
   }
 
+  void addVertices (const glm::vec3* vs, const glm::vec3* ns, unsigned int n)
+  {
+    assert (this->isCompact () == false);
+    assert (this->vertices.numElements () == this->normals.numElements ());
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      this->vertexBounds.grow (this->vertices.numElements () + i, vs[i]);
+    }
+    this->vertices.add (vs, n);
+    this->normals.add (ns, n);
+  }
+
   void reserveVertices (unsigned int n)
   {
     this->vertices.reserve (n);
@@ -190,6 +808,7 @@ struct Mesh::Impl
   {
     this->vertices.shrink (n);
     this->normals.shrink (n);
+    this->vertexBounds.shrink (n);
   }
 
   void index (unsigned int i, unsigned int index) { this->indices.set (i, index); }
@@ -197,6 +816,7 @@ struct Mesh::Impl
   void vertex (unsigned int i, const glm::vec3& v)
   {
     assert (Util::isNaN (v) == false);
+    this->vertexBounds.update (i, this->vertices.get (i), v);
     this->vertices.set (i, v);
   }
 
@@ -206,14 +826,183 @@ struct Mesh::Impl
     this->normals.set (i, n);
   }
 
+  void compact ()
+  {
+    assert (this->isCompact () == false);
+
+    this->compactVertices.compact (*this->vertices.data, *this->normals.data);
+    this->vertices.reset ();
+    this->normals.reset ();
+    this->vertexBounds.reset ();
+    this->resetVertexBuffer ();
+  }
+
+  void expand ()
+  {
+    assert (this->isCompact ());
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+
+    this->compactVertices.expand (positions, normals);
+    this->compactVertices.reset ();
+    this->addVertices (positions.data (), normals.data (), positions.size ());
+    this->resetVertexBuffer ();
+  }
+
+  bool isCompact () const { return this->compactVertices.isUsed; }
+
+  // the layout of the vertex buffer changes
+  void resetVertexBuffer ()
+  {
+    this->bufferVersion++;
+    this->vertexArray.reset ();
+    this->vertexBuffer.reset ();
+    this->resetNormalWork ();
+  }
+
+  void recomputeNormals (unsigned int numVertices, const std::vector<unsigned int>& work)
+  {
+    assert (this->isCompact () == false);
+    assert (OpenGL::hasComputeShader ());
+
+    this->numNormalWork = numVertices;
+    this->normalWork = work;
+  }
+
+  void resetNormalWork ()
+  {
+    this->normalWork.clear ();
+    this->numNormalWork = 0;
+    this->numPendingNormals = 0;
+  }
+
+  // the work is uploaded after the vertices, whose normals it overwrites when rendering next
+  void bufferNormalWork ()
+  {
+    std::vector<unsigned int> noPages;
+
+    this->normalWorkBuffer.bufferData (
+      OpenGL::ShaderStorageBuffer (), sizeof (unsigned int), this->normalWork.size (), true,
+      noPages, [this](unsigned int, unsigned int) { return this->normalWork.data (); });
+    OpenGL::glBindBuffer (OpenGL::ShaderStorageBuffer (), 0);
+
+    this->numPendingNormals = this->numNormalWork;
+    this->normalWork.clear ();
+    this->numNormalWork = 0;
+  }
+
+  /* Without geometry shaders the wireframe is rendered from a separate index buffer of lines.
+   * Meshes are closed and consistently oriented, hence each edge is shared by two triangles
+   * in opposite directions and emitted only once from its lower to its higher vertex index.
+   */
+  static bool renderWireframeByLines () { return OpenGL::hasGeometryShader () == false; }
+
+  void bufferEdges ()
+  {
+    const std::vector<unsigned int>& is = *this->indices.data;
+    std::vector<unsigned int>        edges;
+
+    edges.reserve (is.size ());
+
+    for (unsigned int i = 0; i + 2 < is.size (); i += 3)
+    {
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        const unsigned int i1 = is[i + j];
+        const unsigned int i2 = is[i + ((j + 1) % 3)];
+
+        if (i1 < i2)
+        {
+          edges.push_back (i1);
+          edges.push_back (i2);
+        }
+      }
+    }
+
+    std::vector<unsigned int> noPages;
+    this->edgeBuffer.bufferData (OpenGL::ElementArrayBuffer (), sizeof (unsigned int),
+                                 edges.size (), true, noPages,
+                                 [&edges](unsigned int, unsigned int) { return edges.data (); });
+  }
+
+  // the vertex array object records the bindings once the buffer objects exist
   void bufferData ()
   {
-    this->vertices.bufferData (OpenGL::ArrayBuffer ());
-    this->indices.bufferData (OpenGL::ElementArrayBuffer ());
-    this->normals.bufferData (OpenGL::ArrayBuffer ());
+    DILAY_PROFILE_ZONE ("Mesh::bufferData");
+
+    this->bufferVersion++;
+
+    if (OpenGL::isInitialized () == false)
+    {
+      this->vertices.dirty.reset ();
+      this->indices.dirty.reset ();
+      this->normals.dirty.reset ();
+      this->compactVertices.isDirty = false;
+      this->resetNormalWork ();
+      return;
+    }
+
+    const bool indicesChanged =
+      this->indices.dirty.includesAll || this->indices.dirty.pages.empty () == false;
+
+    if (this->isCompact () == false)
+    {
+      this->vertexBuffer.bufferData (this->vertices, this->normals);
+    }
+    else if (this->compactVertices.isDirty || this->vertexBuffer.buffer.id.isValid () == false)
+    {
+      this->vertexBuffer.bufferData (this->compactVertices);
+    }
+    this->indexBuffer.bufferData (
+      OpenGL::ElementArrayBuffer (), sizeof (unsigned int), this->indices.numElements (),
+      this->indices.dirty.includesAll, this->indices.dirty.pages,
+      [this](unsigned int begin, unsigned int) { return this->indices.elements (begin); });
+
+    if (this->numNormalWork > 0 && this->isCompact () == false)
+    {
+      this->bufferNormalWork ();
+    }
+    else
+    {
+      this->resetNormalWork ();
+    }
+
+    if (Impl::renderWireframeByLines () &&
+        (indicesChanged || this->edgeBuffer.id.isValid () == false))
+    {
+      this->bufferEdges ();
+    }
+
+    this->vertices.dirty.reset ();
+    this->indices.dirty.reset ();
+    this->normals.dirty.reset ();
+    this->compactVertices.isDirty = false;
 
     OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
     OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+
+    if (OpenGL::hasVertexArrayObject () && OpenGL::isSecondaryContext () == false &&
+        this->vertexArray.isValid () == false)
+    {
+      this->vertexArray.allocate ();
+      OpenGL::glBindVertexArray (this->vertexArray.id ());
+      this->bindBuffers ();
+      OpenGL::glBindVertexArray (0);
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
+  }
+
+  // vertex arrays are not shared, hence secondary contexts specify the attributes on each render
+  bool useVertexArray () const
+  {
+    return this->vertexArray.isValid () && OpenGL::isSecondaryContext () == false;
+  }
+
+  void bindBuffers () const
+  {
+    this->vertexBuffer.setAttributes ();
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indexBuffer.id.id ());
   }
 
   glm::mat4x4 modelMatrix () const
@@ -226,42 +1015,56 @@ struct Mesh::Impl
     return glm::inverseTranspose (glm::mat3x3 (this->modelMatrix ()));
   }
 
+  // the model matrix of a compact mesh also dequantizes its positions
   void setModelMatrix (Camera& camera, bool noZoom) const
   {
-    camera.setModelViewProjection (this->modelMatrix (), this->modelNormalMatrix (), noZoom);
+    const glm::mat4x4 model = this->isCompact ()
+                                ? this->modelMatrix () * this->compactVertices.dequantization ()
+                                : this->modelMatrix ();
+
+    camera.setModelViewProjection (model, this->modelNormalMatrix (), noZoom);
   }
 
-  void renderBegin (Camera& camera) const
+  void renderBegin (Camera& camera) const { this->renderBegin (camera, this->renderMode); }
+
+  void renderBegin (Camera& camera, const RenderMode& renderMode) const
   {
-    if (this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false)
+    if (this->numPendingNormals > 0 && OpenGL::isSecondaryContext () == false)
     {
-      RenderMode nonWireframeRenderMode (this->renderMode);
-      nonWireframeRenderMode.renderWireframe (false);
-
-      camera.renderer ().setProgram (nonWireframeRenderMode);
+      this->normalWorkBuffer.markUsed ();
+      camera.renderer ().recomputeNormals (
+        this->vertexBuffer.buffer.id.id (), this->normalWorkBuffer.id.id (),
+        this->numPendingNormals, this->vertexBuffer.stride () / sizeof (uint32_t),
+        this->vertexBuffer.packNormals);
+      this->numPendingNormals = 0;
     }
-    else
+
+    RenderMode programRenderMode (renderMode);
+    programRenderMode.octahedralNormals (this->isCompact ());
+
+    if (renderMode.renderWireframe () && Impl::renderWireframeByLines ())
     {
-      camera.renderer ().setProgram (this->renderMode);
+      programRenderMode.renderWireframe (false);
     }
+    camera.renderer ().setProgram (programRenderMode);
     camera.renderer ().setColor (this->color);
     camera.renderer ().setWireframeColor (this->wireframeColor);
 
     this->setModelMatrix (camera, this->renderMode.cameraRotationOnly ());
 
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
-    OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, 0);
-
-    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indices.id.id ());
+    this->vertexBuffer.buffer.markUsed ();
+    this->indexBuffer.markUsed ();
+    this->edgeBuffer.markUsed ();
 
-    if (this->renderMode.smoothShading ())
+    if (this->useVertexArray ())
     {
-      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
-      OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
-      OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false, 0, 0);
+      OpenGL::glBindVertexArray (this->vertexArray.id ());
+    }
+    else
+    {
+      this->bindBuffers ();
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
     }
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
 
     if (this->renderMode.noDepthTest ())
     {
@@ -271,29 +1074,146 @@ struct Mesh::Impl
 
   void renderEnd () const
   {
-    OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
-    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    if (this->useVertexArray ())
+    {
+      OpenGL::glBindVertexArray (0);
+    }
+    else
+    {
+      OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+      OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    }
     OpenGL::glEnable (OpenGL::DepthTest ());
   }
 
+  // renders the buffered data, which may be outdated while the mesh is modified on another thread
   void render (Camera& camera) const
   {
-    this->renderBegin (camera);
+    this->renderTriangles (camera, this->renderMode,
+                           [](unsigned int primitive, unsigned int numIndices) {
+                             OpenGL::glDrawElements (primitive, numIndices,
+                                                     OpenGL::UnsignedInt (), nullptr);
+                           });
+  }
+
+  void render (Camera& camera, const RenderMode& renderMode, const Color& color) const
+  {
+    this->renderTriangles (camera, renderMode,
+                           [&camera, &color](unsigned int primitive, unsigned int numIndices) {
+                             if (primitive == OpenGL::Triangles ())
+                             {
+                               camera.renderer ().setColor (color);
+                             }
+                             OpenGL::glDrawElements (primitive, numIndices,
+                                                     OpenGL::UnsignedInt (), nullptr);
+                           });
+  }
+
+  void render (Camera& camera, const std::vector<unsigned int>& firsts,
+               const std::vector<unsigned int>& counts) const
+  {
+    assert (firsts.size () == counts.size ());
 
-    OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                            nullptr);
+    const unsigned int numIndices = this->indexBuffer.numBufferedElements;
 
-    if (this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false)
+    std::vector<int>         clippedCounts;
+    std::vector<const void*> offsets;
+
+    clippedCounts.reserve (firsts.size ());
+    offsets.reserve (firsts.size ());
+
+    for (unsigned int i = 0; i < firsts.size (); i++)
     {
-      camera.renderer ().setColor (this->wireframeColor);
-      OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Line ());
+      if (firsts[i] < numIndices)
+      {
+        clippedCounts.push_back (int(glm::min (counts[i], numIndices - firsts[i])));
+        offsets.push_back (
+          reinterpret_cast<const void*> (std::uintptr_t (firsts[i] * sizeof (unsigned int))));
+      }
+    }
+
+    if (offsets.empty () == false)
+    {
+      this->renderTriangles (
+        camera, this->renderMode,
+        [&clippedCounts, &offsets](unsigned int primitive, unsigned int numIndices) {
+          if (primitive == OpenGL::Triangles ())
+          {
+            OpenGL::glMultiDrawElements (primitive, clippedCounts.data (),
+                                         OpenGL::UnsignedInt (), offsets.data (),
+                                         int(offsets.size ()));
+          }
+          else
+          {
+            OpenGL::glDrawElements (primitive, numIndices, OpenGL::UnsignedInt (), nullptr);
+          }
+        });
+    }
+  }
 
-      OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                              nullptr);
+  // instances are rendered one by one if instancing is not supported
+  void renderInstances (Camera& camera, MeshInstances& instances) const
+  {
+    assert (this->isCompact () == false);
 
-      OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Fill ());
+    if (instances.numInstances () == 0)
+    {
+      return;
+    }
+    else if (OpenGL::hasInstancing ())
+    {
+      RenderMode renderMode (this->renderMode);
+      renderMode.instancing (true);
+
+      instances.bufferData ();
+      this->renderTriangles (camera, renderMode,
+                             [&instances](unsigned int primitive, unsigned int numIndices) {
+                               instances.bindAttributes ();
+                               OpenGL::glDrawElementsInstanced (primitive, numIndices,
+                                                                OpenGL::UnsignedInt (), nullptr,
+                                                                instances.numInstances ());
+                               instances.unbindAttributes ();
+                             });
+    }
+    else
+    {
+      this->renderTriangles (camera, this->renderMode,
+                             [&camera, &instances](unsigned int primitive,
+                                                   unsigned int numIndices) {
+                               for (unsigned int i = 0; i < instances.numInstances (); i++)
+                               {
+                                 camera.renderer ().setModel (instances.model (i),
+                                                              instances.modelNormal (i));
+                                 OpenGL::glDrawElements (primitive, numIndices,
+                                                         OpenGL::UnsignedInt (), nullptr);
+                               }
+                             });
+    }
+  }
+
+  // `draw (primitive, numIndices)` draws the triangles and the lines of the wireframe fallback
+  template <typename F>
+  void renderTriangles (Camera& camera, const RenderMode& renderMode, const F& draw) const
+  {
+    this->renderBegin (camera, renderMode);
+
+    if (renderMode.renderWireframe () && Impl::renderWireframeByLines ())
+    {
+      OpenGL::glEnable (OpenGL::PolygonOffsetFill ());
+      OpenGL::glPolygonOffset (1.0f, 1.0f);
+      draw (OpenGL::Triangles (), this->indexBuffer.numBufferedElements);
+      OpenGL::glDisable (OpenGL::PolygonOffsetFill ());
+
+      camera.renderer ().setColor (this->wireframeColor);
+
+      OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->edgeBuffer.id.id ());
+      draw (OpenGL::Lines (), this->edgeBuffer.numBufferedElements);
+      OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indexBuffer.id.id ());
+    }
+    else
+    {
+      draw (OpenGL::Triangles (), this->indexBuffer.numBufferedElements);
     }
 
     this->renderEnd ();
@@ -302,10 +1222,57 @@ struct Mesh::Impl
   void renderLines (Camera& camera) const
   {
     this->renderBegin (camera);
-    OpenGL::glDrawElements (OpenGL::Lines (), this->numIndices (), OpenGL::UnsignedInt (), nullptr);
+    OpenGL::glDrawElements (OpenGL::Lines (), this->indexBuffer.numBufferedElements,
+                            OpenGL::UnsignedInt (), nullptr);
     this->renderEnd ();
   }
 
+  std::size_t renderKey () const
+  {
+    const glm::mat4x4 model = this->modelMatrix ();
+    std::size_t       key = 0;
+
+    Hash::combine (key, this->bufferVersion);
+    Hash::combine (key, this->renderMode.value ());
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      Hash::combine (key, this->color.vec4 ()[i]);
+      Hash::combine (key, this->wireframeColor.vec4 ()[i]);
+
+      for (unsigned int j = 0; j < 4; j++)
+      {
+        Hash::combine (key, model[i][j]);
+      }
+    }
+    return key;
+  }
+
+  std::size_t numBytes () const
+  {
+    return sizeof (Mesh::Impl) + this->vertices.numBytes () + this->indices.numBytes () +
+           this->normals.numBytes () + this->vertexBounds.numBytes () +
+           this->compactVertices.numBytes () + this->vertexBuffer.numBytes () +
+           (this->normalWork.capacity () * sizeof (unsigned int));
+  }
+
+  std::size_t numBufferBytes () const
+  {
+    return this->vertexBuffer.buffer.bufferSize + this->indexBuffer.bufferSize +
+           this->edgeBuffer.bufferSize + this->normalWorkBuffer.bufferSize;
+  }
+
+  void releaseStagingBuffers ()
+  {
+    std::vector<unsigned char> ().swap (this->vertexBuffer.interleaved);
+    std::vector<unsigned int> ().swap (this->vertexBuffer.pages);
+
+    if (this->numNormalWork == 0)
+    {
+      std::vector<unsigned int> ().swap (this->normalWork);
+    }
+  }
+
   void reset ()
   {
     this->scalingMatrix = glm::mat4x4 (1.0f);
@@ -316,9 +1283,18 @@ struct Mesh::Impl
 
   void resetGeometry ()
   {
+    this->bufferVersion++;
+    this->vertexArray.reset ();
     this->vertices.reset ();
     this->indices.reset ();
     this->normals.reset ();
+    this->vertexBounds.reset ();
+    this->compactVertices.reset ();
+    this->vertexBuffer.reset ();
+    this->indexBuffer.reset ();
+    this->edgeBuffer.reset ();
+    this->normalWorkBuffer.reset ();
+    this->resetNormalWork ();
   }
 
   void scale (const glm::vec3& v) { this->scalingMatrix = glm::scale (this->scalingMatrix, v); }
@@ -371,19 +1347,41 @@ struct Mesh::Impl
 
   void rotateZ (float angle) { this->rotate (glm::vec3 (0.0f, 0.0f, 1.0f), angle); }
 
-  void normalize ()
+  /* Vertices and normals are transformed in chunks of pages, which are written in place, and the
+   * bounds of their pages are recomputed in parallel afterwards.
+   */
+  void transform (const glm::mat4x4& model)
   {
-    const glm::mat4x4 model = this->modelMatrix ();
-    const glm::mat3x3 modelNormal = this->modelNormalMatrix ();
+    assert (this->isCompact () == false);
+
+    const glm::mat3x3       modelNormal = glm::inverseTranspose (glm::mat3x3 (model));
+    std::vector<glm::vec3>& vertices = this->vertices.data.write ();
+    std::vector<glm::vec3>& normals = this->normals.data.write ();
+
+    Parallel::forRange (vertices.size (), 1 << pageShift,
+                        [&model, &modelNormal, &vertices, &normals](unsigned int begin,
+                                                                    unsigned int end) {
+                          for (unsigned int i = begin; i < end; i++)
+                          {
+                            vertices[i] = Util::transformPosition (model, vertices[i]);
+                          }
+                          for (unsigned int i = begin; i < end; i++)
+                          {
+                            if (Util::isNotNull (normals[i]))
+                            {
+                              normals[i] = glm::normalize (modelNormal * normals[i]);
+                            }
+                          }
+                        });
+    this->vertices.dirty.markAll ();
+    this->normals.dirty.markAll ();
+    this->vertexBounds.rebuild (vertices.size (),
+                                [&vertices](unsigned int i) { return vertices[i]; });
+  }
 
-    for (unsigned int i = 0; i < this->numVertices (); i++)
-    {
-      this->vertex (i, Util::transformPosition (model, this->vertex (i)));
-      if (Util::isNotNull (this->normal (i)))
-      {
-        this->normal (i, glm::normalize (modelNormal * this->normal (i)));
-      }
-    }
+  void normalize ()
+  {
+    this->transform (this->modelMatrix ());
     this->position (glm::vec3 (0.0f));
     this->scaling (glm::vec3 (1.0f));
     this->rotationMatrix = glm::mat4x4 (1.0f);
@@ -391,15 +1389,13 @@ struct Mesh::Impl
 
   PrimAABox bounds () const
   {
-    glm::vec3 min = glm::vec3 (Util::maxFloat ());
-    glm::vec3 max = glm::vec3 (Util::minFloat ());
-
-    for (unsigned int i = 0; i < this->numVertices (); i++)
+    if (this->isCompact ())
     {
-      min = glm::min (min, this->vertices.get (i));
-      max = glm::max (max, this->vertices.get (i));
+      return PrimAABox (this->compactVertices.origin,
+                        this->compactVertices.origin + this->compactVertices.extent);
     }
-    return PrimAABox (min, max);
+    return this->vertexBounds.bounds (this->numVertices (),
+                                      [this](unsigned int i) { return this->vertices.get (i); });
   }
 };
 
@@ -412,23 +1408,37 @@ DELEGATE1_CONST (const glm::vec3&, Mesh, normal, unsigned int)
 
 DELEGATE1 (void, Mesh, copyNonGeometry, const Mesh&)
 DELEGATE1 (unsigned int, Mesh, addIndex, unsigned int)
+DELEGATE2 (void, Mesh, addIndices, const unsigned int*, unsigned int)
 DELEGATE1 (void, Mesh, reserveIndices, unsigned int)
 DELEGATE1 (void, Mesh, shrinkIndices, unsigned int)
 DELEGATE1 (unsigned int, Mesh, addVertex, const glm::vec3&)
 DELEGATE2 (unsigned int, Mesh, addVertex, const glm::vec3&, const glm::vec3&)
+DELEGATE3 (void, Mesh, addVertices, const glm::vec3*, const glm::vec3*, unsigned int)
 DELEGATE1 (void, Mesh, reserveVertices, unsigned int)
 DELEGATE1 (void, Mesh, shrinkVertices, unsigned int)
 DELEGATE2 (void, Mesh, index, unsigned int, unsigned int)
 DELEGATE2 (void, Mesh, vertex, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Mesh, normal, unsigned int, const glm::vec3&)
+DELEGATE (void, Mesh, compact)
+DELEGATE (void, Mesh, expand)
+DELEGATE_CONST (bool, Mesh, isCompact)
 
+DELEGATE2 (void, Mesh, recomputeNormals, unsigned int, const std::vector<unsigned int>&)
 DELEGATE (void, Mesh, bufferData)
 DELEGATE_CONST (glm::mat4x4, Mesh, modelMatrix)
 DELEGATE_CONST (glm::mat3x3, Mesh, modelNormalMatrix)
 DELEGATE1_CONST (void, Mesh, renderBegin, Camera&)
 DELEGATE_CONST (void, Mesh, renderEnd)
 DELEGATE1_CONST (void, Mesh, render, Camera&)
+DELEGATE3_CONST (void, Mesh, render, Camera&, const RenderMode&, const Color&)
+DELEGATE3_CONST (void, Mesh, render, Camera&, const std::vector<unsigned int>&,
+                 const std::vector<unsigned int>&)
+DELEGATE2_CONST (void, Mesh, renderInstances, Camera&, MeshInstances&)
 DELEGATE1_CONST (void, Mesh, renderLines, Camera&)
+DELEGATE_CONST (std::size_t, Mesh, renderKey)
+DELEGATE_CONST (std::size_t, Mesh, numBytes)
+DELEGATE_CONST (std::size_t, Mesh, numBufferBytes)
+DELEGATE (void, Mesh, releaseStagingBuffers)
 DELEGATE (void, Mesh, reset)
 DELEGATE (void, Mesh, resetGeometry)
 GETTER_CONST (const RenderMode&, Mesh, renderMode)
@@ -451,6 +1461,7 @@ DELEGATE2 (void, Mesh, rotate, const glm::vec3&, float)
 DELEGATE1 (void, Mesh, rotateX, float)
 DELEGATE1 (void, Mesh, rotateY, float)
 DELEGATE1 (void, Mesh, rotateZ, float)
+DELEGATE1 (void, Mesh, transform, const glm::mat4x4&)
 DELEGATE (void, Mesh, normalize)
 DELEGATE_CONST (PrimAABox, Mesh, bounds)
 GETTER_CONST (const Color&, Mesh, color)
@@ -6,10 +6,12 @@
 #define DILAY_MESH
 
 #include <glm/fwd.hpp>
+#include <vector>
 #include "macro.hpp"
 
 class Camera;
 class Color;
+class MeshInstances;
 class PrimAABox;
 class RenderFlags;
 class RenderMode;
@@ -26,23 +28,48 @@ public:
   const glm::vec3& normal (unsigned int) const;
   void             copyNonGeometry (const Mesh&);
   unsigned int     addIndex (unsigned int);
+  void             addIndices (const unsigned int*, unsigned int);
   void             reserveIndices (unsigned int);
   void             shrinkIndices (unsigned int);
   unsigned int     addVertex (const glm::vec3&);
   unsigned int     addVertex (const glm::vec3&, const glm::vec3&);
+  void             addVertices (const glm::vec3*, const glm::vec3*, unsigned int);
   void             reserveVertices (unsigned int);
   void             shrinkVertices (unsigned int);
   void             index (unsigned int, unsigned int);
   void             vertex (unsigned int, const glm::vec3&);
   void             normal (unsigned int, const glm::vec3&);
+  // quantizes the vertices, which cannot be accessed until the mesh is expanded again
+  void             compact ();
+  void             expand ();
+  bool             isCompact () const;
 
+  /* Recomputes the normals of the given number of vertices on the GPU, once the mesh has been
+   * buffered next and before it is rendered, i.e., without changing the normals of the mesh.
+   * Requires compute shaders (cf. `Shader::normalComputeShader` for the layout of the work).
+   */
+  void              recomputeNormals (unsigned int, const std::vector<unsigned int>&);
   void              bufferData ();
   glm::mat4x4       modelMatrix () const;
   glm::mat3x3       modelNormalMatrix () const;
   void              renderBegin (Camera&) const;
   void              renderEnd () const;
   void              render (Camera&) const;
+  // renders with another render mode and color
+  void              render (Camera&, const RenderMode&, const Color&) const;
+  // renders the index ranges given by their first indices and numbers of indices
+  void              render (Camera&, const std::vector<unsigned int>&,
+                            const std::vector<unsigned int>&) const;
+  void              renderInstances (Camera&, MeshInstances&) const;
   void              renderLines (Camera&) const;
+  // changes if rendering the mesh would render a different image
+  std::size_t       renderKey () const;
+  // the memory of the arrays, which copies share until they are written
+  std::size_t       numBytes () const;
+  // the memory of the buffer objects
+  std::size_t       numBufferBytes () const;
+  // releases the arrays that stage uploads, which are allocated again by the next upload
+  void              releaseStagingBuffers ();
   void              reset ();
   void              resetGeometry ();
   const RenderMode& renderMode () const;
@@ -65,7 +92,11 @@ public:
   void               rotateX (float);
   void               rotateY (float);
   void               rotateZ (float);
+  // transforms vertices and normals by an affine matrix in parallel, e.g., to bake a model matrix
+  void               transform (const glm::mat4x4&);
+  // bakes the model matrix into vertices and normals, which are transformed in parallel
   void               normalize ();
+  // bounds are maintained incrementally, so querying them does not scan all vertices
   PrimAABox          bounds () const;
   const Color&       color () const;
   void               color (const Color&);
@@ -2,35 +2,52 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
 #include <QOpenGLContext>
 #include <QOpenGLExtensions>
 #include <QOpenGLFunctions_2_1>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLFunctions_4_4_Core>
+#include <QSaveFile>
+#include <functional>
 #include <glm/glm.hpp>
 #include <iostream>
 #include <memory>
+#include <string>
 #include "log.hpp"
 #include "opengl.hpp"
 #include "shader.hpp"
 #include "util.hpp"
 
+// calls a function of the core profile if available, and of the 2.1 fallback otherwise
+#define CALL_GL(method, ...) \
+  (coreFun ? coreFun->method (__VA_ARGS__) : legacyFun->method (__VA_ARGS__))
+
+// calls a function of the core profile if available, and of an extension otherwise
+#define CALL_GL_EXT(extension, method, ...) \
+  (coreFun ? coreFun->method (__VA_ARGS__) : extension->method (__VA_ARGS__))
+
 #define DELEGATE_GL_CONSTANT(method, constant) \
   unsigned int method () { return constant; }
 #define DELEGATE_GL(r, method) \
-  r method () { return fun->method (); }
+  r method () { return CALL_GL (method); }
 #define DELEGATE1_GL(r, method, t1) \
-  r method (t1 a1) { return fun->method (a1); }
+  r method (t1 a1) { return CALL_GL (method, a1); }
 #define DELEGATE2_GL(r, method, t1, t2) \
-  r method (t1 a1, t2 a2) { return fun->method (a1, a2); }
+  r method (t1 a1, t2 a2) { return CALL_GL (method, a1, a2); }
 #define DELEGATE3_GL(r, method, t1, t2, t3) \
-  r method (t1 a1, t2 a2, t3 a3) { return fun->method (a1, a2, a3); }
+  r method (t1 a1, t2 a2, t3 a3) { return CALL_GL (method, a1, a2, a3); }
 #define DELEGATE4_GL(r, method, t1, t2, t3, t4) \
-  r method (t1 a1, t2 a2, t3 a3, t4 a4) { return fun->method (a1, a2, a3, a4); }
+  r method (t1 a1, t2 a2, t3 a3, t4 a4) { return CALL_GL (method, a1, a2, a3, a4); }
 #define DELEGATE5_GL(r, method, t1, t2, t3, t4, t5) \
-  r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5) { return fun->method (a1, a2, a3, a4, a5); }
+  r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5) { return CALL_GL (method, a1, a2, a3, a4, a5); }
 #define DELEGATE6_GL(r, method, t1, t2, t3, t4, t5, t6) \
   r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5, t6 a6)   \
   {                                                     \
-    return fun->method (a1, a2, a3, a4, a5, a6);        \
+    return CALL_GL (method, a1, a2, a3, a4, a5, a6);    \
   }
 
 namespace OpenGL
@@ -39,30 +56,95 @@ namespace OpenGL
   static_assert (sizeof (int) >= 4, "type does not meet size required by OpenGL");
   static_assert (sizeof (float) >= 4, "type does not meet size required by OpenGL");
 
-  static QOpenGLFunctions_2_1*                                  fun = nullptr;
-  static std::unique_ptr<QOpenGLExtension_EXT_geometry_shader4> gsFun;
-
-  void setDefaultFormat ()
+  static QOpenGLFunctions_2_1*                                     legacyFun = nullptr;
+  static QOpenGLFunctions_4_1_Core*                                coreFun = nullptr;
+  static QOpenGLFunctions_4_3_Core*                                core43Fun = nullptr;
+  static QOpenGLFunctions_4_4_Core*                                core44Fun = nullptr;
+  static std::unique_ptr<QOpenGLExtension_EXT_geometry_shader4>    gsFun;
+  static std::unique_ptr<QOpenGLExtension_ARB_vertex_array_object> vaoFun;
+  static std::unique_ptr<QOpenGLExtension_ARB_instanced_arrays>    iaFun;
+  static std::unique_ptr<QOpenGLExtension_ARB_draw_instanced>      diFun;
+  static std::unique_ptr<QOpenGLExtension_ARB_sync>                syncFun;
+  static std::unique_ptr<QOpenGLExtension_ARB_get_program_binary>  pbFun;
+  static bool                                                      geometryShader = false;
+  static bool                                                      programBinary = false;
+  static bool                                                      packedNormals = false;
+  static std::string                                               programCacheDir;
+  static std::size_t                                               numUploadedBytes = 0;
+  static bool                                                      secondaryContext = false;
+
+  void programCacheDirectory (const std::string& directory) { programCacheDir = directory; }
+
+  std::size_t uploadedBytes () { return numUploadedBytes; }
+
+  void setDefaultFormat (bool preferCoreProfile)
   {
     QSurfaceFormat format;
 
-    format.setVersion (2, 1);
+    format.setVersion (4, 1);
     format.setDepthBufferSize (24);
     format.setStencilBufferSize (1);
-    format.setProfile (QSurfaceFormat::NoProfile);
+    format.setProfile (QSurfaceFormat::CoreProfile);
     format.setRenderableType (QSurfaceFormat::OpenGL);
 
+    if (preferCoreProfile == false)
+    {
+      format.setVersion (2, 1);
+      format.setProfile (QSurfaceFormat::NoProfile);
+    }
     QSurfaceFormat::setDefaultFormat (format);
   }
 
-  void initializeFunctions (bool initGeometryShader)
+  bool isInitialized () { return legacyFun != nullptr || coreFun != nullptr; }
+
+  bool isSecondaryContext () { return secondaryContext; }
+
+  void isSecondaryContext (bool s) { secondaryContext = s; }
+
+  // vertex array objects, instancing, sync objects and program binaries are part of 4.1
+  static void initializeCoreFunctions (bool initGeometryShader)
   {
-    fun = QOpenGLContext::currentContext ()->versionFunctions<QOpenGLFunctions_2_1> ();
-    if (fun == nullptr)
+    QOpenGLContext*      context = QOpenGLContext::currentContext ();
+    const QSurfaceFormat format = context->format ();
+
+    coreFun = context->versionFunctions<QOpenGLFunctions_4_1_Core> ();
+    if (coreFun == nullptr || coreFun->initializeOpenGLFunctions () == false)
+    {
+      coreFun = nullptr;
+      return;
+    }
+    if (format.version () >= qMakePair (4, 3))
+    {
+      core43Fun = context->versionFunctions<QOpenGLFunctions_4_3_Core> ();
+      if (core43Fun && core43Fun->initializeOpenGLFunctions () == false)
+      {
+        core43Fun = nullptr;
+      }
+    }
+    if (format.version () >= qMakePair (4, 4))
+    {
+      core44Fun = context->versionFunctions<QOpenGLFunctions_4_4_Core> ();
+      if (core44Fun && core44Fun->initializeOpenGLFunctions () == false)
+      {
+        core44Fun = nullptr;
+      }
+    }
+    GLint numFormats = 0;
+    coreFun->glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+    geometryShader = initGeometryShader;
+    programBinary = numFormats > 0;
+    packedNormals = true;
+  }
+
+  static void initializeLegacyFunctions (bool initGeometryShader)
+  {
+    legacyFun = QOpenGLContext::currentContext ()->versionFunctions<QOpenGLFunctions_2_1> ();
+    if (legacyFun == nullptr)
     {
       DILAY_PANIC ("could not obtain OpenGL 2.1 context")
     }
-    fun->initializeOpenGLFunctions ();
+    legacyFun->initializeOpenGLFunctions ();
 
     if (initGeometryShader)
     {
@@ -76,14 +158,84 @@ namespace OpenGL
           DILAY_PANIC ("could not initialize GL_EXT_geometry_shader4 extension")
         }
         gsFun->initializeOpenGLFunctions ();
+        geometryShader = true;
+      }
+    }
+
+    if (QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_ARB_vertex_array_object")))
+    {
+      vaoFun = std::make_unique<QOpenGLExtension_ARB_vertex_array_object> ();
+      if (vaoFun->initializeOpenGLFunctions () == false)
+      {
+        vaoFun.reset ();
+      }
+    }
+    if (QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_ARB_instanced_arrays")) &&
+        QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_ARB_draw_instanced")))
+    {
+      iaFun = std::make_unique<QOpenGLExtension_ARB_instanced_arrays> ();
+      diFun = std::make_unique<QOpenGLExtension_ARB_draw_instanced> ();
+      if (iaFun->initializeOpenGLFunctions () == false ||
+          diFun->initializeOpenGLFunctions () == false)
+      {
+        iaFun.reset ();
+        diFun.reset ();
       }
     }
+    if (QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_ARB_sync")))
+    {
+      syncFun = std::make_unique<QOpenGLExtension_ARB_sync> ();
+      if (syncFun->initializeOpenGLFunctions () == false)
+      {
+        syncFun.reset ();
+      }
+    }
+    if (QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_ARB_get_program_binary")))
+    {
+      GLint numFormats = 0;
 
-    DILAY_INFO ("OpenGL version: %s", fun->glGetString (GL_VERSION));
-    DILAY_INFO ("OpenGL vendor: %s", fun->glGetString (GL_VENDOR));
-    DILAY_INFO ("OpenGL renderer: %s", fun->glGetString (GL_RENDERER));
-    DILAY_INFO ("OpenGL GLSL version: %s", fun->glGetString (GL_SHADING_LANGUAGE_VERSION));
-    DILAY_INFO ("OpenGL supports GL_EXT_geometry_shader4: %i", gsFun != nullptr);
+      pbFun = std::make_unique<QOpenGLExtension_ARB_get_program_binary> ();
+      legacyFun->glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+      if (numFormats <= 0 || pbFun->initializeOpenGLFunctions () == false)
+      {
+        pbFun.reset ();
+      }
+    }
+    programBinary = bool(pbFun);
+    packedNormals = QOpenGLContext::currentContext ()->hasExtension (
+      QByteArray ("GL_ARB_vertex_type_2_10_10_10_rev"));
+  }
+
+  void initializeFunctions (bool initGeometryShader)
+  {
+    const QSurfaceFormat format = QOpenGLContext::currentContext ()->format ();
+
+    if (format.profile () == QSurfaceFormat::CoreProfile &&
+        format.version () >= qMakePair (4, 1))
+    {
+      initializeCoreFunctions (initGeometryShader);
+    }
+    if (coreFun == nullptr)
+    {
+      initializeLegacyFunctions (initGeometryShader);
+    }
+
+    DILAY_INFO ("OpenGL version: %s", CALL_GL (glGetString, GL_VERSION));
+    DILAY_INFO ("OpenGL vendor: %s", CALL_GL (glGetString, GL_VENDOR));
+    DILAY_INFO ("OpenGL renderer: %s", CALL_GL (glGetString, GL_RENDERER));
+    DILAY_INFO ("OpenGL GLSL version: %s", CALL_GL (glGetString, GL_SHADING_LANGUAGE_VERSION));
+    DILAY_INFO ("OpenGL core profile: %i", OpenGL::hasCoreProfile ());
+    DILAY_INFO ("OpenGL supports geometry shaders: %i", OpenGL::hasGeometryShader ());
+    DILAY_INFO ("OpenGL supports vertex array objects: %i", OpenGL::hasVertexArrayObject ());
+    DILAY_INFO ("OpenGL supports packed normals: %i", packedNormals);
+    DILAY_INFO ("OpenGL supports instancing: %i", OpenGL::hasInstancing ());
+    DILAY_INFO ("OpenGL supports sync objects: %i", OpenGL::hasSync ());
+    DILAY_INFO ("OpenGL supports program binaries: %i", programBinary);
+    DILAY_INFO ("OpenGL supports multi-draw-indirect: %i", OpenGL::hasMultiDrawIndirect ());
+    DILAY_INFO ("OpenGL supports buffer storage: %i", OpenGL::hasBufferStorage ());
+    DILAY_INFO ("OpenGL supports compute shaders: %i", OpenGL::hasComputeShader ());
+    DILAY_INFO ("OpenGL supports timer queries: %i", OpenGL::hasTimerQuery ());
   }
 
   DELEGATE_GL_CONSTANT (Always, GL_ALWAYS);
@@ -91,15 +243,19 @@ namespace OpenGL
   DELEGATE_GL_CONSTANT (Back, GL_BACK);
   DELEGATE_GL_CONSTANT (Blend, GL_BLEND);
   DELEGATE_GL_CONSTANT (BufferSize, GL_BUFFER_SIZE);
+  DELEGATE_GL_CONSTANT (CCW, GL_CCW);
   DELEGATE_GL_CONSTANT (ColorBufferBit, GL_COLOR_BUFFER_BIT);
+  DELEGATE_GL_CONSTANT (CommandBarrierBit, GL_COMMAND_BARRIER_BIT);
   DELEGATE_GL_CONSTANT (CullFace, GL_CULL_FACE);
   DELEGATE_GL_CONSTANT (CW, GL_CW);
-  DELEGATE_GL_CONSTANT (CCW, GL_CCW);
   DELEGATE_GL_CONSTANT (Decr, GL_DECR);
   DELEGATE_GL_CONSTANT (DecrWrap, GL_DECR_WRAP);
   DELEGATE_GL_CONSTANT (DepthBufferBit, GL_DEPTH_BUFFER_BIT);
   DELEGATE_GL_CONSTANT (DepthTest, GL_DEPTH_TEST);
+  DELEGATE_GL_CONSTANT (DrawIndirectBuffer, GL_DRAW_INDIRECT_BUFFER);
   DELEGATE_GL_CONSTANT (DstColor, GL_DST_COLOR);
+  DELEGATE_GL_CONSTANT (DynamicDraw, GL_DYNAMIC_DRAW);
+  DELEGATE_GL_CONSTANT (DynamicStorageBit, GL_DYNAMIC_STORAGE_BIT);
   DELEGATE_GL_CONSTANT (ElementArrayBuffer, GL_ELEMENT_ARRAY_BUFFER);
   DELEGATE_GL_CONSTANT (Equal, GL_EQUAL);
   DELEGATE_GL_CONSTANT (Fill, GL_FILL);
@@ -110,26 +266,60 @@ namespace OpenGL
   DELEGATE_GL_CONSTANT (Greater, GL_GREATER);
   DELEGATE_GL_CONSTANT (Incr, GL_INCR);
   DELEGATE_GL_CONSTANT (IncrWrap, GL_INCR_WRAP);
+  DELEGATE_GL_CONSTANT (Int2101010Rev, GL_INT_2_10_10_10_REV);
   DELEGATE_GL_CONSTANT (Invert, GL_INVERT);
   DELEGATE_GL_CONSTANT (Keep, GL_KEEP);
   DELEGATE_GL_CONSTANT (LEqual, GL_LEQUAL);
   DELEGATE_GL_CONSTANT (Line, GL_LINE);
   DELEGATE_GL_CONSTANT (Lines, GL_LINES);
+  DELEGATE_GL_CONSTANT (Linear, GL_LINEAR);
+  DELEGATE_GL_CONSTANT (Nearest, GL_NEAREST);
   DELEGATE_GL_CONSTANT (Never, GL_NEVER);
+  DELEGATE_GL_CONSTANT (PixelPackBuffer, GL_PIXEL_PACK_BUFFER);
   DELEGATE_GL_CONSTANT (PolygonOffsetFill, GL_POLYGON_OFFSET_FILL);
+  DELEGATE_GL_CONSTANT (QueryResult, GL_QUERY_RESULT);
+  DELEGATE_GL_CONSTANT (QueryResultAvailable, GL_QUERY_RESULT_AVAILABLE);
+  DELEGATE_GL_CONSTANT (ReadOnly, GL_READ_ONLY);
   DELEGATE_GL_CONSTANT (Replace, GL_REPLACE);
+  DELEGATE_GL_CONSTANT (RGBA, GL_RGBA);
+  DELEGATE_GL_CONSTANT (SamplesPassed, GL_SAMPLES_PASSED);
+  DELEGATE_GL_CONSTANT (ShaderStorageBarrierBit, GL_SHADER_STORAGE_BARRIER_BIT);
+  DELEGATE_GL_CONSTANT (ShaderStorageBuffer, GL_SHADER_STORAGE_BUFFER);
+  DELEGATE_GL_CONSTANT (Short, GL_SHORT);
   DELEGATE_GL_CONSTANT (StaticDraw, GL_STATIC_DRAW);
   DELEGATE_GL_CONSTANT (StencilBufferBit, GL_STENCIL_BUFFER_BIT);
   DELEGATE_GL_CONSTANT (StencilTest, GL_STENCIL_TEST);
+  DELEGATE_GL_CONSTANT (StreamRead, GL_STREAM_READ);
+  DELEGATE_GL_CONSTANT (TimeElapsed, GL_TIME_ELAPSED);
   DELEGATE_GL_CONSTANT (Triangles, GL_TRIANGLES);
+  DELEGATE_GL_CONSTANT (UniformBuffer, GL_UNIFORM_BUFFER);
+  DELEGATE_GL_CONSTANT (UnsignedByte, GL_UNSIGNED_BYTE);
   DELEGATE_GL_CONSTANT (UnsignedInt, GL_UNSIGNED_INT);
+  DELEGATE_GL_CONSTANT (UnsignedShort, GL_UNSIGNED_SHORT);
+  DELEGATE_GL_CONSTANT (VertexAttribArrayBarrierBit, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
   DELEGATE_GL_CONSTANT (Zero, GL_ZERO);
 
   DELEGATE2_GL (void, glBindBuffer, unsigned int, unsigned int)
   DELEGATE1_GL (void, glBlendEquation, unsigned int)
   DELEGATE2_GL (void, glBlendFunc, unsigned int, unsigned int)
-  DELEGATE4_GL (void, glBufferData, unsigned int, unsigned int, const void*, unsigned int)
-  DELEGATE4_GL (void, glBufferSubData, unsigned int, unsigned int, unsigned int, const void*)
+
+  void glBufferData (unsigned int target, unsigned int size, const void* data, unsigned int usage)
+  {
+    if (data)
+    {
+      numUploadedBytes += size;
+    }
+    CALL_GL (glBufferData, target, size, data, usage);
+  }
+
+  void glBufferSubData (unsigned int target, unsigned int offset, unsigned int size,
+                        const void* data)
+  {
+    numUploadedBytes += size;
+    CALL_GL (glBufferSubData, target, offset, size, data);
+  }
+
+  DELEGATE2_GL (void, glBeginQuery, unsigned int, unsigned int)
   DELEGATE1_GL (void, glClear, unsigned int)
   DELEGATE4_GL (void, glClearColor, float, float, float, float)
   DELEGATE1_GL (void, glClearStencil, int)
@@ -142,142 +332,507 @@ namespace OpenGL
   DELEGATE4_GL (void, glDrawElements, unsigned int, unsigned int, unsigned int, const void*)
   DELEGATE1_GL (void, glEnable, unsigned int)
   DELEGATE1_GL (void, glEnableVertexAttribArray, unsigned int)
+  DELEGATE1_GL (void, glEndQuery, unsigned int)
   DELEGATE1_GL (void, glFrontFace, unsigned int)
   DELEGATE2_GL (void, glGenBuffers, unsigned int, unsigned int*)
+  DELEGATE2_GL (void, glGenQueries, unsigned int, unsigned int*)
   DELEGATE3_GL (void, glGetBufferParameteriv, unsigned int, unsigned int, int*)
+  DELEGATE3_GL (void, glGetQueryObjectuiv, unsigned int, unsigned int, unsigned int*)
   DELEGATE2_GL (int, glGetUniformLocation, unsigned int, const char*)
   DELEGATE1_GL (bool, glIsBuffer, unsigned int)
   DELEGATE1_GL (bool, glIsProgram, unsigned int)
+  DELEGATE2_GL (void*, glMapBuffer, unsigned int, unsigned int)
+  DELEGATE5_GL (void, glMultiDrawElements, unsigned int, const int*, unsigned int,
+                const void* const*, int)
   DELEGATE2_GL (void, glPolygonMode, unsigned int, unsigned int)
   DELEGATE2_GL (void, glPolygonOffset, float, float)
   DELEGATE3_GL (void, glStencilFunc, unsigned int, int, unsigned int)
   DELEGATE3_GL (void, glStencilOp, unsigned int, unsigned int, unsigned int)
   DELEGATE2_GL (void, glUniform1f, int, float)
+  DELEGATE2_GL (void, glUniform1i, int, int)
   DELEGATE4_GL (void, glUniformMatrix3fv, int, unsigned int, bool, const float*)
   DELEGATE4_GL (void, glUniformMatrix4fv, int, unsigned int, bool, const float*)
+  DELEGATE1_GL (bool, glUnmapBuffer, unsigned int)
   DELEGATE1_GL (void, glUseProgram, unsigned int)
   DELEGATE6_GL (void, glVertexAttribPointer, unsigned int, int, unsigned int, bool, unsigned int,
                 const void*)
   DELEGATE4_GL (void, glViewport, unsigned int, unsigned int, unsigned int, unsigned int)
 
-  bool hasGeometryShader () { return bool(gsFun); }
+  void glReadPixels (int x, int y, unsigned int width, unsigned int height, unsigned int format,
+                     unsigned int type, void* data)
+  {
+    CALL_GL (glReadPixels, x, y, width, height, format, type, data);
+  }
+
+  void glBindVertexArray (unsigned int id)
+  {
+    assert (OpenGL::hasVertexArrayObject ());
+    CALL_GL_EXT (vaoFun, glBindVertexArray, id);
+  }
+
+  void glGenVertexArrays (unsigned int n, unsigned int* ids)
+  {
+    assert (OpenGL::hasVertexArrayObject ());
+    CALL_GL_EXT (vaoFun, glGenVertexArrays, n, ids);
+  }
+
+  void glDrawElementsInstanced (unsigned int mode, unsigned int count, unsigned int type,
+                                const void* indices, unsigned int numInstances)
+  {
+    assert (OpenGL::hasInstancing ());
+    if (coreFun)
+    {
+      coreFun->glDrawElementsInstanced (mode, count, type, indices, numInstances);
+    }
+    else
+    {
+      diFun->glDrawElementsInstancedARB (mode, count, type, indices, numInstances);
+    }
+  }
+
+  void glVertexAttribDivisor (unsigned int index, unsigned int divisor)
+  {
+    assert (OpenGL::hasInstancing ());
+    if (coreFun)
+    {
+      coreFun->glVertexAttribDivisor (index, divisor);
+    }
+    else
+    {
+      iaFun->glVertexAttribDivisorARB (index, divisor);
+    }
+  }
+
+  void* glFenceSync ()
+  {
+    assert (OpenGL::hasSync ());
+    return CALL_GL_EXT (syncFun, glFenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  bool isSignaled (void* sync)
+  {
+    assert (OpenGL::hasSync ());
+    const GLenum status =
+      CALL_GL_EXT (syncFun, glClientWaitSync, static_cast<GLsync> (sync), 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+  }
+
+  void waitSync (void* sync)
+  {
+    assert (OpenGL::hasSync ());
+
+    // waits at most a second, which only fails if the context was lost
+    const GLuint64 timeout = 1000000000;
+    CALL_GL_EXT (syncFun, glClientWaitSync, static_cast<GLsync> (sync),
+                 GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+  }
+
+  void glBindBufferBase (unsigned int target, unsigned int index, unsigned int id)
+  {
+    assert (OpenGL::hasUniformBuffers ());
+    coreFun->glBindBufferBase (target, index, id);
+  }
+
+  void glBufferStorage (unsigned int target, unsigned int size, const void* data,
+                        unsigned int flags)
+  {
+    assert (OpenGL::hasBufferStorage ());
+    if (data)
+    {
+      numUploadedBytes += size;
+    }
+    core44Fun->glBufferStorage (target, size, data, flags);
+  }
+
+  void glDispatchCompute (unsigned int x, unsigned int y, unsigned int z)
+  {
+    assert (OpenGL::hasComputeShader ());
+    core43Fun->glDispatchCompute (x, y, z);
+  }
+
+  void glGetQueryObjectui64v (unsigned int id, unsigned int name, std::uint64_t* value)
+  {
+    assert (OpenGL::hasTimerQuery ());
+    GLuint64 v = 0;
+    coreFun->glGetQueryObjectui64v (id, name, &v);
+    *value = v;
+  }
+
+  unsigned int glGetUniformBlockIndex (unsigned int program, const char* name)
+  {
+    assert (OpenGL::hasUniformBuffers ());
+    return coreFun->glGetUniformBlockIndex (program, name);
+  }
+
+  void glMemoryBarrier (unsigned int barriers)
+  {
+    assert (OpenGL::hasComputeShader ());
+    core43Fun->glMemoryBarrier (barriers);
+  }
+
+  void glMultiDrawElementsIndirect (unsigned int mode, unsigned int type, const void* indirect,
+                                    unsigned int numDraws, unsigned int stride)
+  {
+    assert (OpenGL::hasMultiDrawIndirect ());
+    core43Fun->glMultiDrawElementsIndirect (mode, type, indirect, numDraws, stride);
+  }
+
+  void glUniformBlockBinding (unsigned int program, unsigned int block, unsigned int binding)
+  {
+    assert (OpenGL::hasUniformBuffers ());
+    coreFun->glUniformBlockBinding (program, block, binding);
+  }
+
+  bool hasCoreProfile () { return coreFun != nullptr; }
+
+  bool hasGeometryShader () { return geometryShader; }
+
+  bool hasVertexArrayObject () { return coreFun || vaoFun; }
+
+  bool hasInstancing () { return coreFun || (iaFun && diFun); }
+
+  bool hasSync () { return coreFun || syncFun; }
+
+  bool hasPackedNormals () { return packedNormals; }
+
+  bool hasUniformBuffers () { return coreFun != nullptr; }
+
+  bool hasMultiDrawIndirect () { return core43Fun != nullptr; }
+
+  bool hasBufferStorage () { return core44Fun != nullptr; }
+
+  bool hasComputeShader () { return core43Fun != nullptr; }
+
+  bool hasTimerQuery () { return coreFun != nullptr; }
+
+  void glUniformVec3 (unsigned int id, const glm::vec3& v)
+  {
+    CALL_GL (glUniform3f, id, v.x, v.y, v.z);
+  }
 
-  void glUniformVec3 (unsigned int id, const glm::vec3& v) { fun->glUniform3f (id, v.x, v.y, v.z); }
   void glUniformVec4 (unsigned int id, const glm::vec4& v)
   {
-    fun->glUniform4f (id, v.x, v.y, v.z, v.w);
+    CALL_GL (glUniform4f, id, v.x, v.y, v.z, v.w);
   }
 
   void safeDeleteBuffer (unsigned int& id)
   {
     if (id > 0)
     {
-      fun->glDeleteBuffers (1, &id);
+      CALL_GL (glDeleteBuffers, 1, &id);
     }
     id = 0;
   }
 
+  void safeDeleteQuery (unsigned int& id)
+  {
+    if (id > 0)
+    {
+      CALL_GL (glDeleteQueries, 1, &id);
+    }
+    id = 0;
+  }
+
+  void safeDeleteVertexArray (unsigned int& id)
+  {
+    if (id > 0)
+    {
+      assert (OpenGL::hasVertexArrayObject ());
+      CALL_GL_EXT (vaoFun, glDeleteVertexArrays, 1, &id);
+    }
+    id = 0;
+  }
+
+  void safeDeleteSync (void*& sync)
+  {
+    if (sync)
+    {
+      assert (OpenGL::hasSync ());
+      CALL_GL_EXT (syncFun, glDeleteSync, static_cast<GLsync> (sync));
+    }
+    sync = nullptr;
+  }
+
   void safeDeleteShader (unsigned int& id)
   {
-    if (id > 0 && fun->glIsShader (id) == GL_TRUE)
+    if (id > 0 && CALL_GL (glIsShader, id) == GL_TRUE)
     {
-      fun->glDeleteShader (id);
+      CALL_GL (glDeleteShader, id);
     }
     id = 0;
   }
 
   void safeDeleteProgram (unsigned int& id)
   {
-    if (id > 0 && fun->glIsProgram (id) == GL_TRUE)
+    if (id > 0 && CALL_GL (glIsProgram, id) == GL_TRUE)
     {
       GLsizei numShaders;
       GLuint  shaderIds[2];
 
-      fun->glGetAttachedShaders (id, 2, &numShaders, shaderIds);
+      CALL_GL (glGetAttachedShaders, id, 2, &numShaders, shaderIds);
 
       for (GLsizei i = 0; i < numShaders; i++)
       {
         OpenGL::safeDeleteShader (shaderIds[i]);
       }
-      fun->glDeleteProgram (id);
+      CALL_GL (glDeleteProgram, id);
     }
     id = 0;
   }
 
-  unsigned int loadProgram (const char* vertexShader, const char* fragmentShader,
-                            bool loadGeometryShader)
+  static const char* geometryShaderSource ()
   {
-    auto showInfoLog = [](GLuint id) {
-      const int maxLogLength = 1000;
-      char      logBuffer[maxLogLength];
-      GLsizei   logLength;
-      fun->glGetShaderInfoLog (id, maxLogLength, &logLength, logBuffer);
-      if (logLength > 0)
-      {
-        DILAY_WARN ("%s", logBuffer)
-      }
-    };
+    return coreFun ? Shader::coreGeometryShader () : Shader::geometryShader ();
+  }
 
-    auto compileShader = [&showInfoLog](GLenum shaderType, const char* shaderSource) -> GLuint {
-      GLuint shaderId = fun->glCreateShader (shaderType);
-      fun->glShaderSource (shaderId, 1, &shaderSource, NULL);
-      fun->glCompileShader (shaderId);
+  /* Sources of GLSL 1.20 are translated to the core profile by redefining the removed
+   * qualifiers and the fragment output.  Other sources are left as they are.
+   */
+  static std::string shaderSource (GLenum shaderType, const char* source)
+  {
+    const std::string legacyVersion = "#version 120";
+    const std::string original (source);
 
-      GLint status;
-      fun->glGetShaderiv (shaderId, GL_COMPILE_STATUS, &status);
-      if (status == GL_FALSE)
-      {
-        showInfoLog (shaderId);
-        DILAY_PANIC ("can not compile shader: see info log above")
-      }
-      return shaderId;
-    };
+    if (coreFun == nullptr || original.compare (0, legacyVersion.size (), legacyVersion) != 0)
+    {
+      return original;
+    }
+    std::string header = "#version 410 core\n";
 
-    GLuint programId = fun->glCreateProgram ();
-    GLuint vsId = compileShader (GL_VERTEX_SHADER, vertexShader);
-    GLuint fsId = compileShader (GL_FRAGMENT_SHADER, fragmentShader);
-    GLuint gmId = 0;
+    if (shaderType == GL_VERTEX_SHADER)
+    {
+      header += "#define attribute in\n"
+                "#define varying out\n";
+    }
+    else if (shaderType == GL_FRAGMENT_SHADER)
+    {
+      header += "#define varying in\n"
+                "out vec4 fragColor;\n"
+                "#define gl_FragColor fragColor\n";
+    }
+    return header + original.substr (original.find ('\n') + 1);
+  }
 
-    fun->glAttachShader (programId, vsId);
-    fun->glAttachShader (programId, fsId);
+  static void showInfoLog (GLuint id, bool isProgram)
+  {
+    const int maxLogLength = 1000;
+    char      logBuffer[maxLogLength];
+    GLsizei   logLength = 0;
 
-    if (loadGeometryShader)
+    if (isProgram)
     {
-      assert (OpenGL::hasGeometryShader ());
+      CALL_GL (glGetProgramInfoLog, id, maxLogLength, &logLength, logBuffer);
+    }
+    else
+    {
+      CALL_GL (glGetShaderInfoLog, id, maxLogLength, &logLength, logBuffer);
+    }
+    if (logLength > 0)
+    {
+      DILAY_WARN ("%s", logBuffer)
+    }
+  }
 
-      gmId = compileShader (GL_GEOMETRY_SHADER_EXT, Shader::geometryShader ());
-      fun->glAttachShader (programId, gmId);
+  static GLuint compileShader (GLenum shaderType, const char* source)
+  {
+    const std::string translated = shaderSource (shaderType, source);
+    const char*       translatedSource = translated.c_str ();
 
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_VERTICES_OUT_EXT, 3);
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_INPUT_TYPE_EXT, GL_TRIANGLES);
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_OUTPUT_TYPE_EXT, GL_TRIANGLE_STRIP);
-    }
+    GLuint shaderId = CALL_GL (glCreateShader, shaderType);
+    CALL_GL (glShaderSource, shaderId, 1, &translatedSource, NULL);
+    CALL_GL (glCompileShader, shaderId);
 
-    fun->glBindAttribLocation (programId, OpenGL::PositionIndex, "position");
-    fun->glBindAttribLocation (programId, OpenGL::NormalIndex, "normal");
+    GLint status;
+    CALL_GL (glGetShaderiv, shaderId, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+      showInfoLog (shaderId, false);
+      DILAY_PANIC ("can not compile shader: see info log above")
+    }
+    return shaderId;
+  }
 
-    fun->glLinkProgram (programId);
+  static void linkProgram (GLuint programId)
+  {
+    CALL_GL (glLinkProgram, programId);
 
     GLint status;
-    fun->glGetProgramiv (programId, GL_LINK_STATUS, &status);
+    CALL_GL (glGetProgramiv, programId, GL_LINK_STATUS, &status);
 
     if (status == GL_FALSE)
     {
-      showInfoLog (programId);
+      showInfoLog (programId, true);
       OpenGL::safeDeleteProgram (programId);
       DILAY_PANIC ("can not link shader program: see info log above")
     }
+  }
+
+  static GLuint compileProgram (const char* vertexShader, const char* fragmentShader,
+                                bool loadGeometryShader)
+  {
+    GLuint programId = CALL_GL (glCreateProgram);
+    GLuint vsId = compileShader (GL_VERTEX_SHADER, vertexShader);
+    GLuint fsId = compileShader (GL_FRAGMENT_SHADER, fragmentShader);
+    GLuint gmId = 0;
+
+    CALL_GL (glAttachShader, programId, vsId);
+    CALL_GL (glAttachShader, programId, fsId);
+
+    if (loadGeometryShader)
+    {
+      assert (OpenGL::hasGeometryShader ());
+
+      gmId = compileShader (GL_GEOMETRY_SHADER, geometryShaderSource ());
+      CALL_GL (glAttachShader, programId, gmId);
+
+      // core geometry shaders declare their primitives themselves
+      if (coreFun == nullptr)
+      {
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_VERTICES_OUT_EXT, 3);
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_INPUT_TYPE_EXT, GL_TRIANGLES);
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_OUTPUT_TYPE_EXT,
+                                       GL_TRIANGLE_STRIP);
+      }
+    }
+
+    CALL_GL (glBindAttribLocation, programId, OpenGL::PositionIndex, "position");
+    CALL_GL (glBindAttribLocation, programId, OpenGL::NormalIndex, "normal");
+    CALL_GL (glBindAttribLocation, programId, OpenGL::ModelIndex, "model");
+    CALL_GL (glBindAttribLocation, programId, OpenGL::ModelNormalIndex, "modelNormal");
+
+    if (programBinary)
+    {
+      CALL_GL_EXT (pbFun, glProgramParameteri, programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                   GL_TRUE);
+    }
+    linkProgram (programId);
+
     OpenGL::safeDeleteShader (vsId);
     OpenGL::safeDeleteShader (fsId);
     OpenGL::safeDeleteShader (gmId);
     return programId;
   }
 
-  void clearError () { fun->glGetError (); }
+  /* Binaries of programs depend on their sources and on the driver, so cache files are named
+   * by a hash of both.  An empty file name disables caching.
+   */
+  static std::string programCacheFile (const char* vertexShader, const char* fragmentShader,
+                                       bool loadGeometryShader)
+  {
+    if (programBinary == false || programCacheDir.empty ())
+    {
+      return std::string ();
+    }
+    const std::string key =
+      std::string (vertexShader) + fragmentShader +
+      (loadGeometryShader ? geometryShaderSource () : "") +
+      reinterpret_cast<const char*> (CALL_GL (glGetString, GL_VENDOR)) +
+      reinterpret_cast<const char*> (CALL_GL (glGetString, GL_RENDERER)) +
+      reinterpret_cast<const char*> (CALL_GL (glGetString, GL_VERSION));
+
+    const QString hash = QString::number (qulonglong (std::hash<std::string> () (key)), 16);
+    return QDir (programCacheDir.c_str ()).filePath ("program-" + hash + ".bin").toStdString ();
+  }
+
+  // returns 0 if there is no usable binary, e.g. because the driver has changed
+  static GLuint loadProgramBinary (const std::string& fileName)
+  {
+    QFile file (fileName.c_str ());
+
+    if (fileName.empty () || file.open (QIODevice::ReadOnly) == false)
+    {
+      return 0;
+    }
+    QDataStream stream (&file);
+    quint32     format;
+    QByteArray  binary;
+
+    stream >> format >> binary;
+    file.close ();
+
+    if (stream.status () != QDataStream::Ok || binary.isEmpty ())
+    {
+      return 0;
+    }
+    GLuint programId = CALL_GL (glCreateProgram);
+    GLint  status;
+
+    CALL_GL_EXT (pbFun, glProgramBinary, programId, format, binary.constData (), binary.size ());
+    CALL_GL (glGetProgramiv, programId, GL_LINK_STATUS, &status);
+
+    if (status == GL_FALSE)
+    {
+      CALL_GL (glDeleteProgram, programId);
+      return 0;
+    }
+    return programId;
+  }
+
+  static void saveProgramBinary (GLuint programId, const std::string& fileName)
+  {
+    GLint length = 0;
+
+    if (fileName.empty ())
+    {
+      return;
+    }
+    CALL_GL (glGetProgramiv, programId, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length > 0 && QDir ().mkpath (programCacheDir.c_str ()))
+    {
+      QByteArray binary (length, 0);
+      GLenum     format;
+      GLsizei    numBytes = 0;
+
+      CALL_GL_EXT (pbFun, glGetProgramBinary, programId, length, &numBytes, &format,
+                   binary.data ());
+      binary.resize (numBytes);
+
+      QSaveFile file (fileName.c_str ());
+      if (numBytes > 0 && file.open (QIODevice::WriteOnly))
+      {
+        QDataStream stream (&file);
+
+        stream << quint32 (format) << binary;
+        file.commit ();
+      }
+    }
+  }
+
+  unsigned int loadProgram (const char* vertexShader, const char* fragmentShader,
+                            bool loadGeometryShader)
+  {
+    const std::string cacheFile =
+      programCacheFile (vertexShader, fragmentShader, loadGeometryShader);
+
+    GLuint programId = loadProgramBinary (cacheFile);
+
+    if (programId == 0)
+    {
+      programId = compileProgram (vertexShader, fragmentShader, loadGeometryShader);
+      saveProgramBinary (programId, cacheFile);
+    }
+    return programId;
+  }
+
+  unsigned int loadComputeProgram (const char* computeShader)
+  {
+    assert (OpenGL::hasComputeShader ());
+
+    GLuint programId = CALL_GL (glCreateProgram);
+    GLuint csId = compileShader (GL_COMPUTE_SHADER, computeShader);
+
+    CALL_GL (glAttachShader, programId, csId);
+    linkProgram (programId);
+    OpenGL::safeDeleteShader (csId);
+    return programId;
+  }
+
+  void clearError () { CALL_GL (glGetError); }
 
   void printError ()
   {
-    const unsigned int glError = fun->glGetError ();
+    const unsigned int glError = CALL_GL (glGetError);
 
     switch (glError)
     {
@@ -5,14 +5,32 @@
 #ifndef DILAY_OPENGL
 #define DILAY_OPENGL
 
+#include <cstddef>
+#include <cstdint>
 #include <glm/fwd.hpp>
 #include <string>
 
 namespace OpenGL
 {
   // QT related
-  void setDefaultFormat ();
+  /* Requests a 4.1 core profile if preferred, or 2.1 otherwise.  This must be called before the
+   * application is constructed, since it creates the shared context with the default format.
+   * Drivers that do not provide a 4.1 core profile create another context, for which
+   * `initializeFunctions` falls back to 2.1 functions.
+   */
+  void setDefaultFormat (bool);
   void initializeFunctions (bool);
+  // functions are not initialized in headless programs, which do not buffer any data
+  bool isInitialized ();
+  /* secondary contexts share buffers and programs with the context the functions have been
+   * initialized with, but not vertex arrays and queries
+   */
+  bool isSecondaryContext ();
+  void isSecondaryContext (bool);
+  // binaries of compiled programs are cached in the given directory, if it is not empty
+  void programCacheDirectory (const std::string&);
+  // returns the number of bytes that have been uploaded to buffers so far
+  std::size_t uploadedBytes ();
 
   // wrappers
   unsigned int Always ();
@@ -20,15 +38,19 @@ namespace OpenGL
   unsigned int Back ();
   unsigned int Blend ();
   unsigned int BufferSize ();
+  unsigned int CCW ();
   unsigned int ColorBufferBit ();
+  unsigned int CommandBarrierBit ();
   unsigned int CullFace ();
   unsigned int CW ();
-  unsigned int CCW ();
   unsigned int Decr ();
   unsigned int DecrWrap ();
   unsigned int DepthBufferBit ();
   unsigned int DepthTest ();
+  unsigned int DrawIndirectBuffer ();
   unsigned int DstColor ();
+  unsigned int DynamicDraw ();
+  unsigned int DynamicStorageBit ();
   unsigned int ElementArrayBuffer ();
   unsigned int Equal ();
   unsigned int Fill ();
@@ -39,69 +61,135 @@ namespace OpenGL
   unsigned int Greater ();
   unsigned int Incr ();
   unsigned int IncrWrap ();
+  unsigned int Int2101010Rev ();
   unsigned int Invert ();
   unsigned int Keep ();
   unsigned int LEqual ();
   unsigned int Line ();
   unsigned int Lines ();
+  unsigned int Linear ();
+  unsigned int Nearest ();
   unsigned int Never ();
+  unsigned int PixelPackBuffer ();
   unsigned int PolygonOffsetFill ();
+  unsigned int QueryResult ();
+  unsigned int QueryResultAvailable ();
+  unsigned int ReadOnly ();
   unsigned int Replace ();
+  unsigned int RGBA ();
+  unsigned int SamplesPassed ();
+  unsigned int ShaderStorageBarrierBit ();
+  unsigned int ShaderStorageBuffer ();
+  unsigned int Short ();
   unsigned int StaticDraw ();
   unsigned int StencilBufferBit ();
   unsigned int StencilTest ();
+  unsigned int StreamRead ();
+  unsigned int TimeElapsed ();
   unsigned int Triangles ();
+  unsigned int UniformBuffer ();
+  unsigned int UnsignedByte ();
   unsigned int UnsignedInt ();
+  unsigned int UnsignedShort ();
+  unsigned int VertexAttribArrayBarrierBit ();
   unsigned int Zero ();
 
-  void glBindBuffer (unsigned int, unsigned int);
-  void glBlendEquation (unsigned int);
-  void glBlendFunc (unsigned int, unsigned);
-  void glBufferData (unsigned int, unsigned int, const void*, unsigned int);
-  void glBufferSubData (unsigned int, unsigned int, unsigned int, const void*);
-  void glClear (unsigned int);
-  void glClearColor (float, float, float, float);
-  void glClearStencil (int);
-  void glColorMask (bool, bool, bool, bool);
-  void glCullFace (unsigned int);
-  void glDepthFunc (unsigned int);
-  void glDepthMask (bool);
-  void glDisable (unsigned int);
-  void glDisableVertexAttribArray (unsigned int);
-  void glDrawElements (unsigned int, unsigned int, unsigned int, const void*);
-  void glEnable (unsigned int);
-  void glEnableVertexAttribArray (unsigned int);
-  void glFrontFace (unsigned int);
-  void glGenBuffers (unsigned int, unsigned int*);
-  void glGetBufferParameteriv (unsigned int, unsigned int, int*);
-  int  glGetUniformLocation (unsigned int, const char*);
-  bool glIsBuffer (unsigned int);
-  bool glIsProgram (unsigned int);
-  void glPolygonMode (unsigned int, unsigned int);
-  void glPolygonOffset (float, float);
-  void glStencilFunc (unsigned int, int, unsigned int);
-  void glStencilOp (unsigned int, unsigned int, unsigned int);
-  void glUniform1f (int, float);
-  void glUniformMatrix3fv (int, unsigned int, bool, const float*);
-  void glUniformMatrix4fv (int, unsigned int, bool, const float*);
-  void glUseProgram (unsigned int);
-  void glVertexAttribPointer (unsigned int, int, unsigned int, bool, unsigned int, const void*);
-  void glViewport (unsigned int, unsigned int, unsigned int, unsigned int);
+  void  glBeginQuery (unsigned int, unsigned int);
+  void  glBindBuffer (unsigned int, unsigned int);
+  void  glBindBufferBase (unsigned int, unsigned int, unsigned int);
+  void  glBindVertexArray (unsigned int);
+  void  glBlendEquation (unsigned int);
+  void  glBlendFunc (unsigned int, unsigned);
+  void  glBufferData (unsigned int, unsigned int, const void*, unsigned int);
+  void  glBufferStorage (unsigned int, unsigned int, const void*, unsigned int);
+  void  glBufferSubData (unsigned int, unsigned int, unsigned int, const void*);
+  void  glClear (unsigned int);
+  void  glClearColor (float, float, float, float);
+  void  glClearStencil (int);
+  void  glColorMask (bool, bool, bool, bool);
+  void  glCullFace (unsigned int);
+  void  glDepthFunc (unsigned int);
+  void  glDepthMask (bool);
+  void  glDisable (unsigned int);
+  void  glDisableVertexAttribArray (unsigned int);
+  void  glDispatchCompute (unsigned int, unsigned int, unsigned int);
+  void  glDrawElements (unsigned int, unsigned int, unsigned int, const void*);
+  void  glDrawElementsInstanced (unsigned int, unsigned int, unsigned int, const void*,
+                                 unsigned int);
+  void  glEnable (unsigned int);
+  void  glEnableVertexAttribArray (unsigned int);
+  void  glEndQuery (unsigned int);
+  void  glFrontFace (unsigned int);
+  void  glGenBuffers (unsigned int, unsigned int*);
+  void  glGenQueries (unsigned int, unsigned int*);
+  void  glGenVertexArrays (unsigned int, unsigned int*);
+  void  glGetBufferParameteriv (unsigned int, unsigned int, int*);
+  void  glGetQueryObjectuiv (unsigned int, unsigned int, unsigned int*);
+  void  glGetQueryObjectui64v (unsigned int, unsigned int, std::uint64_t*);
+  int   glGetUniformLocation (unsigned int, const char*);
+  bool  glIsBuffer (unsigned int);
+  bool  glIsProgram (unsigned int);
+  void* glMapBuffer (unsigned int, unsigned int);
+  void  glMemoryBarrier (unsigned int);
+  void  glMultiDrawElements (unsigned int, const int*, unsigned int, const void* const*, int);
+  void  glMultiDrawElementsIndirect (unsigned int, unsigned int, const void*, unsigned int,
+                                     unsigned int);
+  void  glPolygonMode (unsigned int, unsigned int);
+  void  glPolygonOffset (float, float);
+  void  glReadPixels (int, int, unsigned int, unsigned int, unsigned int, unsigned int, void*);
+  void  glStencilFunc (unsigned int, int, unsigned int);
+  void  glStencilOp (unsigned int, unsigned int, unsigned int);
+  void  glUniform1f (int, float);
+  void  glUniform1i (int, int);
+  void  glUniformBlockBinding (unsigned int, unsigned int, unsigned int);
+  void  glUniformMatrix3fv (int, unsigned int, bool, const float*);
+  void  glUniformMatrix4fv (int, unsigned int, bool, const float*);
+  bool  glUnmapBuffer (unsigned int);
+  void  glUseProgram (unsigned int);
+  void  glVertexAttribDivisor (unsigned int, unsigned int);
+  void  glVertexAttribPointer (unsigned int, int, unsigned int, bool, unsigned int, const void*);
+  void  glViewport (unsigned int, unsigned int, unsigned int, unsigned int);
 
   // utilities
   enum VertexAttributIndex
   {
     PositionIndex = 0,
-    NormalIndex = 1
+    NormalIndex = 1,
+    // per-instance matrices occupy one index per column
+    ModelIndex = 2,
+    ModelNormalIndex = 6
   };
 
+  // vertex array objects, instancing, sync objects and uniform buffers are part of the core
+  bool         hasCoreProfile ();
   bool         hasGeometryShader ();
+  bool         hasVertexArrayObject ();
+  bool         hasInstancing ();
+  bool         hasSync ();
+  // normals can be specified as signed 10-10-10-2 integers
+  bool         hasPackedNormals ();
+  bool         hasUniformBuffers ();
+  bool         hasMultiDrawIndirect ();
+  bool         hasBufferStorage ();
+  bool         hasComputeShader ();
+  // queries of elapsed GPU times are part of the core profile
+  bool         hasTimerQuery ();
+  unsigned int glGetUniformBlockIndex (unsigned int, const char*);
   void         glUniformVec3 (unsigned int, const glm::vec3&);
   void         glUniformVec4 (unsigned int, const glm::vec4&);
+  // fences are opaque pointers, which are only valid if sync objects are supported
+  void*        glFenceSync ();
+  bool         isSignaled (void*);
+  void         waitSync (void*);
+  void         safeDeleteSync (void*&);
   void         safeDeleteBuffer (unsigned int&);
+  void         safeDeleteQuery (unsigned int&);
+  void         safeDeleteVertexArray (unsigned int&);
   void         safeDeleteShader (unsigned int&);
   void         safeDeleteProgram (unsigned int&);
   unsigned int loadProgram (const char*, const char*, bool);
+  // compute shaders are written for the core profile, i.e., they are not translated
+  unsigned int loadComputeProgram (const char*);
   void         clearError ();
   void         printError ();
 }
@@ -0,0 +1,307 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "parallel.hpp"
+#include "util.hpp"
+
+namespace
+{
+  struct PendingTasks
+  {
+    std::atomic<unsigned int> numPending;
+    std::exception_ptr        exception;
+
+    PendingTasks ()
+      : numPending (0)
+    {
+    }
+  };
+
+  struct QueuedTask
+  {
+    Parallel::Task task;
+    PendingTasks*  pending;
+  };
+
+  /* Workers wait on `changed`, which is notified whenever a task is queued or finished.  Threads
+   * that wait for a task group process queued tasks of that group themselves, so tasks may be
+   * submitted from within other tasks without dead-locking the pool.  The first exception of a
+   * group's tasks is kept until the group is waited for.
+   */
+  struct Pool
+  {
+    std::mutex               mutex;
+    std::condition_variable  changed;
+    std::deque<QueuedTask>   queue;
+    std::vector<std::thread> workers;
+    unsigned int             numThreads;
+    bool                     stop;
+
+    Pool ()
+      : numThreads (0)
+      , stop (false)
+    {
+      this->start (0);
+    }
+
+    ~Pool () { this->shutdown (); }
+
+    void start (unsigned int n)
+    {
+      assert (this->workers.empty ());
+
+      this->numThreads = n == 0 ? std::max (1u, std::thread::hardware_concurrency ()) : n;
+      this->stop = false;
+
+      for (unsigned int i = 1; i < this->numThreads; i++)
+      {
+        this->workers.emplace_back ([this]() { this->work (); });
+      }
+    }
+
+    void shutdown ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->stop = true;
+      }
+      this->changed.notify_all ();
+
+      for (std::thread& worker : this->workers)
+      {
+        worker.join ();
+      }
+      this->workers.clear ();
+    }
+
+    void push (const Parallel::Task& task, PendingTasks& pending)
+    {
+      pending.numPending++;
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->queue.push_back (QueuedTask{task, &pending});
+      }
+      this->changed.notify_one ();
+    }
+
+    void run (std::unique_lock<std::mutex>& lock, std::deque<QueuedTask>::iterator it)
+    {
+      assert (lock.owns_lock ());
+      assert (it != this->queue.end ());
+
+      QueuedTask queued = std::move (*it);
+      this->queue.erase (it);
+
+      std::exception_ptr exception;
+      lock.unlock ();
+      try
+      {
+        queued.task ();
+      }
+      catch (...)
+      {
+        exception = std::current_exception ();
+      }
+      lock.lock ();
+
+      if (exception && queued.pending->exception == nullptr)
+      {
+        queued.pending->exception = exception;
+      }
+      queued.pending->numPending--;
+      this->changed.notify_all ();
+    }
+
+    void work ()
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      while (true)
+      {
+        this->changed.wait (lock, [this]() { return this->stop || this->queue.empty () == false; });
+
+        if (this->stop)
+        {
+          return;
+        }
+        this->run (lock, this->queue.begin ());
+      }
+    }
+
+    // returns the first exception of the waited tasks
+    std::exception_ptr wait (PendingTasks& pending)
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+      const auto isPending = [&pending](const QueuedTask& queued) {
+        return queued.pending == &pending;
+      };
+
+      while (pending.numPending > 0)
+      {
+        const auto it = std::find_if (this->queue.begin (), this->queue.end (), isPending);
+
+        if (it == this->queue.end ())
+        {
+          this->changed.wait (lock);
+        }
+        else
+        {
+          this->run (lock, it);
+        }
+      }
+      std::exception_ptr exception = pending.exception;
+      pending.exception = nullptr;
+      return exception;
+    }
+  };
+
+  Pool& pool ()
+  {
+    static Pool p;
+    return p;
+  }
+}
+
+namespace Parallel
+{
+  void initialize (unsigned int n)
+  {
+    Pool& p = pool ();
+
+    if ((n == 0 ? std::max (1u, std::thread::hardware_concurrency ()) : n) != p.numThreads)
+    {
+      p.shutdown ();
+      p.start (n);
+    }
+    DILAY_INFO ("Threads: %u", p.numThreads);
+  }
+
+  unsigned int numThreads () { return pool ().numThreads; }
+
+  void forRange (unsigned int n, unsigned int grainSize, const RangeTask& f)
+  {
+    assert (grainSize > 0);
+
+    if (n <= grainSize || numThreads () == 1)
+    {
+      if (n > 0)
+      {
+        f (0, n);
+      }
+    }
+    else
+    {
+      ParallelTaskGroup group;
+
+      for (unsigned int begin = 0; begin < n; begin += grainSize)
+      {
+        const unsigned int end = std::min (n, begin + grainSize);
+
+        group.add ([&f, begin, end]() { f (begin, end); });
+      }
+      group.wait ();
+    }
+  }
+
+  void forEach (unsigned int n, const IndexTask& f)
+  {
+    const unsigned int grainSize = std::max (1u, n / (8 * numThreads ()));
+
+    forRange (n, grainSize, [&f](unsigned int begin, unsigned int end) {
+      for (unsigned int i = begin; i < end; i++)
+      {
+        f (i);
+      }
+    });
+  }
+
+  /* Calls are admitted in order by the calling thread, which waits until running calls release
+   * enough of the budget.  A pool of a single thread has no workers, so its calls run in order.
+   */
+  void forEach (const std::vector<std::size_t>& costs, std::size_t budget, const IndexTask& f)
+  {
+    if (numThreads () == 1)
+    {
+      for (unsigned int i = 0; i < costs.size (); i++)
+      {
+        f (i);
+      }
+      return;
+    }
+
+    std::mutex              mutex;
+    std::condition_variable released;
+    std::size_t             runningCosts = 0;
+    unsigned int            numRunning = 0;
+    ParallelTaskGroup       group;
+
+    for (unsigned int i = 0; i < costs.size (); i++)
+    {
+      {
+        std::unique_lock<std::mutex> lock (mutex);
+        released.wait (lock, [&costs, budget, &runningCosts, &numRunning, i]() {
+          return budget == 0 || numRunning == 0 || runningCosts + costs[i] <= budget;
+        });
+        runningCosts += costs[i];
+        numRunning++;
+      }
+      group.add ([&costs, &f, &mutex, &released, &runningCosts, &numRunning, i]() {
+        const auto release = [&costs, &mutex, &released, &runningCosts, &numRunning, i]() {
+          {
+            std::lock_guard<std::mutex> lock (mutex);
+            runningCosts -= costs[i];
+            numRunning--;
+          }
+          released.notify_all ();
+        };
+        try
+        {
+          f (i);
+        }
+        catch (...)
+        {
+          release ();
+          throw;
+        }
+        release ();
+      });
+    }
+    group.wait ();
+  }
+}
+
+struct ParallelTaskGroup::Impl
+{
+  PendingTasks pending;
+
+  // exceptions of tasks that are not waited for are dropped
+  ~Impl () { pool ().wait (this->pending); }
+
+  void add (const Parallel::Task& task) { pool ().push (task, this->pending); }
+
+  bool isReady () const { return this->pending.numPending == 0; }
+
+  void wait ()
+  {
+    const std::exception_ptr exception = pool ().wait (this->pending);
+
+    if (exception)
+    {
+      std::rethrow_exception (exception);
+    }
+  }
+};
+
+DELEGATE_BIG2 (ParallelTaskGroup)
+DELEGATE1 (void, ParallelTaskGroup, add, const Parallel::Task&)
+DELEGATE_CONST (bool, ParallelTaskGroup, isReady)
+DELEGATE (void, ParallelTaskGroup, wait)
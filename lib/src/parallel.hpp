@@ -0,0 +1,49 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PARALLEL
+#define DILAY_PARALLEL
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "macro.hpp"
+
+namespace Parallel
+{
+  typedef std::function<void()>                           Task;
+  typedef std::function<void(unsigned int)>               IndexTask;
+  typedef std::function<void(unsigned int, unsigned int)> RangeTask;
+
+  // 0 uses all available cores (includes the calling thread, which helps while waiting)
+  void         initialize (unsigned int);
+  unsigned int numThreads ();
+
+  // calls `f (begin, end)` on sub-ranges of [0, n) with at most the given number of elements
+  void forRange (unsigned int, unsigned int, const RangeTask&);
+  void forEach (unsigned int, const IndexTask&);
+
+  /* Calls `f (i)` concurrently for each of the given costs (e.g., estimated bytes), such that the
+   * costs of running calls stay within the given budget.  A call that exceeds the budget runs
+   * alone, and a budget of 0 admits all calls at once.
+   */
+  void forEach (const std::vector<std::size_t>&, std::size_t, const IndexTask&);
+}
+
+class ParallelTaskGroup
+{
+public:
+  DECLARE_BIG2 (ParallelTaskGroup)
+
+  void add (const Parallel::Task&);
+  // whether all added tasks are finished, without helping
+  bool isReady () const;
+  // helps with queued tasks of the group and rethrows the first exception of its tasks
+  void wait ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
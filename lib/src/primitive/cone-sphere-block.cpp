@@ -0,0 +1,62 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "primitive/cone-sphere-block.hpp"
+#include "primitive/cone-sphere.hpp"
+#include "util.hpp"
+
+PrimConeSphereBlock::PrimConeSphereBlock ()
+  : _numConeSpheres (0)
+{
+}
+
+void PrimConeSphereBlock::add (const PrimConeSphere& c)
+{
+  assert (this->isFull () == false);
+
+  const unsigned int i = this->_numConeSpheres++;
+  Parameters&        p = this->_parameters;
+  const bool         sameRadii = c.sameRadii ();
+  const bool         cone = sameRadii ? c.length () > Util::epsilon () : c.hasCone ();
+  const float        r1 = c.sphere1 ().radius ();
+  const float        r2 = c.sphere2 ().radius ();
+  const float        l = c.length ();
+  const glm::vec3    direction = cone ? c.direction () : glm::vec3 (0.0f);
+
+  p.x[i] = c.sphere1 ().center ().x;
+  p.y[i] = c.sphere1 ().center ().y;
+  p.z[i] = c.sphere1 ().center ().z;
+  p.directionX[i] = direction.x;
+  p.directionY[i] = direction.y;
+  p.directionZ[i] = direction.z;
+  p.radius1[i] = r1;
+  p.endRadius[i] = sameRadii ? r1 : r2;
+  p.length[i] = l;
+  p.hasCone[i] = cone;
+
+  if (cone && sameRadii == false)
+  {
+    const float s = c.coneSideLength ();
+
+    p.sideLength[i] = s;
+    p.h1[i] = r1 * c.delta () / l;
+    p.h2[i] = r2 * c.delta () / l;
+    p.r1c[i] = r1 * s / l;
+    p.r2c[i] = r2 * s / l;
+    p.sinAlpha[i] = c.sinAlpha ();
+    p.cosAlpha[i] = c.cosAlpha ();
+  }
+  else
+  {
+    p.sideLength[i] = l;
+    p.h1[i] = 0.0f;
+    p.h2[i] = 0.0f;
+    p.r1c[i] = r1;
+    p.r2c[i] = r1;
+    p.sinAlpha[i] = 0.0f;
+    p.cosAlpha[i] = 1.0f;
+  }
+}
+
+void PrimConeSphereBlock::reset () { this->_numConeSpheres = 0; }
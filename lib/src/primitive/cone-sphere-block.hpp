@@ -0,0 +1,47 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PRIMITIVE_CONE_SPHERE_BLOCK
+#define DILAY_PRIMITIVE_CONE_SPHERE_BLOCK
+
+#include <glm/glm.hpp>
+
+class PrimConeSphere;
+
+/* A small block of cone-spheres, whose parameters are precomputed once and stored as separate
+ * arrays (cf. `Distance::distance (const PrimConeSphere&, const glm::vec3&)`).  Cone-spheres with
+ * equal radii are stored as cones with a zero angle, and cone-spheres without a cone are reduced
+ * to their first sphere.
+ */
+class PrimConeSphereBlock
+{
+public:
+  static constexpr unsigned int maxConeSpheres = 8;
+
+  struct Parameters
+  {
+    float x[maxConeSpheres], y[maxConeSpheres], z[maxConeSpheres];
+    float directionX[maxConeSpheres], directionY[maxConeSpheres], directionZ[maxConeSpheres];
+    float radius1[maxConeSpheres], endRadius[maxConeSpheres];
+    float length[maxConeSpheres], sideLength[maxConeSpheres];
+    float h1[maxConeSpheres], h2[maxConeSpheres], r1c[maxConeSpheres], r2c[maxConeSpheres];
+    float sinAlpha[maxConeSpheres], cosAlpha[maxConeSpheres];
+    bool  hasCone[maxConeSpheres];
+  };
+
+  PrimConeSphereBlock ();
+
+  unsigned int      numConeSpheres () const { return this->_numConeSpheres; }
+  bool              isFull () const { return this->_numConeSpheres == maxConeSpheres; }
+  const Parameters& parameters () const { return this->_parameters; }
+
+  void add (const PrimConeSphere&);
+  void reset ();
+
+private:
+  unsigned int _numConeSpheres;
+  Parameters   _parameters;
+};
+
+#endif
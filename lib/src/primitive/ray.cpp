@@ -9,6 +9,7 @@ PrimRay::PrimRay (bool l, const glm::vec3& o, const glm::vec3& d)
   : _isLine (l)
   , _origin (o)
   , _direction (glm::normalize (d))
+  , _invDirection (glm::vec3 (1.0f) / this->_direction)
 {
 }
 
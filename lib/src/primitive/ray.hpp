@@ -16,6 +16,8 @@ public:
   bool             isLine () const { return this->_isLine; }
   const glm::vec3& origin () const { return this->_origin; }
   const glm::vec3& direction () const { return this->_direction; }
+  // for slab tests against boxes
+  const glm::vec3& invDirection () const { return this->_invDirection; }
 
   void origin (const glm::vec3& o) { this->_origin = o; }
 
@@ -27,6 +29,7 @@ private:
   const bool      _isLine;
   glm::vec3       _origin;
   const glm::vec3 _direction;
+  const glm::vec3 _invDirection;
 };
 
 #endif
@@ -0,0 +1,50 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "primitive/triangle-block.hpp"
+#include "primitive/triangle.hpp"
+#include "util.hpp"
+
+namespace
+{
+  void set (PrimTriangleBlock::Coordinates& cs, unsigned int i, const glm::vec3& v)
+  {
+    cs.x[i] = v.x;
+    cs.y[i] = v.y;
+    cs.z[i] = v.z;
+  }
+
+  glm::vec3 get (const PrimTriangleBlock::Coordinates& cs, unsigned int i)
+  {
+    return glm::vec3 (cs.x[i], cs.y[i], cs.z[i]);
+  }
+}
+
+PrimTriangleBlock::PrimTriangleBlock ()
+  : _numTriangles (0)
+{
+}
+
+glm::vec3 PrimTriangleBlock::normal (unsigned int i) const
+{
+  assert (i < this->_numTriangles);
+
+  const glm::vec3 c = glm::cross (get (this->_edges1, i), get (this->_edges2, i));
+  const float     l = glm::length (c);
+
+  return l > 0.0f ? (c / l) : glm::vec3 (0.0f);
+}
+
+void PrimTriangleBlock::add (const PrimTriangle& tri)
+{
+  assert (this->isFull () == false);
+
+  const unsigned int i = this->_numTriangles++;
+
+  set (this->_vertices1, i, tri.vertex1 ());
+  set (this->_edges1, i, tri.vertex2 () - tri.vertex1 ());
+  set (this->_edges2, i, tri.vertex3 () - tri.vertex1 ());
+}
+
+void PrimTriangleBlock::reset () { this->_numTriangles = 0; }
@@ -0,0 +1,47 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PRIMITIVE_TRIANGLE_BLOCK
+#define DILAY_PRIMITIVE_TRIANGLE_BLOCK
+
+#include <glm/glm.hpp>
+
+class PrimTriangle;
+
+/* A small block of triangles, which are stored as separate coordinate arrays of their first
+ * vertices and of their edges from the first vertex.  Kernels process all triangles of a block
+ * in a single loop over plain floats.
+ */
+class PrimTriangleBlock
+{
+public:
+  static constexpr unsigned int maxTriangles = 8;
+
+  struct Coordinates
+  {
+    float x[maxTriangles];
+    float y[maxTriangles];
+    float z[maxTriangles];
+  };
+
+  PrimTriangleBlock ();
+
+  unsigned int       numTriangles () const { return this->_numTriangles; }
+  bool               isFull () const { return this->_numTriangles == maxTriangles; }
+  const Coordinates& vertices1 () const { return this->_vertices1; }
+  const Coordinates& edges1 () const { return this->_edges1; }
+  const Coordinates& edges2 () const { return this->_edges2; }
+  glm::vec3          normal (unsigned int) const;
+
+  void add (const PrimTriangle&);
+  void reset ();
+
+private:
+  unsigned int _numTriangles;
+  Coordinates  _vertices1;
+  Coordinates  _edges1;
+  Coordinates  _edges2;
+};
+
+#endif
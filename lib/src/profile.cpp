@@ -0,0 +1,287 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "profile.hpp"
+
+namespace
+{
+  struct Zone
+  {
+    const char*  name;
+    std::int64_t begin;
+    std::int64_t end;
+  };
+
+  // each thread records into its own buffer, which is only shared while it is written out
+  struct ThreadZones
+  {
+    unsigned int                                  threadId;
+    std::mutex                                    mutex;
+    std::vector<Zone>                             zones;
+    std::unordered_map<const char*, std::int64_t> totals;
+  };
+
+  typedef std::chrono::steady_clock Clock;
+
+  const Clock::time_point                   epoch = Clock::now ();
+  std::atomic<bool>                         running (false);
+  std::atomic<bool>                         accumulating (false);
+  std::mutex                                threadsMutex;
+  std::vector<std::unique_ptr<ThreadZones>> threads;
+  std::mutex                                gpuMutex;
+  Profile::Totals                           gpuTotals;
+
+  /* Counters are claimed by tags without locking, since they are updated by `operator new`,
+   * which must not allocate.  Tags are compared by their addresses.
+   */
+  struct AllocationCounter
+  {
+    std::atomic<const char*>   tag;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> bytes;
+  };
+
+  const unsigned int       maxAllocationTags = 64;
+  AllocationCounter        allocationCounters[maxAllocationTags];
+  thread_local const char* allocationTag = nullptr;
+
+  void countAllocation (std::size_t size)
+  {
+    const char* tag = allocationTag;
+
+    if (tag == nullptr)
+    {
+      return;
+    }
+    for (AllocationCounter& c : allocationCounters)
+    {
+      const char* cTag = c.tag.load (std::memory_order_acquire);
+
+      if (cTag == nullptr && c.tag.compare_exchange_strong (cTag, tag))
+      {
+        cTag = tag;
+      }
+      if (cTag == tag)
+      {
+        c.count.fetch_add (1, std::memory_order_relaxed);
+        c.bytes.fetch_add (size, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  std::int64_t now ()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (Clock::now () - epoch).count ();
+  }
+
+  ThreadZones& threadZones ()
+  {
+    thread_local ThreadZones* zones = nullptr;
+
+    if (zones == nullptr)
+    {
+      std::lock_guard<std::mutex> lock (threadsMutex);
+
+      threads.emplace_back (new ThreadZones);
+      threads.back ()->threadId = threads.size ();
+      zones = threads.back ().get ();
+    }
+    return *zones;
+  }
+
+  void writeEscaped (std::ostream& stream, const char* string)
+  {
+    for (const char* c = string; *c != '\0'; c++)
+    {
+      if (*c == '"' || *c == '\\')
+      {
+        stream << '\\';
+      }
+      stream << *c;
+    }
+  }
+}
+
+namespace Profile
+{
+  void start () { running = true; }
+
+  void stop () { running = false; }
+
+  bool isRunning () { return running; }
+
+  void clear ()
+  {
+    std::lock_guard<std::mutex> lock (threadsMutex);
+
+    for (std::unique_ptr<ThreadZones>& t : threads)
+    {
+      std::lock_guard<std::mutex> threadLock (t->mutex);
+      t->zones.clear ();
+    }
+  }
+
+  bool toChromeTrace (const std::string& fileName)
+  {
+    std::ofstream file (fileName);
+
+    if (file.is_open () == false)
+    {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock (threadsMutex);
+    bool                        isFirst = true;
+
+    file << std::fixed << std::setprecision (3) << "{\"traceEvents\":[";
+    for (std::unique_ptr<ThreadZones>& t : threads)
+    {
+      std::lock_guard<std::mutex> threadLock (t->mutex);
+
+      for (const Zone& zone : t->zones)
+      {
+        file << (isFirst ? "\n" : ",\n") << "{\"name\":\"";
+        writeEscaped (file, zone.name);
+        file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t->threadId
+             << ",\"ts\":" << (double(zone.begin) / 1000.0)
+             << ",\"dur\":" << (double(zone.end - zone.begin) / 1000.0) << "}";
+        isFirst = false;
+      }
+    }
+    file << "\n]}\n";
+    return file.good ();
+  }
+
+  void accumulateTotals (bool a) { accumulating = a; }
+
+  bool isAccumulatingTotals () { return accumulating; }
+
+  Totals takeTotals ()
+  {
+    std::lock_guard<std::mutex> lock (threadsMutex);
+    Totals                      totals;
+
+    for (std::unique_ptr<ThreadZones>& t : threads)
+    {
+      std::lock_guard<std::mutex> threadLock (t->mutex);
+
+      for (const auto& total : t->totals)
+      {
+        totals[total.first] += double(total.second) / 1000000.0;
+      }
+      t->totals.clear ();
+    }
+    return totals;
+  }
+
+  void gpuTime (const char* name, double ms)
+  {
+    std::lock_guard<std::mutex> lock (gpuMutex);
+    gpuTotals[name] = ms;
+  }
+
+  Totals takeGpuTimes ()
+  {
+    std::lock_guard<std::mutex> lock (gpuMutex);
+    Totals                      times;
+
+    std::swap (times, gpuTotals);
+    return times;
+  }
+
+  bool tracksAllocations ()
+  {
+#if defined(DILAY_ENABLE_ALLOCATION_TRACKING)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  AllocationTotals takeAllocations ()
+  {
+    AllocationTotals totals;
+
+    for (AllocationCounter& c : allocationCounters)
+    {
+      const char* tag = c.tag.load (std::memory_order_acquire);
+
+      if (tag)
+      {
+        Allocations& a = totals[tag];
+        a.count += c.count.exchange (0, std::memory_order_relaxed);
+        a.bytes += c.bytes.exchange (0, std::memory_order_relaxed);
+      }
+    }
+    return totals;
+  }
+}
+
+ProfileZone::ProfileZone (const char* n)
+  : name (n)
+  , begin ((running || accumulating) ? now () : -1)
+{
+}
+
+ProfileZone::~ProfileZone ()
+{
+  if (this->begin >= 0)
+  {
+    const std::int64_t          end = now ();
+    ThreadZones&                zones = threadZones ();
+    std::lock_guard<std::mutex> lock (zones.mutex);
+
+    if (running)
+    {
+      zones.zones.push_back (Zone{this->name, this->begin, end});
+    }
+    if (accumulating)
+    {
+      zones.totals[this->name] += end - this->begin;
+    }
+  }
+}
+
+AllocationScope::AllocationScope (const char* tag)
+  : outerTag (allocationTag)
+{
+  allocationTag = tag;
+}
+
+AllocationScope::~AllocationScope () { allocationTag = this->outerTag; }
+
+#if defined(DILAY_ENABLE_ALLOCATION_TRACKING)
+void* operator new (std::size_t size)
+{
+  countAllocation (size);
+
+  void* p = std::malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+  {
+    throw std::bad_alloc ();
+  }
+  return p;
+}
+
+void* operator new[] (std::size_t size) { return operator new (size); }
+
+void operator delete (void* p) noexcept { std::free (p); }
+
+void operator delete[] (void* p) noexcept { std::free (p); }
+
+void operator delete (void* p, std::size_t) noexcept { std::free (p); }
+
+void operator delete[] (void* p, std::size_t) noexcept { std::free (p); }
+#endif
@@ -0,0 +1,98 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PROFILE
+#define DILAY_PROFILE
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/* Zones are compiled into debug builds, and into release builds if `DILAY_ENABLE_PROFILER` is
+ * defined.  They are only recorded while the profiler is running.  Independently of that, the
+ * durations of zones can be summed up per name.  Zone names must outlive the profiler, e.g.,
+ * string literals.
+ */
+#define DILAY_PROFILE_CONCAT_DETAIL(a, b) a##b
+#define DILAY_PROFILE_CONCAT(a, b) DILAY_PROFILE_CONCAT_DETAIL (a, b)
+
+#if !defined(NDEBUG) || defined(DILAY_ENABLE_PROFILER)
+#define DILAY_PROFILE_ZONE(name) \
+  const ProfileZone DILAY_PROFILE_CONCAT (profileZone, __LINE__) (name)
+#else
+#define DILAY_PROFILE_ZONE(name) static_cast<void> (0)
+#endif
+
+/* Allocations are only tracked if `DILAY_ENABLE_ALLOCATION_TRACKING` is defined, which replaces
+ * the global `operator new`.  Allocations of a thread are counted per tag of its innermost
+ * allocation scope, i.e., allocations of workers of the thread pool are not attributed to the
+ * scope that runs them.  Tags must be string literals and there are at most 64 of them.
+ */
+#if defined(DILAY_ENABLE_ALLOCATION_TRACKING)
+#define DILAY_ALLOCATION_SCOPE(tag) \
+  const AllocationScope DILAY_PROFILE_CONCAT (allocationScope, __LINE__) (tag)
+#else
+#define DILAY_ALLOCATION_SCOPE(tag) static_cast<void> (0)
+#endif
+
+namespace Profile
+{
+  void start ();
+  void stop ();
+  bool isRunning ();
+  void clear ();
+
+  // writes all recorded zones as trace events, which can be viewed in Chrome's `about:tracing`
+  bool toChromeTrace (const std::string&);
+
+  // summed up durations in milliseconds, indexed by zone names
+  typedef std::map<std::string, double> Totals;
+
+  void   accumulateTotals (bool);
+  bool   isAccumulatingTotals ();
+  Totals takeTotals ();
+
+  // measured GPU durations in milliseconds, indexed by the names of render passes
+  void   gpuTime (const char*, double);
+  Totals takeGpuTimes ();
+
+  struct Allocations
+  {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+  };
+
+  // allocations since the last call, indexed by tags
+  typedef std::map<std::string, Allocations> AllocationTotals;
+
+  bool             tracksAllocations ();
+  AllocationTotals takeAllocations ();
+}
+
+class ProfileZone
+{
+public:
+  explicit ProfileZone (const char*);
+  ProfileZone (const ProfileZone&) = delete;
+  ProfileZone& operator= (const ProfileZone&) = delete;
+  ~ProfileZone ();
+
+private:
+  const char*  name;
+  std::int64_t begin;
+};
+
+class AllocationScope
+{
+public:
+  explicit AllocationScope (const char*);
+  AllocationScope (const AllocationScope&) = delete;
+  AllocationScope& operator= (const AllocationScope&) = delete;
+  ~AllocationScope ();
+
+private:
+  const char* outerTag;
+};
+
+#endif
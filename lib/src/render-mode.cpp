@@ -13,6 +13,8 @@ RenderMode::RenderMode ()
   this->renderWireframe (false);
   this->cameraRotationOnly (false);
   this->noDepthTest (false);
+  this->instancing (false);
+  this->octahedralNormals (false);
 }
 
 RenderMode::RenderMode (const RenderMode& other)
@@ -32,19 +34,45 @@ bool RenderMode::cameraRotationOnly () const { return this->flags.get<4> (); }
 
 bool RenderMode::noDepthTest () const { return this->flags.get<5> (); }
 
+bool RenderMode::instancing () const { return this->flags.get<6> (); }
+
+bool RenderMode::octahedralNormals () const { return this->flags.get<7> (); }
+
+bool RenderMode::matcapShading () const { return this->flags.get<8> (); }
+
+unsigned int RenderMode::value () const { return this->flags.value (); }
+
 const char* RenderMode::vertexShader () const
 {
-  if (this->smoothShading ())
+  if (this->smoothShading () && this->octahedralNormals ())
+  {
+    return this->instancing () ? Shader::smoothInstancedOctahedralVertexShader ()
+                               : Shader::smoothOctahedralVertexShader ();
+  }
+  else if (this->smoothShading ())
   {
-    return Shader::smoothVertexShader ();
+    return this->instancing () ? Shader::smoothInstancedVertexShader ()
+                               : Shader::smoothVertexShader ();
+  }
+  else if (this->matcapShading () && this->octahedralNormals ())
+  {
+    return this->instancing () ? Shader::matcapInstancedOctahedralVertexShader ()
+                               : Shader::matcapOctahedralVertexShader ();
+  }
+  else if (this->matcapShading ())
+  {
+    return this->instancing () ? Shader::matcapInstancedVertexShader ()
+                               : Shader::matcapVertexShader ();
   }
   else if (this->flatShading ())
   {
-    return Shader::flatVertexShader ();
+    return this->instancing () ? Shader::flatInstancedVertexShader ()
+                               : Shader::flatVertexShader ();
   }
   else if (this->constantShading ())
   {
-    return Shader::constantVertexShader ();
+    return this->instancing () ? Shader::constantInstancedVertexShader ()
+                               : Shader::constantVertexShader ();
   }
   else
   {
@@ -54,7 +82,7 @@ const char* RenderMode::vertexShader () const
 
 const char* RenderMode::fragmentShader () const
 {
-  if (this->smoothShading ())
+  if (this->smoothShading () || this->matcapShading ())
   {
     return this->renderWireframe () ? Shader::smoothWireframeFragmentShader ()
                                     : Shader::smoothFragmentShader ();
@@ -82,6 +110,7 @@ void RenderMode::smoothShading (bool v)
   {
     this->flags.set<1> (false);
     this->flags.set<2> (false);
+    this->flags.set<8> (false);
   }
 }
 
@@ -92,6 +121,7 @@ void RenderMode::flatShading (bool v)
   {
     this->flags.set<0> (false);
     this->flags.set<2> (false);
+    this->flags.set<8> (false);
   }
 }
 
@@ -102,6 +132,18 @@ void RenderMode::constantShading (bool v)
   {
     this->flags.set<0> (false);
     this->flags.set<1> (false);
+    this->flags.set<8> (false);
+  }
+}
+
+void RenderMode::matcapShading (bool v)
+{
+  this->flags.set<8> (v);
+  if (v)
+  {
+    this->flags.set<0> (false);
+    this->flags.set<1> (false);
+    this->flags.set<2> (false);
   }
 }
 
@@ -110,3 +152,7 @@ void RenderMode::renderWireframe (bool v) { this->flags.set<3> (v); }
 void RenderMode::cameraRotationOnly (bool v) { this->flags.set<4> (v); }
 
 void RenderMode::noDepthTest (bool v) { this->flags.set<5> (v); }
+
+void RenderMode::instancing (bool v) { this->flags.set<6> (v); }
+
+void RenderMode::octahedralNormals (bool v) { this->flags.set<7> (v); }
@@ -13,21 +13,28 @@ public:
   RenderMode ();
   RenderMode (const RenderMode&);
 
-  bool        smoothShading () const;
-  bool        flatShading () const;
-  bool        constantShading () const;
-  bool        renderWireframe () const;
-  bool        cameraRotationOnly () const;
-  bool        noDepthTest () const;
-  const char* vertexShader () const;
-  const char* fragmentShader () const;
+  bool         smoothShading () const;
+  bool         flatShading () const;
+  bool         constantShading () const;
+  bool         matcapShading () const;
+  bool         renderWireframe () const;
+  bool         cameraRotationOnly () const;
+  bool         noDepthTest () const;
+  bool         instancing () const;
+  bool         octahedralNormals () const;
+  const char*  vertexShader () const;
+  const char*  fragmentShader () const;
+  unsigned int value () const;
 
   void smoothShading (bool);
   void flatShading (bool);
   void constantShading (bool);
+  void matcapShading (bool);
   void renderWireframe (bool);
   void cameraRotationOnly (bool);
   void noDepthTest (bool);
+  void instancing (bool);
+  void octahedralNormals (bool);
 
 private:
   Bitset<unsigned int> flags;
@@ -3,11 +3,15 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
 #include "color.hpp"
 #include "config.hpp"
 #include "opengl.hpp"
+#include "profile.hpp"
 #include "render-mode.hpp"
 #include "renderer.hpp"
+#include "shader.hpp"
 #include "util.hpp"
 
 namespace
@@ -28,18 +32,55 @@ namespace
     }
   };
 
+  // uniform values of a program, which are only uploaded if they change
+  struct ShaderValues
+  {
+    unsigned int globalUniformsVersion;
+    glm::mat4x4  view;
+    glm::mat4x4  projection;
+    glm::vec4    color;
+    glm::vec4    wireframeColor;
+
+    ShaderValues ()
+      : globalUniformsVersion (0)
+      , view (0.0f)
+      , projection (0.0f)
+      , color (-1.0f)
+      , wireframeColor (-1.0f)
+    {
+    }
+  };
+
+  struct BrushRegionIds
+  {
+    int regionId;
+    int normalId;
+    int innerRadiusId;
+    int colorId;
+
+    BrushRegionIds ()
+      : regionId (0)
+      , normalId (0)
+      , innerRadiusId (0)
+      , colorId (0)
+    {
+    }
+  };
+
   struct ShaderIds
   {
-    unsigned int programId;
-    int          modelId;
-    int          modelNormalId;
-    int          viewId;
-    int          projectionId;
-    int          colorId;
-    int          wireframeColorId;
-    int          eyePointId;
-    int          barycentricId;
-    LightIds     lightIds[numLights];
+    unsigned int   programId;
+    int            modelId;
+    int            modelNormalId;
+    int            viewId;
+    int            projectionId;
+    int            colorId;
+    int            wireframeColorId;
+    int            eyePointId;
+    int            barycentricId;
+    LightIds       lightIds[numLights];
+    BrushRegionIds brushRegionIds;
+    ShaderValues   values;
 
     ShaderIds ()
       : programId (0)
@@ -55,6 +96,36 @@ namespace
     }
   };
 
+  struct NormalIds
+  {
+    unsigned int programId;
+    int          numVerticesId;
+    int          strideId;
+    int          packedNormalsId;
+
+    NormalIds ()
+      : programId (0)
+      , numVerticesId (0)
+      , strideId (0)
+      , packedNormalsId (0)
+    {
+    }
+  };
+
+  struct GpuTimer
+  {
+    unsigned int id;
+    const char*  name;
+    bool         isPending;
+
+    GpuTimer ()
+      : id (0)
+      , name (nullptr)
+      , isPending (false)
+    {
+    }
+  };
+
   struct GlobalLightUniforms
   {
     glm::vec3 direction;
@@ -62,24 +133,48 @@ namespace
     float     irradiance;
   };
 
+  // a region of radius 0 is not highlighted
+  struct GlobalBrushRegionUniforms
+  {
+    glm::vec4 region;
+    glm::vec3 normal;
+    float     innerRadius;
+    Color     color;
+
+    GlobalBrushRegionUniforms ()
+      : region (0.0f)
+      , normal (0.0f)
+      , innerRadius (0.0f)
+    {
+    }
+  };
+
   struct GlobalUniforms
   {
-    GlobalLightUniforms lightUniforms[numLights];
-    glm::vec3           eyePoint;
+    GlobalLightUniforms       lightUniforms[numLights];
+    glm::vec3                 eyePoint;
+    GlobalBrushRegionUniforms brushRegion;
   };
 };
 
 struct Renderer::Impl
 {
-  static const unsigned int numShaders = 6;
-
-  ShaderIds      shaderIds[Impl::numShaders];
-  ShaderIds*     activeShaderIndex;
-  GlobalUniforms globalUniforms;
-  Color          clearColor;
+  static const unsigned int numShaders = 24;
+  static const unsigned int maxGpuTimers = 64;
+
+  ShaderIds             shaderIds[Impl::numShaders];
+  ShaderIds*            activeShaderIndex;
+  NormalIds             normalIds;
+  GlobalUniforms        globalUniforms;
+  unsigned int          globalUniformsVersion;
+  Color                 clearColor;
+  std::vector<GpuTimer> gpuTimers;
+  GpuTimer*             activeGpuTimer;
 
   Impl (const Config& config)
     : activeShaderIndex (nullptr)
+    , globalUniformsVersion (1)
+    , activeGpuTimer (nullptr)
   {
     this->runFromConfig (config);
   }
@@ -90,6 +185,12 @@ struct Renderer::Impl
     {
       OpenGL::safeDeleteProgram (this->shaderIds[i].programId);
     }
+    OpenGL::safeDeleteProgram (this->normalIds.programId);
+
+    for (GpuTimer& timer : this->gpuTimers)
+    {
+      OpenGL::safeDeleteQuery (timer.id);
+    }
   }
 
   void setupRendering ()
@@ -103,6 +204,82 @@ struct Renderer::Impl
     OpenGL::glEnable (OpenGL::DepthTest ());
     OpenGL::glDepthFunc (OpenGL::LEqual ());
     OpenGL::glClear (OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ());
+
+    // the active program may have been changed by native painting
+    this->activeShaderIndex = nullptr;
+
+    this->readGpuTimers ();
+  }
+
+  /* Timers are only measured while totals of the profiler are accumulated, and not in secondary
+   * contexts, which do not share queries.  A timer is reused once its result has been read,
+   * which happens a few frames later.  If all timers are still pending, passes are not measured.
+   */
+  void beginGpuTimer (const char* name)
+  {
+    assert (this->activeGpuTimer == nullptr);
+
+    if (Profile::isAccumulatingTotals () == false || OpenGL::hasTimerQuery () == false ||
+        OpenGL::isSecondaryContext ())
+    {
+      return;
+    }
+
+    for (GpuTimer& timer : this->gpuTimers)
+    {
+      if (timer.isPending == false)
+      {
+        this->activeGpuTimer = &timer;
+        break;
+      }
+    }
+    if (this->activeGpuTimer == nullptr && this->gpuTimers.size () < Impl::maxGpuTimers)
+    {
+      this->gpuTimers.emplace_back ();
+      this->activeGpuTimer = &this->gpuTimers.back ();
+      OpenGL::glGenQueries (1, &this->activeGpuTimer->id);
+    }
+
+    if (this->activeGpuTimer)
+    {
+      this->activeGpuTimer->name = name;
+      OpenGL::glBeginQuery (OpenGL::TimeElapsed (), this->activeGpuTimer->id);
+    }
+  }
+
+  void endGpuTimer ()
+  {
+    if (this->activeGpuTimer)
+    {
+      OpenGL::glEndQuery (OpenGL::TimeElapsed ());
+      this->activeGpuTimer->isPending = true;
+      this->activeGpuTimer = nullptr;
+    }
+  }
+
+  void readGpuTimers ()
+  {
+    if (OpenGL::isSecondaryContext ())
+    {
+      return;
+    }
+
+    for (GpuTimer& timer : this->gpuTimers)
+    {
+      unsigned int isAvailable = 0;
+
+      if (timer.isPending)
+      {
+        OpenGL::glGetQueryObjectuiv (timer.id, OpenGL::QueryResultAvailable (), &isAvailable);
+      }
+      if (isAvailable)
+      {
+        std::uint64_t ns = 0;
+        OpenGL::glGetQueryObjectui64v (timer.id, OpenGL::QueryResult (), &ns);
+        Profile::gpuTime (timer.name, double(ns) / 1000000.0);
+        timer.isPending = false;
+      }
+    }
   }
 
   void shutdownRendering ()
@@ -111,19 +288,31 @@ struct Renderer::Impl
     OpenGL::glDisable (OpenGL::CullFace ());
   }
 
-  unsigned int shaderIndex (const RenderMode& renderMode)
+  unsigned int shaderIndex (const RenderMode& renderMode) const
   {
-    if (renderMode.smoothShading ())
+    const unsigned int offset = renderMode.instancing () ? 6 : 0;
+
+    // only smooth and matcap shading read normals
+    if (renderMode.smoothShading () && renderMode.octahedralNormals ())
     {
-      return renderMode.renderWireframe () ? 0 : 1;
+      return 12 + (renderMode.instancing () ? 2 : 0) + (renderMode.renderWireframe () ? 0 : 1);
+    }
+    else if (renderMode.matcapShading ())
+    {
+      return 16 + (renderMode.octahedralNormals () ? 4 : 0) + (renderMode.instancing () ? 2 : 0) +
+             (renderMode.renderWireframe () ? 0 : 1);
+    }
+    else if (renderMode.smoothShading ())
+    {
+      return offset + (renderMode.renderWireframe () ? 0 : 1);
     }
     else if (renderMode.flatShading ())
     {
-      return renderMode.renderWireframe () ? 2 : 3;
+      return offset + (renderMode.renderWireframe () ? 2 : 3);
     }
     else if (renderMode.constantShading ())
     {
-      return renderMode.renderWireframe () ? 4 : 5;
+      return offset + (renderMode.renderWireframe () ? 4 : 5);
     }
     else
     {
@@ -158,6 +347,10 @@ struct Renderer::Impl
     s->lightIds[1].directionId = OpenGL::glGetUniformLocation (id, "light2Direction");
     s->lightIds[1].colorId = OpenGL::glGetUniformLocation (id, "light2Color");
     s->lightIds[1].irradianceId = OpenGL::glGetUniformLocation (id, "light2Irradiance");
+    s->brushRegionIds.regionId = OpenGL::glGetUniformLocation (id, "brushRegion");
+    s->brushRegionIds.normalId = OpenGL::glGetUniformLocation (id, "brushNormal");
+    s->brushRegionIds.innerRadiusId = OpenGL::glGetUniformLocation (id, "brushInnerRadius");
+    s->brushRegionIds.colorId = OpenGL::glGetUniformLocation (id, "brushColor");
   }
 
   void setProgram (const RenderMode& renderMode)
@@ -170,9 +363,21 @@ struct Renderer::Impl
     }
     assert (this->shaderIds[index].programId);
 
-    this->activeShaderIndex = &this->shaderIds[index];
-    OpenGL::glUseProgram (this->activeShaderIndex->programId);
+    if (this->activeShaderIndex != &this->shaderIds[index])
+    {
+      this->activeShaderIndex = &this->shaderIds[index];
+      OpenGL::glUseProgram (this->activeShaderIndex->programId);
+    }
+
+    if (this->activeShaderIndex->values.globalUniformsVersion != this->globalUniformsVersion)
+    {
+      this->activeShaderIndex->values.globalUniformsVersion = this->globalUniformsVersion;
+      this->setGlobalUniforms ();
+    }
+  }
 
+  void setGlobalUniforms ()
+  {
     OpenGL::glUniformVec3 (this->activeShaderIndex->eyePointId, this->globalUniforms.eyePoint);
 
     for (unsigned int i = 0; i < numLights; i++)
@@ -184,6 +389,44 @@ struct Renderer::Impl
       OpenGL::glUniform1f (this->activeShaderIndex->lightIds[i].irradianceId,
                            this->globalUniforms.lightUniforms[i].irradiance);
     }
+
+    const BrushRegionIds&            b = this->activeShaderIndex->brushRegionIds;
+    const GlobalBrushRegionUniforms& region = this->globalUniforms.brushRegion;
+
+    OpenGL::glUniformVec4 (b.regionId, region.region);
+    OpenGL::glUniformVec3 (b.normalId, region.normal);
+    OpenGL::glUniform1f (b.innerRadiusId, region.innerRadius);
+    OpenGL::glUniformVec3 (b.colorId, region.color.vec3 ());
+  }
+
+  // the active program is changed, hence it is set again when rendering next
+  void recomputeNormals (unsigned int vertexBufferId, unsigned int workBufferId,
+                         unsigned int numVertices, unsigned int stride, bool packedNormals)
+  {
+    assert (OpenGL::hasComputeShader ());
+
+    const unsigned int localSize = 64;
+    NormalIds&         n = this->normalIds;
+
+    if (n.programId == 0)
+    {
+      n.programId = OpenGL::loadComputeProgram (Shader::normalComputeShader ());
+      n.numVerticesId = OpenGL::glGetUniformLocation (n.programId, "numVertices");
+      n.strideId = OpenGL::glGetUniformLocation (n.programId, "stride");
+      n.packedNormalsId = OpenGL::glGetUniformLocation (n.programId, "packedNormals");
+    }
+    OpenGL::glUseProgram (n.programId);
+    OpenGL::glUniform1i (n.numVerticesId, int(numVertices));
+    OpenGL::glUniform1i (n.strideId, int(stride));
+    OpenGL::glUniform1i (n.packedNormalsId, packedNormals ? 1 : 0);
+    OpenGL::glBindBufferBase (OpenGL::ShaderStorageBuffer (), 0, vertexBufferId);
+    OpenGL::glBindBufferBase (OpenGL::ShaderStorageBuffer (), 1, workBufferId);
+    OpenGL::glDispatchCompute ((numVertices + localSize - 1) / localSize, 1, 1);
+    OpenGL::glMemoryBarrier (OpenGL::VertexAttribArrayBarrierBit ());
+    OpenGL::glBindBufferBase (OpenGL::ShaderStorageBuffer (), 0, 0);
+    OpenGL::glBindBufferBase (OpenGL::ShaderStorageBuffer (), 1, 0);
+
+    this->activeShaderIndex = nullptr;
   }
 
   void setModel (const float* model, const float* modelNormal)
@@ -196,20 +439,49 @@ struct Renderer::Impl
   void setView (const float* view)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+
+    const glm::mat4x4 v = glm::make_mat4 (view);
+    if (this->activeShaderIndex->values.view != v)
+    {
+      this->activeShaderIndex->values.view = v;
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+    }
   }
 
   void setProjection (const float* projection)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+
+    const glm::mat4x4 p = glm::make_mat4 (projection);
+    if (this->activeShaderIndex->values.projection != p)
+    {
+      this->activeShaderIndex->values.projection = p;
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+    }
+  }
+
+  // the alpha of the cached value marks colors without opacity
+  static bool updateColor (glm::vec4& cached, const Color& c, bool withOpacity)
+  {
+    const glm::vec4 value = withOpacity ? c.vec4 () : glm::vec4 (c.vec3 (), -1.0f);
+
+    if (cached != value)
+    {
+      cached = value;
+      return true;
+    }
+    return false;
   }
 
   void setColor (const Color& c, bool withOpacity)
   {
     assert (this->activeShaderIndex);
 
-    if (withOpacity)
+    if (Impl::updateColor (this->activeShaderIndex->values.color, c, withOpacity) == false)
+    {
+      return;
+    }
+    else if (withOpacity)
     {
       OpenGL::glUniformVec4 (this->activeShaderIndex->colorId, c.vec4 ());
     }
@@ -223,7 +495,12 @@ struct Renderer::Impl
   {
     assert (this->activeShaderIndex);
 
-    if (withOpacity)
+    if (Impl::updateColor (this->activeShaderIndex->values.wireframeColor, c, withOpacity) ==
+        false)
+    {
+      return;
+    }
+    else if (withOpacity)
     {
       OpenGL::glUniformVec4 (this->activeShaderIndex->wireframeColorId, c.vec4 ());
     }
@@ -233,24 +510,60 @@ struct Renderer::Impl
     }
   }
 
-  void setEyePoint (const glm::vec3& e) { this->globalUniforms.eyePoint = e; }
+  void setEyePoint (const glm::vec3& e)
+  {
+    if (this->globalUniforms.eyePoint != e)
+    {
+      this->globalUniforms.eyePoint = e;
+      this->globalUniformsVersion++;
+    }
+  }
 
   void setLightDirection (unsigned int i, const glm::vec3& d)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].direction = d;
+    this->globalUniformsVersion++;
   }
 
   void setLightColor (unsigned int i, const Color& c)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].color = c;
+    this->globalUniformsVersion++;
   }
 
   void setLightIrradiance (unsigned int i, float irr)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].irradiance = irr;
+    this->globalUniformsVersion++;
+  }
+
+  void setBrushRegion (const glm::vec3& center, float radius, float innerRadius,
+                       const glm::vec3& normal, const Color& color)
+  {
+    GlobalBrushRegionUniforms& region = this->globalUniforms.brushRegion;
+    const glm::vec4            value (center, radius);
+
+    if (region.region != value || region.normal != normal || region.innerRadius != innerRadius ||
+        region.color.vec3 () != color.vec3 ())
+    {
+      region.region = value;
+      region.normal = normal;
+      region.innerRadius = innerRadius;
+      region.color = color;
+      this->globalUniformsVersion++;
+    }
+  }
+
+  void resetBrushRegion ()
+  {
+    if (this->globalUniforms.brushRegion.region.w != 0.0f)
+    {
+      this->globalUniforms.brushRegion.region.w = 0.0f;
+      this->globalUniformsVersion++;
+    }
   }
 
   void runFromConfig (const Config& config)
@@ -273,7 +586,12 @@ DELEGATE1_BIG3 (Renderer, const Config&)
 
 DELEGATE (void, Renderer, setupRendering)
 DELEGATE (void, Renderer, shutdownRendering)
+DELEGATE1 (void, Renderer, beginGpuTimer, const char*)
+DELEGATE (void, Renderer, endGpuTimer)
+DELEGATE1_CONST (unsigned int, Renderer, shaderIndex, const RenderMode&)
 DELEGATE1 (void, Renderer, setProgram, const RenderMode&)
+DELEGATE5 (void, Renderer, recomputeNormals, unsigned int, unsigned int, unsigned int, unsigned int,
+           bool)
 DELEGATE2 (void, Renderer, setModel, const float*, const float*)
 DELEGATE1 (void, Renderer, setView, const float*)
 DELEGATE1 (void, Renderer, setProjection, const float*)
@@ -283,4 +601,7 @@ DELEGATE1 (void, Renderer, setEyePoint, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightDirection, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightColor, unsigned int, const Color&)
 DELEGATE2 (void, Renderer, setLightIrradiance, unsigned int, float)
+DELEGATE5 (void, Renderer, setBrushRegion, const glm::vec3&, float, float, const glm::vec3&,
+           const Color&)
+DELEGATE (void, Renderer, resetBrushRegion)
 DELEGATE1 (void, Renderer, runFromConfig, const Config&)
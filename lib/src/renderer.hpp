@@ -20,7 +20,23 @@ public:
 
   void setupRendering ();
   void shutdownRendering ();
+
+  /* measures the GPU time of the commands between both calls, which must not be nested, as a
+   * render pass of the given name (cf. `Profile::takeGpuTimes`)
+   */
+  void beginGpuTimer (const char*);
+  void endGpuTimer ();
+
+  // render items with equal shader indices share a program
+  unsigned int shaderIndex (const RenderMode&) const;
+
+  // redundant changes of programs and uniforms are skipped
   void setProgram (const RenderMode&);
+  /* recomputes the normals of a vertex buffer with a compute shader, given the buffer of the
+   * work, the number of vertices of the work, the stride of the vertices in 32 bit words and
+   * whether normals are packed (cf. `Shader::normalComputeShader`)
+   */
+  void recomputeNormals (unsigned int, unsigned int, unsigned int, unsigned int, bool);
   void setModel (const float*, const float*);
   void setView (const float*);
   void setProjection (const float*);
@@ -30,6 +46,12 @@ public:
   void setLightDirection (unsigned int, const glm::vec3&);
   void setLightColor (unsigned int, const Color&);
   void setLightIrradiance (unsigned int, float);
+  /* highlights the region of a brush in smooth, flat and matcap shading, given its center, its
+   * radius, the radius up to which it is fully highlighted, its normal and the highlight's color.
+   * Faces facing away from the normal are not highlighted.
+   */
+  void setBrushRegion (const glm::vec3&, float, float, const glm::vec3&, const Color&);
+  void resetBrushRegion ();
 
 private:
   IMPLEMENTATION
@@ -2,13 +2,35 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <list>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "hash.hpp"
 #include "import-export.hpp"
 #include "intersection.hpp"
+#include "mesh-instances.hpp"
+#include "maybe.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/plane.hpp"
+#include "primitive/ray.hpp"
 #include "render-mode.hpp"
+#include "renderer.hpp"
 #include "scene.hpp"
 #include "sketch/bone-intersection.hpp"
 #include "sketch/mesh-intersection.hpp"
@@ -17,22 +39,161 @@
 #include "sketch/path-intersection.hpp"
 #include "util.hpp"
 
+namespace
+{
+  // the shared mesh of a linked mesh is given by its id
+  struct LinkedMesh
+  {
+    unsigned int meshId;
+    glm::mat4x4  model;
+  };
+
+  /* The geometry of a loaded mesh, which shares the arrays of the mesh.  Vertex normals are
+   * averaged from the adjacent faces if the mesh has been loaded without normals.
+   */
+  Mesh preview (const Mesh& source)
+  {
+    Mesh preview (source);
+
+    for (unsigned int i = 0; i < source.numVertices (); i++)
+    {
+      if (source.normal (i) != glm::vec3 (0.0f))
+      {
+        return preview;
+      }
+    }
+
+    std::vector<glm::vec3> normals (source.numVertices (), glm::vec3 (0.0f));
+
+    for (unsigned int i = 0; i + 2 < source.numIndices (); i += 3)
+    {
+      const unsigned int i1 = source.index (i + 0);
+      const unsigned int i2 = source.index (i + 1);
+      const unsigned int i3 = source.index (i + 2);
+      const glm::vec3    n = glm::cross (source.vertex (i2) - source.vertex (i1),
+                                      source.vertex (i3) - source.vertex (i1));
+      normals[i1] += n;
+      normals[i2] += n;
+      normals[i3] += n;
+    }
+    for (unsigned int i = 0; i < source.numVertices (); i++)
+    {
+      const float length = glm::length (normals[i]);
+      preview.normal (i, length > Util::epsilon () ? normals[i] / length : glm::vec3 (0.0f));
+    }
+    return preview;
+  }
+
+  /* A loaded mesh that is rendered as its preview until it is constructed.  Constructions run on
+   * the thread pool, which is waited for before the mesh is destroyed.
+   */
+  struct DeferredMesh
+  {
+    Mesh              source;
+    DynamicMesh       mesh;
+    PrimAABox         bounds;
+    Mesh              preview;
+    bool              isConstructing;
+    ParallelTaskGroup construction;
+
+    DeferredMesh (const Mesh& m)
+      : source (m)
+      , bounds (m.bounds ())
+      , preview (::preview (m))
+      , isConstructing (false)
+    {
+    }
+  };
+
+  /* The occlusion query of a dynamic mesh.  Results are read in later frames, once they are
+   * available, so that rendering never waits for them.
+   */
+  struct OcclusionQuery
+  {
+    unsigned int id;
+    bool         isPending;
+    bool         isVisible;
+    bool         isUsed;
+
+    OcclusionQuery ()
+      : id (0)
+      , isPending (false)
+      , isVisible (true)
+      , isUsed (false)
+    {
+    }
+  };
+
+  // the mesh is configured beforehand and stays empty if the source is inconsistent
+  void construct (const Mesh& source, DynamicMesh& mesh)
+  {
+    if (MeshUtil::checkConsistency (source))
+    {
+      std::vector<glm::vec3>    vertices (source.numVertices ());
+      std::vector<unsigned int> indices (source.numIndices ());
+
+      for (unsigned int i = 0; i < source.numVertices (); i++)
+      {
+        vertices[i] = source.vertex (i);
+      }
+      for (unsigned int i = 0; i < source.numIndices (); i++)
+      {
+        indices[i] = source.index (i);
+      }
+      mesh.fromArrays (vertices, indices);
+      mesh.reorder (false);
+    }
+  }
+}
+
 struct Scene::Impl
 {
-  Scene*                 self;
-  std::list<DynamicMesh> dynamicMeshes;
-  std::list<SketchMesh>  sketchMeshes;
-  RenderMode             commonRenderMode;
-  std::string            fileName;
+  typedef std::unordered_map<unsigned int, const DynamicMesh*> MeshesById;
+  typedef std::vector<std::pair<unsigned int, const DynamicMesh*>> RenderQueue;
+
+  Scene*                                           self;
+  std::list<DynamicMesh>                           dynamicMeshes;
+  std::list<DynamicMesh>                           deletedDynamicMeshes;
+  std::list<SketchMesh>                            sketchMeshes;
+  std::vector<LinkedMesh>                          linkedMeshes;
+  std::list<DeferredMesh>                          deferredMeshes;
+  std::unordered_map<unsigned int, MeshInstances>  linkedInstances;
+  unsigned int                                     linkRevision;
+  RenderMode                                       commonRenderMode;
+  bool                                             renderLodProxies;
+  int                                              matcapNumFaces;
+  bool                                             isMatcapShading;
+  bool                                             occlusionCulling;
+  std::unordered_map<unsigned int, OcclusionQuery> occlusionQueries;
+  Mesh                                             occlusionBox;
+  int                                              compactNumFaces;
+  int                                              deferredNumFaces;
+  bool                                             compressFiles;
+  bool                                             storeMeshLayouts;
+  std::string                                      fileName;
+  Bvh                                              bvh;
+  std::vector<DynamicMesh*>                        bvhMeshes;
+  Maybe<PrimPlane>                                 clipPlane;
 
   Impl (Scene* s, const Config& config)
     : self (s)
+    , linkRevision (0)
+    , renderLodProxies (false)
+    , matcapNumFaces (0)
+    , isMatcapShading (false)
+    , occlusionCulling (false)
+    , compactNumFaces (0)
+    , deferredNumFaces (0)
+    , compressFiles (false)
+    , storeMeshLayouts (false)
   {
     this->runFromConfig (config);
 
     this->commonRenderMode.smoothShading (true);
   }
 
+  ~Impl () { this->resetOcclusionQueries (); }
+
   DynamicMesh& newDynamicMesh (const Config& config, const DynamicMesh& other)
   {
     this->dynamicMeshes.emplace_back (other);
@@ -40,6 +201,13 @@ struct Scene::Impl
     return this->dynamicMeshes.back ();
   }
 
+  DynamicMesh& newDynamicMesh (const Config& config, DynamicMesh&& other)
+  {
+    this->dynamicMeshes.emplace_back (std::move (other));
+    this->setupMesh (config, this->dynamicMeshes.back ());
+    return this->dynamicMeshes.back ();
+  }
+
   DynamicMesh& newDynamicMesh (const Config& config, const Mesh& mesh)
   {
     this->dynamicMeshes.emplace_back (mesh);
@@ -66,6 +234,7 @@ struct Scene::Impl
   {
     mesh.bufferData ();
     mesh.renderMode () = this->commonRenderMode;
+    mesh.clipPlane (this->clipPlane.get ());
     mesh.fromConfig (config);
   }
 
@@ -75,13 +244,299 @@ struct Scene::Impl
     mesh.fromConfig (config);
   }
 
+  // shared meshes are kept expanded since compact meshes are not rendered as instances
+  void linkMesh (DynamicMesh& mesh, const glm::mat4x4& model)
+  {
+    if (mesh.isCompact ())
+    {
+      mesh.expand ();
+    }
+    this->linkedMeshes.push_back (LinkedMesh{mesh.id (), model});
+    this->linkRevision++;
+  }
+
+  bool hasLinkedMeshes (unsigned int meshId) const
+  {
+    return std::any_of (this->linkedMeshes.begin (), this->linkedMeshes.end (),
+                        [meshId](const LinkedMesh& link) { return link.meshId == meshId; });
+  }
+
+  void deleteLinkedMeshes (unsigned int meshId)
+  {
+    if (this->hasLinkedMeshes (meshId))
+    {
+      this->linkedMeshes.erase (std::remove_if (this->linkedMeshes.begin (),
+                                                this->linkedMeshes.end (),
+                                                [meshId](const LinkedMesh& link) {
+                                                  return link.meshId == meshId;
+                                                }),
+                                this->linkedMeshes.end ());
+      this->linkRevision++;
+    }
+    this->linkedInstances.erase (meshId);
+  }
+
+  MeshesById meshesById () const
+  {
+    MeshesById meshes;
+    this->forEachConstMesh (
+      [&meshes](const DynamicMesh& mesh) { meshes.emplace (mesh.id (), &mesh); });
+    return meshes;
+  }
+
+  // the unique copy of a linked mesh is added to the scene
+  DynamicMesh& unlinkMesh (unsigned int i)
+  {
+    const LinkedMesh   link = this->linkedMeshes[i];
+    const DynamicMesh& shared = *this->meshesById ().at (link.meshId);
+
+    this->linkedMeshes.erase (this->linkedMeshes.begin () + i);
+    this->linkRevision++;
+
+    this->dynamicMeshes.emplace_back (shared);
+    DynamicMesh& mesh = this->dynamicMeshes.back ();
+
+    mesh.renderMode () = this->commonRenderMode;
+    mesh.transform (link.model);
+    return mesh;
+  }
+
+  bool defersMesh (const Mesh& mesh) const
+  {
+    return this->deferredNumFaces > 0 &&
+           mesh.numIndices () / 3 >= (unsigned int) this->deferredNumFaces;
+  }
+
+  void newDeferredMesh (const Config& config, const Mesh& mesh)
+  {
+    this->deferredMeshes.emplace_back (mesh);
+
+    DeferredMesh& deferred = this->deferredMeshes.back ();
+
+    deferred.mesh.fromConfig (config);
+    deferred.preview.color (deferred.mesh.color ());
+    deferred.preview.wireframeColor (deferred.mesh.wireframeColor ());
+    deferred.preview.renderMode () = this->commonRenderMode;
+    deferred.preview.bufferData ();
+  }
+
+  void startConstruction (DeferredMesh& deferred)
+  {
+    deferred.isConstructing = true;
+    deferred.construction.add ([&deferred]() { construct (deferred.source, deferred.mesh); });
+  }
+
+  // deferred meshes that have not been started yet are constructed on the calling thread
+  void addDeferredMesh (std::list<DeferredMesh>::iterator it)
+  {
+    if (it->isConstructing)
+    {
+      it->construction.wait ();
+    }
+    else
+    {
+      construct (it->source, it->mesh);
+    }
+    this->dynamicMeshes.emplace_back (std::move (it->mesh));
+    this->deferredMeshes.erase (it);
+
+    DynamicMesh& mesh = this->dynamicMeshes.back ();
+    if (mesh.isEmpty ())
+    {
+      DILAY_WARN ("could not load inconsistent mesh")
+      this->dynamicMeshes.pop_back ();
+    }
+    else
+    {
+      mesh.bufferData ();
+      mesh.renderMode () = this->commonRenderMode;
+
+      if (this->compactNumFaces > 0 && mesh.numFaces () >= (unsigned int) this->compactNumFaces)
+      {
+        mesh.compact ();
+      }
+    }
+  }
+
+  // meshes that are nearer to the camera are constructed first
+  bool updateDeferredMeshes (const Camera& camera)
+  {
+    unsigned int numConstructions = 0;
+
+    for (auto it = this->deferredMeshes.begin (); it != this->deferredMeshes.end ();)
+    {
+      auto next = std::next (it);
+      if (it->isConstructing)
+      {
+        if (it->construction.isReady ())
+        {
+          this->addDeferredMesh (it);
+        }
+        else
+        {
+          numConstructions++;
+        }
+      }
+      it = next;
+    }
+
+    while (numConstructions < Parallel::numThreads ())
+    {
+      DeferredMesh* nearest = nullptr;
+      float         minDistance = Util::maxFloat ();
+
+      for (DeferredMesh& deferred : this->deferredMeshes)
+      {
+        const float distance = glm::distance (camera.position (), deferred.bounds.center ());
+
+        if (deferred.isConstructing == false && distance < minDistance)
+        {
+          nearest = &deferred;
+          minDistance = distance;
+        }
+      }
+
+      if (nearest == nullptr)
+      {
+        break;
+      }
+      this->startConstruction (*nearest);
+      numConstructions++;
+    }
+    return this->deferredMeshes.empty () == false;
+  }
+
+  void loadDeferredMeshes ()
+  {
+    while (this->deferredMeshes.empty () == false)
+    {
+      this->addDeferredMesh (this->deferredMeshes.begin ());
+    }
+  }
+
+  void loadDeferredMeshes (const PrimRay& ray)
+  {
+    for (auto it = this->deferredMeshes.begin (); it != this->deferredMeshes.end ();)
+    {
+      auto  next = std::next (it);
+      float t;
+
+      if (IntersectionUtil::intersects (ray, it->bounds, &t))
+      {
+        this->addDeferredMesh (it);
+      }
+      it = next;
+    }
+  }
+
+  // meshes that track changes are kept until the history has recorded their changes
+  unsigned int splitComponents (const Config& config, DynamicMesh& mesh)
+  {
+    if (mesh.isCompact ())
+    {
+      mesh.expand ();
+    }
+
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> faceComponents;
+
+    indices.reserve (3 * mesh.numFaces ());
+    mesh.forEachFace ([&mesh, &indices](unsigned int f) {
+      unsigned int i1, i2, i3;
+      mesh.vertexIndices (f, i1, i2, i3);
+      indices.insert (indices.end (), {i1, i2, i3});
+    });
+
+    const unsigned int numComponents =
+      MeshUtil::components (indices, mesh.vertexCapacity (), faceComponents);
+
+    if (numComponents <= 1)
+    {
+      return numComponents;
+    }
+
+    // faces are sorted by their components, whose arrays are gathered in parallel
+    std::vector<unsigned int> componentBegin (numComponents + 1, 0);
+    std::vector<unsigned int> sortedFaces (faceComponents.size ());
+
+    for (unsigned int c : faceComponents)
+    {
+      componentBegin[c + 1]++;
+    }
+    std::partial_sum (componentBegin.begin (), componentBegin.end (), componentBegin.begin ());
+    {
+      std::vector<unsigned int> next (componentBegin.begin (), componentBegin.end () - 1);
+
+      for (unsigned int f = 0; f < faceComponents.size (); f++)
+      {
+        sortedFaces[next[faceComponents[f]]++] = f;
+      }
+    }
+
+    // each vertex belongs to a single component, so that components share the new indices
+    std::vector<unsigned int>              newIndices (mesh.vertexCapacity (),
+                                                       Util::invalidIndex ());
+    std::vector<std::vector<glm::vec3>>    vertices (numComponents);
+    std::vector<std::vector<glm::vec3>>    normals (numComponents);
+    std::vector<std::vector<unsigned int>> componentIndices (numComponents);
+
+    Parallel::forEach (numComponents, [&](unsigned int c) {
+      componentIndices[c].reserve (3 * (componentBegin[c + 1] - componentBegin[c]));
+
+      for (unsigned int k = componentBegin[c]; k < componentBegin[c + 1]; k++)
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          const unsigned int i = indices[(3 * sortedFaces[k]) + j];
+
+          if (newIndices[i] == Util::invalidIndex ())
+          {
+            newIndices[i] = vertices[c].size ();
+            vertices[c].push_back (mesh.vertex (i));
+            normals[c].push_back (mesh.vertexNormal (i));
+          }
+          componentIndices[c].push_back (newIndices[i]);
+        }
+      }
+    });
+
+    for (unsigned int c = 0; c < numComponents; c++)
+    {
+      DynamicMesh component;
+
+      component.fromArrays (vertices[c], normals[c], componentIndices[c]);
+      component.scaling (mesh.scaling ());
+      component.rotationMatrix (mesh.rotationMatrix ());
+      component.position (mesh.position ());
+
+      this->newDynamicMesh (config, std::move (component));
+    }
+    this->deleteMesh (mesh);
+    return numComponents;
+  }
+
+  void deleteMesh (std::list<DynamicMesh>::iterator it)
+  {
+    this->deleteLinkedMeshes (it->id ());
+
+    if (it->tracksChanges ())
+    {
+      this->deletedDynamicMeshes.splice (this->deletedDynamicMeshes.end (), this->dynamicMeshes,
+                                         it);
+    }
+    else
+    {
+      this->dynamicMeshes.erase (it);
+    }
+  }
+
   void deleteMesh (DynamicMesh& mesh)
   {
     for (auto it = this->dynamicMeshes.begin (); it != this->dynamicMeshes.end (); ++it)
     {
       if (&*it == &mesh)
       {
-        this->dynamicMeshes.erase (it);
+        this->deleteMesh (it);
         this->resetIfEmpty ();
         return;
       }
@@ -103,23 +558,247 @@ struct Scene::Impl
     DILAY_IMPOSSIBLE
   }
 
-  void deleteDynamicMeshes () { this->dynamicMeshes.clear (); }
+  void deleteDynamicMeshes ()
+  {
+    while (this->dynamicMeshes.empty () == false)
+    {
+      this->deleteMesh (this->dynamicMeshes.begin ());
+    }
+  }
 
   void deleteSketchMeshes () { this->sketchMeshes.clear (); }
 
   void deleteEmptyMeshes ()
   {
-    this->dynamicMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
+    for (auto it = this->dynamicMeshes.begin (); it != this->dynamicMeshes.end ();)
+    {
+      auto next = std::next (it);
+      if (it->isEmpty ())
+      {
+        this->deleteMesh (it);
+      }
+      it = next;
+    }
     this->sketchMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
     this->resetIfEmpty ();
   }
 
+  // dynamic meshes are sorted by program and color to skip redundant state changes
   void render (Camera& camera)
   {
-    this->forEachMesh ([&](DynamicMesh& m) { m.render (camera); });
+    RenderQueue queue;
+    queue.reserve (this->dynamicMeshes.size ());
+
+    this->forEachConstMesh ([&camera, &queue](const DynamicMesh& m) {
+      queue.emplace_back (camera.renderer ().shaderIndex (m.renderMode ()), &m);
+    });
+
+    // meshes are prepared concurrently, while draw calls are issued on the calling thread
+    Parallel::forEach (queue.size (), [&camera, &queue](unsigned int i) {
+      queue[i].second->prepareRendering (camera);
+    });
+
+    std::stable_sort (queue.begin (), queue.end (), [](const auto& a, const auto& b) {
+      const Color& c1 = a.second->color ();
+      const Color& c2 = b.second->color ();
+
+      return std::make_tuple (a.first, c1.r (), c1.g (), c1.b ()) <
+             std::make_tuple (b.first, c2.r (), c2.g (), c2.b ());
+    });
+
+    // queries are not shared between contexts
+    if (this->occlusionCulling && OpenGL::isSecondaryContext () == false)
+    {
+      this->renderOccluded (camera, queue);
+    }
+    else
+    {
+      for (const auto& item : queue)
+      {
+        item.second->render (camera, this->renderLodProxies);
+      }
+    }
+    this->renderLinkedMeshes (camera);
+
+    for (const DeferredMesh& deferred : this->deferredMeshes)
+    {
+      deferred.preview.render (camera);
+    }
     this->forEachMesh ([&](SketchMesh& m) { m.render (camera); });
   }
 
+  /* Meshes that were visible when their last query completed are rendered first and occlude
+   * the others, which are only tested by rendering their bounding boxes.  Each rendering is
+   * enclosed by a query, whose result decides if the mesh is rendered in the next frames.  Thus
+   * a mesh that becomes visible appears one or two frames late.
+   */
+  void renderOccluded (Camera& camera, const RenderQueue& queue)
+  {
+    std::vector<std::pair<const DynamicMesh*, OcclusionQuery*>> occluded;
+
+    for (auto& q : this->occlusionQueries)
+    {
+      q.second.isUsed = false;
+    }
+
+    for (const auto& item : queue)
+    {
+      const DynamicMesh& mesh = *item.second;
+      OcclusionQuery&    query = this->occlusionQueries[mesh.id ()];
+
+      this->readOcclusionQuery (query);
+      query.isUsed = true;
+
+      if (query.isVisible || Impl::containsEye (camera, mesh))
+      {
+        this->beginOcclusionQuery (query);
+        mesh.render (camera, this->renderLodProxies);
+        this->endOcclusionQuery (query);
+      }
+      else
+      {
+        occluded.emplace_back (&mesh, &query);
+      }
+    }
+
+    if (occluded.empty () == false)
+    {
+      if (this->occlusionBox.numIndices () == 0)
+      {
+        this->occlusionBox = MeshUtil::cube (0);
+        this->occlusionBox.renderMode ().constantShading (true);
+        this->occlusionBox.bufferData ();
+      }
+      OpenGL::glDepthMask (false);
+      OpenGL::glColorMask (false, false, false, false);
+      OpenGL::glDisable (OpenGL::CullFace ());
+
+      for (const auto& o : occluded)
+      {
+        const PrimAABox bounds = o.first->bounds ();
+
+        this->occlusionBox.rotationMatrix (
+          o.first->mesh ().modelMatrix () * glm::translate (glm::mat4x4 (1.0f), bounds.center ()) *
+          glm::scale (glm::mat4x4 (1.0f),
+                      glm::max (2.0f * bounds.halfWidth (), glm::vec3 (Util::epsilon ()))));
+
+        this->beginOcclusionQuery (*o.second);
+        this->occlusionBox.render (camera);
+        this->endOcclusionQuery (*o.second);
+      }
+      OpenGL::glEnable (OpenGL::CullFace ());
+      OpenGL::glColorMask (true, true, true, true);
+      OpenGL::glDepthMask (true);
+    }
+
+    for (auto it = this->occlusionQueries.begin (); it != this->occlusionQueries.end ();)
+    {
+      if (it->second.isUsed)
+      {
+        ++it;
+      }
+      else
+      {
+        OpenGL::safeDeleteQuery (it->second.id);
+        it = this->occlusionQueries.erase (it);
+      }
+    }
+  }
+
+  // near-plane clipping would hide the bounding box of a mesh that encloses the camera
+  static bool containsEye (const Camera& camera, const DynamicMesh& mesh)
+  {
+    const PrimAABox bounds = mesh.bounds ();
+    const glm::vec3 eye =
+      glm::vec3 (glm::inverse (mesh.mesh ().modelMatrix ()) * glm::vec4 (camera.position (), 1.0f));
+    const glm::vec3 margin = glm::vec3 (0.1f * glm::length (bounds.halfWidth ()));
+
+    return glm::all (glm::greaterThanEqual (eye, bounds.minimum () - margin)) &&
+           glm::all (glm::lessThanEqual (eye, bounds.maximum () + margin));
+  }
+
+  static void readOcclusionQuery (OcclusionQuery& query)
+  {
+    if (query.isPending)
+    {
+      unsigned int isAvailable = 0;
+      OpenGL::glGetQueryObjectuiv (query.id, OpenGL::QueryResultAvailable (), &isAvailable);
+
+      if (isAvailable)
+      {
+        unsigned int numSamples = 0;
+        OpenGL::glGetQueryObjectuiv (query.id, OpenGL::QueryResult (), &numSamples);
+
+        query.isVisible = numSamples > 0;
+        query.isPending = false;
+      }
+    }
+  }
+
+  // a query is only issued again once its result has been read
+  static void beginOcclusionQuery (OcclusionQuery& query)
+  {
+    if (query.isPending == false)
+    {
+      if (query.id == 0)
+      {
+        OpenGL::glGenQueries (1, &query.id);
+      }
+      OpenGL::glBeginQuery (OpenGL::SamplesPassed (), query.id);
+    }
+  }
+
+  static void endOcclusionQuery (OcclusionQuery& query)
+  {
+    if (query.isPending == false)
+    {
+      OpenGL::glEndQuery (OpenGL::SamplesPassed ());
+      query.isPending = true;
+    }
+  }
+
+  void resetOcclusionQueries ()
+  {
+    for (auto& q : this->occlusionQueries)
+    {
+      OpenGL::safeDeleteQuery (q.second.id);
+    }
+    this->occlusionQueries.clear ();
+  }
+
+  // linked meshes are rendered as instances of their shared meshes
+  void renderLinkedMeshes (Camera& camera)
+  {
+    const MeshesById meshes = this->meshesById ();
+
+    for (auto& instances : this->linkedInstances)
+    {
+      instances.second.reset ();
+    }
+    for (const LinkedMesh& link : this->linkedMeshes)
+    {
+      this->linkedInstances[link.meshId].add (link.model *
+                                              meshes.at (link.meshId)->mesh ().modelMatrix ());
+    }
+    for (auto& instances : this->linkedInstances)
+    {
+      meshes.at (instances.first)->mesh ().renderInstances (camera, instances.second);
+    }
+  }
+
+  std::size_t renderKey () const
+  {
+    std::size_t key = 0;
+
+    this->forEachConstMesh (
+      [&key](const DynamicMesh& m) { Hash::combine (key, m.renderKey ()); });
+    this->forEachConstMesh ([&key](const SketchMesh& m) { Hash::combine (key, m.renderKey ()); });
+    Hash::combine (key, this->linkRevision);
+    Hash::combine (key, this->deferredMeshes.size ());
+
+    return key;
+  }
+
   template <typename TMesh, typename TIntersection, typename... Ts>
   bool intersectsT (const PrimRay& ray, TIntersection& intersection, Ts... args)
   {
@@ -129,9 +808,93 @@ struct Scene::Impl
     return intersection.isIntersection ();
   }
 
+  /* The hierarchy over the bounds of the dynamic meshes is rebuilt when meshes are added or
+   * deleted, and refit otherwise.
+   */
+  void updateBvh ()
+  {
+    std::vector<DynamicMesh*> meshes;
+    meshes.reserve (this->dynamicMeshes.size ());
+
+    for (DynamicMesh& mesh : this->dynamicMeshes)
+    {
+      // the cached bounds of the meshes are computed before they are read in parallel
+      mesh.bounds ();
+      meshes.push_back (&mesh);
+    }
+
+    const auto getBounds = [this](unsigned int i) { return this->bvhMeshes[i]->bounds (); };
+
+    if (meshes == this->bvhMeshes)
+    {
+      this->bvh.refit (getBounds);
+    }
+    else
+    {
+      this->bvhMeshes = std::move (meshes);
+      this->bvh.build (this->bvhMeshes.size (), getBounds);
+    }
+  }
+
+  bool intersectsDynamicMeshes (const PrimRay& ray, DynamicMeshIntersection& intersection)
+  {
+    this->loadDeferredMeshes (ray);
+    this->updateBvh ();
+    this->bvh.intersects (ray, [this, &ray, &intersection](unsigned int i) {
+      return this->bvhMeshes[i]->intersects (ray, intersection) ? intersection.distance ()
+                                                                 : Util::maxFloat ();
+    });
+    return intersection.isIntersection ();
+  }
+
+  // rays are transformed into the space of the shared meshes, returns the nearest linked mesh
+  unsigned int intersectsLinkedMeshes (const PrimRay& ray, Intersection& intersection) const
+  {
+    const MeshesById meshes = this->meshesById ();
+    unsigned int     nearest = Util::invalidIndex ();
+
+    for (unsigned int i = 0; i < this->linkedMeshes.size (); i++)
+    {
+      const LinkedMesh& link = this->linkedMeshes[i];
+      const glm::mat4x4 inverse = glm::inverse (link.model);
+      const PrimRay     localRay (ray.isLine (), Util::transformPosition (inverse, ray.origin ()),
+                              Util::transformDirection (inverse, ray.direction ()));
+      Intersection      localIntersection;
+
+      if (meshes.at (link.meshId)->intersects (localRay, localIntersection))
+      {
+        const glm::vec3 position =
+          Util::transformPosition (link.model, localIntersection.position ());
+        const glm::vec3 normal = glm::normalize (glm::inverseTranspose (glm::mat3x3 (link.model)) *
+                                                 localIntersection.normal ());
+
+        if (intersection.update (glm::dot (position - ray.origin (), ray.direction ()), position,
+                                 normal))
+        {
+          nearest = i;
+        }
+      }
+    }
+    return nearest;
+  }
+
   bool intersects (const PrimRay& ray, DynamicMeshIntersection& intersection)
   {
-    return this->intersectsT<DynamicMesh> (ray, intersection);
+    Intersection       linkIntersection;
+    const unsigned int link = this->intersectsLinkedMeshes (ray, linkIntersection);
+
+    this->intersectsDynamicMeshes (ray, intersection);
+
+    if (link != Util::invalidIndex () &&
+        (intersection.isIntersection () == false ||
+         linkIntersection.distance () < intersection.distance ()))
+    {
+      DynamicMesh& mesh = this->unlinkMesh (link);
+
+      intersection.reset ();
+      mesh.intersects (ray, intersection);
+    }
+    return intersection.isIntersection ();
   }
 
   bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
@@ -166,11 +929,13 @@ struct Scene::Impl
     DynamicMeshIntersection dIntersection;
     SketchMeshIntersection  sIntersection;
 
-    if (this->intersects (ray, dIntersection))
+    if (this->intersectsDynamicMeshes (ray, dIntersection))
     {
       intersection.update (dIntersection.distance (), dIntersection.position (),
                            dIntersection.normal ());
     }
+    this->intersectsLinkedMeshes (ray, intersection);
+
     if (this->intersects (ray, sIntersection))
     {
       intersection.update (sIntersection.distance (), sIntersection.position (),
@@ -203,6 +968,20 @@ struct Scene::Impl
     }
   }
 
+  // meshes are processed concurrently, hence `f` must only touch the given mesh
+  template <typename T>
+  void forEachMeshParallelT (std::list<T>& list, const std::function<void(T&)>& f)
+  {
+    std::vector<T*> meshes;
+    meshes.reserve (list.size ());
+
+    for (T& mesh : list)
+    {
+      meshes.push_back (&mesh);
+    }
+    Parallel::forEach (meshes.size (), [&meshes, &f](unsigned int i) { f (*meshes[i]); });
+  }
+
   template <typename T>
   void forEachConstMeshT (const std::list<T>& list, const std::function<void(const T&)>& f) const
   {
@@ -233,6 +1012,11 @@ struct Scene::Impl
     this->forEachMeshT<SketchMesh> (this->sketchMeshes, f);
   }
 
+  void forEachMeshParallel (const std::function<void(DynamicMesh&)>& f)
+  {
+    this->forEachMeshParallelT<DynamicMesh> (this->dynamicMeshes, f);
+  }
+
   void forEachConstMesh (const std::function<void(const DynamicMesh&)>& f) const
   {
     this->forEachConstMeshT<DynamicMesh> (this->dynamicMeshes, f);
@@ -243,14 +1027,54 @@ struct Scene::Impl
     this->forEachConstMeshT<SketchMesh> (this->sketchMeshes, f);
   }
 
+  void forEachDeletedMesh (const std::function<void(DynamicMesh&)>& f)
+  {
+    this->forEachMeshT<DynamicMesh> (this->deletedDynamicMeshes, f);
+  }
+
+  void forEachConstDeletedMesh (const std::function<void(const DynamicMesh&)>& f) const
+  {
+    this->forEachConstMeshT<DynamicMesh> (this->deletedDynamicMeshes, f);
+  }
+
+  void forEachConstLinkedMesh (
+    const std::function<void(const DynamicMesh&, const glm::mat4x4&)>& f) const
+  {
+    const MeshesById meshes = this->meshesById ();
+
+    for (const LinkedMesh& link : this->linkedMeshes)
+    {
+      f (*meshes.at (link.meshId), link.model);
+    }
+  }
+
+  void clearDeletedMeshes () { this->deletedDynamicMeshes.clear (); }
+
   void sanitizeMeshes ()
   {
-    this->forEachMesh ([](DynamicMesh& mesh) { mesh.sanitize (); });
+    this->forEachMeshParallel ([](DynamicMesh& mesh) { mesh.sanitize (); });
+  }
+
+  void releaseCaches ()
+  {
+    this->forEachMesh ([](DynamicMesh& mesh) { mesh.releaseCaches (); });
+    this->forEachDeletedMesh ([](DynamicMesh& mesh) { mesh.releaseCaches (); });
+  }
+
+  void releaseStagingBuffers ()
+  {
+    this->forEachMesh ([](DynamicMesh& mesh) { mesh.releaseStagingBuffers (); });
+    this->forEachDeletedMesh ([](DynamicMesh& mesh) { mesh.releaseStagingBuffers (); });
   }
 
   void reset ()
   {
-    this->deleteDynamicMeshes ();
+    this->dynamicMeshes.clear ();
+    this->deletedDynamicMeshes.clear ();
+    this->linkedMeshes.clear ();
+    this->linkedInstances.clear ();
+    this->deferredMeshes.clear ();
+    this->linkRevision++;
     this->deleteSketchMeshes ();
     this->fileName.clear ();
   }
@@ -259,18 +1083,68 @@ struct Scene::Impl
   {
     if (this->isEmpty ())
     {
-      this->reset ();
+      this->fileName.clear ();
     }
   }
 
   void setCommonRenderMode (const RenderMode& mode)
   {
     this->commonRenderMode = mode;
-    this->forEachMesh ([this](DynamicMesh& mesh) { mesh.renderMode () = this->commonRenderMode; });
+    this->isMatcapShading = false;
+    this->applyRenderMode (mode);
     this->forEachMesh (
       [&mode](SketchMesh& mesh) { mesh.renderWireframe (mode.renderWireframe ()); });
   }
 
+  void applyRenderMode (const RenderMode& mode)
+  {
+    this->forEachMesh ([&mode](DynamicMesh& mesh) { mesh.renderMode () = mode; });
+    for (DeferredMesh& deferred : this->deferredMeshes)
+    {
+      deferred.preview.renderMode () = mode;
+    }
+  }
+
+  // dynamic meshes of heavy scenes are shaded by matcaps while the camera moves
+  void setRenderLodProxies (bool value)
+  {
+    this->renderLodProxies = value;
+
+    const bool matcap = value && this->matcapNumFaces > 0 &&
+                        this->numFaces () >= (unsigned int) this->matcapNumFaces;
+
+    if (matcap != this->isMatcapShading)
+    {
+      RenderMode mode (this->commonRenderMode);
+
+      if (matcap)
+      {
+        mode.matcapShading (true);
+      }
+      this->applyRenderMode (mode);
+      this->isMatcapShading = matcap;
+    }
+  }
+
+  void setClipPlane (const PrimPlane& plane)
+  {
+    this->clipPlane = plane;
+    this->applyClipPlane ();
+  }
+
+  void resetClipPlane ()
+  {
+    this->clipPlane.reset ();
+    this->applyClipPlane ();
+  }
+
+  bool isClipping () const { return bool(this->clipPlane); }
+
+  void applyClipPlane ()
+  {
+    this->forEachMesh ([this](DynamicMesh& mesh) { mesh.clipPlane (this->clipPlane.get ()); });
+  }
+
   bool renderWireframe () const { return this->commonRenderMode.renderWireframe (); }
 
   void renderWireframe (bool value)
@@ -294,12 +1168,20 @@ struct Scene::Impl
     this->setCommonRenderMode (this->commonRenderMode);
   }
 
-  bool isEmpty () const { return this->numDynamicMeshes () == 0 && this->numSketchMeshes () == 0; }
+  bool isEmpty () const
+  {
+    return this->numDynamicMeshes () == 0 && this->numSketchMeshes () == 0 &&
+           this->numDeferredMeshes () == 0;
+  }
 
   unsigned int numDynamicMeshes () const { return this->dynamicMeshes.size (); }
 
   unsigned int numSketchMeshes () const { return this->sketchMeshes.size (); }
 
+  unsigned int numLinkedMeshes () const { return this->linkedMeshes.size (); }
+
+  unsigned int numDeferredMeshes () const { return this->deferredMeshes.size (); }
+
   unsigned int numFaces () const
   {
     unsigned int n = 0;
@@ -307,12 +1189,41 @@ struct Scene::Impl
     return n;
   }
 
+  // deleted meshes are kept for the history, hence they are counted as well
+  std::size_t numBytes () const
+  {
+    std::size_t n = this->bvh.numBytes () + (this->bvhMeshes.capacity () * sizeof (DynamicMesh*)) +
+                    (this->linkedMeshes.capacity () * sizeof (LinkedMesh));
+
+    this->forEachConstMesh ([&n](const DynamicMesh& mesh) { n += mesh.numBytes (); });
+    this->forEachConstDeletedMesh ([&n](const DynamicMesh& mesh) { n += mesh.numBytes (); });
+    this->forEachConstMesh ([&n](const SketchMesh& mesh) { n += mesh.numBytes (); });
+
+    for (const DeferredMesh& deferred : this->deferredMeshes)
+    {
+      n += deferred.source.numBytes () + deferred.preview.numBytes ();
+    }
+    return n;
+  }
+
+  std::size_t numBufferBytes () const
+  {
+    std::size_t n = 0;
+
+    this->forEachConstMesh ([&n](const DynamicMesh& mesh) { n += mesh.numBufferBytes (); });
+    this->forEachConstDeletedMesh ([&n](const DynamicMesh& mesh) { n += mesh.numBufferBytes (); });
+    this->forEachConstMesh ([&n](const SketchMesh& mesh) { n += mesh.numBufferBytes (); });
+    return n;
+  }
+
   bool hasFileName () const { return !this->fileName.empty (); }
 
   bool toDlyFile (bool isObjFile)
   {
     assert (this->hasFileName ());
 
+    this->loadDeferredMeshes ();
+
     return Util::withCLocale<bool> ([this, isObjFile]() {
       if (ImportExport::toDlyFile (this->fileName, *this->self, isObjFile))
       {
@@ -332,12 +1243,29 @@ struct Scene::Impl
     return this->toDlyFile (isObjFile);
   }
 
+  // large meshes of loaded files are kept compact until they are edited
+  void compactMeshes ()
+  {
+    if (this->compactNumFaces > 0)
+    {
+      this->forEachMesh ([this](DynamicMesh& mesh) {
+        if (mesh.isCompact () == false &&
+            mesh.numFaces () >= (unsigned int) this->compactNumFaces &&
+            this->hasLinkedMeshes (mesh.id ()) == false)
+        {
+          mesh.compact ();
+        }
+      });
+    }
+  }
+
   bool fromDlyFile (const Config& config, const std::string& newFileName)
   {
     this->fileName = newFileName;
 
     if (ImportExport::fromDlyFile (this->fileName, config, *this->self))
     {
+      this->compactMeshes ();
       return true;
     }
     else
@@ -349,7 +1277,19 @@ struct Scene::Impl
 
   void runFromConfig (const Config& config)
   {
-    this->forEachMesh ([&config](DynamicMesh& mesh) { mesh.fromConfig (config); });
+    this->compactNumFaces = config.get<int> ("editor/mesh/compact-num-faces");
+    this->deferredNumFaces = config.get<int> ("editor/mesh/deferred-num-faces");
+    this->matcapNumFaces = config.get<int> ("editor/mesh/matcap-num-faces");
+    this->occlusionCulling = config.get<bool> ("editor/occlusion-culling");
+    this->compressFiles = config.get<bool> ("editor/compress-files");
+    this->storeMeshLayouts = config.get<bool> ("editor/store-mesh-layouts");
+
+    if (this->occlusionCulling == false)
+    {
+      this->resetOcclusionQueries ();
+    }
+
+    this->forEachMeshParallel ([&config](DynamicMesh& mesh) { mesh.fromConfig (config); });
     this->forEachMesh ([&config](SketchMesh& mesh) { mesh.fromConfig (config); });
   }
 };
@@ -357,17 +1297,25 @@ struct Scene::Impl
 DELEGATE1_BIG3_SELF (Scene, const Config&)
 
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const DynamicMesh&)
+DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, DynamicMesh&&)
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const Mesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchMesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchTree&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, DynamicMesh&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, SketchMesh&)
+DELEGATE2 (void, Scene, linkMesh, DynamicMesh&, const glm::mat4x4&)
+DELEGATE1_CONST (bool, Scene, defersMesh, const Mesh&)
+DELEGATE2 (void, Scene, newDeferredMesh, const Config&, const Mesh&)
+DELEGATE1 (bool, Scene, updateDeferredMeshes, const Camera&)
+DELEGATE (void, Scene, loadDeferredMeshes)
+DELEGATE2 (unsigned int, Scene, splitComponents, const Config&, DynamicMesh&)
 DELEGATE1 (void, Scene, deleteMesh, DynamicMesh&)
 DELEGATE1 (void, Scene, deleteMesh, SketchMesh&)
 DELEGATE (void, Scene, deleteDynamicMeshes)
 DELEGATE (void, Scene, deleteSketchMeshes)
 DELEGATE (void, Scene, deleteEmptyMeshes)
 DELEGATE1 (void, Scene, render, Camera&)
+DELEGATE_CONST (std::size_t, Scene, renderKey)
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, DynamicMeshIntersection&)
 DELEGATE3 (bool, Scene, intersects, const PrimRay&, SketchNodeIntersection&, const SketchNode*)
 DELEGATE2 (bool, Scene, intersects, const PrimRay&, SketchBoneIntersection&)
@@ -378,11 +1326,23 @@ DELEGATE2 (bool, Scene, intersects, const PrimRay&, Intersection&)
 DELEGATE_CONST (void, Scene, printStatistics)
 DELEGATE1 (void, Scene, forEachMesh, const std::function<void(DynamicMesh&)>&)
 DELEGATE1 (void, Scene, forEachMesh, const std::function<void(SketchMesh&)>&)
+DELEGATE1 (void, Scene, forEachMeshParallel, const std::function<void(DynamicMesh&)>&)
 DELEGATE1_CONST (void, Scene, forEachConstMesh, const std::function<void(const DynamicMesh&)>&)
 DELEGATE1_CONST (void, Scene, forEachConstMesh, const std::function<void(const SketchMesh&)>&)
+DELEGATE1 (void, Scene, forEachDeletedMesh, const std::function<void(DynamicMesh&)>&)
+DELEGATE1_CONST (void, Scene, forEachConstDeletedMesh,
+                 const std::function<void(const DynamicMesh&)>&)
+DELEGATE1_CONST (void, Scene, forEachConstLinkedMesh,
+                 const std::function<void(const DynamicMesh&, const glm::mat4x4&)>&)
+DELEGATE (void, Scene, clearDeletedMeshes)
 DELEGATE (void, Scene, sanitizeMeshes)
+DELEGATE (void, Scene, releaseCaches)
+DELEGATE (void, Scene, releaseStagingBuffers)
 DELEGATE (void, Scene, reset)
 GETTER_CONST (const RenderMode&, Scene, commonRenderMode)
+GETTER_CONST (bool, Scene, renderLodProxies)
+DELEGATE (void, Scene, resetClipPlane)
+DELEGATE_CONST (bool, Scene, isClipping)
 DELEGATE_CONST (bool, Scene, renderWireframe)
 DELEGATE1 (void, Scene, renderWireframe, bool)
 DELEGATE (void, Scene, toggleWireframe)
@@ -390,10 +1350,21 @@ DELEGATE (void, Scene, toggleShading)
 DELEGATE_CONST (bool, Scene, isEmpty)
 DELEGATE_CONST (unsigned int, Scene, numDynamicMeshes)
 DELEGATE_CONST (unsigned int, Scene, numSketchMeshes)
+DELEGATE_CONST (unsigned int, Scene, numLinkedMeshes)
+DELEGATE_CONST (unsigned int, Scene, numDeferredMeshes)
 DELEGATE_CONST (unsigned int, Scene, numFaces)
+DELEGATE_CONST (std::size_t, Scene, numBytes)
+DELEGATE_CONST (std::size_t, Scene, numBufferBytes)
 DELEGATE_CONST (bool, Scene, hasFileName)
 GETTER_CONST (const std::string&, Scene, fileName)
+GETTER_CONST (bool, Scene, compressFiles)
+GETTER_CONST (bool, Scene, storeMeshLayouts)
+SETTER (const std::string&, Scene, fileName)
 DELEGATE1 (bool, Scene, toDlyFile, bool)
 DELEGATE2 (bool, Scene, toDlyFile, const std::string&, bool)
 DELEGATE2 (bool, Scene, fromDlyFile, const Config&, const std::string&)
 DELEGATE1 (void, Scene, runFromConfig, const Config&)
+
+void Scene::renderLodProxies (bool value) { this->impl->setRenderLodProxies (value); }
+
+void Scene::clipPlane (const PrimPlane& plane) { this->impl->setClipPlane (plane); }
@@ -5,6 +5,7 @@
 #ifndef DILAY_SCENE
 #define DILAY_SCENE
 
+#include <glm/fwd.hpp>
 #include <string>
 #include "configurable.hpp"
 #include "macro.hpp"
@@ -15,6 +16,7 @@ class DynamicMesh;
 class DynamicMeshIntersection;
 class Intersection;
 class Mesh;
+class PrimPlane;
 class PrimRay;
 class RenderMode;
 
@@ -24,17 +26,40 @@ public:
   DECLARE_BIG3 (Scene, const Config&)
 
   DynamicMesh& newDynamicMesh (const Config&, const DynamicMesh&);
+  DynamicMesh& newDynamicMesh (const Config&, DynamicMesh&&);
   DynamicMesh& newDynamicMesh (const Config&, const Mesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchMesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchTree&);
   void         setupMesh (const Config&, DynamicMesh&);
   void         setupMesh (const Config&, SketchMesh&);
+  /* A linked mesh shares the geometry of a dynamic mesh and is transformed by its own model
+   * matrix.  Linked meshes are rendered as instances and are intersected without being copied.
+   * Intersecting a `DynamicMeshIntersection` converts the nearest linked mesh into a unique copy,
+   * which can be edited.  Linked meshes are deleted along with their shared mesh.
+   */
+  void         linkMesh (DynamicMesh&, const glm::mat4x4&);
+  /* Loaded meshes with at least `editor/mesh/deferred-num-faces` faces are deferred: their
+   * geometry is rendered as soon as they have been parsed, while their octrees and adjacencies
+   * are constructed in the background.  Deferred meshes that are hit by a ray are waited for
+   * when intersecting, i.e., tools wait for the meshes they act on.
+   */
+  bool         defersMesh (const Mesh&) const;
+  void         newDeferredMesh (const Config&, const Mesh&);
+  // adds constructed meshes and returns whether there are deferred meshes left
+  bool         updateDeferredMeshes (const Camera&);
+  // waits until all deferred meshes are added
+  void         loadDeferredMeshes ();
+  /* Replaces a mesh by one mesh per connected component, which are constructed in bulk, and
+   * returns the number of components.  Connected meshes are kept.
+   */
+  unsigned int splitComponents (const Config&, DynamicMesh&);
   void         deleteMesh (DynamicMesh&);
   void         deleteMesh (SketchMesh&);
   void         deleteDynamicMeshes ();
   void         deleteSketchMeshes ();
   void         deleteEmptyMeshes ();
   void         render (Camera&);
+  std::size_t  renderKey () const;
   bool         intersects (const PrimRay&, DynamicMeshIntersection&);
   bool         intersects (const PrimRay&, SketchNodeIntersection&, const SketchNode* = nullptr);
   bool         intersects (const PrimRay&, SketchBoneIntersection&);
@@ -45,11 +70,28 @@ public:
   void         printStatistics () const;
   void         forEachMesh (const std::function<void(DynamicMesh&)>&);
   void         forEachMesh (const std::function<void(SketchMesh&)>&);
+  // processes meshes concurrently, i.e., the function must only touch the given mesh
+  void         forEachMeshParallel (const std::function<void(DynamicMesh&)>&);
   void         forEachConstMesh (const std::function<void(const DynamicMesh&)>&) const;
   void         forEachConstMesh (const std::function<void(const SketchMesh&)>&) const;
+  void         forEachDeletedMesh (const std::function<void(DynamicMesh&)>&);
+  void         forEachConstDeletedMesh (const std::function<void(const DynamicMesh&)>&) const;
+  void         forEachConstLinkedMesh (
+    const std::function<void(const DynamicMesh&, const glm::mat4x4&)>&) const;
+  void         clearDeletedMeshes ();
   void         sanitizeMeshes ();
+  // cf. `DynamicMesh::releaseCaches`, e.g., if the system runs low on memory
+  void         releaseCaches ();
+  void         releaseStagingBuffers ();
   void         reset ();
   const RenderMode&  commonRenderMode () const;
+  bool               renderLodProxies () const;
+  // also shades heavy scenes by matcaps (see `editor/mesh/matcap-num-faces`)
+  void               renderLodProxies (bool);
+  // clips all dynamic meshes by a plane (cf. `DynamicMesh::clipPlane`), e.g., to look into them
+  void               clipPlane (const PrimPlane&);
+  void               resetClipPlane ();
+  bool               isClipping () const;
   bool               renderWireframe () const;
   void               renderWireframe (bool);
   void               toggleWireframe ();
@@ -57,9 +99,18 @@ public:
   bool               isEmpty () const;
   unsigned int       numDynamicMeshes () const;
   unsigned int       numSketchMeshes () const;
+  unsigned int       numLinkedMeshes () const;
+  unsigned int       numDeferredMeshes () const;
   unsigned int       numFaces () const;
+  std::size_t        numBytes () const;
+  std::size_t        numBufferBytes () const;
   bool               hasFileName () const;
   const std::string& fileName () const;
+  void               fileName (const std::string&);
+  // meshes of binary files are compressed if `editor/compress-files` is set
+  bool               compressFiles () const;
+  // binary files store the adjacency and octree of meshes if `editor/store-mesh-layouts` is set
+  bool               storeMeshLayouts () const;
   bool               toDlyFile (bool);
   bool               toDlyFile (const std::string&, bool);
   bool               fromDlyFile (const Config&, const std::string&);
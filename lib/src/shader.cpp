@@ -4,15 +4,67 @@
  */
 #include "shader.hpp"
 
-#define SMOOTH_VERTEX_SHADER                                                                   \
+// instanced shaders specify model matrices per instance
+#define UNIFORM_MODEL                                                                          \
+  "uniform   mat4  model;                                                                  \n"
+
+#define UNIFORM_MODEL_NORMAL                                                                   \
+  "uniform   mat3  modelNormal;                                                            \n"
+
+#define ATTRIBUTE_MODEL                                                                        \
+  "attribute mat4  model;                                                                  \n"
+
+#define ATTRIBUTE_MODEL_NORMAL                                                                 \
+  "attribute mat3  modelNormal;                                                            \n"
+
+#define FLOAT_NORMAL                                                                           \
+  "attribute vec3  normal;                                                                 \n" \
+  "                                                                                        \n" \
+  "vec3 vertexNormal () { return normal; }                                                 \n" \
+  "                                                                                        \n"
+
+// compact meshes store normals as octahedral coordinates
+#define OCTAHEDRAL_NORMAL                                                                      \
+  "attribute vec2  normal;                                                                 \n" \
+  "                                                                                        \n" \
+  "vec3 vertexNormal () {                                                                  \n" \
+  "  vec3 n = vec3 (normal, 1.0 - abs (normal.x) - abs (normal.y));                        \n" \
+  "  if (n.z < 0.0) {                                                                      \n" \
+  "    n.xy = (1.0 - abs (n.yx)) * vec2 (n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);\n" \
+  "  }                                                                                     \n" \
+  "  return n;                                                                             \n" \
+  "}                                                                                       \n" \
+  "                                                                                        \n"
+
+/* Tints the region of a brush (cf. `Renderer::setBrushRegion`), which fades out linearly between
+ * its inner radius and its radius.  Points whose normals face away from the brush's normal are
+ * not tinted.
+ */
+#define BRUSH_REGION                                                                           \
+  "uniform vec4  brushRegion;                                                              \n" \
+  "uniform vec3  brushNormal;                                                              \n" \
+  "uniform float brushInnerRadius;                                                         \n" \
+  "uniform vec3  brushColor;                                                               \n" \
+  "                                                                                        \n" \
+  "vec3 brushTint (vec3 p, vec3 n) {                                                       \n" \
+  "  float d = distance (p, brushRegion.xyz);                                              \n" \
+  "  if (d >= brushRegion.w || dot (n, brushNormal) <= 0.0) {                              \n" \
+  "    return vec3 (1.0);                                                                  \n" \
+  "  }                                                                                     \n" \
+  "  float w = (brushRegion.w - d) / max (brushRegion.w - brushInnerRadius, 1.0e-6);       \n" \
+  "  return mix (vec3 (1.0), brushColor, clamp (w, 0.0, 1.0));                             \n" \
+  "}                                                                                       \n" \
+  "                                                                                        \n"
+
+#define SMOOTH_VERTEX_SHADER(MODEL, MODEL_NORMAL, NORMAL)                                      \
   "#version 120                                                                            \n" \
   "                                                                                        \n" \
-  "uniform   mat4  model;                                                                  \n" \
-  "uniform   mat3  modelNormal;                                                            \n" \
+  MODEL                                                                                        \
+  MODEL_NORMAL                                                                                 \
   "uniform   mat4  view;                                                                   \n" \
   "uniform   mat4  projection;                                                             \n" \
   "attribute vec3  position;                                                               \n" \
-  "attribute vec3  normal;                                                                 \n" \
+  NORMAL                                                                                       \
   "uniform   vec3  color;                                                                  \n" \
   "uniform   vec3  light1Direction;                                                        \n" \
   "uniform   vec3  light1Color;                                                            \n" \
@@ -21,16 +73,19 @@
   "uniform   vec3  light2Color;                                                            \n" \
   "uniform   float light2Irradiance;                                                       \n" \
   "                                                                                        \n" \
+  BRUSH_REGION                                                                               \
   "varying vec3 vsColor;                                                                   \n" \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
-  "  gl_Position      = (projection * view * model) * vec4 (position, 1.0);                \n" \
-  "  vec3  viewNormal = vec3 (view * vec4 (normalize (modelNormal * normal), 0.0));        \n" \
+  "  vec4  worldPos   = model * vec4 (position, 1.0);                                      \n" \
+  "  vec3  wNormal    = normalize (modelNormal * vertexNormal ());                         \n" \
+  "  gl_Position      = (projection * view) * worldPos;                                    \n" \
+  "  vec3  viewNormal = vec3 (view * vec4 (wNormal, 0.0));                                 \n" \
   "  float light1Diff = max (0.0, dot (-light1Direction, viewNormal));                     \n" \
   "  float light2Diff = max (0.0, dot (-light2Direction, viewNormal));                     \n" \
   "  vec3  light1     = light1Irradiance * light1Color * light1Diff;                       \n" \
   "  vec3  light2     = light2Irradiance * light2Color * light2Diff;                       \n" \
-  "        vsColor    = color * (light1 + light2);                                         \n" \
+  "        vsColor    = color * (light1 + light2) * brushTint (worldPos.xyz, wNormal);     \n" \
   "}                                                                                       \n"
 
 #define SMOOTH_FRAGMENT_SHADER(COLOR, FINAL)                                                   \
@@ -46,10 +101,10 @@
   ", 1.0);                                                 \n" FINAL                           \
   "}                                                                                       \n"
 
-#define FLAT_VERTEX_SHADER                                                                     \
+#define FLAT_VERTEX_SHADER(MODEL)                                                              \
   "#version 120                                                                            \n" \
   "                                                                                        \n" \
-  "uniform   mat4 model;                                                                   \n" \
+  MODEL                                                                                        \
   "uniform   mat4 view;                                                                    \n" \
   "uniform   mat4 projection;                                                              \n" \
   "attribute vec3 position;                                                                \n" \
@@ -74,6 +129,7 @@
   "uniform vec3  light2Color;                                                              \n" \
   "uniform float light2Irradiance;                                                         \n" \
   "                                                                                        \n" \
+  BRUSH_REGION                                                                               \
   "varying vec3 " COLOR ";                                                                 \n" \
   "varying vec3 barycentric;                                                               \n" \
   "                                                                                        \n" \
@@ -86,14 +142,15 @@
   "  vec3  light1     = light1Irradiance * light1Color * vec3 (light1Diff);                \n" \
   "  vec3  light2     = light2Irradiance * light2Color * vec3 (light2Diff);                \n" \
   "                                                                                        \n" \
-  "  gl_FragColor     = vec4 (color * (light1 + light2), 1.0);                             "   \
+  "  vec3  tint       = brushTint (" COLOR ", normal);                                     \n" \
+  "  gl_FragColor     = vec4 (color * (light1 + light2) * tint, 1.0);                      "   \
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
-#define CONSTANT_VERTEX_SHADER                                                                 \
+#define CONSTANT_VERTEX_SHADER(MODEL)                                                          \
   "#version 120                                                                            \n" \
   "                                                                                        \n" \
-  "uniform   mat4 model;                                                                   \n" \
+  MODEL                                                                                        \
   "uniform   mat4 view;                                                                    \n" \
   "uniform   mat4 projection;                                                              \n" \
   "attribute vec3 position;                                                                \n" \
@@ -115,6 +172,33 @@
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
+/* Shades by a fixed function of the normal in view space, like a lookup into a material
+ * capture, which ignores the lights of the scene.  This is cheaper than smooth shading on dense
+ * meshes, whose costs are dominated by their vertices.
+ */
+#define MATCAP_VERTEX_SHADER(MODEL, MODEL_NORMAL, NORMAL)                                      \
+  "#version 120                                                                            \n" \
+  "                                                                                        \n" \
+  MODEL                                                                                        \
+  MODEL_NORMAL                                                                                 \
+  "uniform   mat4  view;                                                                   \n" \
+  "uniform   mat4  projection;                                                             \n" \
+  "attribute vec3  position;                                                               \n" \
+  NORMAL                                                                                       \
+  "uniform   vec3  color;                                                                  \n" \
+  "                                                                                        \n" \
+  BRUSH_REGION                                                                               \
+  "varying vec3 vsColor;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main () {                                                                          \n" \
+  "  vec4  worldPos   = model * vec4 (position, 1.0);                                      \n" \
+  "  vec3  wNormal    = normalize (modelNormal * vertexNormal ());                         \n" \
+  "  gl_Position      = (projection * view) * worldPos;                                    \n" \
+  "  vec3  viewNormal = vec3 (view * vec4 (wNormal, 0.0));                                 \n" \
+  "  float shade      = 0.25 + (0.65 * max (0.0, viewNormal.z)) + (0.1 * viewNormal.y);    \n" \
+  "        vsColor    = color * shade * brushTint (worldPos.xyz, wNormal);                 \n" \
+  "}                                                                                       \n"
+
 #define ADD_WIREFRAME                                                                          \
   "vec3 barycDelta = fwidth (barycentric);                                                 \n" \
   "                                                                                        \n" \
@@ -149,7 +233,109 @@
   "    EndPrimitive();                                                                     \n" \
   "}                                                                                       \n"
 
-const char* Shader::smoothVertexShader () { return SMOOTH_VERTEX_SHADER; }
+#define CORE_GEOMETRY_SHADER                                                                   \
+  "#version 410 core                                                                       \n" \
+  "                                                                                        \n" \
+  "layout (triangles) in;                                                                  \n" \
+  "layout (triangle_strip, max_vertices = 3) out;                                          \n" \
+  "                                                                                        \n" \
+  "in  vec3 vsColor[];                                                                     \n" \
+  "out vec3 gsColor;                                                                       \n" \
+  "out vec3 barycentric;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main() {                                                                           \n" \
+  "    gl_Position = gl_in[0].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[0];                                                           \n" \
+  "    barycentric = vec3 (1.0,0.0,0.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    gl_Position = gl_in[1].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[1];                                                           \n" \
+  "    barycentric = vec3 (0.0,1.0,0.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    gl_Position = gl_in[2].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[2];                                                           \n" \
+  "    barycentric = vec3 (0.0,0.0,1.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    EndPrimitive();                                                                     \n" \
+  "}                                                                                       \n"
+
+/* Recomputes the normals of vertices from the positions of their adjacent faces.  The work lists
+ * the vertex, the offset of the indices of its faces and the number of its faces for each
+ * vertex, followed by the indices of the faces.  Vertices are read and written as 32 bit words.
+ */
+#define NORMAL_COMPUTE_SHADER                                                                  \
+  "#version 430 core                                                                       \n" \
+  "                                                                                        \n" \
+  "layout (local_size_x = 64) in;                                                          \n" \
+  "                                                                                        \n" \
+  "layout (std430, binding = 0) buffer Vertices { uint vertices[]; };                      \n" \
+  "layout (std430, binding = 1) readonly buffer Work { uint work[]; };                     \n" \
+  "                                                                                        \n" \
+  "uniform int numVertices;                                                                \n" \
+  "uniform int stride;                                                                     \n" \
+  "uniform int packedNormals;                                                              \n" \
+  "                                                                                        \n" \
+  "vec3 position (uint i) {                                                                \n" \
+  "    uint b = i * uint (stride);                                                         \n" \
+  "    return uintBitsToFloat (uvec3 (vertices[b], vertices[b + 1u], vertices[b + 2u]));   \n" \
+  "}                                                                                       \n" \
+  "                                                                                        \n" \
+  "uint packNormal (vec3 n) {                                                              \n" \
+  "    uvec3 p = uvec3 (ivec3 (round (clamp (n, -1.0, 1.0) * 511.0))) & 1023u;             \n" \
+  "    return p.x | (p.y << 10) | (p.z << 20);                                             \n" \
+  "}                                                                                       \n" \
+  "                                                                                        \n" \
+  "void main() {                                                                           \n" \
+  "    uint k = gl_GlobalInvocationID.x;                                                   \n" \
+  "    if (k >= uint (numVertices)) {                                                      \n" \
+  "        return;                                                                         \n" \
+  "    }                                                                                   \n" \
+  "    uint v     = work[3u * k];                                                          \n" \
+  "    uint first = work[(3u * k) + 1u];                                                   \n" \
+  "    uint count = work[(3u * k) + 2u];                                                   \n" \
+  "    vec3 n     = vec3 (0.0);                                                            \n" \
+  "                                                                                        \n" \
+  "    for (uint j = 0u; j < count; j++) {                                                 \n" \
+  "        uint t  = first + (3u * j);                                                     \n" \
+  "        vec3 p1 = position (work[t]);                                                   \n" \
+  "        n += cross (position (work[t + 1u]) - p1, position (work[t + 2u]) - p1);        \n" \
+  "    }                                                                                   \n" \
+  "    float l = length (n);                                                               \n" \
+  "    n = l > 0.0 ? n / l : vec3 (0.0);                                                   \n" \
+  "                                                                                        \n" \
+  "    uint b = (v * uint (stride)) + 3u;                                                  \n" \
+  "    if (packedNormals != 0) {                                                           \n" \
+  "        vertices[b] = packNormal (n);                                                   \n" \
+  "    }                                                                                   \n" \
+  "    else {                                                                              \n" \
+  "        vertices[b]      = floatBitsToUint (n.x);                                       \n" \
+  "        vertices[b + 1u] = floatBitsToUint (n.y);                                       \n" \
+  "        vertices[b + 2u] = floatBitsToUint (n.z);                                       \n" \
+  "    }                                                                                   \n" \
+  "}                                                                                       \n"
+
+const char* Shader::smoothVertexShader ()
+{
+  return SMOOTH_VERTEX_SHADER (UNIFORM_MODEL, UNIFORM_MODEL_NORMAL, FLOAT_NORMAL);
+}
+
+const char* Shader::smoothInstancedVertexShader ()
+{
+  return SMOOTH_VERTEX_SHADER (ATTRIBUTE_MODEL, ATTRIBUTE_MODEL_NORMAL, FLOAT_NORMAL);
+}
+
+const char* Shader::smoothOctahedralVertexShader ()
+{
+  return SMOOTH_VERTEX_SHADER (UNIFORM_MODEL, UNIFORM_MODEL_NORMAL, OCTAHEDRAL_NORMAL);
+}
+
+const char* Shader::smoothInstancedOctahedralVertexShader ()
+{
+  return SMOOTH_VERTEX_SHADER (ATTRIBUTE_MODEL, ATTRIBUTE_MODEL_NORMAL, OCTAHEDRAL_NORMAL);
+}
 
 const char* Shader::smoothFragmentShader () { return SMOOTH_FRAGMENT_SHADER ("vsColor", ""); }
 
@@ -158,7 +344,29 @@ const char* Shader::smoothWireframeFragmentShader ()
   return SMOOTH_FRAGMENT_SHADER ("gsColor", ADD_WIREFRAME);
 }
 
-const char* Shader::flatVertexShader () { return FLAT_VERTEX_SHADER; }
+const char* Shader::matcapVertexShader ()
+{
+  return MATCAP_VERTEX_SHADER (UNIFORM_MODEL, UNIFORM_MODEL_NORMAL, FLOAT_NORMAL);
+}
+
+const char* Shader::matcapInstancedVertexShader ()
+{
+  return MATCAP_VERTEX_SHADER (ATTRIBUTE_MODEL, ATTRIBUTE_MODEL_NORMAL, FLOAT_NORMAL);
+}
+
+const char* Shader::matcapOctahedralVertexShader ()
+{
+  return MATCAP_VERTEX_SHADER (UNIFORM_MODEL, UNIFORM_MODEL_NORMAL, OCTAHEDRAL_NORMAL);
+}
+
+const char* Shader::matcapInstancedOctahedralVertexShader ()
+{
+  return MATCAP_VERTEX_SHADER (ATTRIBUTE_MODEL, ATTRIBUTE_MODEL_NORMAL, OCTAHEDRAL_NORMAL);
+}
+
+const char* Shader::flatVertexShader () { return FLAT_VERTEX_SHADER (UNIFORM_MODEL); }
+
+const char* Shader::flatInstancedVertexShader () { return FLAT_VERTEX_SHADER (ATTRIBUTE_MODEL); }
 
 const char* Shader::flatFragmentShader () { return FLAT_FRAGMENT_SHADER ("vsColor", ""); }
 
@@ -167,7 +375,12 @@ const char* Shader::flatWireframeFragmentShader ()
   return FLAT_FRAGMENT_SHADER ("gsColor", ADD_WIREFRAME);
 }
 
-const char* Shader::constantVertexShader () { return CONSTANT_VERTEX_SHADER; }
+const char* Shader::constantVertexShader () { return CONSTANT_VERTEX_SHADER (UNIFORM_MODEL); }
+
+const char* Shader::constantInstancedVertexShader ()
+{
+  return CONSTANT_VERTEX_SHADER (ATTRIBUTE_MODEL);
+}
 
 const char* Shader::constantFragmentShader () { return CONSTANT_FRAGMENT_SHADER (""); }
 
@@ -177,3 +390,7 @@ const char* Shader::constantWireframeFragmentShader ()
 }
 
 const char* Shader::geometryShader () { return GEOMETRY_SHADER; }
+
+const char* Shader::coreGeometryShader () { return CORE_GEOMETRY_SHADER; }
+
+const char* Shader::normalComputeShader () { return NORMAL_COMPUTE_SHADER; }
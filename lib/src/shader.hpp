@@ -8,17 +8,31 @@
 namespace Shader
 {
   const char* smoothVertexShader ();
+  const char* smoothInstancedVertexShader ();
+  const char* smoothOctahedralVertexShader ();
+  const char* smoothInstancedOctahedralVertexShader ();
   const char* smoothFragmentShader ();
   const char* smoothWireframeFragmentShader ();
 
+  // matcap shading shares the fragment shaders of smooth shading
+  const char* matcapVertexShader ();
+  const char* matcapInstancedVertexShader ();
+  const char* matcapOctahedralVertexShader ();
+  const char* matcapInstancedOctahedralVertexShader ();
+
   const char* flatVertexShader ();
+  const char* flatInstancedVertexShader ();
   const char* flatFragmentShader ();
   const char* flatWireframeFragmentShader ();
 
   const char* constantVertexShader ();
+  const char* constantInstancedVertexShader ();
   const char* constantFragmentShader ();
   const char* constantWireframeFragmentShader ();
   const char* geometryShader ();
+  // the geometry shader of the core profile
+  const char* coreGeometryShader ();
+  const char* normalComputeShader ();
 };
 
 #endif
@@ -2,13 +2,20 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
+#include <unordered_map>
+#include <vector>
 #include "../mesh.hpp"
+#include "bvh.hpp"
 #include "color.hpp"
 #include "config.hpp"
 #include "dimension.hpp"
 #include "distance.hpp"
+#include "hash.hpp"
+#include "mesh-instances.hpp"
 #include "mesh-util.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone-sphere.hpp"
@@ -22,6 +29,7 @@
 #include "sketch/node-intersection.hpp"
 #include "sketch/path-intersection.hpp"
 #include "sketch/path.hpp"
+#include "sketch/primitives.hpp"
 #include "util.hpp"
 
 namespace
@@ -39,6 +47,18 @@ namespace
     }
   };
 
+  void combineSphere (std::size_t& key, const glm::vec3& center, float radius)
+  {
+    Hash::combine (key, center.x);
+    Hash::combine (key, center.y);
+    Hash::combine (key, center.z);
+    Hash::combine (key, radius);
+  }
+
+  // spheres appended to paths are intersected linearly until they exceed this number and a
+  // quarter of the indexed spheres, after which the index of path spheres is rebuilt
+  constexpr unsigned int maxNumUnindexedSpheres = 1 << 8;
+
   bool almostEqual (const glm::vec3& a, const glm::vec3& b)
   {
     return glm::distance2 (a, b) <= Util::epsilon () * Util::epsilon ();
@@ -74,6 +94,238 @@ namespace
   private:
     PrimSphere _sphere;
   };
+
+  /* The spheres of all paths hashed by their centers into a uniform grid, whose cells are about
+   * as big as an average sphere.  Spheres whose centers lie in a box are found by visiting the
+   * cells that overlap it, or all spheres if the box overlaps more cells than are occupied.
+   */
+  class PathSphereGrid
+  {
+  public:
+    struct Element
+    {
+      unsigned int path;
+      unsigned int index;
+      PrimSphere   sphere;
+    };
+
+    PathSphereGrid (const SketchPaths& paths)
+      : cellSize (1.0f)
+    {
+      float sumRadii = 0.0f;
+      for (unsigned int p = 0; p < paths.size (); p++)
+      {
+        const SketchPath::Spheres& spheres = paths[p].spheres ();
+
+        for (unsigned int i = 0; i < spheres.size (); i++)
+        {
+          this->elements.push_back (Element{p, i, spheres[i]});
+          sumRadii += spheres[i].radius ();
+        }
+      }
+
+      if (this->elements.empty () == false)
+      {
+        this->cellSize = glm::max (Util::epsilon (), 2.0f * sumRadii / this->elements.size ());
+      }
+      for (unsigned int i = 0; i < this->elements.size (); i++)
+      {
+        this->cells[this->key (this->cell (this->elements[i].sphere.center ()))].push_back (i);
+      }
+    }
+
+    unsigned int numElements () const { return this->elements.size (); }
+
+    const Element& element (unsigned int i) const { return this->elements[i]; }
+
+    // elements of cells with colliding keys are visited as well
+    void forEachElement (const glm::vec3& min, const glm::vec3& max,
+                         const std::function<void(unsigned int)>& f) const
+    {
+      const glm::ivec3 cMin = this->cell (min);
+      const glm::ivec3 cMax = this->cell (max);
+      const glm::vec3  extent = glm::vec3 (cMax - cMin) + glm::vec3 (1.0f);
+
+      if (extent.x * extent.y * extent.z > float (this->cells.size ()))
+      {
+        for (unsigned int i = 0; i < this->elements.size (); i++)
+        {
+          f (i);
+        }
+      }
+      else
+      {
+        for (int z = cMin.z; z <= cMax.z; z++)
+        {
+          for (int y = cMin.y; y <= cMax.y; y++)
+          {
+            for (int x = cMin.x; x <= cMax.x; x++)
+            {
+              const auto it = this->cells.find (this->key (glm::ivec3 (x, y, z)));
+              if (it != this->cells.end ())
+              {
+                for (unsigned int i : it->second)
+                {
+                  f (i);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+
+  private:
+    glm::ivec3 cell (const glm::vec3& p) const
+    {
+      return glm::ivec3 (glm::floor (p / this->cellSize));
+    }
+
+    std::size_t key (const glm::ivec3& c) const
+    {
+      std::size_t k = 0;
+      Hash::combine (k, c.x);
+      Hash::combine (k, c.y);
+      Hash::combine (k, c.z);
+      return k;
+    }
+
+    float                                                      cellSize;
+    std::vector<Element>                                       elements;
+    std::unordered_map<std::size_t, std::vector<unsigned int>> cells;
+  };
+
+  /* The nodes of a tree hashed by their centers into a grid, whose cells are twice as big as the
+   * distance of almost equal centers, so that the mirrored twin of a node is found in constant
+   * time by visiting the adjacent cells of its mirrored center.  The index is maintained while
+   * nodes are added, moved or deleted, and is rebuilt after other changes of the tree.  Copies
+   * are invalid, since they would refer to the nodes of another tree.
+   */
+  class NodeGrid
+  {
+  public:
+    NodeGrid ()
+      : isValid (false)
+    {
+    }
+
+    NodeGrid (const NodeGrid&)
+      : NodeGrid ()
+    {
+    }
+
+    NodeGrid& operator= (const NodeGrid&)
+    {
+      this->invalidate ();
+      return *this;
+    }
+
+    void invalidate ()
+    {
+      this->isValid = false;
+      this->cells.clear ();
+      this->nodeKeys.clear ();
+    }
+
+    void update (SketchTree& tree)
+    {
+      if (this->isValid == false)
+      {
+        this->isValid = true;
+
+        if (tree.hasRoot ())
+        {
+          tree.root ().forEachNode ([this](SketchNode& node) { this->insert (node); });
+        }
+      }
+    }
+
+    void insert (SketchNode& node)
+    {
+      if (this->isValid)
+      {
+        const std::size_t k = this->key (this->cell (node.data ().center ()));
+
+        this->cells[k].push_back (&node);
+        this->nodeKeys[&node] = k;
+      }
+    }
+
+    void erase (const SketchNode& node)
+    {
+      const auto it = this->nodeKeys.find (&node);
+
+      if (it != this->nodeKeys.end ())
+      {
+        std::vector<SketchNode*>& cell = this->cells[it->second];
+
+        cell.erase (std::find (cell.begin (), cell.end (), &node));
+        if (cell.empty ())
+        {
+          this->cells.erase (it->second);
+        }
+        this->nodeKeys.erase (it);
+      }
+    }
+
+    // must be called whenever the center of a node changes
+    void move (SketchNode& node)
+    {
+      if (this->isValid)
+      {
+        this->erase (node);
+        this->insert (node);
+      }
+    }
+
+    SketchNode* find (const glm::vec3& center, const SketchNode& exclude) const
+    {
+      assert (this->isValid);
+
+      const glm::ivec3 c = this->cell (center);
+
+      for (int z = c.z - 1; z <= c.z + 1; z++)
+      {
+        for (int y = c.y - 1; y <= c.y + 1; y++)
+        {
+          for (int x = c.x - 1; x <= c.x + 1; x++)
+          {
+            const auto it = this->cells.find (this->key (glm::ivec3 (x, y, z)));
+            if (it != this->cells.end ())
+            {
+              for (SketchNode* n : it->second)
+              {
+                if (n->parent () && (&exclude != n) && almostEqual (n->data ().center (), center))
+                {
+                  return n;
+                }
+              }
+            }
+          }
+        }
+      }
+      return nullptr;
+    }
+
+  private:
+    glm::ivec3 cell (const glm::vec3& p) const
+    {
+      return glm::ivec3 (glm::floor (p / (2.0f * Util::epsilon ())));
+    }
+
+    std::size_t key (const glm::ivec3& c) const
+    {
+      std::size_t k = 0;
+      Hash::combine (k, c.x);
+      Hash::combine (k, c.y);
+      Hash::combine (k, c.z);
+      return k;
+    }
+
+    bool                                                     isValid;
+    std::unordered_map<std::size_t, std::vector<SketchNode*>> cells;
+    std::unordered_map<const SketchNode*, std::size_t>       nodeKeys;
+  };
 }
 
 struct SketchMesh::Impl
@@ -81,12 +333,41 @@ struct SketchMesh::Impl
   SketchMesh*  self;
   SketchTree   tree;
   SketchPaths  paths;
-  Mesh         sphereMesh;
-  Mesh         boneMesh;
-  RenderConfig renderConfig;
+  Mesh          sphereMesh;
+  Mesh          boneMesh;
+  RenderConfig  renderConfig;
+  MeshInstances nodeInstances;
+  MeshInstances boneInstances;
+  MeshInstances bubbleInstances;
+  MeshInstances pathInstances;
+
+  mutable SketchPrimitives primitivesCache;
+  mutable std::size_t      primitivesKey;
+  mutable bool             isPrimitivesCacheValid;
+
+  // bones are indexed by their child nodes, path spheres by their path and sphere indices
+  std::vector<SketchNode*>  indexedNodes;
+  std::vector<SketchNode*>  indexedBones;
+  std::vector<ui_pair>      indexedSpheres;
+  Bvh                       nodeBvh;
+  Bvh                       boneBvh;
+  Bvh                       sphereBvh;
+  std::size_t               indexTopologyKey;
+  std::size_t               indexGeometryKey;
+  bool                      isIndexValid;
+  std::vector<unsigned int> indexedPathSizes;
+  std::vector<std::size_t>  indexedPathKeys;
+  bool                      isPathIndexValid;
+  NodeGrid                  nodeGrid;
 
   Impl (SketchMesh* s)
     : self (s)
+    , primitivesKey (0)
+    , isPrimitivesCacheValid (false)
+    , indexTopologyKey (0)
+    , indexGeometryKey (0)
+    , isIndexValid (false)
+    , isPathIndexValid (false)
   {
     this->sphereMesh = MeshUtil::icosphere (3);
     this->sphereMesh.bufferData ();
@@ -105,6 +386,12 @@ struct SketchMesh::Impl
     , sphereMesh (other.sphereMesh)
     , boneMesh (other.boneMesh)
     , renderConfig (other.renderConfig)
+    , primitivesKey (0)
+    , isPrimitivesCacheValid (false)
+    , indexTopologyKey (0)
+    , indexGeometryKey (0)
+    , isIndexValid (false)
+    , isPathIndexValid (false)
   {
     this->sphereMesh.bufferData ();
     this->boneMesh.bufferData ();
@@ -112,53 +399,247 @@ struct SketchMesh::Impl
 
   bool isEmpty () const { return this->tree.hasRoot () == false && this->paths.empty (); }
 
-  void fromTree (const SketchTree& newTree) { this->tree = newTree; }
+  // the tree may be changed arbitrarily by the caller
+  SketchTree& mutableTree ()
+  {
+    this->nodeGrid.invalidate ();
+    return this->tree;
+  }
+
+  void fromTree (const SketchTree& newTree)
+  {
+    this->tree = newTree;
+    this->nodeGrid.invalidate ();
+  }
+
+  void reset ()
+  {
+    this->tree.reset ();
+    this->nodeGrid.invalidate ();
+  }
 
-  void reset () { this->tree.reset (); }
+  static PrimAABox sphereBounds (const PrimSphere& s)
+  {
+    return PrimAABox (s.center () - glm::vec3 (s.radius ()), s.center () + glm::vec3 (s.radius ()));
+  }
 
-  bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
-                   const SketchNode* exclude = nullptr)
+  static PrimAABox boneBounds (const SketchNode& node)
+  {
+    assert (node.parent ());
+
+    const PrimSphere& s1 = node.data ();
+    const PrimSphere& s2 = node.parent ()->data ();
+
+    return PrimAABox (glm::min (s1.center () - glm::vec3 (s1.radius ()),
+                                s2.center () - glm::vec3 (s2.radius ())),
+                      glm::max (s1.center () + glm::vec3 (s1.radius ()),
+                                s2.center () + glm::vec3 (s2.radius ())));
+  }
+
+  std::size_t topologyKey () const
   {
+    std::size_t key = 0;
+
     if (this->tree.hasRoot ())
     {
-      this->tree.root ().forEachNode ([this, &ray, &intersection, exclude](SketchNode& node) {
-        float t;
-        if (&node != exclude && IntersectionUtil::intersects (ray, node.data (), &t))
-        {
-          const glm::vec3 p = ray.pointAt (t);
-          intersection.update (t, p, glm::normalize (p - node.data ().center ()), *this->self,
-                               node);
-        }
+      this->tree.root ().forEachConstNode ([&key](const SketchNode& node) {
+        Hash::combine (key, &node);
+        Hash::combine (key, node.parent ());
       });
     }
-    return intersection.isIntersection ();
+    return key;
   }
 
-  bool intersects (const PrimRay& ray, SketchBoneIntersection& intersection)
+  std::size_t treeGeometryKey () const
   {
+    std::size_t key = 0;
+
     if (this->tree.hasRoot ())
     {
-      this->tree.root ().forEachNode ([this, &ray, &intersection](SketchNode& node) {
-        if (node.parent ())
-        {
-          const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
+      this->tree.root ().forEachConstNode ([&key](const SketchNode& node) {
+        Hash::combine (key, node.numChildren ());
+        combineSphere (key, node.data ().center (), node.data ().radius ());
+      });
+    }
+    return key;
+  }
 
-          if (coneSphere.hasCone ())
-          {
-            const PrimCone cone = coneSphere.toCone ();
+  /* Like the primitives, the index of the tree is validated by hashing.  It is refit if only
+   * the geometry changed, i.e. nodes were moved or scaled, and rebuilt if nodes were added or
+   * deleted.
+   */
+  void updateIndex ()
+  {
+    const std::size_t topologyKey = this->topologyKey ();
+    const std::size_t geometryKey = this->treeGeometryKey ();
 
-            float tRay, tCone;
-            if (IntersectionUtil::intersects (ray, cone, &tRay, &tCone))
-            {
-              const glm::vec3 p = ray.pointAt (tRay);
+    if (this->isIndexValid == false || topologyKey != this->indexTopologyKey)
+    {
+      this->indexedNodes.clear ();
+      this->indexedBones.clear ();
 
-              intersection.update (tRay, p, cone.projPointAt (tCone), cone.normalAt (p, tCone),
-                                   *this->self, node);
-            }
+      if (this->tree.hasRoot ())
+      {
+        this->tree.root ().forEachNode ([this](SketchNode& node) {
+          this->indexedNodes.push_back (&node);
+          if (node.parent ())
+          {
+            this->indexedBones.push_back (&node);
           }
-        }
+        });
+      }
+
+      this->nodeBvh.build (this->indexedNodes.size (), [this](unsigned int i) {
+        return Impl::sphereBounds (this->indexedNodes[i]->data ());
+      });
+      this->boneBvh.build (this->indexedBones.size (), [this](unsigned int i) {
+        return Impl::boneBounds (*this->indexedBones[i]);
+      });
+    }
+    else if (geometryKey != this->indexGeometryKey)
+    {
+      this->nodeBvh.refit ([this](unsigned int i) {
+        return Impl::sphereBounds (this->indexedNodes[i]->data ());
       });
+      this->boneBvh.refit (
+        [this](unsigned int i) { return Impl::boneBounds (*this->indexedBones[i]); });
     }
+    this->indexTopologyKey = topologyKey;
+    this->indexGeometryKey = geometryKey;
+    this->isIndexValid = true;
+  }
+
+  unsigned int numIndexedSpheres (unsigned int path) const
+  {
+    return path < this->indexedPathSizes.size () ? this->indexedPathSizes[path] : 0;
+  }
+
+  void buildPathIndex ()
+  {
+    this->indexedSpheres.clear ();
+    this->indexedPathSizes.clear ();
+    this->indexedPathKeys.clear ();
+
+    for (unsigned int i = 0; i < this->paths.size (); i++)
+    {
+      const unsigned int n = this->paths[i].spheres ().size ();
+
+      for (unsigned int j = 0; j < n; j++)
+      {
+        this->indexedSpheres.emplace_back (i, j);
+      }
+      this->indexedPathSizes.push_back (n);
+      this->indexedPathKeys.push_back (this->paths[i].key (n));
+    }
+    this->sphereBvh.build (this->indexedSpheres.size (), [this](unsigned int i) {
+      return Impl::sphereBounds (this->indexedSphere (i));
+    });
+    this->isPathIndexValid = true;
+  }
+
+  /* Paths are drawn by appending spheres, hence the index of path spheres only covers the
+   * spheres each path had when it was built.  Paths keep the hashes of their prefixes, so the
+   * index is validated in constant time per path: it is refit if indexed spheres were changed,
+   * and rebuilt if indexed spheres were deleted or too many spheres of the given number of first
+   * paths are not indexed.  Spheres of later paths, i.e. of paths being drawn, never trigger a
+   * rebuild.
+   */
+  void updatePathIndex (unsigned int numPaths)
+  {
+    if (this->isPathIndexValid == false || this->indexedPathSizes.size () > this->paths.size ())
+    {
+      this->buildPathIndex ();
+      return;
+    }
+
+    bool isChanged = false;
+    for (unsigned int i = 0; i < this->indexedPathSizes.size (); i++)
+    {
+      const SketchPath&  path = this->paths[i];
+      const unsigned int n = this->indexedPathSizes[i];
+
+      if (path.spheres ().size () < n)
+      {
+        this->buildPathIndex ();
+        return;
+      }
+      else if (path.key (n) != this->indexedPathKeys[i])
+      {
+        this->indexedPathKeys[i] = path.key (n);
+        isChanged = true;
+      }
+    }
+
+    unsigned int numUnindexed = 0;
+    for (unsigned int i = 0; i < numPaths; i++)
+    {
+      numUnindexed += this->paths[i].spheres ().size () - this->numIndexedSpheres (i);
+    }
+
+    if (numUnindexed > glm::max (maxNumUnindexedSpheres,
+                                 (unsigned int) this->indexedSpheres.size () / 4))
+    {
+      this->buildPathIndex ();
+    }
+    else if (isChanged)
+    {
+      this->sphereBvh.refit (
+        [this](unsigned int i) { return Impl::sphereBounds (this->indexedSphere (i)); });
+    }
+  }
+
+  const PrimSphere& indexedSphere (unsigned int i) const
+  {
+    const ui_pair& index = this->indexedSpheres[i];
+    return this->paths[index.first].spheres ()[index.second];
+  }
+
+  template <typename T> static float nearest (const T& intersection)
+  {
+    return intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
+  }
+
+  bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
+                   const SketchNode* exclude = nullptr)
+  {
+    this->updateIndex ();
+    this->nodeBvh.intersects (ray, [this, &ray, &intersection, exclude](unsigned int i) {
+      SketchNode& node = *this->indexedNodes[i];
+      float       t;
+
+      if (&node != exclude && IntersectionUtil::intersects (ray, node.data (), &t))
+      {
+        const glm::vec3 p = ray.pointAt (t);
+        intersection.update (t, p, glm::normalize (p - node.data ().center ()), *this->self,
+                             node);
+      }
+      return Impl::nearest (intersection);
+    });
+    return intersection.isIntersection ();
+  }
+
+  bool intersects (const PrimRay& ray, SketchBoneIntersection& intersection)
+  {
+    this->updateIndex ();
+    this->boneBvh.intersects (ray, [this, &ray, &intersection](unsigned int i) {
+      SketchNode&          node = *this->indexedBones[i];
+      const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
+
+      if (coneSphere.hasCone ())
+      {
+        const PrimCone cone = coneSphere.toCone ();
+
+        float tRay, tCone;
+        if (IntersectionUtil::intersects (ray, cone, &tRay, &tCone))
+        {
+          const glm::vec3 p = ray.pointAt (tRay);
+
+          intersection.update (tRay, p, cone.projPointAt (tCone), cone.normalAt (p, tCone),
+                               *this->self, node);
+        }
+      }
+      return Impl::nearest (intersection);
+    });
     return intersection.isIntersection ();
   }
 
@@ -181,126 +662,79 @@ struct SketchMesh::Impl
     }
     if (numExcludedLastPaths < this->paths.size ())
     {
-      for (unsigned int i = 0; i < this->paths.size () - numExcludedLastPaths; i++)
+      if (this->intersects (ray, spIntersection, this->paths.size () - numExcludedLastPaths))
       {
-        if (this->paths.at (i).intersects (ray, *this->self, spIntersection))
-        {
-          intersection.update (spIntersection.distance (), spIntersection.position (),
-                               spIntersection.normal (), spIntersection.mesh ());
-        }
+        intersection.update (spIntersection.distance (), spIntersection.position (),
+                             spIntersection.normal (), spIntersection.mesh ());
       }
     }
     return intersection.isIntersection ();
   }
 
-  bool intersects (const PrimRay& ray, SketchPathIntersection& intersection)
+  /* Only intersects the spheres of the given number of first paths, i.e. spheres appended to
+   * excluded paths are neither indexed nor intersected.  Spheres that are not indexed yet are
+   * intersected by the bounds of the chunks of their paths.
+   */
+  bool intersects (const PrimRay& ray, SketchPathIntersection& intersection,
+                   unsigned int numPaths)
   {
-    for (unsigned int i = 0; i < this->paths.size (); i++)
+    this->updatePathIndex (numPaths);
+    this->sphereBvh.intersects (ray, [this, &ray, &intersection, numPaths](unsigned int i) {
+      const ui_pair&    index = this->indexedSpheres[i];
+      const PrimSphere& s = this->indexedSphere (i);
+      float             t;
+
+      if (index.first < numPaths && IntersectionUtil::intersects (ray, s, &t))
+      {
+        const glm::vec3 p = ray.pointAt (t);
+        intersection.update (t, p, glm::normalize (p - s.center ()), *this->self,
+                             this->paths[index.first]);
+      }
+      return Impl::nearest (intersection);
+    });
+    for (unsigned int i = 0; i < numPaths; i++)
     {
-      this->paths.at (i).intersects (ray, *this->self, intersection);
+      this->paths[i].intersects (ray, *this->self, intersection, this->numIndexedSpheres (i));
     }
     return intersection.isIntersection ();
   }
 
+  bool intersects (const PrimRay& ray, SketchPathIntersection& intersection)
+  {
+    return this->intersects (ray, intersection, this->paths.size ());
+  }
+
   bool intersects (const glm::vec3& point, PrimSphereIntersection& intersection,
                    const SketchPath& excluded)
   {
-    auto checkSphere = [&point, &intersection](const SketchNode& node) {
-      const float d2 = glm::distance2 (point, node.data ().center ());
-      if (d2 <= node.data ().radius () * node.data ().radius ())
-      {
-        intersection.update (glm::sqrt (d2), node.data ());
-      }
-    };
+    this->primitives ().containingSpheres (
+      point, Util::findIndexByReference (this->paths, excluded),
+      [&intersection](float d, const PrimSphere& s) { intersection.update (d, s); });
 
-    auto checkBone = [&point, &intersection, &checkSphere](const SketchNode& node) {
-      if (node.parent ())
-      {
-        const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
-
-        if (coneSphere.hasCone ())
-        {
-          const glm::vec3 toP = point - coneSphere.sphere1 ().center ();
-          const float     x = glm::dot (toP, coneSphere.direction ());
-          const float     y = glm::sqrt (glm::dot (toP, toP) - (x * x));
-          const float     sigma = glm::half_pi<float> () - coneSphere.alpha ();
-          const float     xOff = x - (y / glm::tan (sigma));
-
-          float nearestFactor;
-          float nearestRadius;
-
-          if (xOff <= 0.0f)
-          {
-            nearestFactor = 0.0f;
-            nearestRadius = coneSphere.sphere1 ().radius ();
-          }
-          else if (xOff >= coneSphere.length ())
-          {
-            nearestFactor = coneSphere.length ();
-            nearestRadius = coneSphere.sphere2 ().radius ();
-          }
-          else
-          {
-            nearestFactor = xOff;
-            nearestRadius = glm::mix (coneSphere.sphere1 ().radius (),
-                                      coneSphere.sphere2 ().radius (), xOff / coneSphere.length ());
-          }
-
-          const glm::vec3 nearestCenter =
-            coneSphere.sphere1 ().center () + (nearestFactor * coneSphere.direction ());
-          const float d2 = glm::distance2 (point, nearestCenter);
-
-          if (d2 <= nearestRadius * nearestRadius)
-          {
-            intersection.update (glm::sqrt (d2), PrimSphere (nearestCenter, nearestRadius));
-          }
-        }
-        else
-        {
-          const float d2 = glm::distance2 (point, coneSphere.sphere1 ().center ());
-
-          if (d2 <= coneSphere.sphere1 ().radius () * coneSphere.sphere1 ().radius ())
-          {
-            intersection.update (glm::sqrt (d2), coneSphere.sphere1 ());
-          }
-        }
-      }
-      else
-      {
-        checkSphere (node);
-      }
-    };
-
-    if (this->tree.hasRoot ())
-    {
-      this->tree.root ().forEachNode ([&checkBone](SketchNode& node) { checkBone (node); });
-    }
-
-    for (const SketchPath& p : this->paths)
-    {
-      if (&p != &excluded)
-      {
-        for (const PrimSphere& s : p.spheres ())
-        {
-          checkSphere (s);
-        }
-      }
-    }
     return intersection.isIntersection ();
   }
 
+  static glm::mat4x4 instanceMatrix (const glm::vec3& position, const glm::mat4x4& rotation,
+                                     const glm::vec3& scaling)
+  {
+    return glm::translate (glm::mat4x4 (1.0f), position) * rotation *
+           glm::scale (glm::mat4x4 (1.0f), scaling);
+  }
+
   void renderTree (Camera& camera)
   {
+    this->nodeInstances.reset ();
+    this->boneInstances.reset ();
+    this->bubbleInstances.reset ();
+
     if (this->tree.hasRoot ())
     {
-      this->tree.root ().forEachConstNode ([this, &camera](const SketchNode& node) {
+      this->tree.root ().forEachConstNode ([this](const SketchNode& node) {
         const glm::vec3& pos = node.data ().center ();
         const float      radius = node.data ().radius ();
 
-        this->sphereMesh.position (pos);
-        this->sphereMesh.scaling (glm::vec3 (radius));
-        this->sphereMesh.color (this->renderConfig.nodeColor);
-        this->sphereMesh.render (camera);
+        this->nodeInstances.add (
+          Impl::instanceMatrix (pos, glm::mat4x4 (1.0f), glm::vec3 (radius)));
 
         if (node.parent ())
         {
@@ -313,37 +747,33 @@ struct SketchMesh::Impl
           {
             const glm::vec3 down = glm::vec3 (0.0f, -1.0f, 0.0f);
 
+            glm::mat4x4     rotation (1.0f);
+
             if (Util::colinearUnit (direction, down))
             {
-              this->boneMesh.rotationMatrix (glm::mat4x4 (1.0f));
-
               if (glm::dot (direction, down) < 0.0f)
               {
-                this->boneMesh.rotateX (glm::pi<float> ());
+                rotation =
+                  glm::rotate (glm::mat4x4 (1.0f), glm::pi<float> (), glm::vec3 (1.0f, 0.0f, 0.0f));
               }
             }
             else
             {
-              this->boneMesh.rotationMatrix (glm::orientation (direction, down));
+              rotation = glm::orientation (direction, down);
             }
 
-            this->boneMesh.color (this->renderConfig.nodeColor);
-            this->boneMesh.position (parPos);
-            this->boneMesh.scaling (glm::vec3 (parRadius, distance, parRadius));
-            this->boneMesh.render (camera);
+            this->boneInstances.add (
+              Impl::instanceMatrix (parPos, rotation, glm::vec3 (parRadius, distance, parRadius)));
           }
           else
           {
-            this->sphereMesh.color (this->renderConfig.bubbleColor);
-
             for (float d = radius * 0.5f; d < distance;)
             {
               const glm::vec3 bubblePos = pos + (d * direction);
               const float     bubbleRadius = glm::mix (radius, parRadius, d / distance);
 
-              this->sphereMesh.position (bubblePos);
-              this->sphereMesh.scaling (glm::vec3 (bubbleRadius));
-              this->sphereMesh.render (camera);
+              this->bubbleInstances.add (
+                Impl::instanceMatrix (bubblePos, glm::mat4x4 (1.0f), glm::vec3 (bubbleRadius)));
 
               d += bubbleRadius * 0.5f;
             }
@@ -351,16 +781,28 @@ struct SketchMesh::Impl
         }
       });
     }
+
+    this->sphereMesh.color (this->renderConfig.nodeColor);
+    this->sphereMesh.renderInstances (camera, this->nodeInstances);
+
+    this->boneMesh.color (this->renderConfig.nodeColor);
+    this->boneMesh.renderInstances (camera, this->boneInstances);
+
+    this->sphereMesh.color (this->renderConfig.bubbleColor);
+    this->sphereMesh.renderInstances (camera, this->bubbleInstances);
   }
 
   void renderPaths (Camera& camera)
   {
-    this->sphereMesh.color (this->renderConfig.sphereColor);
+    this->pathInstances.reset ();
 
     for (const SketchPath& p : this->paths)
     {
-      p.render (camera, this->sphereMesh);
+      p.addInstances (this->pathInstances);
     }
+
+    this->sphereMesh.color (this->renderConfig.sphereColor);
+    this->sphereMesh.renderInstances (camera, this->pathInstances);
   }
 
   void render (Camera& camera)
@@ -375,6 +817,76 @@ struct SketchMesh::Impl
 
   void renderWireframe (bool v) { this->renderConfig.renderWireframe = v; }
 
+  // each node of the tree is stored in its parent's list of children
+  std::size_t numBytes () const
+  {
+    std::size_t n = sizeof (SketchMesh::Impl) + this->sphereMesh.numBytes () +
+                    this->boneMesh.numBytes () + this->nodeBvh.numBytes () +
+                    this->boneBvh.numBytes () + this->sphereBvh.numBytes ();
+
+    if (this->tree.hasRoot ())
+    {
+      n += this->tree.root ().numNodes () * (sizeof (SketchNode) + (2 * sizeof (void*)));
+    }
+    for (const SketchPath& path : this->paths)
+    {
+      n += sizeof (SketchPath) +
+           (path.spheres ().capacity () * (sizeof (PrimSphere) + sizeof (std::size_t)));
+    }
+    n += (this->indexedNodes.capacity () + this->indexedBones.capacity ()) * sizeof (SketchNode*);
+    n += this->indexedSpheres.capacity () * sizeof (ui_pair);
+    n += this->indexedPathSizes.capacity () * (sizeof (unsigned int) + sizeof (std::size_t));
+    return n;
+  }
+
+  std::size_t numBufferBytes () const
+  {
+    return this->sphereMesh.numBufferBytes () + this->boneMesh.numBufferBytes ();
+  }
+
+  // sketches are edited in place, hence their key is computed from the rendered spheres
+  std::size_t renderKey () const
+  {
+    std::size_t key = 0;
+
+    Hash::combine (key, this->renderConfig.renderWireframe);
+    for (const Color& c : {this->renderConfig.nodeColor, this->renderConfig.bubbleColor,
+                           this->renderConfig.sphereColor})
+    {
+      combineSphere (key, c.vec3 (), c.opacity ());
+    }
+    Hash::combine (key, this->geometryKey ());
+    return key;
+  }
+
+  std::size_t geometryKey () const
+  {
+    std::size_t key = this->treeGeometryKey ();
+
+    for (const SketchPath& p : this->paths)
+    {
+      Hash::combine (key, p.spheres ().size ());
+      Hash::combine (key, p.key (p.spheres ().size ()));
+    }
+    return key;
+  }
+
+  /* Nodes are exposed by reference and may be modified directly, hence the cache is validated by
+   * hashing the geometry, which is much cheaper than rebuilding the primitives.
+   */
+  const SketchPrimitives& primitives () const
+  {
+    const std::size_t key = this->geometryKey ();
+
+    if (this->isPrimitivesCacheValid == false || key != this->primitivesKey)
+    {
+      this->primitivesCache.build (this->tree, this->paths);
+      this->primitivesKey = key;
+      this->isPrimitivesCacheValid = true;
+    }
+    return this->primitivesCache;
+  }
+
   PrimPlane mirrorPlane (Dimension dim) const
   {
     if (this->tree.hasRoot ())
@@ -392,16 +904,8 @@ struct SketchMesh::Impl
   {
     if (this->tree.hasRoot () && node.parent ())
     {
-      SketchNode*     result = nullptr;
-      const glm::vec3 pos = mirrorPlane.mirror (node.data ().center ());
-
-      this->tree.root ().forEachNode ([&exclude, &result, &pos](SketchNode& n) {
-        if (n.parent () && (&exclude != &n) && almostEqual (n.data ().center (), pos))
-        {
-          result = &n;
-        }
-      });
-      return result;
+      this->nodeGrid.update (this->tree);
+      return this->nodeGrid.find (mirrorPlane.mirror (node.data ().center ()), exclude);
     }
     else
     {
@@ -436,15 +940,19 @@ struct SketchMesh::Impl
     const float     radius = node.data ().radius ();
     SketchNode&     parent = *node.parent ();
 
-    if (parent.parent () == nullptr)
+    SketchNode* parentM =
+      parent.parent () == nullptr ? &parent : this->mirrored (parent, mirrorPlane, node);
+
+    if (parentM)
     {
-      return &parent.emplaceChild (pos, radius);
+      SketchNode& nodeM = parentM->emplaceChild (pos, radius);
+
+      this->nodeGrid.insert (nodeM);
+      return &nodeM;
     }
     else
     {
-      SketchNode* parentM = this->mirrored (parent, mirrorPlane, node);
-
-      return bool(parentM) ? &parentM->emplaceChild (pos, radius) : nullptr;
+      return nullptr;
     }
   }
 
@@ -453,6 +961,7 @@ struct SketchMesh::Impl
   {
     SketchNode& newNode = parent.emplaceChild (pos, radius);
 
+    this->nodeGrid.insert (newNode);
     if (dim)
     {
       this->addMirroredNode (newNode, this->mirrorPlane (*dim));
@@ -484,6 +993,7 @@ struct SketchMesh::Impl
       }
     }
     child.parent ()->deleteChild (child);
+    this->nodeGrid.invalidate ();
     return newNode;
   }
 
@@ -517,15 +1027,18 @@ struct SketchMesh::Impl
 
   void move (SketchNode& node, const glm::vec3& delta, bool all, const Dimension* dim)
   {
-    const auto moveNodes = [all](SketchNode& node, const glm::vec3& delta) {
+    const auto moveNodes = [this, all](SketchNode& node, const glm::vec3& delta) {
       if (all)
       {
-        node.forEachNode (
-          [&delta](SketchNode& n) { n.data ().center (n.data ().center () + delta); });
+        node.forEachNode ([this, &delta](SketchNode& n) {
+          n.data ().center (n.data ().center () + delta);
+          this->nodeGrid.move (n);
+        });
       }
       else
       {
         node.data ().center (node.data ().center () + delta);
+        this->nodeGrid.move (node);
       }
     };
 
@@ -580,11 +1093,12 @@ struct SketchMesh::Impl
 
   void rotate (SketchNode& node, const glm::vec3& axis, float angle, const Dimension* dim)
   {
-    const auto rotateNodes = [](SketchNode& node, const glm::vec3& axis, float angle) {
+    const auto rotateNodes = [this](SketchNode& node, const glm::vec3& axis, float angle) {
       const glm::mat4x4 matrix = Util::rotation (node.data ().center (), axis, angle);
 
-      node.forEachNode ([&matrix](SketchNode& n) {
+      node.forEachNode ([this, &matrix](SketchNode& n) {
         n.data ().center (glm::vec3 (matrix * glm::vec4 (n.data ().center (), 1.0f)));
+        this->nodeGrid.move (n);
       });
     };
 
@@ -622,9 +1136,11 @@ struct SketchMesh::Impl
 
         if (nodeM && nodeM->parent ())
         {
+          this->eraseFromNodeGrid (*nodeM);
           nodeM->parent ()->deleteChild (*nodeM);
         }
       }
+      this->eraseFromNodeGrid (node);
       node.parent ()->deleteChild (node);
     }
     else
@@ -642,9 +1158,15 @@ struct SketchMesh::Impl
         }
       }
       node.parent ()->deleteChild (node);
+      this->nodeGrid.invalidate ();
     }
   }
 
+  void eraseFromNodeGrid (const SketchNode& node)
+  {
+    node.forEachConstNode ([this](const SketchNode& n) { this->nodeGrid.erase (n); });
+  }
+
   void deletePath (SketchPath& path, const Dimension* dim)
   {
     assert (this->paths.empty () == false);
@@ -720,6 +1242,7 @@ struct SketchMesh::Impl
       });
 
       mirrorPositiveNode (this->tree.root ());
+      this->nodeGrid.invalidate ();
     }
   }
 
@@ -752,6 +1275,7 @@ struct SketchMesh::Impl
   {
     assert (this->tree.hasRoot ());
     this->tree.rebalance (newRoot);
+    this->nodeGrid.invalidate ();
   }
 
   SketchNode& snap (SketchNode& node, Dimension dim)
@@ -771,18 +1295,22 @@ struct SketchMesh::Impl
         node.forEachConstChild ([&snapped](const SketchNode& c) { snapped.addChild (c); });
         nodeM->forEachConstChild ([&snapped](const SketchNode& c) { snapped.addChild (c); });
         this->deleteNode (node, true, &dim);
+        this->nodeGrid.invalidate ();
         return snapped;
       }
       else
       {
         node.data ().center (mPlane.project (node.data ().center ()));
         nodeM->data ().center (mPlane.project (nodeM->data ().center ()));
+        this->nodeGrid.move (node);
+        this->nodeGrid.move (*nodeM);
         return node;
       }
     }
     else
     {
       node.data ().center (mPlane.project (node.data ().center ()));
+      this->nodeGrid.move (node);
       return node;
     }
   }
@@ -839,70 +1367,65 @@ struct SketchMesh::Impl
     }
   }
 
+  /* Path spheres are redundant if they lie inside a sphere of another path or inside a bone.
+   * Since containment is transitive, deleting all of them at once keeps the union of spheres.
+   */
   void optimizePaths ()
   {
-    for (SketchPath& p1 : this->paths)
+    const PathSphereGrid           grid (this->paths);
+    std::vector<std::vector<bool>> isRedundant;
+
+    for (const SketchPath& p : this->paths)
     {
-      for (SketchPath& p2 : this->paths)
-      {
-        if (&p1 < &p2)
-        {
-          for (auto it1 = p1.spheres ().begin (); it1 != p1.spheres ().end ();)
-          {
-            bool deletedP1Sphere = false;
+      isRedundant.emplace_back (p.spheres ().size (), false);
+    }
 
-            for (auto it2 = p2.spheres ().begin (); it2 != p2.spheres ().end ();)
-            {
-              const PrimSphere& s1 = *it1;
-              const PrimSphere& s2 = *it2;
-              const float       d = glm::distance (s1.center (), s2.center ());
+    for (unsigned int i = 0; i < grid.numElements (); i++)
+    {
+      const PathSphereGrid::Element& outer = grid.element (i);
+      const glm::vec3                r (outer.sphere.radius ());
 
-              if (s2.radius () > d + s1.radius ())
-              {
-                it1 = p1.deleteSphere (it1);
-                deletedP1Sphere = true;
-                break;
-              }
-              else if (s1.radius () > d + s2.radius ())
-              {
-                it2 = p2.deleteSphere (it2);
-              }
-              else
-              {
-                ++it2;
-              }
-            }
-            if (deletedP1Sphere == false)
-            {
-              ++it1;
-            }
-          }
-        }
-      }
-      if (this->tree.hasRoot ())
-      {
-        this->tree.root ().forEachNode ([&p1](SketchNode& node) {
-          if (node.parent ())
+      grid.forEachElement (
+        outer.sphere.center () - r, outer.sphere.center () + r,
+        [&grid, &isRedundant, &outer](unsigned int j) {
+          const PathSphereGrid::Element& inner = grid.element (j);
+          const float d = glm::distance (outer.sphere.center (), inner.sphere.center ());
+
+          if (inner.path != outer.path && outer.sphere.radius () > d + inner.sphere.radius ())
           {
-            const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
+            isRedundant[inner.path][inner.index] = true;
+          }
+        });
+    }
 
-            for (auto it1 = p1.spheres ().begin (); it1 != p1.spheres ().end ();)
+    if (this->tree.hasRoot ())
+    {
+      this->tree.root ().forEachConstNode ([&grid, &isRedundant](const SketchNode& node) {
+        if (node.parent ())
+        {
+          const PrimSphere&    s1 = node.data ();
+          const PrimSphere&    s2 = node.parent ()->data ();
+          const PrimConeSphere coneSphere (s1, s2);
+          const glm::vec3      min = glm::min (s1.center () - glm::vec3 (s1.radius ()),
+                                               s2.center () - glm::vec3 (s2.radius ()));
+          const glm::vec3      max = glm::max (s1.center () + glm::vec3 (s1.radius ()),
+                                               s2.center () + glm::vec3 (s2.radius ()));
+
+          grid.forEachElement (min, max, [&grid, &isRedundant, &coneSphere](unsigned int j) {
+            const PathSphereGrid::Element& inner = grid.element (j);
+
+            if (Distance::distance (coneSphere, inner.sphere.center ()) < -inner.sphere.radius ())
             {
-              const PrimSphere& s1 = *it1;
-              const float       d = Distance::distance (coneSphere, s1.center ());
-
-              if (d < -s1.radius ())
-              {
-                it1 = p1.deleteSphere (it1);
-              }
-              else
-              {
-                ++it1;
-              }
+              isRedundant[inner.path][inner.index] = true;
             }
-          }
-        });
-      }
+          });
+        }
+      });
+    }
+
+    for (unsigned int p = 0; p < this->paths.size (); p++)
+    {
+      this->paths[p].deleteSpheres (isRedundant[p]);
     }
   }
 
@@ -916,7 +1439,6 @@ struct SketchMesh::Impl
 
 DELEGATE_BIG4_COPY_SELF (SketchMesh);
 GETTER_CONST (const SketchTree&, SketchMesh, tree)
-GETTER (SketchTree&, SketchMesh, tree)
 GETTER_CONST (const SketchPaths&, SketchMesh, paths)
 DELEGATE_CONST (bool, SketchMesh, isEmpty)
 DELEGATE1 (void, SketchMesh, fromTree, const SketchTree&)
@@ -927,6 +1449,9 @@ DELEGATE3 (bool, SketchMesh, intersects, const PrimRay&, SketchMeshIntersection&
 DELEGATE2 (bool, SketchMesh, intersects, const PrimRay&, SketchPathIntersection&)
 DELEGATE1 (void, SketchMesh, render, Camera&)
 DELEGATE1 (void, SketchMesh, renderWireframe, bool)
+DELEGATE_CONST (std::size_t, SketchMesh, renderKey)
+DELEGATE_CONST (std::size_t, SketchMesh, numBytes)
+DELEGATE_CONST (std::size_t, SketchMesh, numBufferBytes)
 DELEGATE1 (PrimPlane, SketchMesh, mirrorPlane, Dimension)
 DELEGATE4 (SketchNode&, SketchMesh, addChild, SketchNode&, const glm::vec3&, float,
            const Dimension*)
@@ -947,4 +1472,7 @@ DELEGATE2_CONST (void, SketchMesh, minMax, glm::vec3&, glm::vec3&)
 DELEGATE5 (void, SketchMesh, smoothPath, SketchPath&, const PrimSphere&, unsigned int,
            SketchPathSmoothEffect, const Dimension*)
 DELEGATE (void, SketchMesh, optimizePaths)
+DELEGATE_CONST (const SketchPrimitives&, SketchMesh, primitives)
 DELEGATE1 (void, SketchMesh, runFromConfig, const Config&)
+
+SketchTree& SketchMesh::tree () { return this->impl->mutableTree (); }
@@ -15,6 +15,7 @@ enum class Dimension;
 class PrimPlane;
 class PrimRay;
 class PrimSphere;
+class SketchPrimitives;
 enum class SketchPathSmoothEffect;
 
 class SketchMesh : public Configurable
@@ -34,6 +35,9 @@ public:
   bool        intersects (const PrimRay&, SketchPathIntersection&);
   void        render (Camera&);
   void        renderWireframe (bool);
+  std::size_t renderKey () const;
+  std::size_t numBytes () const;
+  std::size_t numBufferBytes () const;
   PrimPlane   mirrorPlane (Dimension);
   SketchNode& addChild (SketchNode&, const glm::vec3&, float, const Dimension*);
   SketchNode& addParent (SketchNode&, const glm::vec3&, float, const Dimension*);
@@ -52,6 +56,9 @@ public:
                           const Dimension*);
   void        optimizePaths ();
 
+  // cached until the geometry changes
+  const SketchPrimitives& primitives () const;
+
 private:
   IMPLEMENTATION
 
@@ -1,5 +1,8 @@
+#include <glm/gtc/matrix_transform.hpp>
 #include "../mesh.hpp"
+#include "hash.hpp"
 #include "intersection.hpp"
+#include "mesh-instances.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
@@ -7,14 +10,59 @@
 #include "sketch/path.hpp"
 #include "util.hpp"
 
+namespace
+{
+  static const unsigned int chunkSize = 16;
+
+  struct Bounds
+  {
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    Bounds ()
+      : minimum (Util::maxFloat ())
+      , maximum (Util::minFloat ())
+    {
+    }
+
+    void extend (const PrimSphere& s)
+    {
+      this->maximum = glm::max (this->maximum, s.center () + glm::vec3 (s.radius ()));
+      this->minimum = glm::min (this->minimum, s.center () - glm::vec3 (s.radius ()));
+    }
+
+    void extend (const Bounds& b)
+    {
+      this->maximum = glm::max (this->maximum, b.maximum);
+      this->minimum = glm::min (this->minimum, b.minimum);
+    }
+  };
+
+  std::size_t combineSphere (std::size_t key, const PrimSphere& s)
+  {
+    Hash::combine (key, s.center ().x);
+    Hash::combine (key, s.center ().y);
+    Hash::combine (key, s.center ().z);
+    Hash::combine (key, s.radius ());
+    return key;
+  }
+}
+
+/* Paths are drawn continuously, hence consecutive spheres are close to each other.  The bounds
+ * of chunks of consecutive spheres are kept, so smoothing only visits the chunks near the brush
+ * and updates the bounds of the path from the chunks it changed.  Likewise, the hashes of all
+ * prefixes of the path are kept, so appending a sphere only hashes the new sphere.
+ */
 struct SketchPath::Impl
 {
-  SketchPath*         self;
-  SketchPath::Spheres spheres;
-  glm::vec3           minimum;
-  glm::vec3           maximum;
-  glm::vec3           intersectionFirst;
-  glm::vec3           intersectionLast;
+  SketchPath*              self;
+  SketchPath::Spheres      spheres;
+  std::vector<Bounds>      chunks;
+  std::vector<std::size_t> keys;
+  glm::vec3                minimum;
+  glm::vec3                maximum;
+  glm::vec3                intersectionFirst;
+  glm::vec3                intersectionLast;
 
   Impl (SketchPath* s)
     : self (s)
@@ -32,17 +80,58 @@ struct SketchPath::Impl
   {
     this->resetMinMax ();
     this->spheres.clear ();
+    this->chunks.clear ();
+    this->keys.clear ();
+  }
+
+  std::size_t key (unsigned int n) const
+  {
+    assert (n <= this->keys.size ());
+    return n == 0 ? 0 : this->keys[n - 1];
+  }
+
+  // rehashes the prefixes from the given sphere on
+  void setKeys (unsigned int from)
+  {
+    this->keys.resize (this->spheres.size ());
+    for (unsigned int i = from; i < this->spheres.size (); i++)
+    {
+      this->keys[i] = combineSphere (this->key (i), this->spheres[i]);
+    }
+  }
+
+  void setChunk (unsigned int c)
+  {
+    const unsigned int end = glm::min ((c + 1) * chunkSize, (unsigned int) this->spheres.size ());
+
+    this->chunks[c] = Bounds ();
+    for (unsigned int i = c * chunkSize; i < end; i++)
+    {
+      this->chunks[c].extend (this->spheres[i]);
+    }
+  }
+
+  void setMinMaxFromChunks ()
+  {
+    Bounds bounds;
+    for (const Bounds& b : this->chunks)
+    {
+      bounds.extend (b);
+    }
+    this->minimum = bounds.minimum;
+    this->maximum = bounds.maximum;
   }
 
   void setMinMax ()
   {
-    this->resetMinMax ();
+    this->chunks.resize ((this->spheres.size () + chunkSize - 1) / chunkSize);
 
-    for (const PrimSphere& s : this->spheres)
+    for (unsigned int c = 0; c < this->chunks.size (); c++)
     {
-      this->maximum = glm::max (this->maximum, s.center () + glm::vec3 (s.radius ()));
-      this->minimum = glm::min (this->minimum, s.center () - glm::vec3 (s.radius ()));
+      this->setChunk (c);
     }
+    this->setMinMaxFromChunks ();
+    this->setKeys (0);
   }
 
   bool isEmpty () const { return this->spheres.empty (); }
@@ -67,38 +156,83 @@ struct SketchPath::Impl
     this->maximum = glm::max (this->maximum, position + glm::vec3 (radius));
     this->minimum = glm::min (this->minimum, position - glm::vec3 (radius));
 
+    if (this->spheres.size () % chunkSize == 0)
+    {
+      this->chunks.emplace_back ();
+    }
     this->spheres.emplace_back (position, radius);
+    this->chunks.back ().extend (this->spheres.back ());
+    this->keys.push_back (combineSphere (this->key (this->keys.size ()), this->spheres.back ()));
   }
 
   SketchPath::Spheres::iterator deleteSphere (SketchPath::Spheres::const_iterator it)
   {
-    return this->spheres.erase (it);
+    const SketchPath::Spheres::iterator next = this->spheres.erase (it);
+    this->setMinMax ();
+    return next;
+  }
+
+  void deleteSpheres (const std::vector<bool>& flags)
+  {
+    assert (flags.size () == this->spheres.size ());
+
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < this->spheres.size (); i++)
+    {
+      if (flags[i] == false)
+      {
+        this->spheres[n++] = this->spheres[i];
+      }
+    }
+    if (n < this->spheres.size ())
+    {
+      this->spheres.erase (this->spheres.begin () + n, this->spheres.end ());
+      this->setMinMax ();
+    }
   }
 
-  void render (Camera& camera, Mesh& mesh) const
+  void addInstances (MeshInstances& instances) const
   {
     for (const PrimSphere& s : this->spheres)
     {
-      mesh.position (s.center ());
-      mesh.scaling (glm::vec3 (s.radius ()));
-      mesh.render (camera);
+      instances.add (glm::scale (glm::translate (glm::mat4x4 (1.0f), s.center ()),
+                                 glm::vec3 (s.radius ())));
     }
   }
 
-  bool intersects (const PrimRay& ray, SketchMesh& mesh, SketchPathIntersection& intersection)
+  bool isNearer (const PrimRay& ray, const glm::vec3& min, const glm::vec3& max,
+                 const SketchPathIntersection& intersection) const
   {
-    const PrimAABox aabox (this->minimum, this->maximum);
-    float           t;
-    if (IntersectionUtil::intersects (ray, aabox, &t))
+    float t;
+    return IntersectionUtil::intersects (ray, PrimAABox (min, max), &t) &&
+           (intersection.isIntersection () == false || t < intersection.distance ());
+  }
+
+  bool intersects (const PrimRay& ray, SketchMesh& mesh, SketchPathIntersection& intersection,
+                   unsigned int first)
+  {
+    if (first < this->spheres.size () &&
+        this->isNearer (ray, this->minimum, this->maximum, intersection))
     {
-      if (intersection.isIntersection () == false || t < intersection.distance ())
+      for (unsigned int c = first / chunkSize; c < this->chunks.size (); c++)
       {
-        for (const PrimSphere& s : this->spheres)
+        if (this->isNearer (ray, this->chunks[c].minimum, this->chunks[c].maximum, intersection))
         {
-          if (IntersectionUtil::intersects (ray, s, &t))
+          const unsigned int begin = glm::max (c * chunkSize, first);
+          const unsigned int end =
+            glm::min ((c + 1) * chunkSize, (unsigned int) this->spheres.size ());
+
+          for (unsigned int i = begin; i < end; i++)
           {
-            intersection.update (t, ray.pointAt (t), glm::normalize (ray.pointAt (t) - s.center ()),
-                                 mesh, *this->self);
+            const PrimSphere& s = this->spheres[i];
+            float             t;
+
+            if (IntersectionUtil::intersects (ray, s, &t))
+            {
+              intersection.update (t, ray.pointAt (t),
+                                   glm::normalize (ray.pointAt (t) - s.center ()), mesh,
+                                   *this->self);
+            }
           }
         }
       }
@@ -145,76 +279,99 @@ struct SketchPath::Impl
   void smooth (const PrimSphere& range, unsigned int halfWidth, SketchPathSmoothEffect effect,
                const PrimSphere* nearestToFirst, const PrimSphere* nearestToLast)
   {
-    const unsigned int numS = this->spheres.size ();
+    unsigned int firstChanged = this->chunks.size ();
 
-    for (unsigned int i = 0; i < numS; i++)
+    for (unsigned int c = 0; c < this->chunks.size (); c++)
     {
-      if (IntersectionUtil::intersects (range, this->spheres.at (i)))
+      const Bounds& b = this->chunks[c];
+
+      if (IntersectionUtil::intersects (range, PrimAABox (b.minimum, b.maximum)))
       {
-        const unsigned int hW =
-          i < halfWidth ? i : (i >= numS - halfWidth ? numS - i - 1 : halfWidth);
-        glm::vec3 center (0.0f);
-        float     radius (0.0f);
-        for (unsigned int j = i - hW; j <= i + hW; j++)
+        const unsigned int end =
+          glm::min ((c + 1) * chunkSize, (unsigned int) this->spheres.size ());
+
+        for (unsigned int i = c * chunkSize; i < end; i++)
         {
-          center += this->spheres.at (j).center ();
-          radius += this->spheres.at (j).radius ();
+          if (IntersectionUtil::intersects (range, this->spheres[i]))
+          {
+            this->smoothSphere (i, halfWidth, effect, nearestToFirst, nearestToLast);
+          }
         }
+        this->setChunk (c);
+        firstChanged = glm::min (firstChanged, c);
+      }
+    }
+    if (firstChanged < this->chunks.size ())
+    {
+      this->setMinMaxFromChunks ();
+      this->setKeys (firstChanged * chunkSize);
+    }
+  }
 
-        const bool effectEmbeds = effect == SketchPathSmoothEffect::Embed ||
-                                  effect == SketchPathSmoothEffect::EmbedAndAdjust;
-        unsigned int numAffectedCenter = 0;
-        unsigned int numAffectedRadius = 0;
+  void smoothSphere (unsigned int i, unsigned int halfWidth, SketchPathSmoothEffect effect,
+                     const PrimSphere* nearestToFirst, const PrimSphere* nearestToLast)
+  {
+    const unsigned int numS = this->spheres.size ();
+    const unsigned int hW = i < halfWidth ? i : (i >= numS - halfWidth ? numS - i - 1 : halfWidth);
+    glm::vec3          center (0.0f);
+    float              radius (0.0f);
+    for (unsigned int j = i - hW; j <= i + hW; j++)
+    {
+      center += this->spheres.at (j).center ();
+      radius += this->spheres.at (j).radius ();
+    }
 
-        if (effect != SketchPathSmoothEffect::None)
+    const bool effectEmbeds = effect == SketchPathSmoothEffect::Embed ||
+                              effect == SketchPathSmoothEffect::EmbedAndAdjust;
+    unsigned int numAffectedCenter = 0;
+    unsigned int numAffectedRadius = 0;
+
+    if (effect != SketchPathSmoothEffect::None)
+    {
+      if (i < halfWidth)
+      {
+        if (nearestToFirst && effectEmbeds)
         {
-          if (i < halfWidth)
-          {
-            if (nearestToFirst && effectEmbeds)
-            {
-              numAffectedCenter++;
-              center += nearestToFirst->center ();
-            }
+          numAffectedCenter++;
+          center += nearestToFirst->center ();
+        }
 
-            if (nearestToFirst && effect == SketchPathSmoothEffect::EmbedAndAdjust)
-            {
-              numAffectedRadius++;
-              radius += nearestToFirst->radius ();
-            }
-            else if (effect == SketchPathSmoothEffect::Pinch)
-            {
-              numAffectedRadius++;
-              numAffectedCenter++;
-              center += this->intersectionFirst;
-            }
-          }
+        if (nearestToFirst && effect == SketchPathSmoothEffect::EmbedAndAdjust)
+        {
+          numAffectedRadius++;
+          radius += nearestToFirst->radius ();
+        }
+        else if (effect == SketchPathSmoothEffect::Pinch)
+        {
+          numAffectedRadius++;
+          numAffectedCenter++;
+          center += this->intersectionFirst;
+        }
+      }
 
-          if (i >= numS - halfWidth)
-          {
-            if (nearestToLast && effectEmbeds)
-            {
-              numAffectedCenter++;
-              center += nearestToLast->center ();
-            }
+      if (i >= numS - halfWidth)
+      {
+        if (nearestToLast && effectEmbeds)
+        {
+          numAffectedCenter++;
+          center += nearestToLast->center ();
+        }
 
-            if (nearestToLast && effect == SketchPathSmoothEffect::EmbedAndAdjust)
-            {
-              numAffectedRadius++;
-              radius += nearestToLast->radius ();
-            }
-            else if (effect == SketchPathSmoothEffect::Pinch)
-            {
-              numAffectedRadius++;
-              numAffectedCenter++;
-              center += this->intersectionLast;
-            }
-          }
+        if (nearestToLast && effect == SketchPathSmoothEffect::EmbedAndAdjust)
+        {
+          numAffectedRadius++;
+          radius += nearestToLast->radius ();
+        }
+        else if (effect == SketchPathSmoothEffect::Pinch)
+        {
+          numAffectedRadius++;
+          numAffectedCenter++;
+          center += this->intersectionLast;
         }
-        this->spheres.at (i).center (center / float((2 * hW) + 1 + numAffectedCenter));
-        this->spheres.at (i).radius (radius / float((2 * hW) + 1 + numAffectedRadius));
       }
     }
-    this->setMinMax ();
+    this->spheres.at (i).center (center / float((2 * hW) + 1 + numAffectedCenter));
+    this->spheres.at (i).radius (radius / float((2 * hW) + 1 + numAffectedRadius));
   }
 };
 
@@ -232,8 +389,11 @@ DELEGATE_CONST (PrimAABox, SketchPath, aabox)
 DELEGATE3 (void, SketchPath, addSphere, const glm::vec3&, const glm::vec3&, float)
 DELEGATE1 (SketchPath::Spheres::iterator, SketchPath, deleteSphere,
            SketchPath::Spheres::const_iterator)
-DELEGATE2_CONST (void, SketchPath, render, Camera&, Mesh&)
-DELEGATE3 (bool, SketchPath, intersects, const PrimRay&, SketchMesh&, SketchPathIntersection&)
+DELEGATE1 (void, SketchPath, deleteSpheres, const std::vector<bool>&)
+DELEGATE1_CONST (void, SketchPath, addInstances, MeshInstances&)
+DELEGATE1_CONST (std::size_t, SketchPath, key, unsigned int)
+DELEGATE4 (bool, SketchPath, intersects, const PrimRay&, SketchMesh&, SketchPathIntersection&,
+           unsigned int)
 DELEGATE1 (SketchPath, SketchPath, mirrorPositive, const PrimPlane&)
 DELEGATE5 (void, SketchPath, smooth, const PrimSphere&, unsigned int, SketchPathSmoothEffect,
            const PrimSphere*, const PrimSphere*)
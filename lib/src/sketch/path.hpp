@@ -12,6 +12,7 @@
 class Camera;
 class Intersection;
 class Mesh;
+class MeshInstances;
 class PrimAABox;
 class PrimPlane;
 class PrimRay;
@@ -43,8 +44,14 @@ public:
   PrimAABox         aabox () const;
   void              addSphere (const glm::vec3&, const glm::vec3&, float);
   Spheres::iterator deleteSphere (Spheres::const_iterator);
-  void              render (Camera&, Mesh&) const;
-  bool              intersects (const PrimRay&, SketchMesh&, SketchPathIntersection&);
+  // deletes the spheres whose flags are set
+  void              deleteSpheres (const std::vector<bool>&);
+  void              addInstances (MeshInstances&) const;
+  // hashes the given number of first spheres in constant time
+  std::size_t       key (unsigned int) const;
+  // only intersects the spheres from the given index on
+  bool              intersects (const PrimRay&, SketchMesh&, SketchPathIntersection&,
+                                unsigned int = 0);
   SketchPath        mirrorPositive (const PrimPlane&);
   void smooth (const PrimSphere&, unsigned int, SketchPathSmoothEffect, const PrimSphere*,
                const PrimSphere*);
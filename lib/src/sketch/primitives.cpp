@@ -0,0 +1,487 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <glm/gtx/norm.hpp>
+#include "bvh.hpp"
+#include "hash.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/cone-sphere.hpp"
+#include "sketch/path.hpp"
+#include "sketch/primitives.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int batchSize = 8;
+
+  // unused lanes repeat the last position of a batch
+  struct Batch
+  {
+    float x[batchSize];
+    float y[batchSize];
+    float z[batchSize];
+    float distance[batchSize];
+  };
+
+  /* The parameters of cone-spheres, whose first sphere is the larger one (cf.
+   * `Distance::distance (const PrimConeSphere&, const glm::vec3&)`).  Cone-spheres with equal
+   * radii are stored as cones with a zero angle, and cone-spheres without a cone are reduced to
+   * their first sphere.
+   */
+  struct Bones
+  {
+    std::vector<float>         x, y, z;
+    std::vector<float>         directionX, directionY, directionZ;
+    std::vector<float>         radius1, radius2, endRadius;
+    std::vector<float>         length, sideLength;
+    std::vector<float>         h1, h2, r1c, r2c;
+    std::vector<float>         sinAlpha, cosAlpha, tanAlpha;
+    std::vector<unsigned char> hasCone;
+
+    unsigned int size () const { return this->x.size (); }
+
+    void add (const PrimConeSphere& c)
+    {
+      const bool      sameRadii = c.sameRadii ();
+      const bool      cone = sameRadii ? c.length () > Util::epsilon () : c.hasCone ();
+      const float     r1 = c.sphere1 ().radius ();
+      const float     r2 = c.sphere2 ().radius ();
+      const float     l = c.length ();
+      const glm::vec3 direction = cone ? c.direction () : glm::vec3 (0.0f);
+
+      this->x.push_back (c.sphere1 ().center ().x);
+      this->y.push_back (c.sphere1 ().center ().y);
+      this->z.push_back (c.sphere1 ().center ().z);
+      this->directionX.push_back (direction.x);
+      this->directionY.push_back (direction.y);
+      this->directionZ.push_back (direction.z);
+      this->radius1.push_back (r1);
+      this->radius2.push_back (r2);
+      this->endRadius.push_back (sameRadii ? r1 : r2);
+      this->length.push_back (l);
+      this->hasCone.push_back (cone ? 1 : 0);
+
+      if (cone && sameRadii == false)
+      {
+        const float s = c.coneSideLength ();
+
+        this->sideLength.push_back (s);
+        this->h1.push_back (r1 * c.delta () / l);
+        this->h2.push_back (r2 * c.delta () / l);
+        this->r1c.push_back (r1 * s / l);
+        this->r2c.push_back (r2 * s / l);
+        this->sinAlpha.push_back (c.sinAlpha ());
+        this->cosAlpha.push_back (c.cosAlpha ());
+        this->tanAlpha.push_back (glm::tan (c.alpha ()));
+      }
+      else
+      {
+        this->sideLength.push_back (l);
+        this->h1.push_back (0.0f);
+        this->h2.push_back (0.0f);
+        this->r1c.push_back (r1);
+        this->r2c.push_back (r1);
+        this->sinAlpha.push_back (0.0f);
+        this->cosAlpha.push_back (1.0f);
+        this->tanAlpha.push_back (0.0f);
+      }
+    }
+
+    PrimAABox bounds (unsigned int i) const
+    {
+      const glm::vec3 c1 (this->x[i], this->y[i], this->z[i]);
+      const glm::vec3 c2 =
+        c1 + (glm::vec3 (this->directionX[i], this->directionY[i], this->directionZ[i]) *
+              this->length[i]);
+
+      return PrimAABox (glm::min (c1 - glm::vec3 (this->radius1[i]),
+                                  c2 - glm::vec3 (this->radius2[i])),
+                        glm::max (c1 + glm::vec3 (this->radius1[i]),
+                                  c2 + glm::vec3 (this->radius2[i])));
+    }
+  };
+
+  struct Spheres
+  {
+    std::vector<float>        x, y, z;
+    std::vector<float>        radius;
+    std::vector<unsigned int> paths;
+
+    unsigned int size () const { return this->x.size (); }
+
+    void add (const PrimSphere& s, unsigned int path)
+    {
+      this->x.push_back (s.center ().x);
+      this->y.push_back (s.center ().y);
+      this->z.push_back (s.center ().z);
+      this->radius.push_back (s.radius ());
+      this->paths.push_back (path);
+    }
+
+    PrimSphere sphere (unsigned int i) const
+    {
+      return PrimSphere (glm::vec3 (this->x[i], this->y[i], this->z[i]), this->radius[i]);
+    }
+
+    PrimAABox bounds (unsigned int i) const
+    {
+      const glm::vec3 c (this->x[i], this->y[i], this->z[i]);
+      return PrimAABox (c - glm::vec3 (this->radius[i]), c + glm::vec3 (this->radius[i]));
+    }
+  };
+
+  /* Folds the polynomial smooth minimum over the distances in ascending order, so the result
+   * does not depend on the order in which primitives are found.  Distances that exceed the
+   * minimum by at least the blend radius do not contribute.
+   */
+  float smoothUnion (std::vector<float>& distances, float blend)
+  {
+    assert (blend > 0.0f);
+
+    if (distances.empty ())
+    {
+      return Util::maxFloat ();
+    }
+    std::sort (distances.begin (), distances.end ());
+
+    float d = distances[0];
+    for (unsigned int i = 1; i < distances.size (); i++)
+    {
+      const float h = glm::max (blend - glm::abs (distances[i] - d), 0.0f) / blend;
+      d = glm::min (d, distances[i]) - (h * h * blend * 0.25f);
+    }
+    return d;
+  }
+}
+
+struct SketchPrimitives::Impl
+{
+  // bones precede spheres in the hierarchy's elements
+  Bones   bones;
+  Spheres spheres;
+  Bvh     bvh;
+
+  void build (const SketchTree& tree, const SketchPaths& paths)
+  {
+    this->bones = Bones ();
+    this->spheres = Spheres ();
+
+    if (tree.hasRoot ())
+    {
+      tree.root ().forEachConstNode ([this](const SketchNode& node) {
+        if (node.parent ())
+        {
+          this->bones.add (PrimConeSphere (node.data (), node.parent ()->data ()));
+        }
+        else
+        {
+          this->spheres.add (node.data (), Util::invalidIndex ());
+        }
+      });
+    }
+    for (unsigned int i = 0; i < paths.size (); i++)
+    {
+      for (const PrimSphere& s : paths[i].spheres ())
+      {
+        this->spheres.add (s, i);
+      }
+    }
+
+    this->bvh.build (this->bones.size () + this->spheres.size (),
+                     [this](unsigned int i) { return this->bounds (i); });
+  }
+
+  bool isEmpty () const { return this->bvh.numElements () == 0; }
+
+  PrimAABox bounds (unsigned int i) const
+  {
+    return i < this->bones.size () ? this->bones.bounds (i)
+                                   : this->spheres.bounds (i - this->bones.size ());
+  }
+
+  // calls `f` with the primitives whose bounds come within a margin of a box until it returns true
+  template <typename F> void forEachNear (const PrimAABox& box, float margin, const F& f) const
+  {
+    const glm::vec3 minimum = box.minimum () - glm::vec3 (margin);
+    const glm::vec3 maximum = box.maximum () + glm::vec3 (margin);
+    const float     maxDistance = (0.5f * glm::distance (minimum, maximum)) + Util::epsilon ();
+    bool            stop = false;
+
+    this->bvh.distance (box.center (), maxDistance,
+                        [this, &minimum, &maximum, maxDistance, &f, &stop](unsigned int i) {
+                          const PrimAABox b = this->bounds (i);
+
+                          if (stop == false &&
+                              glm::all (glm::lessThanEqual (b.minimum (), maximum)) &&
+                              glm::all (glm::lessThanEqual (minimum, b.maximum ())))
+                          {
+                            stop = f (i);
+                          }
+                          return stop ? 0.0f : maxDistance;
+                        });
+  }
+
+  bool isNear (const PrimAABox& box, float margin) const
+  {
+    bool found = false;
+
+    this->forEachNear (box, margin, [&found](unsigned int) {
+      found = true;
+      return true;
+    });
+    return found;
+  }
+
+  // the parameters of a primitive determine its distances
+  std::size_t hash (unsigned int i) const
+  {
+    std::size_t seed = 0;
+
+    if (i < this->bones.size ())
+    {
+      const Bones& b = this->bones;
+
+      for (float p : {b.x[i], b.y[i], b.z[i], b.directionX[i], b.directionY[i], b.directionZ[i],
+                      b.radius1[i], b.radius2[i], b.length[i]})
+      {
+        Hash::combine (seed, p);
+      }
+    }
+    else
+    {
+      const Spheres&     s = this->spheres;
+      const unsigned int j = i - this->bones.size ();
+
+      for (float p : {s.x[j], s.y[j], s.z[j], s.radius[j]})
+      {
+        Hash::combine (seed, p);
+      }
+    }
+    return std::size_t (Hash::mix (seed));
+  }
+
+  // hashes are summed, since the order in which primitives are found depends on the hierarchy
+  std::size_t hash (const PrimAABox& box, float margin) const
+  {
+    std::size_t sum = 0;
+
+    this->forEachNear (box, margin, [this, &sum](unsigned int i) {
+      sum += this->hash (i);
+      return false;
+    });
+    return sum;
+  }
+
+  // updates the minimal distances of `N` positions
+  template <unsigned int N>
+  void boneDistances (unsigned int i, const float* x, const float* y, const float* z,
+                      float* distances) const
+  {
+    const Bones& b = this->bones;
+    const float  cx = b.x[i], cy = b.y[i], cz = b.z[i];
+    const float  dx = b.directionX[i], dy = b.directionY[i], dz = b.directionZ[i];
+    const float  r1 = b.radius1[i], rEnd = b.endRadius[i];
+    const float  l = b.length[i], s = b.sideLength[i];
+    const float  h1 = b.h1[i], h2 = b.h2[i], r1c = b.r1c[i], r2c = b.r2c[i];
+    const float  sinAlpha = b.sinAlpha[i], cosAlpha = b.cosAlpha[i];
+    const bool   hasCone = b.hasCone[i] != 0;
+
+    for (unsigned int k = 0; k < N; k++)
+    {
+      const float tx = x[k] - cx;
+      const float ty = y[k] - cy;
+      const float tz = z[k] - cz;
+      const float px = (tx * dx) + (ty * dy) + (tz * dz);
+      const float ySqr = (tx * tx) + (ty * ty) + (tz * tz) - (px * px);
+      const float py = ySqr <= Util::epsilon () ? 0.0f : glm::sqrt (ySqr);
+      const float ex = px - l;
+      const float d1 = glm::sqrt ((px * px) + (py * py)) - r1;
+      const float d2 = glm::sqrt ((ex * ex) + (py * py)) - rEnd;
+      const float xn = ((px - h1) * cosAlpha) - ((py - r1c) * sinAlpha);
+      const float yn = ((px - h1) * sinAlpha) + ((py - r1c) * cosAlpha);
+      const float dSide = xn <= 0.0f ? d1 : (xn >= s ? d2 : yn);
+      const float dCone = px <= 0.0f ? d1 : ((px >= l + h2 && py <= r2c) ? d2 : dSide);
+
+      distances[k] = glm::min (distances[k], hasCone ? dCone : d1);
+    }
+  }
+
+  template <unsigned int N>
+  void sphereDistances (unsigned int i, const float* x, const float* y, const float* z,
+                        float* distances) const
+  {
+    const float cx = this->spheres.x[i], cy = this->spheres.y[i], cz = this->spheres.z[i];
+    const float r = this->spheres.radius[i];
+
+    for (unsigned int k = 0; k < N; k++)
+    {
+      const float tx = x[k] - cx;
+      const float ty = y[k] - cy;
+      const float tz = z[k] - cz;
+
+      distances[k] = glm::min (distances[k], glm::sqrt ((tx * tx) + (ty * ty) + (tz * tz)) - r);
+    }
+  }
+
+  template <unsigned int N>
+  void primitiveDistances (unsigned int i, const float* x, const float* y, const float* z,
+                           float* distances) const
+  {
+    if (i < this->bones.size ())
+    {
+      this->boneDistances<N> (i, x, y, z, distances);
+    }
+    else
+    {
+      this->sphereDistances<N> (i - this->bones.size (), x, y, z, distances);
+    }
+  }
+
+  float distance (const glm::vec3& p) const
+  {
+    float nearest = Util::maxFloat ();
+
+    this->bvh.distance (p, [this, &p, &nearest](unsigned int i) {
+      this->primitiveDistances<1> (i, &p.x, &p.y, &p.z, &nearest);
+
+      // boxes that contain the position are still searched if it lies inside a primitive
+      return glm::max (nearest, Util::epsilon ());
+    });
+    return nearest;
+  }
+
+  /* Each batch searches all primitives whose boxes are near enough to the center of the batch's
+   * positions: a primitive is only nearest to a position if its distance to the center is at
+   * most the center's distance plus the diameter of the batch.  Blending additionally searches
+   * all primitives within the blend radius.
+   */
+  void distances (const std::vector<glm::vec3>& positions, std::vector<float>& distances,
+                  float blend) const
+  {
+    distances.resize (positions.size ());
+
+    if (this->isEmpty ())
+    {
+      std::fill (distances.begin (), distances.end (), Util::maxFloat ());
+      return;
+    }
+
+    for (unsigned int begin = 0; begin < positions.size (); begin += batchSize)
+    {
+      const unsigned int end = glm::min (begin + batchSize, (unsigned int) (positions.size ()));
+      Batch              batch;
+      glm::vec3          min (Util::maxFloat ());
+      glm::vec3          max (Util::minFloat ());
+
+      for (unsigned int k = 0; k < batchSize; k++)
+      {
+        const glm::vec3& p = positions[glm::min (begin + k, end - 1)];
+
+        batch.x[k] = p.x;
+        batch.y[k] = p.y;
+        batch.z[k] = p.z;
+        batch.distance[k] = Util::maxFloat ();
+        min = glm::min (min, p);
+        max = glm::max (max, p);
+      }
+
+      const glm::vec3 center = 0.5f * (min + max);
+      const float     diameter = glm::distance (min, max);
+      const float     maxDistance =
+        glm::max (this->distance (center) + diameter, 0.0f) + blend + Util::epsilon ();
+
+      if (blend > 0.0f)
+      {
+        std::array<std::vector<float>, batchSize> candidates;
+
+        this->bvh.distance (center, maxDistance,
+                            [this, &batch, &candidates, maxDistance](unsigned int i) {
+                              float d[batchSize];
+                              std::fill_n (d, batchSize, Util::maxFloat ());
+
+                              this->primitiveDistances<batchSize> (i, batch.x, batch.y, batch.z,
+                                                                   d);
+                              for (unsigned int k = 0; k < batchSize; k++)
+                              {
+                                candidates[k].push_back (d[k]);
+                              }
+                              return maxDistance;
+                            });
+
+        for (unsigned int k = 0; k < batchSize; k++)
+        {
+          batch.distance[k] = smoothUnion (candidates[k], blend);
+        }
+      }
+      else
+      {
+        this->bvh.distance (center, maxDistance, [this, &batch, maxDistance](unsigned int i) {
+          this->primitiveDistances<batchSize> (i, batch.x, batch.y, batch.z, batch.distance);
+          return maxDistance;
+        });
+      }
+
+      for (unsigned int k = begin; k < end; k++)
+      {
+        distances[k] = batch.distance[k - begin];
+      }
+    }
+  }
+
+  void containingSpheres (const glm::vec3& p, unsigned int excludedPath,
+                          const SketchPrimitives::ContainingSphereCallback& f) const
+  {
+    const auto check = [&p, &f](const glm::vec3& center, float radius) {
+      const float d2 = glm::distance2 (p, center);
+      if (d2 <= radius * radius)
+      {
+        f (glm::sqrt (d2), PrimSphere (center, radius));
+      }
+    };
+
+    this->bvh.distance (p, Util::epsilon (), [this, &p, excludedPath, &check](unsigned int i) {
+      if (i < this->bones.size ())
+      {
+        const Bones&    b = this->bones;
+        const glm::vec3 c1 (b.x[i], b.y[i], b.z[i]);
+
+        if (b.hasCone[i] != 0)
+        {
+          const glm::vec3 direction (b.directionX[i], b.directionY[i], b.directionZ[i]);
+          const glm::vec3 toP = p - c1;
+          const float     x = glm::dot (toP, direction);
+          const float     y = glm::sqrt (glm::max (0.0f, glm::dot (toP, toP) - (x * x)));
+          const float     xOff = glm::clamp (x - (y * b.tanAlpha[i]), 0.0f, b.length[i]);
+
+          check (c1 + (xOff * direction),
+                 glm::mix (b.radius1[i], b.radius2[i], xOff / b.length[i]));
+        }
+        else
+        {
+          check (c1, b.radius1[i]);
+        }
+      }
+      else if (this->spheres.paths[i - this->bones.size ()] != excludedPath)
+      {
+        const PrimSphere s = this->spheres.sphere (i - this->bones.size ());
+        check (s.center (), s.radius ());
+      }
+      return Util::epsilon ();
+    });
+  }
+};
+
+DELEGATE_BIG6 (SketchPrimitives)
+DELEGATE2 (void, SketchPrimitives, build, const SketchTree&, const SketchPaths&)
+DELEGATE_CONST (bool, SketchPrimitives, isEmpty)
+DELEGATE1_CONST (float, SketchPrimitives, distance, const glm::vec3&)
+DELEGATE2_CONST (bool, SketchPrimitives, isNear, const PrimAABox&, float)
+DELEGATE2_CONST (std::size_t, SketchPrimitives, hash, const PrimAABox&, float)
+DELEGATE3_CONST (void, SketchPrimitives, distances, const std::vector<glm::vec3>&,
+                 std::vector<float>&, float)
+DELEGATE3_CONST (void, SketchPrimitives, containingSpheres, const glm::vec3&, unsigned int,
+                 const SketchPrimitives::ContainingSphereCallback&)
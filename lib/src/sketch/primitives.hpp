@@ -0,0 +1,49 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SKETCH_PRIMITIVES
+#define DILAY_SKETCH_PRIMITIVES
+
+#include <cstddef>
+#include <functional>
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+#include "sketch/fwd.hpp"
+
+class PrimAABox;
+
+/* The bones (as cone-spheres) and spheres of a sketch mesh.  Their parameters are precomputed
+ * once and stored as arrays of components, so distances are evaluated for batches of positions
+ * by fixed-width loops without branches, which compilers vectorize.  Primitives are found by a
+ * bounding volume hierarchy.
+ */
+class SketchPrimitives
+{
+public:
+  DECLARE_BIG6 (SketchPrimitives)
+
+  // called with the distance of a position to the center of a sphere that contains it
+  typedef std::function<void(float, const PrimSphere&)> ContainingSphereCallback;
+
+  void        build (const SketchTree&, const SketchPaths&);
+  bool        isEmpty () const;
+  float       distance (const glm::vec3&) const;
+  // checks whether a box comes within the given margin of the bounds of a primitive
+  bool        isNear (const PrimAABox&, float) const;
+  // hashes the primitives that come within the given margin of a box regardless of their order
+  std::size_t hash (const PrimAABox&, float) const;
+  // primitives are blended by a smooth minimum if the given blend radius is positive
+  void        distances (const std::vector<glm::vec3>&, std::vector<float>&,
+                         float = 0.0f) const;
+
+  // calls back with each primitive's nearest sphere that contains a position, but skips
+  // the spheres of the path with the given index
+  void containingSpheres (const glm::vec3&, unsigned int, const ContainingSphereCallback&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
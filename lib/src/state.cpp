@@ -12,6 +12,7 @@
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool.hpp"
+#include "tool/sculpt/util/recording.hpp"
 #include "tools.hpp"
 #include "view/gl-widget.hpp"
 #include "view/info-pane.hpp"
@@ -36,8 +37,9 @@ struct State::Impl
   Camera                  camera;
   History                 history;
   Scene                   scene;
+  SculptRecording         sculptRecording;
   std::unique_ptr<Tool>   toolPtr;
-  Maybe<ToolKey>          previousToolKey;
+  MaybeInline<ToolKey>    previousToolKey;
   std::vector<QShortcut*> shortcuts;
 
   Impl (State* s, ViewMainWindow& mW, Config& cfg, Cache& cch)
@@ -155,6 +157,7 @@ struct State::Impl
           this->addToolShortcut (ToolKey::SculptSmooth, tip, ViewInputEvent::S);
           this->addToolShortcut (ToolKey::SculptFlatten, tip, ViewInputEvent::F);
           this->addToolShortcut (ToolKey::SculptReduce, tip, ViewInputEvent::R);
+          this->addToolShortcut (ToolKey::SculptFreeze, tip, ViewInputEvent::Z);
           this->addToolShortcut (ToolKey::TrimMesh, tip, ViewInputEvent::T);
           this->addToolShortcut (ToolKey::Remesh, tip, ViewInputEvent::M);
 #ifndef NDEBUG
@@ -169,8 +172,10 @@ struct State::Impl
                                       (this->toolPtr->getKey () == ToolKey::SculptFlatten) ||
                                       (this->toolPtr->getKey () == ToolKey::SculptPinch) ||
                                       (this->toolPtr->getKey () == ToolKey::SculptReduce) ||
+                                      (this->toolPtr->getKey () == ToolKey::SculptFreeze) ||
                                       (this->toolPtr->getKey () == ToolKey::TrimMesh) ||
-                                      (this->toolPtr->getKey () == ToolKey::Remesh);
+                                      (this->toolPtr->getKey () == ToolKey::Remesh) ||
+                                      (this->toolPtr->getKey () == ToolKey::DecimateMesh);
 
           const bool toggleBackFromSmooth = (this->toolPtr->getKey () == ToolKey::SculptSmooth) &&
                                             this->previousToolKey &&
@@ -242,12 +247,14 @@ struct State::Impl
       SET_TOOL (SculptCrease)
       SET_TOOL (SculptPinch)
       SET_TOOL (SculptReduce)
+      SET_TOOL (SculptFreeze)
       SET_TOOL (EditSketch)
       SET_TOOL (DeleteSketch)
       SET_TOOL (ConvertSketch)
       SET_TOOL (SketchSpheres)
       SET_TOOL (TrimMesh)
       SET_TOOL (Remesh)
+      SET_TOOL (DecimateMesh)
       SET_TOOL (MoveCamera)
     }
 #undef SET_TOOL
@@ -352,6 +359,7 @@ GETTER (Cache&, State, cache)
 GETTER (Camera&, State, camera)
 GETTER (History&, State, history)
 GETTER (Scene&, State, scene)
+GETTER (SculptRecording&, State, sculptRecording)
 DELEGATE (bool, State, hasTool)
 DELEGATE (Tool&, State, tool)
 DELEGATE1 (void, State, setTool, ToolKey)
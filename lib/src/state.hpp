@@ -15,6 +15,7 @@ class History;
 class Id;
 class Mesh;
 class Scene;
+class SculptRecording;
 class Tool;
 enum class ToolKey;
 enum class ToolResponse;
@@ -29,22 +30,23 @@ public:
 
   DECLARE_BIG2 (State, ViewMainWindow&, Config&, Cache&)
 
-  ViewMainWindow& mainWindow ();
-  Config&         config ();
-  Cache&          cache ();
-  Camera&         camera ();
-  History&        history ();
-  Scene&          scene ();
-  bool            hasTool ();
-  Tool&           tool ();
-  void            setTool (ToolKey);
-  void            setPreviousTool ();
-  void            setToolTip (const ViewToolTip*, const ViewShortcuts&);
-  void            setToolTip (const ViewToolTip*);
-  void            resetTool ();
-  void            fromConfig ();
-  void            undo ();
-  void            redo ();
+  ViewMainWindow&  mainWindow ();
+  Config&          config ();
+  Cache&           cache ();
+  Camera&          camera ();
+  History&         history ();
+  Scene&           scene ();
+  SculptRecording& sculptRecording ();
+  bool             hasTool ();
+  Tool&            tool ();
+  void             setTool (ToolKey);
+  void             setPreviousTool ();
+  void             setToolTip (const ViewToolTip*, const ViewShortcuts&);
+  void             setToolTip (const ViewToolTip*);
+  void             resetTool ();
+  void             fromConfig ();
+  void             undo ();
+  void             redo ();
 
   void handleToolResponse (ToolResponse);
 
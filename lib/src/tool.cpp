@@ -16,6 +16,7 @@
 #include "mirror.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/triangle.hpp"
+#include "render-mode.hpp"
 #include "scene.hpp"
 #include "sketch/mesh.hpp"
 #include "state.hpp"
@@ -40,6 +41,8 @@ struct Tool::Impl
   QPushButton*         mirrorSyncButton;
   glm::ivec2           prevPointingEventPosition;
   std::array<bool, 26> keymap;
+  const KVStore::Key   mirrorKey;
+  const KVStore::Key   renderMirrorKey;
 
   Impl (Tool* s, State& st, const char* cacheKey)
     : self (s)
@@ -47,6 +50,8 @@ struct Tool::Impl
     , _cache (this->cache (cacheKey))
     , mirrorCheckBox (nullptr)
     , mirrorSyncButton (nullptr)
+    , mirrorKey (st.cache ().key ("editor/tool/mirror"))
+    , renderMirrorKey (st.config ().key ("editor/tool/sculpt/mirror/render"))
   {
     this->keymap.fill (false);
   }
@@ -63,15 +68,19 @@ struct Tool::Impl
 #endif
   }
 
+  void prepareRender () { this->self->runPrepareRender (); }
+
   void render () const
   {
     this->self->runRender ();
-    if (this->mirrorEnabled () && this->config ().get<bool> ("editor/tool/sculpt/mirror/render"))
+    if (this->mirrorEnabled () && this->config ().get<bool> (this->renderMirrorKey))
     {
       this->_mirror->render (this->state.camera ());
     }
   }
 
+  void finishRender () { this->self->runFinishRender (); }
+
   void paint (QPainter& painter) const { this->self->runPaint (painter); }
 
   void keyEvent (const ViewKeyEvent& e)
@@ -107,6 +116,8 @@ struct Tool::Impl
 
   void fromConfig ()
   {
+    this->self->runSynchronize ();
+
     if (this->_mirror)
     {
       this->_mirror->fromConfig (this->config ());
@@ -114,6 +125,8 @@ struct Tool::Impl
     this->self->runFromConfig ();
   }
 
+  void synchronize () { this->self->runSynchronize (); }
+
   void updateGlWidget () { this->state.mainWindow ().glWidget ().update (); }
 
   ViewTwoColumnGrid& properties () const
@@ -132,6 +145,20 @@ struct Tool::Impl
 
   glm::ivec2 cursorPosition () { return this->state.mainWindow ().glWidget ().cursorPosition (); }
 
+  // the hovered mesh is picked on the GPU, since it is only shown and not edited
+  void renderHoveredDynamicMesh () const
+  {
+    DynamicMesh* mesh = this->state.mainWindow ().glWidget ().pickDynamicMesh ();
+
+    if (mesh)
+    {
+      RenderMode renderMode (mesh->renderMode ());
+      renderMode.renderWireframe (true);
+
+      mesh->mesh ().render (this->state.camera (), renderMode, mesh->mesh ().color ());
+    }
+  }
+
   void snapshotAll () { this->state.history ().snapshotAll (this->state.scene ()); }
 
   void snapshotDynamicMeshes ()
@@ -144,20 +171,6 @@ struct Tool::Impl
     this->state.history ().snapshotSketchMeshes (this->state.scene ());
   }
 
-  bool intersectsRecentDynamicMesh (const PrimRay& ray, Intersection& intersection) const
-  {
-    assert (this->state.history ().hasRecentDynamicMesh ());
-
-    this->state.history ().forEachRecentDynamicMesh (
-      [&ray, &intersection](const DynamicMesh& mesh) { mesh.intersects (ray, intersection); });
-    return intersection.isIntersection ();
-  }
-
-  bool intersectsRecentDynamicMesh (const glm::ivec2& pos, Intersection& intersection) const
-  {
-    return this->intersectsRecentDynamicMesh (this->state.camera ().ray (pos), intersection);
-  }
-
   void supportsMirror ()
   {
     assert (bool(this->_mirror) == false);
@@ -167,7 +180,7 @@ struct Tool::Impl
 
   bool mirrorEnabled () const
   {
-    return this->_mirror && this->state.cache ().get ("editor/tool/mirror", true);
+    return this->_mirror && this->state.cache ().get (this->mirrorKey, true);
   }
 
   void mirrorPosition (const glm::vec3& p)
@@ -240,7 +253,7 @@ struct Tool::Impl
 
     this->mirrorCheckBox = &ViewUtil::checkBox (QObject::tr ("Mirror"), this->mirrorEnabled ());
     ViewUtil::connect (*this->mirrorCheckBox, [this](bool m) {
-      this->state.cache ().set ("editor/tool/mirror", m);
+      this->state.cache ().set (this->mirrorKey, m);
       this->mirrorSyncButton->setEnabled (m);
       this->updateGlWidget ();
     });
@@ -338,13 +351,16 @@ struct Tool::Impl
 
 DELEGATE2_BIG3_SELF (Tool, State&, const char*)
 DELEGATE (ToolResponse, Tool, initialize)
+DELEGATE (void, Tool, prepareRender)
 DELEGATE_CONST (void, Tool, render)
+DELEGATE (void, Tool, finishRender)
 DELEGATE1_CONST (void, Tool, paint, QPainter&)
 DELEGATE1 (void, Tool, keyEvent, const ViewKeyEvent&)
 DELEGATE1 (ToolResponse, Tool, pointingEvent, const ViewPointingEvent&)
 DELEGATE1 (ToolResponse, Tool, cursorUpdate, const glm::ivec2&)
 DELEGATE (ToolResponse, Tool, commit)
 DELEGATE (void, Tool, fromConfig)
+DELEGATE (void, Tool, synchronize)
 GETTER_CONST (State&, Tool, state)
 DELEGATE (void, Tool, updateGlWidget)
 DELEGATE_CONST (ViewTwoColumnGrid&, Tool, properties)
@@ -352,11 +368,10 @@ DELEGATE_CONST (Config&, Tool, config)
 DELEGATE (CacheProxy&, Tool, cache)
 DELEGATE1_CONST (CacheProxy, Tool, cache, const char*)
 DELEGATE_CONST (glm::ivec2, Tool, cursorPosition)
+DELEGATE_CONST (void, Tool, renderHoveredDynamicMesh)
 DELEGATE (void, Tool, snapshotAll)
 DELEGATE (void, Tool, snapshotDynamicMeshes)
 DELEGATE (void, Tool, snapshotSketchMeshes)
-DELEGATE2_CONST (bool, Tool, intersectsRecentDynamicMesh, const PrimRay&, Intersection&)
-DELEGATE2_CONST (bool, Tool, intersectsRecentDynamicMesh, const glm::ivec2&, Intersection&)
 DELEGATE (void, Tool, supportsMirror)
 DELEGATE_CONST (bool, Tool, mirrorEnabled)
 DELEGATE1 (void, Tool, mirrorPosition, const glm::vec3&)
@@ -40,13 +40,16 @@ public:
   virtual ToolKey getKey () const = 0;
 
   ToolResponse initialize ();
+  void         prepareRender ();
   void         render () const;
+  void         finishRender ();
   void         paint (QPainter&) const;
   void         keyEvent (const ViewKeyEvent&);
   ToolResponse pointingEvent (const ViewPointingEvent&);
   ToolResponse cursorUpdate (const glm::ivec2&);
   ToolResponse commit ();
   void         fromConfig ();
+  void         synchronize ();
 
 protected:
   State&             state () const;
@@ -56,11 +59,10 @@ protected:
   CacheProxy&        cache ();
   CacheProxy         cache (const char*) const;
   glm::ivec2         cursorPosition () const;
+  void               renderHoveredDynamicMesh () const;
   void               snapshotAll ();
   void               snapshotDynamicMeshes ();
   void               snapshotSketchMeshes ();
-  bool               intersectsRecentDynamicMesh (const PrimRay&, Intersection&) const;
-  bool               intersectsRecentDynamicMesh (const glm::ivec2&, Intersection&) const;
   void               supportsMirror ();
   bool               mirrorEnabled () const;
   void               mirrorPosition (const glm::vec3&);
@@ -81,8 +83,12 @@ private:
 
   virtual ToolResponse runInitialize () = 0;
 
+  virtual void runPrepareRender () {}
+
   virtual void runRender () const {}
 
+  virtual void runFinishRender () {}
+
   virtual void runPaint (QPainter&) const {}
 
   virtual ToolResponse runPointingEvent (const ViewPointingEvent&);
@@ -98,6 +104,8 @@ private:
   virtual ToolResponse runCommit () { return ToolResponse::None; }
 
   virtual void runFromConfig () {}
+
+  virtual void runSynchronize () {}
 };
 
 #define DECLARE_TOOL(keyName, otherMethods)              \
@@ -114,7 +122,9 @@ private:
     otherMethods                                         \
   };
 
+#define DECLARE_TOOL_RUN_PREPARE_RENDER void runPrepareRender ();
 #define DECLARE_TOOL_RUN_RENDER void runRender () const;
+#define DECLARE_TOOL_RUN_FINISH_RENDER void runFinishRender ();
 #define DECLARE_TOOL_RUN_PAINT void runPaint (QPainter&) const;
 #define DECLARE_TOOL_RUN_POINTING_EVENT ToolResponse runPointingEvent (const ViewPointingEvent&);
 #define DECLARE_TOOL_RUN_PRESS_EVENT ToolResponse runPressEvent (const ViewPointingEvent&);
@@ -123,12 +133,15 @@ private:
 #define DECLARE_TOOL_RUN_CURSOR_UPDATE ToolResponse runCursorUpdate (const glm::ivec2&);
 #define DECLARE_TOOL_RUN_COMMIT ToolResponse runCommit ();
 #define DECLARE_TOOL_RUN_FROM_CONFIG void runFromConfig ();
+#define DECLARE_TOOL_RUN_SYNCHRONIZE void runSynchronize ();
 
 #define DELEGATE_TOOL(name)                                        \
   DELEGATE_BIG2_BASE (name, (State & s), (this), Tool, (s, #name)) \
   DELEGATE (ToolResponse, name, runInitialize)
 
+#define DELEGATE_TOOL_RUN_PREPARE_RENDER(n) DELEGATE (void, n, runPrepareRender)
 #define DELEGATE_TOOL_RUN_RENDER(n) DELEGATE_CONST (void, n, runRender)
+#define DELEGATE_TOOL_RUN_FINISH_RENDER(n) DELEGATE (void, n, runFinishRender)
 #define DELEGATE_TOOL_RUN_PAINT(n) DELEGATE1_CONST (void, n, runPaint, QPainter&)
 #define DELEGATE_TOOL_RUN_POINTING_EVENT(n) \
   DELEGATE1 (ToolResponse, n, runPointingEvent, const ViewPointingEvent&)
@@ -142,5 +155,6 @@ private:
   DELEGATE1 (ToolResponse, n, runCursorUpdate, const glm::ivec2&)
 #define DELEGATE_TOOL_RUN_COMMIT(n) DELEGATE (ToolResponse, n, runCommit)
 #define DELEGATE_TOOL_RUN_FROM_CONFIG(n) DELEGATE (void, n, runFromConfig)
+#define DELEGATE_TOOL_RUN_SYNCHRONIZE(n) DELEGATE (void, n, runSynchronize)
 
 #endif
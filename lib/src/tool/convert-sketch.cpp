@@ -3,37 +3,93 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <future>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
 #include "cache.hpp"
-#include "distance.hpp"
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
-#include "primitive/cone-sphere.hpp"
+#include "render-mode.hpp"
 #include "scene.hpp"
 #include "sketch/mesh-intersection.hpp"
 #include "sketch/mesh.hpp"
-#include "sketch/path.hpp"
+#include "sketch/primitives.hpp"
 #include "state.hpp"
+#include "tool/convert-sketch/action.hpp"
+#include "tool/convert-sketch/cache.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "tools.hpp"
+#include "view/double-slider.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
 #include "view/two-column-grid.hpp"
 #include "view/util.hpp"
 
+namespace
+{
+  // previews are extracted at 8, 4, 2 and 1 times the resolution
+  static const unsigned int numPreviewStages = 4;
+}
+
 struct ToolConvertSketch::Impl
 {
   ToolConvertSketch* self;
   float              resolution;
+  float              blend;
+  bool               adaptive;
+  bool               preview;
+  int                faceBudget;
+
+  ViewResolutionSlider* resolutionEdit;
+  QLabel*               estimateEdit;
+  const SketchMesh*     estimatedSketch;
+  std::size_t           estimatedKey;
+  float                 estimatedArea;
+
+  std::size_t                                  previewKey;
+  std::shared_ptr<const SketchPrimitives>      previewPrimitives;
+  glm::vec3                                    previewMin;
+  glm::vec3                                    previewMax;
+  unsigned int                                 previewStage;
+  std::shared_ptr<IsosurfaceExtractionContext> previewContext;
+  std::future<DynamicMesh>                     previewJob;
+  std::unique_ptr<DynamicMesh>                 previewMesh;
+
+  // the bricks of the last extraction of each stage
+  std::vector<std::shared_ptr<ToolConvertSketchCache>> previewCaches;
 
   Impl (ToolConvertSketch* s)
     : self (s)
     , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , blend (s->cache ().get<float> ("blend", 0.0f))
+    , adaptive (s->cache ().get<bool> ("adaptive", false))
+    , preview (s->cache ().get<bool> ("preview", false))
+    , faceBudget (s->cache ().get<int> ("face-budget", 1000000))
+    , resolutionEdit (nullptr)
+    , estimateEdit (nullptr)
+    , estimatedSketch (nullptr)
+    , estimatedKey (0)
+    , estimatedArea (0.0f)
+    , previewKey (0)
+    , previewStage (0)
+    , previewContext (std::make_shared<IsosurfaceExtractionContext> ())
   {
+    for (unsigned int i = 0; i < numPreviewStages; i++)
+    {
+      this->previewCaches.push_back (std::make_shared<ToolConvertSketchCache> ());
+    }
   }
 
+  ~Impl () { this->stopPreview (); }
+
   ToolResponse runInitialize ()
   {
     this->setupProperties ();
@@ -46,13 +102,107 @@ struct ToolConvertSketch::Impl
   {
     ViewTwoColumnGrid& properties = this->self->properties ();
 
-    ViewResolutionSlider& resolutionEdit =
-      ViewUtil::resolutionSlider (0.01f, this->resolution, 0.1f);
-    ViewUtil::connect (resolutionEdit, [this](float r) {
+    this->resolutionEdit = &ViewUtil::resolutionSlider (0.01f, this->resolution, 0.1f);
+    ViewUtil::connect (*this->resolutionEdit, [this](float r) {
       this->resolution = r;
       this->self->cache ().set ("resolution", r);
+      this->restartPreview ();
+      this->showEstimate ();
+    });
+    properties.addStacked (QObject::tr ("Resolution"), *this->resolutionEdit);
+
+    this->estimateEdit = new QLabel;
+    properties.add (QObject::tr ("Estimate"), *this->estimateEdit);
+
+    QSpinBox& budgetEdit = ViewUtil::spinBox (10000, this->faceBudget, 100000000, 10000);
+    ViewUtil::connect (budgetEdit, [this](int b) {
+      this->faceBudget = b;
+      this->self->cache ().set ("face-budget", b);
+    });
+    QPushButton& fitEdit = ViewUtil::pushButton (QObject::tr ("Fit"));
+    ViewUtil::connect (fitEdit, [this]() {
+      if (this->estimatedArea > 0.0f)
+      {
+        this->resolutionEdit->setResolution (IsosurfaceExtraction::estimateResolution (
+          this->estimatedArea, (unsigned int) (this->faceBudget)));
+      }
     });
-    properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
+    properties.add (QObject::tr ("Face budget"), budgetEdit);
+    properties.add (fitEdit);
+    this->showEstimate ();
+
+    ViewDoubleSlider& blendEdit = ViewUtil::slider (2, 0.0f, this->blend, 0.5f);
+    ViewUtil::connect (blendEdit, [this](float b) {
+      this->blend = b;
+      this->self->cache ().set ("blend", b);
+      this->restartPreview ();
+      // blending changes the area
+      this->estimatedSketch = nullptr;
+    });
+    properties.addStacked (QObject::tr ("Blend"), blendEdit);
+
+    QCheckBox& adaptiveEdit = ViewUtil::checkBox (QObject::tr ("Adaptive"), this->adaptive);
+    ViewUtil::connect (adaptiveEdit, [this](bool a) {
+      this->adaptive = a;
+      this->self->cache ().set ("adaptive", a);
+    });
+    properties.add (adaptiveEdit);
+
+    QCheckBox& previewEdit = ViewUtil::checkBox (QObject::tr ("Preview"), this->preview);
+    ViewUtil::connect (previewEdit, [this](bool p) {
+      this->preview = p;
+      this->self->cache ().set ("preview", p);
+      this->restartPreview ();
+    });
+    properties.add (previewEdit);
+
+    QPushButton& allEdit = ViewUtil::pushButton (QObject::tr ("Convert all"));
+    ViewUtil::connect (allEdit, [this]() { this->convertAll (); });
+    properties.add (allEdit);
+  }
+
+  // estimates the mesh that converting the hovered sketch would produce (cf. `fitEdit`)
+  void showEstimate ()
+  {
+    if (this->estimateEdit == nullptr)
+    {
+      return;
+    }
+    else if (this->estimatedArea <= 0.0f)
+    {
+      this->estimateEdit->setText (QObject::tr ("-"));
+    }
+    else
+    {
+      const unsigned int numFaces =
+        IsosurfaceExtraction::estimateNumFaces (this->estimatedArea, this->resolution);
+
+      this->estimateEdit->setText (
+        QObject::tr ("%1 faces, %2")
+          .arg (numFaces)
+          .arg (ViewUtil::byteSize (IsosurfaceExtraction::estimateNumBytes (numFaces))));
+    }
+  }
+
+  void updateEstimate (const ViewPointingEvent& e)
+  {
+    SketchMeshIntersection intersection;
+    if (this->self->intersectsScene (e, intersection))
+    {
+      const SketchMesh& sketch = intersection.mesh ();
+
+      if (&sketch != this->estimatedSketch || sketch.renderKey () != this->estimatedKey)
+      {
+        glm::vec3 min, max;
+        sketch.minMax (min, max);
+
+        this->estimatedSketch = &sketch;
+        this->estimatedKey = sketch.renderKey ();
+        this->estimatedArea =
+          ToolConvertSketchAction::area (sketch.primitives (), min, max, this->blend);
+        this->showEstimate ();
+      }
+    }
   }
 
   void setupToolTip ()
@@ -62,41 +212,207 @@ struct ToolConvertSketch::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
+  // reuses the bricks of the last stage of the preview, which has the same resolution
   DynamicMesh& convert (SketchMesh& sketch)
   {
     glm::vec3 min, max;
     sketch.minMax (min, max);
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&sketch](const glm::vec3& pos) {
-      float distance = Util::maxFloat ();
+    sketch.optimizePaths ();
+
+    DynamicMesh mesh;
+    this->previewCaches.back ()->convert (sketch.primitives (), min, max, this->resolution,
+                                          this->blend, mesh);
+
+    State& state = this->self->state ();
+    return state.scene ().newDynamicMesh (state.config (), mesh);
+  }
+
+  void finalizeMesh (DynamicMesh& mesh)
+  {
+    ToolSculptAction::smoothMesh (mesh);
+    if (this->adaptive)
+    {
+      ToolSculptAction::coarsenFlatRegions (mesh, this->resolution);
+    }
+  }
 
-      if (sketch.tree ().hasRoot ())
+  /* Converts all sketches of the scene with a single snapshot.  Sketches are extracted
+   * concurrently as long as their estimated sizes fit into the memory budget, where the area of
+   * each sketch is estimated by a coarse extraction first.
+   */
+  void convertAll ()
+  {
+    State&                   state = this->self->state ();
+    std::vector<SketchMesh*> sketches;
+
+    state.scene ().forEachMesh ([&sketches](SketchMesh& sketch) { sketches.push_back (&sketch); });
+    if (sketches.empty ())
+    {
+      return;
+    }
+
+    this->stopPreview ();
+    this->self->snapshotAll ();
+
+    // primitives are cached by their sketches, hence they are built before extracting
+    std::vector<const SketchPrimitives*> primitives (sketches.size ());
+    std::vector<glm::vec3>               mins (sketches.size ());
+    std::vector<glm::vec3>               maxs (sketches.size ());
+    for (unsigned int i = 0; i < sketches.size (); i++)
+    {
+      sketches[i]->minMax (mins[i], maxs[i]);
+      sketches[i]->optimizePaths ();
+      primitives[i] = &sketches[i]->primitives ();
+    }
+
+    std::vector<std::size_t> costs (sketches.size ());
+    Parallel::forEach (sketches.size (), [this, &primitives, &mins, &maxs, &costs](unsigned int i) {
+      const float area =
+        ToolConvertSketchAction::area (*primitives[i], mins[i], maxs[i], this->blend);
+      costs[i] = IsosurfaceExtraction::estimateNumBytes (
+        IsosurfaceExtraction::estimateNumFaces (area, this->resolution));
+    });
+
+    const int                budget = state.config ().get<int> ("editor/memory-budget");
+    std::vector<DynamicMesh> meshes (sketches.size ());
+    Parallel::forEach (costs, std::size_t (std::max (0, budget)) * 1024 * 1024,
+                       [this, &primitives, &mins, &maxs, &meshes](unsigned int i) {
+                         ToolConvertSketchAction::convert (*primitives[i], mins[i], maxs[i],
+                                                           this->resolution, this->blend,
+                                                           meshes[i]);
+                       });
+
+    for (unsigned int i = 0; i < sketches.size (); i++)
+    {
+      this->finalizeMesh (state.scene ().newDynamicMesh (state.config (), meshes[i]));
+      state.scene ().deleteMesh (*sketches[i]);
+    }
+    this->self->updateGlWidget ();
+  }
+
+  /* The hovered sketch is previewed by extracting it from coarse to fine resolutions in the
+   * background.  Each stage starts when the last one is finished and replaces the previewed mesh.
+   * Changes of the sketch or of the parameters cancel the running stage.  All stages share an
+   * extraction context, which retains the buffers of the extraction.  Each stage caches its
+   * bricks, so a changed sketch only reextracts the bricks near its changed primitives.
+   */
+  void updatePreview (const ViewPointingEvent& e)
+  {
+    SketchMeshIntersection intersection;
+    if (this->preview && this->self->intersectsScene (e, intersection))
+    {
+      const SketchMesh& sketch = intersection.mesh ();
+
+      if (sketch.renderKey () != this->previewKey || this->previewPrimitives == nullptr)
       {
-        sketch.tree ().root ().forEachConstNode ([&pos, &distance](const SketchNode& node) {
-          const float d =
-            node.parent ()
-              ? Distance::distance (PrimConeSphere (node.data (), node.parent ()->data ()), pos)
-              : Distance::distance (node.data (), pos);
-
-          distance = glm::min (distance, d);
-        });
+        this->stopPreview ();
+        this->previewKey = sketch.renderKey ();
+        this->previewPrimitives = std::make_shared<const SketchPrimitives> (sketch.primitives ());
+        sketch.minMax (this->previewMin, this->previewMax);
+        this->startPreviewStage ();
+        this->self->updateGlWidget ();
       }
-      for (const SketchPath& p : sketch.paths ())
+    }
+    else if (this->previewPrimitives)
+    {
+      this->stopPreview ();
+      this->self->updateGlWidget ();
+    }
+  }
+
+  void restartPreview ()
+  {
+    if (this->preview == false)
+    {
+      this->stopPreview ();
+    }
+    else if (this->previewPrimitives)
+    {
+      this->cancelPreviewStage ();
+      this->previewStage = 0;
+      this->startPreviewStage ();
+    }
+    this->self->updateGlWidget ();
+  }
+
+  void startPreviewStage ()
+  {
+    assert (this->previewPrimitives);
+    assert (this->previewJob.valid () == false);
+    assert (this->previewStage < numPreviewStages);
+
+    const float resolution =
+      this->resolution * float (1 << (numPreviewStages - this->previewStage - 1));
+
+    this->previewContext->resetCancellation ();
+    this->previewJob =
+      std::async (std::launch::async,
+                  [primitives = this->previewPrimitives, min = this->previewMin,
+                   max = this->previewMax, resolution, blend = this->blend,
+                   context = this->previewContext,
+                   cache = this->previewCaches[this->previewStage]]() {
+                    DynamicMesh mesh;
+                    cache->convert (*primitives, min, max, resolution, blend, mesh,
+                                    context.get ());
+                    return mesh;
+                  });
+  }
+
+  void cancelPreviewStage ()
+  {
+    if (this->previewJob.valid ())
+    {
+      this->previewContext->cancel ();
+      this->previewJob.wait ();
+      this->previewJob = std::future<DynamicMesh> ();
+    }
+  }
+
+  void stopPreview ()
+  {
+    this->cancelPreviewStage ();
+    this->previewKey = 0;
+    this->previewPrimitives.reset ();
+    this->previewStage = 0;
+    this->previewMesh.reset ();
+  }
+
+  void runPrepareRender ()
+  {
+    if (this->previewJob.valid ())
+    {
+      if (this->previewJob.wait_for (std::chrono::seconds (0)) == std::future_status::ready)
       {
-        for (const PrimSphere& s : p.spheres ())
+        this->previewMesh.reset (new DynamicMesh (this->previewJob.get ()));
+        this->previewMesh->fromConfig (this->self->state ().config ());
+        this->previewMesh->bufferData ();
+        this->previewStage++;
+
+        if (this->previewStage < numPreviewStages)
         {
-          distance = glm::min (distance, Distance::distance (s, pos));
+          this->startPreviewStage ();
         }
       }
-      return distance;
-    };
+      this->self->updateGlWidget ();
+    }
+  }
 
-    sketch.optimizePaths ();
-    DynamicMesh mesh;
-    IsosurfaceExtraction::extract (getDistance, PrimAABox (min, max), this->resolution, mesh);
+  void runRender () const
+  {
+    if (this->previewMesh && this->previewMesh->isEmpty () == false)
+    {
+      this->previewMesh->renderMode () = this->self->state ().scene ().commonRenderMode ();
+      this->previewMesh->renderMode ().renderWireframe (true);
+      this->previewMesh->render (this->self->state ().camera ());
+    }
+  }
 
-    State& state = this->self->state ();
-    return state.scene ().newDynamicMesh (state.config (), mesh);
+  ToolResponse runMoveEvent (const ViewPointingEvent& e)
+  {
+    this->updateEstimate (e);
+    this->updatePreview (e);
+    return ToolResponse::None;
   }
 
   ToolResponse runReleaseEvent (const ViewPointingEvent& e)
@@ -108,9 +424,10 @@ struct ToolConvertSketch::Impl
       {
         SketchMesh& sMesh = intersection.mesh ();
 
+        this->stopPreview ();
         this->self->snapshotAll ();
 
-        ToolSculptAction::smoothMesh (this->convert (sMesh));
+        this->finalizeMesh (this->convert (sMesh));
         this->self->state ().scene ().deleteMesh (sMesh);
         return ToolResponse::Redraw;
       }
@@ -120,4 +437,7 @@ struct ToolConvertSketch::Impl
 };
 
 DELEGATE_TOOL (ToolConvertSketch)
+DELEGATE_TOOL_RUN_PREPARE_RENDER (ToolConvertSketch)
+DELEGATE_TOOL_RUN_RENDER (ToolConvertSketch)
+DELEGATE_TOOL_RUN_MOVE_EVENT (ToolConvertSketch)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolConvertSketch)
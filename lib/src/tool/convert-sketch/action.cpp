@@ -0,0 +1,54 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "primitive/aabox.hpp"
+#include "sketch/primitives.hpp"
+#include "tool/convert-sketch/action.hpp"
+
+namespace
+{
+  // coarse extractions capture the area of a sketch well, since sketches are smooth
+  constexpr unsigned int areaSamplesPerExtent = 32;
+}
+
+namespace ToolConvertSketchAction
+{
+  bool convert (const SketchPrimitives& primitives, const glm::vec3& min, const glm::vec3& max,
+                float resolution, float blend, DynamicMesh& mesh,
+                IsosurfaceExtractionContext* context)
+  {
+    const IsosurfaceExtraction::DistancesCallback getDistances =
+      [&primitives, blend](const std::vector<glm::vec3>& positions,
+                           std::vector<float>&           distances) {
+        primitives.distances (positions, distances, blend);
+      };
+    const IsosurfaceExtraction::NearCallback isNear = [&primitives, blend](const PrimAABox& box) {
+      return primitives.isNear (box, blend);
+    };
+
+    // blending grows the surface by at most a quarter of the blend radius
+    const glm::vec3 margin (blend);
+    return IsosurfaceExtraction::extractNarrowBand (getDistances, isNear,
+                                                    PrimAABox (min - margin, max + margin),
+                                                    resolution, mesh, context);
+  }
+
+  float area (const SketchPrimitives& primitives, const glm::vec3& min, const glm::vec3& max,
+              float blend)
+  {
+    const float extent = glm::max (max.x - min.x, glm::max (max.y - min.y, max.z - min.z));
+    DynamicMesh mesh;
+
+    if (extent > 0.0f &&
+        convert (primitives, min, max, extent / float(areaSamplesPerExtent), blend, mesh))
+    {
+      return mesh.area ();
+    }
+    return 0.0f;
+  }
+}
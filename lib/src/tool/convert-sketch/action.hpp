@@ -0,0 +1,23 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_CONVERT_SKETCH_ACTION
+#define DILAY_TOOL_CONVERT_SKETCH_ACTION
+
+#include <glm/fwd.hpp>
+
+class DynamicMesh;
+class IsosurfaceExtractionContext;
+class SketchPrimitives;
+
+namespace ToolConvertSketchAction
+{
+  // extracts the surface of primitives within the given bounds (min, max, resolution, blend)
+  bool convert (const SketchPrimitives&, const glm::vec3&, const glm::vec3&, float, float,
+                DynamicMesh&, IsosurfaceExtractionContext* = nullptr);
+  // estimates the surface area of primitives by a coarse extraction (min, max, blend)
+  float area (const SketchPrimitives&, const glm::vec3&, const glm::vec3&, float);
+}
+
+#endif
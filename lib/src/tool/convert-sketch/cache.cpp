@@ -0,0 +1,169 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "isosurface-extraction.hpp"
+#include "isosurface-extraction/shard.hpp"
+#include "primitive/aabox.hpp"
+#include "sketch/primitives.hpp"
+#include "tool/convert-sketch/cache.hpp"
+
+namespace
+{
+  // the number of samples along each side of a brick
+  constexpr unsigned int brickSize = 16;
+
+  // packs the index of a brick into 63 bits
+  std::uint64_t brickIndexKey (const glm::ivec3& index)
+  {
+    const glm::uvec3 i = glm::uvec3 (index + glm::ivec3 (1 << 20)) & glm::uvec3 ((1 << 21) - 1);
+
+    return (std::uint64_t (i.z) << 42) | (std::uint64_t (i.y) << 21) | std::uint64_t (i.x);
+  }
+}
+
+struct ToolConvertSketchCache::Impl
+{
+  float                                           resolution;
+  float                                           blend;
+  std::vector<IsosurfaceExtractionShard>          bricks;
+  std::vector<std::size_t>                        primitiveKeys;
+  std::unordered_map<std::uint64_t, unsigned int> brickIndices;
+
+  Impl ()
+    : resolution (0.0f)
+    , blend (0.0f)
+  {
+  }
+
+  /* Bricks are skipped if no primitive comes near them.  The samples of a brick that determine
+   * its faces are at most a few cells away from the surface, so primitives that are further away
+   * than the blend radius plus two cells do not affect its faces and are not part of its key.
+   */
+  bool convert (const SketchPrimitives& primitives, const glm::vec3& min, const glm::vec3& max,
+                float resolution, float blend, DynamicMesh& mesh,
+                IsosurfaceExtractionContext* context)
+  {
+    if (resolution != this->resolution || blend != this->blend)
+    {
+      this->reset ();
+      this->resolution = resolution;
+      this->blend = blend;
+    }
+
+    const IsosurfaceExtraction::DistancesCallback getDistances =
+      [&primitives, blend](const std::vector<glm::vec3>& positions,
+                           std::vector<float>&           distances) {
+        primitives.distances (positions, distances, blend);
+      };
+    const IsosurfaceExtraction::NearCallback isNear = [&primitives, blend](const PrimAABox& box) {
+      return primitives.isNear (box, blend);
+    };
+    const float     keyMargin = blend + (2.0f * resolution);
+    const glm::vec3 margin (blend);
+    glm::ivec3                                      minIndex, maxIndex;
+
+    IsosurfaceExtraction::anchoredShards (PrimAABox (min - margin, max + margin), resolution,
+                                          brickSize, minIndex, maxIndex);
+
+    std::vector<IsosurfaceExtractionShard>          bricks;
+    std::vector<std::size_t>                        primitiveKeys;
+    std::unordered_map<std::uint64_t, unsigned int> brickIndices;
+    std::vector<bool>                               isReused (this->bricks.size (), false);
+    bool                                            isCancelled = false;
+    glm::ivec3                                      lastIndex;
+
+    for (int z = minIndex.z; z <= maxIndex.z && isCancelled == false; z++)
+    {
+      for (int y = minIndex.y; y <= maxIndex.y && isCancelled == false; y++)
+      {
+        for (int x = minIndex.x; x <= maxIndex.x && isCancelled == false; x++)
+        {
+          const glm::ivec3 index (x, y, z);
+          const PrimAABox  box =
+            IsosurfaceExtraction::anchoredShardBounds (resolution, brickSize, index);
+
+          if (primitives.isNear (box, blend) == false)
+          {
+            continue;
+          }
+
+          const std::uint64_t indexKey = brickIndexKey (index);
+          const std::size_t   primitiveKey = primitives.hash (box, keyMargin);
+          const auto          cached = this->brickIndices.find (indexKey);
+
+          brickIndices.emplace (indexKey, (unsigned int) bricks.size ());
+          primitiveKeys.push_back (primitiveKey);
+
+          if (cached != this->brickIndices.end () &&
+              this->primitiveKeys[cached->second] == primitiveKey)
+          {
+            bricks.push_back (std::move (this->bricks[cached->second]));
+            isReused[cached->second] = true;
+          }
+          else
+          {
+            lastIndex = index;
+            bricks.emplace_back ();
+            isCancelled =
+              IsosurfaceExtraction::extractAnchoredShard (getDistances, isNear, resolution,
+                                                          brickSize, index, bricks.back (),
+                                                          context) == false;
+          }
+        }
+      }
+    }
+
+    // a cancelled conversion keeps the cached bricks that it has not reached yet
+    if (isCancelled)
+    {
+      brickIndices.erase (brickIndexKey (lastIndex));
+      bricks.pop_back ();
+      primitiveKeys.pop_back ();
+
+      for (const auto& b : this->brickIndices)
+      {
+        if (isReused[b.second] == false && brickIndices.count (b.first) == 0)
+        {
+          brickIndices.emplace (b.first, (unsigned int) bricks.size ());
+          primitiveKeys.push_back (this->primitiveKeys[b.second]);
+          bricks.push_back (std::move (this->bricks[b.second]));
+        }
+      }
+    }
+
+    this->bricks = std::move (bricks);
+    this->primitiveKeys = std::move (primitiveKeys);
+    this->brickIndices = std::move (brickIndices);
+
+    if (isCancelled)
+    {
+      return false;
+    }
+    IsosurfaceExtraction::stitch (this->bricks, mesh);
+    return true;
+  }
+
+  void reset ()
+  {
+    this->bricks.clear ();
+    this->primitiveKeys.clear ();
+    this->brickIndices.clear ();
+  }
+};
+
+DELEGATE_BIG3 (ToolConvertSketchCache)
+
+bool ToolConvertSketchCache::convert (const SketchPrimitives& primitives, const glm::vec3& min,
+                                      const glm::vec3& max, float resolution, float blend,
+                                      DynamicMesh& mesh, IsosurfaceExtractionContext* context)
+{
+  return this->impl->convert (primitives, min, max, resolution, blend, mesh, context);
+}
+
+DELEGATE (void, ToolConvertSketchCache, reset)
@@ -0,0 +1,34 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_CONVERT_SKETCH_CACHE
+#define DILAY_TOOL_CONVERT_SKETCH_CACHE
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class DynamicMesh;
+class IsosurfaceExtractionContext;
+class SketchPrimitives;
+
+/* Caches the bricks of the last conversion, i.e., the anchored shards of its surface (cf.
+ * `IsosurfaceExtraction::extractAnchoredShard`), keyed by the primitives near each brick.  A
+ * conversion only reextracts the bricks whose primitives have changed and stitches them with the
+ * cached bricks.  Bricks of other resolutions or blend radii are dropped.
+ */
+class ToolConvertSketchCache
+{
+public:
+  DECLARE_BIG3 (ToolConvertSketchCache)
+
+  // cf. `ToolConvertSketchAction::convert`
+  bool convert (const SketchPrimitives&, const glm::vec3&, const glm::vec3&, float, float,
+                DynamicMesh&, IsosurfaceExtractionContext* = nullptr);
+  void reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,187 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QSpinBox>
+#include "cache.hpp"
+#include "camera.hpp"
+#include "color.hpp"
+#include "config.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "history.hpp"
+#include "primitive/sphere.hpp"
+#include "state.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tools.hpp"
+#include "view/cursor.hpp"
+#include "view/double-slider.hpp"
+#include "view/pointing-event.hpp"
+#include "view/tool-tip.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+namespace
+{
+  enum class Mode
+  {
+    Mesh,
+    Region
+  };
+}
+
+struct ToolDecimateMesh::Impl
+{
+  ToolDecimateMesh* self;
+  Mode              mode;
+  int               numFaces;
+  ViewDoubleSlider& ratioEdit;
+  ViewDoubleSlider& radiusEdit;
+  ViewCursor        cursor;
+
+  Impl (ToolDecimateMesh* s)
+    : self (s)
+    , mode (Mode (s->cache ().get<int> ("mode", int(Mode::Mesh))))
+    , numFaces (s->cache ().get<int> ("num-faces", 200000))
+    , ratioEdit (ViewUtil::slider (2, 0.05f, s->cache ().get<float> ("ratio", 0.5f), 0.95f))
+    , radiusEdit (ViewUtil::slider (2, 0.05f, s->cache ().get<float> ("radius", 0.2f), 1.0f))
+  {
+  }
+
+  void setupProperties ()
+  {
+    ViewTwoColumnGrid& properties = this->self->properties ();
+
+    QSpinBox& numFacesEdit = ViewUtil::spinBox (1000, this->numFaces, 50000000, 1000);
+
+    QButtonGroup& modeEdit =
+      ViewUtil::buttonGroup ({QObject::tr ("Mesh"), QObject::tr ("Region")});
+    ViewUtil::connect (modeEdit, int(this->mode), [this, &numFacesEdit](int id) {
+      this->mode = Mode (id);
+      this->self->cache ().set ("mode", id);
+      numFacesEdit.setEnabled (this->mode == Mode::Mesh);
+      this->ratioEdit.setEnabled (this->mode == Mode::Region);
+      this->radiusEdit.setEnabled (this->mode == Mode::Region);
+      this->cursor.disable ();
+    });
+    properties.add (modeEdit);
+
+    ViewUtil::connect (numFacesEdit, [this](int n) {
+      this->numFaces = n;
+      this->self->cache ().set ("num-faces", n);
+    });
+    numFacesEdit.setEnabled (this->mode == Mode::Mesh);
+    properties.add (QObject::tr ("Faces"), numFacesEdit);
+
+    ViewUtil::connect (this->ratioEdit,
+                       [this](float r) { this->self->cache ().set ("ratio", r); });
+    this->ratioEdit.setEnabled (this->mode == Mode::Region);
+    properties.addStacked (QObject::tr ("Remaining faces"), this->ratioEdit);
+
+    ViewUtil::connect (this->radiusEdit, [this](float r) {
+      this->cursor.radius (r);
+      this->self->cache ().set ("radius", r);
+    });
+    this->radiusEdit.setEnabled (this->mode == Mode::Region);
+    properties.addStacked (QObject::tr ("Radius"), this->radiusEdit);
+  }
+
+  void setupToolTip ()
+  {
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Decimate selection"));
+    this->self->state ().setToolTip (&toolTip);
+  }
+
+  void setupCursor ()
+  {
+    this->cursor.disable ();
+    this->cursor.radius (this->radiusEdit.doubleValue ());
+  }
+
+  ToolResponse runInitialize ()
+  {
+    this->setupProperties ();
+    this->setupToolTip ();
+    this->setupCursor ();
+
+    return ToolResponse::None;
+  }
+
+  void runRender () const
+  {
+    if (this->cursor.isEnabled ())
+    {
+      this->cursor.render (this->self->state ().camera ());
+    }
+  }
+
+  ToolResponse runMoveEvent (const ViewPointingEvent& e)
+  {
+    if (this->mode == Mode::Region)
+    {
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e.position (), intersection))
+      {
+        this->cursor.enable ();
+        this->cursor.position (intersection.position ());
+      }
+      else
+      {
+        this->cursor.disable ();
+      }
+      return ToolResponse::Redraw;
+    }
+    return ToolResponse::None;
+  }
+
+  ToolResponse runReleaseEvent (const ViewPointingEvent& e)
+  {
+    DynamicMeshIntersection intersection;
+
+    if (e.leftButton () == false ||
+        this->self->intersectsScene (e.position (), intersection) == false)
+    {
+      return ToolResponse::None;
+    }
+
+    State&       state = this->self->state ();
+    DynamicMesh& mesh = intersection.mesh ();
+    bool         decimated;
+
+    this->self->snapshotDynamicMeshes ();
+
+    if (this->mode == Mode::Mesh)
+    {
+      decimated = ToolSculptAction::decimateMesh (mesh, (unsigned int) (this->numFaces));
+    }
+    else
+    {
+      const PrimSphere sphere (intersection.position (), this->radiusEdit.doubleValue ());
+      decimated = ToolSculptAction::decimateMesh (mesh, sphere, this->ratioEdit.doubleValue ());
+    }
+
+    // unchanged meshes are not recorded
+    if (decimated == false)
+    {
+      state.undo ();
+      state.history ().dropFutureSnapshot ();
+      return ToolResponse::None;
+    }
+    return ToolResponse::Redraw;
+  }
+
+  ToolResponse runCommit () { return ToolResponse::Redraw; }
+
+  void runFromConfig ()
+  {
+    this->cursor.color (this->self->config ().get<Color> ("editor/tool/cursor-color"));
+  }
+};
+
+DELEGATE_TOOL (ToolDecimateMesh)
+DELEGATE_TOOL_RUN_RENDER (ToolDecimateMesh)
+DELEGATE_TOOL_RUN_MOVE_EVENT (ToolDecimateMesh)
+DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolDecimateMesh)
+DELEGATE_TOOL_RUN_COMMIT (ToolDecimateMesh)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolDecimateMesh)
@@ -28,6 +28,10 @@ struct ToolDeleteMesh::Impl
     return ToolResponse::None;
   }
 
+  void runRender () const { this->self->renderHoveredDynamicMesh (); }
+
+  ToolResponse runMoveEvent (const ViewPointingEvent&) { return ToolResponse::Redraw; }
+
   ToolResponse runReleaseEvent (const ViewPointingEvent& e)
   {
     if (e.leftButton ())
@@ -46,4 +50,6 @@ struct ToolDeleteMesh::Impl
 };
 
 DELEGATE_TOOL (ToolDeleteMesh)
+DELEGATE_TOOL_RUN_RENDER (ToolDeleteMesh)
+DELEGATE_TOOL_RUN_MOVE_EVENT (ToolDeleteMesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolDeleteMesh)
@@ -19,12 +19,14 @@ enum class ToolKey
   SculptCrease,
   SculptPinch,
   SculptReduce,
+  SculptFreeze,
   EditSketch,
   DeleteSketch,
   ConvertSketch,
   SketchSpheres,
   TrimMesh,
   Remesh,
+  DecimateMesh,
   MoveCamera
 };
 
@@ -8,6 +8,7 @@
 #include "config.hpp"
 #include "dimension.hpp"
 #include "intersection.hpp"
+#include "scene.hpp"
 #include "state.hpp"
 #include "tools.hpp"
 #include "view/floor-plane.hpp"
@@ -76,6 +77,8 @@ struct ToolMoveCamera::Impl
       const glm::vec2& resolution = glm::vec2 (cam.resolution ());
       const glm::vec2  delta = glm::vec2 (e.position ()) - glm::vec2 (this->oldPos);
 
+      this->self->state ().scene ().renderLodProxies (true);
+
       if (e.modifiers () == Qt::NoModifier)
       {
         if (delta.x != 0.0f)
@@ -118,6 +121,19 @@ struct ToolMoveCamera::Impl
     }
   }
 
+  // meshes are rendered at full resolution once the camera stops
+  ToolResponse runReleaseEvent (const ViewPointingEvent&)
+  {
+    Scene& scene = this->self->state ().scene ();
+
+    if (scene.renderLodProxies ())
+    {
+      scene.renderLodProxies (false);
+      return ToolResponse::Redraw;
+    }
+    return ToolResponse::None;
+  }
+
   ToolResponse runPressEvent (const ViewPointingEvent& e)
   {
     if (this->mouseButton (e) && e.modifiers () == Qt::AltModifier)
@@ -216,6 +232,7 @@ DELEGATE_CONSTRUCTOR_BASE (ToolMoveCamera, (State & s, bool i), (this, i), Tool,
 DELEGATE_TOOL (ToolMoveCamera)
 DELEGATE_TOOL_RUN_MOVE_EVENT (ToolMoveCamera)
 DELEGATE_TOOL_RUN_PRESS_EVENT (ToolMoveCamera)
+DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolMoveCamera)
 DELEGATE_TOOL_RUN_FROM_CONFIG (ToolMoveCamera)
 DELEGATE1 (ToolResponse, ToolMoveCamera, wheelEvent, const QWheelEvent&)
 DELEGATE (void, ToolMoveCamera, snap)
@@ -28,6 +28,7 @@ private:
   ToolResponse runInitialize ();
   ToolResponse runMoveEvent (const ViewPointingEvent&);
   ToolResponse runPressEvent (const ViewPointingEvent&);
+  ToolResponse runReleaseEvent (const ViewPointingEvent&);
   void         runFromConfig ();
 };
 
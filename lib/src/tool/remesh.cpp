@@ -2,21 +2,34 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QCheckBox>
+#include <QLabel>
 #include <QPainter>
+#include <QPushButton>
+#include <QSpinBox>
 #include "cache.hpp"
+#include "camera.hpp"
 #include "color.hpp"
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "history.hpp"
 #include "isosurface-extraction.hpp"
+#include "isosurface-extraction/csg.hpp"
 #include "maybe.hpp"
 #include "mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
 #include "scene.hpp"
 #include "state.hpp"
+#include "tool/remesh/action.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "tools.hpp"
+#include "view/cursor.hpp"
+#include "view/double-slider.hpp"
+#include "view/main-window.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
@@ -30,21 +43,44 @@ namespace
     Normal,
     Union,
     Difference,
-    Intersection
+    Intersection,
+    Region,
+    Flood
   };
 }
 
 struct ToolRemesh::Impl
 {
-  ToolRemesh*       self;
-  float             resolution;
-  Mode              mode;
-  Maybe<glm::ivec2> pressPoint;
+  ToolRemesh*             self;
+  float                   resolution;
+  bool                    adaptive;
+  bool                    reproject;
+  int                     numRelaxations;
+  Mode                    mode;
+  int                     faceBudget;
+  MaybeInline<glm::ivec2> pressPoint;
+  ViewCursor              cursor;
+  ViewDoubleSlider&       radiusEdit;
+  ViewResolutionSlider*   resolutionEdit;
+  QLabel*                 estimateEdit;
+  const DynamicMesh*      estimatedMesh;
+  std::size_t             estimatedKey;
+  float                   estimatedArea;
 
   Impl (ToolRemesh* s)
     : self (s)
     , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , adaptive (s->cache ().get<bool> ("adaptive", false))
+    , reproject (s->cache ().get<bool> ("reproject", false))
+    , numRelaxations (s->cache ().get<int> ("num-relaxations", 2))
     , mode (Mode (s->cache ().get<int> ("mode", int(Mode::Normal))))
+    , faceBudget (s->cache ().get<int> ("face-budget", 1000000))
+    , radiusEdit (ViewUtil::slider (2, 0.05f, s->cache ().get<float> ("radius", 0.2f), 1.0f))
+    , resolutionEdit (nullptr)
+    , estimateEdit (nullptr)
+    , estimatedMesh (nullptr)
+    , estimatedKey (0)
+    , estimatedArea (0.0f)
   {
   }
 
@@ -54,20 +90,118 @@ struct ToolRemesh::Impl
 
     QButtonGroup& modeEdit =
       ViewUtil::buttonGroup ({QObject::tr ("Normal"), QObject::tr ("Union"),
-                              QObject::tr ("Difference"), QObject::tr ("Intersection")});
+                              QObject::tr ("Difference"), QObject::tr ("Intersection"),
+                              QObject::tr ("Region"), QObject::tr ("Flood")});
     ViewUtil::connect (modeEdit, int(this->mode), [this](int id) {
       this->mode = Mode (id);
       this->self->cache ().set ("mode", id);
+      this->radiusEdit.setEnabled (this->mode == Mode::Region);
+      this->cursor.disable ();
+      this->showEstimate ();
     });
     properties.add (modeEdit);
 
-    ViewResolutionSlider& resolutionEdit =
-      ViewUtil::resolutionSlider (0.02f, this->resolution, 0.1f);
-    ViewUtil::connect (resolutionEdit, [this](float r) {
+    this->resolutionEdit = &ViewUtil::resolutionSlider (0.02f, this->resolution, 0.1f);
+    ViewUtil::connect (*this->resolutionEdit, [this](float r) {
       this->resolution = r;
       this->self->cache ().set ("resolution", r);
+      this->showEstimate ();
     });
-    properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
+    properties.addStacked (QObject::tr ("Resolution"), *this->resolutionEdit);
+
+    this->estimateEdit = new QLabel;
+    properties.add (QObject::tr ("Estimate"), *this->estimateEdit);
+
+    QSpinBox& budgetEdit = ViewUtil::spinBox (10000, this->faceBudget, 100000000, 10000);
+    ViewUtil::connect (budgetEdit, [this](int b) {
+      this->faceBudget = b;
+      this->self->cache ().set ("face-budget", b);
+    });
+    QPushButton& fitEdit = ViewUtil::pushButton (QObject::tr ("Fit"));
+    ViewUtil::connect (fitEdit, [this]() {
+      if (this->estimatedArea > 0.0f)
+      {
+        this->resolutionEdit->setResolution (IsosurfaceExtraction::estimateResolution (
+          this->estimatedArea, (unsigned int) (this->faceBudget)));
+      }
+    });
+    properties.add (QObject::tr ("Face budget"), budgetEdit);
+    properties.add (fitEdit);
+    this->showEstimate ();
+
+    QCheckBox& adaptiveEdit = ViewUtil::checkBox (QObject::tr ("Adaptive"), this->adaptive);
+    ViewUtil::connect (adaptiveEdit, [this](bool a) {
+      this->adaptive = a;
+      this->self->cache ().set ("adaptive", a);
+    });
+    properties.add (adaptiveEdit);
+
+    QSpinBox& relaxationsEdit = ViewUtil::spinBox (0, this->numRelaxations, 10);
+    ViewUtil::connect (relaxationsEdit, [this](int n) {
+      this->numRelaxations = n;
+      this->self->cache ().set ("num-relaxations", n);
+    });
+
+    QCheckBox& reprojectEdit = ViewUtil::checkBox (QObject::tr ("Reproject"), this->reproject);
+    ViewUtil::connect (reprojectEdit, [this, &relaxationsEdit](bool r) {
+      this->reproject = r;
+      this->self->cache ().set ("reproject", r);
+      relaxationsEdit.setEnabled (r);
+    });
+    relaxationsEdit.setEnabled (this->reproject);
+    properties.add (reprojectEdit);
+    properties.add (QObject::tr ("Relaxations"), relaxationsEdit);
+
+    QPushButton& allEdit = ViewUtil::pushButton (QObject::tr ("Remesh all"));
+    ViewUtil::connect (allEdit, [this]() { this->remeshAll (); });
+    properties.add (allEdit);
+
+    ViewUtil::connect (this->radiusEdit, [this](float r) {
+      this->cursor.radius (r);
+      this->self->cache ().set ("radius", r);
+    });
+    this->radiusEdit.setEnabled (this->mode == Mode::Region);
+    properties.addStacked (QObject::tr ("Radius"), this->radiusEdit);
+  }
+
+  // estimates the mesh that remeshing the hovered mesh would produce (cf. `fitEdit`)
+  void showEstimate ()
+  {
+    if (this->estimateEdit == nullptr)
+    {
+      return;
+    }
+    else if (this->mode == Mode::Region || this->estimatedArea <= 0.0f)
+    {
+      this->estimateEdit->setText (QObject::tr ("-"));
+    }
+    else
+    {
+      const unsigned int numFaces =
+        IsosurfaceExtraction::estimateNumFaces (this->estimatedArea, this->resolution);
+
+      this->estimateEdit->setText (
+        QObject::tr ("%1 faces, %2")
+          .arg (numFaces)
+          .arg (ViewUtil::byteSize (IsosurfaceExtraction::estimateNumBytes (numFaces))));
+    }
+  }
+
+  void updateEstimate (const ViewPointingEvent& e)
+  {
+    DynamicMeshIntersection intersection;
+    if (this->self->intersectsScene (e.position (), intersection))
+    {
+      const DynamicMesh& mesh = intersection.mesh ();
+
+      if (&mesh != this->estimatedMesh || mesh.renderKey () != this->estimatedKey)
+      {
+        this->estimatedMesh = &mesh;
+        this->estimatedKey = mesh.renderKey ();
+        this->estimatedArea = mesh.area ();
+        this->showEstimate ();
+      }
+    }
   }
 
   void setupToolTip ()
@@ -77,265 +211,181 @@ struct ToolRemesh::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
+  void setupCursor ()
+  {
+    this->cursor.disable ();
+    this->cursor.radius (this->radiusEdit.doubleValue ());
+  }
+
   ToolResponse runInitialize ()
   {
     this->setupProperties ();
     this->setupToolTip ();
+    this->setupCursor ();
 
     return ToolResponse::None;
   }
 
-  ToolResponse runMoveEvent (const ViewPointingEvent&)
+  void runRender () const
   {
-    return this->mode == Mode::Normal ? ToolResponse::None : ToolResponse::Redraw;
+    Camera& camera = this->self->state ().camera ();
+
+    if (this->cursor.isEnabled ())
+    {
+      this->cursor.render (camera);
+    }
   }
 
-  void remesh (DynamicMesh& mesh)
+  ToolResponse runMoveEvent (const ViewPointingEvent& e)
   {
-    const IsosurfaceExtraction::IntersectionCallback getIntersection =
-      [&mesh](const PrimRay& ray, Intersection& intersection) {
-        if (mesh.intersects (ray, intersection, true))
-        {
-          return IsosurfaceExtraction::Intersection::Sample;
-        }
-        else
-        {
-          return IsosurfaceExtraction::Intersection::None;
-        }
-      };
+    this->updateEstimate (e);
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&mesh](const glm::vec3& pos) {
-      return mesh.unsignedDistance (pos);
-    };
-
-    const PrimAABox bounds = mesh.mesh ().bounds ();
-    DynamicMesh     extractedMesh;
-    IsosurfaceExtraction::extract (getDistance, getIntersection, bounds, this->resolution,
-                                   extractedMesh);
-
-    State& state = this->self->state ();
-    state.scene ().deleteMesh (mesh);
-    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-    ToolSculptAction::smoothMesh (dMesh);
+    if (this->mode == Mode::Region)
+    {
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e.position (), intersection))
+      {
+        this->cursor.enable ();
+        this->cursor.position (intersection.position ());
+      }
+      else
+      {
+        this->cursor.disable ();
+      }
+    }
+    return this->mode == Mode::Normal || this->mode == Mode::Flood ? ToolResponse::None
+                                                                   : ToolResponse::Redraw;
   }
 
-  void remesh (DynamicMesh& meshA, DynamicMesh& meshB)
+  // the surface of an optional source is restored after smoothing (cf. `reproject`)
+  void finalizeMesh (DynamicMesh& mesh, const DynamicMesh* source = nullptr)
   {
-    const IsosurfaceExtraction::IntersectionCallback getCommutativeIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Union || this->mode == Mode::Intersection);
+    ToolSculptAction::smoothMesh (mesh);
 
-        Intersection intersectionA, intersectionB;
-        meshA.intersects (ray, intersectionA, true);
-        meshB.intersects (ray, intersectionB, true);
+    if (source && this->reproject)
+    {
+      ToolRemeshAction::reproject (*source, mesh, (unsigned int) (this->numRelaxations));
+    }
 
-        Intersection::sort (intersectionA, intersectionB);
-        intersection = intersectionA;
+    if (this->adaptive)
+    {
+      ToolSculptAction::coarsenFlatRegions (mesh, this->resolution);
+    }
+  }
 
-        const bool intersectsA = intersectionA.isIntersection ();
-        const bool intersectsB = intersectionB.isIntersection ();
+  void remesh (DynamicMesh& mesh)
+  {
+    DynamicMesh extractedMesh;
+    ToolRemeshAction::remesh (mesh, this->resolution, extractedMesh);
 
-        if (intersectsA && intersectsB)
-        {
-          const bool insideA = glm::dot (ray.direction (), intersectionA.normal ()) > 0.0f;
-          const bool insideB = glm::dot (ray.direction (), intersectionB.normal ()) > 0.0f;
+    State&       state = this->self->state ();
+    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
+    this->finalizeMesh (dMesh, &mesh);
+    state.scene ().deleteMesh (mesh);
+  }
 
-          if (insideA && insideB)
-          {
-            // (B (A o-> A) B)
-            // (A (B o-> A) B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA && insideB == false)
-          {
-            // (A o-> A) (B B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          else if (insideA == false && insideB)
-          {
-            // (B o-> (A A) B)
-            // (B o-> (A B) A)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA == false && insideB == false)
-          {
-            // o-> (A (B B) A)
-            // o-> (A (B A) B)
-            // o-> (A A) (B B)
-            if (this->mode == Mode::Union)
-            {
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              assert (this->mode == Mode::Intersection);
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          DILAY_IMPOSSIBLE
-        }
-        else if (intersectsA)
-        {
-          if (this->mode == Mode::Union)
-          {
-            return IsosurfaceExtraction::Intersection::Sample;
-          }
-          else
-          {
-            assert (this->mode == Mode::Intersection);
-            return IsosurfaceExtraction::Intersection::Continue;
-          }
-        }
-        else
-        {
-          assert (intersectsB == false);
-          return IsosurfaceExtraction::Intersection::None;
-        }
-        DILAY_IMPOSSIBLE
-      };
+  /* Remeshes all meshes of the scene with a single snapshot.  Meshes are extracted concurrently
+   * as long as their estimated sizes fit into the memory budget.
+   */
+  void remeshAll ()
+  {
+    State&                    state = this->self->state ();
+    std::vector<DynamicMesh*> meshes;
 
-    const IsosurfaceExtraction::IntersectionCallback getDifferenceIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Difference);
+    state.scene ().forEachMesh ([&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
+    if (meshes.empty ())
+    {
+      return;
+    }
 
-        Intersection intersectionA, intersectionB;
-        const bool   intersectsA = meshA.intersects (ray, intersectionA, true);
-        const bool   intersectsB = meshB.intersects (ray, intersectionB, true);
+    std::vector<std::size_t> costs (meshes.size ());
+    Parallel::forEach (meshes.size (), [this, &meshes, &costs](unsigned int i) {
+      costs[i] = IsosurfaceExtraction::estimateNumBytes (
+        IsosurfaceExtraction::estimateNumFaces (meshes[i]->area (), this->resolution));
+    });
 
-        if (intersectsA && intersectsB)
-        {
-          const bool insideA = glm::dot (ray.direction (), intersectionA.normal ()) > 0.0f;
-          const bool insideB = glm::dot (ray.direction (), intersectionB.normal ()) > 0.0f;
-          const bool aBeforeB = intersectionA.distance () < intersectionB.distance ();
+    const int                budget = state.config ().get<int> ("editor/memory-budget");
+    std::vector<DynamicMesh> extractedMeshes (meshes.size ());
+    Parallel::forEach (costs, std::size_t (std::max (0, budget)) * 1024 * 1024,
+                       [this, &meshes, &extractedMeshes](unsigned int i) {
+                         ToolRemeshAction::remesh (*meshes[i], this->resolution,
+                                                   extractedMeshes[i]);
+                       });
 
-          intersection = aBeforeB ? intersectionA : intersectionB;
+    this->self->snapshotDynamicMeshes ();
+    for (unsigned int i = 0; i < meshes.size (); i++)
+    {
+      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMeshes[i]);
+      this->finalizeMesh (dMesh, meshes[i]);
+      state.scene ().deleteMesh (*meshes[i]);
+    }
+    this->self->updateGlWidget ();
+  }
 
-          if (insideA && insideB)
-          {
-            if (aBeforeB)
-            {
-              // (B (A o-> A) B)
-              // (A (B o-> A) B)
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-            else
-            {
-              // (A (B o-> B) A)
-              // (B (A o-> B) A)
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-          }
-          else if (insideA && insideB == false)
-          {
-            // (A o-> A) (B B)
-            // (A o-> (B B) A)
-            // (A o-> (B A) B)
-            return IsosurfaceExtraction::Intersection::Sample;
-          }
-          else if (insideA == false && insideB)
-          {
-            // (B o-> B) (A A)
-            // (B o-> (A A) B)
-            // (B o-> (A B) A)
-            return IsosurfaceExtraction::Intersection::Continue;
-          }
-          else if (insideA == false && insideB == false)
-          {
-            if (aBeforeB)
-            {
-              // o-> (A (B B) A)
-              // o-> (A (B A) B)
-              // o-> (A A) (B B)
-              return IsosurfaceExtraction::Intersection::Sample;
-            }
-            else
-            {
-              // o-> (B (A A) B)
-              // o-> (B (A B) A)
-              // o-> (B B) (A A)
-              return IsosurfaceExtraction::Intersection::Continue;
-            }
-          }
-          DILAY_IMPOSSIBLE
-        }
-        else if (intersectsA)
-        {
-          intersection = intersectionA;
-          return IsosurfaceExtraction::Intersection::Sample;
-        }
-        else if (intersectsB)
-        {
-          intersection = intersectionB;
-          return IsosurfaceExtraction::Intersection::Continue;
-        }
-        else
-        {
-          return IsosurfaceExtraction::Intersection::None;
-        }
-        DILAY_IMPOSSIBLE
-      };
+  void remesh (DynamicMesh& meshA, DynamicMesh& meshB)
+  {
+    const IsosurfaceExtractionCsg::Operation operation =
+      this->mode == Mode::Union
+        ? IsosurfaceExtractionCsg::Operation::Union
+        : (this->mode == Mode::Intersection ? IsosurfaceExtractionCsg::Operation::Intersection
+                                            : IsosurfaceExtractionCsg::Operation::Difference);
+    const IsosurfaceExtractionCsg csg (operation, {&meshA, &meshB}, this->resolution);
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&meshA,
-                                                                &meshB](const glm::vec3& pos) {
-      return glm::min (meshA.unsignedDistance (pos), meshB.unsignedDistance (pos));
-    };
+    DynamicMesh extractedMesh;
+    IsosurfaceExtraction::extract (csg.distancesCallback (), csg.intersectionCallback (),
+                                   csg.bounds (), this->resolution, extractedMesh);
 
-    const PrimAABox boundsA = meshA.mesh ().bounds ();
-    const PrimAABox boundsB = meshB.mesh ().bounds ();
-    const glm::vec3 min = glm::min (boundsA.minimum (), boundsB.minimum ());
-    const glm::vec3 max = glm::max (boundsA.maximum (), boundsB.maximum ());
-    const PrimAABox bounds (min, max);
+    State& state = this->self->state ();
+    state.scene ().deleteMesh (meshA);
+    state.scene ().deleteMesh (meshB);
 
-    DynamicMesh extractedMesh;
-    if (this->mode == Mode::Difference)
+    if (extractedMesh.isEmpty () == false)
     {
-      IsosurfaceExtraction::extract (getDistance, getDifferenceIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
+      this->finalizeMesh (dMesh);
     }
-    else
+  }
+
+  void remeshRegion (DynamicMesh& mesh, const glm::vec3& center)
+  {
+    State& state = this->self->state ();
+
+    this->self->snapshotDynamicMeshes ();
+    const PrimSphere sphere (center, this->radiusEdit.doubleValue ());
+
+    if (ToolRemeshAction::remeshRegion (mesh, sphere, this->resolution) == false)
     {
-      IsosurfaceExtraction::extract (getDistance, getCommutativeIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      state.undo ();
+      state.history ().dropFutureSnapshot ();
+      ViewUtil::error (state.mainWindow (), QObject::tr ("Could not remesh region."));
     }
+  }
 
+  /* Flooding retessellates a mesh towards the resolution without extracting it, hence the mesh
+   * keeps its topology and its sharp features.
+   */
+  void floodDetail (DynamicMesh& mesh)
+  {
     State& state = this->self->state ();
-    state.scene ().deleteMesh (meshA);
-    state.scene ().deleteMesh (meshB);
 
-    if (extractedMesh.isEmpty () == false)
+    this->self->snapshotDynamicMeshes ();
+
+    // unchanged meshes are not recorded
+    if (ToolSculptAction::floodDetail (mesh, this->resolution) == false)
     {
-      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-      ToolSculptAction::smoothMesh (dMesh);
+      state.undo ();
+      state.history ().dropFutureSnapshot ();
     }
   }
 
+  bool isCsgMode () const
+  {
+    return this->mode != Mode::Normal && this->mode != Mode::Region && this->mode != Mode::Flood;
+  }
+
   ToolResponse runPressEvent (const ViewPointingEvent& e)
   {
-    if (e.leftButton () == false || this->mode == Mode::Normal)
+    if (e.leftButton () == false || this->isCsgMode () == false)
     {
       return ToolResponse::None;
     }
@@ -368,6 +418,32 @@ struct ToolRemesh::Impl
           return ToolResponse::None;
         }
       }
+      else if (this->mode == Mode::Region)
+      {
+        DynamicMeshIntersection intersection;
+        if (this->self->intersectsScene (e.position (), intersection))
+        {
+          this->remeshRegion (intersection.mesh (), intersection.position ());
+          return ToolResponse::Redraw;
+        }
+        else
+        {
+          return ToolResponse::None;
+        }
+      }
+      else if (this->mode == Mode::Flood)
+      {
+        DynamicMeshIntersection intersection;
+        if (this->self->intersectsScene (e.position (), intersection))
+        {
+          this->floodDetail (intersection.mesh ());
+          return ToolResponse::Redraw;
+        }
+        else
+        {
+          return ToolResponse::None;
+        }
+      }
       else if (this->pressPoint)
       {
         DynamicMeshIntersection intersectionA;
@@ -404,7 +480,7 @@ struct ToolRemesh::Impl
 
   void runPaint (QPainter& painter) const
   {
-    if (this->mode != Mode::Normal && this->pressPoint)
+    if (this->isCsgMode () && this->pressPoint)
     {
       const QPoint cursorPos (ViewUtil::toQPoint (this->self->cursorPosition ()));
 
@@ -418,11 +494,18 @@ struct ToolRemesh::Impl
   }
 
   ToolResponse runCommit () { return ToolResponse::Redraw; }
+
+  void runFromConfig ()
+  {
+    this->cursor.color (this->self->config ().get<Color> ("editor/tool/cursor-color"));
+  }
 };
 
 DELEGATE_TOOL (ToolRemesh)
+DELEGATE_TOOL_RUN_RENDER (ToolRemesh)
 DELEGATE_TOOL_RUN_MOVE_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_PRESS_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_PAINT (ToolRemesh)
 DELEGATE_TOOL_RUN_COMMIT (ToolRemesh)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolRemesh)
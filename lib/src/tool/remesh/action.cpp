@@ -0,0 +1,390 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <functional>
+#include <glm/gtx/norm.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction.hpp"
+#include "mesh.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "primitive/triangle.hpp"
+#include "profile.hpp"
+#include "tool/remesh/action.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::vector<unsigned int> Loop;
+  typedef std::vector<Loop>         Loops;
+
+  bool isInside (const DynamicMesh& mesh, const PrimSphere& sphere, unsigned int f)
+  {
+    unsigned int i1, i2, i3;
+    mesh.vertexIndices (f, i1, i2, i3);
+
+    return sphere.contains ((mesh.vertex (i1) + mesh.vertex (i2) + mesh.vertex (i3)) / 3.0f);
+  }
+
+  /* Collects the border loops of a set of faces, where `faces` must contain all faces of the set
+   * that are adjacent to its border.  Each loop is oriented like the faces of the set.  Fails if
+   * the border is non-manifold, i.e., if a vertex is part of more than one loop.
+   */
+  bool findBorder (const DynamicMesh& mesh, const std::vector<unsigned int>& faces,
+                   const std::function<bool(unsigned int)>& isMember, Loops& loops)
+  {
+    std::unordered_map<unsigned int, unsigned int> next;
+
+    for (unsigned int f : faces)
+    {
+      unsigned int i[3];
+      mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+      for (unsigned int e = 0; e < 3; e++)
+      {
+        const unsigned int from = i[e];
+        const unsigned int to = i[(e + 1) % 3];
+
+        unsigned int leftFace, leftVertex, rightFace, rightVertex;
+        mesh.findAdjacent (from, to, leftFace, leftVertex, rightFace, rightVertex);
+
+        assert (leftFace == f);
+        if (rightFace == Util::invalidIndex () || isMember (rightFace) == false)
+        {
+          if (next.emplace (from, to).second == false)
+          {
+            return false;
+          }
+        }
+      }
+    }
+
+    while (next.empty () == false)
+    {
+      Loop         loop;
+      unsigned int v = next.begin ()->first;
+      do
+      {
+        const auto it = next.find (v);
+        if (it == next.end ())
+        {
+          return false;
+        }
+        loop.push_back (v);
+        v = it->second;
+        next.erase (it);
+      } while (v != loop.front ());
+
+      if (loop.size () < 3)
+      {
+        return false;
+      }
+      loops.push_back (std::move (loop));
+    }
+    return true;
+  }
+
+  /* Maps each loop of `outer` to the loop of `inner` that contains the vertex closest to the
+   * loop's first vertex.  The mapped inner loop is rotated to start at that vertex.
+   */
+  bool matchLoops (const DynamicMesh& outerMesh, const Loops& outer, const DynamicMesh& innerMesh,
+                   Loops& inner)
+  {
+    if (outer.size () != inner.size ())
+    {
+      return false;
+    }
+
+    Loops             matched (outer.size ());
+    std::vector<bool> isMatched (inner.size (), false);
+
+    for (unsigned int o = 0; o < outer.size (); o++)
+    {
+      const glm::vec3& start = outerMesh.vertex (outer[o].front ());
+      unsigned int     closestLoop = Util::invalidIndex ();
+      unsigned int     closestVertex = Util::invalidIndex ();
+      float            minDistance = Util::maxFloat ();
+
+      for (unsigned int l = 0; l < inner.size (); l++)
+      {
+        for (unsigned int v = 0; v < inner[l].size (); v++)
+        {
+          const float d = glm::distance2 (start, innerMesh.vertex (inner[l][v]));
+
+          if (d < minDistance)
+          {
+            closestLoop = l;
+            closestVertex = v;
+            minDistance = d;
+          }
+        }
+      }
+      assert (closestLoop != Util::invalidIndex ());
+
+      if (isMatched[closestLoop])
+      {
+        return false;
+      }
+      isMatched[closestLoop] = true;
+
+      const Loop& loop = inner[closestLoop];
+      for (unsigned int v = 0; v < loop.size (); v++)
+      {
+        matched[o].push_back (loop[(closestVertex + v) % loop.size ()]);
+      }
+    }
+    inner = std::move (matched);
+    return true;
+  }
+
+  /* Bridges two loops with a strip of triangles.  Both loops must start at nearby vertices and
+   * must run in the same direction, i.e., `outer` is oriented like the faces it borders and
+   * `inner` in the opposite way.
+   */
+  void stitch (DynamicMesh& mesh, const Loop& outer, const Loop& inner, DynamicFaces& faces)
+  {
+    const unsigned int nO = outer.size ();
+    const unsigned int nI = inner.size ();
+    unsigned int       i = 0;
+    unsigned int       j = 0;
+
+    while (i < nO || j < nI)
+    {
+      const unsigned int o = outer[i % nO];
+      const unsigned int o1 = outer[(i + 1) % nO];
+      const unsigned int p = inner[j % nI];
+      const unsigned int p1 = inner[(j + 1) % nI];
+
+      const bool advanceOuter =
+        j == nI || (i < nO && glm::distance2 (mesh.vertex (o1), mesh.vertex (p)) <=
+                                glm::distance2 (mesh.vertex (p1), mesh.vertex (o)));
+      if (advanceOuter)
+      {
+        faces.insert (mesh.addFace (o1, o, p));
+        i++;
+      }
+      else
+      {
+        faces.insert (mesh.addFace (p, p1, o));
+        j++;
+      }
+    }
+  }
+}
+
+namespace ToolRemeshAction
+{
+  bool remesh (const DynamicMesh& mesh, float resolution, DynamicMesh& extractedMesh,
+               IsosurfaceExtractionContext* context)
+  {
+    const IsosurfaceExtraction::IntersectionCallback getIntersection =
+      [&mesh](const PrimRay& ray, std::vector<float>& crossings) {
+        std::vector<Intersection> intersections;
+        mesh.intersects (ray, intersections, true);
+        IsosurfaceExtraction::addCrossings (ray, intersections, crossings);
+      };
+
+    const IsosurfaceExtraction::DistancesCallback getDistances =
+      IsosurfaceExtraction::meshDistances (mesh, resolution);
+
+    return IsosurfaceExtraction::extract (getDistances, getIntersection, mesh.mesh ().bounds (),
+                                          resolution, extractedMesh, context,
+                                          IsosurfaceExtraction::meshBounds (mesh));
+  }
+
+  bool remeshRegion (DynamicMesh& mesh, const PrimSphere& sphere, float resolution)
+  {
+    const IsosurfaceExtraction::IntersectionCallback getIntersection =
+      [&mesh](const PrimRay& ray, std::vector<float>& crossings) {
+        std::vector<Intersection> intersections;
+        mesh.intersects (ray, intersections, true);
+        IsosurfaceExtraction::addCrossings (ray, intersections, crossings);
+      };
+
+    const IsosurfaceExtraction::DistancesCallback getDistances =
+      IsosurfaceExtraction::meshDistances (mesh, resolution);
+
+    // the extracted patch is closed along the region's bounds, which are therefore kept away
+    // from the sphere
+    const glm::vec3 extent (sphere.radius () + (2.0f * resolution));
+    const PrimAABox region (sphere.center () - extent, sphere.center () + extent);
+    DynamicMesh     patch;
+
+    IsosurfaceExtraction::extractRegion (getDistances, getIntersection, mesh.mesh ().bounds (),
+                                         region, resolution, patch, nullptr,
+                                         IsosurfaceExtraction::meshBounds (mesh));
+
+    DynamicFaces inside;
+    if (mesh.intersects (sphere, inside) == false)
+    {
+      return false;
+    }
+    inside.filter ([&mesh, &sphere](unsigned int f) { return isInside (mesh, sphere, f); });
+
+    if (inside.isEmpty ())
+    {
+      return false;
+    }
+
+    std::unordered_set<unsigned int> outsideFaces;
+    mesh.forEachVertex (inside, [&mesh, &inside, &outsideFaces](unsigned int v) {
+      for (unsigned int f : mesh.adjacentFaces (v))
+      {
+        if (inside.contains (f) == false)
+        {
+          outsideFaces.insert (f);
+        }
+      }
+    });
+
+    Loops outerLoops;
+    if (findBorder (mesh, std::vector<unsigned int> (outsideFaces.begin (), outsideFaces.end ()),
+                    [&inside](unsigned int f) { return inside.contains (f) == false; },
+                    outerLoops) == false)
+    {
+      return false;
+    }
+
+    std::vector<unsigned int> patchFaces;
+    std::vector<bool>         isPatchFace (patch.numFaces (), false);
+    patch.forEachFace ([&patch, &sphere, &patchFaces, &isPatchFace](unsigned int f) {
+      if (isInside (patch, sphere, f))
+      {
+        patchFaces.push_back (f);
+        isPatchFace[f] = true;
+      }
+    });
+
+    Loops innerLoops;
+    if (findBorder (patch, patchFaces, [&isPatchFace](unsigned int f) { return isPatchFace[f]; },
+                    innerLoops) == false ||
+        matchLoops (mesh, outerLoops, patch, innerLoops) == false)
+    {
+      return false;
+    }
+
+    std::vector<unsigned int> newIndices (patch.numVertices (), Util::invalidIndex ());
+    const auto                newIndex = [&mesh, &patch, &newIndices](unsigned int i) {
+      if (newIndices[i] == Util::invalidIndex ())
+      {
+        newIndices[i] = mesh.addVertex (patch.vertex (i), patch.vertexNormal (i));
+      }
+      return newIndices[i];
+    };
+
+    DynamicFaces newFaces;
+    for (unsigned int f : patchFaces)
+    {
+      unsigned int i1, i2, i3;
+      patch.vertexIndices (f, i1, i2, i3);
+      newFaces.insert (mesh.addFace (newIndex (i1), newIndex (i2), newIndex (i3)));
+    }
+
+    std::vector<unsigned int> insideVertices;
+    mesh.forEachVertex (inside,
+                        [&insideVertices](unsigned int v) { insideVertices.push_back (v); });
+
+    for (unsigned int f : inside)
+    {
+      mesh.deleteFace (f);
+    }
+    for (unsigned int v : insideVertices)
+    {
+      if (mesh.adjacentFaces (v).empty ())
+      {
+        mesh.deleteVertex (v);
+      }
+    }
+
+    for (unsigned int l = 0; l < outerLoops.size (); l++)
+    {
+      Loop inner;
+      inner.reserve (innerLoops[l].size ());
+      inner.push_back (newIndex (innerLoops[l].front ()));
+      for (unsigned int v = innerLoops[l].size () - 1; v > 0; v--)
+      {
+        inner.push_back (newIndex (innerLoops[l][v]));
+      }
+      stitch (mesh, outerLoops[l], inner, newFaces);
+    }
+
+    newFaces.commit ();
+    ToolSculptAction::smoothMesh (mesh, newFaces);
+
+    return mesh.pruneAndCheckConsistency ();
+  }
+
+  void reproject (const DynamicMesh& source, DynamicMesh& mesh, unsigned int numRelaxations)
+  {
+    DILAY_PROFILE_ZONE ("ToolRemeshAction::reproject");
+
+    std::vector<unsigned int> vertices;
+    vertices.reserve (mesh.numVertices ());
+
+    mesh.forEachVertex ([&mesh, &vertices](unsigned int i) {
+      if (mesh.valence (i) > 0)
+      {
+        vertices.push_back (i);
+      }
+    });
+
+    std::vector<glm::vec3> positions (vertices.size ());
+    std::vector<glm::vec3> points;
+
+    for (unsigned int j = 0; j < vertices.size (); j++)
+    {
+      positions[j] = mesh.vertex (vertices[j]);
+    }
+
+    const auto project = [&source, &mesh, &vertices, &positions, &points]() {
+      source.nearestPoints (positions, points);
+
+      for (unsigned int j = 0; j < vertices.size (); j++)
+      {
+        mesh.vertex (vertices[j], points[j]);
+      }
+    };
+
+    project ();
+
+    // each vertex moves towards the centroid of its neighbors within its tangent plane
+    for (unsigned int r = 0; r < numRelaxations; r++)
+    {
+      Parallel::forEach (vertices.size (), [&mesh, &vertices, &positions](unsigned int j) {
+        const unsigned int i = vertices[j];
+        const glm::vec3&   position = mesh.vertex (i);
+        glm::vec3          centroid (0.0f);
+        glm::vec3          normal (0.0f);
+
+        mesh.forEachVertexAdjacentToVertex (
+          i, [&mesh, &centroid](unsigned int a) { centroid += mesh.vertex (a); });
+
+        for (unsigned int a : mesh.adjacentFaces (i))
+        {
+          normal += mesh.face (a).cross ();
+        }
+
+        const glm::vec3 delta = (centroid / float(mesh.valence (i))) - position;
+        const float     normalSqr = glm::length2 (normal);
+
+        positions[j] = normalSqr > 0.0f
+                         ? position + delta - (normal * glm::dot (delta, normal) / normalSqr)
+                         : position;
+      });
+      project ();
+    }
+
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    mesh.bufferData ();
+  }
+}
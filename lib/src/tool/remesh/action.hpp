@@ -0,0 +1,23 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_REMESH_ACTION
+#define DILAY_TOOL_REMESH_ACTION
+
+class DynamicMesh;
+class IsosurfaceExtractionContext;
+class PrimSphere;
+
+namespace ToolRemeshAction
+{
+  // extracts the surface of a mesh at the given resolution
+  bool remesh (const DynamicMesh&, float, DynamicMesh&, IsosurfaceExtractionContext* = nullptr);
+  bool remeshRegion (DynamicMesh&, const PrimSphere&, float);
+  /* Projects the vertices of a mesh onto the surface of a source mesh, interleaved with the given
+   * number of tangential relaxations, so that coarse extractions keep the source's detail.
+   */
+  void reproject (const DynamicMesh&, DynamicMesh&, unsigned int);
+}
+
+#endif
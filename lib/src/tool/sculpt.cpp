@@ -4,22 +4,36 @@
  */
 #include <QCheckBox>
 #include <QFrame>
+#include <QSpinBox>
 #include <QWheelEvent>
+#include <algorithm>
+#include <future>
+#include <string>
 #include "cache.hpp"
 #include "camera.hpp"
+#include "color.hpp"
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh-layers.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
 #include "maybe.hpp"
 #include "mirror.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "renderer.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool/sculpt.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/arena.hpp"
 #include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/governor.hpp"
+#include "tool/sculpt/util/level.hpp"
+#include "tool/sculpt/util/recording.hpp"
+#include "tool/sculpt/util/reference.hpp"
 #include "tool/util/movement.hpp"
+#include "tool/util/prediction.hpp"
 #include "tool/util/step.hpp"
 #include "view/cursor.hpp"
 #include "view/double-slider.hpp"
@@ -37,31 +51,74 @@ namespace
     Sculpted,
     Ended
   };
+
+  // layers are numbered from 1, where 0 sculpts without a layer
+  constexpr int maxNumLayers = 8;
 }
 
 struct ToolSculpt::Impl
 {
-  ToolSculpt*       self;
-  SculptBrush       brush;
-  ViewCursor        cursor;
-  CacheProxy        commonCache;
-  ViewDoubleSlider& radiusEdit;
-  ViewDoubleSlider* secondarySlider;
-  bool              absoluteRadius;
-  SculptState       sculptState;
-  ToolUtilStep      step;
+  ToolSculpt*                    self;
+  SculptBrush                    brush;
+  ViewCursor                     cursor;
+  glm::vec3                      cursorNormal;
+  ToolUtilPrediction             prediction;
+  bool                           isCursorPredicted;
+  bool                           highlightRegion;
+  Color                          highlightColor;
+  CacheProxy                     commonCache;
+  ViewDoubleSlider&              radiusEdit;
+  ViewDoubleSlider*              secondarySlider;
+  bool                           absoluteRadius;
+  SculptState                    sculptState;
+  ToolUtilStep                   step;
+  bool                           coalesceEvents;
+  bool                           sculptInBackground;
+  bool                           combineMirror;
+  bool                           separateStrokeRegion;
+  MaybeInline<ViewPointingEvent> pendingEvent;
+  std::future<bool>              worker;
+  bool                           isWorking;
+  bool                           hasEmptyMesh;
+  std::vector<DynamicMesh*>      unbufferedMeshes;
+  bool                           sculptCoarseLevel;
+  Maybe<SculptLevel>             level;
+  DynamicMesh*                   levelMesh;
+  bool                           needsPropagation;
+  unsigned int                   layer;
+  bool                           hasLayerSnapshot;
+  ToolSculptArena                arena;
+  SculptReference                reference;
+  SculptGovernor                 governor;
+  const KVStore::Key             maxAbsoluteRadiusKey;
 
   Impl (ToolSculpt* s)
     : self (s)
+    , isCursorPredicted (false)
+    , highlightRegion (false)
     , commonCache (this->self->cache ("sculpt"))
     , radiusEdit (
         ViewUtil::slider (2, 0.01f, this->commonCache.get<float> ("radius", 0.1f), 1.0f, 3))
     , secondarySlider (nullptr)
     , absoluteRadius (this->commonCache.get<bool> ("absolute-radius", true))
     , sculptState (SculptState::None)
+    , coalesceEvents (false)
+    , sculptInBackground (false)
+    , combineMirror (false)
+    , separateStrokeRegion (false)
+    , isWorking (false)
+    , hasEmptyMesh (false)
+    , sculptCoarseLevel (this->commonCache.get<bool> ("coarse-level", false))
+    , levelMesh (nullptr)
+    , needsPropagation (false)
+    , layer (this->commonCache.get<int> ("layer", 0))
+    , hasLayerSnapshot (false)
+    , maxAbsoluteRadiusKey (s->config ().key ("editor/tool/sculpt/max-absolute-radius"))
   {
   }
 
+  ~Impl () { this->self->state ().camera ().renderer ().resetBrushRegion (); }
+
   ToolResponse runInitialize ()
   {
     this->self->supportsMirror ();
@@ -98,6 +155,7 @@ struct ToolSculpt::Impl
     {
       this->cursor.enable ();
       this->cursor.position (intersection.position ());
+      this->cursorNormal = intersection.normal ();
     }
     else
     {
@@ -142,12 +200,88 @@ struct ToolSculpt::Impl
     });
     properties.add (absRadiusEdit);
 
+    QCheckBox& coarseLevelEdit =
+      ViewUtil::checkBox (QObject::tr ("Sculpt coarse level"), this->sculptCoarseLevel);
+    ViewUtil::connect (coarseLevelEdit, [this](bool c) {
+      this->sculptCoarseLevel = c;
+      this->commonCache.set ("coarse-level", c);
+    });
+    properties.add (coarseLevelEdit);
+
+    QSpinBox&         layerEdit = ViewUtil::spinBox (0, int(this->layer), maxNumLayers);
+    ViewDoubleSlider& layerStrengthEdit =
+      ViewUtil::slider (2, 0.0f, this->layerStrength (this->layer), 2.0f);
+    layerStrengthEdit.setEnabled (this->layer > 0);
+
+    ViewUtil::connect (layerEdit, [this, &layerStrengthEdit](int l) {
+      this->layer = l;
+      this->commonCache.set ("layer", l);
+      layerStrengthEdit.setEnabled (l > 0);
+      layerStrengthEdit.setDoubleValue (this->layerStrength (l));
+    });
+    ViewUtil::connect (layerStrengthEdit, [this](float s) { this->setLayerStrength (s); });
+    QObject::connect (&layerStrengthEdit, &QSlider::sliderReleased,
+                      [this]() { this->hasLayerSnapshot = false; });
+    properties.add (QObject::tr ("Layer"), layerEdit);
+    properties.addStacked (QObject::tr ("Layer strength"), layerStrengthEdit);
+
     this->self->addMirrorProperties ();
     properties.add (ViewUtil::horizontalLine ());
 
     this->self->runSetupProperties (properties);
   }
 
+  float layerStrength (unsigned int l) const
+  {
+    return this->commonCache.get<float> ("layer-strength-" + std::to_string (l), 1.0f);
+  }
+
+  /* Changing a strength only moves the vertices of the layer, hence the snapshot records them
+   * sparsely.  Changes of a single drag of the slider share their snapshot.
+   */
+  void setLayerStrength (float s)
+  {
+    if (this->layer == 0 || s == this->layerStrength (this->layer))
+    {
+      return;
+    }
+    this->runSynchronize ();
+
+    if (this->hasLayerSnapshot == false)
+    {
+      this->self->snapshotDynamicMeshes ();
+      this->hasLayerSnapshot = true;
+    }
+
+    const unsigned int l = this->layer - 1;
+    this->self->state ().scene ().forEachMesh (
+      [l, s](DynamicMesh& mesh) { mesh.layerStrength (l, s); });
+    this->commonCache.set ("layer-strength-" + std::to_string (this->layer), s);
+    this->self->updateGlWidget ();
+  }
+
+  /* Layers of meshes that have been dropped (e.g., by undoing) are recreated at the strength of
+   * the slider before the stroke is recorded.
+   */
+  void recordLayer ()
+  {
+    assert (this->layer > 0);
+
+    const unsigned int l = this->layer - 1;
+    const float        s = this->layerStrength (this->layer);
+
+    this->self->state ().scene ().forEachMesh ([l, s](DynamicMesh& mesh) {
+      if (mesh.tracksChanges ())
+      {
+        if (mesh.layers ().strength (l) != s)
+        {
+          mesh.layerStrength (l, s);
+        }
+        mesh.recordLayer (l);
+      }
+    });
+  }
+
   void setupToolTip ()
   {
     ViewToolTip toolTip;
@@ -158,11 +292,251 @@ struct ToolSculpt::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
+  void runPrepareRender ()
+  {
+    this->prepareData ();
+    this->predictCursor ();
+    this->updateBrushRegion ();
+  }
+
+  /* In background mode, pending events are sculpted by a worker that owns the scene's meshes
+   * until it is finished.  The worker is started once a frame has been rendered and is joined
+   * before the next one, so it runs while events are handled but never while the scene is
+   * rendered.
+   */
+  void prepareData ()
+  {
+    if (this->sculptInBackground)
+    {
+      this->waitForWorker ();
+      this->bufferData ();
+    }
+    else
+    {
+      this->runPendingEvent ();
+      this->bufferData ();
+    }
+  }
+
+  void runFinishRender ()
+  {
+    if (this->sculptInBackground && this->pendingEvent)
+    {
+      this->startWorker ();
+      this->self->updateGlWidget ();
+    }
+  }
+
+  void runSynchronize ()
+  {
+    this->waitForWorker ();
+    this->runPendingEvent ();
+  }
+
+  void startWorker ()
+  {
+    assert (this->worker.valid () == false);
+    assert (this->pendingEvent);
+
+    const ViewPointingEvent e = *this->pendingEvent;
+    this->pendingEvent.reset ();
+
+    this->isWorking = true;
+    this->worker = std::async (std::launch::async,
+                               [this, e]() { return this->self->runSculptPointingEvent (e); });
+  }
+
+  void waitForWorker ()
+  {
+    if (this->worker.valid ())
+    {
+      if (this->worker.get ())
+      {
+        this->sculptState = SculptState::Sculpted;
+      }
+      this->isWorking = false;
+
+      if (this->hasEmptyMesh)
+      {
+        this->bufferData ();
+      }
+    }
+  }
+
+  void runPendingEvent ()
+  {
+    if (this->pendingEvent)
+    {
+      const ViewPointingEvent e = *this->pendingEvent;
+      this->pendingEvent.reset ();
+
+      if (this->self->runSculptPointingEvent (e))
+      {
+        this->sculptState = SculptState::Sculpted;
+      }
+    }
+  }
+
+  /* When sculpting a coarse level, the brush acts on the level's coarse mesh whenever the
+   * level's fine mesh is hit.  The fine mesh is updated by propagating the level before it is
+   * buffered.
+   */
+  bool isOnLevel () const
+  {
+    return this->levelMesh && &this->brush.mesh () == &this->level->coarseMesh ();
+  }
+
+  DynamicMesh& sculptedMesh (DynamicMesh& mesh)
+  {
+    return this->levelMesh == &mesh ? this->level->coarseMesh () : mesh;
+  }
+
+  // binds a level to the mesh of a starting stroke, hence no worker must be running
+  void prepareLevel (DynamicMesh& mesh)
+  {
+    assert (this->isWorking == false);
+
+    if (this->sculptCoarseLevel)
+    {
+      if (this->level == false || this->level->isBoundTo (mesh) == false)
+      {
+        const float factor =
+          this->self->config ().get<float> ("editor/tool/sculpt/coarse-level-factor");
+        this->level = Maybe<SculptLevel>::make (mesh, factor * this->brush.radius ());
+      }
+      this->levelMesh = &mesh;
+    }
+  }
+
+  void markUnbuffered ()
+  {
+    DynamicMesh* mesh = &this->brush.mesh ();
+
+    if (this->isOnLevel ())
+    {
+      mesh = this->levelMesh;
+      this->needsPropagation = true;
+    }
+
+    if (std::find (this->unbufferedMeshes.begin (), this->unbufferedMeshes.end (), mesh) ==
+        this->unbufferedMeshes.end ())
+    {
+      this->unbufferedMeshes.push_back (mesh);
+    }
+  }
+
+  // buffers the sculpted meshes and deletes empty ones, hence no worker must be running
+  void bufferData ()
+  {
+    assert (this->isWorking == false);
+
+    if (this->needsPropagation)
+    {
+      assert (this->levelMesh);
+
+      if (this->level->propagate (*this->levelMesh) == false)
+      {
+        DILAY_WARN ("coarse level lost bound vertices");
+        if (this->isOnLevel ())
+        {
+          this->brush.resetPointOfAction ();
+        }
+        this->level.reset ();
+        this->levelMesh = nullptr;
+      }
+      this->needsPropagation = false;
+    }
+
+    for (DynamicMesh* mesh : this->unbufferedMeshes)
+    {
+      assert (mesh->isEmpty () == false);
+      mesh->bufferData ();
+    }
+    this->unbufferedMeshes.clear ();
+
+    if (this->hasEmptyMesh)
+    {
+      this->self->state ().scene ().deleteEmptyMeshes ();
+      this->hasEmptyMesh = false;
+    }
+  }
+
+  /* The cursor is drawn where the pointer is predicted to be when the frame is displayed.  Only
+   * the cursor is predicted: dabs are applied at the positions of events, since applied dabs can
+   * not be corrected cheaply.  Frames are requested until the prediction expires, which moves the
+   * cursor back to the pointer.
+   */
+  void predictCursor ()
+  {
+    if (this->isWorking || this->cursor.isEnabled () == false)
+    {
+      return;
+    }
+
+    glm::ivec2 predicted;
+    if (this->prediction.predict (predicted))
+    {
+      this->moveCursor (predicted);
+      this->isCursorPredicted = true;
+      this->self->updateGlWidget ();
+    }
+    else if (this->isCursorPredicted)
+    {
+      this->moveCursor (this->prediction.position ());
+      this->isCursorPredicted = false;
+    }
+  }
+
+  // strokes that start on a mesh may share the snapshot of the previous stroke
+  void snapshotStroke (const ViewPointingEvent& e)
+  {
+    DynamicMeshIntersection intersection;
+    if (this->self->intersectsScene (e, intersection))
+    {
+      this->self->state ().history ().snapshotStroke (
+        this->self->state ().scene (), intersection.mesh (),
+        PrimSphere (intersection.position (), this->brush.radius ()));
+    }
+    else
+    {
+      this->self->snapshotDynamicMeshes ();
+    }
+  }
+
+  void moveCursor (const glm::ivec2& pos)
+  {
+    DynamicMeshIntersection intersection;
+    if (this->self->intersectsScene (pos, intersection))
+    {
+      this->cursor.position (intersection.position ());
+      this->cursorNormal = intersection.normal ();
+    }
+  }
+
+  /* The region of the brush is highlighted by the shaders of the meshes, hence hovering only
+   * intersects the cursor's ray and does not collect the faces of the region.
+   */
+  void updateBrushRegion ()
+  {
+    Renderer& renderer = this->self->state ().camera ().renderer ();
+
+    if (this->highlightRegion && this->cursor.isEnabled () && this->isWorking == false)
+    {
+      renderer.setBrushRegion (this->cursor.position (), this->cursor.radius (), 0.0f,
+                               this->cursorNormal, this->highlightColor);
+    }
+    else
+    {
+      renderer.resetBrushRegion ();
+    }
+  }
+
   void runRender () const
   {
     Camera& camera = this->self->state ().camera ();
 
-    if (this->cursor.isEnabled ())
+    // the cursor is updated by a running worker
+    if (this->cursor.isEnabled () && this->isWorking == false)
     {
       this->cursor.render (camera);
     }
@@ -170,20 +544,41 @@ struct ToolSculpt::Impl
 
   ToolResponse runPointingEvent (const ViewPointingEvent& e)
   {
+    this->prediction.add (e);
+
     if (this->self->onKeymap ('r') && e.moveEvent ())
     {
+      this->runSynchronize ();
       this->radiusEdit.setIntValue (this->radiusEdit.intValue () + e.delta ().x);
     }
     else if (this->secondarySlider && this->self->onKeymap ('i') && e.moveEvent ())
     {
+      this->runSynchronize ();
       this->secondarySlider->setIntValue (this->secondarySlider->intValue () + e.delta ().x);
     }
     else if (e.leftButton ())
     {
+      const bool isSculpting =
+        this->sculptState == SculptState::Started || this->sculptState == SculptState::Sculpted;
+
+      if ((this->coalesceEvents || this->sculptInBackground) && isSculpting && e.moveEvent ())
+      {
+        this->pendingEvent = e;
+        return ToolResponse::Redraw;
+      }
+      this->runSynchronize ();
+
       if (e.pressEvent ())
       {
-        this->self->snapshotDynamicMeshes ();
+        this->snapshotStroke (e);
+        this->reference.reset ();
         this->sculptState = SculptState::Started;
+        this->hasLayerSnapshot = false;
+
+        // all meshes are buffered, since no event is pending
+        const bool separate = this->separateStrokeRegion;
+        this->self->state ().scene ().forEachMesh (
+          [separate](DynamicMesh& m) { m.beginStroke (separate); });
       }
 
       const bool doSculpt =
@@ -200,6 +595,7 @@ struct ToolSculpt::Impl
     }
     else
     {
+      this->runSynchronize ();
       this->self->runSculptPointingEvent (e);
     }
     return ToolResponse::Redraw;
@@ -207,6 +603,8 @@ struct ToolSculpt::Impl
 
   ToolResponse runCursorUpdate (const glm::ivec2& pos)
   {
+    this->runSynchronize ();
+
     DynamicMeshIntersection cursorIntersection;
     this->setCursorByIntersection (pos, cursorIntersection);
     return ToolResponse::Redraw;
@@ -214,7 +612,20 @@ struct ToolSculpt::Impl
 
   ToolResponse runCommit ()
   {
+    this->runSynchronize ();
+    this->governor.endStroke (this->self->state ().scene ());
+    this->bufferData ();
+    this->self->state ().scene ().forEachMesh ([](DynamicMesh& m) { m.endStroke (); });
+
+    if (this->sculptState == SculptState::Sculpted && this->layer > 0)
+    {
+      this->recordLayer ();
+    }
     this->brush.resetPointOfAction ();
+    this->levelMesh = nullptr;
+    this->arena.reset ();
+    this->reference.reset ();
+    this->self->state ().sculptRecording ().endStroke ();
 
     if (this->sculptState == SculptState::Started)
     {
@@ -230,6 +641,15 @@ struct ToolSculpt::Impl
 
     this->brush.detailFactor (config.get<float> ("editor/tool/sculpt/detail-factor"));
     this->brush.stepWidthFactor (config.get<float> ("editor/tool/sculpt/step-width-factor"));
+    this->brush.batchSubdivision (config.get<bool> ("editor/tool/sculpt/batch-subdivision"));
+    this->governor.budget (config.get<float> ("editor/tool/sculpt/dab-budget"));
+    this->coalesceEvents = config.get<bool> ("editor/tool/sculpt/coalesce-events");
+    this->sculptInBackground = config.get<bool> ("editor/tool/sculpt/background");
+    this->separateStrokeRegion = config.get<bool> ("editor/tool/sculpt/separate-stroke-region");
+    this->combineMirror = config.get<bool> ("editor/tool/sculpt/mirror/combine");
+    this->highlightRegion = config.get<bool> ("editor/tool/sculpt/highlight-region");
+    this->highlightColor = config.get<Color> ("editor/tool/sculpt/highlight-color");
+    this->prediction.lead (config.get<float> ("editor/tool/sculpt/cursor-prediction"));
 
     this->cursor.color (this->self->config ().get<Color> ("editor/tool/cursor-color"));
   }
@@ -254,18 +674,60 @@ struct ToolSculpt::Impl
   {
     assert (this->brush.hasPointOfAction ());
 
-    ToolSculptAction::sculpt (this->brush);
-    if (this->self->mirrorEnabled () && this->brush.mesh ().isEmpty () == false)
+    SculptRecording& recording = this->self->state ().sculptRecording ();
+    if (recording.isRecording ())
+    {
+      const DynamicMesh& mesh = this->isOnLevel () ? *this->levelMesh : this->brush.mesh ();
+      recording.addDab (this->brush, this->self->state ().scene (), mesh,
+                        this->self->mirrorEnabled () ? &this->self->mirror ().plane () : nullptr,
+                        this->combineMirror);
+    }
+
+    const bool subdivide = this->brush.subdivide ();
+    if (this->isOnLevel ())
+    {
+      this->brush.subdivide (false);
+    }
+    this->governor.beginDab (this->brush);
+
+    if (this->self->mirrorEnabled () && this->combineMirror)
+    {
+      ToolSculptAction::sculpt (this->brush, this->self->mirror ().plane (), this->arena);
+    }
+    else
+    {
+      ToolSculptAction::sculpt (this->brush, this->arena);
+      if (this->self->mirrorEnabled () && this->brush.mesh ().isEmpty () == false)
+      {
+        this->brush.mirror (this->self->mirror ().plane ());
+        ToolSculptAction::sculpt (this->brush, this->arena);
+        this->brush.mirror (this->self->mirror ().plane ());
+      }
+    }
+
+    this->governor.addRegion (this->brush);
+    if (this->self->mirrorEnabled ())
     {
       this->brush.mirror (this->self->mirror ().plane ());
-      ToolSculptAction::sculpt (this->brush);
+      this->governor.addRegion (this->brush);
       this->brush.mirror (this->self->mirror ().plane ());
     }
+    this->governor.endDab (this->brush);
+    this->brush.subdivide (subdivide);
 
     if (this->brush.mesh ().isEmpty ())
     {
-      this->self->state ().scene ().deleteEmptyMeshes ();
+      this->unbufferedMeshes.erase (std::remove (this->unbufferedMeshes.begin (),
+                                                 this->unbufferedMeshes.end (),
+                                                 &this->brush.mesh ()),
+                                    this->unbufferedMeshes.end ());
+      this->hasEmptyMesh = true;
       this->brush.resetPointOfAction ();
+
+      if (this->isWorking == false)
+      {
+        this->bufferData ();
+      }
     }
   }
 
@@ -279,6 +741,7 @@ struct ToolSculpt::Impl
       }
       this->cursor.enable ();
       this->cursor.position (intersection.position ());
+      this->cursorNormal = intersection.normal ();
       return true;
     }
     else
@@ -297,36 +760,36 @@ struct ToolSculpt::Impl
 
     if (this->self->intersectsScene (ray, intersection))
     {
-      if (this->brush.hasPointOfAction () && (&this->brush.mesh () != &intersection.mesh ()))
+      DynamicMesh& mesh = this->sculptedMesh (intersection.mesh ());
+
+      if (this->brush.hasPointOfAction () && (&this->brush.mesh () != &mesh))
       {
-        this->brush.mesh ().bufferData ();
+        this->markUnbuffered ();
       }
 
       if (useRecentMesh)
       {
         Intersection rIntersection;
-        if (this->self->intersectsRecentDynamicMesh (ray, rIntersection))
+        if (this->reference.intersects (this->self->state ().scene (), ray, rIntersection))
         {
-          this->brush.setPointOfAction (intersection.mesh (), rIntersection.position (),
-                                        rIntersection.normal ());
+          this->brush.setPointOfAction (mesh, rIntersection.position (), rIntersection.normal ());
         }
         else
         {
-          this->brush.mesh ().bufferData ();
+          this->markUnbuffered ();
           this->brush.resetPointOfAction ();
           return false;
         }
       }
       else
       {
-        this->brush.setPointOfAction (intersection.mesh (), intersection.position (),
-                                      intersection.normal ());
+        this->brush.setPointOfAction (mesh, intersection.position (), intersection.normal ());
       }
       return true;
     }
     else
     {
-      this->brush.mesh ().bufferData ();
+      this->markUnbuffered ();
       this->brush.resetPointOfAction ();
       return false;
     }
@@ -350,6 +813,11 @@ struct ToolSculpt::Impl
         (*toggle) ();
       }
 
+      if (e.pressEvent ())
+      {
+        this->prepareLevel (cursorIntersection.mesh ());
+      }
+
       if (this->brush.hasPointOfAction ())
       {
         this->step.stepWidth (this->brush.stepWidth ());
@@ -380,8 +848,7 @@ struct ToolSculpt::Impl
 
       if (this->brush.hasPointOfAction ())
       {
-        assert (this->brush.mesh ().isEmpty () == false);
-        this->brush.mesh ().bufferData ();
+        this->markUnbuffered ();
       }
 
       if (doToggle)
@@ -407,7 +874,9 @@ struct ToolSculpt::Impl
       {
         if (this->setCursorByIntersection (e.position (), cursorIntersection))
         {
-          this->brush.setPointOfAction (cursorIntersection.mesh (), cursorIntersection.position (),
+          this->prepareLevel (cursorIntersection.mesh ());
+          this->brush.setPointOfAction (this->sculptedMesh (cursorIntersection.mesh ()),
+                                        cursorIntersection.position (),
                                         cursorIntersection.normal ());
           this->cursor.disable ();
           movement.reset (cursorIntersection.position ());
@@ -442,8 +911,7 @@ struct ToolSculpt::Impl
           this->sculpt ();
           if (this->brush.hasPointOfAction ())
           {
-            assert (this->brush.mesh ().isEmpty () == false);
-            this->brush.mesh ().bufferData ();
+            this->markUnbuffered ();
           }
           return true;
         }
@@ -480,7 +948,7 @@ struct ToolSculpt::Impl
 
   void setAbsoluteRadius ()
   {
-    const float max = this->self->config ().get<float> ("editor/tool/sculpt/max-absolute-radius");
+    const float max = this->self->config ().get<float> (this->maxAbsoluteRadiusKey);
     const float factor = this->radiusEdit.doubleValue ();
 
     this->absoluteRadius = true;
@@ -499,8 +967,11 @@ DELEGATE3 (bool, ToolSculpt, drawlikeStroke, const ViewPointingEvent&, bool,
 DELEGATE2 (bool, ToolSculpt, grablikeStroke, const ViewPointingEvent&, ToolUtilMovement&)
 DELEGATE1 (void, ToolSculpt, registerSecondarySlider, ViewDoubleSlider&)
 DELEGATE (ToolResponse, ToolSculpt, runInitialize)
+DELEGATE (void, ToolSculpt, runPrepareRender)
 DELEGATE_CONST (void, ToolSculpt, runRender)
+DELEGATE (void, ToolSculpt, runFinishRender)
 DELEGATE1 (ToolResponse, ToolSculpt, runPointingEvent, const ViewPointingEvent&)
 DELEGATE1 (ToolResponse, ToolSculpt, runCursorUpdate, const glm::ivec2&)
 DELEGATE (ToolResponse, ToolSculpt, runCommit)
 DELEGATE (void, ToolSculpt, runFromConfig)
+DELEGATE (void, ToolSculpt, runSynchronize)
@@ -32,11 +32,14 @@ private:
   IMPLEMENTATION
 
   ToolResponse runInitialize ();
+  void         runPrepareRender ();
   void         runRender () const;
+  void         runFinishRender ();
   ToolResponse runPointingEvent (const ViewPointingEvent&);
   ToolResponse runCursorUpdate (const glm::ivec2&);
   ToolResponse runCommit ();
   void         runFromConfig ();
+  void         runSynchronize ();
 
   virtual void runSetupBrush (SculptBrush&) = 0;
   virtual void runSetupCursor (ViewCursor&) = 0;
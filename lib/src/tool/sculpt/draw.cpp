@@ -68,7 +68,7 @@ struct ToolSculptDraw::Impl
     SBDrawParameters& params = this->self->brush ().parameters<SBDrawParameters> ();
 
     const std::function<void()> toggleInvert = [&params]() { params.toggleInvert (); };
-    return this->self->drawlikeStroke (e, params.constantHeight (), &toggleInvert);
+    return this->self->drawlikeStroke (e, false, &toggleInvert);
   }
 };
 
@@ -0,0 +1,58 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QCheckBox>
+#include "cache.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tools.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+struct ToolSculptFreeze::Impl
+{
+  ToolSculptFreeze* self;
+
+  Impl (ToolSculptFreeze* s)
+    : self (s)
+  {
+  }
+
+  void runSetupBrush (SculptBrush& brush)
+  {
+    auto& params = brush.initParameters<SBFreezeParameters> ();
+
+    params.invert (this->self->cache ().get<bool> ("unfreeze", false));
+
+    brush.subdivide (false);
+  }
+
+  void runSetupCursor (ViewCursor&) {}
+
+  void runSetupProperties (ViewTwoColumnGrid& properties)
+  {
+    auto& params = this->self->brush ().parameters<SBFreezeParameters> ();
+
+    QCheckBox& unfreezeEdit = ViewUtil::checkBox (QObject::tr ("Unfreeze"), params.invert ());
+    ViewUtil::connect (unfreezeEdit, [this, &params](bool u) {
+      params.invert (u);
+      this->self->cache ().set ("unfreeze", u);
+    });
+    properties.add (unfreezeEdit);
+  }
+
+  void runSetupToolTip (ViewToolTip& toolTip)
+  {
+    this->self->addDefaultToolTip (toolTip, true, false);
+  }
+
+  bool runSculptPointingEvent (const ViewPointingEvent& e)
+  {
+    const std::function<void()> toggleInvert = [this]() {
+      this->self->brush ().parameters<SBFreezeParameters> ().toggleInvert ();
+    };
+    return this->self->drawlikeStroke (e, false, &toggleInvert);
+  }
+};
+
+DELEGATE_TOOL_SCULPT (ToolSculptFreeze)
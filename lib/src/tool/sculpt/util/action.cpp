@@ -2,15 +2,20 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
 #include "intersection.hpp"
+#include "parallel.hpp"
+#include "primitive/plane.hpp"
 #include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
+#include "profile.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/arena.hpp"
 #include "tool/sculpt/util/brush.hpp"
 #include "tool/sculpt/util/edge-collection.hpp"
 #include "util.hpp"
@@ -18,16 +23,33 @@
 namespace
 {
   constexpr float minEdgeLength = 0.001f;
-
+  constexpr float maxFlatAngle = 0.1f;
+  constexpr float maxCoarseEdgeLengthFactor = 4.0f;
+  // flooded edges are kept within these factors of the target length (cf. Botsch and Kobbelt: A
+  // Remeshing Approach to Multiresolution Modeling, 2004)
+  constexpr float minFloodEdgeLengthFactor = 4.0f / 5.0f;
+  constexpr float maxFloodEdgeLengthFactor = 4.0f / 3.0f;
+  constexpr unsigned int smoothingGrainSize = 1 << 10;
+  constexpr unsigned int subdivisionGrainSize = 1 << 10;
+  constexpr double minRelativeDeterminant = 1.0e-6;
+
+  // the buffers of new faces and of faces to delete belong to the arena
   struct NewFaces
   {
-    std::vector<unsigned int>        vertexIndices;
-    std::unordered_set<unsigned int> facesToDelete;
+    std::vector<unsigned int>& vertexIndices;
+    DynamicFaces&              facesToDelete;
+
+    NewFaces (ToolSculptArena& arena)
+      : vertexIndices (arena.newFaceIndices ())
+      , facesToDelete (arena.deletedFaces ())
+    {
+      this->reset ();
+    }
 
     void reset ()
     {
       this->vertexIndices.clear ();
-      this->facesToDelete.clear ();
+      this->facesToDelete.reset ();
     }
 
     void addFace (unsigned int i1, unsigned int i2, unsigned int i3)
@@ -39,10 +61,11 @@ namespace
 
     void deleteFace (unsigned int i) { this->facesToDelete.insert (i); }
 
-    bool applyToMesh (DynamicMesh& mesh, DynamicFaces& faces) const
+    bool applyToMesh (DynamicMesh& mesh, DynamicFaces& faces)
     {
       assert (this->vertexIndices.size () % 3 == 0);
 
+      this->facesToDelete.commit ();
       for (unsigned int i : this->facesToDelete)
       {
         mesh.deleteFace (i);
@@ -53,96 +76,195 @@ namespace
         const unsigned int f = mesh.addFace (this->vertexIndices[i + 0], this->vertexIndices[i + 1],
                                              this->vertexIndices[i + 2]);
 
-        if (i >= this->facesToDelete.size () * 3)
+        if (i >= this->facesToDelete.numElements () * 3)
         {
           faces.insert (f);
         }
       }
-      return this->facesToDelete.size () <= (this->vertexIndices.size () / 3);
+      return this->facesToDelete.numElements () <= (this->vertexIndices.size () / 3);
     }
   };
 
-  void extendAndFilterDomain (const SculptBrush& brush, DynamicFaces& faces, unsigned int numRings)
+  /* The region of a sculpting step: the brush's sphere and, if a mirrored brush is sculpted in
+   * the same pass, the mirrored sphere.
+   */
+  struct SculptDomain
   {
-    assert (faces.hasUncomitted () == false);
-    const DynamicMesh& mesh = brush.mesh ();
-    const PrimSphere   sphere = brush.sphere ();
+    std::vector<PrimSphere>        spheres;
+    std::function<DynamicFaces()>  affectedFaces;
 
-    std::unordered_set<unsigned int> frontier;
+    SculptDomain (const SculptBrush& brush)
+      : spheres ({brush.sphere ()})
+      , affectedFaces ([&brush]() { return brush.getAffectedFaces (); })
+    {
+    }
 
-    faces.filter ([&mesh, &sphere, &frontier](unsigned int i) {
-      const PrimTriangle face = mesh.face (i);
+    SculptDomain (const DynamicMesh& mesh, const std::vector<PrimSphere>& s)
+      : spheres (s)
+      , affectedFaces ([&mesh, s]() {
+        DynamicFaces faces;
+
+        for (const PrimSphere& sphere : s)
+        {
+          DynamicFaces sphereFaces;
+          mesh.intersects (sphere, sphereFaces);
+          faces.insert (sphereFaces.indices ());
+        }
+        faces.commit ();
+        return faces;
+      })
+    {
+    }
+
+    SculptDomain (SculptBrush& brush, const PrimPlane& mirror)
+    {
+      this->spheres.push_back (brush.sphere ());
+      brush.mirror (mirror);
+      this->spheres.push_back (brush.sphere ());
+      brush.mirror (mirror);
+
+      this->affectedFaces = [&brush, &mirror]() {
+        DynamicFaces faces = brush.getAffectedFaces ();
 
-      if (IntersectionUtil::intersects (sphere, face) == false)
+        brush.mirror (mirror);
+        faces.insert (brush.getAffectedFaces ().indices ());
+        brush.mirror (mirror);
+
+        faces.commit ();
+        return faces;
+      };
+    }
+
+    bool intersects (const PrimTriangle& face) const
+    {
+      for (const PrimSphere& s : this->spheres)
       {
-        return false;
+        if (IntersectionUtil::intersects (s, face))
+        {
+          return true;
+        }
       }
-      else if (sphere.contains (face) == false)
+      return false;
+    }
+
+    bool contains (const PrimTriangle& face) const
+    {
+      for (const PrimSphere& s : this->spheres)
       {
-        frontier.insert (i);
+        if (s.contains (face))
+        {
+          return true;
+        }
       }
-      return true;
-    });
+      return false;
+    }
+  };
 
-    for (unsigned int ring = 0; ring < numRings; ring++)
+  /* Grows a domain ring by ring, where a ring only expands the faces that have been added by the
+   * previous one, i.e., the frontier.  The faces of the domain are marked in the arena, so growing
+   * a ring is proportional to the size of the frontier.
+   */
+  struct DomainGrowth
+  {
+    const DynamicMesh&         mesh;
+    DynamicFaces&              faces;
+    ToolSculptArena::Marks&    marks;
+    std::vector<unsigned int>& frontier;
+    std::vector<unsigned int>& nextFrontier;
+
+    DomainGrowth (const DynamicMesh& m, DynamicFaces& f, ToolSculptArena& arena)
+      : mesh (m)
+      , faces (f)
+      , marks (arena.faceMarks ())
+      , frontier (arena.frontier ())
+      , nextFrontier (arena.nextFrontier ())
     {
-      std::unordered_set<unsigned int> extendedFrontier;
+      assert (f.hasUncomitted () == false);
+
+      this->frontier.clear ();
+      this->nextFrontier.clear ();
+    }
 
-      for (unsigned int i : frontier)
+    // marks the current faces of the domain, which must be done before adding faces
+    void markDomain ()
+    {
+      this->marks.clear ();
+      for (unsigned int i : this->faces)
       {
-        mesh.forEachVertexAdjacentToFace (
-          i, [&mesh, &faces, &frontier, &extendedFrontier](unsigned int v) {
-            for (unsigned int a : mesh.adjacentFaces (v))
-            {
-              if (faces.contains (a) == false && frontier.find (a) == frontier.end ())
-              {
-                faces.insert (a);
-                extendedFrontier.insert (a);
-              }
-            }
-          });
+        this->marks.mark (i);
       }
-      faces.commit ();
-      frontier = std::move (extendedFrontier);
     }
-  }
 
-  void extendDomain (DynamicMesh& mesh, DynamicFaces& faces, unsigned int numRings)
-  {
-    assert (faces.hasUncomitted () == false);
+    void addAdjacentFaces (unsigned int v)
+    {
+      for (unsigned int a : this->mesh.adjacentFaces (v))
+      {
+        if (this->marks.isMarked (a) == false)
+        {
+          this->marks.mark (a);
+          this->faces.insert (a);
+          this->nextFrontier.push_back (a);
+        }
+      }
+    }
 
-    for (unsigned int ring = 0; ring < numRings; ring++)
+    void addRings (unsigned int numRings)
     {
-      for (unsigned int i : faces)
+      for (unsigned int ring = 0; ring < numRings && this->frontier.empty () == false; ring++)
       {
-        mesh.forEachVertexAdjacentToFace (i, [&mesh, &faces](unsigned int v) {
-          for (unsigned int a : mesh.adjacentFaces (v))
-          {
-            if (faces.contains (a) == false)
-            {
-              faces.insert (a);
-            }
-          }
-        });
+        for (unsigned int i : this->frontier)
+        {
+          this->mesh.forEachVertexAdjacentToFace (
+            i, [this](unsigned int v) { this->addAdjacentFaces (v); });
+        }
+        this->frontier.swap (this->nextFrontier);
+        this->nextFrontier.clear ();
       }
-      faces.commit ();
+      this->faces.commit ();
     }
+  };
+
+  void extendAndFilterDomain (const DynamicMesh& mesh, const SculptDomain& domain,
+                              DynamicFaces& faces, unsigned int numRings, ToolSculptArena& arena)
+  {
+    DomainGrowth growth (mesh, faces, arena);
+
+    faces.filter ([&mesh, &domain, &growth](unsigned int i) {
+      const PrimTriangle face = mesh.face (i);
+
+      if (domain.intersects (face) == false)
+      {
+        return false;
+      }
+      else if (domain.contains (face) == false)
+      {
+        growth.frontier.push_back (i);
+      }
+      return true;
+    });
+    growth.markDomain ();
+    growth.addRings (numRings);
   }
 
-  void extendDomainByPoles (DynamicMesh& mesh, DynamicFaces& faces)
+  void extendDomain (const DynamicMesh& mesh, DynamicFaces& faces, unsigned int numRings,
+                     ToolSculptArena& arena)
   {
-    assert (faces.hasUncomitted () == false);
+    DomainGrowth growth (mesh, faces, arena);
+
+    growth.frontier.assign (faces.begin (), faces.end ());
+    growth.markDomain ();
+    growth.addRings (numRings);
+  }
+
+  void extendDomainByPoles (const DynamicMesh& mesh, DynamicFaces& faces, ToolSculptArena& arena)
+  {
+    DomainGrowth growth (mesh, faces, arena);
 
-    mesh.forEachVertex (faces, [&mesh, &faces](unsigned int i) {
+    growth.markDomain ();
+    mesh.forEachVertex (faces, [&mesh, &growth](unsigned int i) {
       if (mesh.valence (i) > 6)
       {
-        for (unsigned int a : mesh.adjacentFaces (i))
-        {
-          if (faces.contains (a) == false)
-          {
-            faces.insert (a);
-          }
-        }
+        growth.addAdjacentFaces (i);
       }
     });
     faces.commit ();
@@ -173,152 +295,216 @@ namespace
     }
   }
 
-  void splitEdges (DynamicMesh& mesh, ToolSculptEdgeMap& newE, float maxLength, DynamicFaces& faces)
+  /* Edges are planned in parallel, i.e., long edges and their new vertices are determined from
+   * the unchanged mesh, and are split in the order of the faces afterwards.  An edge of two faces
+   * is planned twice but split once.  Only faces that split an edge are kept.
+   */
+  void splitEdges (DynamicMesh& mesh, ToolSculptEdgeMap& newE, float maxLength, DynamicFaces& faces,
+                   ToolSculptArena& arena)
   {
     assert (faces.hasUncomitted () == false);
 
-    const auto split = [&mesh, &newE, maxLength](unsigned int i1, unsigned int i2) {
-      if (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) > maxLength * maxLength)
-      {
-        const glm::vec3 normal = glm::normalize (mesh.vertexNormal (i1) + mesh.vertexNormal (i2));
-        const unsigned int i3 = mesh.addVertex (getSplitPosition (mesh, i1, i2), normal);
-        newE.insert (i1, i2, i3);
-        return true;
-      }
-      else
+    mesh.updateNormals ();
+
+    const std::vector<unsigned int>&         indices = faces.indices ();
+    std::vector<ToolSculptArena::EdgeSplit>& plans = arena.edgeSplits ();
+    plans.resize (indices.size ());
+
+    // edges of frozen vertices are not split
+    const auto plan = [&mesh, maxLength](unsigned int i1, unsigned int i2,
+                                         ToolSculptArena::EdgeSplit& split, unsigned int e) {
+      split.isSplit[e] =
+        mesh.isFrozen (i1) == false && mesh.isFrozen (i2) == false &&
+        glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) > maxLength * maxLength;
+
+      if (split.isSplit[e])
       {
-        return false;
+        split.positions[e] = getSplitPosition (mesh, i1, i2);
+        split.normals[e] = glm::normalize (mesh.vertexNormal (i1) + mesh.vertexNormal (i2));
       }
     };
 
-    faces.filter ([&mesh, &newE, &split](unsigned int f) {
-      bool wasSplit = false;
+    Parallel::forRange (indices.size (), subdivisionGrainSize,
+                        [&mesh, &indices, &plans, &plan](unsigned int begin, unsigned int end) {
+                          for (unsigned int k = begin; k < end; k++)
+                          {
+                            unsigned int i1, i2, i3;
+                            mesh.vertexIndices (indices[k], i1, i2, i3);
+
+                            plan (i1, i2, plans[k], 0);
+                            plan (i1, i3, plans[k], 1);
+                            plan (i2, i3, plans[k], 2);
+                          }
+                        });
+
+    ToolSculptArena::Marks& splitFaces = arena.faceMarks ();
+    splitFaces.clear ();
 
+    for (unsigned int k = 0; k < indices.size (); k++)
+    {
       unsigned int i1, i2, i3;
-      mesh.vertexIndices (f, i1, i2, i3);
+      mesh.vertexIndices (indices[k], i1, i2, i3);
 
-      if (newE.contains (i1, i2) == false)
-      {
-        wasSplit = split (i1, i2) || wasSplit;
-      }
+      const unsigned int edges[3][2] = {{i1, i2}, {i1, i3}, {i2, i3}};
 
-      if (newE.contains (i1, i3) == false)
+      for (unsigned int e = 0; e < 3; e++)
       {
-        wasSplit = split (i1, i3) || wasSplit;
-      }
+        const unsigned int j1 = edges[e][0];
+        const unsigned int j2 = edges[e][1];
 
-      if (newE.contains (i2, i3) == false)
-      {
-        wasSplit = split (i2, i3) || wasSplit;
+        if (plans[k].isSplit[e] && newE.contains (j1, j2) == false)
+        {
+          const unsigned int j3 = mesh.addVertex (plans[k].positions[e], plans[k].normals[e]);
+          arena.inheritBasePosition (mesh, j1, j2, j3);
+          newE.insert (j1, j2, j3);
+          splitFaces.mark (indices[k]);
+        }
       }
-      return wasSplit;
-    });
+    }
+    faces.filter ([&splitFaces](unsigned int f) { return splitFaces.isMarked (f); });
   }
 
-  void triangulate (DynamicMesh& mesh, const ToolSculptEdgeMap& newE, DynamicFaces& faces)
+  // determines the faces that replace a face whose edges have been split
+  void planTriangulation (const DynamicMesh& mesh, const ToolSculptEdgeMap& newE,
+                          ToolSculptArena::FaceSplit& split)
   {
-    assert (faces.hasUncomitted () == false);
+    const auto add = [&split](unsigned int i1, unsigned int i2, unsigned int i3) {
+      split.indices[(3 * split.numFaces) + 0] = i1;
+      split.indices[(3 * split.numFaces) + 1] = i2;
+      split.indices[(3 * split.numFaces) + 2] = i3;
+      split.numFaces++;
+    };
 
-    NewFaces newF;
+    unsigned int i1, i2, i3;
+    mesh.vertexIndices (split.face, i1, i2, i3);
 
-    mesh.forEachFaceExt (faces, [&mesh, &newE, &newF](unsigned int f) {
-      unsigned int i1, i2, i3;
-      mesh.vertexIndices (f, i1, i2, i3);
+    const unsigned int e12 = newE.find (i1, i2);
+    const unsigned int e13 = newE.find (i1, i3);
+    const unsigned int e23 = newE.find (i2, i3);
+    const unsigned int invalid = Util::invalidIndex ();
+
+    const unsigned int v1 = mesh.valence (i1);
+    const unsigned int v2 = mesh.valence (i2);
+    const unsigned int v3 = mesh.valence (i3);
 
-      const unsigned int e12 = newE.find (i1, i2);
-      const unsigned int e13 = newE.find (i1, i3);
-      const unsigned int e23 = newE.find (i2, i3);
-      const unsigned int invalid = Util::invalidIndex ();
+    split.numFaces = 0;
 
-      const unsigned int v1 = mesh.valence (i1);
-      const unsigned int v2 = mesh.valence (i2);
-      const unsigned int v3 = mesh.valence (i3);
+    if (e12 == invalid && e13 == invalid && e23 == invalid)
+    {
+    }
+    // One new vertex
+    else if (e12 != invalid && e13 == invalid && e23 == invalid)
+    {
+      add (i1, e12, i3);
+      add (i3, e12, i2);
+    }
+    else if (e12 == invalid && e13 != invalid && e23 == invalid)
+    {
+      add (i3, e13, i2);
+      add (i2, e13, i1);
+    }
+    else if (e12 == invalid && e13 == invalid && e23 != invalid)
+    {
+      add (i2, e23, i1);
+      add (i1, e23, i3);
+    }
+    // Two new vertices
+    else if (e12 != invalid && e13 != invalid && e23 == invalid)
+    {
+      add (e12, e13, i1);
 
-      if (e12 == invalid && e13 == invalid && e23 == invalid)
+      if (v2 < v3)
       {
+        add (i2, i3, e13);
+        add (i2, e13, e12);
       }
-      // One new vertex
-      else if (e12 != invalid && e13 == invalid && e23 == invalid)
+      else
       {
-        newF.deleteFace (f);
-        newF.addFace (i1, e12, i3);
-        newF.addFace (i3, e12, i2);
+        add (i3, e12, i2);
+        add (i3, e13, e12);
       }
-      else if (e12 == invalid && e13 != invalid && e23 == invalid)
+    }
+    else if (e12 != invalid && e13 == invalid && e23 != invalid)
+    {
+      add (e23, e12, i2);
+
+      if (v1 < v3)
       {
-        newF.deleteFace (f);
-        newF.addFace (i3, e13, i2);
-        newF.addFace (i2, e13, i1);
+        add (i1, e23, i3);
+        add (i1, e12, e23);
       }
-      else if (e12 == invalid && e13 == invalid && e23 != invalid)
+      else
       {
-        newF.deleteFace (f);
-        newF.addFace (i2, e23, i1);
-        newF.addFace (i1, e23, i3);
+        add (i3, i1, e12);
+        add (i3, e12, e23);
       }
-      // Two new vertices
-      else if (e12 != invalid && e13 != invalid && e23 == invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (e12, e13, i1);
+    }
+    else if (e12 == invalid && e13 != invalid && e23 != invalid)
+    {
+      add (e13, e23, i3);
 
-        if (v2 < v3)
-        {
-          newF.addFace (i2, i3, e13);
-          newF.addFace (i2, e13, e12);
-        }
-        else
-        {
-          newF.addFace (i3, e12, i2);
-          newF.addFace (i3, e13, e12);
-        }
+      if (v1 < v2)
+      {
+        add (i1, i2, e23);
+        add (i1, e23, e13);
       }
-      else if (e12 != invalid && e13 == invalid && e23 != invalid)
+      else
       {
-        newF.deleteFace (f);
-        newF.addFace (e23, e12, i2);
-
-        if (v1 < v3)
-        {
-          newF.addFace (i1, e23, i3);
-          newF.addFace (i1, e12, e23);
-        }
-        else
-        {
-          newF.addFace (i3, i1, e12);
-          newF.addFace (i3, e12, e23);
-        }
+        add (i2, e13, i1);
+        add (i2, e23, e13);
       }
-      else if (e12 == invalid && e13 != invalid && e23 != invalid)
+    }
+    // Three new vertices
+    else if (e12 != invalid && e13 != invalid && e23 != invalid)
+    {
+      add (e12, e23, e13);
+      add (i1, e12, e13);
+      add (i2, e23, e12);
+      add (i3, e13, e23);
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+
+  // faces are planned in parallel and are replaced in order afterwards
+  void triangulate (DynamicMesh& mesh, const ToolSculptEdgeMap& newE, DynamicFaces& faces,
+                    ToolSculptArena& arena)
+  {
+    assert (faces.hasUncomitted () == false);
+
+    std::vector<ToolSculptArena::FaceSplit>& plans = arena.faceSplits ();
+    plans.clear ();
+
+    mesh.forEachFaceExt (faces, [&plans](unsigned int f) {
+      ToolSculptArena::FaceSplit split;
+      split.face = f;
+      plans.push_back (split);
+    });
+
+    Parallel::forRange (plans.size (), subdivisionGrainSize,
+                        [&mesh, &newE, &plans](unsigned int begin, unsigned int end) {
+                          for (unsigned int k = begin; k < end; k++)
+                          {
+                            planTriangulation (mesh, newE, plans[k]);
+                          }
+                        });
+
+    NewFaces newF (arena);
+    for (const ToolSculptArena::FaceSplit& split : plans)
+    {
+      if (split.numFaces > 0)
       {
-        newF.deleteFace (f);
-        newF.addFace (e13, e23, i3);
+        newF.deleteFace (split.face);
 
-        if (v1 < v2)
+        for (unsigned int i = 0; i < split.numFaces; i++)
         {
-          newF.addFace (i1, i2, e23);
-          newF.addFace (i1, e23, e13);
+          newF.addFace (split.indices[(3 * i) + 0], split.indices[(3 * i) + 1],
+                        split.indices[(3 * i) + 2]);
         }
-        else
-        {
-          newF.addFace (i2, e13, i1);
-          newF.addFace (i2, e23, e13);
-        }
-      }
-      // Three new vertices
-      else if (e12 != invalid && e13 != invalid && e23 != invalid)
-      {
-        newF.deleteFace (f);
-        newF.addFace (e12, e23, e13);
-        newF.addFace (i1, e12, e13);
-        newF.addFace (i2, e23, e12);
-        newF.addFace (i3, e13, e23);
-      }
-      else
-      {
-        DILAY_IMPOSSIBLE
       }
-    });
+    }
     const bool increasing = newF.applyToMesh (mesh, faces);
     assert (increasing);
     unused (increasing);
@@ -326,10 +512,9 @@ namespace
     faces.commit ();
   }
 
-  void relaxEdges (DynamicMesh& mesh, const DynamicFaces& faces)
+  void relaxEdges (DynamicMesh& mesh, const std::vector<unsigned int>& vertices,
+                   ToolSculptArena& arena)
   {
-    assert (faces.hasUncomitted () == false);
-
     const auto isRelaxable = [&mesh](const ui_pair& edge, unsigned int leftVertex,
                                      unsigned int rightVertex) {
       const int vE1 = int(mesh.valence (edge.first));
@@ -345,21 +530,32 @@ namespace
       return (vE1 > 3) && (vE2 > 3) && (post < pre);
     };
 
-    ToolSculptEdgeSet edgeSet;
-    mesh.forEachVertex (faces, [&mesh, &edgeSet](unsigned int i) {
+    // edges are not flipped if they change the faces of frozen vertices
+    const auto isFrozen = [&mesh](const ui_pair& edge, unsigned int leftVertex,
+                                  unsigned int rightVertex) {
+      return mesh.isFrozen (edge.first) || mesh.isFrozen (edge.second) ||
+             mesh.isFrozen (leftVertex) || mesh.isFrozen (rightVertex);
+    };
+
+    ToolSculptEdgeSet& edgeSet = arena.relaxableEdges ();
+    edgeSet.reset ();
+
+    for (unsigned int i : vertices)
+    {
       if (mesh.valence (i) > 6)
       {
         mesh.forEachVertexAdjacentToVertex (
           i, [i, &edgeSet](unsigned int j) { edgeSet.insert (i, j); });
       }
-    });
+    }
 
     for (const ui_pair& edge : edgeSet)
     {
       unsigned int leftFace, leftVertex, rightFace, rightVertex;
       mesh.findAdjacent (edge.first, edge.second, leftFace, leftVertex, rightFace, rightVertex);
 
-      if (isRelaxable (edge, leftVertex, rightVertex))
+      if (isRelaxable (edge, leftVertex, rightVertex) &&
+          isFrozen (edge, leftVertex, rightVertex) == false)
       {
         mesh.deleteFace (leftFace);
         mesh.deleteFace (rightFace);
@@ -375,68 +571,93 @@ namespace
     }
   }
 
-  void smooth (DynamicMesh& mesh, DynamicFaces& faces)
+  void relaxEdges (DynamicMesh& mesh, const DynamicFaces& faces, ToolSculptArena& arena)
   {
-    std::unordered_map<unsigned int, glm::vec3> newPosition;
+    assert (faces.hasUncomitted () == false);
+    relaxEdges (mesh, mesh.vertices (faces), arena);
+  }
 
-    mesh.forEachVertex (faces, [&mesh, &newPosition](unsigned int i) {
-      const glm::vec3  avgPos = mesh.averagePosition (i);
-      const glm::vec3& normal = mesh.vertexNormal (i);
-      const glm::vec3  delta = avgPos - mesh.vertex (i);
-      const glm::vec3  tangentialPos = avgPos - (normal * glm::dot (normal, delta));
+  // the tangential average of a vertex's neighbors, projected onto its adjacent faces
+  glm::vec3 smoothedPosition (const DynamicMesh& mesh, unsigned int i)
+  {
+    const glm::vec3  avgPos = mesh.averagePosition (i);
+    const glm::vec3& normal = mesh.vertexNormal (i);
+    const glm::vec3  delta = avgPos - mesh.vertex (i);
+    const glm::vec3  tangentialPos = avgPos - (normal * glm::dot (normal, delta));
 
-      constexpr float lo = -Util::epsilon ();
-      constexpr float hi = 1.0f + Util::epsilon ();
+    constexpr float lo = -Util::epsilon ();
+    constexpr float hi = 1.0f + Util::epsilon ();
 
-      float     minDistance = Util::maxFloat ();
-      glm::vec3 projectedPos (0.0f);
+    float     minDistance = Util::maxFloat ();
+    glm::vec3 projectedPos (0.0f);
 
-      for (unsigned int a : mesh.adjacentFaces (i))
-      {
-        unsigned int i1, i2, i3;
-        mesh.vertexIndices (a, i1, i2, i3);
+    for (unsigned int a : mesh.adjacentFaces (i))
+    {
+      unsigned int i1, i2, i3;
+      mesh.vertexIndices (a, i1, i2, i3);
 
-        const glm::vec3& p1 = mesh.vertex (i1);
-        const glm::vec3& p2 = mesh.vertex (i2);
-        const glm::vec3& p3 = mesh.vertex (i3);
+      const glm::vec3& p1 = mesh.vertex (i1);
+      const glm::vec3& p2 = mesh.vertex (i2);
+      const glm::vec3& p3 = mesh.vertex (i3);
 
-        const glm::vec3 u = p2 - p1;
-        const glm::vec3 v = p3 - p1;
-        const glm::vec3 w = tangentialPos - p1;
-        const glm::vec3 n = glm::cross (u, v);
+      const glm::vec3 u = p2 - p1;
+      const glm::vec3 v = p3 - p1;
+      const glm::vec3 w = tangentialPos - p1;
+      const glm::vec3 n = glm::cross (u, v);
 
-        const float b1 = glm::dot (glm::cross (u, w), n) / (glm::dot (n, n));
-        const float b2 = glm::dot (glm::cross (w, v), n) / (glm::dot (n, n));
-        const float b3 = 1.0f - b1 - b2;
+      const float b1 = glm::dot (glm::cross (u, w), n) / (glm::dot (n, n));
+      const float b2 = glm::dot (glm::cross (w, v), n) / (glm::dot (n, n));
+      const float b3 = 1.0f - b1 - b2;
 
-        if (lo < b1 && b1 < hi && lo < b2 && b2 < hi && lo < b3 && b3 < hi)
-        {
-          const glm::vec3 proj = (b3 * p1) + (b2 * p2) + (b1 * p3);
-          const float     d = glm::distance2 (tangentialPos, proj);
+      if (lo < b1 && b1 < hi && lo < b2 && b2 < hi && lo < b3 && b3 < hi)
+      {
+        const glm::vec3 proj = (b3 * p1) + (b2 * p2) + (b1 * p3);
+        const float     d = glm::distance2 (tangentialPos, proj);
 
-          if (d < minDistance)
-          {
-            minDistance = d;
-            projectedPos = proj;
-          }
+        if (d < minDistance)
+        {
+          minDistance = d;
+          projectedPos = proj;
         }
       }
-      if (minDistance != Util::maxFloat ())
-      {
-        newPosition.emplace (i, projectedPos);
-      }
-      else
-      {
-        newPosition.emplace (i, tangentialPos);
-      }
-    });
+    }
+    return minDistance != Util::maxFloat () ? projectedPos : tangentialPos;
+  }
 
-    for (const auto& it : newPosition)
+  /* New positions are computed in parallel from the old ones and written afterwards, hence the
+   * result does not depend on the order of the vertices.  Frozen vertices keep their positions.
+   */
+  void smooth (DynamicMesh& mesh, const std::vector<unsigned int>& vertices,
+               ToolSculptArena& arena)
+  {
+    mesh.updateNormals ();
+
+    std::vector<glm::vec3>& newPositions = arena.positions ();
+    newPositions.resize (vertices.size ());
+    Parallel::forRange (vertices.size (), smoothingGrainSize,
+                        [&mesh, &vertices, &newPositions](unsigned int begin, unsigned int end) {
+                          for (unsigned int k = begin; k < end; k++)
+                          {
+                            newPositions[k] = mesh.isFrozen (vertices[k])
+                                                ? mesh.vertex (vertices[k])
+                                                : smoothedPosition (mesh, vertices[k]);
+                          }
+                        });
+
+    for (unsigned int k = 0; k < vertices.size (); k++)
     {
-      mesh.vertex (it.first, it.second);
+      if (mesh.isFrozen (vertices[k]) == false)
+      {
+        mesh.vertex (vertices[k], newPositions[k]);
+      }
     }
   }
 
+  void smooth (DynamicMesh& mesh, DynamicFaces& faces, ToolSculptArena& arena)
+  {
+    smooth (mesh, mesh.vertices (faces), arena);
+  }
+
   bool deleteValence3Vertex (DynamicMesh& mesh, unsigned int i, DynamicFaces& faces)
   {
     assert (mesh.isFreeVertex (i) == false);
@@ -511,7 +732,9 @@ namespace
     }
   };
 
-  bool collapseEdge (DynamicMesh& mesh, unsigned int i1, unsigned int i2, DynamicFaces faces)
+  // returns the remaining vertex of a collapsed edge, which is moved to the given position
+  unsigned int collapseEdge (DynamicMesh& mesh, unsigned int i1, unsigned int i2,
+                             const glm::vec3& newPos, DynamicFaces& faces, ToolSculptArena& arena)
   {
     const unsigned int v1 = mesh.valence (i1);
     const unsigned int v2 = mesh.valence (i2);
@@ -540,7 +763,7 @@ namespace
     assert (isValidEdge (i1, i2));
 #endif
 
-    NewFaces newFaces;
+    NewFaces newFaces (arena);
 
     const auto addFaces = [&mesh, &newFaces](unsigned int newI, unsigned int i1, unsigned int i2) {
       for (unsigned int a : mesh.adjacentFaces (i1))
@@ -613,18 +836,16 @@ namespace
       return n;
     };
 
-    const glm::vec3 newPos = Util::midpoint (mesh.vertex (i1), mesh.vertex (i2));
-
     if (v1 == 3)
     {
       if (deleteValence3Vertex (mesh, i1, faces))
       {
         mesh.vertex (i2, newPos);
-        return true;
+        return i2;
       }
       else
       {
-        return false;
+        return Util::invalidIndex ();
       }
     }
     if (v2 == 3)
@@ -632,11 +853,11 @@ namespace
       if (deleteValence3Vertex (mesh, i2, faces))
       {
         mesh.vertex (i1, newPos);
-        return true;
+        return i1;
       }
       else
       {
-        return false;
+        return Util::invalidIndex ();
       }
     }
 
@@ -651,15 +872,16 @@ namespace
 
     if (leftVertex == rightVertex)
     {
-      return false;
+      return Util::invalidIndex ();
     }
     else if (vLeftVertex == 3 || vRightVertex == 3)
     {
-      return false;
+      return Util::invalidIndex ();
     }
     else if (numCommonAdjacentVertices () == 2)
     {
       const unsigned int newI = mesh.addVertex (newPos, glm::vec3 (0.0f));
+      arena.inheritBasePosition (mesh, i1, i2, newI);
 
       addFaces (newI, i1, i2);
       addFaces (newI, i2, i1);
@@ -676,85 +898,677 @@ namespace
       assert (mesh.isFreeVertex (i2));
       assert (mesh.valence (newI) == v1 + v2 - 4);
 
-      return true;
+      return newI;
     }
     else
     {
-      return false;
+      return Util::invalidIndex ();
     }
   }
 
-  typedef std::function<bool(unsigned int, unsigned int)> CollapsePredicate;
-  bool collapseEdges (DynamicMesh& mesh, const CollapsePredicate& doCollapse, DynamicFaces& faces)
+  // returns the remaining vertex of an edge collapsed to its midpoint or `Util::invalidIndex ()`
+  unsigned int collapseEdge (DynamicMesh& mesh, unsigned int i1, unsigned int i2,
+                             DynamicFaces& faces, ToolSculptArena& arena)
   {
-    bool         collapsed = false;
-    DynamicFaces current;
-    current.insert (faces.indices ());
+    return collapseEdge (mesh, i1, i2, Util::midpoint (mesh.vertex (i1), mesh.vertex (i2)), faces,
+                         arena);
+  }
 
-    do
-    {
-      faces.insert (current.uncommitted ());
-      current.commit ();
+  typedef ToolSculptArena::CollapseCandidate CollapseCandidate;
 
-      for (unsigned int i : current)
-      {
-        if (mesh.isFreeFace (i) == false)
-        {
-          unsigned int i1, i2, i3;
-          mesh.vertexIndices (i, i1, i2, i3);
+  /* Collapses edges between vertices of the domain from the shortest to the longest.  Candidates
+   * are collected once and checked when they are taken from the heap, since collapses invalidate
+   * edges or move vertices.  After each collapse, only the edges around the remaining vertex,
+   * which belongs to the domain, are added.
+   */
+  template <typename F>
+  bool collapseEdges (DynamicMesh& mesh, const F& doCollapse, DynamicFaces& faces,
+                      ToolSculptArena& arena)
+  {
+    assert (faces.hasUncomitted () == false);
 
-          if (doCollapse (i1, i2))
-          {
-            collapsed = collapseEdge (mesh, i1, i2, current) || collapsed;
-          }
-          else if (doCollapse (i1, i3))
-          {
-            collapsed = collapseEdge (mesh, i1, i3, current) || collapsed;
-          }
-          else if (doCollapse (i2, i3))
-          {
-            collapsed = collapseEdge (mesh, i2, i3, current) || collapsed;
-          }
-        }
+    // a min-heap of the arena's candidates
+    std::vector<CollapseCandidate>& candidates = arena.collapseCandidates ();
+    const std::greater<CollapseCandidate> heapOrder;
+    candidates.clear ();
+
+    // frozen vertices are not marked, so that their edges are not collapsed
+    arena.unmarkVertices ();
+    mesh.forEachVertex (faces, [&mesh, &arena](unsigned int i) {
+      if (mesh.isFrozen (i) == false)
+      {
+        arena.markVertex (i);
       }
-    } while (current.uncommitted ().empty () == false);
+    });
 
-    faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
-    faces.commit ();
-    return collapsed;
-  }
+    const auto addCandidate = [&mesh, &doCollapse, &candidates, &heapOrder,
+                               &arena](unsigned int i1, unsigned int i2) {
+      if (arena.isMarkedVertex (i1) && arena.isMarkedVertex (i2) && doCollapse (i1, i2))
+      {
+        candidates.push_back ({glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)), i1, i2});
+        std::push_heap (candidates.begin (), candidates.end (), heapOrder);
+      }
+    };
 
-  bool collapseEdgesByLength (DynamicMesh& mesh, float maxEdgeLengthSqr, DynamicFaces& faces)
-  {
-    const auto isCollapsable = [&mesh, maxEdgeLengthSqr](unsigned int i1, unsigned i2) -> bool {
-      assert (mesh.isFreeVertex (i1) == false);
-      assert (mesh.isFreeVertex (i2) == false);
+    const auto addCandidates = [&mesh, &addCandidate](unsigned int f) {
+      unsigned int i1, i2, i3;
+      mesh.vertexIndices (f, i1, i2, i3);
 
-      return glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) < maxEdgeLengthSqr;
+      addCandidate (i1, i2);
+      addCandidate (i1, i3);
+      addCandidate (i2, i3);
     };
-    return collapseEdges (mesh, isCollapsable, faces);
-  }
 
-  bool collapseAllEdges (DynamicMesh& mesh, DynamicFaces& faces)
-  {
-    return collapseEdges (mesh, [](unsigned int, unsigned int) { return true; }, faces);
-  }
-
-  void finalize (DynamicMesh& mesh, const DynamicFaces& faces)
-  {
-    mesh.forEachVertex (faces, [&mesh](unsigned int i) { mesh.setVertexNormal (i); });
+    const auto isEdge = [&mesh](unsigned int i1, unsigned int i2) {
+      if (mesh.isFreeVertex (i1) || mesh.isFreeVertex (i2))
+      {
+        return false;
+      }
+      for (unsigned int a : mesh.adjacentFaces (i1))
+      {
+        unsigned int a1, a2, a3;
+        mesh.vertexIndices (a, a1, a2, a3);
 
-    for (unsigned int i : faces)
+        if (i2 == a1 || i2 == a2 || i2 == a3)
+        {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    for (unsigned int f : faces)
+    {
+      if (mesh.isFreeFace (f) == false)
+      {
+        addCandidates (f);
+      }
+    }
+
+    bool collapsed = false;
+    while (candidates.empty () == false)
+    {
+      std::pop_heap (candidates.begin (), candidates.end (), heapOrder);
+      const CollapseCandidate c = candidates.back ();
+      candidates.pop_back ();
+
+      if (isEdge (c.i1, c.i2))
+      {
+        if (glm::distance2 (mesh.vertex (c.i1), mesh.vertex (c.i2)) != c.lengthSqr)
+        {
+          addCandidate (c.i1, c.i2);
+        }
+        else
+        {
+          const unsigned int v = collapseEdge (mesh, c.i1, c.i2, faces, arena);
+
+          if (v != Util::invalidIndex ())
+          {
+            collapsed = true;
+            arena.markVertex (v);
+
+            for (unsigned int a : mesh.adjacentFaces (v))
+            {
+              faces.insert (a);
+              addCandidates (a);
+            }
+          }
+        }
+      }
+    }
+
+    faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+    faces.commit ();
+    return collapsed;
+  }
+
+  bool collapseEdgesByLength (DynamicMesh& mesh, float maxEdgeLengthSqr, DynamicFaces& faces,
+                              ToolSculptArena& arena)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction: collapse edges");
+
+    const auto isCollapsable = [&mesh, maxEdgeLengthSqr](unsigned int i1, unsigned i2) -> bool {
+      assert (mesh.isFreeVertex (i1) == false);
+      assert (mesh.isFreeVertex (i2) == false);
+
+      return glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) < maxEdgeLengthSqr;
+    };
+    return collapseEdges (mesh, isCollapsable, faces, arena);
+  }
+
+  bool collapseAllEdges (DynamicMesh& mesh, DynamicFaces& faces, ToolSculptArena& arena)
+  {
+    return collapseEdges (mesh, [](unsigned int, unsigned int) { return true; }, faces, arena);
+  }
+
+  /* The error of a position with respect to the planes of a set of faces, i.e., the sum of their
+   * squared distances weighted by the areas of the faces (cf. Garland and Heckbert).  The error of
+   * `p` is `dot (p, a * p) + 2 * dot (b, p) + c`.
+   */
+  struct Quadric
+  {
+    glm::dmat3 a;
+    glm::dvec3 b;
+    double     c;
+
+    Quadric ()
+      : a (0.0)
+      , b (0.0)
+      , c (0.0)
+    {
+    }
+
+    explicit Quadric (const PrimTriangle& tri)
+      : Quadric ()
+    {
+      const glm::dvec3 cross (tri.cross ());
+      const double     length = glm::length (cross);
+
+      if (length > 0.0)
+      {
+        const glm::dvec3 n = cross / length;
+        const double     d = -glm::dot (n, glm::dvec3 (tri.vertex1 ()));
+        const double     area = 0.5 * length;
+
+        this->a = area * glm::outerProduct (n, n);
+        this->b = area * d * n;
+        this->c = area * d * d;
+      }
+    }
+
+    Quadric operator+ (const Quadric& other) const
+    {
+      Quadric q;
+      q.a = this->a + other.a;
+      q.b = this->b + other.b;
+      q.c = this->c + other.c;
+      return q;
+    }
+
+    double error (const glm::vec3& p) const
+    {
+      const glm::dvec3 q (p);
+      return glm::dot (q, this->a * q) + (2.0 * glm::dot (this->b, q)) + this->c;
+    }
+
+    /* Returns the position of minimal error, unless it is not unique or lies far away from the
+     * given edge.  Then the best of the edge's end points and midpoint is returned.
+     */
+    glm::vec3 minimum (const glm::vec3& p1, const glm::vec3& p2) const
+    {
+      const glm::vec3 midpoint = Util::midpoint (p1, p2);
+      const double    trace = this->a[0][0] + this->a[1][1] + this->a[2][2];
+
+      if (glm::abs (glm::determinant (this->a)) > minRelativeDeterminant * trace * trace * trace)
+      {
+        const glm::vec3 p = glm::vec3 (-(glm::inverse (this->a) * this->b));
+
+        if (glm::distance2 (p, midpoint) <= glm::distance2 (p1, p2))
+        {
+          return p;
+        }
+      }
+      const double e1 = this->error (p1);
+      const double e2 = this->error (p2);
+      const double e3 = this->error (midpoint);
+
+      return e3 <= e1 && e3 <= e2 ? midpoint : (e1 <= e2 ? p1 : p2);
+    }
+  };
+
+  struct DecimationCandidate
+  {
+    double       error;
+    unsigned int i1;
+    unsigned int i2;
+    glm::vec3    position;
+  };
+
+  /* Whether two vertices do not span an edge, or collapsing it to a position flips a face that
+   * remains.
+   */
+  bool isInvalidCollapse (const DynamicMesh& mesh, unsigned int i1, unsigned int i2,
+                          const glm::vec3& position)
+  {
+    bool isEdge = false;
+
+    for (unsigned int i : {i1, i2})
+    {
+      for (unsigned int a : mesh.adjacentFaces (i))
+      {
+        unsigned int a1, a2, a3;
+        mesh.vertexIndices (a, a1, a2, a3);
+
+        const unsigned int numShared = (a1 == i1 || a1 == i2 ? 1 : 0) +
+                                       (a2 == i1 || a2 == i2 ? 1 : 0) +
+                                       (a3 == i1 || a3 == i2 ? 1 : 0);
+        if (numShared == 2)
+        {
+          isEdge = true;
+        }
+        else
+        {
+          const glm::vec3& v1 = a1 == i ? position : mesh.vertex (a1);
+          const glm::vec3& v2 = a2 == i ? position : mesh.vertex (a2);
+          const glm::vec3& v3 = a3 == i ? position : mesh.vertex (a3);
+
+          if (glm::dot (mesh.face (a).cross (), glm::cross (v2 - v1, v3 - v1)) <= 0.0f)
+          {
+            return true;
+          }
+        }
+      }
+    }
+    return isEdge == false;
+  }
+
+  /* Locks the neighborhood of an edge, i.e., the vertices of its adjacent faces, or returns false
+   * if it overlaps with a locked one.
+   */
+  bool lockNeighborhood (const DynamicMesh& mesh, unsigned int i1, unsigned int i2, bool lock,
+                         std::vector<bool>& isLocked)
+  {
+    for (unsigned int i : {i1, i2})
+    {
+      for (unsigned int a : mesh.adjacentFaces (i))
+      {
+        unsigned int a1, a2, a3;
+        mesh.vertexIndices (a, a1, a2, a3);
+
+        if (lock)
+        {
+          isLocked[a1] = true;
+          isLocked[a2] = true;
+          isLocked[a3] = true;
+        }
+        else if (isLocked[a1] || isLocked[a2] || isLocked[a3])
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /* Collapses edges of the domain by increasing quadric error until the domain consists of at
+   * most the given number of faces.  Each batch evaluates all edges in parallel and selects the
+   * cheapest ones whose neighborhoods, i.e., the vertices of their adjacent faces, do not overlap.
+   * Thus collapses of a batch do not affect each other's evaluation.  They are applied serially,
+   * since they change the topology of the mesh.
+   */
+  void decimate (DynamicMesh& mesh, DynamicFaces& faces, unsigned int numFaces,
+                 ToolSculptArena& arena)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction: decimate");
+
+    assert (faces.hasUncomitted () == false);
+
+    std::vector<Quadric>             quadrics (mesh.vertexCapacity ());
+    std::vector<DecimationCandidate> candidates;
+    std::vector<bool>                isLocked;
+
+    arena.unmarkVertices ();
+    {
+      const std::vector<unsigned int> vertices = mesh.vertices (faces);
+
+      for (unsigned int i : vertices)
+      {
+        arena.markVertex (i);
+      }
+      Parallel::forEach (vertices.size (), [&mesh, &quadrics, &vertices](unsigned int j) {
+        const unsigned int i = vertices[j];
+
+        for (unsigned int a : mesh.adjacentFaces (i))
+        {
+          quadrics[i] = quadrics[i] + Quadric (mesh.face (a));
+        }
+      });
+    }
+
+    const auto evaluate = [&mesh, &quadrics](unsigned int i1, unsigned int i2,
+                                             DecimationCandidate& c) {
+      const Quadric q = quadrics[i1] + quadrics[i2];
+
+      c.i1 = i1;
+      c.i2 = i2;
+      c.position = q.minimum (mesh.vertex (i1), mesh.vertex (i2));
+      c.error = isInvalidCollapse (mesh, i1, i2, c.position) ? Util::maxFloat ()
+                                                               : q.error (c.position);
+    };
+
+    while (faces.numElements () > numFaces)
+    {
+      const std::vector<unsigned int>& indices = faces.indices ();
+
+      // each edge between vertices of the domain is evaluated by the face that orients it from its
+      // lower to its higher index
+      candidates.resize (3 * indices.size ());
+      Parallel::forEach (indices.size (), [&mesh, &arena, &indices, &candidates,
+                                           &evaluate](unsigned int j) {
+        unsigned int i[3];
+        mesh.vertexIndices (indices[j], i[0], i[1], i[2]);
+
+        for (unsigned int k = 0; k < 3; k++)
+        {
+          const unsigned int i1 = i[k];
+          const unsigned int i2 = i[(k + 1) % 3];
+          DecimationCandidate& c = candidates[(3 * j) + k];
+
+          if (i1 < i2 && arena.isMarkedVertex (i1) && arena.isMarkedVertex (i2))
+          {
+            evaluate (i1, i2, c);
+          }
+          else
+          {
+            c.error = Util::maxFloat ();
+          }
+        }
+      });
+      candidates.erase (std::remove_if (candidates.begin (), candidates.end (),
+                                        [](const DecimationCandidate& c) {
+                                          return c.error >= Util::maxFloat ();
+                                        }),
+                        candidates.end ());
+      std::sort (candidates.begin (), candidates.end (),
+                 [](const DecimationCandidate& c1, const DecimationCandidate& c2) {
+                   return c1.error < c2.error;
+                 });
+
+      // a collapse removes two faces
+      const unsigned int maxNumCollapses = (faces.numElements () - numFaces + 1) / 2;
+      unsigned int       numCollapses = 0;
+
+      isLocked.assign (mesh.vertexCapacity (), false);
+      for (const DecimationCandidate& c : candidates)
+      {
+        if (numCollapses >= maxNumCollapses)
+        {
+          break;
+        }
+        else if (lockNeighborhood (mesh, c.i1, c.i2, false, isLocked))
+        {
+          lockNeighborhood (mesh, c.i1, c.i2, true, isLocked);
+          candidates[numCollapses++] = c;
+        }
+      }
+
+      bool collapsed = false;
+      for (unsigned int j = 0; j < numCollapses; j++)
+      {
+        const DecimationCandidate& c = candidates[j];
+
+        // collapses may clean up beyond their neighborhoods
+        if (mesh.isFreeVertex (c.i1) || mesh.isFreeVertex (c.i2) ||
+            isInvalidCollapse (mesh, c.i1, c.i2, c.position))
+        {
+          continue;
+        }
+        const Quadric      q = quadrics[c.i1] + quadrics[c.i2];
+        const unsigned int v = collapseEdge (mesh, c.i1, c.i2, c.position, faces, arena);
+
+        if (v != Util::invalidIndex ())
+        {
+          if (v >= quadrics.size ())
+          {
+            quadrics.resize (mesh.vertexCapacity ());
+          }
+          quadrics[v] = q;
+          arena.markVertex (v);
+          collapsed = true;
+
+          for (unsigned int a : mesh.adjacentFaces (v))
+          {
+            faces.insert (a);
+          }
+        }
+      }
+
+      faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+      faces.commit ();
+
+      if (collapsed == false)
+      {
+        break;
+      }
+    }
+  }
+
+  /* Collapses edges of the domain that are shorter than the minimum length to their midpoints, from
+   * the shortest to the longest, unless a collapse would create an edge that is longer than the
+   * maximum length.  Like `decimate`, each batch evaluates all edges in parallel and applies the
+   * collapses of edges whose neighborhoods do not overlap.
+   */
+  bool collapseShortEdges (DynamicMesh& mesh, DynamicFaces& faces, float minLength,
+                           float maxLength, ToolSculptArena& arena)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction: collapse short edges");
+
+    assert (faces.hasUncomitted () == false);
+
+    std::vector<CollapseCandidate>& candidates = arena.collapseCandidates ();
+    std::vector<bool>               isLocked;
+
+    // frozen vertices are not marked, so that their edges are not collapsed
+    arena.unmarkVertices ();
+    mesh.forEachVertex (faces, [&mesh, &arena](unsigned int i) {
+      if (mesh.isFrozen (i) == false)
+      {
+        arena.markVertex (i);
+      }
+    });
+
+    const auto isCollapsable = [&mesh, minLength, maxLength](unsigned int i1, unsigned int i2) {
+      if (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) >= minLength * minLength)
+      {
+        return false;
+      }
+      const glm::vec3 position = Util::midpoint (mesh.vertex (i1), mesh.vertex (i2));
+
+      if (isInvalidCollapse (mesh, i1, i2, position))
+      {
+        return false;
+      }
+      for (unsigned int i : {i1, i2})
+      {
+        for (unsigned int a : mesh.adjacentFaces (i))
+        {
+          unsigned int a1, a2, a3;
+          mesh.vertexIndices (a, a1, a2, a3);
+
+          for (unsigned int j : {a1, a2, a3})
+          {
+            if (glm::distance2 (position, mesh.vertex (j)) > maxLength * maxLength)
+            {
+              return false;
+            }
+          }
+        }
+      }
+      return true;
+    };
+
+    bool collapsedAny = false;
+    while (true)
+    {
+      const std::vector<unsigned int>& indices = faces.indices ();
+
+      candidates.resize (3 * indices.size ());
+      Parallel::forEach (indices.size (), [&mesh, &arena, &indices, &candidates,
+                                           &isCollapsable](unsigned int j) {
+        unsigned int i[3];
+        mesh.vertexIndices (indices[j], i[0], i[1], i[2]);
+
+        for (unsigned int k = 0; k < 3; k++)
+        {
+          const unsigned int i1 = i[k];
+          const unsigned int i2 = i[(k + 1) % 3];
+          CollapseCandidate& c = candidates[(3 * j) + k];
+
+          if (i1 < i2 && arena.isMarkedVertex (i1) && arena.isMarkedVertex (i2) &&
+              isCollapsable (i1, i2))
+          {
+            c = {glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)), i1, i2};
+          }
+          else
+          {
+            c.lengthSqr = Util::maxFloat ();
+          }
+        }
+      });
+      candidates.erase (std::remove_if (candidates.begin (), candidates.end (),
+                                        [](const CollapseCandidate& c) {
+                                          return c.lengthSqr >= Util::maxFloat ();
+                                        }),
+                        candidates.end ());
+      std::sort (candidates.begin (), candidates.end (),
+                 [](const CollapseCandidate& c1, const CollapseCandidate& c2) {
+                   return c1.lengthSqr < c2.lengthSqr;
+                 });
+
+      unsigned int numCollapses = 0;
+
+      isLocked.assign (mesh.vertexCapacity (), false);
+      for (const CollapseCandidate& c : candidates)
+      {
+        if (lockNeighborhood (mesh, c.i1, c.i2, false, isLocked))
+        {
+          lockNeighborhood (mesh, c.i1, c.i2, true, isLocked);
+          candidates[numCollapses++] = c;
+        }
+      }
+
+      bool collapsed = false;
+      for (unsigned int j = 0; j < numCollapses; j++)
+      {
+        const CollapseCandidate& c = candidates[j];
+
+        // collapses may clean up beyond their neighborhoods
+        if (mesh.isFreeVertex (c.i1) || mesh.isFreeVertex (c.i2) ||
+            isInvalidCollapse (mesh, c.i1, c.i2,
+                               Util::midpoint (mesh.vertex (c.i1), mesh.vertex (c.i2))))
+        {
+          continue;
+        }
+        const unsigned int v = collapseEdge (mesh, c.i1, c.i2, faces, arena);
+
+        if (v != Util::invalidIndex ())
+        {
+          arena.markVertex (v);
+          collapsed = true;
+
+          for (unsigned int a : mesh.adjacentFaces (v))
+          {
+            faces.insert (a);
+          }
+        }
+      }
+
+      faces.filter ([&mesh](unsigned int f) { return mesh.isFreeFace (f) == false; });
+      faces.commit ();
+
+      if (collapsed == false)
+      {
+        break;
+      }
+      collapsedAny = true;
+    }
+    return collapsedAny;
+  }
+
+  void finalize (DynamicMesh& mesh, const DynamicFaces& faces)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction: finalize");
+
+    mesh.deferNormals (faces);
+    mesh.deferRealignment (faces);
+  }
+
+  float maxSubdivisionEdgeLength (const SculptBrush& brush)
+  {
+    return glm::max (brush.subdivThreshold (), 2.0f * minEdgeLength);
+  }
+
+  void subdivide (const SculptBrush& brush, const SculptDomain& domain, DynamicFaces& faces,
+                  ToolSculptArena& arena)
+  {
+    DynamicMesh&       mesh = brush.mesh ();
+    ToolSculptEdgeMap& newEdges = arena.newEdges ();
+    do
+    {
+      newEdges.reset ();
+
+      extendAndFilterDomain (mesh, domain, faces, 1, arena);
+      extendDomainByPoles (mesh, faces, arena);
+      splitEdges (mesh, newEdges, maxSubdivisionEdgeLength (brush), faces, arena);
+
+      if (newEdges.isEmpty () == false)
+      {
+        triangulate (mesh, newEdges, faces, arena);
+      }
+      extendDomain (mesh, faces, 1, arena);
+      relaxEdges (mesh, faces, arena);
+      smooth (mesh, faces, arena);
+      finalize (mesh, faces);
+    } while (faces.numElements () > 0 && newEdges.isEmpty () == false);
+  }
+
+  /* Splits edges until no edge of the brush's domain is too long and relaxes and smoothes the
+   * refined region once afterwards.  Each round of splits halves the remaining edges, so an
+   * edge whose length exceeds the maximum by a factor of 2^n is refined in n rounds, which only
+   * change the topology.
+   */
+  void subdivideBatched (DynamicMesh& mesh, float maxEdgeLength, const SculptDomain& domain,
+                         DynamicFaces& faces, ToolSculptArena& arena)
+  {
+    ToolSculptEdgeMap& newEdges = arena.newEdges ();
+    bool               wasSplit = false;
+    do
     {
-      mesh.realignFace (i);
+      newEdges.reset ();
+
+      extendAndFilterDomain (mesh, domain, faces, 1, arena);
+      extendDomainByPoles (mesh, faces, arena);
+      splitEdges (mesh, newEdges, maxEdgeLength, faces, arena);
+
+      if (newEdges.isEmpty () == false)
+      {
+        triangulate (mesh, newEdges, faces, arena);
+        wasSplit = true;
+      }
+    } while (faces.numElements () > 0 && newEdges.isEmpty () == false);
+
+    if (wasSplit)
+    {
+      faces = domain.affectedFaces ();
+      extendDomain (mesh, faces, 1, arena);
+      relaxEdges (mesh, faces, arena);
+      smooth (mesh, faces, arena);
+      finalize (mesh, faces);
+    }
+  }
+
+  void refine (const SculptBrush& brush, const SculptDomain& domain, DynamicFaces& faces,
+               ToolSculptArena& arena)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction: refine");
+
+    if (brush.subdivide () && brush.batchSubdivision ())
+    {
+      subdivideBatched (brush.mesh (), maxSubdivisionEdgeLength (brush), domain, faces, arena);
+    }
+    else if (brush.subdivide ())
+    {
+      subdivide (brush, domain, faces, arena);
     }
   }
 }
 
 namespace ToolSculptAction
 {
-  void sculpt (const SculptBrush& brush)
+  void sculpt (const SculptBrush& brush, ToolSculptArena& arena)
   {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::sculpt");
+
     DynamicFaces faces = brush.getAffectedFaces ();
 
     if (faces.numElements () > 0)
@@ -765,7 +1579,7 @@ namespace ToolSculptAction
       {
         const float maxEdgeLengthSqr =
           mesh.averageEdgeLengthSqr (faces) * brush.parameters ().intensity ();
-        collapseEdgesByLength (mesh, maxEdgeLengthSqr, faces);
+        collapseEdgesByLength (mesh, maxEdgeLengthSqr, faces, arena);
 
         if (mesh.isEmpty ())
         {
@@ -774,61 +1588,310 @@ namespace ToolSculptAction
         }
         else
         {
-          extendDomain (mesh, faces, 1);
-          smooth (mesh, faces);
+          extendDomain (mesh, faces, 1, arena);
+          smooth (mesh, faces, arena);
           finalize (mesh, faces);
         }
         assert (mesh.pruneAndCheckConsistency ());
       }
       else
       {
-        if (brush.subdivide ())
-        {
-          ToolSculptEdgeMap newEdges;
-          do
-          {
-            newEdges.reset ();
-
-            extendAndFilterDomain (brush, faces, 1);
-            extendDomainByPoles (mesh, faces);
-
-            const float maxLength = glm::max (brush.subdivThreshold (), 2.0f * minEdgeLength);
-            splitEdges (mesh, newEdges, maxLength, faces);
-
-            if (newEdges.isEmpty () == false)
-            {
-              triangulate (mesh, newEdges, faces);
-            }
-            extendDomain (mesh, faces, 1);
-            relaxEdges (mesh, faces);
-            smooth (mesh, faces);
-            finalize (mesh, faces);
-          } while (faces.numElements () > 0 && newEdges.isEmpty () == false);
-        }
+        refine (brush, SculptDomain (brush), faces, arena);
         faces = brush.getAffectedFaces ();
-        brush.sculpt (faces);
-        collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces);
+        brush.sculpt (faces, arena);
+        collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces, arena);
         finalize (mesh, faces);
       }
     }
   }
 
+  /* Subdivides the union of the brush's and the mirrored brush's domains, displaces both of them,
+   * and collapses and finalizes the union once.  Reducing brushes are applied one after another.
+   */
+  void sculpt (SculptBrush& brush, const PrimPlane& mirror, ToolSculptArena& arena)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::sculpt (mirrored)");
+
+    if (brush.parameters ().reduce ())
+    {
+      sculpt (brush, arena);
+      if (brush.mesh ().isEmpty () == false)
+      {
+        brush.mirror (mirror);
+        sculpt (brush, arena);
+        brush.mirror (mirror);
+      }
+      return;
+    }
+
+    const SculptDomain domain (brush, mirror);
+    DynamicFaces       faces = domain.affectedFaces ();
+
+    if (faces.numElements () > 0)
+    {
+      DynamicMesh& mesh = brush.mesh ();
+
+      refine (brush, domain, faces, arena);
+
+      brush.sculpt (brush.getAffectedFaces (), arena);
+      brush.mirror (mirror);
+      brush.sculpt (brush.getAffectedFaces (), arena);
+      brush.mirror (mirror);
+
+      faces = domain.affectedFaces ();
+      collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces, arena);
+      finalize (mesh, faces);
+    }
+  }
+
+  // smoothes all vertices without collecting faces, and recomputes normals and the octree once
   void smoothMesh (DynamicMesh& mesh)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::smoothMesh");
+
+    std::vector<unsigned int> vertices;
+    vertices.reserve (mesh.numVertices ());
+
+    mesh.forEachVertex ([&mesh, &vertices](unsigned int i) {
+      if (mesh.valence (i) > 0)
+      {
+        vertices.push_back (i);
+      }
+    });
+
+    ToolSculptArena arena;
+
+    relaxEdges (mesh, vertices, arena);
+    smooth (mesh, vertices, arena);
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    mesh.bufferData ();
+  }
+
+  void smoothMesh (DynamicMesh& mesh, const PrimSphere& sphere)
   {
     DynamicFaces faces;
 
+    if (mesh.intersects (sphere, faces))
+    {
+      smoothMesh (mesh, faces);
+    }
+  }
+
+  void smoothMesh (DynamicMesh& mesh, DynamicFaces& faces)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::smoothMesh (faces)");
+
+    assert (faces.hasUncomitted () == false);
+
+    ToolSculptArena arena;
+
+    relaxEdges (mesh, faces, arena);
+    smooth (mesh, faces, arena);
+    finalize (mesh, faces);
+    mesh.bufferData ();
+  }
+
+  /* Collapses edges in flat regions, i.e., where all faces adjacent to an edge's vertices deviate
+   * by at most `maxFlatAngle` from their average normal.  Edges do not grow longer than a multiple
+   * of the given resolution, hence curved regions keep their detail.
+   */
+  void coarsenFlatRegions (DynamicMesh& mesh, float resolution)
+  {
+    const float minCos = glm::cos (maxFlatAngle);
+    const float maxEdgeLength = maxCoarseEdgeLengthFactor * resolution;
+
+    const auto isFlat = [&mesh, minCos](unsigned int i, const glm::vec3& normal) {
+      for (unsigned int a : mesh.adjacentFaces (i))
+      {
+        if ((glm::dot (mesh.faceNormal (a), normal) >= minCos) == false)
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    const auto isCollapsable = [&mesh, &isFlat, maxEdgeLength](unsigned int i1, unsigned int i2) {
+      if (glm::distance2 (mesh.vertex (i1), mesh.vertex (i2)) >= maxEdgeLength * maxEdgeLength)
+      {
+        return false;
+      }
+      const glm::vec3 normal = glm::normalize (mesh.averageNormal (i1) + mesh.averageNormal (i2));
+      return isFlat (i1, normal) && isFlat (i2, normal);
+    };
+
+    // the domain of `collapseEdge` is not needed
+    DynamicFaces    unusedDomain;
+    ToolSculptArena arena;
+    bool            collapsed;
+    do
+    {
+      collapsed = false;
+      mesh.forEachFace ([&mesh, &isCollapsable, &collapsed, &unusedDomain,
+                         &arena](unsigned int f) {
+        if (mesh.isFreeFace (f) == false)
+        {
+          unsigned int i1, i2, i3;
+          mesh.vertexIndices (f, i1, i2, i3);
+
+          if (isCollapsable (i1, i2))
+          {
+            collapsed = collapseEdge (mesh, i1, i2, unusedDomain, arena) != Util::invalidIndex () ||
+                        collapsed;
+          }
+          else if (isCollapsable (i1, i3))
+          {
+            collapsed = collapseEdge (mesh, i1, i3, unusedDomain, arena) != Util::invalidIndex () ||
+                        collapsed;
+          }
+          else if (isCollapsable (i2, i3))
+          {
+            collapsed = collapseEdge (mesh, i2, i3, unusedDomain, arena) != Util::invalidIndex () ||
+                        collapsed;
+          }
+        }
+      });
+    } while (collapsed);
+
+    DynamicFaces faces;
     mesh.forEachFace ([&faces](unsigned int i) { faces.insert (i); });
     faces.commit ();
-    relaxEdges (mesh, faces);
-    smooth (mesh, faces);
+    relaxEdges (mesh, faces, arena);
+
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    mesh.bufferData ();
+  }
+
+  bool decimateMesh (DynamicMesh& mesh, unsigned int numFaces)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::decimateMesh");
+
+    DynamicFaces    faces;
+    ToolSculptArena arena;
+
+    mesh.forEachFace ([&mesh, &faces](unsigned int f) {
+      if (mesh.isFreeFace (f) == false)
+      {
+        faces.insert (f);
+      }
+    });
+    faces.commit ();
+
+    const unsigned int numOriginalFaces = faces.numElements ();
+
+    decimate (mesh, faces, numFaces, arena);
+
+    if (faces.numElements () == numOriginalFaces)
+    {
+      return false;
+    }
+    mesh.setAllNormals ();
+    mesh.realignAllFaces ();
+    mesh.bufferData ();
+    return true;
+  }
+
+  bool decimateMesh (DynamicMesh& mesh, const PrimSphere& sphere, float ratio)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::decimateMesh (sphere)");
+
+    DynamicFaces    faces;
+    ToolSculptArena arena;
+
+    if (mesh.intersects (sphere, faces) == false)
+    {
+      return false;
+    }
+    const unsigned int numOriginalFaces = faces.numElements ();
+
+    decimate (mesh, faces, (unsigned int) (ratio * float(numOriginalFaces)), arena);
+
+    if (faces.numElements () == numOriginalFaces)
+    {
+      return false;
+    }
     finalize (mesh, faces);
     mesh.bufferData ();
+    return true;
+  }
+
+  void refineRegion (DynamicMesh& mesh, const std::vector<PrimSphere>& spheres,
+                     float maxEdgeLength)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::refineRegion");
+
+    const SculptDomain domain (mesh, spheres);
+    DynamicFaces       faces = domain.affectedFaces ();
+    ToolSculptArena    arena;
+
+    if (faces.numElements () > 0)
+    {
+      subdivideBatched (mesh, glm::max (maxEdgeLength, 2.0f * minEdgeLength), domain, faces,
+                        arena);
+      mesh.bufferData ();
+    }
+  }
+
+  /* Splits long edges in rounds that are planned in parallel (cf. `splitEdges`) and collapses
+   * short edges in parallel batches afterwards.  Relaxing and smoothing the whole mesh evens out
+   * the new edges and moves vertices only tangentially.
+   */
+  bool floodDetail (DynamicMesh& mesh, float edgeLength)
+  {
+    DILAY_PROFILE_ZONE ("ToolSculptAction::floodDetail");
+
+    const float        length = glm::max (edgeLength, 2.0f * minEdgeLength);
+    DynamicFaces       faces;
+    ToolSculptArena    arena;
+    ToolSculptEdgeMap& newEdges = arena.newEdges ();
+
+    const auto collectFaces = [&mesh, &faces]() {
+      faces.reset ();
+      mesh.forEachFace ([&mesh, &faces](unsigned int f) {
+        if (mesh.isFreeFace (f) == false)
+        {
+          faces.insert (f);
+        }
+      });
+      faces.commit ();
+    };
+
+    bool changed = false;
+
+    collectFaces ();
+    do
+    {
+      newEdges.reset ();
+      splitEdges (mesh, newEdges, maxFloodEdgeLengthFactor * length, faces, arena);
+
+      if (newEdges.isEmpty () == false)
+      {
+        triangulate (mesh, newEdges, faces, arena);
+        changed = true;
+      }
+    } while (faces.numElements () > 0 && newEdges.isEmpty () == false);
+
+    collectFaces ();
+    changed = collapseShortEdges (mesh, faces, minFloodEdgeLengthFactor * length,
+                                  maxFloodEdgeLengthFactor * length, arena) ||
+              changed;
+
+    if (changed)
+    {
+      smoothMesh (mesh);
+    }
+    return changed;
   }
 
   bool deleteFaces (DynamicMesh& mesh, DynamicFaces& faces)
   {
-    bool collapsed = collapseAllEdges (mesh, faces);
-    collapsed = collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces) || collapsed;
+    ToolSculptArena arena;
+    bool            collapsed = collapseAllEdges (mesh, faces, arena);
+
+    collapsed =
+      collapseEdgesByLength (mesh, minEdgeLength * minEdgeLength, faces, arena) || collapsed;
     finalize (mesh, faces);
     mesh.bufferData ();
     return collapsed;
@@ -5,13 +5,35 @@
 #ifndef DILAY_TOOL_SCULPT_ACTION
 #define DILAY_TOOL_SCULPT_ACTION
 
+#include <vector>
+
+class DynamicFaces;
 class DynamicMesh;
+class PrimPlane;
+class PrimSphere;
 class SculptBrush;
+class ToolSculptArena;
 
 namespace ToolSculptAction
 {
-  void sculpt (const SculptBrush&);
+  void sculpt (const SculptBrush&, ToolSculptArena&);
+  // sculpts a brush and its mirrored counterpart in a single pass
+  void sculpt (SculptBrush&, const PrimPlane&, ToolSculptArena&);
   void smoothMesh (DynamicMesh&);
+  // smoothes the faces within a sphere
+  void smoothMesh (DynamicMesh&, const PrimSphere&);
+  void smoothMesh (DynamicMesh&, DynamicFaces&);
+  void coarsenFlatRegions (DynamicMesh&, float);
+  // collapses edges by quadric error until the mesh consists of at most the given number of faces
+  bool decimateMesh (DynamicMesh&, unsigned int);
+  // collapses edges within a sphere until the given ratio of its faces remains
+  bool decimateMesh (DynamicMesh&, const PrimSphere&, float);
+  // subdivides the faces within spheres until no edge is longer than the given length
+  void refineRegion (DynamicMesh&, const std::vector<PrimSphere>&, float);
+  /* Splits and collapses edges of the whole mesh towards the given length.  Returns false if the
+   * mesh has not been changed.
+   */
+  bool floodDetail (DynamicMesh&, float);
   bool deleteFaces (DynamicMesh&, DynamicFaces&);
 };
 
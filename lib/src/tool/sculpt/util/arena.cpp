@@ -0,0 +1,84 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include "dynamic/mesh.hpp"
+#include "tool/sculpt/util/arena.hpp"
+
+ToolSculptArena::Marks::Marks ()
+  : _epoch (0)
+{
+}
+
+void ToolSculptArena::Marks::clear ()
+{
+  this->_epoch++;
+
+  if (this->_epoch == 0)
+  {
+    std::fill (this->_marks.begin (), this->_marks.end (), 0);
+    this->_epoch = 1;
+  }
+}
+
+void ToolSculptArena::Marks::mark (unsigned int i)
+{
+  assert (this->_epoch > 0);
+
+  if (i >= this->_marks.size ())
+  {
+    this->_marks.resize (i + 1, 0);
+  }
+  this->_marks[i] = this->_epoch;
+}
+
+bool ToolSculptArena::Marks::isMarked (unsigned int i) const
+{
+  return i < this->_marks.size () && this->_marks[i] == this->_epoch;
+}
+
+ToolSculptArena::ToolSculptArena () {}
+
+void ToolSculptArena::unmarkVertices () { this->_vertexMarks.clear (); }
+
+void ToolSculptArena::markVertex (unsigned int i) { this->_vertexMarks.mark (i); }
+
+bool ToolSculptArena::isMarkedVertex (unsigned int i) const
+{
+  return this->_vertexMarks.isMarked (i);
+}
+
+glm::vec3 ToolSculptArena::basePosition (const DynamicMesh& mesh, unsigned int i) const
+{
+  const auto it = this->_basePositions.find (i);
+  return it == this->_basePositions.end () ? mesh.vertex (i) : it->second;
+}
+
+void ToolSculptArena::recordBasePosition (const DynamicMesh& mesh, unsigned int i)
+{
+  this->_basePositions.emplace (i, mesh.vertex (i));
+}
+
+// indices of deleted vertices are reused, so the base position of a new vertex is always replaced
+void ToolSculptArena::inheritBasePosition (const DynamicMesh& mesh, unsigned int i1,
+                                           unsigned int i2, unsigned int newI)
+{
+  const auto it1 = this->_basePositions.find (i1);
+  const auto it2 = this->_basePositions.find (i2);
+
+  if (it1 == this->_basePositions.end () && it2 == this->_basePositions.end ())
+  {
+    this->_basePositions.erase (newI);
+  }
+  else
+  {
+    const glm::vec3 d1 = mesh.vertex (i1) - this->basePosition (mesh, i1);
+    const glm::vec3 d2 = mesh.vertex (i2) - this->basePosition (mesh, i2);
+
+    this->_basePositions[newI] = mesh.vertex (newI) - (0.5f * (d1 + d2));
+  }
+}
+
+void ToolSculptArena::reset () { *this = ToolSculptArena (); }
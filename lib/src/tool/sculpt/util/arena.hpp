@@ -0,0 +1,113 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_ARENA
+#define DILAY_TOOL_SCULPT_ARENA
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include "dynamic/faces.hpp"
+#include "tool/sculpt/util/edge-collection.hpp"
+
+class DynamicMesh;
+
+/* Temporaries of the sculpting steps of a stroke.  Steps clear the buffers they use, which keeps
+ * their memory, so the steps of a stroke stop allocating once the buffers have grown.  Resetting
+ * an arena releases its memory and is done when a stroke ends.
+ */
+class ToolSculptArena
+{
+public:
+  struct CollapseCandidate
+  {
+    float        lengthSqr;
+    unsigned int i1;
+    unsigned int i2;
+
+    bool operator> (const CollapseCandidate& other) const
+    {
+      return this->lengthSqr > other.lengthSqr;
+    }
+  };
+
+  // the planned splits of the edges (i1, i2), (i1, i3) and (i2, i3) of a face
+  struct EdgeSplit
+  {
+    bool      isSplit[3];
+    glm::vec3 positions[3];
+    glm::vec3 normals[3];
+  };
+
+  // the planned faces that replace a face, which is kept if there are none
+  struct FaceSplit
+  {
+    unsigned int face;
+    unsigned int numFaces;
+    unsigned int indices[12];
+  };
+
+  /* A set of marked indices.  Indices are marked with the current epoch, so starting a new,
+   * empty set does not need to touch them.
+   */
+  class Marks
+  {
+  public:
+    Marks ();
+
+    void clear ();
+    void mark (unsigned int);
+    bool isMarked (unsigned int) const;
+
+  private:
+    std::vector<unsigned int> _marks;
+    unsigned int              _epoch;
+  };
+
+  ToolSculptArena ();
+
+  ToolSculptEdgeMap&              newEdges () { return this->_newEdges; }
+  ToolSculptEdgeSet&              relaxableEdges () { return this->_relaxableEdges; }
+  std::vector<unsigned int>&      newFaceIndices () { return this->_newFaceIndices; }
+  DynamicFaces&                   deletedFaces () { return this->_deletedFaces; }
+  std::vector<glm::vec3>&         positions () { return this->_positions; }
+  std::vector<CollapseCandidate>& collapseCandidates () { return this->_collapseCandidates; }
+  Marks&                          faceMarks () { return this->_faceMarks; }
+  std::vector<unsigned int>&      frontier () { return this->_frontier; }
+  std::vector<unsigned int>&      nextFrontier () { return this->_nextFrontier; }
+  std::vector<EdgeSplit>&         edgeSplits () { return this->_edgeSplits; }
+  std::vector<FaceSplit>&         faceSplits () { return this->_faceSplits; }
+
+  // starts a new set of marked vertices, which is empty
+  void unmarkVertices ();
+  void markVertex (unsigned int);
+  bool isMarkedVertex (unsigned int) const;
+
+  /* Base positions are the positions of vertices before the stroke first displaced them.  Vertices
+   * without a recorded base position have not been displaced yet.  A vertex that is added between
+   * two vertices inherits their displacement, so that a refined region keeps its base surface.
+   */
+  glm::vec3 basePosition (const DynamicMesh&, unsigned int) const;
+  void      recordBasePosition (const DynamicMesh&, unsigned int);
+  void      inheritBasePosition (const DynamicMesh&, unsigned int, unsigned int, unsigned int);
+
+  void reset ();
+
+private:
+  ToolSculptEdgeMap                           _newEdges;
+  ToolSculptEdgeSet                           _relaxableEdges;
+  std::vector<unsigned int>                   _newFaceIndices;
+  DynamicFaces                                _deletedFaces;
+  std::vector<glm::vec3>                      _positions;
+  std::vector<CollapseCandidate>              _collapseCandidates;
+  Marks                                       _vertexMarks;
+  Marks                                       _faceMarks;
+  std::vector<unsigned int>                   _frontier;
+  std::vector<unsigned int>                   _nextFrontier;
+  std::vector<EdgeSplit>                      _edgeSplits;
+  std::vector<FaceSplit>                      _faceSplits;
+  std::unordered_map<unsigned int, glm::vec3> _basePositions;
+};
+
+#endif
@@ -3,14 +3,177 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <memory>
+#include <vector>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/sphere.hpp"
-#include "primitive/triangle.hpp"
+#include "tool/sculpt/util/arena.hpp"
 #include "tool/sculpt/util/brush.hpp"
 #include "util.hpp"
 
+namespace
+{
+  static const unsigned int displacementGrainSize = 1 << 10;
+
+  /* The vertices of the faces affected by a sculpting step.  Their positions are stored as
+   * separate coordinate arrays, so the kernels below process contiguous ranges of them without
+   * indirection.  Ranges are processed in parallel.
+   */
+  struct BrushVertices
+  {
+    std::vector<unsigned int> indices;
+    std::vector<float>        x;
+    std::vector<float>        y;
+    std::vector<float>        z;
+
+    BrushVertices (DynamicMesh& mesh, const DynamicFaces& faces)
+      : indices (mesh.vertices (faces))
+      , x (indices.size ())
+      , y (indices.size ())
+      , z (indices.size ())
+    {
+      for (unsigned int i = 0; i < this->indices.size (); i++)
+      {
+        const glm::vec3& p = mesh.vertex (this->indices[i]);
+
+        this->x[i] = p.x;
+        this->y[i] = p.y;
+        this->z[i] = p.z;
+      }
+    }
+
+    unsigned int size () const { return this->indices.size (); }
+
+    glm::vec3 position (unsigned int i) const
+    {
+      return glm::vec3 (this->x[i], this->y[i], this->z[i]);
+    }
+
+    /* Calls `f (i, x, y, z)` for each vertex, which may modify its coordinates.  Kernels are
+     * inlined into the loop of each range, so that each brush is applied in a single pass.
+     */
+    template <typename F> void forEachVertex (const F& f)
+    {
+      Parallel::forRange (this->size (), displacementGrainSize,
+                          [this, &f](unsigned int begin, unsigned int end) {
+                            float* x = this->x.data ();
+                            float* y = this->y.data ();
+                            float* z = this->z.data ();
+
+                            for (unsigned int i = begin; i < end; i++)
+                            {
+                              f (i, x[i], y[i], z[i]);
+                            }
+                          });
+    }
+
+    // positions are written serially, because writing a vertex records the change
+    void write (DynamicMesh& mesh) const
+    {
+      for (unsigned int i = 0; i < this->indices.size (); i++)
+      {
+        const glm::vec3 p = this->position (i);
+
+        if (p != mesh.vertex (this->indices[i]))
+        {
+          mesh.vertex (this->indices[i], p);
+        }
+      }
+    }
+  };
+
+  // scale * Util::linearStep (position, center, innerRadius, radius)
+  struct LinearFalloff
+  {
+    glm::vec3 center;
+    float     radius;
+    float     invWidth;
+    float     scale;
+
+    float operator() (float x, float y, float z) const
+    {
+      const float dx = x - this->center.x;
+      const float dy = y - this->center.y;
+      const float dz = z - this->center.z;
+      const float d = glm::sqrt ((dx * dx) + (dy * dy) + (dz * dz));
+
+      return this->scale * glm::clamp ((this->radius - d) * this->invWidth, 0.0f, 1.0f);
+    }
+  };
+
+  // a linear falloff of zero width, i.e., scale inside the radius and 0 outside
+  struct StepFalloff
+  {
+    glm::vec3 center;
+    float     radiusSqr;
+    float     scale;
+
+    float operator() (float x, float y, float z) const
+    {
+      const float dx = x - this->center.x;
+      const float dy = y - this->center.y;
+      const float dz = z - this->center.z;
+
+      return (dx * dx) + (dy * dy) + (dz * dz) > this->radiusSqr ? 0.0f : this->scale;
+    }
+  };
+
+  // (1 - distance (position, center) / radius)^2 inside the radius and 0 outside
+  struct QuadraticFalloff
+  {
+    glm::vec3 center;
+    float     invRadius;
+
+    float operator() (float x, float y, float z) const
+    {
+      const float dx = this->center.x - x;
+      const float dy = this->center.y - y;
+      const float dz = this->center.z - z;
+      const float d = glm::sqrt ((dx * dx) + (dy * dy) + (dz * dz)) * this->invRadius;
+      const float invD = glm::max (0.0f, 1.0f - d);
+
+      return invD * invD;
+    }
+  };
+
+  // calls `f` with the falloff that fits the given radii, i.e., once per sculpting step
+  template <typename F>
+  void withLinearFalloff (const glm::vec3& center, float innerRadius, float radius, float scale,
+                          const F& f)
+  {
+    assert (innerRadius <= radius);
+
+    if (radius - innerRadius < Util::epsilon ())
+    {
+      f (StepFalloff{center, radius * radius, scale});
+    }
+    else
+    {
+      f (LinearFalloff{center, radius, 1.0f / (radius - innerRadius), scale});
+    }
+  }
+
+  // the signed distance of a position to a plane
+  struct PlaneDistance
+  {
+    glm::vec3 normal;
+    float     offset;
+
+    PlaneDistance (const PrimPlane& plane)
+      : normal (plane.normal ())
+      , offset (glm::dot (plane.normal (), plane.point ()))
+    {
+    }
+
+    float operator() (float x, float y, float z) const
+    {
+      return (this->normal.x * x) + (this->normal.y * y) + (this->normal.z * z) - this->offset;
+    }
+  };
+}
+
 SBFlattenParameters::SBFlattenParameters ()
   : _lockPlane (false)
 {
@@ -33,52 +196,101 @@ void SBFlattenParameters::mirror (const PrimPlane& m)
   }
 }
 
-void SBDrawParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBDrawParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                               ToolSculptArena& arena) const
 {
   if (faces.isEmpty () == false)
   {
     const float     intensity = 0.3f * this->intensity ();
-    const glm::vec3 planeNormal = this->invert (brush.normal ());
-    const glm::vec3 planePos = brush.position () + (planeNormal * intensity * brush.radius ());
-    const PrimPlane plane (planePos, planeNormal);
-
-    brush.mesh ().forEachVertex (faces, [&brush, &plane, intensity](unsigned int i) {
-      const glm::vec3& oldPos = brush.mesh ().vertex (i);
-      const float      factor = intensity * Util::linearStep (oldPos, brush.position (),
-                                                         0.5f * brush.radius (), brush.radius ());
-      const float      distance = glm::min (0.0f, plane.distance (oldPos));
-      const glm::vec3  newPos = oldPos - (plane.normal () * factor * distance);
-
-      brush.mesh ().vertex (i, newPos);
-    });
+    const glm::vec3 n = this->invert (brush.normal ());
+    BrushVertices   vertices (brush.mesh (), faces);
+
+    if (this->constantHeight ())
+    {
+      // vertices are raised up to a constant height above their positions before the stroke
+      std::vector<glm::vec3> bases (vertices.size ());
+      for (unsigned int i = 0; i < vertices.size (); i++)
+      {
+        arena.recordBasePosition (brush.mesh (), vertices.indices[i]);
+        bases[i] = arena.basePosition (brush.mesh (), vertices.indices[i]);
+      }
+      const float height = intensity * brush.radius ();
+      const auto  kernel = [&bases, &n, &vertices, height](const auto& falloff) {
+        vertices.forEachVertex ([&](unsigned int i, float& x, float& y, float& z) {
+          const float d =
+            (n.x * (x - bases[i].x)) + (n.y * (y - bases[i].y)) + (n.z * (z - bases[i].z));
+          const float f = falloff (x, y, z) * glm::max (0.0f, height - d);
+
+          x += f * n.x;
+          y += f * n.y;
+          z += f * n.z;
+        });
+      };
+      withLinearFalloff (brush.position (), 0.5f * brush.radius (), brush.radius (), intensity,
+                         kernel);
+    }
+    else
+    {
+      const PlaneDistance distance (
+        PrimPlane (brush.position () + (n * intensity * brush.radius ()), n));
+      const auto kernel = [&distance, &vertices](const auto& falloff) {
+        vertices.forEachVertex ([&](unsigned int, float& x, float& y, float& z) {
+          const float f = falloff (x, y, z) * glm::min (0.0f, distance (x, y, z));
+
+          x -= f * distance.normal.x;
+          y -= f * distance.normal.y;
+          z -= f * distance.normal.z;
+        });
+      };
+      withLinearFalloff (brush.position (), 0.5f * brush.radius (), brush.radius (), intensity,
+                         kernel);
+    }
+    vertices.write (brush.mesh ());
   }
 }
 
-void SBGrablikeParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBGrablikeParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                   ToolSculptArena&) const
 {
-  brush.mesh ().forEachVertex (faces, [&brush](unsigned int i) {
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const float factor = Util::linearStep (oldPos, brush.lastPosition (), 0.0f, brush.radius ());
-    const glm::vec3 newPos = oldPos + (factor * brush.delta ());
+  const glm::vec3 delta = brush.delta ();
+  BrushVertices   vertices (brush.mesh (), faces);
 
-    brush.mesh ().vertex (i, newPos);
-  });
+  const auto kernel = [&delta, &vertices](const auto& falloff) {
+    vertices.forEachVertex ([&](unsigned int, float& x, float& y, float& z) {
+      const float f = falloff (x, y, z);
+
+      x += f * delta.x;
+      y += f * delta.y;
+      z += f * delta.z;
+    });
+  };
+  withLinearFalloff (brush.lastPosition (), 0.0f, brush.radius (), 1.0f, kernel);
+  vertices.write (brush.mesh ());
 }
 
-void SBSmoothParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBSmoothParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                 ToolSculptArena&) const
 {
-  brush.mesh ().forEachVertex (faces, [this, &brush](unsigned int i) {
-    const glm::vec3  avgPos = brush.mesh ().averagePosition (i);
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const glm::vec3  newPos = oldPos + (this->intensity () * (avgPos - oldPos));
+  const float   intensity = this->intensity ();
+  BrushVertices vertices (brush.mesh (), faces);
+
+  this->laplacian.update (brush.mesh (), vertices.indices);
 
-    brush.mesh ().vertex (i, newPos);
+  vertices.forEachVertex ([this, &brush, &vertices, intensity](unsigned int i, float& x,
+                                                                float& y, float& z) {
+    const glm::vec3 avgPos = this->laplacian.average (brush.mesh (), vertices.indices[i]);
+
+    x += intensity * (avgPos.x - x);
+    y += intensity * (avgPos.y - y);
+    z += intensity * (avgPos.z - z);
   });
+  vertices.write (brush.mesh ());
 }
 
-void SBReduceParameters::sculpt (const SculptBrush&, const DynamicFaces&) const {}
+void SBReduceParameters::sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const {}
 
-void SBFlattenParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBFlattenParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                  ToolSculptArena&) const
 {
   if (faces.isEmpty () == false)
   {
@@ -95,60 +307,74 @@ void SBFlattenParameters::sculpt (const SculptBrush& brush, const DynamicFaces&
       plane = PrimPlane (avgPos, avgNormal);
     }
 
-    brush.mesh ().forEachVertex (faces, [this, &brush, &plane](unsigned int i) {
-      const glm::vec3& oldPos = brush.mesh ().vertex (i);
-      const float      distance = plane.distance (oldPos);
+    const PlaneDistance distance (plane);
+    const float         minDistance = this->hasLockedPlane () ? -Util::maxFloat () : 0.0f;
+    BrushVertices       vertices (brush.mesh (), faces);
 
-      float factor =
-        this->intensity () * Util::linearStep (oldPos, brush.position (), 0.0f, brush.radius ());
-      factor *= this->hasLockedPlane () ? distance : glm::max (0.0f, distance);
+    const auto kernel = [&distance, &vertices, minDistance](const auto& falloff) {
+      vertices.forEachVertex ([&](unsigned int, float& x, float& y, float& z) {
+        const float f = falloff (x, y, z) * glm::max (minDistance, distance (x, y, z));
 
-      const glm::vec3 newPos = oldPos - (plane.normal () * factor);
-      brush.mesh ().vertex (i, newPos);
-    });
+        x -= f * distance.normal.x;
+        y -= f * distance.normal.y;
+        z -= f * distance.normal.z;
+      });
+    };
+    withLinearFalloff (brush.position (), 0.0f, brush.radius (), this->intensity (), kernel);
+    vertices.write (brush.mesh ());
   }
 }
 
-void SBCreaseParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBCreaseParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                 ToolSculptArena&) const
 {
   if (faces.isEmpty () == false && brush.position () != brush.lastPosition ())
   {
-    const glm::vec3 normal = this->invert (brush.normal ());
-
-    brush.mesh ().forEachVertex (faces, [this, &brush, &normal](unsigned int i) {
-      const glm::vec3& oldPos = brush.mesh ().vertex (i);
-      const glm::vec3  delta = brush.position () - oldPos;
-      const float      distance = glm::length (delta) / brush.radius ();
-
-      if (distance <= 1.0f)
-      {
-        const float invDistance2 = (distance - 1.0f) * (distance - 1.0f);
-        const float hFactor = invDistance2 * this->intensity ();
-        float vFactor = invDistance2 * invDistance2 * brush.radius () * this->intensity () * 0.5f;
-        const glm::vec3 newPos = (oldPos + (hFactor * delta)) + (normal * vFactor);
-
-        brush.mesh ().vertex (i, newPos);
-      }
+    const float            intensity = this->intensity ();
+    const glm::vec3        normal = this->invert (brush.normal ());
+    const glm::vec3        vDirection = normal * brush.radius () * intensity * 0.5f;
+    const glm::vec3        target = brush.position ();
+    const QuadraticFalloff falloff{target, 1.0f / brush.radius ()};
+    BrushVertices          vertices (brush.mesh (), faces);
+
+    vertices.forEachVertex ([&](unsigned int, float& x, float& y, float& z) {
+      const float f = falloff (x, y, z);
+      const float c = f * intensity;
+
+      x += c * (target.x - x);
+      y += c * (target.y - y);
+      z += c * (target.z - z);
+
+      x += f * f * vDirection.x;
+      y += f * f * vDirection.y;
+      z += f * f * vDirection.z;
     });
+    vertices.write (brush.mesh ());
   }
 }
 
-void SBPinchParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces) const
+void SBPinchParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                ToolSculptArena&) const
 {
-  brush.mesh ().forEachVertex (faces, [&brush](unsigned int i) {
-    const glm::vec3& oldPos = brush.mesh ().vertex (i);
-    const glm::vec3  delta = brush.position () - oldPos;
-    const float      distance = glm::length (delta) / brush.radius ();
+  const glm::vec3        target = brush.position ();
+  const QuadraticFalloff falloff{target, 1.0f / brush.radius ()};
+  BrushVertices          vertices (brush.mesh (), faces);
 
-    if (distance <= 1.0f)
-    {
-      const float     invDistance2 = (distance - 1.0f) * (distance - 1.0f);
-      const float     hFactor = invDistance2 * 0.5f;
-      const glm::vec3 newPos = oldPos + (hFactor * delta);
+  vertices.forEachVertex ([&falloff, &target](unsigned int, float& x, float& y, float& z) {
+    const float c = 0.5f * falloff (x, y, z);
 
-      brush.mesh ().vertex (i, newPos);
-    }
+    x += c * (target.x - x);
+    y += c * (target.y - y);
+    z += c * (target.z - z);
   });
+  vertices.write (brush.mesh ());
+}
+
+void SBFreezeParameters::sculpt (const SculptBrush& brush, const DynamicFaces& faces,
+                                 ToolSculptArena&) const
+{
+  brush.mesh ().forEachVertex (
+    faces, [this, &brush](unsigned int i) { brush.mesh ().freeze (i, this->invert () == false); });
 }
 
 struct SculptBrush::Impl
@@ -158,6 +384,8 @@ struct SculptBrush::Impl
   float        detailFactor;
   float        stepWidthFactor;
   bool         subdivide;
+  bool         batchSubdivision;
+  float        coarsening;
   DynamicMesh* _mesh;
   bool         hasPointOfAction;
   glm::vec3    _prevPosition;
@@ -172,6 +400,8 @@ struct SculptBrush::Impl
     , detailFactor (0.0f)
     , stepWidthFactor (0.0f)
     , subdivide (true)
+    , batchSubdivision (false)
+    , coarsening (1.0f)
     , _mesh (nullptr)
     , hasPointOfAction (false)
   {
@@ -191,7 +421,7 @@ struct SculptBrush::Impl
     assert (this->detailFactor > 0.0f);
     assert (this->detailFactor < 1.0f);
 
-    return (1.0f - this->detailFactor) * this->radius;
+    return (1.0f - this->detailFactor) * this->radius * this->coarsening;
   }
 
   const glm::vec3& lastPosition () const
@@ -265,21 +495,32 @@ struct SculptBrush::Impl
     assert (this->_parameters);
 
     DynamicFaces faces;
-    this->_mesh->intersects (this->sphere (), faces);
 
     if (this->_parameters->discardBack ())
+    {
+      this->_mesh->intersectsUnclipped (this->sphere (), this->normal (), faces);
+    }
+    else
+    {
+      this->_mesh->intersectsUnclipped (this->sphere (), faces);
+    }
+    if (this->_parameters->ignoresFrozen () == false)
     {
       faces.filter ([this](unsigned int i) {
-        return glm::dot (this->normal (), this->_mesh->face (i).cross ()) > 0.0f;
+        unsigned int i1, i2, i3;
+        this->_mesh->vertexIndices (i, i1, i2, i3);
+
+        return this->_mesh->isFrozen (i1) == false && this->_mesh->isFrozen (i2) == false &&
+               this->_mesh->isFrozen (i3) == false;
       });
     }
     return faces;
   }
 
-  void sculpt (const DynamicFaces& faces) const
+  void sculpt (const DynamicFaces& faces, ToolSculptArena& arena) const
   {
     assert (this->_parameters);
-    this->_parameters->sculpt (*this->self, faces);
+    this->_parameters->sculpt (*this->self, faces, arena);
   }
 
   SBParameters* parametersPointer () const { return this->_parameters.get (); }
@@ -293,11 +534,15 @@ GETTER_CONST (float, SculptBrush, radius)
 GETTER_CONST (float, SculptBrush, detailFactor)
 GETTER_CONST (float, SculptBrush, stepWidthFactor)
 GETTER_CONST (bool, SculptBrush, subdivide)
+GETTER_CONST (bool, SculptBrush, batchSubdivision)
+GETTER_CONST (float, SculptBrush, coarsening)
 DELEGATE_CONST (DynamicMesh&, SculptBrush, mesh)
 SETTER (float, SculptBrush, radius)
 SETTER (float, SculptBrush, detailFactor)
 SETTER (float, SculptBrush, stepWidthFactor)
 SETTER (bool, SculptBrush, subdivide)
+SETTER (bool, SculptBrush, batchSubdivision)
+SETTER (float, SculptBrush, coarsening)
 DELEGATE_CONST (float, SculptBrush, subdivThreshold)
 DELEGATE_CONST (const glm::vec3&, SculptBrush, lastPosition)
 DELEGATE_CONST (const glm::vec3&, SculptBrush, position)
@@ -310,6 +555,6 @@ DELEGATE3 (void, SculptBrush, setPointOfAction, DynamicMesh&, const glm::vec3&,
 DELEGATE (void, SculptBrush, resetPointOfAction)
 DELEGATE1 (void, SculptBrush, mirror, const PrimPlane&)
 DELEGATE_CONST (DynamicFaces, SculptBrush, getAffectedFaces)
-DELEGATE1_CONST (void, SculptBrush, sculpt, const DynamicFaces&)
+DELEGATE2_CONST (void, SculptBrush, sculpt, const DynamicFaces&, ToolSculptArena&)
 DELEGATE_CONST (SBParameters*, SculptBrush, parametersPointer)
 DELEGATE1 (void, SculptBrush, parametersPointer, SBParameters*)
@@ -8,12 +8,14 @@
 #include <glm/glm.hpp>
 #include "macro.hpp"
 #include "maybe.hpp"
+#include "tool/sculpt/util/laplacian.hpp"
 
 class DynamicFaces;
 class DynamicMesh;
 class PrimPlane;
 class PrimSphere;
 class SculptBrush;
+class ToolSculptArena;
 
 class SBParameters
 {
@@ -30,9 +32,12 @@ public:
 
   virtual bool reduce () const { return false; }
 
+  // affected faces include faces of frozen vertices
+  virtual bool ignoresFrozen () const { return false; }
+
   virtual void mirror (const PrimPlane&) {}
 
-  virtual void sculpt (const SculptBrush&, const DynamicFaces&) const = 0;
+  virtual void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const = 0;
 };
 
 class SBIntensityParameter : virtual public SBParameters
@@ -84,7 +89,7 @@ public:
   {
   }
 
-  void sculpt (const SculptBrush&, const DynamicFaces&) const;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const;
 
   MEMBER_GETTER_SETTER (bool, constantHeight);
 };
@@ -92,7 +97,7 @@ public:
 class SBGrablikeParameters : public SBDiscardBackParameter
 {
 public:
-  void sculpt (const SculptBrush&, const DynamicFaces&) const override;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const override;
 
   bool useLastPos () const override { return true; }
 };
@@ -100,7 +105,10 @@ public:
 class SBSmoothParameters : public SBIntensityParameter
 {
 public:
-  void sculpt (const SculptBrush&, const DynamicFaces&) const;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const;
+
+private:
+  mutable SculptLaplacian laplacian;
 };
 
 class SBReduceParameters : public SBIntensityParameter
@@ -108,7 +116,7 @@ class SBReduceParameters : public SBIntensityParameter
 public:
   bool reduce () const override { return true; }
 
-  void sculpt (const SculptBrush&, const DynamicFaces&) const override;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const override;
 };
 
 class SBFlattenParameters : public SBIntensityParameter
@@ -116,7 +124,7 @@ class SBFlattenParameters : public SBIntensityParameter
 public:
   SBFlattenParameters ();
 
-  void sculpt (const SculptBrush&, const DynamicFaces&) const override;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const override;
 
   bool             hasLockedPlane () const;
   const PrimPlane& lockedPlane () const;
@@ -127,19 +135,28 @@ public:
   MEMBER_GETTER_SETTER (bool, lockPlane);
 
 private:
-  Maybe<PrimPlane> _lockedPlane;
+  MaybeInline<PrimPlane> _lockedPlane;
 };
 
 class SBCreaseParameters : public SBIntensityParameter, public SBInvertParameter
 {
 public:
-  void sculpt (const SculptBrush&, const DynamicFaces&) const;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const;
 };
 
 class SBPinchParameters : public SBInvertParameter
 {
 public:
-  void sculpt (const SculptBrush&, const DynamicFaces&) const;
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const;
+};
+
+// freezes the vertices of the affected faces, or unfreezes them if inverted
+class SBFreezeParameters : public SBInvertParameter
+{
+public:
+  bool ignoresFrozen () const override { return true; }
+
+  void sculpt (const SculptBrush&, const DynamicFaces&, ToolSculptArena&) const override;
 };
 
 class SculptBrush
@@ -151,6 +168,8 @@ public:
   float        detailFactor () const;
   float        stepWidthFactor () const;
   bool         subdivide () const;
+  bool         batchSubdivision () const;
+  float        coarsening () const;
   bool         hasMesh () const;
   DynamicMesh& mesh () const;
 
@@ -158,6 +177,9 @@ public:
   void detailFactor (float);
   void stepWidthFactor (float);
   void subdivide (bool);
+  void batchSubdivision (bool);
+  // scales the subdivision threshold, e.g., to keep dabs within a time budget
+  void coarsening (float);
 
   float            subdivThreshold () const;
   const glm::vec3& lastPosition () const;
@@ -172,7 +194,7 @@ public:
   void             mirror (const PrimPlane&);
 
   DynamicFaces getAffectedFaces () const;
-  void         sculpt (const DynamicFaces&) const;
+  void         sculpt (const DynamicFaces&, ToolSculptArena&) const;
 
   template <typename T> T& initParameters ()
   {
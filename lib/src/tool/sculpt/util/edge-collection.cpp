@@ -2,30 +2,123 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cassert>
 #include <glm/glm.hpp>
+#include "hash.hpp"
+#include "profile.hpp"
 #include "tool/sculpt/util/edge-collection.hpp"
-#include "util.hpp"
 
 namespace
 {
-  ui_pair makeUiKey (unsigned int i1, unsigned int i2)
+  constexpr uint64_t     emptyKey = ~uint64_t (0);
+  constexpr unsigned int initialCapacityLog2 = 8;
+
+  uint64_t makeKey (unsigned int i1, unsigned int i2)
   {
     assert (i1 != i2);
-    return ui_pair (glm::min (i1, i2), glm::max (i1, i2));
+    return EdgeKey (i1, i2).value ();
+  }
+}
+
+ToolSculptEdgeTable::ToolSculptEdgeTable ()
+  : keys (std::size_t (1) << initialCapacityLog2, emptyKey)
+  , values (std::size_t (1) << initialCapacityLog2)
+  , shift (64 - initialCapacityLog2)
+{
+}
+
+/* Packed keys of nearby edges only differ in their lower bits, so keys are mixed before their
+ * upper bits index the table.
+ */
+unsigned int ToolSculptEdgeTable::slot (uint64_t key) const
+{
+  const unsigned int mask = this->keys.size () - 1;
+  unsigned int       s = (unsigned int) (Hash::mix (key) >> this->shift);
+
+  while (this->keys[s] != emptyKey && this->keys[s] != key)
+  {
+    s = (s + 1) & mask;
+  }
+  return s;
+}
+
+void ToolSculptEdgeTable::grow ()
+{
+  const std::vector<unsigned int> oldValues (this->values);
+  const unsigned int              capacity = 2 * this->keys.size ();
+
+  this->shift--;
+  this->keys.assign (capacity, emptyKey);
+  this->values.resize (capacity);
+
+  for (unsigned int i = 0; i < this->usedSlots.size (); i++)
+  {
+    const ui_pair&     edge = this->edges[i];
+    const uint64_t     key = makeKey (edge.first, edge.second);
+    const unsigned int s = this->slot (key);
+
+    this->keys[s] = key;
+    this->values[s] = oldValues[this->usedSlots[i]];
+    this->usedSlots[i] = s;
+  }
+}
+
+bool ToolSculptEdgeTable::insert (unsigned int i1, unsigned int i2, unsigned int value)
+{
+  DILAY_ALLOCATION_SCOPE ("edge-maps");
+
+  if (2 * (this->edges.size () + 1) > this->keys.size ())
+  {
+    this->grow ();
+  }
+
+  const uint64_t     key = makeKey (i1, i2);
+  const unsigned int s = this->slot (key);
+
+  if (this->keys[s] == key)
+  {
+    return false;
+  }
+  else
+  {
+    this->keys[s] = key;
+    this->values[s] = value;
+    this->usedSlots.push_back (s);
+    this->edges.emplace_back (glm::min (i1, i2), glm::max (i1, i2));
+    return true;
   }
 }
 
+unsigned int ToolSculptEdgeTable::find (unsigned int i1, unsigned int i2) const
+{
+  const uint64_t     key = makeKey (i1, i2);
+  const unsigned int s = this->slot (key);
+
+  return this->keys[s] == key ? this->values[s] : Util::invalidIndex ();
+}
+
+void ToolSculptEdgeTable::reset ()
+{
+  for (unsigned int s : this->usedSlots)
+  {
+    this->keys[s] = emptyKey;
+  }
+  this->usedSlots.clear ();
+  this->edges.clear ();
+}
+
 void ToolSculptEdgeMap::insert (unsigned int i1, unsigned int i2, unsigned int value)
 {
-  assert (this->contains (i1, i2) == false);
-  this->map.emplace (makeUiKey (i1, i2), value);
+  assert (value != Util::invalidIndex ());
+
+  const bool inserted = this->table.insert (i1, i2, value);
+  assert (inserted);
+  unused (inserted);
 }
 
 unsigned int ToolSculptEdgeMap::find (unsigned int i1, unsigned int i2) const
 {
-  const auto it = this->map.find (makeUiKey (i1, i2));
-
-  return it == this->map.end () ? Util::invalidIndex () : it->second;
+  return this->table.find (i1, i2);
 }
 
 bool ToolSculptEdgeMap::contains (unsigned int i1, unsigned int i2) const
@@ -33,20 +126,20 @@ bool ToolSculptEdgeMap::contains (unsigned int i1, unsigned int i2) const
   return this->find (i1, i2) != Util::invalidIndex ();
 }
 
-bool ToolSculptEdgeMap::isEmpty () const { return this->map.empty (); }
+bool ToolSculptEdgeMap::isEmpty () const { return this->table.isEmpty (); }
 
-void ToolSculptEdgeMap::reset () { this->map.clear (); }
+void ToolSculptEdgeMap::reset () { this->table.reset (); }
 
 void ToolSculptEdgeSet::insert (unsigned int i1, unsigned int i2)
 {
-  this->set.emplace (makeUiKey (i1, i2));
+  this->table.insert (i1, i2, 0);
 }
 
 bool ToolSculptEdgeSet::contains (unsigned int i1, unsigned int i2) const
 {
-  return this->set.find (makeUiKey (i1, i2)) != this->set.end ();
+  return this->table.find (i1, i2) != Util::invalidIndex ();
 }
 
-bool ToolSculptEdgeSet::isEmpty () const { return this->set.empty (); }
+bool ToolSculptEdgeSet::isEmpty () const { return this->table.isEmpty (); }
 
-void ToolSculptEdgeSet::reset () { this->set.clear (); }
+void ToolSculptEdgeSet::reset () { this->table.reset (); }
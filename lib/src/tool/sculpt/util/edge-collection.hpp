@@ -5,15 +5,43 @@
 #ifndef DILAY_TOOL_SCULPT_EDGE_COLLECTION
 #define DILAY_TOOL_SCULPT_EDGE_COLLECTION
 
-#include <unordered_map>
-#include <unordered_set>
-#include "hash.hpp"
+#include <cstdint>
+#include <vector>
+#include "util.hpp"
 
-class ToolSculptEdgeMap
+/* Open-addressing hash table of undirected edges, which are packed into 64-bit keys.  Edges are
+ * iterated in insertion order.  Resetting a table keeps its memory, so a table can be reused
+ * without allocations.
+ */
+class ToolSculptEdgeTable
 {
 public:
-  typedef std::unordered_map<std::pair<unsigned int, unsigned int>, unsigned int> Map;
+  typedef std::vector<ui_pair> Edges;
+
+  ToolSculptEdgeTable ();
+
+  bool         insert (unsigned int, unsigned int, unsigned int);
+  unsigned int find (unsigned int, unsigned int) const;
+  bool         isEmpty () const { return this->edges.empty (); }
+  void         reset ();
 
+  Edges::const_iterator begin () const { return this->edges.begin (); }
+  Edges::const_iterator end () const { return this->edges.end (); }
+
+private:
+  unsigned int slot (uint64_t) const;
+  void         grow ();
+
+  std::vector<uint64_t>     keys;
+  std::vector<unsigned int> values;
+  std::vector<unsigned int> usedSlots;
+  Edges                     edges;
+  unsigned int              shift;
+};
+
+class ToolSculptEdgeMap
+{
+public:
   void         insert (unsigned int, unsigned int, unsigned int);
   unsigned int find (unsigned int, unsigned int) const;
   bool         contains (unsigned int, unsigned int) const;
@@ -21,24 +49,22 @@ public:
   void         reset ();
 
 private:
-  Map map;
+  ToolSculptEdgeTable table;
 };
 
 class ToolSculptEdgeSet
 {
 public:
-  typedef std::unordered_set<std::pair<unsigned int, unsigned int>> Set;
-
   void insert (unsigned int, unsigned int);
   bool contains (unsigned int, unsigned int) const;
   bool isEmpty () const;
   void reset ();
 
-  Set::const_iterator begin () const { return this->set.begin (); }
-  Set::const_iterator end () const { return this->set.end (); }
+  ToolSculptEdgeTable::Edges::const_iterator begin () const { return this->table.begin (); }
+  ToolSculptEdgeTable::Edges::const_iterator end () const { return this->table.end (); }
 
 private:
-  Set set;
+  ToolSculptEdgeTable table;
 };
 
 #endif
@@ -0,0 +1,127 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "primitive/sphere.hpp"
+#include "scene.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/governor.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  constexpr float maxCoarsening = 4.0f;
+  constexpr float coarseningStep = 1.25f;
+  // the weight of the latest dab in the average time of dabs
+  constexpr float latestTimeWeight = 0.5f;
+
+  struct Region
+  {
+    std::vector<PrimSphere> spheres;
+    float                   maxEdgeLength;
+  };
+}
+
+struct SculptGovernor::Impl
+{
+  float                                          budget;
+  float                                          coarsening;
+  float                                          averageTime;
+  bool                                           batchSubdivision;
+  Clock::time_point                              dabStart;
+  std::unordered_map<const DynamicMesh*, Region> regions;
+
+  Impl ()
+    : budget (0.0f)
+    , coarsening (1.0f)
+    , averageTime (0.0f)
+    , batchSubdivision (false)
+  {
+  }
+
+  void beginDab (SculptBrush& brush)
+  {
+    this->batchSubdivision = brush.batchSubdivision ();
+
+    if (this->budget > 0.0f && this->coarsening > 1.0f)
+    {
+      brush.coarsening (this->coarsening);
+      brush.batchSubdivision (true);
+    }
+    this->dabStart = Clock::now ();
+  }
+
+  void addRegion (const SculptBrush& brush)
+  {
+    if (brush.coarsening () > 1.0f && brush.subdivide () && brush.hasPointOfAction () &&
+        brush.mesh ().isEmpty () == false)
+    {
+      const float maxEdgeLength = brush.subdivThreshold () / brush.coarsening ();
+      auto        it = this->regions.find (&brush.mesh ());
+
+      if (it == this->regions.end ())
+      {
+        this->regions.emplace (&brush.mesh (), Region{{brush.sphere ()}, maxEdgeLength});
+      }
+      else
+      {
+        it->second.spheres.push_back (brush.sphere ());
+        it->second.maxEdgeLength = glm::min (it->second.maxEdgeLength, maxEdgeLength);
+      }
+    }
+  }
+
+  void endDab (SculptBrush& brush)
+  {
+    const float time =
+      std::chrono::duration<float, std::milli> (Clock::now () - this->dabStart).count ();
+
+    this->averageTime = glm::mix (this->averageTime, time, latestTimeWeight);
+
+    if (this->budget > 0.0f)
+    {
+      if (this->averageTime > this->budget)
+      {
+        this->coarsening = glm::min (maxCoarsening, this->coarsening * coarseningStep);
+      }
+      else if (this->averageTime < 0.5f * this->budget)
+      {
+        this->coarsening = glm::max (1.0f, this->coarsening / coarseningStep);
+      }
+    }
+    brush.coarsening (1.0f);
+    brush.batchSubdivision (this->batchSubdivision);
+  }
+
+  void endStroke (Scene& scene)
+  {
+    if (this->regions.empty () == false)
+    {
+      scene.forEachMesh ([this](DynamicMesh& mesh) {
+        const auto it = this->regions.find (&mesh);
+
+        if (it != this->regions.end () && mesh.isEmpty () == false)
+        {
+          ToolSculptAction::refineRegion (mesh, it->second.spheres, it->second.maxEdgeLength);
+        }
+      });
+      this->regions.clear ();
+    }
+    this->coarsening = 1.0f;
+    this->averageTime = 0.0f;
+  }
+};
+
+DELEGATE_BIG3 (SculptGovernor)
+SETTER (float, SculptGovernor, budget)
+DELEGATE1 (void, SculptGovernor, beginDab, SculptBrush&)
+DELEGATE1 (void, SculptGovernor, addRegion, const SculptBrush&)
+DELEGATE1 (void, SculptGovernor, endDab, SculptBrush&)
+DELEGATE1 (void, SculptGovernor, endStroke, Scene&)
@@ -0,0 +1,35 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_GOVERNOR
+#define DILAY_TOOL_SCULPT_GOVERNOR
+
+#include "macro.hpp"
+
+class Scene;
+class SculptBrush;
+
+/* Keeps the dabs of a stroke within a time budget.  If recent dabs took too long, the following
+ * dabs subdivide coarser and relax and smooth their regions once (cf. batched subdivision).  The
+ * regions of coarsened dabs are refined at full detail when the stroke ends.
+ */
+class SculptGovernor
+{
+public:
+  DECLARE_BIG3 (SculptGovernor)
+
+  // the budget of a dab in milliseconds, where 0 disables the governor
+  void budget (float);
+  void beginDab (SculptBrush&);
+  // records the brush's region if it was coarsened, e.g., also for mirrored brushes
+  void addRegion (const SculptBrush&);
+  void endDab (SculptBrush&);
+  // refines the regions of coarsened dabs in the scene's remaining meshes
+  void endStroke (Scene&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,87 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include "dynamic/mesh.hpp"
+#include "tool/sculpt/util/laplacian.hpp"
+#include "util.hpp"
+
+struct SculptLaplacian::Impl
+{
+  unsigned int meshId;
+  unsigned int topologyRevision;
+
+  // the row of each vertex, or an invalid index
+  std::vector<unsigned int> rows;
+
+  std::vector<unsigned int> offsets;
+  std::vector<unsigned int> columns;
+  std::vector<float>        weights;
+
+  Impl () { this->reset (); }
+
+  bool isValid (const DynamicMesh& mesh) const
+  {
+    return mesh.id () == this->meshId && mesh.topologyRevision () == this->topologyRevision;
+  }
+
+  void update (const DynamicMesh& mesh, const std::vector<unsigned int>& vertices)
+  {
+    if (this->isValid (mesh) == false)
+    {
+      this->reset ();
+      this->meshId = mesh.id ();
+      this->topologyRevision = mesh.topologyRevision ();
+    }
+    if (this->rows.size () < mesh.vertexCapacity ())
+    {
+      this->rows.resize (mesh.vertexCapacity (), Util::invalidIndex ());
+    }
+
+    for (unsigned int i : vertices)
+    {
+      if (this->rows[i] == Util::invalidIndex ())
+      {
+        const float weight = 1.0f / float(mesh.valence (i));
+
+        this->rows[i] = this->offsets.size () - 1;
+        mesh.forEachVertexAdjacentToVertex (i, [this, weight](unsigned int j) {
+          this->columns.push_back (j);
+          this->weights.push_back (weight);
+        });
+        this->offsets.push_back (this->columns.size ());
+      }
+    }
+  }
+
+  glm::vec3 average (const DynamicMesh& mesh, unsigned int i) const
+  {
+    assert (this->isValid (mesh));
+    assert (i < this->rows.size () && this->rows[i] != Util::invalidIndex ());
+
+    const unsigned int row = this->rows[i];
+    glm::vec3          position (0.0f);
+
+    for (unsigned int k = this->offsets[row]; k < this->offsets[row + 1]; k++)
+    {
+      position += this->weights[k] * mesh.vertex (this->columns[k]);
+    }
+    return position;
+  }
+
+  void reset ()
+  {
+    this->meshId = Util::invalidIndex ();
+    this->topologyRevision = 0;
+    this->rows.clear ();
+    this->offsets.assign (1, 0);
+    this->columns.clear ();
+    this->weights.clear ();
+  }
+};
+
+DELEGATE_BIG3 (SculptLaplacian)
+DELEGATE2 (void, SculptLaplacian, update, const DynamicMesh&, const std::vector<unsigned int>&)
+DELEGATE2_CONST (glm::vec3, SculptLaplacian, average, const DynamicMesh&, unsigned int)
+DELEGATE (void, SculptLaplacian, reset)
@@ -0,0 +1,36 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_LAPLACIAN
+#define DILAY_TOOL_SCULPT_LAPLACIAN
+
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+class DynamicMesh;
+
+/* The umbrella operator of a mesh's region as a sparse matrix in compressed rows.  The row of a
+ * vertex holds its neighbors, each weighted by the reciprocal of the vertex's valence.  The
+ * weights only depend on the topology, hence rows are kept across updates and are discarded
+ * when faces of the mesh are added or deleted.
+ */
+class SculptLaplacian
+{
+public:
+  DECLARE_BIG3 (SculptLaplacian)
+
+  // adds the missing rows of the given vertices
+  void update (const DynamicMesh&, const std::vector<unsigned int>&);
+
+  // the weighted average of the neighbors of an updated vertex
+  glm::vec3 average (const DynamicMesh&, unsigned int) const;
+
+  void reset ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
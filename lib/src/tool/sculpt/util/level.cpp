@@ -0,0 +1,270 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <vector>
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction.hpp"
+#include "mesh.hpp"
+#include "parallel.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "tool/sculpt/util/level.hpp"
+#include "util.hpp"
+
+namespace
+{
+  static const unsigned int propagationGrainSize = 1 << 10;
+
+  // barycentric coordinates of the projection of a position onto a triangle, clamped to it
+  glm::vec3 barycentric (const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+                         const glm::vec3& p)
+  {
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 ap = p - a;
+    const float     d00 = glm::dot (ab, ab);
+    const float     d01 = glm::dot (ab, ac);
+    const float     d11 = glm::dot (ac, ac);
+    const float     d20 = glm::dot (ap, ab);
+    const float     d21 = glm::dot (ap, ac);
+    const float     denom = (d00 * d11) - (d01 * d01);
+
+    if (denom < Util::epsilon ())
+    {
+      return glm::vec3 (1.0f / 3.0f);
+    }
+    const float     v = ((d11 * d20) - (d01 * d21)) / denom;
+    const float     w = ((d00 * d21) - (d01 * d20)) / denom;
+    const glm::vec3 uvw = glm::max (glm::vec3 (1.0f - v - w, v, w), glm::vec3 (0.0f));
+    const float     sum = uvw.x + uvw.y + uvw.z;
+
+    return sum > 0.0f ? uvw / sum : glm::vec3 (1.0f / 3.0f);
+  }
+}
+
+struct SculptLevel::Impl
+{
+  DynamicMesh  coarse;
+  float        resolution;
+  unsigned int fineId;
+
+  // per fine vertex
+  std::vector<bool>         isFineVertex;
+  std::vector<unsigned int> bindings;
+  std::vector<glm::vec3>    weights;
+  std::vector<glm::vec3>    fineRestPositions;
+  std::vector<glm::vec3>    finePositions;
+
+  // per coarse vertex
+  std::vector<glm::vec3>    coarseRestPositions;
+  std::vector<glm::vec3>    coarseDisplacements;
+  std::vector<unsigned int> boundOffsets;
+  std::vector<unsigned int> bound;
+
+  Impl (const DynamicMesh& fine, float r)
+    : resolution (r)
+    , fineId (fine.id ())
+  {
+    assert (r > 0.0f);
+
+    this->extract (fine);
+    this->bind (fine);
+  }
+
+  void extract (const DynamicMesh& fine)
+  {
+    const IsosurfaceExtraction::IntersectionCallback getIntersection =
+      [&fine](const PrimRay& ray, std::vector<float>& crossings) {
+        std::vector<Intersection> intersections;
+        fine.intersects (ray, intersections, true);
+        IsosurfaceExtraction::addCrossings (ray, intersections, crossings);
+      };
+
+    const IsosurfaceExtraction::DistancesCallback getDistances =
+      IsosurfaceExtraction::meshDistances (fine, this->resolution);
+
+    IsosurfaceExtraction::extract (getDistances, getIntersection, fine.mesh ().bounds (),
+                                   this->resolution, this->coarse, nullptr,
+                                   IsosurfaceExtraction::meshBounds (fine));
+  }
+
+  void bind (const DynamicMesh& fine)
+  {
+    const unsigned int numFine = fine.vertexCapacity ();
+    const unsigned int numCoarse = this->coarse.vertexCapacity ();
+
+    this->isFineVertex.resize (numFine);
+    this->bindings.resize (3 * numFine, Util::invalidIndex ());
+    this->weights.resize (numFine, glm::vec3 (0.0f));
+    this->fineRestPositions.resize (numFine, glm::vec3 (0.0f));
+
+    Parallel::forEach (numFine, [this, &fine](unsigned int i) {
+      if (fine.isFreeVertex (i) == false)
+      {
+        const glm::vec3& p = fine.vertex (i);
+        this->fineRestPositions[i] = p;
+
+        if (this->coarse.isEmpty () == false)
+        {
+          unsigned int nearest = Util::invalidIndex ();
+          this->coarse.unsignedDistance (p, Util::maxFloat (), nearest);
+          assert (nearest != Util::invalidIndex ());
+
+          unsigned int i1, i2, i3;
+          this->coarse.vertexIndices (nearest, i1, i2, i3);
+
+          this->bindings[(3 * i) + 0] = i1;
+          this->bindings[(3 * i) + 1] = i2;
+          this->bindings[(3 * i) + 2] = i3;
+          this->weights[i] = barycentric (this->coarse.vertex (i1), this->coarse.vertex (i2),
+                                          this->coarse.vertex (i3), p);
+        }
+      }
+    });
+
+    for (unsigned int i = 0; i < numFine; i++)
+    {
+      this->isFineVertex[i] = fine.isFreeVertex (i) == false;
+    }
+    this->finePositions = this->fineRestPositions;
+
+    this->coarseRestPositions.resize (numCoarse, glm::vec3 (0.0f));
+    this->coarseDisplacements.resize (numCoarse, glm::vec3 (0.0f));
+    this->coarse.forEachVertex (
+      [this](unsigned int i) { this->coarseRestPositions[i] = this->coarse.vertex (i); });
+
+    this->boundOffsets.resize (numCoarse + 1, 0);
+    for (unsigned int b : this->bindings)
+    {
+      if (b != Util::invalidIndex ())
+      {
+        this->boundOffsets[b + 1]++;
+      }
+    }
+    for (unsigned int i = 0; i < numCoarse; i++)
+    {
+      this->boundOffsets[i + 1] += this->boundOffsets[i];
+    }
+
+    std::vector<unsigned int> next (this->boundOffsets.begin (), this->boundOffsets.end () - 1);
+    this->bound.resize (this->boundOffsets.back ());
+    for (unsigned int i = 0; i < this->bindings.size (); i++)
+    {
+      if (this->bindings[i] != Util::invalidIndex ())
+      {
+        this->bound[next[this->bindings[i]]++] = i / 3;
+      }
+    }
+  }
+
+  DynamicMesh& coarseMesh () { return this->coarse; }
+
+  bool isBoundTo (const DynamicMesh& fine) const
+  {
+    if (fine.id () != this->fineId || fine.vertexCapacity () != this->isFineVertex.size ())
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < this->isFineVertex.size (); i++)
+    {
+      if (fine.isFreeVertex (i) == this->isFineVertex[i])
+      {
+        return false;
+      }
+      else if (this->isFineVertex[i] && fine.vertex (i) != this->finePositions[i])
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool propagate (DynamicMesh& fine)
+  {
+    assert (fine.id () == this->fineId);
+
+    std::vector<unsigned int> moved;
+    for (unsigned int i = 0; i < this->coarseRestPositions.size (); i++)
+    {
+      const bool isBound = this->boundOffsets[i + 1] > this->boundOffsets[i];
+
+      if (this->coarse.isFreeVertex (i))
+      {
+        if (isBound)
+        {
+          return false;
+        }
+      }
+      else
+      {
+        const glm::vec3 d = this->coarse.vertex (i) - this->coarseRestPositions[i];
+
+        if (d != this->coarseDisplacements[i])
+        {
+          this->coarseDisplacements[i] = d;
+          if (isBound)
+          {
+            moved.push_back (i);
+          }
+        }
+      }
+    }
+
+    std::vector<bool>         isDirty (this->isFineVertex.size (), false);
+    std::vector<unsigned int> dirty;
+    for (unsigned int i : moved)
+    {
+      for (unsigned int j = this->boundOffsets[i]; j < this->boundOffsets[i + 1]; j++)
+      {
+        if (isDirty[this->bound[j]] == false)
+        {
+          isDirty[this->bound[j]] = true;
+          dirty.push_back (this->bound[j]);
+        }
+      }
+    }
+
+    std::vector<glm::vec3> positions (dirty.size ());
+    Parallel::forRange (dirty.size (), propagationGrainSize,
+                        [this, &dirty, &positions](unsigned int begin, unsigned int end) {
+                          for (unsigned int k = begin; k < end; k++)
+                          {
+                            const unsigned int i = dirty[k];
+                            const glm::vec3&   w = this->weights[i];
+
+                            positions[k] =
+                              this->fineRestPositions[i] +
+                              (w.x * this->coarseDisplacements[this->bindings[(3 * i) + 0]]) +
+                              (w.y * this->coarseDisplacements[this->bindings[(3 * i) + 1]]) +
+                              (w.z * this->coarseDisplacements[this->bindings[(3 * i) + 2]]);
+                          }
+                        });
+
+    DynamicFaces faces;
+    for (unsigned int k = 0; k < dirty.size (); k++)
+    {
+      fine.vertex (dirty[k], positions[k]);
+      this->finePositions[dirty[k]] = positions[k];
+
+      for (unsigned int a : fine.adjacentFaces (dirty[k]))
+      {
+        faces.insert (a);
+      }
+    }
+    faces.commit ();
+
+    fine.deferNormals (faces);
+    fine.deferRealignment (faces);
+    return true;
+  }
+};
+
+DELEGATE2_BIG3 (SculptLevel, const DynamicMesh&, float)
+DELEGATE (DynamicMesh&, SculptLevel, coarseMesh)
+GETTER_CONST (float, SculptLevel, resolution)
+DELEGATE1_CONST (bool, SculptLevel, isBoundTo, const DynamicMesh&)
+DELEGATE1 (bool, SculptLevel, propagate, DynamicMesh&)
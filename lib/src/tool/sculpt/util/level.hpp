@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_LEVEL
+#define DILAY_TOOL_SCULPT_LEVEL
+
+#include "macro.hpp"
+
+class DynamicMesh;
+
+/* A coarse level of a fine mesh.  The coarse mesh is extracted from the fine mesh at a given
+ * resolution, and each fine vertex is bound to the vertices of its nearest coarse face by
+ * barycentric weights.  Propagating the level displaces the fine vertices by the interpolated
+ * displacements of their coarse vertices, hence the detail of the fine mesh is kept.  Only fine
+ * vertices bound to coarse vertices that moved since the last propagation are updated.
+ * The coarse mesh must not lose vertices after binding, i.e., it is sculpted without
+ * subdivision.
+ */
+class SculptLevel
+{
+public:
+  DECLARE_BIG3 (SculptLevel, const DynamicMesh&, float)
+
+  DynamicMesh& coarseMesh ();
+  float        resolution () const;
+
+  // checks whether the fine mesh was not modified apart from propagating this level
+  bool isBoundTo (const DynamicMesh&) const;
+
+  // returns false if the coarse mesh lost bound vertices, which breaks the level
+  bool propagate (DynamicMesh&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
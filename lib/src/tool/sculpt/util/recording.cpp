@@ -0,0 +1,637 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/plane.hpp"
+#include "primitive/ray.hpp"
+#include "scene.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/arena.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "tool/sculpt/util/recording.hpp"
+#include "util.hpp"
+
+namespace
+{
+  static const char header[] = "dilay-sculpt-1";
+
+  typedef std::chrono::steady_clock Clock;
+
+  enum class Kind : std::uint32_t
+  {
+    Draw,
+    Grablike,
+    Smooth,
+    Reduce,
+    Flatten,
+    Crease,
+    Pinch,
+    Freeze
+  };
+
+  enum Flag : std::uint32_t
+  {
+    Invert = 1 << 0,
+    ConstantHeight = 1 << 1,
+    DiscardBack = 1 << 2,
+    Subdivide = 1 << 3,
+    BatchSubdivision = 1 << 4,
+    LockPlane = 1 << 5,
+    LockedPlane = 1 << 6,
+    Mirror = 1 << 7,
+    CombineMirror = 1 << 8
+  };
+
+  // consists of 4-byte members only, so that dabs are written without padding
+  struct Dab
+  {
+    float         time;
+    std::uint32_t stroke;
+    std::uint32_t mesh;
+    Kind          kind;
+    std::uint32_t flags;
+    float         radius;
+    float         detailFactor;
+    float         stepWidthFactor;
+    float         intensity;
+    glm::vec3     position;
+    glm::vec3     normal;
+    glm::vec3     lockedPlanePoint;
+    glm::vec3     lockedPlaneNormal;
+    glm::vec3     mirrorPoint;
+    glm::vec3     mirrorNormal;
+
+    bool has (Flag flag) const { return (this->flags & flag) != 0; }
+  };
+
+  void setFlag (Dab& dab, Flag flag, bool value)
+  {
+    if (value)
+    {
+      dab.flags |= flag;
+    }
+  }
+
+  unsigned int meshIndex (const Scene& scene, const DynamicMesh& mesh)
+  {
+    unsigned int index = 0;
+    unsigned int found = Util::invalidIndex ();
+
+    scene.forEachConstMesh ([&mesh, &index, &found](const DynamicMesh& m) {
+      if (&m == &mesh)
+      {
+        found = index;
+      }
+      index++;
+    });
+    return found;
+  }
+
+  bool parseKind (const std::string& name, Kind& kind)
+  {
+    static const std::vector<std::pair<std::string, Kind>> kinds = {
+      {"draw", Kind::Draw},     {"grab", Kind::Grablike}, {"smooth", Kind::Smooth},
+      {"reduce", Kind::Reduce}, {"flatten", Kind::Flatten}, {"crease", Kind::Crease},
+      {"pinch", Kind::Pinch}};
+
+    for (const auto& k : kinds)
+    {
+      if (k.first == name)
+      {
+        kind = k.second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<DynamicMesh*> sceneMeshes (Scene& scene)
+  {
+    std::vector<DynamicMesh*> meshes;
+    scene.forEachMesh ([&meshes](DynamicMesh& m) { meshes.push_back (&m); });
+    return meshes;
+  }
+
+  void recordParameters (const SBParameters& parameters, Dab& dab)
+  {
+    dab.intensity = parameters.intensity ();
+    setFlag (dab, DiscardBack, parameters.discardBack ());
+
+    if (const SBInvertParameter* p = dynamic_cast<const SBInvertParameter*> (&parameters))
+    {
+      setFlag (dab, Invert, p->invert ());
+    }
+
+    if (const SBDrawParameters* p = dynamic_cast<const SBDrawParameters*> (&parameters))
+    {
+      dab.kind = Kind::Draw;
+      setFlag (dab, ConstantHeight, p->constantHeight ());
+    }
+    else if (dynamic_cast<const SBGrablikeParameters*> (&parameters))
+    {
+      dab.kind = Kind::Grablike;
+    }
+    else if (dynamic_cast<const SBSmoothParameters*> (&parameters))
+    {
+      dab.kind = Kind::Smooth;
+    }
+    else if (dynamic_cast<const SBReduceParameters*> (&parameters))
+    {
+      dab.kind = Kind::Reduce;
+    }
+    else if (const SBFlattenParameters* p = dynamic_cast<const SBFlattenParameters*> (&parameters))
+    {
+      dab.kind = Kind::Flatten;
+      setFlag (dab, LockPlane, p->lockPlane ());
+      if (p->hasLockedPlane ())
+      {
+        setFlag (dab, LockedPlane, true);
+        dab.lockedPlanePoint = p->lockedPlane ().point ();
+        dab.lockedPlaneNormal = p->lockedPlane ().normal ();
+      }
+    }
+    else if (dynamic_cast<const SBCreaseParameters*> (&parameters))
+    {
+      dab.kind = Kind::Crease;
+    }
+    else if (dynamic_cast<const SBPinchParameters*> (&parameters))
+    {
+      dab.kind = Kind::Pinch;
+    }
+    else if (dynamic_cast<const SBFreezeParameters*> (&parameters))
+    {
+      dab.kind = Kind::Freeze;
+    }
+    else
+    {
+      DILAY_IMPOSSIBLE
+    }
+  }
+
+  void initParameters (SculptBrush& brush, Kind kind)
+  {
+    switch (kind)
+    {
+      case Kind::Draw:
+        brush.initParameters<SBDrawParameters> ();
+        break;
+      case Kind::Grablike:
+        brush.initParameters<SBGrablikeParameters> ();
+        break;
+      case Kind::Smooth:
+        brush.initParameters<SBSmoothParameters> ();
+        break;
+      case Kind::Reduce:
+        brush.initParameters<SBReduceParameters> ();
+        break;
+      case Kind::Flatten:
+        brush.initParameters<SBFlattenParameters> ();
+        break;
+      case Kind::Crease:
+        brush.initParameters<SBCreaseParameters> ();
+        break;
+      case Kind::Pinch:
+        brush.initParameters<SBPinchParameters> ();
+        break;
+      case Kind::Freeze:
+        brush.initParameters<SBFreezeParameters> ();
+        break;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  void replayParameters (const Dab& dab, SculptBrush& brush)
+  {
+    brush.parameters<SBParameters> ().intensity (dab.intensity);
+
+    switch (dab.kind)
+    {
+      case Kind::Draw:
+        brush.parameters<SBDrawParameters> ().invert (dab.has (Invert));
+        brush.parameters<SBDrawParameters> ().constantHeight (dab.has (ConstantHeight));
+        break;
+      case Kind::Grablike:
+        brush.parameters<SBGrablikeParameters> ().discardBack (dab.has (DiscardBack));
+        break;
+      case Kind::Flatten:
+      {
+        SBFlattenParameters& p = brush.parameters<SBFlattenParameters> ();
+        p.lockPlane (dab.has (LockPlane));
+        if (dab.has (LockedPlane))
+        {
+          p.lockedPlane (PrimPlane (dab.lockedPlanePoint, dab.lockedPlaneNormal));
+        }
+        else
+        {
+          p.resetLockedPlane ();
+        }
+        break;
+      }
+      case Kind::Crease:
+        brush.parameters<SBCreaseParameters> ().invert (dab.has (Invert));
+        break;
+      case Kind::Pinch:
+        brush.parameters<SBPinchParameters> ().invert (dab.has (Invert));
+        break;
+      case Kind::Freeze:
+        brush.parameters<SBFreezeParameters> ().invert (dab.has (Invert));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+struct SculptRecording::Impl
+{
+  mutable std::mutex mutex;
+  bool               recording;
+  Clock::time_point  startTime;
+  unsigned int       strokes;
+  bool               isInStroke;
+  std::vector<Dab>   dabs;
+
+  Impl ()
+    : recording (false)
+    , strokes (0)
+    , isInStroke (false)
+  {
+  }
+
+  bool isRecording () const
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    return this->recording;
+  }
+
+  void start ()
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    this->recording = true;
+    this->startTime = Clock::now ();
+    this->strokes = 0;
+    this->isInStroke = false;
+    this->dabs.clear ();
+  }
+
+  void stop ()
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    this->recording = false;
+  }
+
+  unsigned int numDabs () const
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    return this->dabs.size ();
+  }
+
+  unsigned int numStrokes () const
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    return this->strokes;
+  }
+
+  void addDab (const SculptBrush& brush, const Scene& scene, const DynamicMesh& mesh,
+               const PrimPlane* mirror, bool combineMirror)
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    if (this->recording == false)
+    {
+      return;
+    }
+    if (this->isInStroke == false)
+    {
+      this->isInStroke = true;
+      this->strokes++;
+    }
+
+    Dab dab;
+    std::memset (&dab, 0, sizeof (Dab));
+
+    dab.time = std::chrono::duration<float> (Clock::now () - this->startTime).count ();
+    dab.stroke = this->strokes - 1;
+    dab.mesh = meshIndex (scene, mesh);
+    dab.radius = brush.radius ();
+    dab.detailFactor = brush.detailFactor ();
+    dab.stepWidthFactor = brush.stepWidthFactor ();
+    dab.position = brush.position ();
+    dab.normal = brush.normal ();
+
+    setFlag (dab, Subdivide, brush.subdivide ());
+    setFlag (dab, BatchSubdivision, brush.batchSubdivision ());
+    recordParameters (brush.parameters (), dab);
+
+    if (mirror)
+    {
+      setFlag (dab, Mirror, true);
+      setFlag (dab, CombineMirror, combineMirror);
+      dab.mirrorPoint = mirror->point ();
+      dab.mirrorNormal = mirror->normal ();
+    }
+    this->dabs.push_back (dab);
+  }
+
+  void endStroke ()
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    this->isInStroke = false;
+  }
+
+  bool toFile (const std::string& fileName) const
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    std::ofstream               file (fileName, std::ios::binary);
+
+    const std::uint32_t n = this->dabs.size ();
+
+    file.write (header, sizeof (header));
+    file.write (reinterpret_cast<const char*> (&n), sizeof (n));
+    file.write (reinterpret_cast<const char*> (this->dabs.data ()),
+                std::streamsize (n * sizeof (Dab)));
+    return bool(file);
+  }
+
+  bool fromFile (const std::string& fileName)
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+    std::ifstream               file (fileName, std::ios::binary);
+    char                        fileHeader[sizeof (header)];
+    std::uint32_t               n;
+
+    file.read (fileHeader, sizeof (header));
+    if (file.good () == false || std::memcmp (fileHeader, header, sizeof (header)) != 0)
+    {
+      return false;
+    }
+
+    file.read (reinterpret_cast<char*> (&n), sizeof (n));
+    if (file.good () == false)
+    {
+      return false;
+    }
+
+    std::vector<Dab> fileDabs (n);
+    file.read (reinterpret_cast<char*> (fileDabs.data ()), std::streamsize (n * sizeof (Dab)));
+    if (bool(file) == false)
+    {
+      return false;
+    }
+
+    for (const Dab& dab : fileDabs)
+    {
+      if (std::uint32_t (dab.kind) > std::uint32_t (Kind::Freeze))
+      {
+        return false;
+      }
+    }
+
+    this->recording = false;
+    this->isInStroke = false;
+    this->dabs = std::move (fileDabs);
+    this->strokes = this->dabs.empty () ? 0 : this->dabs.back ().stroke + 1;
+    return true;
+  }
+
+  /* Strokes walk over the mesh in the directions from its center, which are projected onto its
+   * surface by intersecting rays towards the center (i.e., like strokes of a user who looks at
+   * the center).  Consecutive directions are a step width apart on a sphere of the mesh's size.
+   * Random walks turn randomly, spirals wind three times around their starting direction, and
+   * drags go straight.  Dabs whose rays miss the mesh are skipped.
+   */
+  bool generate (const Scene& scene, unsigned int meshIndex, const Workload& workload)
+  {
+    const DynamicMesh* mesh = nullptr;
+    unsigned int       index = 0;
+    Kind               kind;
+
+    scene.forEachConstMesh ([meshIndex, &mesh, &index](const DynamicMesh& m) {
+      if (index++ == meshIndex)
+      {
+        mesh = &m;
+      }
+    });
+
+    if (mesh == nullptr || mesh->isEmpty () || parseKind (workload.brush, kind) == false)
+    {
+      return false;
+    }
+
+    const PrimAABox bounds = mesh->bounds ();
+    const float     extent = glm::max (bounds.maxDimExtent (), Util::epsilon ());
+    const float     radius = workload.radius * extent;
+    const float     stepAngle = 2.0f * workload.stepWidthFactor * radius / extent;
+    const float     numTurns = 3.0f;
+
+    std::default_random_engine            gen (workload.seed);
+    std::uniform_real_distribution<float> uniform (-1.0f, 1.0f);
+    std::normal_distribution<float>       turn (0.0f, 0.3f);
+
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    this->recording = false;
+    this->isInStroke = false;
+    this->dabs.clear ();
+
+    for (unsigned int s = 0; s < workload.numStrokes; s++)
+    {
+      glm::vec3 start (uniform (gen), uniform (gen), uniform (gen));
+
+      if (glm::length (start) < Util::epsilon ())
+      {
+        start = glm::vec3 (0.0f, 0.0f, 1.0f);
+      }
+      start = glm::normalize (start);
+
+      const glm::vec3 u = glm::normalize (Util::orthogonal (start));
+      const glm::vec3 v = glm::cross (start, u);
+      glm::vec3       direction = start;
+      glm::vec3       heading = u;
+
+      for (unsigned int i = 0; i < workload.numDabsPerStroke; i++)
+      {
+        if (workload.path == Path::Spiral)
+        {
+          const float t = float(i) / float(workload.numDabsPerStroke);
+          const float theta = glm::min (glm::half_pi<float> (),
+                                        stepAngle * float(workload.numDabsPerStroke) * t / numTurns);
+          const float phi = numTurns * glm::two_pi<float> () * t;
+
+          direction = (glm::cos (theta) * start) +
+                      (glm::sin (theta) * ((glm::cos (phi) * u) + (glm::sin (phi) * v)));
+        }
+        else if (i > 0)
+        {
+          if (workload.path == Path::RandomWalk)
+          {
+            const float angle = turn (gen);
+            heading = (glm::cos (angle) * heading) +
+                      (glm::sin (angle) * glm::cross (direction, heading));
+          }
+          direction = glm::normalize ((glm::cos (stepAngle) * direction) +
+                                      (glm::sin (stepAngle) * heading));
+          heading = glm::normalize (heading - (glm::dot (heading, direction) * direction));
+        }
+
+        const PrimRay ray (bounds.center () + (direction * 2.0f * extent), -direction);
+        Intersection  intersection;
+
+        if (mesh->intersects (ray, intersection))
+        {
+          Dab dab;
+          std::memset (&dab, 0, sizeof (Dab));
+
+          dab.stroke = s;
+          dab.mesh = meshIndex;
+          dab.kind = kind;
+          dab.radius = radius;
+          dab.detailFactor = workload.detailFactor;
+          dab.stepWidthFactor = workload.stepWidthFactor;
+          dab.intensity = workload.intensity;
+          dab.position = intersection.position ();
+          dab.normal = intersection.normal ();
+          setFlag (dab, Subdivide, true);
+
+          this->dabs.push_back (dab);
+        }
+      }
+    }
+    this->strokes = this->dabs.empty () ? 0 : this->dabs.back ().stroke + 1;
+    return true;
+  }
+
+  static bool parsePath (const std::string& name, Path& path)
+  {
+    if (name == "random-walk")
+    {
+      path = Path::RandomWalk;
+    }
+    else if (name == "spiral")
+    {
+      path = Path::Spiral;
+    }
+    else if (name == "drag")
+    {
+      path = Path::Drag;
+    }
+    else
+    {
+      return false;
+    }
+    return true;
+  }
+
+  /* Strokes are replayed like the sculpt tool sculpts them: all dabs of a stroke share a brush
+   * (grab-like brushes depend on the previous point of action) and an arena.  Empty meshes are
+   * deleted after each stroke, which keeps the mesh indices of the next stroke valid.
+   */
+  bool replay (Scene& scene, const DabTiming& timing) const
+  {
+    std::lock_guard<std::mutex> lock (this->mutex);
+
+    SculptBrush               brush;
+    ToolSculptArena           arena;
+    std::vector<DynamicMesh*> meshes = sceneMeshes (scene);
+    bool                      hasParameters = false;
+    Kind                      kind = Kind::Draw;
+
+    for (unsigned int i = 0; i < this->dabs.size (); i++)
+    {
+      const Dab& dab = this->dabs[i];
+
+      if (i > 0 && dab.stroke != this->dabs[i - 1].stroke)
+      {
+        brush.resetPointOfAction ();
+        arena.reset ();
+        scene.deleteEmptyMeshes ();
+        meshes = sceneMeshes (scene);
+        hasParameters = false;
+      }
+
+      if (dab.mesh >= meshes.size () || meshes[dab.mesh]->isEmpty ())
+      {
+        return false;
+      }
+
+      if (hasParameters == false || kind != dab.kind)
+      {
+        initParameters (brush, dab.kind);
+        hasParameters = true;
+        kind = dab.kind;
+      }
+      replayParameters (dab, brush);
+
+      brush.radius (dab.radius);
+      brush.detailFactor (dab.detailFactor);
+      brush.stepWidthFactor (dab.stepWidthFactor);
+      brush.subdivide (dab.has (Subdivide));
+      brush.batchSubdivision (dab.has (BatchSubdivision));
+      brush.setPointOfAction (*meshes[dab.mesh], dab.position, dab.normal);
+
+      const Clock::time_point start = Clock::now ();
+
+      if (dab.has (Mirror))
+      {
+        const PrimPlane mirror (dab.mirrorPoint, dab.mirrorNormal);
+
+        if (dab.has (CombineMirror))
+        {
+          ToolSculptAction::sculpt (brush, mirror, arena);
+        }
+        else
+        {
+          ToolSculptAction::sculpt (brush, arena);
+          if (brush.mesh ().isEmpty () == false)
+          {
+            brush.mirror (mirror);
+            ToolSculptAction::sculpt (brush, arena);
+            brush.mirror (mirror);
+          }
+        }
+      }
+      else
+      {
+        ToolSculptAction::sculpt (brush, arena);
+      }
+
+      if (timing)
+      {
+        timing (i, std::chrono::duration<float> (Clock::now () - start).count ());
+      }
+    }
+    scene.deleteEmptyMeshes ();
+    scene.forEachMesh ([](DynamicMesh& mesh) { mesh.bufferData (); });
+    return true;
+  }
+};
+
+DELEGATE_BIG3 (SculptRecording)
+DELEGATE_CONST (bool, SculptRecording, isRecording)
+DELEGATE (void, SculptRecording, start)
+DELEGATE (void, SculptRecording, stop)
+DELEGATE_CONST (unsigned int, SculptRecording, numDabs)
+DELEGATE_CONST (unsigned int, SculptRecording, numStrokes)
+DELEGATE5 (void, SculptRecording, addDab, const SculptBrush&, const Scene&, const DynamicMesh&,
+           const PrimPlane*, bool)
+DELEGATE (void, SculptRecording, endStroke)
+DELEGATE1_CONST (bool, SculptRecording, toFile, const std::string&)
+DELEGATE1 (bool, SculptRecording, fromFile, const std::string&)
+DELEGATE3 (bool, SculptRecording, generate, const Scene&, unsigned int,
+           const SculptRecording::Workload&)
+DELEGATE2_STATIC (bool, SculptRecording, parsePath, const std::string&, SculptRecording::Path&)
+DELEGATE2_CONST (bool, SculptRecording, replay, Scene&, const SculptRecording::DabTiming&)
@@ -0,0 +1,79 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_RECORDING
+#define DILAY_TOOL_SCULPT_RECORDING
+
+#include <functional>
+#include <string>
+#include "macro.hpp"
+
+class DynamicMesh;
+class PrimPlane;
+class Scene;
+class SculptBrush;
+
+/* Records the dabs of sculpting strokes, i.e., the brush, its point of action and the mirror
+ * plane of each sculpting step, so that they can be replayed deterministically (e.g., to reproduce
+ * performance issues).  Meshes are referenced by their index within the scene.
+ */
+class SculptRecording
+{
+public:
+  // called with the index and the duration (in seconds) of each replayed dab
+  typedef std::function<void(unsigned int, float)> DabTiming;
+
+  enum class Path
+  {
+    RandomWalk,
+    Spiral,
+    Drag
+  };
+
+  /* Parameters of synthetic strokes.  Brushes are given by their names (e.g., `draw` or
+   * `grab`), the radius is relative to the largest extent of the mesh, and the detail factor
+   * decides when the brush subdivides (cf. `SculptBrush::detailFactor`).
+   */
+  struct Workload
+  {
+    std::string  brush = "draw";
+    Path         path = Path::RandomWalk;
+    unsigned int numStrokes = 4;
+    unsigned int numDabsPerStroke = 64;
+    float        radius = 0.05f;
+    float        intensity = 0.5f;
+    float        detailFactor = 0.75f;
+    float        stepWidthFactor = 0.3f;
+    unsigned int seed = 0;
+  };
+
+  DECLARE_BIG3 (SculptRecording)
+
+  bool         isRecording () const;
+  void         start ();
+  void         stop ();
+  unsigned int numDabs () const;
+  unsigned int numStrokes () const;
+
+  // may be called from any thread while recording, otherwise nothing is recorded
+  void addDab (const SculptBrush&, const Scene&, const DynamicMesh&, const PrimPlane*, bool);
+  void endStroke ();
+
+  bool toFile (const std::string&) const;
+  bool fromFile (const std::string&);
+
+  /* Replaces the recorded dabs by synthetic strokes over the i-th mesh of the scene.  Returns
+   * false if the brush is unknown or if the mesh does not exist.
+   */
+  bool generate (const Scene&, unsigned int, const Workload&);
+  static bool parsePath (const std::string&, Path&);
+
+  // returns false if a dab references a mesh that does not exist
+  bool replay (Scene&, const DabTiming& = nullptr) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,211 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "bvh.hpp"
+#include "dynamic/mesh-changes.hpp"
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/triangle.hpp"
+#include "scene.hpp"
+#include "tool/sculpt/util/reference.hpp"
+
+namespace
+{
+  // the triangles of a chunk are stored as consecutive positions
+  struct Chunk
+  {
+    std::vector<glm::vec3> positions;
+    Bvh                    bvh;
+
+    unsigned int numTriangles () const { return this->positions.size () / 3; }
+
+    PrimTriangle triangle (unsigned int i) const
+    {
+      return PrimTriangle (this->positions[(3 * i) + 0], this->positions[(3 * i) + 1],
+                           this->positions[(3 * i) + 2]);
+    }
+
+    void build ()
+    {
+      this->bvh.build (this->numTriangles (), [this](unsigned int i) {
+        const PrimTriangle tri = this->triangle (i);
+        return PrimAABox (tri.minimum (), tri.maximum ());
+      });
+    }
+  };
+
+  struct MeshReference
+  {
+    unsigned int                                numProcessedVertices;
+    unsigned int                                numProcessedFaces;
+    std::unordered_map<unsigned int, glm::vec3> positions;
+    std::unordered_set<unsigned int>            capturedFaces;
+    std::vector<Chunk>                          chunks;
+
+    MeshReference ()
+      : numProcessedVertices (0)
+      , numProcessedFaces (0)
+    {
+    }
+
+    glm::vec3 position (const DynamicMesh& mesh, unsigned int i) const
+    {
+      const auto it = this->positions.find (i);
+      return it == this->positions.end () ? mesh.vertex (i) : it->second;
+    }
+
+    void capture (const DynamicMesh& mesh, unsigned int face, unsigned int i1, unsigned int i2,
+                  unsigned int i3, std::vector<glm::vec3>& triangles)
+    {
+      if (this->capturedFaces.insert (face).second)
+      {
+        triangles.push_back (this->position (mesh, i1));
+        triangles.push_back (this->position (mesh, i2));
+        triangles.push_back (this->position (mesh, i3));
+      }
+    }
+
+    /* Vertices that are not recorded yet have not been modified, i.e., their current positions
+     * are their pre-stroke positions.  Thus captured triangles stay valid until the stroke ends.
+     * Chunks are merged like a binary counter, so that each triangle is rebuilt only
+     * logarithmically often.
+     */
+    void update (const DynamicMesh& mesh)
+    {
+      const DynamicMeshChanges&                      changes = mesh.trackedChanges ();
+      const std::vector<DynamicMeshChanges::Vertex>& vertices = changes.vertices ();
+      const std::vector<DynamicMeshChanges::Face>&   faces = changes.faces ();
+
+      if (this->numProcessedVertices == vertices.size () &&
+          this->numProcessedFaces == faces.size ())
+      {
+        return;
+      }
+
+      for (unsigned int i = this->numProcessedVertices; i < vertices.size (); i++)
+      {
+        if (vertices[i].index < changes.numVertices () && vertices[i].isFree == false)
+        {
+          this->positions.emplace (vertices[i].index, vertices[i].position);
+        }
+      }
+
+      std::vector<glm::vec3> triangles;
+      for (unsigned int i = this->numProcessedFaces; i < faces.size (); i++)
+      {
+        const DynamicMeshChanges::Face& f = faces[i];
+
+        if (f.index < changes.numFaces () && f.isFree == false)
+        {
+          this->capture (mesh, f.index, f.i1, f.i2, f.i3, triangles);
+        }
+      }
+
+      // unmodified faces that are adjacent to modified vertices have kept their indices
+      for (unsigned int i = this->numProcessedVertices; i < vertices.size (); i++)
+      {
+        const unsigned int v = vertices[i].index;
+
+        if (v < mesh.numVertices () && mesh.isFreeVertex (v) == false)
+        {
+          for (unsigned int f : mesh.adjacentFaces (v))
+          {
+            if (changes.hasFace (f) == false)
+            {
+              unsigned int i1, i2, i3;
+              mesh.vertexIndices (f, i1, i2, i3);
+              this->capture (mesh, f, i1, i2, i3, triangles);
+            }
+          }
+        }
+      }
+      this->numProcessedVertices = vertices.size ();
+      this->numProcessedFaces = faces.size ();
+
+      if (triangles.empty () == false)
+      {
+        this->chunks.emplace_back ();
+        this->chunks.back ().positions = std::move (triangles);
+
+        while (this->chunks.size () >= 2 &&
+               this->chunks[this->chunks.size () - 2].numTriangles () <=
+                 2 * this->chunks.back ().numTriangles ())
+        {
+          Chunk& previous = this->chunks[this->chunks.size () - 2];
+          previous.positions.insert (previous.positions.end (),
+                                     this->chunks.back ().positions.begin (),
+                                     this->chunks.back ().positions.end ());
+          this->chunks.pop_back ();
+        }
+        this->chunks.back ().build ();
+      }
+    }
+
+    void intersects (const DynamicMesh& mesh, const PrimRay& ray, Intersection& intersection)
+    {
+      this->update (mesh);
+
+      const DynamicMeshChanges& changes = mesh.trackedChanges ();
+
+      mesh.intersects (ray,
+                       [&mesh, &changes](unsigned int f) {
+                         unsigned int i1, i2, i3;
+                         mesh.vertexIndices (f, i1, i2, i3);
+
+                         return changes.hasFace (f) == false && changes.hasVertex (i1) == false &&
+                                changes.hasVertex (i2) == false && changes.hasVertex (i3) == false;
+                       },
+                       intersection);
+
+      for (const Chunk& chunk : this->chunks)
+      {
+        chunk.bvh.intersects (ray, [&chunk, &ray, &intersection](unsigned int i) -> float {
+          const PrimTriangle tri = chunk.triangle (i);
+          float              t;
+
+          if (IntersectionUtil::intersects (ray, tri, false, &t))
+          {
+            intersection.update (t, ray.pointAt (t), tri.normal ());
+          }
+          return intersection.isIntersection () ? intersection.distance () : Util::maxFloat ();
+        });
+      }
+    }
+  };
+}
+
+struct SculptReference::Impl
+{
+  std::unordered_map<unsigned int, MeshReference> meshes;
+
+  void reset () { this->meshes.clear (); }
+
+  bool intersects (const Scene& scene, const PrimRay& ray, Intersection& intersection)
+  {
+    const auto intersectsMesh = [this, &ray, &intersection](const DynamicMesh& mesh) {
+      if (mesh.tracksChanges ())
+      {
+        this->meshes[mesh.id ()].intersects (mesh, ray, intersection);
+      }
+      else
+      {
+        mesh.intersects (ray, intersection);
+      }
+    };
+    scene.forEachConstMesh (intersectsMesh);
+    scene.forEachConstDeletedMesh (intersectsMesh);
+
+    return intersection.isIntersection ();
+  }
+};
+
+DELEGATE_BIG3 (SculptReference)
+DELEGATE (void, SculptReference, reset)
+DELEGATE3 (bool, SculptReference, intersects, const Scene&, const PrimRay&, Intersection&)
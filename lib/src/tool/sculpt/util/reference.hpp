@@ -0,0 +1,32 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_SCULPT_REFERENCE
+#define DILAY_TOOL_SCULPT_REFERENCE
+
+#include "macro.hpp"
+
+class Intersection;
+class PrimRay;
+class Scene;
+
+/* The surface of all meshes at the start of a stroke, as tracked since the last snapshot.  Faces
+ * that have not been modified are intersected within the meshes themselves.  The pre-stroke
+ * triangles of modified faces are reconstructed from the tracked changes and kept in compact,
+ * read-only bounding volume hierarchies, which grow along with the edited region.
+ */
+class SculptReference
+{
+public:
+  DECLARE_BIG3 (SculptReference)
+
+  // must be called at the end of each stroke
+  void reset ();
+  bool intersects (const Scene&, const PrimRay&, Intersection&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -165,9 +165,21 @@ struct ToolTransformMesh::Impl
     return scaling;
   }
 
+  void runRender () const
+  {
+    if (this->mesh == nullptr)
+    {
+      this->self->renderHoveredDynamicMesh ();
+    }
+  }
+
   ToolResponse runMoveEvent (const ViewPointingEvent& e)
   {
-    if (e.leftButton () && this->mesh)
+    if (e.leftButton () == false)
+    {
+      return ToolResponse::Redraw;
+    }
+    else if (this->mesh)
     {
       if (this->mode == Mode::Move && this->movement.move (e))
       {
@@ -263,6 +275,7 @@ struct ToolTransformMesh::Impl
 };
 
 DELEGATE_TOOL (ToolTransformMesh)
+DELEGATE_TOOL_RUN_RENDER (ToolTransformMesh)
 DELEGATE_TOOL_RUN_MOVE_EVENT (ToolTransformMesh)
 DELEGATE_TOOL_RUN_PRESS_EVENT (ToolTransformMesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolTransformMesh)
@@ -6,8 +6,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include <list>
+#include <queue>
 #include <unordered_set>
 #include "dynamic/mesh.hpp"
+#include "parallel.hpp"
 #include "primitive/plane.hpp"
 #include "tool/trim-mesh/action.hpp"
 #include "tool/trim-mesh/border.hpp"
@@ -136,6 +138,7 @@ namespace
     struct TwoDVertex
     {
       unsigned int index;
+      unsigned int id;
       glm::vec2    position;
       Curvature    curvature;
       bool         isEar;
@@ -145,6 +148,7 @@ namespace
 
       TwoDVertex (unsigned int i, const glm::vec2& p)
         : index (i)
+        , id (0)
         , position (p)
         , curvature (Curvature::Straight)
         , isEar (false)
@@ -179,6 +183,78 @@ namespace
     typedef TwoDVertices::iterator       TwoDVertexRef;
     typedef TwoDVertices::const_iterator TwoDVertexCRef;
 
+    /* The vertices of a polygon hashed into a uniform grid, so ears are tested without visiting
+     * the whole polygon.  Vertices are identified by their ids, since removed vertices are kept
+     * in the grid.
+     */
+    struct TwoDVertexGrid
+    {
+      struct Entry
+      {
+        TwoDVertexCRef vertex;
+        unsigned int   id;
+      };
+
+      glm::vec2                       min;
+      float                           cellSize;
+      glm::uvec2                      dimension;
+      std::vector<std::vector<Entry>> cells;
+
+      TwoDVertexGrid (const TwoDVertices& vertices)
+        : min (Util::maxFloat ())
+      {
+        glm::vec2 max (Util::minFloat ());
+        for (const TwoDVertex& v : vertices)
+        {
+          this->min = glm::min (this->min, v.position);
+          max = glm::max (max, v.position);
+        }
+
+        const glm::vec2    extent = max - this->min;
+        const unsigned int n = (unsigned int) (glm::ceil (glm::sqrt (float(vertices.size ()))));
+
+        this->cellSize = glm::max (Util::epsilon (), glm::max (extent.x, extent.y) / float(n));
+        this->dimension = glm::uvec2 (glm::floor (extent / this->cellSize)) + glm::uvec2 (1);
+        this->cells.resize (this->dimension.x * this->dimension.y);
+
+        for (TwoDVertexCRef v = vertices.begin (); v != vertices.end (); ++v)
+        {
+          const glm::uvec2 c = this->cell (v->position);
+          this->cells[(c.y * this->dimension.x) + c.x].push_back (Entry{v, v->id});
+        }
+      }
+
+      glm::uvec2 cell (const glm::vec2& p) const
+      {
+        const glm::vec2 c = glm::floor ((p - this->min) / this->cellSize);
+
+        return glm::min (glm::uvec2 (glm::max (c, glm::vec2 (0.0f))), this->dimension - 1u);
+      }
+
+      // checks whether the predicate holds for an entry in a box
+      bool any (const glm::vec2& boxMin, const glm::vec2& boxMax,
+                const std::function<bool(const Entry&)>& f) const
+      {
+        const glm::uvec2 cMin = this->cell (boxMin);
+        const glm::uvec2 cMax = this->cell (boxMax);
+
+        for (unsigned int y = cMin.y; y <= cMax.y; y++)
+        {
+          for (unsigned int x = cMin.x; x <= cMax.x; x++)
+          {
+            for (const Entry& e : this->cells[(y * this->dimension.x) + x])
+            {
+              if (f (e))
+              {
+                return true;
+              }
+            }
+          }
+        }
+        return false;
+      }
+    };
+
     struct TwoDPolyline;
     typedef std::vector<TwoDPolyline> TwoDPolylines;
 
@@ -237,25 +313,20 @@ namespace
         }
       }
 
-      void setIsEar (TwoDVertexRef v) const
+      void setIsEar (TwoDVertexRef v, const TwoDVertexGrid& grid,
+                     const std::vector<bool>& isRemoved) const
       {
         if (v->curvature == Curvature::Convex)
         {
           const TwoDVertexCRef p = this->prev (v);
           const TwoDVertexCRef n = this->next (v);
+          const glm::vec2      min = glm::min (glm::min (p->position, v->position), n->position);
+          const glm::vec2      max = glm::max (glm::max (p->position, v->position), n->position);
 
-          for (TwoDVertexCRef it = this->begin (); it != this->end (); ++it)
-          {
-            if (it != p && it != v && it != n)
-            {
-              if (it->isInsideTriangle (p->position, v->position, n->position))
-              {
-                v->isEar = false;
-                return;
-              }
-            }
-          }
-          v->isEar = true;
+          v->isEar = grid.any (min, max, [&](const TwoDVertexGrid::Entry& e) {
+            return isRemoved[e.id] == false && e.vertex != p && e.vertex != v && e.vertex != n &&
+                   e.vertex->isInsideTriangle (p->position, v->position, n->position);
+          }) == false;
         }
         else
         {
@@ -309,29 +380,11 @@ namespace
 
         for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
         {
-          this->setIsEar (v);
           this->setAngle (v);
         }
       }
 
-      void removeEar (TwoDVertexRef v)
-      {
-        assert (v->isEar);
-        assert (this->size () > 3);
-
-        TwoDVertexRef p = this->prev (v);
-        TwoDVertexRef n = this->next (v);
-
-        this->vertices.erase (v);
-        this->setCurvature (p);
-        this->setCurvature (n);
-        this->setIsEar (p);
-        this->setIsEar (n);
-        this->setAngle (p);
-        this->setAngle (n);
-      }
-
-      bool updateEarCandidate (TwoDVertexCRef v, float& weight) const
+      float earWeight (TwoDVertexCRef v) const
       {
         assert (v->isEar);
 
@@ -340,55 +393,94 @@ namespace
 
         if (nearPrev || nearNext)
         {
-          weight = Util::minFloat ();
-          return true;
+          return Util::minFloat ();
         }
         else
         {
           const float bestAngle = glm::cos (glm::radians (60.0f));
-          const float w = glm::abs (v->angle - bestAngle);
-
-          if (w < weight)
-          {
-            weight = w;
-            return true;
-          }
-          else
-          {
-            return false;
-          }
+          return glm::abs (v->angle - bestAngle);
         }
       }
 
+      /* Ears are clipped in the order of their weights.  Candidates are kept in a heap, whose
+       * entries are outdated if their vertex changed since, and ears are tested against the
+       * vertices near them, hence filling takes O(n log n) for evenly spread vertices.
+       */
       bool fillHole (DynamicMesh& mesh)
       {
         const auto addFace = [&mesh](TwoDVertexCRef a, TwoDVertexCRef b, TwoDVertexCRef c) {
           mesh.addFace (a->index, b->index, c->index);
         };
 
-        while (this->size () > 3)
+        struct Candidate
         {
-          TwoDVertexRef earCandidate = this->end ();
-          float         weight = Util::maxFloat ();
+          float         weight;
+          unsigned int  version;
+          TwoDVertexRef vertex;
 
-          for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
+          bool operator< (const Candidate& o) const
           {
-            if (v->isEar && updateEarCandidate (v, weight))
-            {
-              earCandidate = v;
-            }
+            return this->weight > o.weight ||
+                   (this->weight == o.weight && this->vertex->id < o.vertex->id);
+          }
+        };
+
+        unsigned int numIds = 0;
+        for (TwoDVertex& v : this->vertices)
+        {
+          v.id = numIds++;
+        }
+
+        const TwoDVertexGrid           grid (this->vertices);
+        std::vector<bool>              isRemoved (numIds, false);
+        std::vector<unsigned int>      versions (numIds, 0);
+        std::priority_queue<Candidate> candidates;
+
+        const auto update = [this, &grid, &isRemoved, &versions, &candidates](TwoDVertexRef v) {
+          this->setIsEar (v, grid, isRemoved);
+          versions[v->id]++;
+
+          if (v->isEar)
+          {
+            candidates.push (Candidate{this->earWeight (v), versions[v->id], v});
           }
+        };
+
+        for (TwoDVertexRef v = this->begin (); v != this->end (); ++v)
+        {
+          update (v);
+        }
 
-          if (earCandidate != this->end ())
+        while (this->size () > 3)
+        {
+          while (candidates.empty () == false &&
+                 (isRemoved[candidates.top ().vertex->id] ||
+                  candidates.top ().version != versions[candidates.top ().vertex->id]))
           {
-            addFace (this->prev (earCandidate), earCandidate, this->next (earCandidate));
-            this->removeEar (earCandidate);
+            candidates.pop ();
           }
-          else
+
+          if (candidates.empty ())
           {
             DILAY_WARN ("Could not find ear candidate");
             return false;
           }
+
+          const TwoDVertexRef ear = candidates.top ().vertex;
+          const TwoDVertexRef p = this->prev (ear);
+          const TwoDVertexRef n = this->next (ear);
+          candidates.pop ();
+
+          addFace (p, ear, n);
+          isRemoved[ear->id] = true;
+          this->vertices.erase (ear);
+
+          this->setCurvature (p);
+          this->setCurvature (n);
+          this->setAngle (p);
+          this->setAngle (n);
+          update (p);
+          update (n);
         }
         assert (this->size () == 3);
         addFace (this->vertices.begin (), std::next (this->vertices.begin (), 1),
@@ -503,6 +595,155 @@ namespace
         }
       }
 
+      /* Squares are inside if their centers are contained in an odd number of polylines.  The
+       * edges of the polylines are sorted into the rows they cross.  Within a row, an edge adds
+       * to the winding numbers of all squares up to some column, which is found by a binary
+       * search, hence each row is classified in time linear in its squares and crossings.
+       */
+      void setInside (const TwoDPolylines& ps, const glm::vec2& min, float width)
+      {
+        struct Crossing
+        {
+          glm::vec2    from;
+          glm::vec2    to;
+          unsigned int polyline;
+        };
+        std::vector<std::vector<Crossing>> rows (this->dimension.y);
+
+        const auto rowY = [&min, width](unsigned int y) { return min.y + (float(y) * width); };
+
+        for (unsigned int i = 0; i < ps.size (); i++)
+        {
+          for (TwoDVertexCRef v = ps[i].begin (); v != ps[i].end (); ++v)
+          {
+            const glm::vec2& from = v->position;
+            const glm::vec2& to = ps[i].next (v)->position;
+            const float      low = glm::min (from.y, to.y);
+            const float      high = glm::max (from.y, to.y);
+            const float      first = glm::floor ((low - min.y) / width);
+
+            for (unsigned int y = first > 0.0f ? (unsigned int) (first) : 0;
+                 y < this->dimension.y && rowY (y) < high; y++)
+            {
+              if (low <= rowY (y))
+              {
+                rows[y].push_back (Crossing{from, to, i});
+              }
+            }
+          }
+        }
+
+        Parallel::forEach (this->dimension.y, [this, &ps, &rows, &min, width](unsigned int y) {
+          const glm::vec2          row (min.x, min.y + (float(y) * width));
+          std::vector<int>         windings ((this->dimension.x + 1) * ps.size (), 0);
+          std::vector<unsigned int> numContains (this->dimension.x, 0);
+
+          const auto columnX = [&min, width](unsigned int x) {
+            return min.x + (float(x) * width);
+          };
+
+          for (const Crossing& c : rows[y])
+          {
+            const bool upwards = c.from.y <= row.y && row.y < c.to.y;
+            const auto counts = [&c, &row, upwards, &columnX](unsigned int x) {
+              const glm::vec2 pos (columnX (x), row.y);
+              return upwards ? isLeft (pos, c.from, c.to) : isRight (pos, c.from, c.to);
+            };
+
+            // squares left of the edge are counted
+            unsigned int lower = 0;
+            unsigned int upper = this->dimension.x;
+            while (lower < upper)
+            {
+              const unsigned int middle = (lower + upper) / 2;
+
+              if (counts (middle))
+              {
+                lower = middle + 1;
+              }
+              else
+              {
+                upper = middle;
+              }
+            }
+            int* w = &windings[c.polyline * (this->dimension.x + 1)];
+            w[0] += upwards ? 1 : -1;
+            w[lower] -= upwards ? 1 : -1;
+          }
+
+          for (unsigned int i = 0; i < ps.size (); i++)
+          {
+            const int* w = &windings[i * (this->dimension.x + 1)];
+            int        windingNumber = 0;
+
+            for (unsigned int x = 0; x < this->dimension.x; x++)
+            {
+              windingNumber += w[x];
+              if (windingNumber != 0)
+              {
+                numContains[x]++;
+              }
+            }
+          }
+
+          for (unsigned int x = 0; x < this->dimension.x; x++)
+          {
+            TwoDSquare& square = this->squares[this->index (x, y)];
+
+            if (numContains[x] % 2 == 1)
+            {
+              square.state = TwoDSquare::State::Inside;
+            }
+            assert (y > 0 || square.state == TwoDSquare::State::Outside);
+            assert (y < this->dimension.y - 1 || square.state == TwoDSquare::State::Outside);
+            assert (x > 0 || square.state == TwoDSquare::State::Outside);
+            assert (x < this->dimension.x - 1 || square.state == TwoDSquare::State::Outside);
+          }
+        });
+      }
+
+      // inside squares that intersect a polyline are outside
+      void clip (const TwoDPolylines& ps, const glm::vec2& min, float width)
+      {
+        const auto firstCell = [width](float v, float m, unsigned int n) {
+          const float c = glm::floor ((v - m) / width - 0.5f);
+          return c > 0.0f ? glm::min ((unsigned int) (c), n - 1) : 0u;
+        };
+        const auto lastCell = [width](float v, float m, unsigned int n) {
+          const float c = glm::ceil ((v - m) / width + 0.5f);
+          return c > 0.0f ? glm::min ((unsigned int) (c), n - 1) : 0u;
+        };
+
+        for (const TwoDPolyline& p : ps)
+        {
+          for (TwoDVertexCRef v = p.begin (); v != p.end (); ++v)
+          {
+            const glm::vec2& from = v->position;
+            const glm::vec2& to = p.next (v)->position;
+            const glm::vec2  low = glm::min (from, to);
+            const glm::vec2  high = glm::max (from, to);
+
+            for (unsigned int y = glm::max (1u, firstCell (low.y, min.y, this->dimension.y));
+                 y <= glm::min (this->dimension.y - 2, lastCell (high.y, min.y, this->dimension.y));
+                 y++)
+            {
+              for (unsigned int x = glm::max (1u, firstCell (low.x, min.x, this->dimension.x));
+                   x <=
+                   glm::min (this->dimension.x - 2, lastCell (high.x, min.x, this->dimension.x));
+                   x++)
+              {
+                TwoDSquare& square = this->squares[this->index (x, y)];
+
+                if (square.state == TwoDSquare::State::Inside && square.intersects (from, to))
+                {
+                  square.state = TwoDSquare::State::Outside;
+                }
+              }
+            }
+          }
+        }
+      }
+
       TwoDGrid (const ToolTrimMeshBorder& trimBorder, TwoDPolylines& ps)
       {
         constexpr TwoDSquare::State border = TwoDSquare::State::Border;
@@ -545,45 +786,11 @@ namespace
           {
             const glm::vec2 pos = min + (glm::vec2 (float(x), float(y)) * avgLength);
             this->squares.emplace_back (glm::uvec2 (x, y), pos, avgLength);
-            TwoDSquare& square = this->squares.back ();
-
-            unsigned int numContains = 0;
-            for (const TwoDPolyline& p : ps)
-            {
-              if (p.contains (pos))
-              {
-                numContains++;
-              }
-            }
-
-            if (numContains % 2 == 1)
-            {
-              square.state = inside;
-            }
-            assert (y > 0 || square.state == outside);
-            assert (y < this->dimension.y - 1 || square.state == outside);
-            assert (x > 0 || square.state == outside);
-            assert (x < this->dimension.x - 1 || square.state == outside);
-          }
-        }
-        for (unsigned int y = 1; y < this->dimension.y - 1; y++)
-        {
-          for (unsigned int x = 1; x < this->dimension.x - 1; x++)
-          {
-            TwoDSquare& square = this->squares[this->index (x, y)];
-            if (square.state == inside)
-            {
-              for (const TwoDPolyline& p : ps)
-              {
-                if (p.intersects (square))
-                {
-                  square.state = outside;
-                  break;
-                }
-              }
-            }
           }
         }
+        this->setInside (ps, min, avgLength);
+        this->clip (ps, min, avgLength);
+
         for (unsigned int y = 1; y < this->dimension.y - 1; y++)
         {
           for (unsigned int x = 1; x < this->dimension.x - 1; x++)
@@ -1080,10 +1287,8 @@ namespace
 
   void trimVertices (const ToolTrimMeshBorder& border)
   {
-    const auto isAboveBorder = [&border](unsigned int i) {
-      const glm::vec3& p = border.mesh ().vertex (i);
-      return border.onBorder (p) == false && border.plane ().distance (p) > 0.0f;
-    };
+    // vertices are classified by `ToolTrimMeshSplitMesh::splitMesh`
+    const auto isAboveBorder = [&border](unsigned int i) { return border.isAboveBorder (i); };
 
     std::unordered_set<unsigned int> set;
     const auto addAdjacentAboveBorder = [&border, &isAboveBorder, &set](unsigned int i) {
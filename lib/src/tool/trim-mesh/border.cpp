@@ -2,7 +2,9 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include "dynamic/mesh.hpp"
 #include "intersection.hpp"
+#include "parallel.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "tool/trim-mesh/border.hpp"
@@ -14,19 +16,32 @@ namespace
   typedef ToolTrimMeshBorder::Polylines Polylines;
 }
 
+/* The border is tested for many points, hence its tests are precomputed: a point on the border is
+ * within a slab around the plane, which is rejected early, and the sides of the edges are tested
+ * against the normals of their half-planes.  The plane contains the first edge and is parallel
+ * to the second one, so the slab's width also covers points close to the second edge.
+ */
 struct ToolTrimMeshBorder::Impl
 {
-  DynamicMesh&    mesh;
-  Polylines       polylines;
-  const PrimRay   edge1;
-  const PrimRay   edge2;
-  const PrimPlane plane;
+  DynamicMesh&      mesh;
+  Polylines         polylines;
+  const PrimRay     edge1;
+  const PrimRay     edge2;
+  const PrimPlane   plane;
+  const float       slabWidth;
+  glm::vec3         edgeOrigins[2];
+  glm::vec3         edgeNormals[2];
+  std::vector<char> isAbove;
 
   Impl (DynamicMesh& m, const PrimRay& r1, const PrimRay& r2)
     : mesh (m)
     , edge1 (r1)
     , edge2 (r2)
     , plane (r1.origin (), glm::cross (r2.direction (), r1.direction ()))
+    , slabWidth (Util::epsilon () + this->plane.absDistance (r2.origin ()))
+    , edgeOrigins{r1.origin (), r2.origin ()}
+    , edgeNormals{glm::cross (r1.direction (), this->plane.normal ()),
+                  glm::cross (this->plane.normal (), r2.direction ())}
   {
   }
 
@@ -43,6 +58,8 @@ struct ToolTrimMeshBorder::Impl
 
   void setNewIndices (const std::vector<unsigned int>& newIndices)
   {
+    this->isAbove.clear ();
+
     for (Polyline& p : this->polylines)
     {
       for (unsigned int& i : p)
@@ -58,17 +75,22 @@ struct ToolTrimMeshBorder::Impl
   {
     // assert (this->plane.onPlane (p)); // Occasionally fails due to rounding errors (?)
 
-    const bool c1 = 0.0f < glm::dot (this->plane.normal (), glm::cross (p - this->edge1.origin (),
-                                                                        this->edge1.direction ()));
-
-    const bool c2 = 0.0f < glm::dot (this->plane.normal (), glm::cross (this->edge2.direction (),
-                                                                        p - this->edge2.origin ()));
-    return c1 && c2;
+    return 0.0f < glm::dot (p - this->edgeOrigins[0], this->edgeNormals[0]) &&
+           0.0f < glm::dot (p - this->edgeOrigins[1], this->edgeNormals[1]);
   }
 
   bool onBorder (const glm::vec3& p) const
   {
-    if (this->edge1.onRay (p))
+    return this->onBorder (p, this->plane.distance (p));
+  }
+
+  bool onBorder (const glm::vec3& p, float distance) const
+  {
+    if (glm::abs (distance) >= this->slabWidth)
+    {
+      return false;
+    }
+    else if (this->edge1.onRay (p))
     {
       return true;
     }
@@ -76,7 +98,7 @@ struct ToolTrimMeshBorder::Impl
     {
       return true;
     }
-    else if (this->plane.onPlane (p))
+    else if (glm::abs (distance) < Util::epsilon ())
     {
       return this->isValidProjection (p);
     }
@@ -98,6 +120,31 @@ struct ToolTrimMeshBorder::Impl
     }
   }
 
+  void classifyVertices ()
+  {
+    std::vector<unsigned int> indices;
+    unsigned int              numIndices = 0;
+
+    this->mesh.forEachVertex ([&indices, &numIndices](unsigned int i) {
+      indices.push_back (i);
+      numIndices = glm::max (numIndices, i + 1);
+    });
+
+    this->isAbove.assign (numIndices, false);
+    Parallel::forEach (indices.size (), [this, &indices](unsigned int i) {
+      const glm::vec3& p = this->mesh.vertex (indices[i]);
+      const float      distance = this->plane.distance (p);
+
+      this->isAbove[indices[i]] = distance > 0.0f && this->onBorder (p, distance) == false;
+    });
+  }
+
+  bool isAboveBorder (unsigned int i) const
+  {
+    assert (i < this->isAbove.size ());
+    return this->isAbove[i];
+  }
+
   void deleteEmptyPolylines ()
   {
     this->polylines.erase (std::remove_if (this->polylines.begin (), this->polylines.end (),
@@ -127,5 +174,7 @@ DELEGATE (void, ToolTrimMeshBorder, addPolyline)
 DELEGATE1 (void, ToolTrimMeshBorder, setNewIndices, const std::vector<unsigned int>&)
 DELEGATE1_CONST (bool, ToolTrimMeshBorder, onBorder, const glm::vec3&)
 DELEGATE2_CONST (bool, ToolTrimMeshBorder, intersects, const PrimRay&, float&)
+DELEGATE (void, ToolTrimMeshBorder, classifyVertices)
+DELEGATE1_CONST (bool, ToolTrimMeshBorder, isAboveBorder, unsigned int)
 DELEGATE (void, ToolTrimMeshBorder, deleteEmptyPolylines)
 DELEGATE_CONST (bool, ToolTrimMeshBorder, hasVertices)
@@ -29,6 +29,10 @@ public:
   void             setNewIndices (const std::vector<unsigned int>&);
   bool             onBorder (const glm::vec3&) const;
   bool             intersects (const PrimRay&, float&) const;
+  // classifies all vertices of the mesh in parallel, which is invalidated by `setNewIndices`
+  void             classifyVertices ();
+  // whether a classified vertex is neither on the border nor below its plane
+  bool             isAboveBorder (unsigned int) const;
   void             deleteEmptyPolylines ();
   bool             hasVertices () const;
 
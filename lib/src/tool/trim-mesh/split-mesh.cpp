@@ -2,10 +2,13 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
 #include <unordered_set>
+#include <vector>
 #include "dynamic/faces.hpp"
 #include "dynamic/mesh.hpp"
 #include "hash.hpp"
+#include "parallel.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "tool/trim-mesh/border.hpp"
@@ -35,47 +38,48 @@ namespace
     return newI;
   }
 
-  unsigned int splitEdge (const ToolTrimMeshBorder& border, unsigned int e1, unsigned int e2,
-
-                          BorderVertices& borderVertices)
+  // how an edge relates to the border, which only depends on the positions of its vertices
+  struct EdgeClassification
   {
-    const glm::vec3 v1 (border.mesh ().vertex (e1));
-    const glm::vec3 v2 (border.mesh ().vertex (e2));
-    const PrimRay   line (v1, v2 - v1);
-
-    bool checkIntersection = true;
+    bool  v1OnBorder;
+    bool  v2OnBorder;
+    float t;
 
-    if (border.onBorder (v1))
+    bool isSplit () const
     {
-      borderVertices.insert (e1);
-      checkIntersection = false;
+      return this->v1OnBorder == false && this->v2OnBorder == false &&
+             this->t != Util::maxFloat ();
     }
+  };
 
-    if (border.onBorder (v2))
-    {
-      borderVertices.insert (e2);
-      checkIntersection = false;
-    }
+  EdgeClassification classifyEdge (const ToolTrimMeshBorder& border, const EdgeKey& e)
+  {
+    const glm::vec3 v1 (border.mesh ().vertex (e.vertex1 ()));
+    const glm::vec3 v2 (border.mesh ().vertex (e.vertex2 ()));
+
+    EdgeClassification c{border.onBorder (v1), border.onBorder (v2), Util::maxFloat ()};
 
-    if (checkIntersection)
+    if (c.v1OnBorder == false && c.v2OnBorder == false)
     {
       float t;
-      if (border.intersects (line, t) && t > 0.0f && t < glm::distance (v1, v2))
+      if (border.intersects (PrimRay (v1, v2 - v1), t) && t > 0.0f && t < glm::distance (v1, v2))
       {
-        const unsigned int i = splitEdge (border.mesh (), e1, e2, line.pointAt (t));
-        borderVertices.insert (i);
-        return i;
+        c.t = t;
       }
     }
-    return Util::invalidIndex ();
+    return c;
   }
 
+  /* Edges are classified in parallel.  Splitting an edge neither moves vertices nor removes
+   * other edges, so the classifications stay valid while the edges are split one by one.
+   */
   void splitMesh (const ToolTrimMeshBorder& border, BorderVertices& borderVertices)
   {
     DynamicFaces faces;
     border.mesh ().intersects (border.plane (), faces);
 
-    std::unordered_set<ui_pair> edges;
+    std::vector<EdgeKey>            edges;
+    std::vector<EdgeClassification> classifications;
     while (faces.isEmpty () == false)
     {
       edges.clear ();
@@ -84,16 +88,39 @@ namespace
         unsigned int i1, i2, i3;
         border.mesh ().vertexIndices (f, i1, i2, i3);
 
-        edges.emplace (glm::min (i1, i2), glm::max (i1, i2));
-        edges.emplace (glm::min (i1, i3), glm::max (i1, i3));
-        edges.emplace (glm::min (i2, i3), glm::max (i2, i3));
+        edges.emplace_back (i1, i2);
+        edges.emplace_back (i1, i3);
+        edges.emplace_back (i2, i3);
       }
+      std::sort (edges.begin (), edges.end ());
+      edges.erase (std::unique (edges.begin (), edges.end ()), edges.end ());
+
+      classifications.resize (edges.size ());
+      Parallel::forEach (edges.size (), [&border, &edges, &classifications](unsigned int i) {
+        classifications[i] = classifyEdge (border, edges[i]);
+      });
 
-      for (const auto e : edges)
+      for (unsigned int i = 0; i < edges.size (); i++)
       {
-        const unsigned int newI = splitEdge (border, e.first, e.second, borderVertices);
-        if (newI != Util::invalidIndex ())
+        const EdgeKey&            e = edges[i];
+        const EdgeClassification& c = classifications[i];
+
+        if (c.v1OnBorder)
+        {
+          borderVertices.insert (e.vertex1 ());
+        }
+        if (c.v2OnBorder)
         {
+          borderVertices.insert (e.vertex2 ());
+        }
+        if (c.isSplit ())
+        {
+          const glm::vec3    v1 (border.mesh ().vertex (e.vertex1 ()));
+          const glm::vec3    v2 (border.mesh ().vertex (e.vertex2 ()));
+          const unsigned int newI = splitEdge (border.mesh (), e.vertex1 (), e.vertex2 (),
+                                               PrimRay (v1, v2 - v1).pointAt (c.t));
+
+          borderVertices.insert (newI);
           for (unsigned int a : border.mesh ().adjacentFaces (newI))
           {
             faces.insert (a);
@@ -131,8 +158,7 @@ namespace
     unsigned int leftFace, leftVertex, rightFace, rightVertex;
     border.mesh ().findAdjacent (e1, e2, leftFace, leftVertex, rightFace, rightVertex);
 
-    const glm::vec3& vL = border.mesh ().vertex (leftVertex);
-    return border.onBorder (vL) ? false : border.plane ().distance (vL) > 0.0f;
+    return border.isAboveBorder (leftVertex);
   }
 
   void addPolylinesToBorder (ToolTrimMeshBorder& border, BorderVertices& borderVertices)
@@ -189,6 +215,7 @@ bool ToolTrimMeshSplitMesh::splitMesh (ToolTrimMeshBorder& border)
   }
   else if (checkBorderVertices (border.mesh (), borderVertices))
   {
+    border.classifyVertices ();
     addPolylinesToBorder (border, borderVertices);
     return true;
   }
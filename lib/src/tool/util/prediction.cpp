@@ -0,0 +1,99 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <glm/glm.hpp>
+#include <vector>
+#include "tool/util/prediction.hpp"
+#include "view/pointing-event.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  // velocities are averaged over the most recent samples
+  constexpr unsigned int maxNumSamples = 4;
+  // samples are dropped if the pointer has paused for longer (in milliseconds)
+  constexpr unsigned long maxGap = 100;
+  // leads are clamped to keep predictions close to the pointer (in milliseconds)
+  constexpr float maxLead = 50.0f;
+
+  struct Sample
+  {
+    glm::vec2     position;
+    unsigned long time;
+  };
+}
+
+struct ToolUtilPrediction::Impl
+{
+  float               lead;
+  std::vector<Sample> samples;
+  glm::ivec2          position;
+  Clock::time_point   received;
+
+  Impl ()
+    : lead (0.0f)
+    , position (0)
+  {
+  }
+
+  void add (const ViewPointingEvent& e)
+  {
+    this->position = e.position ();
+    this->received = Clock::now ();
+
+    const Sample sample{glm::vec2 (e.position ()), e.time ()};
+
+    if (e.moveEvent () == false || this->samples.empty () ||
+        sample.time < this->samples.back ().time ||
+        sample.time - this->samples.back ().time > maxGap)
+    {
+      this->samples.clear ();
+    }
+    // events of equal time stamps are coalesced
+    else if (sample.time == this->samples.back ().time)
+    {
+      this->samples.pop_back ();
+    }
+    else if (this->samples.size () == maxNumSamples)
+    {
+      this->samples.erase (this->samples.begin ());
+    }
+    this->samples.push_back (sample);
+  }
+
+  void reset () { this->samples.clear (); }
+
+  bool predict (glm::ivec2& predicted) const
+  {
+    if (this->lead <= 0.0f || this->samples.size () < 2)
+    {
+      return false;
+    }
+
+    const Sample& first = this->samples.front ();
+    const Sample& last = this->samples.back ();
+    const float   elapsed =
+      std::chrono::duration<float, std::milli> (Clock::now () - this->received).count ();
+    const float ahead = glm::min (this->lead, maxLead) - elapsed;
+
+    if (ahead <= 0.0f)
+    {
+      return false;
+    }
+
+    const glm::vec2 velocity = (last.position - first.position) / float(last.time - first.time);
+
+    predicted = glm::ivec2 (glm::round (last.position + (velocity * ahead)));
+    return predicted != this->position;
+  }
+};
+
+DELEGATE_BIG3 (ToolUtilPrediction)
+SETTER (float, ToolUtilPrediction, lead)
+DELEGATE1 (void, ToolUtilPrediction, add, const ViewPointingEvent&)
+DELEGATE (void, ToolUtilPrediction, reset)
+GETTER_CONST (const glm::ivec2&, ToolUtilPrediction, position)
+DELEGATE1_CONST (bool, ToolUtilPrediction, predict, glm::ivec2&)
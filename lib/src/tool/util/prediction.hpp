@@ -0,0 +1,37 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_PREDICTION
+#define DILAY_TOOL_UTIL_PREDICTION
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class ViewPointingEvent;
+
+/* Predicts the position of the pointer by the velocity of its recent move events, which hides
+ * the latency between an event and the frame that displays it.  Predictions expire once the
+ * pointer has not moved for longer than the lead, i.e., a resting pointer is not overshot.
+ */
+class ToolUtilPrediction
+{
+public:
+  DECLARE_BIG3 (ToolUtilPrediction)
+
+  // the time to predict ahead in milliseconds, where 0 disables predictions
+  void lead (float);
+  void add (const ViewPointingEvent&);
+  void reset ();
+
+  // the position of the most recent event
+  const glm::ivec2& position () const;
+
+  // returns false if there is no prediction ahead of `position ()`
+  bool predict (glm::ivec2&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -9,10 +9,12 @@
 #include "tool/move-camera.hpp"
 #include "tool/sculpt.hpp"
 
-DECLARE_TOOL (TransformMesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
-                               DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT)
+DECLARE_TOOL (TransformMesh,
+              DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
+                DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT)
 
-DECLARE_TOOL (DeleteMesh, DECLARE_TOOL_RUN_RELEASE_EVENT)
+DECLARE_TOOL (DeleteMesh,
+              DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT)
 
 DECLARE_TOOL (NewMesh, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_COMMIT)
 
@@ -23,13 +25,15 @@ DECLARE_TOOL_SCULPT (SculptFlatten)
 DECLARE_TOOL_SCULPT (SculptCrease)
 DECLARE_TOOL_SCULPT (SculptPinch)
 DECLARE_TOOL_SCULPT (SculptReduce)
+DECLARE_TOOL_SCULPT (SculptFreeze)
 
 DECLARE_TOOL (EditSketch, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
                             DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL (DeleteSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
 
-DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
+DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_PREPARE_RENDER DECLARE_TOOL_RUN_RENDER
+                               DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT)
 
 DECLARE_TOOL (SketchSpheres,
               DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
@@ -40,7 +44,12 @@ DECLARE_TOOL (TrimMesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_RELEASE_EVE
                           DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL (Remesh,
-              DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
-                DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
+              DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
+                DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT
+                  DECLARE_TOOL_RUN_FROM_CONFIG)
+
+DECLARE_TOOL (DecimateMesh, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT
+                              DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT
+                                DECLARE_TOOL_RUN_FROM_CONFIG)
 
 #endif
@@ -6,6 +6,7 @@
 #define DILAY_TREE
 
 #include <list>
+#include <vector>
 #include "maybe.hpp"
 #include "util.hpp"
 
@@ -215,4 +216,136 @@ private:
   Maybe<TreeNode<T>> _root;
 };
 
+/* A tree whose nodes are stored contiguously in depth-first order and refer to each other by
+ * indices.  Copies are copies of a single array and traversals are linear, hence flat trees are
+ * used for trees that are stored rather than edited, e.g. in snapshots.
+ */
+template <typename T> class FlatTree
+{
+public:
+  FlatTree () {}
+
+  explicit FlatTree (const Tree<T>& tree)
+  {
+    if (tree.hasRoot ())
+    {
+      this->add (tree.root (), Util::invalidIndex ());
+    }
+  }
+
+  bool hasRoot () const { return this->_nodes.empty () == false; }
+
+  unsigned int numNodes () const { return this->_nodes.size (); }
+
+  const T& data (unsigned int i) const { return this->_nodes[i].data; }
+
+  // the root's parent is `Util::invalidIndex ()`
+  unsigned int parent (unsigned int i) const { return this->_nodes[i].parent; }
+
+  void forEachConstNode (const std::function<void(unsigned int)>& f) const
+  {
+    for (unsigned int i = 0; i < this->_nodes.size (); i++)
+    {
+      f (i);
+    }
+  }
+
+  void forEachConstChild (unsigned int i, const std::function<void(unsigned int)>& f) const
+  {
+    for (unsigned int c = this->_nodes[i].firstChild; c != Util::invalidIndex ();
+         c = this->_nodes[c].nextSibling)
+    {
+      f (c);
+    }
+  }
+
+  // like `Tree::rebalance`, former parents become last children
+  void rebalance (unsigned int i)
+  {
+    FlatTree<T> rebalanced;
+    rebalanced.addRebalanced (*this, i, Util::invalidIndex (), Util::invalidIndex ());
+    this->_nodes = std::move (rebalanced._nodes);
+  }
+
+  Tree<T> toTree () const
+  {
+    Tree<T> tree;
+
+    if (this->hasRoot ())
+    {
+      this->addChildren (0, tree.emplaceRoot (this->data (0)));
+    }
+    return tree;
+  }
+
+private:
+  struct Node
+  {
+    T            data;
+    unsigned int parent;
+    unsigned int firstChild;
+    unsigned int nextSibling;
+  };
+
+  unsigned int push (const T& data, unsigned int parent)
+  {
+    const unsigned int i = this->_nodes.size ();
+
+    this->_nodes.push_back (Node{data, parent, Util::invalidIndex (), Util::invalidIndex ()});
+    return i;
+  }
+
+  void link (unsigned int parent, unsigned int& lastChild, unsigned int child)
+  {
+    if (lastChild == Util::invalidIndex ())
+    {
+      this->_nodes[parent].firstChild = child;
+    }
+    else
+    {
+      this->_nodes[lastChild].nextSibling = child;
+    }
+    lastChild = child;
+  }
+
+  unsigned int add (const TreeNode<T>& node, unsigned int parent)
+  {
+    const unsigned int i = this->push (node.data (), parent);
+    unsigned int       lastChild = Util::invalidIndex ();
+
+    node.forEachConstChild ([this, i, &lastChild](const TreeNode<T>& c) {
+      this->link (i, lastChild, this->add (c, i));
+    });
+    return i;
+  }
+
+  unsigned int addRebalanced (const FlatTree<T>& tree, unsigned int node, unsigned int from,
+                              unsigned int parent)
+  {
+    const unsigned int i = this->push (tree.data (node), parent);
+    unsigned int       lastChild = Util::invalidIndex ();
+
+    tree.forEachConstChild (node, [this, &tree, node, from, i, &lastChild](unsigned int c) {
+      if (c != from)
+      {
+        this->link (i, lastChild, this->addRebalanced (tree, c, node, i));
+      }
+    });
+    if (tree.parent (node) != Util::invalidIndex () && tree.parent (node) != from)
+    {
+      this->link (i, lastChild, this->addRebalanced (tree, tree.parent (node), node, i));
+    }
+    return i;
+  }
+
+  void addChildren (unsigned int i, TreeNode<T>& node) const
+  {
+    this->forEachConstChild (i, [this, &node](unsigned int c) {
+      this->addChildren (c, node.emplaceChild (this->data (c)));
+    });
+  }
+
+  std::vector<Node> _nodes;
+};
+
 #endif
@@ -2,6 +2,7 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cstdio>
 #include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/epsilon.hpp>
@@ -9,6 +10,16 @@
 #include <vector>
 #include "util.hpp"
 
+#if defined(__linux__)
+#include <malloc.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
 namespace
 {
   template <typename T> bool colinearUnitT (const T& v1, const T& v2)
@@ -16,6 +27,17 @@ namespace
     return Util::almostEqual (glm::abs (glm::dot (v1, v2)), 1.0f);
   }
 
+  uint64_t spreadBits (uint64_t x)
+  {
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+  }
+
   template <typename T> bool colinearT (const T& v1, const T& v2)
   {
     return colinearUnitT<T> (glm::normalize (v1), glm::normalize (v2));
@@ -126,6 +148,51 @@ std::string Util::readFile (const std::string& filePath)
   return content;
 }
 
+std::size_t Util::residentMemory ()
+{
+#if defined(__linux__)
+  std::ifstream stream ("/proc/self/status", std::ios::in);
+  std::string   line;
+  unsigned long kiB;
+
+  while (std::getline (stream, line))
+  {
+    if (std::sscanf (line.c_str (), "VmRSS: %lu kB", &kiB) == 1)
+    {
+      return std::size_t (kiB) * 1024;
+    }
+  }
+  return 0;
+#elif defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (GetProcessMemoryInfo (GetCurrentProcess (), &counters, sizeof (counters)))
+  {
+    return std::size_t (counters.WorkingSetSize);
+  }
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+
+  if (task_info (mach_task_self (), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) ==
+      KERN_SUCCESS)
+  {
+    return std::size_t (info.resident_size);
+  }
+  return 0;
+#else
+  return 0;
+#endif
+}
+
+void Util::releaseFreeMemory ()
+{
+#if defined(__GLIBC__)
+  malloc_trim (0);
+#endif
+}
+
 unsigned int Util::solveQuadraticEq (float a, float b, float c, float& s1, float& s2)
 {
   const float radicand = (b * b) - (4.0f * a * c);
@@ -263,6 +330,11 @@ unsigned int Util::countOnes (unsigned int x)
   return n;
 }
 
+uint64_t Util::mortonCode (unsigned int x, unsigned int y, unsigned int z)
+{
+  return (spreadBits (x) << 2) | (spreadBits (y) << 1) | spreadBits (z);
+}
+
 bool Util::hasSuffix (const std::string& string, const std::string& suffix)
 {
   if (string.size () >= suffix.size ())
@@ -6,6 +6,8 @@
 #define DILAY_UTIL
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <glm/fwd.hpp>
 #include <limits>
@@ -13,8 +15,23 @@
 #include <vector>
 #include "log.hpp"
 
+// messages below this level are compiled out, e.g., `-DDILAY_LOG_LEVEL=1` drops infos
+#ifndef DILAY_LOG_LEVEL
+#define DILAY_LOG_LEVEL 0
+#endif
+
+#if DILAY_LOG_LEVEL > 0
+#define DILAY_INFO(fmt, ...) {}
+#else
 #define DILAY_INFO(fmt, ...) Log::log (Log::Level::Info, __FILE__, __LINE__, fmt, ##__VA_ARGS__);
+#endif
+
+#if DILAY_LOG_LEVEL > 1
+#define DILAY_WARN(fmt, ...) {}
+#else
 #define DILAY_WARN(fmt, ...) Log::log (Log::Level::Warning, __FILE__, __LINE__, fmt, ##__VA_ARGS__);
+#endif
+
 #define DILAY_PANIC(fmt, ...)                                                              \
   {                                                                                        \
     Log::log (Log::Level::Panic, __FILE__, __LINE__, fmt, ##__VA_ARGS__);                  \
@@ -43,6 +60,10 @@ namespace Util
   float        linearStep (const glm::vec3&, const glm::vec3&, float, float);
   float        cross (const glm::vec2&, const glm::vec2&);
   std::string  readFile (const std::string&);
+  // the resident memory of the process in bytes, or 0 if it is unknown
+  std::size_t  residentMemory ();
+  // returns freed memory of the heap to the system if supported
+  void         releaseFreeMemory ();
   unsigned int solveQuadraticEq (float, float, float, float&, float&);
   unsigned int solveCubicEq (float, float, float, float&, float&, float&);
   unsigned int solveCubicEq (float, float, float, float, float&, float&, float&);
@@ -55,6 +76,8 @@ namespace Util
   bool         fromString (const std::string&, unsigned int&);
   bool         fromString (const std::string&, float&);
   unsigned int countOnes (unsigned int);
+  // interleaves the lowest 21 bits of each coordinate (x in the highest position)
+  uint64_t     mortonCode (unsigned int, unsigned int, unsigned int);
   bool         hasSuffix (const std::string&, const std::string&);
 
   constexpr float epsilon () { return 0.0001f; }
@@ -0,0 +1,198 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QDir>
+#include <QStatusBar>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include "config.hpp"
+#include "import-export.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "tool.hpp"
+#include "util.hpp"
+#include "view/background-save.hpp"
+#include "view/gl-widget.hpp"
+#include "view/main-window.hpp"
+#include "view/preview.hpp"
+#include "view/util.hpp"
+
+struct ViewBackgroundSave::Impl
+{
+  ViewMainWindow&    mainWindow;
+  Scene&             scene;
+  QTimer             progressTimer;
+  QTimer             autosaveTimer;
+  QTimer             previewTimer;
+  std::atomic<float> progress;
+  std::string        fileName;
+  bool               isAutosave;
+  bool               isObjFile;
+  std::future<bool>  saving;
+  ViewPreview        preview;
+  unsigned int       previewSize;
+
+  Impl (ViewMainWindow& w, Scene& s)
+    : mainWindow (w)
+    , scene (s)
+    , progress (0.0f)
+    , isAutosave (false)
+    , isObjFile (false)
+    , preview (w.glWidget ())
+    , previewSize (0)
+  {
+    this->progressTimer.setInterval (100);
+    this->previewTimer.setSingleShot (true);
+
+    QObject::connect (&this->progressTimer, &QTimer::timeout, [this]() { this->poll (); });
+    QObject::connect (&this->autosaveTimer, &QTimer::timeout, [this]() { this->autosave (); });
+    QObject::connect (&this->previewTimer, &QTimer::timeout,
+                      [this]() { this->preview.embed (this->fileName, this->previewSize); });
+  }
+
+  // joins without any UI feedback, since the main window is being destroyed
+  ~Impl ()
+  {
+    if (this->isSaving () && this->saving.get () == false)
+    {
+      DILAY_WARN ("could not save to %s", this->fileName.c_str ());
+    }
+  }
+
+  static QString autosavePath () { return QDir::temp ().filePath ("dilay-autosave.dly"); }
+
+  bool isSaving () const { return this->saving.valid (); }
+
+  void start (const std::string& newFileName, bool newIsObjFile, bool newIsAutosave)
+  {
+    this->wait ();
+    this->previewTimer.stop ();
+    this->preview.wait ();
+
+    this->fileName = newFileName;
+    this->isAutosave = newIsAutosave;
+    this->isObjFile = newIsObjFile;
+    this->progress = 0.0f;
+
+    State& state = this->mainWindow.glWidget ().state ();
+    if (state.hasTool ())
+    {
+      state.tool ().synchronize ();
+    }
+    this->scene.loadDeferredMeshes ();
+
+    ImportExport::FrozenScene frozen = ImportExport::freeze (this->scene);
+
+    auto write = [this, newIsObjFile, frozen = std::move (frozen)]() {
+      return ImportExport::toDlyFile (this->fileName, frozen, newIsObjFile,
+                                      [this](float p) { this->progress = p; });
+    };
+    this->saving = std::async (std::launch::async, std::move (write));
+
+    this->progressTimer.start ();
+    this->poll ();
+  }
+
+  void save (bool newIsObjFile)
+  {
+    assert (this->scene.hasFileName ());
+
+    this->start (this->scene.fileName (), newIsObjFile, false);
+  }
+
+  void autosave ()
+  {
+    if (this->isSaving () == false && this->scene.isEmpty () == false)
+    {
+      this->start (autosavePath ().toStdString (), false, true);
+    }
+  }
+
+  void poll ()
+  {
+    assert (this->isSaving ());
+
+    if (this->saving.wait_for (std::chrono::seconds (0)) == std::future_status::ready)
+    {
+      this->finish ();
+    }
+    else
+    {
+      this->mainWindow.statusBar ()->showMessage (
+        QObject::tr ("Saving %1 (%2%)...")
+          .arg (QString::fromStdString (this->fileName))
+          .arg (int (100.0f * this->progress)));
+    }
+  }
+
+  void wait ()
+  {
+    if (this->isSaving ())
+    {
+      this->saving.wait ();
+      this->finish ();
+    }
+  }
+
+  void finish ()
+  {
+    const bool    success = this->saving.get ();
+    const QString name = QString::fromStdString (this->fileName);
+
+    this->progressTimer.stop ();
+
+    if (success)
+    {
+      this->mainWindow.statusBar ()->showMessage (QObject::tr ("Saved %1").arg (name), 5000);
+
+      // previews are rendered once control returns to the event loop
+      if (this->isAutosave == false && this->isObjFile == false &&
+          ImportExport::isMeshFile (this->fileName) == false && this->previewSize > 0)
+      {
+        this->previewTimer.start (0);
+      }
+    }
+    else if (this->isAutosave)
+    {
+      DILAY_WARN ("could not autosave to %s", this->fileName.c_str ());
+      this->mainWindow.statusBar ()->showMessage (
+        QObject::tr ("Could not autosave to %1").arg (name), 5000);
+    }
+    else
+    {
+      if (this->scene.fileName () == this->fileName)
+      {
+        this->scene.fileName ("");
+      }
+      this->mainWindow.statusBar ()->clearMessage ();
+      ViewUtil::error (this->mainWindow, QObject::tr ("Could not save to file."));
+    }
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    const int interval = config.get<int> ("editor/autosave-interval");
+
+    this->previewSize = (unsigned int) std::max (0, config.get<int> ("editor/preview-size"));
+
+    if (interval > 0)
+    {
+      this->autosaveTimer.start (interval * 60 * 1000);
+    }
+    else
+    {
+      this->autosaveTimer.stop ();
+    }
+  }
+};
+
+DELEGATE2_BIG2 (ViewBackgroundSave, ViewMainWindow&, Scene&)
+DELEGATE_STATIC (QString, ViewBackgroundSave, autosavePath)
+DELEGATE_CONST (bool, ViewBackgroundSave, isSaving)
+DELEGATE1 (void, ViewBackgroundSave, save, bool)
+DELEGATE (void, ViewBackgroundSave, wait)
+DELEGATE1 (void, ViewBackgroundSave, runFromConfig, const Config&)
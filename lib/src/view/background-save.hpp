@@ -0,0 +1,37 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_BACKGROUND_SAVE
+#define DILAY_VIEW_BACKGROUND_SAVE
+
+#include <QString>
+#include "configurable.hpp"
+#include "macro.hpp"
+
+class Scene;
+class ViewMainWindow;
+
+/* Writes frozen copies of the scene on a worker thread while the scene remains editable.
+ * Progress is shown in the status bar of the main window.  The scene is also saved periodically
+ * to `autosavePath` if `editor/autosave-interval` is positive.  A preview of the size of
+ * `editor/preview-size` is embedded into binary files after they have been saved.
+ */
+class ViewBackgroundSave : public Configurable
+{
+public:
+  DECLARE_BIG2 (ViewBackgroundSave, ViewMainWindow&, Scene&)
+
+  static QString autosavePath ();
+
+  bool isSaving () const;
+  void save (bool);
+  void wait ();
+
+private:
+  IMPLEMENTATION
+
+  void runFromConfig (const Config&);
+};
+
+#endif
@@ -24,7 +24,8 @@
 
 namespace
 {
-  const std::array<std::string, 1> requireRestart = {"editor/use-geometry-shader"};
+  const std::array<std::string, 2> requireRestart = {"editor/use-geometry-shader",
+                                                     "editor/prefer-core-profile"};
 
   struct DialogData
   {
@@ -188,8 +189,28 @@ namespace
                   QObject::tr ("Step width factor"), Util::epsilon (), 1.0f);
     addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/max-absolute-radius",
                   QObject::tr ("Maximum absolute radius"), Util::epsilon (), 100.0f);
+    addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/coarse-level-factor",
+                  QObject::tr ("Coarse level factor"), Util::epsilon (), 1.0f);
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/highlight-region",
+                 QObject::tr ("Highlight brush region"));
+    addColorButton (data, *gridSculpt, "editor/tool/sculpt/highlight-color",
+                    QObject::tr ("Highlight color"));
+    addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/cursor-prediction",
+                  QObject::tr ("Cursor prediction (ms, 0 disables)"), 0.0f, 50.0f);
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/batch-subdivision",
+                 QObject::tr ("Batch subdivision"));
+    addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/dab-budget",
+                  QObject::tr ("Dab budget (ms)"), 0.0f, 1000.0f);
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/coalesce-events",
+                 QObject::tr ("Coalesce events"));
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/background",
+                 QObject::tr ("Sculpt in background"));
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/separate-stroke-region",
+                 QObject::tr ("Separate stroke region"));
     addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/mirror/render",
                  QObject::tr ("Render mirror"));
+    addBoolEdit (data, *gridSculpt, "editor/tool/sculpt/mirror/combine",
+                 QObject::tr ("Sculpt mirror in one pass"));
     addFloatEdit (data, *gridSculpt, "editor/tool/sculpt/mirror/width",
                   QObject::tr ("Mirror width"), Util::epsilon (), 1.0f);
     addColorButton (data, *gridSculpt, "editor/tool/sculpt/mirror/color",
@@ -213,6 +234,27 @@ namespace
     ViewTwoColumnGrid* grid = new ViewTwoColumnGrid;
 
     addIntEdit (data, *grid, "editor/undo-depth", QObject::tr ("Undo depth"), 1, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/undo-memory", QObject::tr ("Undo memory (MiB)"), 1,
+                Util::maxInt ());
+    addIntEdit (data, *grid, "editor/undo-disk-memory",
+                QObject::tr ("Undo disk memory (MiB, 0 disables)"), 0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/undo-coalesce-time",
+                QObject::tr ("Undo coalescing (ms, 0 disables)"), 0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/memory-budget",
+                QObject::tr ("Memory budget (MiB, 0 disables)"), 0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/autosave-interval",
+                QObject::tr ("Autosave interval (minutes, 0 disables)"), 0, Util::maxInt ());
+    addBoolEdit (data, *grid, "editor/compress-files", QObject::tr ("Compress saved meshes"));
+    addBoolEdit (data, *grid, "editor/store-mesh-layouts",
+                 QObject::tr ("Save octrees and adjacency of meshes"));
+    addIntEdit (data, *grid, "editor/preview-size",
+                QObject::tr ("Preview size of saved files (pixels, 0 disables)"), 0, 1024);
+    addBoolEdit (data, *grid, "editor/import/clean", QObject::tr ("Clean imported meshes"));
+    addFloatEdit (data, *grid, "editor/import/weld-distance",
+                  QObject::tr ("Weld distance of imported vertices"), 0.0f, 1.0f);
+    addBoolEdit (data, *grid, "editor/journal/active", QObject::tr ("Journal edits"));
+    addIntEdit (data, *grid, "editor/journal/checkpoint-size",
+                QObject::tr ("Journal checkpoint size (MiB)"), 1, Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-width", QObject::tr ("Initial window width"), 1,
                 Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-height", QObject::tr ("Initial window height"), 1,
@@ -228,6 +270,53 @@ namespace
                   QObject::tr ("Table pressure intensity"), Util::epsilon (), 10.0f);
 
     addBoolEdit (data, *grid, "editor/use-geometry-shader", QObject::tr ("Use geometry shader"));
+    addBoolEdit (data, *grid, "editor/prefer-core-profile",
+                 QObject::tr ("Prefer OpenGL core profile"));
+    addIntEdit (data, *grid, "editor/max-frame-queue", QObject::tr ("Maximum queued frames"), 1,
+                8);
+    addBoolEdit (data, *grid, "editor/occlusion-culling", QObject::tr ("Cull occluded meshes"));
+    addBoolEdit (data, *grid, "editor/dynamic-resolution/active",
+                 QObject::tr ("Reduce resolution of slow frames"));
+    addFloatEdit (data, *grid, "editor/dynamic-resolution/min-scale",
+                  QObject::tr ("Minimum resolution scale"), 0.1f, 1.0f);
+    addFloatEdit (data, *grid, "editor/dynamic-resolution/frame-time",
+                  QObject::tr ("Target frame time (ms)"), 1.0f, 1000.0f);
+    addIntEdit (data, *grid, "editor/side-view/refresh-interval",
+                QObject::tr ("Side-view refresh interval (ms)"), 0, 10000);
+    addIntEdit (data, *grid, "editor/idle-delay",
+                QObject::tr ("Run background tasks after idling for (ms)"), 0, 60000);
+    addBoolEdit (data, *grid, "editor/mesh/use-bvh", QObject::tr ("Use bounding-volume hierarchy"));
+    addBoolEdit (data, *grid, "editor/mesh/cache-distances", QObject::tr ("Cache distances"));
+    addBoolEdit (data, *grid, "editor/mesh/index-edges", QObject::tr ("Index faces by edges"));
+    addBoolEdit (data, *grid, "editor/mesh/gpu-normals",
+                 QObject::tr ("Recompute normals on the GPU"));
+    addBoolEdit (data, *grid, "editor/mesh/reorder-on-prune",
+                 QObject::tr ("Reorder mesh spatially when pruning"));
+    addBoolEdit (data, *grid, "editor/mesh/optimize-index-order",
+                 QObject::tr ("Optimize index order for vertex cache"));
+    addBoolEdit (data, *grid, "editor/mesh/cull-clusters",
+                 QObject::tr ("Cull clusters of faces that face away"));
+    addIntEdit (data, *grid, "editor/mesh/compact-num-faces",
+                QObject::tr ("Compact loaded meshes with at least this many faces (0 disables)"),
+                0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/mesh/deferred-num-faces",
+                QObject::tr ("Load meshes with at least this many faces lazily (0 disables)"),
+                0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/mesh/matcap-num-faces",
+                QObject::tr ("Shade scenes with at least this many faces cheaply while "
+                             "navigating (0 disables)"),
+                0, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/mesh/defragment-interval",
+                QObject::tr ("Fill free slots of meshes while idling every (ms, 0 disables)"), 0,
+                60000);
+    addIntEdit (data, *grid, "editor/mesh/defragment-num-elements",
+                QObject::tr ("Maximum number of moved vertices and faces per fill"), 0,
+                Util::maxInt ());
+    addIntEdit (data, *grid, "editor/mesh/octree/leaf-size",
+                QObject::tr ("Faces per octree leaf before it is split"), 0, 1024);
+    addFloatEdit (data, *grid, "editor/mesh/octree/min-element-extent",
+                  QObject::tr ("Maximum size of faces in octree children (relative)"), 0.05f,
+                  0.45f);
 
     grid->addStretcher ();
 
@@ -2,10 +2,12 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <glm/gtc/matrix_transform.hpp>
 #include "camera.hpp"
 #include "dimension.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "history.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
@@ -31,6 +33,24 @@ namespace
                            mainWindow.update ();
                          });
 
+    // linked meshes are placed side by side along the x-axis
+    ViewUtil::addAction (menu, QObject::tr ("Link mesh"), QKeySequence (),
+                         [&mainWindow, &scene, &mesh]() {
+                           const PrimAABox bounds = mesh.bounds ();
+                           unsigned int    n = 1;
+
+                           scene.forEachConstLinkedMesh (
+                             [&mesh, &n](const DynamicMesh& m, const glm::mat4x4&) {
+                               n += &m == &mesh ? 1 : 0;
+                             });
+
+                           const float offset =
+                             float(n) * (bounds.maximum ().x - bounds.minimum ().x);
+                           scene.linkMesh (mesh, glm::translate (glm::mat4x4 (1.0f),
+                                                                 glm::vec3 (offset, 0.0f, 0.0f)));
+                           mainWindow.update ();
+                         });
+
     ViewUtil::addAction (
       menu, QObject::tr ("Mirror mesh"), QKeySequence (), [&mainWindow, &mesh]() {
         const PrimAABox bounds = mesh.mesh ().bounds ();
@@ -39,6 +59,20 @@ namespace
         mainWindow.update ();
       });
 
+    // connected meshes are not recorded
+    ViewUtil::addAction (menu, QObject::tr ("Split mesh into components"), QKeySequence (),
+                         [&mainWindow, &config, &mesh]() {
+                           State& state = mainWindow.glWidget ().state ();
+
+                           state.history ().snapshotDynamicMeshes (state.scene ());
+                           if (state.scene ().splitComponents (config, mesh) <= 1)
+                           {
+                             state.undo ();
+                             state.history ().dropFutureSnapshot ();
+                           }
+                           mainWindow.update ();
+                         });
+
     ViewUtil::addAction (menu, QObject::tr ("Move mesh to center"), QKeySequence (),
                          [&mainWindow, &mesh]() {
                            mesh.moveToCenter ();
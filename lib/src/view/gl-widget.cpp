@@ -4,10 +4,20 @@
  */
 #include <QCoreApplication>
 #include <QMouseEvent>
+#include <QOpenGLFramebufferObject>
 #include <QPainter>
+#include <QStatusBar>
+#include <QTimer>
 #include <glm/glm.hpp>
 #include "camera.hpp"
 #include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "frame-queue.hpp"
+#include "hash.hpp"
+#include "history.hpp"
+#include "idle-tasks.hpp"
+#include "journal.hpp"
+#include "memory-governor.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
 #include "opengl.hpp"
@@ -16,6 +26,7 @@
 #include "state.hpp"
 #include "tool/move-camera.hpp"
 #include "view/axis.hpp"
+#include "view/background-save.hpp"
 #include "view/context-menu.hpp"
 #include "view/floor-plane.hpp"
 #include "view/gl-widget.hpp"
@@ -23,16 +34,21 @@
 #include "view/info-pane/scene.hpp"
 #include "view/key-event.hpp"
 #include "view/main-window.hpp"
+#include "view/performance-overlay.hpp"
+#include "view/picking.hpp"
 #include "view/pointing-event.hpp"
 #include "view/tool-pane.hpp"
 #include "view/util.hpp"
 
 struct ViewGlWidget::Impl
 {
-  typedef std::unique_ptr<ToolMoveCamera> ToolMoveCameraPtr;
-  typedef std::unique_ptr<State>          StatePtr;
-  typedef std::unique_ptr<ViewAxis>       AxisPtr;
-  typedef std::unique_ptr<ViewFloorPlane> FloorPlanePtr;
+  typedef std::unique_ptr<ToolMoveCamera>     ToolMoveCameraPtr;
+  typedef std::unique_ptr<State>              StatePtr;
+  typedef std::unique_ptr<ViewAxis>           AxisPtr;
+  typedef std::unique_ptr<ViewFloorPlane>     FloorPlanePtr;
+  typedef std::unique_ptr<ViewBackgroundSave> BackgroundSavePtr;
+  typedef std::unique_ptr<QOpenGLFramebufferObject> FramebufferPtr;
+  typedef std::unique_ptr<ViewPicking>              PickingPtr;
 
   ViewGlWidget*     self;
   ViewMainWindow&   mainWindow;
@@ -42,25 +58,90 @@ struct ViewGlWidget::Impl
   StatePtr          _state;
   AxisPtr           axis;
   FloorPlanePtr     _floorPlane;
+  BackgroundSavePtr _backgroundSave;
+  FramebufferPtr    sceneCache;
+  std::size_t       sceneCacheKey;
+  bool              isSceneCacheValid;
+  FramebufferPtr    scaledScene;
+  bool              dynamicResolution;
+  float             minRenderScale;
+  float             targetFrameTime;
+  float             renderScale;
+  bool              wasCameraMoving;
+  bool              isIdle;
+  QTimer            idleTimer;
+  QTimer            defragmentTimer;
+  unsigned int      defragmentNumElements;
+  bool              isDefragmentRequested;
+  MemoryGovernor    memoryGovernor;
+  QTimer            memoryTimer;
+  bool              isMemoryCheckRequested;
+  PickingPtr        picking;
+  bool              isPickingRequested;
   bool              tabletPressed;
 
+  ViewPerformanceOverlay _performanceOverlay;
+
   Impl (ViewGlWidget* s, ViewMainWindow& mW, Config& cfg, Cache& cch)
     : self (s)
     , mainWindow (mW)
     , config (cfg)
     , cache (cch)
+    , sceneCacheKey (0)
+    , isSceneCacheValid (false)
+    , dynamicResolution (false)
+    , minRenderScale (1.0f)
+    , targetFrameTime (0.0f)
+    , renderScale (1.0f)
+    , wasCameraMoving (false)
+    , isIdle (false)
+    , defragmentNumElements (0)
+    , isDefragmentRequested (false)
+    , isMemoryCheckRequested (false)
+    , isPickingRequested (false)
     , tabletPressed (false)
   {
     this->self->setAutoFillBackground (false);
+
+    this->idleTimer.setSingleShot (true);
+    this->idleTimer.setInterval (250);
+    QObject::connect (&this->idleTimer, &QTimer::timeout, [this]() {
+      this->isIdle = true;
+      this->self->update ();
+    });
+
+    // meshes are defragmented while rendering, i.e., while the context is current
+    QObject::connect (&this->defragmentTimer, &QTimer::timeout, [this]() {
+      if (this->_state && IdleTasks::isInterrupted () == false)
+      {
+        this->isDefragmentRequested = true;
+        this->self->update ();
+      }
+    });
+
+    // memory is relieved while painting, since buffers must be released in a current context
+    this->memoryTimer.setInterval (2000);
+    QObject::connect (&this->memoryTimer, &QTimer::timeout, [this]() {
+      if (this->_state && IdleTasks::isInterrupted () == false)
+      {
+        this->isMemoryCheckRequested = true;
+        this->self->update ();
+      }
+    });
   }
 
   ~Impl ()
   {
     this->self->makeCurrent ();
 
+    this->_backgroundSave.reset (nullptr);
     this->_state.reset (nullptr);
     this->axis.reset (nullptr);
     this->_floorPlane.reset (nullptr);
+    this->sceneCache.reset (nullptr);
+    this->scaledScene.reset (nullptr);
+    this->picking.reset (nullptr);
+    FrameQueue::reset ();
 
     this->self->doneCurrent ();
   }
@@ -83,6 +164,14 @@ struct ViewGlWidget::Impl
     return *this->_floorPlane;
   }
 
+  ViewBackgroundSave& backgroundSave ()
+  {
+    assert (this->_backgroundSave);
+    return *this->_backgroundSave;
+  }
+
+  ViewPerformanceOverlay& performanceOverlay () { return this->_performanceOverlay; }
+
   glm::ivec2 cursorPosition ()
   {
     return ViewUtil::toIVec2 (this->self->mapFromGlobal (QCursor::pos ()));
@@ -100,17 +189,102 @@ struct ViewGlWidget::Impl
     this->floorPlane ().update (this->state ().camera ());
 
     this->_immediateMoveCamera->fromConfig ();
+    this->backgroundSave ().fromConfig (this->config);
+    this->isSceneCacheValid = false;
+    this->resolutionFromConfig ();
+
+    FrameQueue::maxQueuedFrames (this->config.get<int> ("editor/max-frame-queue"));
+    IdleTasks::idleDelay (std::max (0, this->config.get<int> ("editor/idle-delay")));
+    this->defragmentFromConfig ();
+    this->memoryFromConfig ();
+  }
+
+  void defragmentFromConfig ()
+  {
+    const int interval = this->config.get<int> ("editor/mesh/defragment-interval");
+
+    this->defragmentNumElements =
+      std::max (0, this->config.get<int> ("editor/mesh/defragment-num-elements"));
+
+    if (interval > 0 && this->defragmentNumElements > 0)
+    {
+      this->defragmentTimer.start (interval);
+    }
+    else
+    {
+      this->defragmentTimer.stop ();
+    }
+  }
+
+  // moves a bounded number of elements of all meshes into free slots per tick
+  void defragmentMeshes ()
+  {
+    unsigned int numElements = this->defragmentNumElements;
+
+    this->state ().scene ().forEachMesh ([&numElements](DynamicMesh& mesh) {
+      if (numElements > 0)
+      {
+        numElements -= mesh.defragment (numElements);
+      }
+    });
+  }
+
+  void memoryFromConfig ()
+  {
+    const int budget = this->config.get<int> ("editor/memory-budget");
+
+    this->memoryGovernor.budget (std::size_t (std::max (0, budget)) * 1024 * 1024);
+
+    if (budget > 0)
+    {
+      this->memoryTimer.start ();
+    }
+    else
+    {
+      this->memoryTimer.stop ();
+    }
+  }
+
+  void relieveMemory ()
+  {
+    const MemoryGovernor::Step step =
+      this->memoryGovernor.update (this->state ().scene (), this->state ().history ());
+
+    if (step == MemoryGovernor::Step::Warn)
+    {
+      this->mainWindow.statusBar ()->showMessage (
+        QObject::tr ("Dilay exceeds its memory budget: consider saving and reducing the undo "
+                     "depth or the resolution of meshes"),
+        10000);
+    }
+  }
+
+  void resolutionFromConfig ()
+  {
+    this->dynamicResolution = this->config.get<bool> ("editor/dynamic-resolution/active");
+    this->minRenderScale = this->config.get<float> ("editor/dynamic-resolution/min-scale");
+    this->targetFrameTime = this->config.get<float> ("editor/dynamic-resolution/frame-time");
+    this->renderScale = 1.0f;
   }
 
   void initializeGL ()
   {
     OpenGL::initializeFunctions (this->config.get<bool> ("editor/use-geometry-shader"));
+    FrameQueue::maxQueuedFrames (this->config.get<int> ("editor/max-frame-queue"));
+    IdleTasks::idleDelay (std::max (0, this->config.get<int> ("editor/idle-delay")));
+    this->resolutionFromConfig ();
+    this->defragmentFromConfig ();
+    this->memoryFromConfig ();
 
     this->_state.reset (new State (this->mainWindow, this->config, this->cache));
     this->axis.reset (new ViewAxis (this->config));
     this->_floorPlane.reset (new ViewFloorPlane (this->config, this->state ().camera ()));
     this->_immediateMoveCamera.reset (new ToolMoveCamera (this->state (), true));
     this->_immediateMoveCamera->initialize ();
+    this->_backgroundSave.reset (
+      new ViewBackgroundSave (this->mainWindow, this->state ().scene ()));
+    this->_backgroundSave->fromConfig (this->config);
+    this->picking.reset (new ViewPicking);
 
     this->self->setMouseTracking (true);
     this->self->setTabletTracking (true);
@@ -138,20 +312,51 @@ struct ViewGlWidget::Impl
 
   void paintGL ()
   {
+    this->performanceOverlay ().beginFrame ();
+
+    if (this->state ().hasTool ())
+    {
+      this->state ().tool ().prepareRender ();
+    }
+
+    // frames are requested until all deferred meshes are loaded
+    if (this->state ().scene ().updateDeferredMeshes (this->state ().camera ()))
+    {
+      this->self->update ();
+    }
+
+    if (this->isDefragmentRequested)
+    {
+      this->isDefragmentRequested = false;
+      this->defragmentMeshes ();
+    }
+
+    if (this->isMemoryCheckRequested)
+    {
+      this->isMemoryCheckRequested = false;
+      this->relieveMemory ();
+    }
+
     QPainter painter (this->self);
     painter.beginNativePainting ();
 
+    this->updatePicking ();
+    this->updateRenderScale ();
     this->state ().camera ().renderer ().setupRendering ();
-    this->state ().scene ().render (this->state ().camera ());
-    this->floorPlane ().render (this->state ().camera ());
+    this->renderScene ();
 
     if (this->state ().hasTool ())
     {
+      this->state ().camera ().renderer ().beginGpuTimer ("tool");
       this->state ().tool ().render ();
+      this->state ().camera ().renderer ().endGpuTimer ();
     }
+    this->state ().camera ().renderer ().beginGpuTimer ("axis");
     this->axis->render (this->state ().camera ());
+    this->state ().camera ().renderer ().endGpuTimer ();
 
     this->state ().camera ().renderer ().shutdownRendering ();
+    FrameQueue::endFrame ();
     painter.endNativePainting ();
 
     this->axis->render (this->state ().camera (), painter);
@@ -159,6 +364,183 @@ struct ViewGlWidget::Impl
     {
       this->state ().tool ().paint (painter);
     }
+    this->performanceOverlay ().endFrame ();
+    this->performanceOverlay ().paint (painter, this->state ());
+
+    if (this->state ().hasTool ())
+    {
+      this->state ().tool ().finishRender ();
+    }
+  }
+
+  std::size_t sceneKey ()
+  {
+    const Camera& camera = this->state ().camera ();
+    std::size_t   key = this->state ().scene ().renderKey ();
+
+    Hash::combine (key, this->floorPlane ().isActive ());
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      for (unsigned int j = 0; j < 4; j++)
+      {
+        Hash::combine (key, camera.view ()[i][j]);
+        Hash::combine (key, camera.projection ()[i][j]);
+      }
+    }
+    return key;
+  }
+
+  /* The scene is rendered at a reduced resolution while the camera moves, or if the last frame
+   * exceeded the target frame time.  In the latter case, the scale is lowered until frames are
+   * fast enough.  Full resolution is restored once the camera stops, or once no frame has been
+   * requested for a while.
+   */
+  void updateRenderScale ()
+  {
+    const bool  isCameraMoving = this->state ().scene ().renderLodProxies ();
+    const float frameTime = float(this->performanceOverlay ().frameTime ());
+
+    if (this->dynamicResolution == false ||
+        QOpenGLFramebufferObject::hasOpenGLFramebufferBlit () == false)
+    {
+      this->renderScale = 1.0f;
+    }
+    else if (isCameraMoving)
+    {
+      this->renderScale = this->minRenderScale;
+    }
+    else if (this->wasCameraMoving || this->isIdle)
+    {
+      this->renderScale = 1.0f;
+    }
+    else if (frameTime > this->targetFrameTime)
+    {
+      // the number of fragments is quadratic in the scale
+      const float factor = glm::sqrt (this->targetFrameTime / frameTime);
+      this->renderScale = glm::max (this->minRenderScale, this->renderScale * factor);
+    }
+    this->wasCameraMoving = isCameraMoving;
+    this->isIdle = false;
+
+    if (this->renderScale < 1.0f)
+    {
+      this->idleTimer.start ();
+    }
+  }
+
+  // wireframes are rendered along with the scene, hence such scenes are measured as another pass
+  void renderSceneAndFloorPlane ()
+  {
+    Camera&   camera = this->state ().camera ();
+    Renderer& renderer = camera.renderer ();
+
+    renderer.beginGpuTimer (this->state ().scene ().renderWireframe () ? "scene with wireframe"
+                                                                       : "scene");
+    this->state ().scene ().render (camera);
+    renderer.endGpuTimer ();
+
+    renderer.beginGpuTimer ("floor plane");
+    this->floorPlane ().render (camera);
+    renderer.endGpuTimer ();
+  }
+
+  /* The depth buffer is copied along with the colors, so that tools are still occluded by the
+   * scene.  Depth values cannot be interpolated, hence only colors are filtered linearly.
+   */
+  void renderScaledScene (const QRect& rect)
+  {
+    const QSize size =
+      (QSizeF (rect.size ()) * this->renderScale).toSize ().expandedTo (QSize (1, 1));
+    const QRect scaledRect (QPoint (0, 0), size);
+
+    if (this->scaledScene == nullptr || this->scaledScene->size () != size)
+    {
+      this->scaledScene.reset (
+        new QOpenGLFramebufferObject (size, QOpenGLFramebufferObject::CombinedDepthStencil));
+    }
+    this->scaledScene->bind ();
+    OpenGL::glViewport (0, 0, size.width (), size.height ());
+    OpenGL::glClear (OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ());
+
+    this->renderSceneAndFloorPlane ();
+
+    this->scaledScene->release ();
+    OpenGL::glViewport (0, 0, rect.width (), rect.height ());
+
+    QOpenGLFramebufferObject::blitFramebuffer (nullptr, rect, this->scaledScene.get (), scaledRect,
+                                               OpenGL::ColorBufferBit (), OpenGL::Linear ());
+    QOpenGLFramebufferObject::blitFramebuffer (nullptr, rect, this->scaledScene.get (), scaledRect,
+                                               OpenGL::DepthBufferBit (), OpenGL::Nearest ());
+  }
+
+  /* The scene and the floor plane are copied to a cache framebuffer after rendering them.  The
+   * cache is copied back instead of rendering them again as long as neither the scene nor the
+   * camera changed, e.g., if only the cursor of a tool moves.  Level-of-detail proxies are
+   * built asynchronously, hence scenes that render them are not cached.
+   */
+  void renderScene ()
+  {
+    const unsigned int buffers = OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ();
+    const QRect        rect (QPoint (0, 0), this->self->size () * this->self->devicePixelRatioF ());
+    const std::size_t  key = this->sceneKey ();
+
+    if (this->isSceneCacheValid && this->sceneCacheKey == key && this->sceneCache &&
+        this->sceneCache->size () == rect.size ())
+    {
+      QOpenGLFramebufferObject::blitFramebuffer (nullptr, rect, this->sceneCache.get (), rect,
+                                                 buffers);
+    }
+    else if (this->renderScale < 1.0f)
+    {
+      this->renderScaledScene (rect);
+      this->isSceneCacheValid = false;
+    }
+    else
+    {
+      this->renderSceneAndFloorPlane ();
+
+      if (QOpenGLFramebufferObject::hasOpenGLFramebufferBlit () &&
+          this->state ().scene ().renderLodProxies () == false)
+      {
+        if (this->sceneCache == nullptr || this->sceneCache->size () != rect.size ())
+        {
+          this->sceneCache.reset (new QOpenGLFramebufferObject (
+            rect.size (), QOpenGLFramebufferObject::CombinedDepthStencil));
+        }
+        QOpenGLFramebufferObject::blitFramebuffer (this->sceneCache.get (), rect, nullptr, rect,
+                                                   buffers);
+        this->sceneCacheKey = key;
+        this->isSceneCacheValid = true;
+      }
+      else
+      {
+        this->isSceneCacheValid = false;
+      }
+    }
+  }
+
+  // picking is only updated while it is requested, e.g., by tools that highlight hovered meshes;
+  // a further frame is requested until the asynchronous read back settles
+  void updatePicking ()
+  {
+    if (this->isPickingRequested && this->state ().scene ().renderLodProxies () == false &&
+        QOpenGLFramebufferObject::hasOpenGLFramebufferObjects ())
+    {
+      this->isPickingRequested = false;
+
+      if (this->picking->update (this->state ().camera (), this->state ().scene (),
+                                 this->sceneKey (), this->cursorPosition ()))
+      {
+        this->self->update ();
+      }
+    }
+  }
+
+  DynamicMesh* pickDynamicMesh ()
+  {
+    this->isPickingRequested = true;
+    return this->picking->dynamicMesh (this->state ().scene (), this->sceneKey ());
   }
 
   void resizeGL (int w, int h) { this->state ().camera ().updateResolution (glm::uvec2 (w, h)); }
@@ -167,6 +549,27 @@ struct ViewGlWidget::Impl
   {
     if (e.valid ())
     {
+      // idle tasks do not compete with strokes
+      if (e.pressEvent ())
+      {
+        this->performanceOverlay ().beginStroke ();
+        IdleTasks::isStroking (true);
+      }
+      else if (e.releaseEvent ())
+      {
+        IdleTasks::isStroking (false);
+      }
+      else
+      {
+        IdleTasks::interact ();
+      }
+
+      // the immediate camera tool handles middle-button events
+      if (e.middleButton ())
+      {
+        this->synchronizeTool ();
+      }
+
       if (this->_immediateMoveCamera->pointingEvent (e) == ToolResponse::Redraw)
       {
         this->state ().handleToolResponse (ToolResponse::Redraw);
@@ -177,6 +580,13 @@ struct ViewGlWidget::Impl
       {
         this->state ().handleToolResponse (this->state ().tool ().pointingEvent (e));
       }
+
+      // strokes are journaled once they have been applied
+      if (e.releaseEvent () && this->state ().history ().journal ().isActive ())
+      {
+        this->synchronizeTool ();
+        this->state ().history ().journal ().record (this->state ().scene ());
+      }
     }
   }
 
@@ -206,6 +616,9 @@ struct ViewGlWidget::Impl
 
   void wheelEvent (QWheelEvent* e)
   {
+    IdleTasks::interact ();
+    this->synchronizeTool ();
+
     if (this->_immediateMoveCamera->wheelEvent (*e) == ToolResponse::Redraw)
     {
       this->state ().handleToolResponse (ToolResponse::Redraw);
@@ -232,6 +645,8 @@ struct ViewGlWidget::Impl
   {
     const ViewKeyEvent keyEvent (*e, true);
 
+    IdleTasks::interact ();
+
     if (this->state ().hasTool ())
     {
       this->state ().tool ().keyEvent (keyEvent);
@@ -260,6 +675,14 @@ struct ViewGlWidget::Impl
     menu.exec (this->self->mapToGlobal (event->pos ()));
   }
 
+  void synchronizeTool ()
+  {
+    if (this->state ().hasTool ())
+    {
+      this->state ().tool ().synchronize ();
+    }
+  }
+
   void updateCursorInTool ()
   {
     if (this->state ().hasTool ())
@@ -274,7 +697,10 @@ DELEGATE3_BIG2_SELF (ViewGlWidget, ViewMainWindow&, Config&, Cache&)
 DELEGATE (ToolMoveCamera&, ViewGlWidget, immediateMoveCamera)
 DELEGATE (State&, ViewGlWidget, state)
 DELEGATE (ViewFloorPlane&, ViewGlWidget, floorPlane)
+DELEGATE (ViewPerformanceOverlay&, ViewGlWidget, performanceOverlay)
+DELEGATE (ViewBackgroundSave&, ViewGlWidget, backgroundSave)
 DELEGATE (glm::ivec2, ViewGlWidget, cursorPosition)
+DELEGATE (DynamicMesh*, ViewGlWidget, pickDynamicMesh)
 DELEGATE (void, ViewGlWidget, fromConfig)
 DELEGATE (void, ViewGlWidget, initializeGL)
 DELEGATE2 (void, ViewGlWidget, resizeGL, int, int)
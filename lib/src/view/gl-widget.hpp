@@ -11,10 +11,13 @@
 
 class Cache;
 class Config;
+class DynamicMesh;
 class State;
 class ToolMoveCamera;
+class ViewBackgroundSave;
 class ViewFloorPlane;
 class ViewMainWindow;
+class ViewPerformanceOverlay;
 
 class ViewGlWidget : public QOpenGLWidget
 {
@@ -22,11 +25,15 @@ class ViewGlWidget : public QOpenGLWidget
 public:
   DECLARE_BIG2 (ViewGlWidget, ViewMainWindow&, Config&, Cache&)
 
-  ToolMoveCamera& immediateMoveCamera ();
-  State&          state ();
-  ViewFloorPlane& floorPlane ();
-  glm::ivec2      cursorPosition ();
-  void            fromConfig ();
+  ToolMoveCamera&         immediateMoveCamera ();
+  State&                  state ();
+  ViewFloorPlane&         floorPlane ();
+  ViewBackgroundSave&     backgroundSave ();
+  ViewPerformanceOverlay& performanceOverlay ();
+  glm::ivec2              cursorPosition ();
+  // returns the dynamic mesh that has been picked below the cursor, if any
+  DynamicMesh*            pickDynamicMesh ();
+  void                    fromConfig ();
 
 protected:
   void initializeGL ();
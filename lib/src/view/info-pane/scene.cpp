@@ -7,6 +7,7 @@
 #include <QVBoxLayout>
 #include "../../scene.hpp"
 #include "dynamic/mesh.hpp"
+#include "history.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
 #include "state.hpp"
@@ -14,6 +15,7 @@
 #include "view/gl-widget.hpp"
 #include "view/info-pane/scene.hpp"
 #include "view/main-window.hpp"
+#include "view/util.hpp"
 
 namespace
 {
@@ -83,6 +85,7 @@ struct ViewInfoPaneScene::Impl
 
       new MeshItem (item, {QObject::tr ("Faces"), QString::number (mesh.numFaces ())}, mesh);
       new MeshItem (item, {QObject::tr ("Vertices"), QString::number (mesh.numVertices ())}, mesh);
+      new MeshItem (item, {QObject::tr ("Memory"), ViewUtil::byteSize (mesh.numBytes ())}, mesh);
     };
 
     const auto showSketch = [this](SketchMesh& sketch) {
@@ -95,11 +98,25 @@ struct ViewInfoPaneScene::Impl
         new SketchItem (item, {QObject::tr ("Nodes"), QString::number (numNodes)}, sketch);
         new SketchItem (item, {QObject::tr ("Paths"), QString::number (numPaths)}, sketch);
       }
+      new SketchItem (item, {QObject::tr ("Memory"), ViewUtil::byteSize (sketch.numBytes ())},
+                      sketch);
+    };
+
+    const auto showMemory = [this](State& state) {
+      QTreeWidgetItem& item = *new QTreeWidgetItem (this->tree, {QObject::tr ("Memory")});
+
+      const auto addItem = [&item](const QString& label, std::size_t numBytes) {
+        new QTreeWidgetItem (&item, {label, ViewUtil::byteSize (numBytes)});
+      };
+      addItem (QObject::tr ("Scene"), state.scene ().numBytes ());
+      addItem (QObject::tr ("Buffers"), state.scene ().numBufferBytes ());
+      addItem (QObject::tr ("History"), state.history ().numBytes ());
     };
 
     this->tree->clear ();
     this->mainWindow.glWidget ().state ().scene ().forEachMesh (showMesh);
     this->mainWindow.glWidget ().state ().scene ().forEachMesh (showSketch);
+    showMemory (this->mainWindow.glWidget ().state ());
     this->tree->expandAll ();
     this->tree->setItemsExpandable (false);
 
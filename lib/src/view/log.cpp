@@ -27,6 +27,8 @@ void ViewLog::show (ViewMainWindow& window)
   textEdit->setReadOnly (true);
   textEdit->setLineWrapMode (QTextEdit::NoWrap);
 
+  Log::flush ();
+
   if (QFile (ViewLog::logPath ()).exists ())
   {
     const std::string content = Util::readFile (ViewLog::logPath ().toStdString ());
@@ -3,11 +3,13 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCloseEvent>
+#include <QDockWidget>
 #include "view/gl-widget.hpp"
 #include "view/info-pane.hpp"
 #include "view/info-pane/scene.hpp"
 #include "view/main-window.hpp"
 #include "view/menu-bar.hpp"
+#include "view/side-view.hpp"
 #include "view/tool-pane.hpp"
 #include "view/util.hpp"
 
@@ -17,17 +19,25 @@ struct ViewMainWindow::Impl
   ViewGlWidget&   glWidget;
   ViewToolPane&   toolPane;
   ViewInfoPane&   infoPane;
+  QDockWidget&    sideView;
 
   Impl (ViewMainWindow* s, Config& config, Cache& cache)
     : self (s)
     , glWidget (*new ViewGlWidget (*this->self, config, cache))
     , toolPane (*new ViewToolPane (this->glWidget))
     , infoPane (*new ViewInfoPane (*this->self))
+    , sideView (*new QDockWidget (QObject::tr ("Side view")))
   {
     this->self->setCentralWidget (&this->glWidget);
     this->self->addDockWidget (Qt::LeftDockWidgetArea, &this->toolPane);
     this->self->addDockWidget (Qt::RightDockWidgetArea, &this->infoPane);
 
+    // the side view is toggled by the view menu only
+    this->sideView.setWidget (new ViewSideView (this->glWidget));
+    this->sideView.setFeatures (QDockWidget::DockWidgetMovable);
+    this->self->addDockWidget (Qt::RightDockWidgetArea, &this->sideView);
+    this->sideView.hide ();
+
     ViewMenuBar::setup (*this->self, this->glWidget);
   }
 
@@ -59,5 +69,6 @@ DELEGATE2_BIG2_SELF (ViewMainWindow, Config&, Cache&)
 GETTER (ViewGlWidget&, ViewMainWindow, glWidget)
 GETTER (ViewToolPane&, ViewMainWindow, toolPane)
 GETTER (ViewInfoPane&, ViewMainWindow, infoPane)
+GETTER (QDockWidget&, ViewMainWindow, sideView)
 DELEGATE (void, ViewMainWindow, update)
 DELEGATE1 (void, ViewMainWindow, closeEvent, QCloseEvent*)
@@ -11,6 +11,7 @@
 class Cache;
 class Config;
 class QCloseEvent;
+class QDockWidget;
 class ViewGlWidget;
 class ViewInfoPane;
 class ViewToolPane;
@@ -24,6 +25,7 @@ public:
   ViewGlWidget& glWidget ();
   ViewToolPane& toolPane ();
   ViewInfoPane& infoPane ();
+  QDockWidget&  sideView ();
   void          update ();
 
 protected:
@@ -3,13 +3,23 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QDesktopServices>
+#include <QDockWidget>
 #include <QFileDialog>
+#include <QGridLayout>
+#include <QLabel>
 #include <QMenuBar>
+#include <algorithm>
+#include <glm/glm.hpp>
 #include "../util.hpp"
+#include "camera.hpp"
 #include "history.hpp"
+#include "import-export.hpp"
+#include "primitive/plane.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool/move-camera.hpp"
+#include "tool/sculpt/util/recording.hpp"
+#include "view/background-save.hpp"
 #include "view/configuration.hpp"
 #include "view/floor-plane.hpp"
 #include "view/gl-widget.hpp"
@@ -18,6 +28,8 @@
 #include "view/log.hpp"
 #include "view/main-window.hpp"
 #include "view/menu-bar.hpp"
+#include "view/performance-overlay.hpp"
+#include "view/preview.hpp"
 #include "view/util.hpp"
 
 namespace
@@ -35,9 +47,14 @@ namespace
 
   QString filterObjFiles () { return QObject::tr ("Wavefront files (*.obj)"); }
 
+  QString filterMeshFiles () { return QObject::tr ("Mesh files (*.stl *.ply)"); }
+
+  QString filterRecordingFiles () { return QObject::tr ("Sculpt recordings (*.dsr)"); }
+
   QString fileDialogFilters ()
   {
-    return filterAllFiles () + ";;" + filterDlyFiles () + ";;" + filterObjFiles ();
+    return filterAllFiles () + ";;" + filterDlyFiles () + ";;" + filterObjFiles () + ";;" +
+           filterMeshFiles ();
   }
 
   QString selectedFilter (const Scene& scene)
@@ -52,9 +69,53 @@ namespace
       {
         return filterObjFiles ();
       }
+      else if (ImportExport::isMeshFile (scene.fileName ()))
+      {
+        return filterMeshFiles ();
+      }
     }
     return filterAllFiles ();
   }
+
+  // shows the previews that are embedded into binary files next to the list of files
+  QString getOpenFileNameWithPreview (QWidget& parent, const QString& path, QString& filter)
+  {
+    QFileDialog dialog (&parent, QObject::tr ("Open"), path, fileDialogFilters ());
+    QLabel*     preview = new QLabel;
+    auto*       layout = qobject_cast<QGridLayout*> (dialog.layout ());
+
+    dialog.setOption (QFileDialog::DontUseNativeDialog);
+    dialog.setFileMode (QFileDialog::ExistingFile);
+    dialog.selectNameFilter (filter);
+
+    preview->setFixedSize (128, 128);
+    preview->setAlignment (Qt::AlignCenter);
+    if (layout)
+    {
+      layout->addWidget (preview, 0, layout->columnCount (), layout->rowCount (), 1);
+    }
+
+    QObject::connect (&dialog, &QFileDialog::currentChanged, [preview](const QString& fileName) {
+      const QImage image = ViewPreview::fromFile (fileName);
+
+      if (image.isNull ())
+      {
+        preview->clear ();
+      }
+      else
+      {
+        preview->setPixmap (QPixmap::fromImage (image).scaled (
+          preview->size (), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+      }
+    });
+
+    if (dialog.exec () == QDialog::Accepted && dialog.selectedFiles ().isEmpty () == false)
+    {
+      filter = dialog.selectedNameFilter ();
+      return dialog.selectedFiles ().front ();
+    }
+    return QString ();
+  }
 }
 
 void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
@@ -70,20 +131,17 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
       Scene&            scene = glWidget.state ().scene ();
       QString           filter = filterAllFiles ();
       const std::string fileName =
-        QFileDialog::getOpenFileName (&mainWindow, QObject::tr ("Open"), getFileDialogPath (scene),
-                                      fileDialogFilters (), &filter,
-                                      QFileDialog::DontUseNativeDialog)
-          .toStdString ();
+        getOpenFileNameWithPreview (mainWindow, getFileDialogPath (scene), filter).toStdString ();
       if (fileName.empty () == false)
       {
 #ifndef NDEBUG
         scene.reset ();
-        glWidget.state ().history ().reset ();
+        glWidget.state ().history ().reset (scene);
 #else
       if (scene.isEmpty () == false) {
         if (ViewUtil::question (mainWindow, QObject::tr ("Replace existent scene?"))) {
           scene.reset ();
-          glWidget.state ().history ().reset ();
+          glWidget.state ().history ().reset (scene);
         }
         else {
           glWidget.state ().history ().snapshotAll (scene);
@@ -111,29 +169,29 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
       {
         const bool saveAsObj = Util::hasSuffix (fileName, ".obj") || filter == filterObjFiles ();
 
-        if (scene.toDlyFile (fileName, saveAsObj) == false)
-        {
-          ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
-        }
-        else if (saveAsObj && scene.numSketchMeshes () > 0)
+        scene.fileName (fileName);
+        glWidget.backgroundSave ().save (saveAsObj);
+
+        if (saveAsObj && scene.numSketchMeshes () > 0)
         {
           ViewUtil::info (mainWindow,
                           QObject::tr ("Sketches are omitted when saving Wavefront files."));
         }
+        else if (ImportExport::isMeshFile (fileName) && scene.numSketchMeshes () > 0)
+        {
+          ViewUtil::info (mainWindow, QObject::tr ("Sketches are omitted when saving mesh files."));
+        }
       }
     });
 
   ViewUtil::addAction (fileMenu, QObject::tr ("&Save"), QKeySequence::Save,
-                       [&mainWindow, &glWidget, &saveAsAction]() {
+                       [&glWidget, &saveAsAction]() {
                          Scene& scene = glWidget.state ().scene ();
                          if (scene.hasFileName ())
                          {
                            const bool saveAsObj = Util::hasSuffix (scene.fileName (), ".obj");
 
-                           if (scene.toDlyFile (saveAsObj) == false)
-                           {
-                             ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
-                           }
+                           glWidget.backgroundSave ().save (saveAsObj);
                          }
                          else
                          {
@@ -156,6 +214,86 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
     editMenu, QObject::tr ("&Configuration..."), QKeySequence (),
     [&mainWindow, &glWidget]() { ViewConfiguration::show (mainWindow, glWidget); });
 
+  editMenu.addSeparator ();
+
+  ViewUtil::addCheckableAction (
+    editMenu, QObject::tr ("Record sculpt s&trokes"), QKeySequence (), false,
+    [&mainWindow, &glWidget](bool record) {
+      SculptRecording& recording = glWidget.state ().sculptRecording ();
+      if (record)
+      {
+        recording.start ();
+      }
+      else
+      {
+        recording.stop ();
+        if (recording.numDabs () > 0)
+        {
+          const std::string fileName =
+            QFileDialog::getSaveFileName (&mainWindow, QObject::tr ("Save recording"),
+                                          getFileDialogPath (glWidget.state ().scene ()),
+                                          filterRecordingFiles (), nullptr,
+                                          QFileDialog::DontUseNativeDialog)
+              .toStdString ();
+          if (fileName.empty () == false && recording.toFile (fileName) == false)
+          {
+            ViewUtil::error (mainWindow, QObject::tr ("Could not save recording."));
+          }
+        }
+      }
+    });
+
+  ViewUtil::addAction (
+    editMenu, QObject::tr ("Re&play sculpt strokes..."), QKeySequence (),
+    [&mainWindow, &glWidget]() {
+      State&            state = glWidget.state ();
+      const std::string fileName =
+        QFileDialog::getOpenFileName (&mainWindow, QObject::tr ("Replay recording"),
+                                      getFileDialogPath (state.scene ()),
+                                      filterRecordingFiles (), nullptr,
+                                      QFileDialog::DontUseNativeDialog)
+          .toStdString ();
+      if (fileName.empty () == false)
+      {
+        SculptRecording recording;
+        if (recording.fromFile (fileName) == false)
+        {
+          ViewUtil::error (mainWindow, QObject::tr ("Could not open recording."));
+          return;
+        }
+
+        float total = 0.0f;
+        float maximum = 0.0f;
+
+        state.resetTool ();
+        state.history ().snapshotDynamicMeshes (state.scene ());
+
+        const bool success =
+          recording.replay (state.scene (), [&total, &maximum](unsigned int i, float duration) {
+            DILAY_INFO ("replayed dab %u in %f ms", i, duration * 1000.0f);
+            total += duration;
+            maximum = std::max (maximum, duration);
+          });
+        mainWindow.update ();
+
+        if (success)
+        {
+          ViewUtil::info (mainWindow,
+                          QObject::tr ("Replayed %1 dabs of %2 strokes in %3 ms (slowest dab: "
+                                       "%4 ms).")
+                            .arg (recording.numDabs ())
+                            .arg (recording.numStrokes ())
+                            .arg (double(total) * 1000.0)
+                            .arg (double(maximum) * 1000.0));
+        }
+        else
+        {
+          ViewUtil::error (mainWindow,
+                           QObject::tr ("The recording does not match the current scene."));
+        }
+      }
+    });
+
   ViewUtil::addAction (viewMenu, QObject::tr ("Toggle &info pane"), Qt::CTRL + Qt::Key_I,
                        [&mainWindow]() {
                          if (mainWindow.infoPane ().isVisible ())
@@ -168,6 +306,9 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
                          }
                        });
 
+  ViewUtil::addCheckableAction (viewMenu, QObject::tr ("Show si&de view"), QKeySequence (), false,
+                                [&mainWindow](bool a) { mainWindow.sideView ().setVisible (a); });
+
   viewMenu.addSeparator ();
 
   ViewUtil::addAction (viewMenu, QObject::tr ("&Snap camera"), Qt::SHIFT + Qt::Key_C,
@@ -190,12 +331,37 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
                          mainWindow.update ();
                        });
 
+  // hides the geometry between the gaze point and the camera, until the action is unchecked
+  ViewUtil::addCheckableAction (viewMenu, QObject::tr ("&Clip at gaze point"), QKeySequence (),
+                                false, [&mainWindow, &glWidget](bool a) {
+                                  Scene&        scene = glWidget.state ().scene ();
+                                  const Camera& camera = glWidget.state ().camera ();
+
+                                  if (a)
+                                  {
+                                    scene.clipPlane (
+                                      PrimPlane (camera.gazePoint (),
+                                                 glm::normalize (camera.toEyePoint ())));
+                                  }
+                                  else
+                                  {
+                                    scene.resetClipPlane ();
+                                  }
+                                  mainWindow.update ();
+                                });
+
   ViewUtil::addCheckableAction (viewMenu, QObject::tr ("Show &floor plane"), QKeySequence (), false,
                                 [&mainWindow, &glWidget](bool a) {
                                   glWidget.floorPlane ().isActive (a);
                                   mainWindow.update ();
                                 });
 
+  ViewUtil::addCheckableAction (viewMenu, QObject::tr ("Show &performance overlay"),
+                                QKeySequence (), false, [&mainWindow, &glWidget](bool a) {
+                                  glWidget.performanceOverlay ().isActive (a);
+                                  mainWindow.update ();
+                                });
+
   ViewUtil::addAction (helpMenu, QObject::tr ("&Manual..."), QKeySequence (), [&mainWindow]() {
     if (QDesktopServices::openUrl (QUrl ("http://abau.org/dilay/manual.html")) == false)
     {
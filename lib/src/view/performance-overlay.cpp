@@ -0,0 +1,226 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QFontMetrics>
+#include <QPainter>
+#include <QStringList>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "dynamic/mesh.hpp"
+#include "dynamic/octree.hpp"
+#include "history.hpp"
+#include "opengl.hpp"
+#include "profile.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "view/performance-overlay.hpp"
+#include "view/util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  QString millisecondsText (double ms) { return QObject::tr ("%1 ms").arg (ms, 0, 'f', 2); }
+}
+
+struct ViewPerformanceOverlay::Impl
+{
+  bool              isActive;
+  Clock::time_point frameBegin;
+  double            frameTime;
+  std::size_t       frameUploadedBytes;
+  std::size_t       uploadedBytes;
+  Profile::Totals   strokeTotals;
+  Profile::Totals   gpuTimes;
+
+  Profile::AllocationTotals strokeAllocations;
+
+  // statistics of the scene are only gathered again if its render key changed
+  std::size_t  sceneKey;
+  unsigned int numMeshes;
+  unsigned int numVertices;
+  unsigned int numFaces;
+  unsigned int numOctreeNodes;
+  int          maxOctreeDepth;
+
+  Impl ()
+    : isActive (false)
+    , frameTime (0.0)
+    , frameUploadedBytes (0)
+    , uploadedBytes (0)
+    , sceneKey (0)
+    , numMeshes (0)
+    , numVertices (0)
+    , numFaces (0)
+    , numOctreeNodes (0)
+    , maxOctreeDepth (0)
+  {
+  }
+
+  ~Impl ()
+  {
+    if (this->isActive)
+    {
+      Profile::accumulateTotals (false);
+    }
+  }
+
+  void setActive (bool a)
+  {
+    this->isActive = a;
+    this->strokeTotals.clear ();
+    this->gpuTimes.clear ();
+    this->strokeAllocations.clear ();
+    this->sceneKey = 0;
+
+    Profile::accumulateTotals (a);
+    Profile::takeTotals ();
+    Profile::takeAllocations ();
+  }
+
+  void beginFrame () { this->frameBegin = Clock::now (); }
+
+  void endFrame ()
+  {
+    const std::size_t n = OpenGL::uploadedBytes ();
+
+    this->frameTime =
+      std::chrono::duration<double, std::milli> (Clock::now () - this->frameBegin).count ();
+    this->frameUploadedBytes = n - this->uploadedBytes;
+    this->uploadedBytes = n;
+  }
+
+  void beginStroke ()
+  {
+    if (this->isActive)
+    {
+      Profile::takeTotals ();
+      Profile::takeAllocations ();
+      this->strokeTotals.clear ();
+      this->strokeAllocations.clear ();
+    }
+  }
+
+  void updateSceneStatistics (const Scene& scene)
+  {
+    const std::size_t key = scene.renderKey ();
+
+    if (key != this->sceneKey)
+    {
+      this->sceneKey = key;
+      this->numMeshes = 0;
+      this->numVertices = 0;
+      this->numFaces = 0;
+      this->numOctreeNodes = 0;
+      this->maxOctreeDepth = 0;
+
+      scene.forEachConstMesh ([this](const DynamicMesh& mesh) {
+        const DynamicOctreeStatistics stats = mesh.octreeStatistics ();
+
+        this->numMeshes++;
+        this->numVertices += mesh.numVertices ();
+        this->numFaces += mesh.numFaces ();
+        this->numOctreeNodes += stats.numNodes;
+        this->maxOctreeDepth = glm::max (this->maxOctreeDepth, stats.maxDepth);
+      });
+    }
+  }
+
+  void paint (QPainter& painter, State& state)
+  {
+    if (this->isActive == false)
+    {
+      return;
+    }
+
+    for (const auto& total : Profile::takeTotals ())
+    {
+      this->strokeTotals[total.first] += total.second;
+    }
+    for (const auto& allocations : Profile::takeAllocations ())
+    {
+      Profile::Allocations& a = this->strokeAllocations[allocations.first];
+      a.count += allocations.second.count;
+      a.bytes += allocations.second.bytes;
+    }
+
+    // GPU times arrive a few frames late, and only if timer queries are supported
+    Profile::Totals gpuTimes = Profile::takeGpuTimes ();
+    if (gpuTimes.empty () == false)
+    {
+      this->gpuTimes = std::move (gpuTimes);
+    }
+    this->updateSceneStatistics (state.scene ());
+
+    QStringList lines;
+    lines << QObject::tr ("Frame: %1").arg (millisecondsText (this->frameTime))
+          << QObject::tr ("Uploaded: %1").arg (ViewUtil::byteSize (this->frameUploadedBytes))
+          << QObject::tr ("Meshes: %1").arg (this->numMeshes)
+          << QObject::tr ("Vertices: %1").arg (this->numVertices)
+          << QObject::tr ("Faces: %1").arg (this->numFaces)
+          << QObject::tr ("Octree nodes: %1").arg (this->numOctreeNodes)
+          << QObject::tr ("Octree depth: %1").arg (this->maxOctreeDepth)
+          << QObject::tr ("History: %1").arg (ViewUtil::byteSize (state.history ().numBytes ()));
+
+    if (this->gpuTimes.empty () == false)
+    {
+      lines << QObject::tr ("GPU:");
+      for (const auto& time : this->gpuTimes)
+      {
+        lines << QString ("  %1: %2")
+                   .arg (QString::fromStdString (time.first))
+                   .arg (millisecondsText (time.second));
+      }
+    }
+
+    if (this->strokeTotals.empty () == false)
+    {
+      lines << QObject::tr ("Stroke:");
+      for (const auto& total : this->strokeTotals)
+      {
+        lines << QString ("  %1: %2")
+                   .arg (QString::fromStdString (total.first))
+                   .arg (millisecondsText (total.second));
+      }
+    }
+
+    if (this->strokeAllocations.empty () == false)
+    {
+      lines << QObject::tr ("Stroke allocations:");
+      for (const auto& allocations : this->strokeAllocations)
+      {
+        lines << QString ("  %1: %2 (%3)")
+                   .arg (QString::fromStdString (allocations.first))
+                   .arg (allocations.second.count)
+                   .arg (ViewUtil::byteSize (allocations.second.bytes));
+      }
+    }
+
+    const QFontMetrics metrics (painter.font ());
+    const int          margin = metrics.height () / 2;
+    int                width = 0;
+
+    for (const QString& line : lines)
+    {
+      width = glm::max (width, metrics.width (line));
+    }
+    const QRect rect (margin, margin, width + (2 * margin),
+                      (lines.size () * metrics.height ()) + (2 * margin));
+
+    painter.fillRect (rect, QColor (0, 0, 0, 128));
+    painter.setPen (Qt::white);
+    painter.drawText (rect.adjusted (margin, margin, -margin, -margin),
+                      Qt::AlignLeft | Qt::AlignTop, lines.join ("\n"));
+  }
+};
+
+DELEGATE_BIG2 (ViewPerformanceOverlay)
+GETTER_CONST (bool, ViewPerformanceOverlay, isActive)
+GETTER_CONST (double, ViewPerformanceOverlay, frameTime)
+DELEGATE (void, ViewPerformanceOverlay, beginFrame)
+DELEGATE (void, ViewPerformanceOverlay, endFrame)
+DELEGATE (void, ViewPerformanceOverlay, beginStroke)
+DELEGATE2 (void, ViewPerformanceOverlay, paint, QPainter&, State&)
+
+void ViewPerformanceOverlay::isActive (bool a) { this->impl->setActive (a); }
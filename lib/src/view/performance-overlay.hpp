@@ -0,0 +1,36 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_PERFORMANCE_OVERLAY
+#define DILAY_VIEW_PERFORMANCE_OVERLAY
+
+#include "macro.hpp"
+
+class QPainter;
+class State;
+
+/* Paints statistics of the last frame, the current stroke and the scene into the viewport.  A
+ * stroke starts with a press of a pointing device, its phases are the profiling zones that have
+ * been entered since then.  Zones are only available if they are compiled in (see `profile.hpp`),
+ * as are the allocations of tagged subsystems during a stroke.
+ */
+class ViewPerformanceOverlay
+{
+public:
+  DECLARE_BIG2 (ViewPerformanceOverlay)
+
+  bool   isActive () const;
+  void   isActive (bool);
+  // returns the duration of the last frame in milliseconds, which is measured even if inactive
+  double frameTime () const;
+  void   beginFrame ();
+  void   endFrame ();
+  void   beginStroke ();
+  void   paint (QPainter&, State&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -0,0 +1,184 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QOpenGLFramebufferObject>
+#include <glm/glm.hpp>
+#include <memory>
+#include "camera.hpp"
+#include "color.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "render-mode.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "view/picking.hpp"
+
+namespace
+{
+  // index 0 marks the background
+  Color encodeIndex (unsigned int i)
+  {
+    assert (i < 1 << 24);
+    return Color (float((i >> 16) & 0xff) / 255.0f, float((i >> 8) & 0xff) / 255.0f,
+                  float(i & 0xff) / 255.0f);
+  }
+
+  unsigned int decodeIndex (const unsigned char* rgba)
+  {
+    return (rgba[0] << 16) | (rgba[1] << 8) | rgba[2];
+  }
+}
+
+struct ViewPicking::Impl
+{
+  typedef std::unique_ptr<QOpenGLFramebufferObject> FramebufferPtr;
+
+  FramebufferPtr framebuffer;
+  std::size_t    framebufferKey;
+  unsigned int   pixelBufferId;
+  bool           isReading;
+  std::size_t    readingKey;
+  glm::ivec2     readingPosition;
+  unsigned int   pickedIndex;
+  std::size_t    pickedKey;
+
+  Impl ()
+    : framebufferKey (0)
+    , pixelBufferId (0)
+    , isReading (false)
+    , readingKey (0)
+    , readingPosition (-1)
+    , pickedIndex (0)
+    , pickedKey (0)
+  {
+  }
+
+  ~Impl () { OpenGL::safeDeleteBuffer (this->pixelBufferId); }
+
+  bool readPicked ()
+  {
+    if (this->isReading == false)
+    {
+      return false;
+    }
+    this->isReading = false;
+
+    unsigned int index = 0;
+
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->pixelBufferId);
+    const void* data = OpenGL::glMapBuffer (OpenGL::PixelPackBuffer (), OpenGL::ReadOnly ());
+    if (data)
+    {
+      index = decodeIndex (static_cast<const unsigned char*> (data));
+      OpenGL::glUnmapBuffer (OpenGL::PixelPackBuffer ());
+    }
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), 0);
+
+    const bool changed = index != this->pickedIndex || this->readingKey != this->pickedKey;
+
+    this->pickedIndex = index;
+    this->pickedKey = this->readingKey;
+    return changed;
+  }
+
+  void renderIndices (Camera& camera, const Scene& scene, std::size_t key, const QSize& size)
+  {
+    if (this->framebuffer == nullptr || this->framebuffer->size () != size)
+    {
+      this->framebuffer.reset (
+        new QOpenGLFramebufferObject (size, QOpenGLFramebufferObject::Depth));
+    }
+    this->framebuffer->bind ();
+
+    camera.renderer ().setupRendering ();
+    OpenGL::glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+    OpenGL::glClear (OpenGL::ColorBufferBit () | OpenGL::DepthBufferBit ());
+
+    unsigned int index = 0;
+    scene.forEachConstMesh ([&camera, &index](const DynamicMesh& mesh) {
+      RenderMode renderMode (mesh.renderMode ());
+      renderMode.constantShading (true);
+      renderMode.renderWireframe (false);
+
+      index++;
+      mesh.mesh ().render (camera, renderMode, encodeIndex (index));
+    });
+
+    camera.renderer ().shutdownRendering ();
+    this->framebuffer->release ();
+    this->framebufferKey = key;
+  }
+
+  // returns true if the pixel differs from the previously read pixel
+  bool readPixel (const glm::ivec2& pos)
+  {
+    const QSize& size = this->framebuffer->size ();
+
+    if (pos.x < 0 || pos.y < 0 || pos.x >= size.width () || pos.y >= size.height ())
+    {
+      this->pickedIndex = 0;
+      return false;
+    }
+    else if (this->pixelBufferId == 0)
+    {
+      OpenGL::glGenBuffers (1, &this->pixelBufferId);
+      OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->pixelBufferId);
+      OpenGL::glBufferData (OpenGL::PixelPackBuffer (), 4, nullptr, OpenGL::StreamRead ());
+    }
+    else
+    {
+      OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), this->pixelBufferId);
+    }
+
+    this->framebuffer->bind ();
+    OpenGL::glReadPixels (pos.x, size.height () - 1 - pos.y, 1, 1, OpenGL::RGBA (),
+                          OpenGL::UnsignedByte (), nullptr);
+    this->framebuffer->release ();
+    OpenGL::glBindBuffer (OpenGL::PixelPackBuffer (), 0);
+
+    const bool isNew = pos != this->readingPosition || this->framebufferKey != this->readingKey;
+
+    this->isReading = true;
+    this->readingKey = this->framebufferKey;
+    this->readingPosition = pos;
+    return isNew;
+  }
+
+  bool update (Camera& camera, const Scene& scene, std::size_t key, const glm::ivec2& cursor)
+  {
+    const bool  changed = this->readPicked ();
+    const QSize size (int(camera.resolution ().x), int(camera.resolution ().y));
+
+    if (this->framebuffer == nullptr || this->framebuffer->size () != size ||
+        this->framebufferKey != key)
+    {
+      this->renderIndices (camera, scene, key, size);
+    }
+    const bool isNewPixel = this->readPixel (cursor);
+    return changed || isNewPixel;
+  }
+
+  DynamicMesh* dynamicMesh (Scene& scene, std::size_t key) const
+  {
+    DynamicMesh* picked = nullptr;
+
+    if (this->pickedIndex > 0 && this->pickedKey == key)
+    {
+      unsigned int index = 0;
+      scene.forEachMesh ([this, &picked, &index](DynamicMesh& mesh) {
+        index++;
+        if (index == this->pickedIndex)
+        {
+          picked = &mesh;
+        }
+      });
+    }
+    return picked;
+  }
+};
+
+DELEGATE_BIG2 (ViewPicking)
+DELEGATE4 (bool, ViewPicking, update, Camera&, const Scene&, std::size_t, const glm::ivec2&)
+DELEGATE2_CONST (DynamicMesh*, ViewPicking, dynamicMesh, Scene&, std::size_t)
@@ -0,0 +1,37 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_PICKING
+#define DILAY_VIEW_PICKING
+
+#include <cstddef>
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class Camera;
+class DynamicMesh;
+class Scene;
+
+/* GPU picking of dynamic meshes.  The indices of the dynamic meshes of a scene are rendered as
+ * colors into an offscreen framebuffer, which is only rendered again if the key of the scene
+ * changed.  The pixel below the cursor is read back asynchronously by a pixel buffer object,
+ * hence a pick lags one frame behind.  Picks are meant for hover feedback: precise hits are still
+ * computed by casting rays.
+ */
+class ViewPicking
+{
+public:
+  DECLARE_BIG2 (ViewPicking)
+
+  // requires a current context, returns true if the pick may change by another update
+  bool update (Camera&, const Scene&, std::size_t, const glm::ivec2&);
+
+  // returns nullptr if no mesh has been picked in the scene of the given key
+  DynamicMesh* dynamicMesh (Scene&, std::size_t) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
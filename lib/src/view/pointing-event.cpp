@@ -40,6 +40,7 @@ ViewPointingEvent::ViewPointingEvent (const QMouseEvent& event)
   , _position (glm::ivec2 (event.x (), event.y ()))
   , _prevPosition (_position)
   , _intensity (1.0f)
+  , _time (event.timestamp ())
 {
 }
 
@@ -52,6 +53,7 @@ ViewPointingEvent::ViewPointingEvent (const Config& config, const QTabletEvent&
   , _position (glm::ivec2 (event.x (), event.y ()))
   , _prevPosition (_position)
   , _intensity (config.get<float> ("editor/tablet-pressure-intensity") * event.pressure ())
+  , _time (event.timestamp ())
 {
 }
 
@@ -64,6 +66,7 @@ ViewPointingEvent::ViewPointingEvent (const ViewPointingEvent& e, const glm::ive
   , _position (e._position)
   , _prevPosition (prevPos)
   , _intensity (e._intensity)
+  , _time (e._time)
 {
 }
 
@@ -38,6 +38,9 @@ public:
 
   float intensity () const { return this->_intensity; }
 
+  // the time stamp of the event in milliseconds
+  unsigned long time () const { return this->_time; }
+
 private:
   Qt::KeyboardModifiers _modifiers;
   bool                  _pressEvent;
@@ -47,5 +50,6 @@ private:
   glm::ivec2            _position;
   glm::ivec2            _prevPosition;
   float                 _intensity;
+  unsigned long         _time;
 };
 #endif
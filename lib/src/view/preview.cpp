@@ -0,0 +1,189 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QBuffer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <glm/glm.hpp>
+#include <memory>
+#include "camera.hpp"
+#include "config.hpp"
+#include "idle-tasks.hpp"
+#include "import-export.hpp"
+#include "opengl-vertex-array-id.hpp"
+#include "opengl.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "util.hpp"
+#include "view/gl-widget.hpp"
+#include "view/preview.hpp"
+
+struct ViewPreview::Impl
+{
+  typedef std::unique_ptr<QOpenGLContext>    ContextPtr;
+  typedef std::unique_ptr<QOffscreenSurface> SurfacePtr;
+
+  ViewGlWidget& glWidget;
+  ContextPtr    context;
+  SurfacePtr    surface;
+  bool          isEmbedded;
+  IdleTask      embedding;
+
+  Impl (ViewGlWidget& w)
+    : glWidget (w)
+    , isEmbedded (false)
+  {
+  }
+
+  ~Impl () { this->wait (); }
+
+  static QImage fromFile (const QString& fileName)
+  {
+    const std::string data = ImportExport::readPreview (fileName.toStdString ());
+    QImage            image;
+
+    if (data.empty () == false)
+    {
+      image.loadFromData (reinterpret_cast<const uchar*> (data.data ()), int (data.size ()),
+                          "PNG");
+    }
+    return image;
+  }
+
+  // the context is created on demand, since most sessions save rarely
+  bool initialize ()
+  {
+    if (this->context == nullptr)
+    {
+      QOpenGLContext* mainContext = this->glWidget.context ();
+
+      if (mainContext == nullptr)
+      {
+        return false;
+      }
+      this->surface.reset (new QOffscreenSurface);
+      this->surface->setFormat (mainContext->format ());
+      this->surface->create ();
+
+      this->context.reset (new QOpenGLContext);
+      this->context->setFormat (mainContext->format ());
+      this->context->setShareContext (mainContext);
+
+      if (this->surface->isValid () == false || this->context->create () == false)
+      {
+        DILAY_WARN ("could not create offscreen context of previews")
+        this->context.reset ();
+        this->surface.reset ();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /* Vertex arrays are not shared, hence a single one is bound while rendering, whose attributes
+   * are specified by each mesh (cf. `ViewSideView`).
+   */
+  QImage render (unsigned int size)
+  {
+    QOpenGLContext* previousContext = QOpenGLContext::currentContext ();
+    QSurface*       previousSurface = previousContext ? previousContext->surface () : nullptr;
+
+    if (size == 0 || this->initialize () == false ||
+        this->context->makeCurrent (this->surface.get ()) == false)
+    {
+      return QImage ();
+    }
+
+    const Camera&       mainCamera = this->glWidget.state ().camera ();
+    Renderer&           renderer = mainCamera.renderer ();
+    Camera              camera (this->glWidget.state ().config (), renderer);
+    OpenGLVertexArrayId vertexArray;
+    QImage              image;
+
+    OpenGL::isSecondaryContext (true);
+    {
+      // the framebuffer must be deleted while the context is current
+      QOpenGLFramebufferObject framebuffer (QSize (int (size), int (size)),
+                                            QOpenGLFramebufferObject::Depth);
+      framebuffer.bind ();
+
+      camera.set (mainCamera.gazePoint (), mainCamera.toEyePoint ());
+      camera.updateResolution (glm::uvec2 (size));
+
+      if (OpenGL::hasVertexArrayObject ())
+      {
+        vertexArray.allocate ();
+        OpenGL::glBindVertexArray (vertexArray.id ());
+      }
+      renderer.setupRendering ();
+      this->glWidget.state ().scene ().render (camera);
+      renderer.shutdownRendering ();
+
+      if (vertexArray.isValid ())
+      {
+        OpenGL::glBindVertexArray (0);
+        vertexArray.reset ();
+      }
+      image = framebuffer.toImage ();
+      framebuffer.release ();
+    }
+    // the renderer is shared, hence the eye point of the main camera is restored
+    renderer.setEyePoint (mainCamera.position ());
+    OpenGL::isSecondaryContext (false);
+
+    // previews are rendered outside of `paintGL`, hence the previous context is restored
+    if (previousContext)
+    {
+      previousContext->makeCurrent (previousSurface);
+    }
+    else
+    {
+      this->context->doneCurrent ();
+    }
+    return image;
+  }
+
+  void embed (const std::string& fileName, unsigned int size)
+  {
+    this->wait ();
+
+    const QImage image = this->render (size);
+
+    if (image.isNull () == false)
+    {
+      // previews are encoded and embedded while the user is idle
+      this->embedding.schedule ([this, fileName, image]() {
+        QByteArray data;
+        QBuffer    buffer (&data);
+
+        buffer.open (QIODevice::WriteOnly);
+        this->isEmbedded = image.save (&buffer, "PNG") &&
+                           ImportExport::embedPreview (
+                             fileName, std::string (data.constData (), data.size ()));
+      });
+    }
+  }
+
+  void wait ()
+  {
+    if (this->embedding.isValid ())
+    {
+      this->embedding.wait ();
+      this->embedding.reset ();
+
+      if (this->isEmbedded == false)
+      {
+        DILAY_WARN ("could not embed preview")
+      }
+    }
+  }
+};
+
+DELEGATE1_BIG2 (ViewPreview, ViewGlWidget&)
+DELEGATE1_STATIC (QImage, ViewPreview, fromFile, const QString&)
+DELEGATE1 (QImage, ViewPreview, render, unsigned int)
+DELEGATE2 (void, ViewPreview, embed, const std::string&, unsigned int)
+DELEGATE (void, ViewPreview, wait)
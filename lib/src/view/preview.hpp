@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_PREVIEW
+#define DILAY_VIEW_PREVIEW
+
+#include <QImage>
+#include <string>
+#include "macro.hpp"
+
+class QString;
+class ViewGlWidget;
+
+/* Renders previews of the scene from the main camera into an offscreen surface.  Its context
+ * shares the buffers and programs of the main view, and meshes that are small in a preview are
+ * rendered by their LOD proxies.  Previews are encoded as PNG images and embedded into binary
+ * files by an idle task, cf. `ImportExport::embedPreview`.
+ */
+class ViewPreview
+{
+public:
+  DECLARE_BIG2 (ViewPreview, ViewGlWidget&)
+
+  // returns a null image if a file has no preview
+  static QImage fromFile (const QString&);
+
+  // renders a square preview, which is null if no offscreen context could be created
+  QImage render (unsigned int);
+  // renders a preview and embeds it asynchronously
+  void   embed (const std::string&, unsigned int);
+  void   wait ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
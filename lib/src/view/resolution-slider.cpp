@@ -2,18 +2,35 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <glm/glm.hpp>
 #include "view/resolution-slider.hpp"
 #include "view/util.hpp"
 
 struct ViewResolutionSlider::Impl
 {
-  Impl (ViewResolutionSlider* s, float min, float max)
+  ViewResolutionSlider* self;
+  const float           min;
+  const float           max;
+
+  Impl (ViewResolutionSlider* s, float mi, float ma)
+    : self (s)
+    , min (mi)
+    , max (ma)
   {
     ViewDoubleSlider* doubleSlider = s;
     ViewUtil::connect (*doubleSlider,
-                       [s, min, max](float r) { emit s->resolutionChanged (max + min - r); });
+                       [s, mi, ma](float r) { emit s->resolutionChanged (ma + mi - r); });
+  }
+
+  float resolution () const { return this->max + this->min - float(this->self->doubleValue ()); }
+
+  void setResolution (float r)
+  {
+    this->self->setDoubleValue (this->max + this->min - glm::clamp (r, this->min, this->max));
   }
 };
 
 DELEGATE_BIG2_BASE (ViewResolutionSlider, (float min, float max), (this, min, max),
                     ViewDoubleSlider, (2, 1))
+DELEGATE_CONST (float, ViewResolutionSlider, resolution)
+DELEGATE1 (void, ViewResolutionSlider, setResolution, float)
@@ -14,6 +14,10 @@ class ViewResolutionSlider : public ViewDoubleSlider
 public:
   DECLARE_BIG2 (ViewResolutionSlider, float, float)
 
+  // the slider shows fine resolutions to the right
+  float resolution () const;
+  void  setResolution (float);
+
 signals:
   void resolutionChanged (float);
 
@@ -0,0 +1,118 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QTimer>
+#include <glm/glm.hpp>
+#include <memory>
+#include "camera.hpp"
+#include "config.hpp"
+#include "frame-queue.hpp"
+#include "opengl-vertex-array-id.hpp"
+#include "opengl.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "state.hpp"
+#include "view/floor-plane.hpp"
+#include "view/gl-widget.hpp"
+#include "view/side-view.hpp"
+
+struct ViewSideView::Impl
+{
+  typedef std::unique_ptr<Camera> CameraPtr;
+
+  ViewSideView*       self;
+  ViewGlWidget&       glWidget;
+  CameraPtr           camera;
+  OpenGLVertexArrayId vertexArray;
+  QTimer              refreshTimer;
+
+  Impl (ViewSideView* s, ViewGlWidget& w)
+    : self (s)
+    , glWidget (w)
+  {
+    this->self->setAutoFillBackground (false);
+
+    this->refreshTimer.setSingleShot (true);
+    QObject::connect (&this->refreshTimer, &QTimer::timeout, [this]() { this->self->update (); });
+    QObject::connect (&this->glWidget, &QOpenGLWidget::frameSwapped, this->self,
+                      [this]() { this->requestUpdate (); });
+  }
+
+  ~Impl ()
+  {
+    this->self->makeCurrent ();
+    this->vertexArray.reset ();
+    this->self->doneCurrent ();
+  }
+
+  // frames of the main view are coalesced until the refresh interval elapsed
+  void requestUpdate ()
+  {
+    if (this->self->isVisible () && this->refreshTimer.isActive () == false)
+    {
+      this->refreshTimer.start (
+        this->glWidget.state ().config ().get<int> ("editor/side-view/refresh-interval"));
+    }
+  }
+
+  /* The view is initialized after the main view, whose renderer is shared.  Vertex arrays are
+   * not shared, hence a single one is bound while rendering, whose attributes are specified by
+   * each mesh.
+   */
+  void initializeGL ()
+  {
+    Camera& mainCamera = this->glWidget.state ().camera ();
+
+    this->camera.reset (new Camera (this->glWidget.state ().config (), mainCamera.renderer ()));
+    this->camera->orthographic (true);
+
+    if (OpenGL::hasVertexArrayObject ())
+    {
+      this->vertexArray.allocate ();
+    }
+  }
+
+  void resizeGL (int w, int h)
+  {
+    assert (this->camera);
+    this->camera->updateResolution (glm::uvec2 (w, h));
+  }
+
+  void paintGL ()
+  {
+    assert (this->camera);
+
+    const Camera& mainCamera = this->glWidget.state ().camera ();
+    Renderer&     renderer = this->camera->renderer ();
+
+    this->camera->set (mainCamera.gazePoint (),
+                       glm::length (mainCamera.toEyePoint ()) * mainCamera.right ());
+
+    OpenGL::isSecondaryContext (true);
+
+    if (this->vertexArray.isValid ())
+    {
+      OpenGL::glBindVertexArray (this->vertexArray.id ());
+    }
+    renderer.setupRendering ();
+    this->glWidget.state ().scene ().render (*this->camera);
+    this->glWidget.floorPlane ().render (*this->camera);
+    renderer.shutdownRendering ();
+
+    if (this->vertexArray.isValid ())
+    {
+      OpenGL::glBindVertexArray (0);
+    }
+    // the renderer is shared, hence the eye point of the main camera is restored
+    renderer.setEyePoint (mainCamera.position ());
+    FrameQueue::endFrame ();
+
+    OpenGL::isSecondaryContext (false);
+  }
+};
+
+DELEGATE1_BIG2_SELF (ViewSideView, ViewGlWidget&)
+DELEGATE (void, ViewSideView, initializeGL)
+DELEGATE2 (void, ViewSideView, resizeGL, int, int)
+DELEGATE (void, ViewSideView, paintGL)
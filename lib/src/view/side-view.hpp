@@ -0,0 +1,32 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VIEW_SIDE_VIEW
+#define DILAY_VIEW_SIDE_VIEW
+
+#include <QOpenGLWidget>
+#include "macro.hpp"
+
+class ViewGlWidget;
+
+/* An orthographic view of the scene from the right of the main camera.  Its context shares the
+ * buffers and programs of the main view, which are thus uploaded and compiled only once.  The
+ * view follows the frames of the main view at the rate of `editor/side-view/refresh-interval`.
+ */
+class ViewSideView : public QOpenGLWidget
+{
+  Q_OBJECT
+public:
+  DECLARE_BIG2 (ViewSideView, ViewGlWidget&)
+
+protected:
+  void initializeGL ();
+  void resizeGL (int, int);
+  void paintGL ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
@@ -92,9 +92,11 @@ struct ViewToolPane::Impl
     this->addToolButton (ToolKey::SculptSmooth, toolPaneLayout, QObject::tr ("Smooth"));
     this->addToolButton (ToolKey::SculptFlatten, toolPaneLayout, QObject::tr ("Flatten"));
     this->addToolButton (ToolKey::SculptReduce, toolPaneLayout, QObject::tr ("Reduce"));
+    this->addToolButton (ToolKey::SculptFreeze, toolPaneLayout, QObject::tr ("Freeze"));
     toolPaneLayout->addWidget (&ViewUtil::horizontalLine ());
     this->addToolButton (ToolKey::Remesh, toolPaneLayout, QObject::tr ("Remesh"));
     this->addToolButton (ToolKey::TrimMesh, toolPaneLayout, QObject::tr ("Trim"));
+    this->addToolButton (ToolKey::DecimateMesh, toolPaneLayout, QObject::tr ("Decimate"));
 
     toolPaneLayout->addStretch (1);
 
@@ -183,6 +183,22 @@ QPoint ViewUtil::toQPoint (const glm::uvec2& p) { return QPoint (int(p.x), int(p
 
 QPoint ViewUtil::toQPoint (const glm::ivec2& p) { return QPoint (p.x, p.y); }
 
+QString ViewUtil::byteSize (std::size_t n)
+{
+  if (n < 1024)
+  {
+    return QObject::tr ("%1 B").arg (n);
+  }
+  else if (n < 1024 * 1024)
+  {
+    return QObject::tr ("%1 KiB").arg (double(n) / 1024.0, 0, 'f', 1);
+  }
+  else
+  {
+    return QObject::tr ("%1 MiB").arg (double(n) / (1024.0 * 1024.0), 0, 'f', 1);
+  }
+}
+
 void ViewUtil::connect (const QSpinBox& s, const std::function<void(int)>& f)
 {
   void (QSpinBox::*ptr) (int) = &QSpinBox::valueChanged;
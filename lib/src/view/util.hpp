@@ -5,6 +5,7 @@
 #ifndef VIEW_UTIL
 #define VIEW_UTIL
 
+#include <cstddef>
 #include <functional>
 #include <glm/fwd.hpp>
 #include <vector>
@@ -52,6 +53,7 @@ namespace ViewUtil
   glm::ivec2            toIVec2 (const QPoint&);
   QPoint                toQPoint (const glm::uvec2&);
   QPoint                toQPoint (const glm::ivec2&);
+  QString               byteSize (std::size_t);
   void                  connect (const QSpinBox&, const std::function<void(int)>&);
   void                  connect (const QDoubleSpinBox&, const std::function<void(double)>&);
   void                  connect (const QPushButton&, const std::function<void()>&);
@@ -3,33 +3,179 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCoreApplication>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include "parallel.hpp"
 #include "test-bitset.hpp"
+#include "test-bvh.hpp"
 #include "test-distance.hpp"
+#include "test-import-export.hpp"
 #include "test-intersection.hpp"
 #include "test-maybe.hpp"
+#include "test-mesh.hpp"
 #include "test-misc.hpp"
 #include "test-octree.hpp"
+#include "test-opengl.hpp"
+#include "test-parallel.hpp"
+#include "test-performance.hpp"
 #include "test-prune.hpp"
 #include "test-tree.hpp"
 
-int main ()
+namespace
+{
+  void usage ()
+  {
+    std::cerr << "usage: run-tests [--opengl] [--performance [--threads N] [--budgets FILE] "
+                 "[--tolerance T]]\n"
+              << "  --opengl       also runs tests that need an OpenGL context, i.e., a display\n"
+              << "  --performance  runs performance scenarios instead of functional tests\n"
+              << "  --threads N    number of threads (all cores by default)\n"
+              << "  --budgets FILE overrides budgets by lines `NAME MILLISECONDS MEGABYTES`\n"
+              << "  --tolerance T  relative tolerance of budgets (0.2)\n";
+  }
+
+  bool parseNumThreads (const std::string& arg, unsigned int& numThreads)
+  {
+    try
+    {
+      std::size_t end;
+      const int   n = std::stoi (arg, &end);
+      const bool  isValid = end == arg.size () && n >= 0;
+
+      if (isValid)
+      {
+        numThreads = (unsigned int) n;
+      }
+      return isValid;
+    }
+    catch (const std::invalid_argument&)
+    {
+      return false;
+    }
+    catch (const std::out_of_range&)
+    {
+      return false;
+    }
+  }
+
+  bool parseTolerance (const std::string& arg, float& tolerance)
+  {
+    try
+    {
+      std::size_t end;
+      const float t = std::stof (arg, &end);
+      const bool  isValid = end == arg.size () && std::isfinite (t) && t >= 0.0f;
+
+      if (isValid)
+      {
+        tolerance = t;
+      }
+      return isValid;
+    }
+    catch (const std::invalid_argument&)
+    {
+      return false;
+    }
+    catch (const std::out_of_range&)
+    {
+      return false;
+    }
+  }
+}
+
+int main (int argc, char** argv)
 {
   QCoreApplication::setApplicationName ("dilay");
 
+  bool         opengl = false;
+  bool         performance = false;
+  unsigned int numThreads = 0;
+  std::string  budgets;
+  float        tolerance = 0.2f;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg (argv[i]);
+
+    if (arg == "--opengl")
+    {
+      opengl = true;
+    }
+    else if (arg == "--performance")
+    {
+      performance = true;
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+    {
+      if (parseNumThreads (argv[++i], numThreads) == false)
+      {
+        usage ();
+        return 1;
+      }
+    }
+    else if (arg == "--budgets" && i + 1 < argc)
+    {
+      budgets = argv[++i];
+    }
+    else if (arg == "--tolerance" && i + 1 < argc)
+    {
+      if (parseTolerance (argv[++i], tolerance) == false)
+      {
+        usage ();
+        return 1;
+      }
+    }
+    else
+    {
+      usage ();
+      return 1;
+    }
+  }
+
+  if (performance)
+  {
+    Parallel::initialize (numThreads);
+
+    if (TestPerformance::test (budgets, tolerance) == false)
+    {
+      std::cout << "performance budgets exceeded\n";
+      return 1;
+    }
+    std::cout << "all performance budgets met\n";
+    return 0;
+  }
+
   TestIntersection::test1 ();
   TestIntersection::test2 ();
+  TestIntersection::test3 ();
   TestMaybe::test1 ();
   TestMaybe::test2 ();
   TestMaybe::test3 ();
+  TestMaybe::test4 ();
+  TestMesh::test ();
   TestOctree::test ();
+  TestBvh::test ();
   TestBitset::test ();
   TestTree::test1 ();
   TestTree::test2 ();
   TestTree::test3 ();
+  TestTree::test4 ();
   TestMisc::test ();
   TestDistance::test ();
+  TestDistance::testBatches ();
   TestPrune::test ();
+  TestParallel::test ();
+  TestImportExport::testMeshFiles ();
+  TestImportExport::testBinaryFiles ();
+  TestImportExport::testCompressedFiles ();
+  TestImportExport::testIncrementalFiles ();
+
+  if (opengl)
+  {
+    TestOpenGL::test (argc, argv);
+  }
 
   std::cout << "all tests ran successfully\n";
   return 0;
@@ -0,0 +1,135 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "bvh.hpp"
+#include "intersection.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "test-bvh.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // returns the distance to the nearest box hit by the ray
+  float nearestBox (const std::vector<PrimAABox>& boxes, const PrimRay& ray, const Bvh* bvh)
+  {
+    float distance = Util::maxFloat ();
+
+    const auto check = [&boxes, &ray, &distance](unsigned int i) {
+      float t;
+      if (IntersectionUtil::intersects (ray, boxes[i], &t))
+      {
+        distance = glm::min (distance, glm::max (0.0f, t));
+      }
+      return distance;
+    };
+
+    if (bvh)
+    {
+      bvh->intersects (ray, check);
+    }
+    else
+    {
+      for (unsigned int i = 0; i < boxes.size (); i++)
+      {
+        check (i);
+      }
+    }
+    return distance;
+  }
+
+  // returns the distance to the nearest box center
+  float nearestCenter (const std::vector<PrimAABox>& boxes, const glm::vec3& p, const Bvh* bvh)
+  {
+    const auto distance = [&boxes, &p](unsigned int i) {
+      return glm::distance (p, boxes[i].center ());
+    };
+
+    if (bvh)
+    {
+      return bvh->distance (p, distance);
+    }
+    else
+    {
+      float min = Util::maxFloat ();
+      for (unsigned int i = 0; i < boxes.size (); i++)
+      {
+        min = glm::min (min, distance (i));
+      }
+      return min;
+    }
+  }
+
+  void testBoxes (unsigned int numBoxes)
+  {
+    const unsigned int numQueries = 1000;
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-10.0f, 10.0f);
+    std::uniform_real_distribution<float> sizeD (0.01f, 1.0f);
+
+    std::vector<PrimAABox> boxes;
+    std::vector<PrimAABox> movedBoxes;
+    for (unsigned int i = 0; i < numBoxes; i++)
+    {
+      const glm::vec3 center (posD (gen), posD (gen), posD (gen));
+      const glm::vec3 movedCenter = center + glm::vec3 (1.0f);
+      const glm::vec3 size (sizeD (gen), sizeD (gen), sizeD (gen));
+
+      boxes.emplace_back (center - size, center + size);
+      movedBoxes.emplace_back (movedCenter - size, movedCenter + (2.0f * size));
+    }
+
+    Bvh bvh;
+    bvh.build (numBoxes, [&boxes](unsigned int i) { return boxes[i]; });
+    assert (bvh.numElements () == numBoxes);
+
+    for (unsigned int i = 0; i < numQueries; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+      const PrimRay   ray (p, glm::normalize (glm::vec3 (posD (gen), posD (gen), posD (gen))));
+
+      assert (nearestBox (boxes, ray, &bvh) == nearestBox (boxes, ray, nullptr));
+      assert (nearestCenter (boxes, p, &bvh) == nearestCenter (boxes, p, nullptr));
+    }
+
+    bvh.refit ([&movedBoxes](unsigned int i) { return movedBoxes[i]; });
+
+    for (unsigned int i = 0; i < numQueries; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+      const PrimRay   ray (p, glm::normalize (glm::vec3 (posD (gen), posD (gen), posD (gen))));
+
+      assert (nearestBox (movedBoxes, ray, &bvh) == nearestBox (movedBoxes, ray, nullptr));
+      assert (nearestCenter (movedBoxes, p, &bvh) == nearestCenter (movedBoxes, p, nullptr));
+    }
+
+    // moves some boxes back and refits their leaves only
+    std::vector<unsigned int> changed;
+    for (unsigned int i = 0; i < numBoxes; i += 7)
+    {
+      movedBoxes[i] = boxes[i];
+      changed.push_back (i);
+    }
+    bvh.refit (changed, [&movedBoxes](unsigned int i) { return movedBoxes[i]; });
+
+    for (unsigned int i = 0; i < numQueries; i++)
+    {
+      const glm::vec3 p (posD (gen), posD (gen), posD (gen));
+      const PrimRay   ray (p, glm::normalize (glm::vec3 (posD (gen), posD (gen), posD (gen))));
+
+      assert (nearestBox (movedBoxes, ray, &bvh) == nearestBox (movedBoxes, ray, nullptr));
+      assert (nearestCenter (movedBoxes, p, &bvh) == nearestCenter (movedBoxes, p, nullptr));
+    }
+  }
+}
+
+void TestBvh::test ()
+{
+  testBoxes (1000);
+  testBoxes (20000);
+}
@@ -4,8 +4,17 @@
  */
 #include <glm/glm.hpp>
 #include <glm/gtc/epsilon.hpp>
+#include <random>
+#include <vector>
 #include "distance.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/cone-sphere-block.hpp"
+#include "primitive/cone-sphere.hpp"
 #include "primitive/cylinder.hpp"
+#include "primitive/triangle-block.hpp"
+#include "primitive/triangle.hpp"
+#include "sketch/path.hpp"
+#include "sketch/primitives.hpp"
 #include "test-distance.hpp"
 #include "util.hpp"
 
@@ -31,5 +40,148 @@ void TestDistance::test ()
                              glm::sqrt ((1.5f * 1.5f) + (2.0f * 2.0f)), eps));
   assert (glm::epsilonEqual (distance (cyl, glm::vec3 (2.0f, 2.0f, 0.0f)),
                              glm::sqrt ((1.5f * 1.5f) + (1.0f * 1.0f)), eps));
+
+  const PrimSphere s1 (glm::vec3 (0.0f), 1.0f);
+  const PrimSphere s2 (glm::vec3 (2.0f, 0.0f, 0.0f), 0.5f);
+  const PrimSphere s3 (glm::vec3 (2.0f, 2.0f, 0.0f), 0.5f);
+  const PrimSphere s4 (glm::vec3 (2.0f, 0.2f, 0.0f), 0.1f);
+
+  SketchTree tree;
+  tree.emplaceRoot (s1).emplaceChild (s2).emplaceChild (s3).emplaceChild (s4);
+
+  SketchPrimitives primitives;
+  primitives.build (tree, SketchPaths ());
+
+  std::vector<glm::vec3> positions;
+  for (unsigned int i = 0; i < 27; i++)
+  {
+    positions.emplace_back (-1.5f + (0.27f * float(i)), 0.1f * float(i % 7), 0.3f - (0.05f * float(i)));
+  }
+
+  std::vector<float> distances;
+  primitives.distances (positions, distances);
+
+  for (unsigned int i = 0; i < positions.size (); i++)
+  {
+    const glm::vec3& p = positions[i];
+    const float      d = glm::min (glm::min (distance (PrimConeSphere (s2, s1), p),
+                                             distance (PrimConeSphere (s3, s2), p)),
+                                   glm::min (distance (PrimConeSphere (s4, s3), p),
+                                             distance (s1, p)));
+
+    assert (glm::epsilonEqual (primitives.distance (p), d, eps));
+    assert (glm::epsilonEqual (distances[i], d, eps));
+  }
+
+  std::vector<float> blended;
+  primitives.distances (positions, blended, 0.2f);
+
+  for (unsigned int i = 0; i < positions.size (); i++)
+  {
+    assert (blended[i] <= distances[i] + eps);
+  }
+
+  const PrimAABox box (glm::vec3 (3.0f, 3.0f, 0.0f), glm::vec3 (4.0f, 4.0f, 1.0f));
+  assert (primitives.isNear (box, 0.1f) == false);
+  assert (primitives.isNear (box, 1.0f));
+
+  const glm::vec3    t1 (0.0f, 0.0f, 0.0f);
+  const glm::vec3    t2 (1.0f, 0.0f, 0.0f);
+  const glm::vec3    t3 (0.0f, 1.0f, 0.0f);
+  const PrimTriangle tri (t1, t2, t3);
+
+  assert (glm::all (glm::epsilonEqual (Distance::nearestPoint (tri, glm::vec3 (0.2f, 0.2f, 1.0f)),
+                                       glm::vec3 (0.2f, 0.2f, 0.0f), eps)));
+  assert (glm::all (glm::epsilonEqual (Distance::nearestPoint (tri, glm::vec3 (1.0f, 1.0f, 0.0f)),
+                                       glm::vec3 (0.5f, 0.5f, 0.0f), eps)));
+  assert (glm::all (glm::epsilonEqual (Distance::nearestPoint (tri, glm::vec3 (-1.0f, -1.0f, 0.5f)),
+                                       t1, eps)));
+  unused (eps);
+}
+
+// batches must agree with the scalar distances
+void TestDistance::testBatches ()
+{
+  using Distance::distance;
+
+  const float        eps = 10.0f * Util::epsilon ();
+  const unsigned int numBatches = 100;
+
+  std::default_random_engine            gen;
+  std::uniform_real_distribution<float> posD (-1.0f, 1.0f);
+  std::uniform_real_distribution<float> radiusD (0.05f, 0.5f);
+
+  const auto randomVec = [&gen, &posD]() { return glm::vec3 (posD (gen), posD (gen), posD (gen)); };
+
+  std::vector<glm::vec3> points;
+  for (unsigned int i = 0; i < 50; i++)
+  {
+    points.push_back (2.0f * randomVec ());
+  }
+
+  for (unsigned int b = 0; b < numBatches; b++)
+  {
+    std::vector<glm::vec3>      vertices;
+    std::vector<PrimConeSphere> coneSpheres;
+    PrimTriangleBlock           triangles;
+    PrimConeSphereBlock         cones;
+
+    for (unsigned int i = 0; i < 3 * PrimTriangleBlock::maxTriangles; i++)
+    {
+      vertices.push_back (randomVec ());
+    }
+    for (unsigned int i = 0; i < PrimTriangleBlock::maxTriangles; i++)
+    {
+      triangles.add (PrimTriangle (vertices[(3 * i) + 0], vertices[(3 * i) + 1],
+                                   vertices[(3 * i) + 2]));
+    }
+    for (unsigned int i = 0; i < PrimConeSphereBlock::maxConeSpheres; i++)
+    {
+      // every fourth cone-sphere has equal radii
+      const float r1 = radiusD (gen);
+      const float r2 = i % 4 == 0 ? r1 : radiusD (gen);
+
+      coneSpheres.emplace_back (PrimSphere (randomVec (), r1), PrimSphere (randomVec (), r2));
+      cones.add (coneSpheres.back ());
+    }
+
+    for (const glm::vec3& p : points)
+    {
+      float minTriangle = Util::maxFloat ();
+      for (unsigned int i = 0; i < PrimTriangleBlock::maxTriangles; i++)
+      {
+        minTriangle = glm::min (minTriangle, distance (PrimTriangle (vertices[(3 * i) + 0],
+                                                                     vertices[(3 * i) + 1],
+                                                                     vertices[(3 * i) + 2]),
+                                                       p));
+      }
+      assert (glm::epsilonEqual (distance (triangles, p), minTriangle, eps));
+
+      float minCone = Util::maxFloat ();
+      for (const PrimConeSphere& c : coneSpheres)
+      {
+        minCone = glm::min (minCone, distance (c, p));
+      }
+      unsigned int nearest;
+      assert (glm::epsilonEqual (distance (cones, p, &nearest), minCone, eps));
+      assert (glm::epsilonEqual (distance (coneSpheres[nearest], p), minCone, eps));
+      unused (nearest);
+    }
+
+    const PrimTriangle tri (vertices[0], vertices[1], vertices[2]);
+    std::vector<float> distances;
+
+    Distance::distances (tri, points, distances);
+    for (unsigned int i = 0; i < points.size (); i++)
+    {
+      assert (glm::epsilonEqual (distances[i], distance (tri, points[i]), eps));
+    }
+
+    Distance::distances (coneSpheres[0], points, distances);
+    for (unsigned int i = 0; i < points.size (); i++)
+    {
+      assert (glm::epsilonEqual (distances[i], distance (coneSpheres[0], points[i]), eps));
+    }
+  }
   unused (eps);
 }
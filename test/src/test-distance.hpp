@@ -8,6 +8,7 @@
 namespace TestDistance
 {
   void test ();
+  void testBatches ();
 }
 
 #endif
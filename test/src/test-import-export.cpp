@@ -0,0 +1,226 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QFile>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "mesh-util.hpp"
+#include "primitive/sphere.hpp"
+#include "scene.hpp"
+#include "sketch/mesh.hpp"
+#include "test-import-export.hpp"
+#include "util.hpp"
+
+namespace
+{
+  std::vector<glm::vec3> vertices (const Scene& scene)
+  {
+    std::vector<glm::vec3> result;
+
+    scene.forEachConstMesh ([&result](const DynamicMesh& mesh) {
+      mesh.forEachVertex ([&mesh, &result](unsigned int i) { result.push_back (mesh.vertex (i)); });
+    });
+    return result;
+  }
+
+  // imported meshes are reordered, hence vertices are compared regardless of their order
+  bool equals (const Scene& scene1, const Scene& scene2)
+  {
+    const std::vector<glm::vec3> vertices1 = vertices (scene1);
+    const std::vector<glm::vec3> vertices2 = vertices (scene2);
+
+    return scene1.numFaces () == scene2.numFaces () && vertices1.size () == vertices2.size () &&
+           std::all_of (vertices2.begin (), vertices2.end (), [&vertices1](const glm::vec3& v) {
+             return std::any_of (vertices1.begin (), vertices1.end (), [&v](const glm::vec3& w) {
+               return glm::distance (v, w) < Util::epsilon ();
+             });
+           });
+  }
+
+  unsigned int numSketchNodes (const Scene& scene)
+  {
+    unsigned int n = 0;
+
+    scene.forEachConstMesh ([&n](const SketchMesh& mesh) {
+      n += mesh.tree ().hasRoot () ? mesh.tree ().root ().numNodes () : 0;
+    });
+    return n;
+  }
+
+  bool loads (const Config& config, const Scene& scene, const std::string& fileName)
+  {
+    Scene loaded (config);
+
+    return ImportExport::fromDlyFile (fileName, config, loaded) && equals (scene, loaded);
+  }
+
+  bool rejectsTruncated (const Config& config, const std::string& fileName, Scene& scene)
+  {
+    QFile file (QString::fromStdString (fileName));
+
+    return file.resize (file.size () / 2) &&
+           ImportExport::fromDlyFile (fileName, config, scene) == false;
+  }
+
+  bool toAsciiStlFile (const DynamicMesh& mesh, const std::string& fileName)
+  {
+    std::ofstream file (fileName);
+
+    file << std::setprecision (9) << "solid test\n";
+    mesh.forEachFace ([&mesh, &file](unsigned int f) {
+      unsigned int i[3];
+      mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+      file << "  facet normal 0 0 0\n    outer loop\n";
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        const glm::vec3& v = mesh.vertex (i[j]);
+        file << "      vertex " << v.x << " " << v.y << " " << v.z << "\n";
+      }
+      file << "    endloop\n  endfacet\n";
+    });
+    file << "endsolid test\n";
+    return bool(file);
+  }
+}
+
+void TestImportExport::testMeshFiles ()
+{
+  QTemporaryDir      dir;
+  Config             config;
+  Scene              scene (config);
+  const DynamicMesh& mesh = scene.newDynamicMesh (config, MeshUtil::icosphere (2));
+  const std::string  binaryStl = dir.filePath ("binary.stl").toStdString ();
+  const std::string  asciiStl = dir.filePath ("ascii.stl").toStdString ();
+  const std::string  ply = dir.filePath ("mesh.ply").toStdString ();
+
+  const bool isBinaryStlSaved = ImportExport::toDlyFile (binaryStl, scene, false);
+  const bool isAsciiStlSaved = toAsciiStlFile (mesh, asciiStl);
+  const bool isPlySaved = ImportExport::toDlyFile (ply, scene, false);
+
+  assert (dir.isValid ());
+  assert (isBinaryStlSaved && loads (config, scene, binaryStl));
+  assert (isAsciiStlSaved && loads (config, scene, asciiStl));
+  assert (isPlySaved && loads (config, scene, ply));
+
+  for (const std::string& fileName : {binaryStl, asciiStl, ply})
+  {
+    Scene      loaded (config);
+    const bool isRejected = rejectsTruncated (config, fileName, loaded);
+
+    assert (isRejected && loaded.isEmpty ());
+    unused (isRejected);
+  }
+  unused (isBinaryStlSaved);
+  unused (isAsciiStlSaved);
+  unused (isPlySaved);
+  unused (loads);
+}
+
+void TestImportExport::testBinaryFiles ()
+{
+  QTemporaryDir     dir;
+  Config            config;
+  Scene             scene (config);
+  Scene             loaded (config);
+  const std::string fileName = dir.filePath ("scene.dly").toStdString ();
+
+  scene.newDynamicMesh (config, MeshUtil::icosphere (2));
+  scene.newDynamicMesh (config, MeshUtil::icosphere (1));
+  scene.newSketchMesh (config, SketchTree ())
+    .tree ()
+    .emplaceRoot (PrimSphere (glm::vec3 (0.0f), 1.0f))
+    .emplaceChild (PrimSphere (glm::vec3 (1.0f, 0.0f, 0.0f), 0.5f));
+
+  const bool isSaved = ImportExport::toDlyFile (fileName, scene, false);
+  const bool isLoaded = ImportExport::fromDlyFile (fileName, config, loaded);
+
+  assert (dir.isValid ());
+  assert (isSaved && isLoaded);
+  assert (loaded.numDynamicMeshes () == 2 && equals (scene, loaded));
+  assert (loaded.numSketchMeshes () == 1 && numSketchNodes (loaded) == 2);
+
+  // a truncated file leaves the scene untouched
+  const bool isRejected = rejectsTruncated (config, fileName, loaded);
+
+  assert (isRejected);
+  assert (loaded.numDynamicMeshes () == 2 && equals (scene, loaded));
+  assert (loaded.numSketchMeshes () == 1 && numSketchNodes (loaded) == 2);
+  unused (isSaved);
+  unused (isLoaded);
+  unused (isRejected);
+  unused (numSketchNodes);
+}
+
+void TestImportExport::testCompressedFiles ()
+{
+  QTemporaryDir     dir;
+  Config            config;
+  Config            compressedConfig;
+  const std::string fileName = dir.filePath ("scene.dly").toStdString ();
+  const std::string compressedFileName = dir.filePath ("compressed.dly").toStdString ();
+
+  compressedConfig.set ("editor/compress-files", true);
+
+  Scene scene (config);
+  Scene compressedScene (compressedConfig);
+  Scene loaded (config);
+
+  scene.newDynamicMesh (config, MeshUtil::icosphere (3));
+  compressedScene.newDynamicMesh (compressedConfig, MeshUtil::icosphere (3));
+
+  const bool isSaved = ImportExport::toDlyFile (fileName, scene, false);
+  const bool isCompressedSaved =
+    ImportExport::toDlyFile (compressedFileName, compressedScene, false);
+  const bool isLoaded = ImportExport::fromDlyFile (compressedFileName, config, loaded);
+
+  assert (dir.isValid ());
+  assert (isSaved && isCompressedSaved && isLoaded);
+  assert (QFile (QString::fromStdString (compressedFileName)).size () <
+          QFile (QString::fromStdString (fileName)).size ());
+  assert (loaded.numDynamicMeshes () == 1 && equals (scene, loaded));
+  unused (isSaved);
+  unused (isCompressedSaved);
+  unused (isLoaded);
+}
+
+void TestImportExport::testIncrementalFiles ()
+{
+  QTemporaryDir     dir;
+  Config            config;
+  Scene             scene (config);
+  Scene             loaded (config);
+  const std::string fileName = dir.filePath ("scene.dly").toStdString ();
+  const QFile       file (QString::fromStdString (fileName));
+
+  scene.newDynamicMesh (config, MeshUtil::icosphere (3));
+  DynamicMesh& edited = scene.newDynamicMesh (config, MeshUtil::icosphere (1));
+
+  const bool   isSaved = ImportExport::toDlyFile (fileName, scene, false);
+  const qint64 size = file.size ();
+
+  edited.vertex (0, edited.vertex (0) * 2.0f);
+
+  // only the chunk of the edited mesh is appended to the existing file
+  const bool isUpdated = ImportExport::toDlyFile (fileName, scene, false);
+  const bool isLoaded = ImportExport::fromDlyFile (fileName, config, loaded);
+
+  assert (dir.isValid ());
+  assert (isSaved && isUpdated && isLoaded);
+  assert (file.size () > size);
+  assert (loaded.numDynamicMeshes () == 2 && equals (scene, loaded));
+  unused (isSaved);
+  unused (isUpdated);
+  unused (isLoaded);
+  unused (size);
+}
@@ -3,6 +3,8 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <random>
+#include <vector>
 #include "intersection.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone.hpp"
@@ -10,6 +12,7 @@
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
 #include "primitive/sphere.hpp"
+#include "primitive/triangle-block.hpp"
 #include "primitive/triangle.hpp"
 #include "test-intersection.hpp"
 #include "util.hpp"
@@ -117,3 +120,58 @@ void TestIntersection::test2 ()
   assert (i2.position () == glm::vec3 (2.0f));
   assert (i2.normal () == glm::vec3 (2.0f));
 }
+
+// a block must find the nearest of its triangles that are hit by single tests
+void TestIntersection::test3 ()
+{
+  const unsigned int numBlocks = 1000;
+
+  std::default_random_engine            gen;
+  std::uniform_real_distribution<float> posD (-1.0f, 1.0f);
+
+  const auto randomVec = [&gen, &posD]() { return glm::vec3 (posD (gen), posD (gen), posD (gen)); };
+
+  for (unsigned int b = 0; b < numBlocks; b++)
+  {
+    const PrimRay          ray (b % 2 == 0, 3.0f * randomVec (), randomVec ());
+    const bool             both = b % 3 == 0;
+    std::vector<glm::vec3> vertices;
+    PrimTriangleBlock      block;
+
+    for (unsigned int i = 0; i < 3 * PrimTriangleBlock::maxTriangles; i++)
+    {
+      vertices.push_back (randomVec ());
+    }
+
+    float        nearestT = Util::maxFloat ();
+    unsigned int nearest = Util::invalidIndex ();
+    for (unsigned int i = 0; i < PrimTriangleBlock::maxTriangles; i++)
+    {
+      const PrimTriangle tri (vertices[(3 * i) + 0], vertices[(3 * i) + 1],
+                              vertices[(3 * i) + 2]);
+      float              t;
+
+      block.add (tri);
+      if (IntersectionUtil::intersects (ray, tri, both, &t) && t < nearestT)
+      {
+        nearestT = t;
+        nearest = i;
+      }
+    }
+    assert (block.isFull ());
+
+    float        t;
+    unsigned int index;
+    if (IntersectionUtil::intersects (ray, block, both, &t, &index))
+    {
+      assert (index == nearest);
+      assert (glm::abs (t - nearestT) < Util::epsilon ());
+    }
+    else
+    {
+      assert (nearest == Util::invalidIndex ());
+    }
+    unused (t);
+    unused (index);
+  }
+}
@@ -89,3 +89,46 @@ void TestMaybe::test3 ()
   assert (m2.hasValue ());
   assert (*m2 == 5);
 }
+
+void TestMaybe::test4 ()
+{
+  MaybeInline<int> m1 (5);
+
+  assert (m1.hasValue ());
+  assert (*m1 == 5);
+
+  MaybeInline<int> m2 (m1);
+
+  assert (*m1 == 5);
+  assert (*m2 == 5);
+
+  MaybeInline<int> m3 (std::move (m1));
+
+  assert (m1.hasValue () == false);
+  assert (*m3 == 5);
+
+  m2 = 12;
+  m3 = std::move (m2);
+
+  assert (m2.hasValue () == false);
+  assert (*m3 == 12);
+
+  m3 = m2;
+
+  assert (m3.hasValue () == false);
+
+  m3 = 44;
+  m3.swap (m2);
+
+  assert (m3.hasValue () == false);
+  assert (*m2 == 44);
+
+  MaybeInline<Foo> m4 = MaybeInline<Foo>::make (7);
+
+  assert (m4->data () == 7);
+
+  m4.reset ();
+
+  assert (m4.hasValue () == false);
+  assert (m4.get () == nullptr);
+}
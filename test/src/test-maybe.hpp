@@ -10,6 +10,7 @@ namespace TestMaybe
   void test1 ();
   void test2 ();
   void test3 ();
+  void test4 ();
 }
 
 #endif
@@ -0,0 +1,326 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include "dynamic/mesh-changes.hpp"
+#include "dynamic/mesh-layers.hpp"
+#include "dynamic/mesh-snapshot.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "test-mesh.hpp"
+#include "util.hpp"
+
+namespace
+{
+  bool hasScannedBounds (const Mesh& mesh)
+  {
+    glm::vec3 min = glm::vec3 (Util::maxFloat ());
+    glm::vec3 max = glm::vec3 (Util::minFloat ());
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      min = glm::min (min, mesh.vertex (i));
+      max = glm::max (max, mesh.vertex (i));
+    }
+    return mesh.bounds ().minimum () == min && mesh.bounds ().maximum () == max;
+  }
+
+  // the positions of the faces' vertices in sorted order
+  std::vector<std::array<float, 9>> facePositions (const DynamicMesh& mesh)
+  {
+    std::vector<std::array<float, 9>> positions;
+
+    mesh.forEachFace ([&mesh, &positions](unsigned int f) {
+      unsigned int i[3];
+      mesh.vertexIndices (f, i[0], i[1], i[2]);
+
+      positions.emplace_back ();
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        for (unsigned int k = 0; k < 3; k++)
+        {
+          positions.back ()[(3 * j) + k] = mesh.vertex (i[j])[k];
+        }
+      }
+    });
+    std::sort (positions.begin (), positions.end ());
+    return positions;
+  }
+
+  // compares the used vertices and faces of both meshes index by index
+  bool hasSameElements (const DynamicMesh& mesh1, const DynamicMesh& mesh2)
+  {
+    bool result = mesh1.numVertices () == mesh2.numVertices () &&
+                  mesh1.numFaces () == mesh2.numFaces ();
+
+    mesh1.forEachVertex ([&mesh1, &mesh2, &result](unsigned int i) {
+      result = result && i < mesh2.vertexCapacity () && mesh2.isFreeVertex (i) == false &&
+               mesh1.vertex (i) == mesh2.vertex (i);
+    });
+    mesh1.forEachFace ([&mesh1, &mesh2, &result](unsigned int f) {
+      unsigned int i1[3], i2[3];
+
+      result = result && f < mesh2.faceCapacity () && mesh2.isFreeFace (f) == false;
+      if (result)
+      {
+        mesh1.vertexIndices (f, i1[0], i1[1], i1[2]);
+        mesh2.vertexIndices (f, i2[0], i2[1], i2[2]);
+        result = i1[0] == i2[0] && i1[1] == i2[1] && i1[2] == i2[2];
+      }
+    });
+    return result;
+  }
+}
+
+void TestMesh::test ()
+{
+  const Mesh      sphere = MeshUtil::icosphere (3);
+  const PrimAABox bounds = sphere.bounds ();
+  const float     tolerance = glm::length (bounds.maximum () - bounds.minimum ()) / 65535.0f;
+  Mesh            mesh (sphere);
+
+  mesh.compact ();
+
+  assert (mesh.isCompact ());
+  assert (mesh.numVertices () == sphere.numVertices ());
+  assert (mesh.numIndices () == sphere.numIndices ());
+  assert (glm::distance (mesh.bounds ().minimum (), bounds.minimum ()) < Util::epsilon ());
+  assert (glm::distance (mesh.bounds ().maximum (), bounds.maximum ()) < Util::epsilon ());
+
+  mesh.expand ();
+
+  assert (mesh.isCompact () == false);
+  assert (mesh.numVertices () == sphere.numVertices ());
+
+  for (unsigned int i = 0; i < sphere.numVertices (); i++)
+  {
+    assert (glm::distance (mesh.vertex (i), sphere.vertex (i)) <= tolerance);
+    assert (glm::dot (mesh.normal (i), sphere.normal (i)) > 0.9999f);
+  }
+  for (unsigned int i = 0; i < sphere.numIndices (); i++)
+  {
+    assert (mesh.index (i) == sphere.index (i));
+  }
+  unused (tolerance);
+
+  // bounds are maintained while vertices are moved, added and removed
+  Mesh incremental (MeshUtil::icosphere (6));
+  assert (hasScannedBounds (incremental));
+
+  for (unsigned int i = 0; i < incremental.numVertices (); i += 7)
+  {
+    incremental.vertex (i, 0.5f * incremental.vertex (i));
+  }
+  assert (hasScannedBounds (incremental));
+
+  incremental.vertex (3, glm::vec3 (2.0f, 0.0f, 0.0f));
+  assert (hasScannedBounds (incremental));
+
+  incremental.addVertex (glm::vec3 (0.0f, -3.0f, 0.0f));
+  assert (hasScannedBounds (incremental));
+
+  incremental.shrinkVertices (incremental.numVertices () / 3);
+  assert (hasScannedBounds (incremental));
+
+  MeshUtil::normalizeScaling (incremental);
+  assert (hasScannedBounds (incremental));
+  assert (glm::abs (incremental.bounds ().maxDimExtent () - 2.0f) < Util::epsilon ());
+
+  incremental.translate (glm::vec3 (1.0f, 2.0f, 3.0f));
+  incremental.normalize ();
+  assert (hasScannedBounds (incremental));
+
+  // triangle soups are welded
+  const Mesh                icosphere = MeshUtil::icosphere (2);
+  std::vector<glm::vec3>    soupVertices;
+  std::vector<unsigned int> soupIndices;
+
+  for (unsigned int i = 0; i < icosphere.numIndices (); i++)
+  {
+    soupVertices.push_back (icosphere.vertex (icosphere.index (i)));
+    soupIndices.push_back (i);
+  }
+  soupIndices.insert (soupIndices.end (), {0, 1, 2, 3, 3, 4});
+
+  const MeshUtil::CleanResult soup = MeshUtil::clean (soupVertices, soupIndices, 0.0f);
+
+  assert (soupVertices.size () == icosphere.numVertices ());
+  assert (soupIndices.size () == icosphere.numIndices ());
+  assert (soup.numDuplicateFaces == 1);
+  assert (soup.numDegeneratedFaces == 1);
+  assert (soup.numSplitVertices == 0);
+  unused (soup);
+
+  // tetrahedra that share a vertex are split
+  std::vector<glm::vec3>    tetraVertices (1, glm::vec3 (0.0f));
+  std::vector<unsigned int> tetraIndices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3,
+                                            0, 5, 4, 0, 4, 6, 0, 6, 5, 4, 5, 6};
+
+  for (unsigned int i = 0; i < 6; i++)
+  {
+    glm::vec3 v (0.0f);
+    v[i % 3] = i < 3 ? 1.0f : -1.0f;
+    tetraVertices.push_back (v);
+  }
+
+  const MeshUtil::CleanResult tetra = MeshUtil::clean (tetraVertices, tetraIndices, 0.0f);
+  Mesh                        tetraMesh;
+
+  assert (tetra.numSplitVertices == 1);
+  assert (tetraVertices.size () == 8);
+  unused (tetra);
+
+  for (const glm::vec3& v : tetraVertices)
+  {
+    tetraMesh.addVertex (v);
+  }
+  tetraMesh.addIndices (tetraIndices.data (), tetraIndices.size ());
+  assert (MeshUtil::checkConsistency (tetraMesh));
+
+  // the split tetrahedra are separate components, which are numbered by their first faces
+  std::vector<unsigned int> tetraComponents;
+  const unsigned int        numTetraComponents =
+    MeshUtil::components (tetraIndices, tetraVertices.size (), tetraComponents);
+
+  assert (numTetraComponents == 2);
+  assert (tetraComponents.size () == tetraIndices.size () / 3);
+  assert (tetraComponents[0] == 0 && tetraComponents.back () == 1);
+  assert (std::is_sorted (tetraComponents.begin (), tetraComponents.end ()));
+  unused (numTetraComponents);
+
+  // defragmenting moves the last elements into free slots until the mesh is dense
+  DynamicMesh fragmented (MeshUtil::icosphere (3));
+
+  for (unsigned int i = 0; i < fragmented.vertexCapacity (); i += 5)
+  {
+    if (fragmented.isFreeVertex (i) == false)
+    {
+      fragmented.deleteVertex (i);
+    }
+  }
+
+  const std::vector<std::array<float, 9>> fragmentedFaces = facePositions (fragmented);
+  const unsigned int                      numVertices = fragmented.numVertices ();
+
+  while (fragmented.defragment (50) > 0)
+  {
+  }
+  assert (fragmented.vertexCapacity () == numVertices);
+  assert (fragmented.faceCapacity () == fragmentedFaces.size ());
+  assert (facePositions (fragmented) == fragmentedFaces);
+
+  fragmented.forEachVertex ([&fragmented](unsigned int v) {
+    for (unsigned int f : fragmented.adjacentFaces (v))
+    {
+      unsigned int i1, i2, i3;
+      fragmented.vertexIndices (f, i1, i2, i3);
+      assert (v == i1 || v == i2 || v == i3);
+    }
+  });
+
+  // frozen vertices remain frozen when the mesh is pruned
+  DynamicMesh               frozen (MeshUtil::icosphere (2));
+  std::vector<unsigned int> frozenMap;
+
+  frozen.deleteVertex (0);
+  frozen.freeze (5, true);
+  frozen.prune (&frozenMap, nullptr);
+
+  for (unsigned int i = 1; i < frozenMap.size (); i++)
+  {
+    assert (frozen.isFrozen (frozenMap[i]) == (i == 5));
+  }
+
+  // the area of an icosphere approaches the area of its unit sphere from below
+  const DynamicMesh areaSphere (MeshUtil::icosphere (3));
+  const float       area = areaSphere.area ();
+
+  assert (area < 4.0f * glm::pi<float> () && area > 0.95f * 4.0f * glm::pi<float> ());
+
+  // pinned snapshots are not changed by later edits of their mesh
+  DynamicMesh                  edited (MeshUtil::icosphere (3));
+  const DynamicMeshSnapshotPtr pinned = edited.snapshot ();
+  const glm::vec3              moved = edited.vertex (0) + glm::vec3 (1.0f);
+
+  edited.vertex (0, moved);
+  edited.deleteFace (0);
+
+  const DynamicMeshSnapshotPtr latest = edited.snapshot ();
+
+  assert (pinned->version < latest->version);
+  assert (pinned->vertices.get (0) != moved && latest->vertices.get (0) == moved);
+  assert (pinned->isFreeFace (0) == false && latest->isFreeFace (0));
+  assert (latest->vertices.numElements () == edited.vertexCapacity ());
+  assert (latest->numFaces () == edited.faceCapacity ());
+  assert (latest->octreeVersion == latest->version);
+  assert (edited.snapshot () == latest);
+
+  // undoing and redoing recorded changes restores the original and the edited mesh
+  DynamicMesh       tracked (MeshUtil::icosphere (3));
+  const DynamicMesh original (tracked);
+
+  tracked.trackChanges ();
+  for (unsigned int i = 0; i < 10; i++)
+  {
+    tracked.vertex (i, tracked.vertex (i) * 1.1f);
+  }
+  tracked.deleteFace (0);
+  tracked.setAllNormals ();
+
+  const DynamicMeshChanges undo = tracked.untrackChanges ();
+  const DynamicMesh        trackedEdit (tracked);
+  const DynamicMeshChanges redo = tracked.applyChanges (undo);
+  const bool               isUndone = hasSameElements (tracked, original);
+
+  tracked.applyChanges (redo);
+  assert (isUndone && hasSameElements (tracked, trackedEdit));
+
+  // compressed changes restore the same meshes as uncompressed changes
+  DynamicMeshChanges compressedUndo (undo);
+
+  compressedUndo.compress ();
+  compressedUndo.decompress ();
+
+  DynamicMeshChanges compressedRedo = tracked.applyChanges (compressedUndo);
+  const bool         isUndoneCompressed = hasSameElements (tracked, original);
+
+  compressedRedo.compress ();
+  compressedRedo.decompress ();
+  tracked.applyChanges (compressedRedo);
+  assert (isUndoneCompressed && hasSameElements (tracked, trackedEdit));
+
+  // layers are only dropped by changes that move their vertices
+  DynamicMesh layered (MeshUtil::icosphere (2));
+
+  layered.trackChanges ();
+  layered.vertex (0, layered.vertex (0) * 1.1f);
+  layered.recordLayer (0);
+
+  const DynamicMeshChanges layerUndo = layered.untrackChanges ();
+
+  layered.trackChanges ();
+  layered.vertex (1, layered.vertex (1) * 1.1f);
+  layered.applyChanges (layered.untrackChanges ());
+
+  const bool keepsLayer = layered.layers ().isDisplaced (0);
+
+  layered.applyChanges (layerUndo);
+  assert (keepsLayer && layered.layers ().isDisplaced (0) == false);
+
+  unused (numVertices);
+  unused (area);
+  unused (pinned);
+  unused (latest);
+  unused (isUndone);
+  unused (isUndoneCompressed);
+  unused (keepsLayer);
+  unused (hasSameElements);
+}
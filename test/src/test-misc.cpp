@@ -4,6 +4,7 @@
  */
 #include <cassert>
 #include <limits>
+#include "hash.hpp"
 #include "test-misc.hpp"
 #include "util.hpp"
 
@@ -19,4 +20,9 @@ void TestMisc::test ()
   assert (Util::countOnes (256) == 1);
 
   assert (Util::countOnes (std::numeric_limits<unsigned int>::max ()) == sizeof (unsigned int) * 8);
+
+  assert (EdgeKey (3, 7) == EdgeKey (7, 3));
+  assert (EdgeKey (3, 7).vertex1 () == 3 && EdgeKey (3, 7).vertex2 () == 7);
+  assert (EdgeKey (0, 8) < EdgeKey (1, 2));
+  assert (Hash::mix (1) != Hash::mix (2));
 }
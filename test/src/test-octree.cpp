@@ -6,9 +6,286 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <random>
+#include <unordered_set>
 #include "dynamic/octree.hpp"
+#include "intersection.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
 #include "primitive/triangle.hpp"
 #include "test-octree.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::vector<glm::vec3> Positions;
+
+  // every element within the query sphere must be reported exactly once
+  void checkSphereQuery (const DynamicOctree& octree, const Positions& positions,
+                         const std::vector<bool>& isElement, const PrimSphere& sphere)
+  {
+    std::unordered_set<unsigned int> found;
+
+    octree.intersects (sphere, [&found, &isElement](bool, unsigned int i) {
+      assert (i < isElement.size ());
+      assert (isElement[i]);
+      const bool isInserted = found.insert (i).second;
+      assert (isInserted);
+      unused (isInserted);
+    });
+
+    for (unsigned int i = 0; i < positions.size (); i++)
+    {
+      if (isElement[i] && sphere.contains (positions[i]))
+      {
+        assert (found.count (i) == 1);
+      }
+    }
+
+    // the partitioned query must report the same elements
+    std::vector<unsigned int> contained;
+    std::vector<unsigned int> intersected;
+    octree.intersects (sphere, contained, intersected);
+
+    assert (contained.size () + intersected.size () == found.size ());
+    for (unsigned int i : contained)
+    {
+      assert (found.count (i) == 1);
+    }
+    for (unsigned int i : intersected)
+    {
+      assert (found.count (i) == 1);
+    }
+  }
+
+  void testModifications ()
+  {
+    const unsigned int numElements = 5000;
+    const float        extent = 0.01f;
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-10.0f, 10.0f);
+
+    DynamicOctree     octree;
+    Positions         positions;
+    std::vector<bool> isElement (numElements, true);
+
+    octree.setupRoot (glm::vec3 (0.0f), 1.0f);
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      positions.emplace_back (posD (gen), posD (gen), posD (gen));
+      octree.addElement (i, positions.back (), extent);
+    }
+
+    const DynamicOctree copy (octree);
+    const Positions     copyPositions (positions);
+
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      if (i % 2 == 0)
+      {
+        octree.deleteElement (i);
+        isElement[i] = false;
+      }
+      else
+      {
+        positions[i] = 0.5f * positions[i] + glm::vec3 (1.0f);
+        octree.realignElement (i, positions[i], extent);
+      }
+    }
+    octree.deleteEmptyChildren ();
+    octree.shrinkRoot ();
+
+    const PrimSphere sphere (glm::vec3 (1.0f), 3.0f);
+    checkSphereQuery (octree, positions, isElement, sphere);
+    checkSphereQuery (copy, copyPositions, std::vector<bool> (numElements, true), sphere);
+
+    std::vector<unsigned int> indexMap (numElements, Util::invalidIndex ());
+    Positions                 prunedPositions;
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      if (isElement[i])
+      {
+        indexMap[i] = prunedPositions.size ();
+        prunedPositions.push_back (positions[i]);
+      }
+    }
+    octree.updateIndices (indexMap);
+    checkSphereQuery (octree, prunedPositions, std::vector<bool> (prunedPositions.size (), true),
+                      sphere);
+  }
+
+  // leaves gather elements, and sparse subtrees are merged into leaves
+  void testLeaves ()
+  {
+    const unsigned int numElements = 5000;
+    const float        extent = 0.0001f;
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-1.0f, 1.0f);
+
+    DynamicOctree     gathering;
+    DynamicOctree     splitting;
+    Positions         positions;
+    std::vector<bool> isElement (numElements, true);
+
+    gathering.configure (16, 0.25f);
+    splitting.configure (0, 0.25f);
+    gathering.setupRoot (glm::vec3 (0.0f), 1.0f);
+    splitting.setupRoot (glm::vec3 (0.0f), 1.0f);
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      positions.emplace_back (posD (gen), posD (gen), posD (gen));
+      gathering.addElement (i, positions.back (), extent);
+      splitting.addElement (i, positions.back (), extent);
+    }
+
+    const unsigned int numNodes = gathering.statistics ().numNodes;
+    assert (numNodes < splitting.statistics ().numNodes);
+
+    const PrimSphere sphere (glm::vec3 (0.2f), 0.5f);
+    checkSphereQuery (gathering, positions, isElement, sphere);
+
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      if (i % 100 != 0)
+      {
+        gathering.deleteElement (i);
+        isElement[i] = false;
+      }
+    }
+    gathering.deleteEmptyChildren ();
+
+    assert (gathering.statistics ().numNodes < numNodes);
+    checkSphereQuery (gathering, positions, isElement, sphere);
+
+    for (unsigned int i = 0; i < numElements; i += 100)
+    {
+      gathering.deleteElement (i);
+    }
+    gathering.deleteEmptyChildren ();
+
+    assert (gathering.statistics ().numNodes == 0);
+    unused (numNodes);
+  }
+
+  void testBuild ()
+  {
+    const unsigned int numElements = 20000;
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-10.0f, 10.0f);
+    std::uniform_real_distribution<float> extentD (0.00001f, 2.0f);
+
+    DynamicOctree             octree;
+    Positions                 positions;
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec4>    elements;
+    std::vector<bool>         isElement (numElements, true);
+
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      positions.emplace_back (posD (gen), posD (gen), posD (gen));
+      indices.push_back (i);
+      elements.emplace_back (positions.back (), glm::pow (extentD (gen), 4.0f));
+    }
+    octree.build (indices, elements);
+
+    const PrimSphere sphere (glm::vec3 (2.0f), 4.0f);
+    checkSphereQuery (octree, positions, isElement, sphere);
+
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      if (i % 3 == 0)
+      {
+        octree.deleteElement (i);
+        isElement[i] = false;
+      }
+      else
+      {
+        positions[i] += glm::vec3 (0.01f);
+        octree.realignElement (i, positions[i], elements[i].w);
+      }
+    }
+    checkSphereQuery (octree, positions, isElement, sphere);
+  }
+
+  // a batch of rays must find the same nearest elements as single rays and as brute force
+  void testRayBatch ()
+  {
+    const unsigned int numElements = 2000;
+    const unsigned int numRays = 100;
+    const float        radius = 0.2f;
+
+    std::default_random_engine            gen;
+    std::uniform_real_distribution<float> posD (-5.0f, 5.0f);
+
+    DynamicOctree        octree;
+    Positions            positions;
+    std::vector<PrimRay> rays;
+
+    octree.setupRoot (glm::vec3 (0.0f), 1.0f);
+    for (unsigned int i = 0; i < numElements; i++)
+    {
+      positions.emplace_back (posD (gen), posD (gen), posD (gen));
+      octree.addElement (i, positions.back (), 2.0f * radius);
+    }
+    for (unsigned int i = 0; i < numRays; i++)
+    {
+      rays.emplace_back (glm::vec3 (posD (gen), posD (gen), -10.0f),
+                         glm::normalize (glm::vec3 (0.1f * posD (gen), 0.1f * posD (gen), 1.0f)));
+    }
+
+    const auto intersectSphere = [&positions, &rays, radius](unsigned int r, unsigned int i) {
+      float t;
+      if (IntersectionUtil::intersects (rays[r], PrimSphere (positions[i], radius), &t))
+      {
+        return t;
+      }
+      return Util::maxFloat ();
+    };
+
+    std::vector<float> batchDistances (numRays, Util::maxFloat ());
+    octree.intersects (rays, [&batchDistances, &intersectSphere](unsigned int r, unsigned int i) {
+      batchDistances[r] = glm::min (batchDistances[r], intersectSphere (r, i));
+      return batchDistances[r];
+    });
+
+    for (unsigned int r = 0; r < numRays; r++)
+    {
+      float distance = Util::maxFloat ();
+      octree.intersects (rays[r], [&distance, &intersectSphere, r](unsigned int i) {
+        distance = glm::min (distance, intersectSphere (r, i));
+        return distance;
+      });
+      assert (distance == batchDistances[r]);
+
+      // the ordered traversal must not skip the nearest element, and any-hit queries must agree
+      float nearest = Util::maxFloat ();
+      for (unsigned int i = 0; i < numElements; i++)
+      {
+        nearest = glm::min (nearest, intersectSphere (r, i));
+      }
+      assert (nearest == distance);
+
+      const float maxDistance = 10.0f;
+      const bool  isHit = octree.intersectsAny (
+        rays[r], maxDistance,
+        [&intersectSphere, r, maxDistance](const unsigned int* elements, unsigned int n) {
+          for (unsigned int i = 0; i < n; i++)
+          {
+            if (intersectSphere (r, elements[i]) < maxDistance)
+            {
+              return true;
+            }
+          }
+          return false;
+        });
+      assert (isHit == (nearest < maxDistance));
+      unused (nearest);
+      unused (isHit);
+    }
+  }
+}
 
 void TestOctree::test ()
 {
@@ -51,4 +328,9 @@ void TestOctree::test ()
   {
     octree.deleteElement (i);
   }
+
+  testModifications ();
+  testLeaves ();
+  testBuild ();
+  testRayBatch ();
 }
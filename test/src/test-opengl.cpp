@@ -0,0 +1,49 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <cassert>
+#include <iostream>
+#include <utility>
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+#include "test-opengl.hpp"
+
+void TestOpenGL::test (int& argc, char** argv)
+{
+  QGuiApplication   app (argc, argv);
+  QOffscreenSurface surface;
+  QOpenGLContext    context;
+
+  surface.create ();
+  if (context.create () == false || context.makeCurrent (&surface) == false)
+  {
+    std::cout << "skipped OpenGL tests: could not create OpenGL context\n";
+    return;
+  }
+  OpenGL::initializeFunctions (false);
+
+  // moved-from ids must not delete the buffers they gave away
+  OpenGLBufferId a;
+  a.allocate ();
+  const unsigned int id = a.id ();
+
+  OpenGLBufferId b (std::move (a));
+  assert (a.isValid () == false);
+  assert (b.id () == id);
+
+  OpenGLBufferId c;
+  c = std::move (b);
+  assert (b.isValid () == false);
+  assert (c.id () == id);
+
+  a.reset ();
+  b.reset ();
+  assert (OpenGL::glIsBuffer (c.id ()));
+
+  c.reset ();
+  assert (c.isValid () == false);
+}
@@ -0,0 +1,14 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TEST_OPENGL
+#define DILAY_TEST_OPENGL
+
+// OpenGL tests need a display, hence they are skipped if no context can be created
+namespace TestOpenGL
+{
+  void test (int&, char**);
+}
+
+#endif
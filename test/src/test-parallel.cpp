@@ -0,0 +1,106 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "idle-tasks.hpp"
+#include "parallel.hpp"
+#include "test-parallel.hpp"
+#include "util.hpp"
+
+void TestParallel::test ()
+{
+  const unsigned int n = 100000;
+
+  std::vector<unsigned int> visited (n, 0);
+  Parallel::forEach (n, [&visited](unsigned int i) { visited[i]++; });
+  assert (std::all_of (visited.begin (), visited.end (), [](unsigned int v) { return v == 1; }));
+
+  std::atomic<unsigned int> sum (0);
+  Parallel::forRange (n, 7, [&sum](unsigned int begin, unsigned int end) {
+    assert (end - begin <= 7);
+    sum += end - begin;
+  });
+  assert (sum == n);
+
+  std::atomic<unsigned int> numNested (0);
+  ParallelTaskGroup         group;
+  for (unsigned int i = 0; i < 16; i++)
+  {
+    group.add ([&numNested]() {
+      Parallel::forEach (100, [&numNested](unsigned int) { numNested++; });
+    });
+  }
+  group.wait ();
+  assert (numNested == 1600);
+
+  // calls within a budget never exceed it together, and calls beyond it run alone
+  const std::vector<std::size_t> costs = {3, 5, 2, 8, 4, 1, 6};
+  std::atomic<unsigned int>      runningCosts (0);
+  std::atomic<unsigned int>      numBudgeted (0);
+  Parallel::forEach (costs, 6, [&costs, &runningCosts, &numBudgeted](unsigned int i) {
+    const unsigned int running = runningCosts += (unsigned int) costs[i];
+    assert (running <= 6 || running == costs[i]);
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    runningCosts -= (unsigned int) costs[i];
+    numBudgeted++;
+    unused (running);
+  });
+  assert (numBudgeted == costs.size ());
+
+  // exceptions of tasks are rethrown by waiting for their group, after all tasks finished
+  std::atomic<unsigned int> numThrowing (0);
+  ParallelTaskGroup         throwing;
+  bool                      isRethrown = false;
+  for (unsigned int i = 0; i < 100; i++)
+  {
+    throwing.add ([&numThrowing, i]() {
+      numThrowing++;
+      if (i == 50)
+      {
+        throw std::runtime_error ("task failed");
+      }
+    });
+  }
+  try
+  {
+    throwing.wait ();
+  }
+  catch (const std::runtime_error&)
+  {
+    isRethrown = true;
+  }
+  assert (isRethrown && numThrowing == 100);
+
+  // idle tasks are paused during strokes, and waiting runs them on the calling thread
+  std::atomic<unsigned int> numIdle (0);
+  IdleTask                  paused;
+  IdleTask                  resumed;
+  IdleTasks::idleDelay (0);
+  IdleTasks::isStroking (true);
+  paused.schedule ([&numIdle]() { numIdle++; });
+  resumed.schedule ([&numIdle]() { numIdle++; });
+  std::this_thread::sleep_for (std::chrono::milliseconds (10));
+  assert (numIdle == 0 && paused.isReady () == false);
+  paused.wait ();
+  assert (numIdle == 1 && paused.isReady ());
+
+  IdleTasks::isStroking (false);
+  for (unsigned int i = 0; i < 1000 && resumed.isReady () == false; i++)
+  {
+    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+  }
+  assert (numIdle == 2 && resumed.isReady ());
+
+  unused (visited);
+  unused (sum);
+  unused (numNested);
+  unused (numBudgeted);
+  unused (isRethrown);
+  unused (numIdle);
+}
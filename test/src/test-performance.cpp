@@ -0,0 +1,257 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh-intersection.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "test-performance.hpp"
+#include "tool/remesh/action.hpp"
+#include "tool/sculpt/util/action.hpp"
+#include "tool/sculpt/util/arena.hpp"
+#include "tool/sculpt/util/brush.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::chrono::steady_clock Clock;
+
+  const unsigned int numRepetitions = 3;
+
+  struct Budget
+  {
+    std::string name;
+    float       milliseconds;
+    float       megabytes;
+  };
+
+  struct Measurement
+  {
+    float       milliseconds;
+    std::size_t numBytes;
+  };
+
+  // reference budgets of a current desktop machine
+  std::vector<Budget> defaultBudgets ()
+  {
+    return {Budget{"prune", 1500.0f, 600.0f}, Budget{"octree-sphere-queries", 500.0f, 60.0f},
+            Budget{"draw-dabs", 500.0f, 60.0f}, Budget{"remesh", 3000.0f, 60.0f}};
+  }
+
+  bool readBudgets (const std::string& fileName, std::vector<Budget>& budgets)
+  {
+    std::ifstream file (fileName);
+    std::string   line;
+
+    if (file.is_open () == false)
+    {
+      return false;
+    }
+
+    while (std::getline (file, line))
+    {
+      std::istringstream stream (line.substr (0, line.find ('#')));
+      Budget             budget;
+
+      if (stream >> budget.name)
+      {
+        if (bool(stream >> budget.milliseconds >> budget.megabytes) == false)
+        {
+          return false;
+        }
+
+        bool found = false;
+        for (Budget& b : budgets)
+        {
+          if (b.name == budget.name)
+          {
+            b = budget;
+            found = true;
+          }
+        }
+        if (found == false)
+        {
+          std::cerr << "unknown performance scenario " << budget.name << "\n";
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // the fastest of several repetitions, each of which is set up without being measured
+  float measure (const std::function<void()>& setup, const std::function<void()>& run)
+  {
+    float fastest = 0.0f;
+
+    for (unsigned int i = 0; i < numRepetitions; i++)
+    {
+      setup ();
+
+      const Clock::time_point start = Clock::now ();
+      run ();
+      const float ms = std::chrono::duration<float, std::milli> (Clock::now () - start).count ();
+
+      fastest = i == 0 ? ms : glm::min (fastest, ms);
+    }
+    return fastest;
+  }
+
+  // prunes a mesh of about 1.3M faces, a quarter of which are deleted
+  Measurement prune ()
+  {
+    const Mesh  sphere = MeshUtil::icosphere (8);
+    DynamicMesh mesh (sphere);
+
+    const float ms = measure (
+      [&sphere, &mesh]() {
+        mesh.fromMesh (sphere);
+        for (unsigned int i = 0; i < sphere.numIndices () / 3; i += 4)
+        {
+          mesh.deleteFace (i);
+        }
+      },
+      [&mesh]() { mesh.prune (); });
+
+    return Measurement{ms, mesh.numBytes ()};
+  }
+
+  // queries the faces of 10k spheres on a mesh of about 82k faces
+  Measurement octreeSphereQueries ()
+  {
+    const unsigned int numQueries = 10000;
+    DynamicMesh        mesh (MeshUtil::icosphere (6));
+    DynamicFaces       faces;
+
+    const float ms = measure ([]() {},
+                              [&mesh, &faces]() {
+                                for (unsigned int i = 0; i < numQueries; i++)
+                                {
+                                  const float angle = 2.0f * glm::pi<float> () * float(i) /
+                                                      float(numQueries);
+                                  const glm::vec3 center (glm::cos (angle), glm::sin (angle),
+                                                          -1.0f + (2.0f * float(i) /
+                                                                   float(numQueries)));
+                                  faces.reset ();
+                                  mesh.intersects (PrimSphere (center, 0.05f), faces);
+                                }
+                              });
+
+    return Measurement{ms, mesh.numBytes ()};
+  }
+
+  // sculpts a stroke of 100 subdividing draw dabs on a mesh of about 82k faces
+  Measurement drawDabs ()
+  {
+    const unsigned int numDabs = 100;
+    const Mesh         sphere = MeshUtil::icosphere (6);
+    DynamicMesh        mesh (sphere);
+    SculptBrush        brush;
+    ToolSculptArena    arena;
+
+    brush.radius (0.1f);
+    brush.detailFactor (0.75f);
+    brush.stepWidthFactor (0.3f);
+    brush.subdivide (true);
+    brush.initParameters<SBDrawParameters> ().intensity (0.5f);
+
+    const float ms = measure ([&sphere, &mesh]() { mesh.fromMesh (sphere); },
+                              [&mesh, &brush, &arena]() {
+                                for (unsigned int i = 0; i < numDabs; i++)
+                                {
+                                  const float angle = glm::pi<float> () * float(i) / float(numDabs);
+                                  const glm::vec3 direction (glm::cos (angle), glm::sin (angle),
+                                                             0.0f);
+
+                                  DynamicMeshIntersection intersection;
+                                  if (mesh.intersects (PrimRay (2.0f * direction, -direction),
+                                                       intersection))
+                                  {
+                                    brush.setPointOfAction (mesh, intersection.position (),
+                                                            intersection.normal ());
+                                    ToolSculptAction::sculpt (brush, arena);
+                                  }
+                                }
+                                brush.resetPointOfAction ();
+                                arena.reset ();
+                              });
+
+    return Measurement{ms, mesh.numBytes ()};
+  }
+
+  // remeshes a mesh of about 20k faces at a medium resolution
+  Measurement remesh ()
+  {
+    const DynamicMesh mesh (MeshUtil::icosphere (5));
+    DynamicMesh       result;
+
+    const float ms = measure ([&result]() { result.reset (); },
+                              [&mesh, &result]() {
+                                const bool success = ToolRemeshAction::remesh (mesh, 0.02f, result);
+                                assert (success);
+                                unused (success);
+                              });
+
+    return Measurement{ms, result.numBytes ()};
+  }
+
+  Measurement run (const std::string& name)
+  {
+    if (name == "prune")
+    {
+      return prune ();
+    }
+    else if (name == "octree-sphere-queries")
+    {
+      return octreeSphereQueries ();
+    }
+    else if (name == "draw-dabs")
+    {
+      return drawDabs ();
+    }
+    else if (name == "remesh")
+    {
+      return remesh ();
+    }
+    DILAY_IMPOSSIBLE
+  }
+}
+
+bool TestPerformance::test (const std::string& budgetsFile, float tolerance)
+{
+  std::vector<Budget> budgets = defaultBudgets ();
+
+  if (budgetsFile.empty () == false && readBudgets (budgetsFile, budgets) == false)
+  {
+    std::cerr << "could not read performance budgets " << budgetsFile << "\n";
+    return false;
+  }
+
+  bool success = true;
+  for (const Budget& budget : budgets)
+  {
+    const Measurement m = run (budget.name);
+    const float       megabytes = float(m.numBytes) / (1024.0f * 1024.0f);
+    const bool        exceedsTime = m.milliseconds > budget.milliseconds * (1.0f + tolerance);
+    const bool        exceedsMemory = megabytes > budget.megabytes * (1.0f + tolerance);
+
+    std::cout << budget.name << ": " << m.milliseconds << " ms (budget " << budget.milliseconds
+              << " ms), " << megabytes << " MB (budget " << budget.megabytes << " MB)"
+              << (exceedsTime || exceedsMemory ? " EXCEEDED" : "") << "\n";
+
+    success = success && exceedsTime == false && exceedsMemory == false;
+  }
+  return success;
+}
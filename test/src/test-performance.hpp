@@ -0,0 +1,19 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TEST_PERFORMANCE
+#define DILAY_TEST_PERFORMANCE
+
+#include <string>
+
+/* Runs fixed scenarios of hot paths and compares their time and memory with budgets.  Budgets
+ * can be overridden by a file with lines `NAME MILLISECONDS MEGABYTES` (`#` starts a comment).
+ */
+namespace TestPerformance
+{
+  // returns false if a scenario exceeds a budget by more than the given (relative) tolerance
+  bool test (const std::string&, float);
+}
+
+#endif
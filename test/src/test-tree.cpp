@@ -102,3 +102,42 @@ void TestTree::test3 ()
   assert (t3.root ().data () == 1);
   assert (t3.root ().lastChild ().data () == 2);
 }
+
+void TestTree::test4 ()
+{
+  Tree<int> t;
+
+  TreeNode<int>& node3 = t.emplaceRoot (1).emplaceChild (2).emplaceChild (3);
+  node3.emplaceChild (4);
+  t.root ().emplaceChild (5);
+
+  FlatTree<int> flat (t);
+
+  assert (flat.numNodes () == 5);
+  assert (flat.data (0) == 1);
+  assert (flat.parent (0) == Util::invalidIndex ());
+
+  const Tree<int> copy = flat.toTree ();
+
+  assert (copy.root ().numNodes () == 5);
+  assert (copy.root ().data () == 1);
+  assert (copy.root ().lastChild ().data () == 5);
+
+  unsigned int i3 = Util::invalidIndex ();
+  flat.forEachConstNode ([&flat, &i3](unsigned int i) {
+    if (flat.data (i) == 3)
+    {
+      i3 = i;
+    }
+  });
+  flat.rebalance (i3);
+  t.rebalance (node3);
+
+  const Tree<int> rebalanced = flat.toTree ();
+
+  assert (rebalanced.root ().numNodes () == 5);
+  assert (rebalanced.root ().data () == 3);
+  assert (rebalanced.root ().lastChild ().data () == t.root ().lastChild ().data ());
+  assert (rebalanced.root ().lastChild ().lastChild ().data () == 1);
+  assert (rebalanced.root ().lastChild ().lastChild ().lastChild ().data () == 5);
+}
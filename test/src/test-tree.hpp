@@ -10,6 +10,7 @@ namespace TestTree
   void test1 ();
   void test2 ();
   void test3 ();
+  void test4 ();
 }
 
 #endif
@@ -9,21 +9,33 @@ INCLUDEPATH    += src $$PWD/../lib/src
 SOURCES += \
            src/main.cpp \
            src/test-bitset.cpp \
+           src/test-bvh.cpp \
            src/test-distance.cpp \
+           src/test-import-export.cpp \
            src/test-intersection.cpp \
            src/test-maybe.cpp \
+           src/test-mesh.cpp \
            src/test-misc.cpp \
            src/test-octree.cpp \
+           src/test-opengl.cpp \
+           src/test-parallel.cpp \
+           src/test-performance.cpp \
            src/test-prune.cpp \
            src/test-tree.cpp
 
 HEADERS += \
            src/test-bitset.hpp \
+           src/test-bvh.hpp \
            src/test-distance.hpp \
+           src/test-import-export.hpp \
            src/test-intersection.hpp \
            src/test-maybe.hpp \
+           src/test-mesh.hpp \
            src/test-misc.hpp \
            src/test-octree.hpp \
+           src/test-opengl.hpp \
+           src/test-parallel.hpp \
+           src/test-performance.hpp \
            src/test-prune.hpp \
            src/test-tree.hpp
 